@@ -0,0 +1,210 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Slicer includes
+#include "vtkSlicerApplicationLogic.h"
+#include "vtkSlicerTask.h"
+#include "vtkMRMLCoreTestingMacros.h"
+
+// MRML includes
+#include <vtkMRMLAbstractLogic.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+
+// ITK includes
+#include <itkMutexLock.h>
+
+// ITKSYS includes
+#include <itksys/SystemTools.hxx>
+
+// STD includes
+#include <vector>
+
+//---------------------------------------------------------------------------
+/// vtkSlicerTaskTestLogic records the order in which its tasks are executed.
+class vtkSlicerTaskTestLogic: public vtkMRMLAbstractLogic
+{
+public:
+  vtkTypeMacro(vtkSlicerTaskTestLogic, vtkMRMLAbstractLogic);
+  static vtkSlicerTaskTestLogic *New();
+
+  /// Record the task identifier passed as client data
+  void RecordTask(void* clientData)
+  {
+    this->Lock.Lock();
+    this->ExecutedTasks.push_back(*reinterpret_cast<int*>(clientData));
+    this->Lock.Unlock();
+  }
+
+  /// Block the calling thread until Release is set
+  void BlockTask(void* vtkNotUsed(clientData))
+  {
+    this->Lock.Lock();
+    this->Blocked = true;
+    this->Lock.Unlock();
+    bool released = false;
+    while (!released)
+      {
+      itksys::SystemTools::Delay(10);
+      this->Lock.Lock();
+      released = this->Released;
+      this->Lock.Unlock();
+      }
+  }
+
+  std::vector<int> GetExecutedTasks()
+  {
+    this->Lock.Lock();
+    std::vector<int> executedTasks = this->ExecutedTasks;
+    this->Lock.Unlock();
+    return executedTasks;
+  }
+
+  bool IsBlocked()
+  {
+    this->Lock.Lock();
+    bool blocked = this->Blocked;
+    this->Lock.Unlock();
+    return blocked;
+  }
+
+  void Release()
+  {
+    this->Lock.Lock();
+    this->Released = true;
+    this->Lock.Unlock();
+  }
+
+protected:
+  vtkSlicerTaskTestLogic() : Blocked(false), Released(false) {}
+  virtual ~vtkSlicerTaskTestLogic() {}
+
+  itk::SimpleMutexLock Lock;
+  std::vector<int> ExecutedTasks;
+  bool Blocked;
+  bool Released;
+};
+
+vtkStandardNewMacro(vtkSlicerTaskTestLogic);
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+bool WaitForTasks(vtkSlicerTaskTestLogic* logic, size_t count)
+{
+  for (int i = 0; i < 500 && logic->GetExecutedTasks().size() < count; ++i)
+    {
+    itksys::SystemTools::Delay(10);
+    }
+  return logic->GetExecutedTasks().size() >= count;
+}
+
+//---------------------------------------------------------------------------
+bool WaitForBlockedTask(vtkSlicerTaskTestLogic* logic)
+{
+  for (int i = 0; i < 500 && !logic->IsBlocked(); ++i)
+    {
+    itksys::SystemTools::Delay(10);
+    }
+  return logic->IsBlocked();
+}
+
+//---------------------------------------------------------------------------
+// Tasks are counted as completed after their function returns, wait for the
+// counter rather than for the recorded task.
+bool WaitForCompletedTasks(vtkSlicerApplicationLogic* appLogic, int type, int count)
+{
+  for (int i = 0; i < 500 && appLogic->GetNumberOfCompletedTasks(type) < count; ++i)
+    {
+    itksys::SystemTools::Delay(10);
+    }
+  return appLogic->GetNumberOfCompletedTasks(type) >= count;
+}
+
+//---------------------------------------------------------------------------
+bool ScheduleTask(vtkSlicerApplicationLogic* appLogic, vtkSlicerTaskTestLogic* logic,
+                  vtkMRMLAbstractLogic::TaskFunctionPointer function,
+                  int type, int priority, int* clientData)
+{
+  vtkNew<vtkSlicerTask> task;
+  task->SetTaskFunction(logic, function, clientData);
+  task->SetType(type);
+  task->SetPriority(priority);
+  return appLogic->ScheduleTask(task.GetPointer()) != 0;
+}
+
+} // end of anonymous namespace
+
+//---------------------------------------------------------------------------
+int vtkSlicerTaskTest1(int , char * [])
+{
+  vtkMRMLAbstractLogic::TaskFunctionPointer recordTask =
+    (vtkMRMLAbstractLogic::TaskFunctionPointer)&vtkSlicerTaskTestLogic::RecordTask;
+  vtkMRMLAbstractLogic::TaskFunctionPointer blockTask =
+    (vtkMRMLAbstractLogic::TaskFunctionPointer)&vtkSlicerTaskTestLogic::BlockTask;
+  int taskIds[3] = {0, 1, 2};
+
+  vtkNew<vtkSlicerApplicationLogic> appLogic;
+  vtkNew<vtkSlicerTaskTestLogic> logic;
+
+  // Tasks can not be scheduled before the threads are created
+  CHECK_BOOL(ScheduleTask(appLogic.GetPointer(), logic.GetPointer(), recordTask,
+    vtkSlicerTask::Processing, 0, &taskIds[0]), false);
+
+  appLogic->SetNumberOfProcessingThreads(1);
+  appLogic->SetNumberOfNetworkingThreads(1);
+  appLogic->CreateProcessingThread();
+
+  // Block the only processing thread
+  CHECK_BOOL(ScheduleTask(appLogic.GetPointer(), logic.GetPointer(), blockTask,
+    vtkSlicerTask::Processing, 0, 0), true);
+  CHECK_BOOL(WaitForBlockedTask(logic.GetPointer()), true);
+
+  // Queue processing tasks: the high priority one must run first
+  CHECK_BOOL(ScheduleTask(appLogic.GetPointer(), logic.GetPointer(), recordTask,
+    vtkSlicerTask::Processing, 0, &taskIds[0]), true);
+  CHECK_BOOL(ScheduleTask(appLogic.GetPointer(), logic.GetPointer(), recordTask,
+    vtkSlicerTask::Processing, 10, &taskIds[1]), true);
+
+  // A networking task must not wait for the blocked processing thread
+  CHECK_BOOL(ScheduleTask(appLogic.GetPointer(), logic.GetPointer(), recordTask,
+    vtkSlicerTask::Networking, 0, &taskIds[2]), true);
+  CHECK_BOOL(WaitForCompletedTasks(appLogic.GetPointer(), vtkSlicerTask::Networking, 1), true);
+  CHECK_INT(static_cast<int>(logic->GetExecutedTasks().size()), 1);
+  CHECK_INT(logic->GetExecutedTasks()[0], 2);
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(vtkSlicerTask::Processing), 2);
+  CHECK_INT(appLogic->GetNumberOfRunningTasks(vtkSlicerTask::Processing), 1);
+  CHECK_INT(appLogic->GetNumberOfCompletedTasks(vtkSlicerTask::Networking), 1);
+
+  logic->Release();
+  CHECK_BOOL(WaitForTasks(logic.GetPointer(), 3), true);
+  CHECK_INT(logic->GetExecutedTasks()[1], 1);
+  CHECK_INT(logic->GetExecutedTasks()[2], 0);
+
+  appLogic->TerminateProcessingThread();
+
+  CHECK_INT(appLogic->GetNumberOfQueuedTasks(vtkSlicerTask::Processing), 0);
+  CHECK_INT(appLogic->GetNumberOfCompletedTasks(vtkSlicerTask::Processing), 3);
+  CHECK_BOOL(appLogic->GetMaximumTaskQueueSize(vtkSlicerTask::Processing) >= 2, true);
+  CHECK_BOOL(appLogic->GetMaximumTaskRunTime(vtkSlicerTask::Processing) > 0., true);
+
+  appLogic->ResetTaskStatistics();
+  CHECK_INT(appLogic->GetNumberOfCompletedTasks(vtkSlicerTask::Processing), 0);
+
+  return EXIT_SUCCESS;
+}
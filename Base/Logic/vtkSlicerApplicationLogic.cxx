@@ -35,6 +35,9 @@
 #include <vtkPointData.h>
 #include <vtkPolyData.h>
 
+// ITK includes
+#include <itkConditionVariable.h>
+
 // ITKSYS includes
 #include <itksys/SystemTools.hxx>
 
@@ -52,7 +55,102 @@
 #include "vtkSlicerApplicationLogicRequests.h"
 
 //----------------------------------------------------------------------------
-class ProcessingTaskQueue : public std::queue<vtkSmartPointer<vtkSlicerTask> > {};
+/// Queues of tasks waiting to be executed by the processing and networking
+/// threads. There is one queue per task type so that a task of one type
+/// never blocks the threads of another type.
+/// All members are protected by Lock.
+class ProcessingTaskQueue
+{
+public:
+  struct ScheduledTask
+  {
+    vtkSmartPointer<vtkSlicerTask> Task;
+    int Priority;
+    unsigned long Sequence;
+    double ScheduledTime;
+
+    /// std::priority_queue pops the largest element first: higher priority
+    /// first, then first scheduled first.
+    bool operator<(const ScheduledTask& other) const
+    {
+      if (this->Priority != other.Priority)
+        {
+        return this->Priority < other.Priority;
+        }
+      return this->Sequence > other.Sequence;
+    }
+  };
+
+  struct Statistics
+  {
+    Statistics() { this->Reset(); }
+    void Reset()
+    {
+      this->Completed = 0;
+      this->MaximumQueueSize = 0;
+      this->TotalWaitTime = 0.;
+      this->MaximumWaitTime = 0.;
+      this->TotalRunTime = 0.;
+      this->MaximumRunTime = 0.;
+    }
+
+    int Completed;
+    int MaximumQueueSize;
+    double TotalWaitTime;
+    double MaximumWaitTime;
+    double TotalRunTime;
+    double MaximumRunTime;
+  };
+
+  struct TaskQueue
+  {
+    TaskQueue()
+      : NumberOfRunningTasks(0)
+    {
+      this->TaskAvailable = itk::ConditionVariable::New();
+    }
+
+    std::priority_queue<ScheduledTask> Tasks;
+    /// Signaled when a task is pushed into Tasks or when the threads are
+    /// terminated.
+    itk::ConditionVariable::Pointer TaskAvailable;
+    int NumberOfRunningTasks;
+    Statistics TaskStatistics;
+  };
+
+  ProcessingTaskQueue()
+    : Active(false)
+    , Sequence(0)
+  {
+  }
+
+  TaskQueue& GetQueue(int taskType)
+  {
+    return taskType == vtkSlicerTask::Networking ?
+      this->NetworkingQueue : this->ProcessingQueue;
+  }
+
+  void Clear()
+  {
+    while (!this->ProcessingQueue.Tasks.empty())
+      {
+      this->ProcessingQueue.Tasks.pop();
+      }
+    while (!this->NetworkingQueue.Tasks.empty())
+      {
+      this->NetworkingQueue.Tasks.pop();
+      }
+  }
+
+  itk::SimpleMutexLock Lock;
+  /// True while the worker threads must wait for tasks.
+  bool Active;
+  unsigned long Sequence;
+  TaskQueue ProcessingQueue;
+  TaskQueue NetworkingQueue;
+};
+
+//----------------------------------------------------------------------------
 class ModifiedQueue : public std::queue<vtkSmartPointer<vtkObject> > {};
 class ReadDataQueue : public std::queue<DataRequest*> {};
 class WriteDataQueue : public std::queue<DataRequest*> {};
@@ -64,10 +162,8 @@ vtkStandardNewMacro(vtkSlicerApplicationLogic);
 vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
 {
   this->ProcessingThreader = itk::MultiThreader::New();
-  this->ProcessingThreadId = -1;
-  this->ProcessingThreadActive = false;
-  this->ProcessingThreadActiveLock = itk::MutexLock::New();
-  this->ProcessingTaskQueueLock = itk::MutexLock::New();
+  this->NumberOfProcessingThreads = 1;
+  this->NumberOfNetworkingThreads = 1;
 
   this->ModifiedQueueActive = false;
   this->ModifiedQueueActiveLock = itk::MutexLock::New();
@@ -91,21 +187,9 @@ vtkSlicerApplicationLogic::vtkSlicerApplicationLogic()
 //----------------------------------------------------------------------------
 vtkSlicerApplicationLogic::~vtkSlicerApplicationLogic()
 {
-  // Note that TerminateThread does not kill a thread, it only waits
-  // for the thread to finish.  We need to signal the thread that we
-  // want to terminate
-  if (this->ProcessingThreadId != -1 && this->ProcessingThreader)
-    {
-    // Signal the processingThread that we are terminating.
-    this->ProcessingThreadActiveLock->Lock();
-    this->ProcessingThreadActive = false;
-    this->ProcessingThreadActiveLock->Unlock();
-
-    // Wait for the thread to finish and clean up the state of the threader
-    this->ProcessingThreader->TerminateThread( this->ProcessingThreadId );
-
-    this->ProcessingThreadId = -1;
-    }
+  // Signal the processing and networking threads that we are terminating
+  // and wait for them to finish.
+  this->TerminateProcessingThread();
 
   delete this->InternalTaskQueue;
 
@@ -181,41 +265,35 @@ void vtkSlicerApplicationLogic::PrintSelf(ostream& os, vtkIndent indent)
   this->vtkObject::PrintSelf(os, indent);
 
   os << indent << "SlicerApplicationLogic:             " << this->GetClassName() << "\n";
+  os << indent << "NumberOfProcessingThreads: " << this->NumberOfProcessingThreads << "\n";
+  os << indent << "NumberOfNetworkingThreads: " << this->NumberOfNetworkingThreads << "\n";
 }
 
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::CreateProcessingThread()
 {
-  if (this->ProcessingThreadId == -1)
-    {
-    this->ProcessingThreadActiveLock->Lock();
-    this->ProcessingThreadActive = true;
-    this->ProcessingThreadActiveLock->Unlock();
-
-    this->ProcessingThreadId
-      = this->ProcessingThreader
-      ->SpawnThread(vtkSlicerApplicationLogic::ProcessingThreaderCallback,
-                    this);
-
-    // Start four network threads (TODO: make the number of threads a setting)
-    this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
-          ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
-                    this) );
-    /*
-     * TODO: it looks like curl is not thread safe by default
-     * - maybe there's a setting that cmcurl can have
-     *   similar to the --enable-threading of the standard curl build
-     *
-    this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
-          ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
-                    this) );
-    this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
-          ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
-                    this) );
-    this->NetworkingThreadIDs.push_back ( this->ProcessingThreader
-          ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
-                    this) );
-    */
+  if (this->ProcessingThreadIDs.empty())
+    {
+    this->InternalTaskQueue->Lock.Lock();
+    this->InternalTaskQueue->Active = true;
+    this->InternalTaskQueue->Lock.Unlock();
+
+    for (int i = 0; i < this->NumberOfProcessingThreads; ++i)
+      {
+      this->ProcessingThreadIDs.push_back( this->ProcessingThreader
+        ->SpawnThread(vtkSlicerApplicationLogic::ProcessingThreaderCallback,
+                      this) );
+      }
+
+    // TODO: it looks like curl is not thread safe by default
+    // - maybe there's a setting that cmcurl can have
+    //   similar to the --enable-threading of the standard curl build
+    for (int i = 0; i < this->NumberOfNetworkingThreads; ++i)
+      {
+      this->NetworkingThreadIDs.push_back( this->ProcessingThreader
+        ->SpawnThread(vtkSlicerApplicationLogic::NetworkingThreaderCallback,
+                      this) );
+      }
 
     // Setup the communication channel back to the main thread
     this->ModifiedQueueActiveLock->Lock();
@@ -238,7 +316,7 @@ void vtkSlicerApplicationLogic::CreateProcessingThread()
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::TerminateProcessingThread()
 {
-  if (this->ProcessingThreadId != -1)
+  if (!this->ProcessingThreadIDs.empty())
     {
     this->ModifiedQueueActiveLock->Lock();
     this->ModifiedQueueActive = false;
@@ -252,22 +330,35 @@ void vtkSlicerApplicationLogic::TerminateProcessingThread()
     this->WriteDataQueueActive = false;
     this->WriteDataQueueActiveLock->Unlock();
 
-    this->ProcessingThreadActiveLock->Lock();
-    this->ProcessingThreadActive = false;
-    this->ProcessingThreadActiveLock->Unlock();
-
-    this->ProcessingThreader->TerminateThread( this->ProcessingThreadId );
-    this->ProcessingThreadId = -1;
+    // Wake up all the idle threads so that they can exit
+    this->InternalTaskQueue->Lock.Lock();
+    this->InternalTaskQueue->Active = false;
+    this->InternalTaskQueue->ProcessingQueue.TaskAvailable->Broadcast();
+    this->InternalTaskQueue->NetworkingQueue.TaskAvailable->Broadcast();
+    this->InternalTaskQueue->Lock.Unlock();
 
+    // Note that TerminateThread does not kill a thread, it only waits
+    // for the thread to finish.
     std::vector<int>::const_iterator idIterator;
-    idIterator = this->NetworkingThreadIDs.begin();
-    while (idIterator != this->NetworkingThreadIDs.end())
+    for (idIterator = this->ProcessingThreadIDs.begin();
+         idIterator != this->ProcessingThreadIDs.end(); ++idIterator)
+      {
+      this->ProcessingThreader->TerminateThread( *idIterator );
+      }
+    this->ProcessingThreadIDs.clear();
+
+    for (idIterator = this->NetworkingThreadIDs.begin();
+         idIterator != this->NetworkingThreadIDs.end(); ++idIterator)
       {
       this->ProcessingThreader->TerminateThread( *idIterator );
-      ++idIterator;
       }
     this->NetworkingThreadIDs.clear();
 
+    // Discard the tasks that have not been executed
+    this->InternalTaskQueue->Lock.Lock();
+    this->InternalTaskQueue->Clear();
+    this->InternalTaskQueue->Lock.Unlock();
+
     }
 }
 
@@ -310,48 +401,7 @@ vtkSlicerApplicationLogic
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::ProcessProcessingTasks()
 {
-  int active = true;
-  vtkSmartPointer<vtkSlicerTask> task = 0;
-
-  while (active)
-    {
-    // Check to see if we should be shutting down
-    this->ProcessingThreadActiveLock->Lock();
-    active = this->ProcessingThreadActive;
-    this->ProcessingThreadActiveLock->Unlock();
-
-    if (active)
-      {
-      // pull a task off the queue
-      this->ProcessingTaskQueueLock->Lock();
-      if ((*this->InternalTaskQueue).size() > 0)
-        {
-        // std::cout << "Number of queued tasks: " << (*this->InternalTaskQueue).size() << std::endl;
-
-        // only handle processing tasks in this thread
-        task = (*this->InternalTaskQueue).front();
-        if ( task->GetType() == vtkSlicerTask::Processing )
-          {
-          (*this->InternalTaskQueue).pop();
-          }
-        else
-          {
-          task = NULL;
-          }
-        }
-      this->ProcessingTaskQueueLock->Unlock();
-
-      // process the task (should this be in a separate thread?)
-      if (task)
-        {
-        task->Execute();
-        task = 0;
-        }
-      }
-
-    // busy wait
-    itksys::SystemTools::Delay(100);
-    }
+  this->ProcessTasks(vtkSlicerTask::Processing);
 }
 
 ITK_THREAD_RETURN_TYPE
@@ -392,66 +442,169 @@ vtkSlicerApplicationLogic
 //----------------------------------------------------------------------------
 void vtkSlicerApplicationLogic::ProcessNetworkingTasks()
 {
-  int active = true;
-  vtkSmartPointer<vtkSlicerTask> task = 0;
+  this->ProcessTasks(vtkSlicerTask::Networking);
+}
 
-  while (active)
-    {
-    // Check to see if we should be shutting down
-    this->ProcessingThreadActiveLock->Lock();
-    active = this->ProcessingThreadActive;
-    this->ProcessingThreadActiveLock->Unlock();
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::ProcessTasks(int taskType)
+{
+  ProcessingTaskQueue* queues = this->InternalTaskQueue;
+  ProcessingTaskQueue::TaskQueue& queue = queues->GetQueue(taskType);
 
-    if (active)
+  queues->Lock.Lock();
+  while (queues->Active)
+    {
+    if (queue.Tasks.empty())
       {
-      // pull a task off the queue
-      this->ProcessingTaskQueueLock->Lock();
-      if ((*this->InternalTaskQueue).size() > 0)
-        {
-        // std::cout << "Number of queued tasks: " << (*this->InternalTaskQueue).size() << std::endl;
-        task = (*this->InternalTaskQueue).front();
-        if ( task->GetType() == vtkSlicerTask::Networking )
-          {
-          (*this->InternalTaskQueue).pop();
-          }
-        else
-          {
-          task = NULL;
-          }
-        }
-      this->ProcessingTaskQueueLock->Unlock();
-
-      // process the task (should this be in a separate thread?)
-      if (task)
-        {
-        task->Execute();
-        task = 0;
-        }
+      // Sleep until a task is scheduled or the threads are terminated.
+      // The lock is released while waiting.
+      queue.TaskAvailable->Wait(&queues->Lock);
+      continue;
       }
 
-    // busy wait
-    itksys::SystemTools::Delay(100);
+    // pull a task off the queue
+    ProcessingTaskQueue::ScheduledTask scheduledTask = queue.Tasks.top();
+    queue.Tasks.pop();
+    double startTime = itksys::SystemTools::GetTime();
+    double waitTime = startTime - scheduledTask.ScheduledTime;
+    queue.TaskStatistics.TotalWaitTime += waitTime;
+    queue.TaskStatistics.MaximumWaitTime =
+      std::max(queue.TaskStatistics.MaximumWaitTime, waitTime);
+    ++queue.NumberOfRunningTasks;
+    queues->Lock.Unlock();
+
+    scheduledTask.Task->Execute();
+    double runTime = itksys::SystemTools::GetTime() - startTime;
+    scheduledTask.Task = 0;
+
+    queues->Lock.Lock();
+    --queue.NumberOfRunningTasks;
+    ++queue.TaskStatistics.Completed;
+    queue.TaskStatistics.TotalRunTime += runTime;
+    queue.TaskStatistics.MaximumRunTime =
+      std::max(queue.TaskStatistics.MaximumRunTime, runTime);
     }
+  queues->Lock.Unlock();
 }
 
 //----------------------------------------------------------------------------
 int vtkSlicerApplicationLogic::ScheduleTask( vtkSlicerTask *task )
 {
-  // only schedule a task if the processing task is up
-  this->ProcessingThreadActiveLock->Lock();
-  int active = this->ProcessingThreadActive;
-  this->ProcessingThreadActiveLock->Unlock();
-  if (!active)
+  if (!task)
     {
     return false;
     }
 
-  this->ProcessingTaskQueueLock->Lock();
-  (*this->InternalTaskQueue).push( task );
-  this->ProcessingTaskQueueLock->Unlock();
+  ProcessingTaskQueue* queues = this->InternalTaskQueue;
+  queues->Lock.Lock();
+  // only schedule a task if the processing threads are up
+  if (!queues->Active)
+    {
+    queues->Lock.Unlock();
+    return false;
+    }
+
+  ProcessingTaskQueue::TaskQueue& queue = queues->GetQueue(task->GetType());
+  ProcessingTaskQueue::ScheduledTask scheduledTask;
+  scheduledTask.Task = task;
+  scheduledTask.Priority = task->GetPriority();
+  scheduledTask.Sequence = queues->Sequence++;
+  scheduledTask.ScheduledTime = itksys::SystemTools::GetTime();
+  queue.Tasks.push(scheduledTask);
+  queue.TaskStatistics.MaximumQueueSize = std::max(
+    queue.TaskStatistics.MaximumQueueSize, static_cast<int>(queue.Tasks.size()));
+
+  // wake up one idle thread
+  queue.TaskAvailable->Signal();
+  queues->Lock.Unlock();
   return true;
 }
 
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfQueuedTasks(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  int size = static_cast<int>(this->InternalTaskQueue->GetQueue(taskType).Tasks.size());
+  this->InternalTaskQueue->Lock.Unlock();
+  return size;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfRunningTasks(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  int running = this->InternalTaskQueue->GetQueue(taskType).NumberOfRunningTasks;
+  this->InternalTaskQueue->Lock.Unlock();
+  return running;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetNumberOfCompletedTasks(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  int completed = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics.Completed;
+  this->InternalTaskQueue->Lock.Unlock();
+  return completed;
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerApplicationLogic::GetMaximumTaskQueueSize(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  int size = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics.MaximumQueueSize;
+  this->InternalTaskQueue->Lock.Unlock();
+  return size;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerApplicationLogic::GetAverageTaskWaitTime(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  const ProcessingTaskQueue::Statistics& statistics = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics;
+  double average = statistics.Completed > 0 ?
+    statistics.TotalWaitTime / statistics.Completed : 0.;
+  this->InternalTaskQueue->Lock.Unlock();
+  return average;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerApplicationLogic::GetMaximumTaskWaitTime(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  double maximum = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics.MaximumWaitTime;
+  this->InternalTaskQueue->Lock.Unlock();
+  return maximum;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerApplicationLogic::GetAverageTaskRunTime(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  const ProcessingTaskQueue::Statistics& statistics = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics;
+  double average = statistics.Completed > 0 ?
+    statistics.TotalRunTime / statistics.Completed : 0.;
+  this->InternalTaskQueue->Lock.Unlock();
+  return average;
+}
+
+//----------------------------------------------------------------------------
+double vtkSlicerApplicationLogic::GetMaximumTaskRunTime(int taskType)
+{
+  this->InternalTaskQueue->Lock.Lock();
+  double maximum = this->InternalTaskQueue->GetQueue(taskType).TaskStatistics.MaximumRunTime;
+  this->InternalTaskQueue->Lock.Unlock();
+  return maximum;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerApplicationLogic::ResetTaskStatistics()
+{
+  this->InternalTaskQueue->Lock.Lock();
+  this->InternalTaskQueue->ProcessingQueue.TaskStatistics.Reset();
+  this->InternalTaskQueue->NetworkingQueue.TaskStatistics.Reset();
+  this->InternalTaskQueue->Lock.Unlock();
+}
+
 //----------------------------------------------------------------------------
 vtkMTimeType vtkSlicerApplicationLogic::RequestModified(vtkObject *obj)
 {
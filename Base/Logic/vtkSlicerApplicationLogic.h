@@ -69,11 +69,26 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
   /// (display it in the Fiducials GUI)
   void PropagateFiducialListSelection();
 
-  /// Create a thread for processing
+  /// Create the threads for processing and networking tasks.
+  /// \sa SetNumberOfProcessingThreads(), SetNumberOfNetworkingThreads()
   void CreateProcessingThread();
 
-  /// Shutdown the processing thread
+  /// Shutdown the processing and networking threads.
+  /// Tasks that are still queued are discarded.
   void TerminateProcessingThread();
+
+  /// Number of threads executing vtkSlicerTask::Processing tasks.
+  /// Must be set before calling CreateProcessingThread(). Default is 1.
+  vtkSetClampMacro(NumberOfProcessingThreads, int, 1, 64);
+  vtkGetMacro(NumberOfProcessingThreads, int);
+
+  /// Number of threads executing vtkSlicerTask::Networking tasks.
+  /// Must be set before calling CreateProcessingThread(). Default is 1.
+  /// \note curl is not thread safe by default, only increase this
+  /// value if the networking tasks do not share a curl handle.
+  vtkSetClampMacro(NumberOfNetworkingThreads, int, 1, 64);
+  vtkGetMacro(NumberOfNetworkingThreads, int);
+
   /// List of events potentially fired by the application logic
   enum RequestEvents
     {
@@ -90,8 +105,41 @@ class VTK_SLICER_BASE_LOGIC_EXPORT vtkSlicerApplicationLogic
   /// Schedule a task to run in the processing thread. Returns true if
   /// task was successfully scheduled. ScheduleTask() is called from the
   /// main thread to run something in the processing thread.
+  /// Tasks are dispatched to a queue per task type (see vtkSlicerTask::GetType()),
+  /// so a long processing task never delays a networking task. Within a queue,
+  /// tasks are ordered by vtkSlicerTask::GetPriority(). Idle worker threads
+  /// are woken up as soon as a task is scheduled.
+  /// Tasks of type vtkSlicerTask::Undefined are run as processing tasks.
   int ScheduleTask( vtkSlicerTask* );
 
+  /// Return the number of tasks of type \a taskType waiting to be executed.
+  /// \sa vtkSlicerTask::Processing, vtkSlicerTask::Networking
+  int GetNumberOfQueuedTasks(int taskType);
+
+  /// Return the number of tasks of type \a taskType currently executed.
+  int GetNumberOfRunningTasks(int taskType);
+
+  /// Return the number of tasks of type \a taskType executed since the last
+  /// call to ResetTaskStatistics().
+  int GetNumberOfCompletedTasks(int taskType);
+
+  /// Return the largest number of queued tasks of type \a taskType observed
+  /// since the last call to ResetTaskStatistics().
+  int GetMaximumTaskQueueSize(int taskType);
+
+  /// Return the average and maximum time (in seconds) tasks of type
+  /// \a taskType spent in the queue before being executed.
+  double GetAverageTaskWaitTime(int taskType);
+  double GetMaximumTaskWaitTime(int taskType);
+
+  /// Return the average and maximum time (in seconds) spent executing tasks
+  /// of type \a taskType.
+  double GetAverageTaskRunTime(int taskType);
+  double GetMaximumTaskRunTime(int taskType);
+
+  /// Reset the statistics collected for all task types.
+  void ResetTaskStatistics();
+
   /// Request a Modified call on an object.  This method allows a
   /// processing thread to request a Modified call on an object to be
   /// performed in the main thread.  This allows the call to Modified
@@ -217,12 +265,16 @@ protected:
   /// Callback used by a MultiThreader to start a networking thread
   static ITK_THREAD_RETURN_TYPE NetworkingThreaderCallback( void * );
 
-  /// Task processing loop that is run in the processing thread
+  /// Task processing loop that is run in the processing threads
   void ProcessProcessingTasks();
 
-  /// Networking Task processing loop that is run in a networking thread
+  /// Networking Task processing loop that is run in the networking threads
   void ProcessNetworkingTasks();
 
+  /// Wait for tasks of type \a taskType and execute them until the
+  /// processing threads are terminated.
+  void ProcessTasks(int taskType);
+
   /// Process a request to read data into a scene.  This method is
   /// called by ProcessReadData() in the application main thread
   /// because calls to load data will cause a Modified() on a node
@@ -235,8 +287,6 @@ private:
   void operator=(const vtkSlicerApplicationLogic&);
 
   itk::MultiThreader::Pointer ProcessingThreader;
-  itk::MutexLock::Pointer ProcessingThreadActiveLock;
-  itk::MutexLock::Pointer ProcessingTaskQueueLock;
   itk::MutexLock::Pointer ModifiedQueueActiveLock;
   itk::MutexLock::Pointer ModifiedQueueLock;
   itk::MutexLock::Pointer ReadDataQueueActiveLock;
@@ -244,9 +294,10 @@ private:
   itk::MutexLock::Pointer WriteDataQueueActiveLock;
   itk::MutexLock::Pointer WriteDataQueueLock;
   vtkTimeStamp RequestTimeStamp;
-  int ProcessingThreadId;
+  std::vector<int> ProcessingThreadIDs;
   std::vector<int> NetworkingThreadIDs;
-  int ProcessingThreadActive;
+  int NumberOfProcessingThreads;
+  int NumberOfNetworkingThreads;
   int ModifiedQueueActive;
   int ReadDataQueueActive;
   int WriteDataQueueActive;
@@ -11,7 +11,9 @@ vtkSlicerTask::vtkSlicerTask()
 {
   this->TaskObject = 0;
   this->TaskFunction = 0;
+  this->TaskClientData = 0;
   this->Type = vtkSlicerTask::Undefined;
+  this->Priority = 0;
 }
 //----------------------------------------------------------------------------
 vtkSlicerTask::~vtkSlicerTask()
@@ -41,4 +43,7 @@ void vtkSlicerTask::Execute()
 void vtkSlicerTask::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os, indent);
+
+  os << indent << "Type: " << this->GetTypeAsString() << "\n";
+  os << indent << "Priority: " << this->Priority << "\n";
 }
@@ -38,6 +38,13 @@ public:
   void SetTypeToProcessing() {this->SetType(vtkSlicerTask::Processing);};
   void SetTypeToNetworking() {this->SetType(vtkSlicerTask::Networking);};
 
+  /// Priority of the task within the queue of its type.
+  /// Tasks with a higher priority are executed first, tasks with the same
+  /// priority are executed in the order they were scheduled.
+  /// Default is 0.
+  vtkSetMacro(Priority, int);
+  vtkGetMacro(Priority, int);
+
   const char* GetTypeAsString( ) {
     switch (this->Type)
       {
@@ -60,6 +67,7 @@ private:
   void *TaskClientData;
 
   int Type;
+  int Priority;
 
 };
 #endif
@@ -0,0 +1,119 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Qt includes
+#include <QFile>
+#include <QSettings>
+#include <QTemporaryDir>
+
+// SlicerQt includes
+#include "qSlicerCLIModuleFactoryHelper.h"
+
+// STD includes
+#include <iostream>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+bool WriteFile(const QString& filePath, const QByteArray& content)
+{
+  QFile file(filePath);
+  if (!file.open(QIODevice::WriteOnly))
+    {
+    return false;
+    }
+  file.write(content);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int NumberOfCachedDescriptions()
+{
+  QSettings cache(qSlicerCLIModuleFactoryHelper::descriptionCacheFilePath(), QSettings::IniFormat);
+  return cache.childGroups().count();
+}
+
+} // end anonymous namespace
+
+//-----------------------------------------------------------------------------
+int qSlicerCLIModuleFactoryHelperTest1(int, char * [])
+{
+  QTemporaryDir temporaryDir;
+  if (!temporaryDir.isValid())
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to create temporary directory" << std::endl;
+    return EXIT_FAILURE;
+    }
+  qSlicerCLIModuleFactoryHelper::setDescriptionCacheFilePath(
+    temporaryDir.path() + "/CLIModuleDescriptionCache.ini");
+
+  QString cliPath = temporaryDir.path() + "/FakeCLI";
+  QString xmlDescription("<executable><title>Fake</title></executable>");
+  if (!WriteFile(cliPath, "v1"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to write " << qPrintable(cliPath) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Cache miss then hit
+  if (!qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(cliPath).isEmpty())
+    {
+    std::cerr << "Line " << __LINE__ << " - Unexpected cached description" << std::endl;
+    return EXIT_FAILURE;
+    }
+  qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(cliPath, xmlDescription);
+  if (qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(cliPath) != xmlDescription)
+    {
+    std::cerr << "Line " << __LINE__ << " - Description not cached" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A modified CLI invalidates and evicts its description
+  if (!WriteFile(cliPath, "version 2"))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to write " << qPrintable(cliPath) << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(cliPath).isEmpty()
+    || NumberOfCachedDescriptions() != 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Stale description not evicted" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A removed CLI is pruned from the cache
+  qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(cliPath, xmlDescription);
+  QString otherCliPath = temporaryDir.path() + "/OtherFakeCLI";
+  WriteFile(otherCliPath, "other");
+  qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(otherCliPath, xmlDescription);
+  qSlicerCLIModuleFactoryHelper::pruneDescriptionCache();
+  if (NumberOfCachedDescriptions() != 2)
+    {
+    std::cerr << "Line " << __LINE__ << " - Valid descriptions pruned" << std::endl;
+    return EXIT_FAILURE;
+    }
+  QFile::remove(cliPath);
+  qSlicerCLIModuleFactoryHelper::pruneDescriptionCache();
+  if (NumberOfCachedDescriptions() != 1
+    || qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(otherCliPath) != xmlDescription)
+    {
+    std::cerr << "Line " << __LINE__ << " - Description of removed CLI not pruned" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  qSlicerCLIModuleFactoryHelper::setDescriptionCacheFilePath(QString());
+  return EXIT_SUCCESS;
+}
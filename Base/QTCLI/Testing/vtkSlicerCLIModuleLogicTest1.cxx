@@ -0,0 +1,223 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// ModuleDescriptionParser includes
+#include <ModuleDescription.h>
+#include <ModuleDescriptionParser.h>
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+#include <vtkMRMLStorageNode.h>
+
+// MRMLCLI includes
+#include <vtkMRMLCommandLineModuleNode.h>
+#include <vtkSlicerCLIModuleLogic.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// VTKsys includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//-----------------------------------------------------------------------------
+const char* SharedMemoryTestModuleDescription =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<executable>\n"
+  "  <title>Shared memory test</title>\n"
+  "  <parameters>\n"
+  "    <image>\n"
+  "      <name>InputVolume</name>\n"
+  "      <longflag>inputVolume</longflag>\n"
+  "      <channel>input</channel>\n"
+  "    </image>\n"
+  "    <image>\n"
+  "      <name>OutputVolume</name>\n"
+  "      <longflag>outputVolume</longflag>\n"
+  "      <channel>output</channel>\n"
+  "    </image>\n"
+  "  </parameters>\n"
+  "</executable>\n";
+
+//-----------------------------------------------------------------------------
+// Expose the file name construction of the logic
+class vtkSlicerCLIModuleLogicTestHelper : public vtkSlicerCLIModuleLogic
+{
+public:
+  static vtkSlicerCLIModuleLogicTestHelper* New();
+  vtkTypeMacro(vtkSlicerCLIModuleLogicTestHelper, vtkSlicerCLIModuleLogic);
+
+  std::string GetImageFileName(const char* nodeID, bool useSharedMemory)
+    {
+    return this->ConstructTemporaryFileName("image", "scalar", nodeID,
+      std::vector<std::string>(1, ".nrrd"), CommandLineModule, useSharedMemory);
+    }
+  bool CanUseSharedMemory(vtkMRMLCommandLineModuleNode* node)
+    {
+    return this->CanUseSharedMemoryTransfer(node);
+    }
+};
+vtkStandardNewMacro(vtkSlicerCLIModuleLogicTestHelper);
+
+//-----------------------------------------------------------------------------
+bool StartsWith(const std::string& fileName, const std::string& directory)
+{
+  return fileName.compare(0, directory.size() + 1, directory + "/") == 0;
+}
+
+} // end of anonymous namespace
+
+//-----------------------------------------------------------------------------
+int vtkSlicerCLIModuleLogicTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [])
+{
+  ModuleDescription description;
+  ModuleDescriptionParser parser;
+  if (parser.Parse(SharedMemoryTestModuleDescription, description) != 0)
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to parse module description" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerCLIModuleLogicTestHelper> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(16, 16, 16);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  short* voxels = static_cast<short*>(imageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < imageData->GetNumberOfPoints(); ++i)
+    {
+    voxels[i] = static_cast<short>(i % 1000 - 500);
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(volumeNode.GetPointer());
+
+  vtkNew<vtkMRMLCommandLineModuleNode> cliNode;
+  cliNode->SetModuleDescription(description);
+  cliNode->SetParameterAsString("InputVolume", volumeNode->GetID());
+  scene->AddNode(cliNode.GetPointer());
+
+  // Shared memory directory with enough space: the images are exchanged there
+  std::string sharedMemoryDirectory =
+    vtksys::SystemTools::GetCurrentWorkingDirectory() + "/vtkSlicerCLIModuleLogicTest1-shm";
+  vtksys::SystemTools::MakeDirectory(sharedMemoryDirectory.c_str());
+  logic->SetSharedMemoryDirectory(sharedMemoryDirectory.c_str());
+  if (!logic->CanUseSharedMemory(cliNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Shared memory transfer refused in "
+              << sharedMemoryDirectory << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string fileName = logic->GetImageFileName(volumeNode->GetID(), true);
+  if (!StartsWith(fileName, sharedMemoryDirectory)
+    || vtksys::SystemTools::GetFilenameLastExtension(fileName) != ".nrrd")
+    {
+    std::cerr << "Line " << __LINE__ << " - Unexpected shared memory file name: "
+              << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Exchange the volume through the shared memory file the way the logic
+  // does for executable modules and check that the voxels come back intact
+  vtkSmartPointer<vtkMRMLStorageNode> writer;
+  writer.TakeReference(volumeNode->CreateDefaultStorageNode());
+  writer->ConfigureForDataExchange();
+  writer->SetScene(scene.GetPointer());
+  writer->SetFileName(fileName.c_str());
+  if (!writer->WriteData(volumeNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to write " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  // Data exchange files are not compressed: the module reads the voxels as is
+  unsigned long voxelsSize = 16 * 16 * 16 * sizeof(short);
+  if (vtksys::SystemTools::FileLength(fileName) < voxelsSize)
+    {
+    std::cerr << "Line " << __LINE__ << " - Shared memory file " << fileName
+              << " is smaller than the voxels: "
+              << vtksys::SystemTools::FileLength(fileName) << " < " << voxelsSize << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> outputVolumeNode;
+  scene->AddNode(outputVolumeNode.GetPointer());
+  vtkSmartPointer<vtkMRMLStorageNode> reader;
+  reader.TakeReference(outputVolumeNode->CreateDefaultStorageNode());
+  reader->SetScene(scene.GetPointer());
+  reader->SetFileName(fileName.c_str());
+  if (!reader->ReadData(outputVolumeNode.GetPointer())
+    || !outputVolumeNode->GetImageData())
+    {
+    std::cerr << "Line " << __LINE__ << " - Failed to read " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkImageData* outputImageData = outputVolumeNode->GetImageData();
+  int* outputDimensions = outputImageData->GetDimensions();
+  if (outputDimensions[0] != 16 || outputDimensions[1] != 16 || outputDimensions[2] != 16
+    || outputImageData->GetScalarType() != VTK_SHORT)
+    {
+    std::cerr << "Line " << __LINE__ << " - Unexpected image read from " << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+  short* outputVoxels = static_cast<short*>(outputImageData->GetScalarPointer());
+  for (vtkIdType i = 0; i < outputImageData->GetNumberOfPoints(); ++i)
+    {
+    if (outputVoxels[i] != voxels[i])
+      {
+      std::cerr << "Line " << __LINE__ << " - Voxel " << i << " differs: "
+                << outputVoxels[i] << " != " << voxels[i] << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  vtksys::SystemTools::RemoveFile(fileName.c_str());
+  vtksys::SystemTools::RemoveADirectory(sharedMemoryDirectory.c_str());
+
+  // Missing shared memory directory: fall back to the temporary directory
+  logic->SetSharedMemoryDirectory(sharedMemoryDirectory.c_str());
+  if (logic->CanUseSharedMemory(cliNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Shared memory transfer accepted in missing directory "
+              << sharedMemoryDirectory << std::endl;
+    return EXIT_FAILURE;
+    }
+  logic->SetSharedMemoryDirectory("");
+  if (logic->CanUseSharedMemory(cliNode.GetPointer()))
+    {
+    std::cerr << "Line " << __LINE__ << " - Shared memory transfer accepted without directory" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // without application logic the temporary directory is the current directory
+  fileName = logic->GetImageFileName(volumeNode->GetID(), false);
+  if (!StartsWith(fileName, ".")
+    || vtksys::SystemTools::GetFilenameLastExtension(fileName) != ".nrrd")
+    {
+    std::cerr << "Line " << __LINE__ << " - Unexpected temporary file name: "
+              << fileName << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -19,6 +19,7 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QElapsedTimer>
 #include <QProcess>
 
 // SlicerQt includes
@@ -52,6 +53,8 @@ qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactoryItem::instanciator()
 {
   // Using a scoped pointer ensures the memory will be cleaned if instantiator
   // fails before returning the module. See QScopedPointer::take()
+  QElapsedTimer timer;
+  timer.start();
   QScopedPointer<qSlicerCLIModule> module(new qSlicerCLIModule());
   module->setModuleType("CommandLineModule");
   module->setEntryPoint(this->path());
@@ -60,7 +63,8 @@ qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactoryItem::instanciator()
 
   //
   // If the xml file exists, read it and associate it with the module
-  // description. If not, run the CLI executable with "--xml".
+  // description. If not, use the description cached the last time the
+  // executable was run with "--xml", or run it if it has changed since.
   //
   QString xmlDescription;
   if (QFile::exists(xmlFilePath))
@@ -78,8 +82,19 @@ qSlicerAbstractCoreModule* qSlicerCLIExecutableModuleFactoryItem::instanciator()
     }
   else
     {
-    xmlDescription = this->runCLIWithXmlArgument();
+    xmlDescription =
+      qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(this->path());
+    if (xmlDescription.isEmpty())
+      {
+      xmlDescription = this->runCLIWithXmlArgument();
+      if (!xmlDescription.isEmpty())
+        {
+        qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(
+          this->path(), xmlDescription);
+        }
+      }
     }
+  qSlicerCLIModuleFactoryHelper::addDiscoveryTime(this->path(), timer.elapsed());
   if (xmlDescription.isEmpty())
     {
     return 0;
@@ -223,6 +238,7 @@ qSlicerCLIExecutableModuleFactory::~qSlicerCLIExecutableModuleFactory()
 //-----------------------------------------------------------------------------
 void qSlicerCLIExecutableModuleFactory::registerItems()
 {
+  qSlicerCLIModuleFactoryHelper::pruneDescriptionCache();
   QStringList modulePaths = qSlicerCLIModuleFactoryHelper::modulePaths();
   this->registerAllFileItems(modulePaths);
 }
@@ -19,6 +19,7 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QElapsedTimer>
 
 // SlicerQT includes
 #include "qSlicerCLILoadableModuleFactory.h"
@@ -38,16 +39,24 @@ qSlicerCLILoadableModuleFactoryItem::qSlicerCLILoadableModuleFactoryItem(
 //-----------------------------------------------------------------------------
 bool qSlicerCLILoadableModuleFactoryItem::load()
 {
-  // If XML description file exists, skip loading. It will be
-  // lazily done by calling ModuleDescription::GetTarget() method.
-  if (!QFile::exists(this->xmlModuleDescriptionFilePath()))
+  // If XML description file exists or if the description is cached, skip
+  // loading. It will be lazily done by calling ModuleDescription::GetTarget()
+  // method.
+  if (QFile::exists(this->xmlModuleDescriptionFilePath()))
     {
-    return this->Superclass::load();
+    return true;
     }
-  else
+  this->CachedXmlDescription =
+    qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(this->path());
+  if (!this->CachedXmlDescription.isEmpty())
     {
     return true;
     }
+  QElapsedTimer timer;
+  timer.start();
+  bool res = this->Superclass::load();
+  qSlicerCLIModuleFactoryHelper::addDiscoveryTime(this->path(), timer.elapsed());
+  return res;
 }
 
 //-----------------------------------------------------------------------------
@@ -86,14 +95,17 @@ qSlicerAbstractCoreModule* qSlicerCLILoadableModuleFactoryItem::instanciator()
 {
   // Using a scoped pointer ensures the memory will be cleaned if instantiator
   // fails before returning the module. See QScopedPointer::take()
+  QElapsedTimer timer;
+  timer.start();
   QScopedPointer<qSlicerCLIModule> module(new qSlicerCLIModule());
 
   QString xmlFilePath = this->xmlModuleDescriptionFilePath();
 
   //
-  // If the xml file exists, read it and associate it with the module
-  // description. The "ModuleEntryPoint" address will be lazily retrieved
-  // after calling ModuleDescription::GetTarget() method.
+  // If the xml file exists or if the description is cached, read it and
+  // associate it with the module description. The "ModuleEntryPoint" address
+  // will be lazily retrieved after calling ModuleDescription::GetTarget()
+  // method.
   //
   // If not, directly resolve the symbols "XMLModuleDescription" and
   // "ModuleEntryPoint" from the loaded library.
@@ -116,6 +128,13 @@ qSlicerAbstractCoreModule* qSlicerCLILoadableModuleFactoryItem::instanciator()
     module->moduleDescription().SetTargetCallback(
           this, qSlicerCLILoadableModuleFactoryItem::loadLibraryAndResolveSymbols);
     }
+  else if (!this->CachedXmlDescription.isEmpty())
+    {
+    xmlDescription = this->CachedXmlDescription;
+    // Set callback to allow lazy loading of target symbols.
+    module->moduleDescription().SetTargetCallback(
+          this, qSlicerCLILoadableModuleFactoryItem::loadLibraryAndResolveSymbols);
+    }
   else
     {
     // Library is expected to already be loaded
@@ -125,7 +144,13 @@ qSlicerAbstractCoreModule* qSlicerCLILoadableModuleFactoryItem::instanciator()
       {
       return 0;
       }
+    if (!xmlDescription.isEmpty())
+      {
+      qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(
+        this->path(), xmlDescription);
+      }
     }
+  qSlicerCLIModuleFactoryHelper::addDiscoveryTime(this->path(), timer.elapsed());
   if (xmlDescription.isEmpty())
     {
     return 0;
@@ -307,6 +332,7 @@ qSlicerCLILoadableModuleFactory::~qSlicerCLILoadableModuleFactory()
 //-----------------------------------------------------------------------------
 void qSlicerCLILoadableModuleFactory::registerItems()
 {
+  qSlicerCLIModuleFactoryHelper::pruneDescriptionCache();
   QStringList modulePaths = qSlicerCLIModuleFactoryHelper::modulePaths();
   this->registerAllFileItems(modulePaths);
 }
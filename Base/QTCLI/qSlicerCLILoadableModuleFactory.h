@@ -56,6 +56,9 @@ protected:
   static bool updateLogo(qSlicerCLILoadableModuleFactoryItem* item, ModuleLogo& logo);
 private:
   QString TempDirectory;
+  /// Description found in the description cache by load(), the library
+  /// is then lazily loaded.
+  QString CachedXmlDescription;
 };
 
 class qSlicerCLILoadableModuleFactoryPrivate;
@@ -19,6 +19,10 @@
 ==============================================================================*/
 
 // Qt includes
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
 #include <QSettings>
 
 // QtCLI includes
@@ -28,6 +32,32 @@
 #include "qSlicerCoreApplication.h" // For: Slicer_CLIMODULES_LIB_DIR
 #include "qSlicerUtils.h"
 
+namespace
+{
+
+//-----------------------------------------------------------------------------
+QHash<QString, qint64>& DiscoveryTimes()
+{
+  static QHash<QString, qint64> discoveryTimes;
+  return discoveryTimes;
+}
+
+//-----------------------------------------------------------------------------
+QString& DescriptionCacheFilePath()
+{
+  static QString descriptionCacheFilePath;
+  return descriptionCacheFilePath;
+}
+
+//-----------------------------------------------------------------------------
+QString DescriptionCacheKey(const QString& path)
+{
+  return QString(QCryptographicHash::hash(
+    QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+} // end of anonymous namespace
+
 //-----------------------------------------------------------------------------
 const QStringList qSlicerCLIModuleFactoryHelper::modulePaths()
 {
@@ -73,3 +103,101 @@ bool qSlicerCLIModuleFactoryHelper::isBuiltIn(const QString& path)
   qSlicerCoreApplication * app = qSlicerCoreApplication::application();
   return app ? qSlicerUtils::isPluginBuiltIn(path, app->slicerHome()) : true;
 }
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIModuleFactoryHelper::descriptionCacheFilePath()
+{
+  if (!DescriptionCacheFilePath().isEmpty())
+    {
+    return DescriptionCacheFilePath();
+    }
+  qSlicerCoreApplication * app = qSlicerCoreApplication::application();
+  if (!app)
+    {
+    return QString();
+    }
+  QFileInfo settingsFileInfo(app->slicerRevisionUserSettingsFilePath());
+  return settingsFileInfo.dir().filePath("CLIModuleDescriptionCache.ini");
+}
+
+//-----------------------------------------------------------------------------
+QString qSlicerCLIModuleFactoryHelper::cachedXmlModuleDescription(const QString& path)
+{
+  QString cacheFilePath = qSlicerCLIModuleFactoryHelper::descriptionCacheFilePath();
+  if (cacheFilePath.isEmpty() || !QFile::exists(cacheFilePath))
+    {
+    return QString();
+    }
+  QSettings cache(cacheFilePath, QSettings::IniFormat);
+  QString key = DescriptionCacheKey(path);
+  if (!cache.childGroups().contains(key))
+    {
+    return QString();
+    }
+  cache.beginGroup(key);
+  QFileInfo fileInfo(path);
+  if (cache.value("Path").toString() != fileInfo.absoluteFilePath()
+      || cache.value("Size").toLongLong() != fileInfo.size()
+      || cache.value("LastModified").toDateTime() != fileInfo.lastModified())
+    {
+    // The CLI has been modified, its description is stale
+    cache.endGroup();
+    cache.remove(key);
+    return QString();
+    }
+  return cache.value("XmlDescription").toString();
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIModuleFactoryHelper::setDescriptionCacheFilePath(const QString& filePath)
+{
+  DescriptionCacheFilePath() = filePath;
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIModuleFactoryHelper::pruneDescriptionCache()
+{
+  QString cacheFilePath = qSlicerCLIModuleFactoryHelper::descriptionCacheFilePath();
+  if (cacheFilePath.isEmpty() || !QFile::exists(cacheFilePath))
+    {
+    return;
+    }
+  QSettings cache(cacheFilePath, QSettings::IniFormat);
+  foreach(const QString& key, cache.childGroups())
+    {
+    if (!QFile::exists(cache.value(key + "/Path").toString()))
+      {
+      cache.remove(key);
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIModuleFactoryHelper::setCachedXmlModuleDescription(
+  const QString& path, const QString& xmlDescription)
+{
+  QString cacheFilePath = qSlicerCLIModuleFactoryHelper::descriptionCacheFilePath();
+  if (cacheFilePath.isEmpty())
+    {
+    return;
+    }
+  QSettings cache(cacheFilePath, QSettings::IniFormat);
+  cache.beginGroup(DescriptionCacheKey(path));
+  QFileInfo fileInfo(path);
+  cache.setValue("Path", fileInfo.absoluteFilePath());
+  cache.setValue("Size", fileInfo.size());
+  cache.setValue("LastModified", fileInfo.lastModified());
+  cache.setValue("XmlDescription", xmlDescription);
+}
+
+//-----------------------------------------------------------------------------
+void qSlicerCLIModuleFactoryHelper::addDiscoveryTime(const QString& path, qint64 msecs)
+{
+  DiscoveryTimes()[path] += msecs;
+}
+
+//-----------------------------------------------------------------------------
+QHash<QString, qint64> qSlicerCLIModuleFactoryHelper::discoveryTimes()
+{
+  return DiscoveryTimes();
+}
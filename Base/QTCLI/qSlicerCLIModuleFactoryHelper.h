@@ -22,6 +22,7 @@
 #define __qSlicerCLIModuleFactoryHelper_h
 
 /// QT includes
+#include <QHash>
 #include <QStringList>
 
 #include "qSlicerBaseQTCLIExport.h"
@@ -40,6 +41,39 @@ public:
   /// Convenient method returning True if the given CLI path corresponds to a built-in module
   static bool isBuiltIn(const QString& path);
 
+  /// Return the XML description of the CLI \a path saved in the description
+  /// cache, or an empty string if the CLI is not in the cache or if its file
+  /// has been modified (different size or modification time) since then.
+  /// \sa setCachedXmlModuleDescription(), descriptionCacheFilePath()
+  static QString cachedXmlModuleDescription(const QString& path);
+
+  /// Save the XML description of the CLI \a path in the description cache,
+  /// the next time the application starts the CLI doesn't have to be run or
+  /// loaded to retrieve its description.
+  static void setCachedXmlModuleDescription(const QString& path, const QString& xmlDescription);
+
+  /// Return the path of the file storing the cached CLI descriptions.
+  /// It is located next to the revision specific user settings unless it
+  /// has been set with setDescriptionCacheFilePath().
+  static QString descriptionCacheFilePath();
+
+  /// Set the path of the file storing the cached CLI descriptions.
+  /// An empty path restores the default location.
+  static void setDescriptionCacheFilePath(const QString& filePath);
+
+  /// Remove from the description cache the CLIs whose file doesn't exist
+  /// anymore. Descriptions of modified CLIs are removed when looked up.
+  /// \sa cachedXmlModuleDescription()
+  static void pruneDescriptionCache();
+
+  /// Add \a msecs to the time spent loading the CLI \a path and retrieving
+  /// its description.
+  static void addDiscoveryTime(const QString& path, qint64 msecs);
+
+  /// Return the time in milliseconds spent loading each CLI and retrieving
+  /// its description, indexed by CLI path.
+  static QHash<QString, qint64> discoveryTimes();
+
 private:
   /// Not implemented
   qSlicerCLIModuleFactoryHelper(){}
@@ -30,9 +30,11 @@
 #include <vtkMRMLStorageNode.h>
 #include <vtkMRMLModelStorageNode.h>
 #include <vtkMRMLTransformNode.h>
+#include <vtkMRMLVolumeNode.h>
 
 // VTK includes
 #include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
 #include <vtkIntArray.h>
 #include <vtkMultiThreader.h>
 #include <vtkNew.h>
@@ -59,7 +61,9 @@
 #include <set>
 
 #ifdef _WIN32
+#include <windows.h>
 #else
+#include <sys/statvfs.h>
 #include <sys/types.h>
 #include <unistd.h>
 #endif
@@ -78,6 +82,28 @@ struct DigitsToCharacters
     }
 };
 
+//----------------------------------------------------------------------------
+// Return the number of bytes available in the file system of a directory,
+// 0 if it can't be determined.
+static vtkTypeUInt64 GetAvailableDiskSpace(const std::string& directory)
+{
+#ifdef _WIN32
+  ULARGE_INTEGER freeBytes;
+  if (!GetDiskFreeSpaceExA(directory.c_str(), &freeBytes, NULL, NULL))
+    {
+    return 0;
+    }
+  return static_cast<vtkTypeUInt64>(freeBytes.QuadPart);
+#else
+  struct statvfs stats;
+  if (statvfs(directory.c_str(), &stats) != 0)
+    {
+    return 0;
+    }
+  return static_cast<vtkTypeUInt64>(stats.f_bavail) * stats.f_frsize;
+#endif
+}
+
 typedef std::pair<vtkSlicerCLIModuleLogic *, vtkMRMLCommandLineModuleNode *> LogicNodePair;
 class MRMLIDMap : public std::map<std::string, std::string> {};
 
@@ -198,6 +224,8 @@ public:
   ModuleDescription DefaultModuleDescription;
   int DeleteTemporaryFiles;
   int AllowInMemoryTransfer;
+  int AllowSharedMemoryTransfer;
+  std::string SharedMemoryDirectory;
 
   int RedirectModuleStreams;
 
@@ -300,6 +328,13 @@ vtkSlicerCLIModuleLogic::vtkSlicerCLIModuleLogic()
   this->Internal->ProcessesKillLock = itk::MutexLock::New();
   this->Internal->DeleteTemporaryFiles = 1;
   this->Internal->AllowInMemoryTransfer = 1;
+  this->Internal->AllowSharedMemoryTransfer = 0;
+#ifndef _WIN32
+  if (vtksys::SystemTools::FileIsDirectory("/dev/shm"))
+    {
+    this->Internal->SharedMemoryDirectory = "/dev/shm";
+    }
+#endif
   this->Internal->RedirectModuleStreams = 1;
   this->Internal->RescheduleCallback =
     vtkSmartPointer<vtkSlicerCLIRescheduleCallback>::New();
@@ -403,6 +438,34 @@ int vtkSlicerCLIModuleLogic::GetAllowInMemoryTransfer() const
   return this->Internal->AllowInMemoryTransfer;
 }
 
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SetAllowSharedMemoryTransfer(int value)
+{
+  vtkDebugMacro(<< this->GetClassName() << " (" << this << "): setting AllowSharedMemoryTransfer to " << value);
+  if (this->Internal->AllowSharedMemoryTransfer != value)
+    {
+    this->Internal->AllowSharedMemoryTransfer = value;
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkSlicerCLIModuleLogic::GetAllowSharedMemoryTransfer() const
+{
+  return this->Internal->AllowSharedMemoryTransfer;
+}
+
+//----------------------------------------------------------------------------
+void vtkSlicerCLIModuleLogic::SetSharedMemoryDirectory(const char* directory)
+{
+  this->Internal->SharedMemoryDirectory = directory ? directory : "";
+}
+
+//----------------------------------------------------------------------------
+const char* vtkSlicerCLIModuleLogic::GetSharedMemoryDirectory() const
+{
+  return this->Internal->SharedMemoryDirectory.c_str();
+}
+
 //----------------------------------------------------------------------------
 void vtkSlicerCLIModuleLogic::RedirectModuleStreamsOn()
 {
@@ -479,6 +542,65 @@ vtkSlicerCLIModuleLogic
   return fname;
 }
 
+//----------------------------------------------------------------------------
+bool vtkSlicerCLIModuleLogic
+::CanUseSharedMemoryTransfer(vtkMRMLCommandLineModuleNode* node)
+{
+  const std::string& directory = this->Internal->SharedMemoryDirectory;
+  if (directory.empty() ||
+      !vtksys::SystemTools::FileIsDirectory(directory.c_str()))
+    {
+    return false;
+    }
+
+  // The size of the output images is not known before the module runs,
+  // reserve the size of the largest input image for each of them.
+  vtkTypeUInt64 inputSize = 0;
+  vtkTypeUInt64 largestInputSize = 0;
+  int numberOfOutputs = 0;
+  const std::vector<ModuleParameterGroup>& groups =
+    node->GetModuleDescription().GetParameterGroups();
+  std::vector<ModuleParameterGroup>::const_iterator pgit;
+  for (pgit = groups.begin(); pgit != groups.end(); ++pgit)
+    {
+    const std::vector<ModuleParameter>& parameters = (*pgit).GetParameters();
+    std::vector<ModuleParameter>::const_iterator pit;
+    for (pit = parameters.begin(); pit != parameters.end(); ++pit)
+      {
+      if ((*pit).GetTag() != "image")
+        {
+        continue;
+        }
+      if ((*pit).GetChannel() == "output")
+        {
+        ++numberOfOutputs;
+        continue;
+        }
+      vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(
+        this->GetMRMLScene()->GetNodeByID((*pit).GetValue().c_str()));
+      if (!volumeNode || !volumeNode->GetImageData())
+        {
+        continue;
+        }
+      // GetActualMemorySize() is in kibibytes
+      vtkTypeUInt64 size =
+        static_cast<vtkTypeUInt64>(volumeNode->GetImageData()->GetActualMemorySize()) * 1024;
+      inputSize += size;
+      largestInputSize = std::max(largestInputSize, size);
+      }
+    }
+  vtkTypeUInt64 requiredSize = inputSize + numberOfOutputs * largestInputSize;
+  vtkTypeUInt64 availableSize = GetAvailableDiskSpace(directory);
+  if (availableSize < requiredSize)
+    {
+    vtkDebugMacro("Not enough space in " << directory << " to exchange images: "
+                  << requiredSize << " bytes required, "
+                  << availableSize << " bytes available.");
+    return false;
+    }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 std::string
 vtkSlicerCLIModuleLogic
@@ -486,7 +608,8 @@ vtkSlicerCLIModuleLogic
                              const std::string& type,
                              const std::string& name,
                              const std::vector<std::string>& extensions,
-                             CommandLineModuleType commandType)
+                             CommandLineModuleType commandType,
+                             bool useSharedMemory)
 {
   std::string fname = name;
   std::string pid;
@@ -505,6 +628,9 @@ vtkSlicerCLIModuleLogic
   //
   // 3. If the consumer of the file cannot communicate directly with
   // the MRML scene, then a real temporary filename is constructed.
+  // Images exchanged with an executable can be written in a RAM-backed
+  // file system (see SetAllowSharedMemoryTransfer()) instead of the
+  // temporary directory.
   // The filename will point to the Temporary directory defined for
   // Slicer. The filename will be unique to the process (multiple
   // running instances of slicer will not collide).  The filename
@@ -564,6 +690,15 @@ vtkSlicerCLIModuleLogic
         {
         ext = extensions[0];
         }
+      std::string lowerExt = vtksys::SystemTools::LowerCase(ext);
+      if (useSharedMemory && commandType == CommandLineModule &&
+          (lowerExt == ".nrrd" || lowerExt == ".nhdr"))
+        {
+        // Uncompressed NRRD files are read and written without any
+        // decoding, when located in shared memory they never hit the disk.
+        fname = this->Internal->SharedMemoryDirectory + "/"
+          + vtksys::SystemTools::GetFilenameName(fname);
+        }
       fname = fname + ext;
       }
     else
@@ -916,6 +1051,11 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
   // vector of files to delete
   std::set<std::string> filesToDelete;
 
+  // Exchange images with executables through shared memory if possible
+  bool useSharedMemory = commandType == CommandLineModule
+    && this->GetAllowSharedMemoryTransfer()
+    && this->CanUseSharedMemoryTransfer(node0);
+
   // iterators for parameter groups
   std::vector<ModuleParameterGroup>::iterator pgbeginit
     = node0->GetModuleDescription().GetParameterGroups().begin();
@@ -963,7 +1103,8 @@ void vtkSlicerCLIModuleLogic::ApplyTask(void *clientdata)
                                              (*pit).GetType(),
                                              id,
                                              (*pit).GetFileExtensions(),
-                                             commandType);
+                                             commandType,
+                                             useSharedMemory);
 
         filesToDelete.insert(fname);
         if ((*pit).GetChannel() == "input")
@@ -80,6 +80,23 @@ public:
   void SetAllowInMemoryTransfer(int value);
   int GetAllowInMemoryTransfer() const;
 
+  /// Control use of shared memory to exchange images with executable CLIs.
+  /// If enabled, the input and output volumes of command line modules are
+  /// exchanged as uncompressed NRRD files in the SharedMemoryDirectory
+  /// instead of the temporary directory. Only modules that read and write
+  /// NRRD images are concerned. Disabled by default.
+  /// \sa SetSharedMemoryDirectory()
+  void SetAllowSharedMemoryTransfer(int value);
+  int GetAllowSharedMemoryTransfer() const;
+
+  /// Directory of a RAM-backed file system used to exchange images when
+  /// AllowSharedMemoryTransfer is enabled. Default is the POSIX shared
+  /// memory directory (/dev/shm) if it exists, empty otherwise.
+  /// The temporary directory is used instead if it is empty, does not exist
+  /// or does not have enough free space for the input and output images.
+  void SetSharedMemoryDirectory(const char* directory);
+  const char* GetSharedMemoryDirectory() const;
+
   /// For debugging, control redirection of cout and cerr
   virtual void RedirectModuleStreamsOn();
   virtual void RedirectModuleStreamsOff();
@@ -127,8 +144,12 @@ protected:
                                          const std::string& type,
                                          const std::string& name,
                                      const std::vector<std::string>& extensions,
-                                     CommandLineModuleType commandType);
+                                     CommandLineModuleType commandType,
+                                     bool useSharedMemory = false);
   std::string ConstructTemporarySceneFileName(vtkMRMLScene *scene);
+  /// Return true if the free space of the SharedMemoryDirectory is large
+  /// enough to exchange the images of the module of \a node.
+  bool CanUseSharedMemoryTransfer(vtkMRMLCommandLineModuleNode* node);
   std::string FindHiddenNodeID(const ModuleDescription& d,
                                const ModuleParameter& p);
 
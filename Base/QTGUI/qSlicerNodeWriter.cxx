@@ -157,6 +157,10 @@ bool qSlicerNodeWriter::write(const qSlicerIO::IOProperties& properties)
     {
     snode->SetUseCompression(properties["useCompression"].toInt());
     }
+  if (properties.contains("compressionLevel"))
+    {
+    snode->SetCompressionLevel(properties["compressionLevel"].toInt());
+    }
   bool res = snode->WriteData(node);
 
   if (res)
@@ -0,0 +1,166 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// MRML includes
+#include "vtkEventBroker.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Modify the node passed as client data: the observation of that node is
+// nested in the observation of the caller.
+void ModifyClientDataCallback(vtkObject* vtkNotUsed(caller),
+                              unsigned long vtkNotUsed(eid),
+                              void* clientData, void* vtkNotUsed(callData))
+{
+  vtkMRMLNode* node = reinterpret_cast<vtkMRMLNode*>(clientData);
+  if (node)
+    {
+    node->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int CountOccurrences(const std::string& str, const std::string& pattern)
+{
+  int count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + pattern.size()))
+    {
+    ++count;
+    }
+  return count;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkEventBrokerTracingTest1(int argc, char * argv[] )
+{
+  if (argc != 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string fileName = std::string(argv[1]) + "/vtkEventBrokerTracingTest1.json";
+
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  CHECK_BOOL(broker->GetTracing(), false);
+  CHECK_BOOL(broker->StopTracing(), false);
+
+  // node1 modified -> observer modifies node2 -> node2 observed
+  vtkNew<vtkMRMLModelNode> node1;
+  vtkNew<vtkMRMLModelNode> node2;
+  vtkNew<vtkMRMLModelNode> observer;
+  vtkNew<vtkCallbackCommand> modifyNode2;
+  modifyNode2->SetCallback(ModifyClientDataCallback);
+  modifyNode2->SetClientData(node2.GetPointer());
+  vtkNew<vtkCallbackCommand> doNothing;
+  doNothing->SetCallback(ModifyClientDataCallback);
+  broker->AddObservation(node1.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), modifyNode2.GetPointer());
+  broker->AddObservation(node2.GetPointer(), vtkCommand::ModifiedEvent,
+                         observer.GetPointer(), doNothing.GetPointer());
+
+  // Nothing is recorded when not tracing
+  node1->Modified();
+  broker->TraceBegin("Not traced", "test");
+  broker->TraceEnd();
+  CHECK_INT(broker->GetNumberOfTraceEvents(), 0);
+
+  // Sections started before tracing are not recorded, neither are their ends
+  vtkNew<vtkMRMLScene> scene;
+  scene->StartState(vtkMRMLScene::CloseState);
+  broker->TraceBegin("Started before tracing", "test");
+
+  broker->StartTracing(fileName.c_str());
+  CHECK_BOOL(broker->GetTracing(), true);
+  {
+  vtkEventBrokerTraceScope trace("Test \"scope\"", "test", "{\"value\":1}");
+  node1->Modified();
+  }
+  // 2 nested observations and the scope
+  CHECK_INT(broker->GetNumberOfTraceEvents(), 6);
+
+  scene->StartState(vtkMRMLScene::ImportState);
+  scene->EndState(vtkMRMLScene::ImportState);
+  CHECK_BOOL(broker->GetNumberOfTraceEvents() >= 8, true);
+  int numberOfEvents = broker->GetNumberOfTraceEvents();
+  broker->TraceEnd();
+  scene->EndState(vtkMRMLScene::CloseState);
+  CHECK_INT(broker->GetNumberOfTraceEvents(), numberOfEvents);
+
+  CHECK_BOOL(broker->StopTracing(), true);
+  CHECK_BOOL(broker->GetTracing(), false);
+  node1->Modified();
+  CHECK_INT(broker->GetNumberOfTraceEvents(), 0);
+
+  broker->RemoveObservations(observer.GetPointer());
+
+  // Check the trace file
+  std::ifstream file(fileName.c_str());
+  CHECK_BOOL(file.is_open(), true);
+  std::stringstream content;
+  content << file.rdbuf();
+  std::string trace = content.str();
+  int numberOfBegins = CountOccurrences(trace, "\"ph\":\"B\"");
+  CHECK_BOOL(numberOfBegins >= 4, true);
+  CHECK_INT(CountOccurrences(trace, "\"ph\":\"E\""), numberOfBegins);
+  CHECK_INT(CountOccurrences(trace, "\"name\":\"ModifiedEvent\""), 2);
+  CHECK_INT(CountOccurrences(trace, "\"name\":\"Test \\\"scope\\\"\""), 1);
+  CHECK_INT(CountOccurrences(trace, "\"name\":\"Scene import\""), 1);
+  CHECK_INT(CountOccurrences(trace, "\"observer\":\"vtkMRMLModelNode\""), 2);
+  CHECK_INT(CountOccurrences(trace, "\"name\":\"thread_name\""), 1);
+  CHECK_INT(CountOccurrences(trace, "{\"value\":1}"), 1);
+  CHECK_INT(CountOccurrences(trace, "Started before tracing"), 0);
+  CHECK_INT(CountOccurrences(trace, "\"name\":\"Scene close\""), 0);
+  file.close();
+
+  // The number of records is bounded, the recorded sections are still closed
+  broker->SetMaximumNumberOfTraceEvents(3);
+  broker->StartTracing(fileName.c_str());
+  {
+  vtkEventBrokerTraceScope trace("Outer", "test");
+  for (int i = 0; i < 10; ++i)
+    {
+    vtkEventBrokerTraceScope innerTrace("Inner", "test");
+    }
+  }
+  CHECK_INT(broker->GetNumberOfTraceEvents(), 4);
+  CHECK_INT(broker->GetNumberOfDroppedTraceEvents(), 9);
+  TESTING_OUTPUT_ASSERT_WARNINGS_BEGIN();
+  CHECK_BOOL(broker->StopTracing(), true);
+  TESTING_OUTPUT_ASSERT_WARNINGS_END();
+  broker->SetMaximumNumberOfTraceEvents(1000000);
+
+  std::ifstream boundedFile(fileName.c_str());
+  CHECK_BOOL(boundedFile.is_open(), true);
+  std::stringstream boundedContent;
+  boundedContent << boundedFile.rdbuf();
+  trace = boundedContent.str();
+  CHECK_INT(CountOccurrences(trace, "\"ph\":\"B\""), 2);
+  CHECK_INT(CountOccurrences(trace, "\"ph\":\"E\""), 2);
+
+  return EXIT_SUCCESS;
+}
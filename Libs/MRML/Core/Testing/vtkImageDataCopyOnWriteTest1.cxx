@@ -0,0 +1,160 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkImageDataCopyOnWrite.h"
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkVersion.h>
+
+// STD includes
+#include <cstdlib>
+
+//----------------------------------------------------------------------------
+int vtkImageDataCopyOnWriteTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // 128x128x64 short volume (2 MB): scalar = i + j
+  vtkNew<vtkImageData> source;
+  source->SetDimensions(128, 128, 64);
+  source->SetSpacing(0.5, 0.5, 2.);
+  source->AllocateScalars(VTK_SHORT, 1);
+  short* sourceVoxels = static_cast<short*>(source->GetScalarPointer());
+  for (int k = 0; k < 64; ++k)
+    {
+    for (int j = 0; j < 128; ++j)
+      {
+      for (int i = 0; i < 128; ++i)
+        {
+        *(sourceVoxels++) = static_cast<short>(i + j);
+        }
+      }
+    }
+  source->GetPointData()->GetScalars()->SetName("ImageScalars");
+  // Small arrays are deep copied
+  vtkNew<vtkDoubleArray> smallArray;
+  smallArray->SetName("Small");
+  smallArray->SetNumberOfValues(10);
+  smallArray->FillComponent(0, 3.);
+  source->GetPointData()->AddArray(smallArray.GetPointer());
+
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 0);
+
+  // The source is not modified by the copy: its voxels can still be
+  // written through a pointer obtained before
+  short* sourcePointer = static_cast<short*>(source->GetScalarPointer(0, 0, 0));
+  vtkNew<vtkImageData> copy1;
+  vtkImageDataCopyOnWrite::Copy(source.GetPointer(), copy1.GetPointer());
+  CHECK_POINTER(source->GetScalarPointer(0, 0, 0), sourcePointer);
+  CHECK_BOOL(vtkImageDataCopyOnWrite::IsCopyOnWrite(source->GetPointData()->GetScalars()), false);
+  sourcePointer[5] = -5;
+  CHECK_DOUBLE(source->GetScalarComponentAsDouble(5, 0, 0, 0), -5.);
+  CHECK_DOUBLE(copy1->GetScalarComponentAsDouble(5, 0, 0, 0), 5.);
+  sourcePointer[5] = 5;
+  CHECK_INT(copy1->GetDimensions()[2], 64);
+  CHECK_DOUBLE(copy1->GetSpacing()[2], 2.);
+  CHECK_INT(copy1->GetScalarType(), VTK_SHORT);
+  CHECK_STRING(copy1->GetPointData()->GetScalars()->GetName(), "ImageScalars");
+  CHECK_DOUBLE(copy1->GetPointData()->GetArray("Small")->GetComponent(9, 0), 3.);
+  CHECK_DOUBLE(copy1->GetScalarComponentAsDouble(100, 20, 63, 0), 120.);
+  CHECK_DOUBLE(source->GetScalarComponentAsDouble(100, 20, 63, 0), 120.);
+  CHECK_BOOL(vtkImageDataCopyOnWrite::IsCopyOnWrite(copy1->GetPointData()->GetArray("Small")), false);
+#if VTK_MAJOR_VERSION >= 9 || (VTK_MAJOR_VERSION >= 8 && VTK_MINOR_VERSION >= 1)
+  CHECK_BOOL(vtkImageDataCopyOnWrite::IsCopyOnWrite(copy1->GetPointData()->GetScalars()), true);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 1);
+#else
+  // Arrays are deep copied
+  CHECK_BOOL(vtkImageDataCopyOnWrite::IsCopyOnWrite(copy1->GetPointData()->GetScalars()), false);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 0);
+  return EXIT_SUCCESS;
+#endif
+
+  // Copies of the unmodified source (its content is compared, it was
+  // restored) and copies of copies share the buffer
+  vtkNew<vtkImageData> copy2;
+  vtkImageDataCopyOnWrite::Copy(source.GetPointer(), copy2.GetPointer());
+  vtkNew<vtkImageData> copy3;
+  vtkImageDataCopyOnWrite::Copy(copy1.GetPointer(), copy3.GetPointer());
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 1);
+
+  // Writes are private to each image, modifying the images does not modify
+  // their arrays
+  copy1->SetScalarComponentFromDouble(100, 20, 63, 0, -1.);
+  copy1->Modified();
+  source->SetScalarComponentFromDouble(100, 20, 63, 0, -2.);
+  source->Modified();
+  CHECK_DOUBLE(copy1->GetScalarComponentAsDouble(100, 20, 63, 0), -1.);
+  CHECK_DOUBLE(source->GetScalarComponentAsDouble(100, 20, 63, 0), -2.);
+  CHECK_DOUBLE(copy2->GetScalarComponentAsDouble(100, 20, 63, 0), 120.);
+  CHECK_DOUBLE(copy3->GetScalarComponentAsDouble(100, 20, 63, 0), 120.);
+  CHECK_DOUBLE(copy3->GetScalarComponentAsDouble(101, 20, 63, 0), 121.);
+
+  // Modified images are copied to a new buffer
+  vtkNew<vtkImageData> copy4;
+  vtkImageDataCopyOnWrite::Copy(copy1.GetPointer(), copy4.GetPointer());
+  CHECK_DOUBLE(copy4->GetScalarComponentAsDouble(100, 20, 63, 0), -1.);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 2);
+  vtkNew<vtkImageData> copy5;
+  vtkImageDataCopyOnWrite::Copy(source.GetPointer(), copy5.GetPointer());
+  CHECK_DOUBLE(copy5->GetScalarComponentAsDouble(100, 20, 63, 0), -2.);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 3);
+
+  // Writes through the scalar pointer do not modify the arrays, they are
+  // still found in the copies of the source and of a copy
+  *static_cast<short*>(source->GetScalarPointer(10, 10, 10)) = -3;
+  vtkNew<vtkImageData> copy6;
+  vtkImageDataCopyOnWrite::Copy(source.GetPointer(), copy6.GetPointer());
+  CHECK_DOUBLE(copy6->GetScalarComponentAsDouble(10, 10, 10, 0), -3.);
+  CHECK_DOUBLE(copy5->GetScalarComponentAsDouble(10, 10, 10, 0), 20.);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 4);
+  *static_cast<short*>(copy3->GetScalarPointer(10, 10, 10)) = -4;
+  vtkNew<vtkImageData> copy7;
+  vtkImageDataCopyOnWrite::Copy(copy3.GetPointer(), copy7.GetPointer());
+  CHECK_DOUBLE(copy7->GetScalarComponentAsDouble(10, 10, 10, 0), -4.);
+  CHECK_DOUBLE(copy2->GetScalarComponentAsDouble(10, 10, 10, 0), 20.);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 5);
+  // Unchanged since the last copy: the buffer is reused
+  vtkNew<vtkImageData> copy8;
+  vtkImageDataCopyOnWrite::Copy(source.GetPointer(), copy8.GetPointer());
+  CHECK_DOUBLE(copy8->GetScalarComponentAsDouble(10, 10, 10, 0), -3.);
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 5);
+
+  // Buffers are released with the last copy mapping them, the source does
+  // not map any buffer
+  copy7->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 4);
+  copy6->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 4);
+  copy8->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 3);
+  copy5->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 2);
+  copy4->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 1);
+  copy1->Initialize();
+  copy2->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 1);
+  CHECK_DOUBLE(copy3->GetScalarComponentAsDouble(100, 20, 63, 0), 120.);
+  copy3->Initialize();
+  CHECK_INT(vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers(), 0);
+  CHECK_DOUBLE(source->GetScalarComponentAsDouble(10, 10, 10, 0), -3.);
+  CHECK_POINTER(source->GetScalarPointer(0, 0, 0), sourcePointer);
+
+  return EXIT_SUCCESS;
+}
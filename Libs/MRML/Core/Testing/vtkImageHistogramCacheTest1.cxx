@@ -0,0 +1,153 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkImageHistogramCache.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLScalarVolumeDisplayNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckValue(const char* name, double value, double expected)
+{
+  if (fabs(value - expected) > 1e-6)
+    {
+    std::cerr << name << ": expected " << expected << ", got " << value << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkImageHistogramCacheTest1(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  // 20x10x5 volume: scalar = i - 5, 50 voxels per value in [-5, 14]
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(20, 10, 5);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < 5; ++k)
+    {
+    for (int j = 0; j < 10; ++j)
+      {
+      for (int i = 0; i < 20; ++i)
+        {
+        imageData->SetScalarComponentFromDouble(i, j, k, 0, i - 5);
+        }
+      }
+    }
+
+  vtkNew<vtkImageHistogramCache> cache;
+  CHECK_BOOL(cache->Update(), false);
+
+  // Exact statistics, one bin per value
+  cache->SetImageData(imageData.GetPointer());
+  cache->SetNumberOfThreads(3);
+  CHECK_BOOL(cache->IsUpToDate(), false);
+  CHECK_BOOL(cache->Update(), true);
+  CHECK_BOOL(cache->IsUpToDate(), true);
+  CHECK_BOOL(cache->GetEstimated(), false);
+  CHECK_INT(static_cast<int>(cache->GetNumberOfSamples()), 1000);
+  CHECK_BOOL(CheckValue("Minimum", cache->GetMinimum(), -5.), true);
+  CHECK_BOOL(CheckValue("Maximum", cache->GetMaximum(), 14.), true);
+  CHECK_BOOL(CheckValue("Mean", cache->GetMean(), 4.5), true);
+  CHECK_BOOL(CheckValue("StandardDeviation", cache->GetStandardDeviation(),
+                        sqrt(33.25 * 1000. / 999.)), true);
+  CHECK_INT(cache->GetNumberOfBins(), 20);
+  CHECK_BOOL(CheckValue("BinOrigin", cache->GetBinOrigin(), -5.), true);
+  CHECK_BOOL(CheckValue("BinSpacing", cache->GetBinSpacing(), 1.), true);
+  CHECK_INT(static_cast<int>(cache->GetHistogram()->GetValue(7)), 50);
+  CHECK_BOOL(CheckValue("Percentile", cache->GetPercentile(50.), 4.), true);
+  CHECK_BOOL(CheckValue("Percentile", cache->GetPercentile(100.), 14.), true);
+
+  // The multithreader runs fewer threads than requested
+  int globalMaximumNumberOfThreads = vtkMultiThreader::GetGlobalMaximumNumberOfThreads();
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(2);
+  cache->SetNumberOfThreads(8);
+  imageData->Modified();
+  bool updated = cache->Update();
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(globalMaximumNumberOfThreads);
+  CHECK_BOOL(updated, true);
+  CHECK_INT(static_cast<int>(cache->GetNumberOfSamples()), 1000);
+  CHECK_INT(static_cast<int>(cache->GetHistogram()->GetValue(7)), 50);
+
+  // Statistics are recomputed only when the image is modified
+  imageData->SetScalarComponentFromDouble(0, 0, 0, 0, 100);
+  imageData->Modified();
+  CHECK_BOOL(cache->IsUpToDate(), false);
+  CHECK_BOOL(cache->Update(), true);
+  CHECK_BOOL(CheckValue("Maximum", cache->GetMaximum(), 100.), true);
+  CHECK_INT(cache->GetNumberOfBins(), 106);
+
+  // Estimate from every 3rd voxel along each axis
+  cache->SetMaximumNumberOfEstimateSamples(100);
+  CHECK_BOOL(cache->IsUpToDate(true), true);
+  imageData->Modified();
+  CHECK_BOOL(cache->Update(true), true);
+  CHECK_BOOL(cache->GetEstimated(), true);
+  CHECK_INT(static_cast<int>(cache->GetNumberOfSamples()), 7 * 4 * 2);
+  CHECK_BOOL(cache->IsUpToDate(true), true);
+  CHECK_BOOL(cache->IsUpToDate(false), false);
+  CHECK_BOOL(cache->Update(), true);
+  CHECK_BOOL(cache->GetEstimated(), false);
+  CHECK_INT(static_cast<int>(cache->GetNumberOfSamples()), 1000);
+
+  // Floating point images: bins spread over the range
+  vtkNew<vtkImageData> floatImageData;
+  floatImageData->SetDimensions(11, 1, 1);
+  floatImageData->AllocateScalars(VTK_FLOAT, 1);
+  for (int i = 0; i < 11; ++i)
+    {
+    floatImageData->SetScalarComponentFromDouble(i, 0, 0, 0, i * 0.1);
+    }
+  cache->SetImageData(floatImageData.GetPointer());
+  cache->SetMaximumNumberOfBins(11);
+  CHECK_BOOL(cache->Update(), true);
+  CHECK_INT(cache->GetNumberOfBins(), 11);
+  CHECK_BOOL(CheckValue("BinSpacing", cache->GetBinSpacing(), 0.1), true);
+  CHECK_INT(static_cast<int>(cache->GetHistogram()->GetValue(3)), 1);
+
+  // The cache of a volume is shared by its display nodes
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  scene->AddNode(volumeNode.GetPointer());
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  vtkImageHistogramCache* volumeCache = volumeNode->GetHistogramCache();
+  CHECK_POINTER(volumeNode->GetHistogramCache(), volumeCache);
+  CHECK_POINTER(volumeCache->GetImageData(), imageData.GetPointer());
+  CHECK_BOOL(volumeCache->IsUpToDate(true), false);
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  displayNode->Modified();
+  CHECK_BOOL(volumeCache->IsUpToDate(true), true);
+
+  return EXIT_SUCCESS;
+}
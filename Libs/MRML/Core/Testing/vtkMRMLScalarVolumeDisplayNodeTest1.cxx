@@ -10,12 +10,84 @@
 
 =========================================================================auto=*/
 
+#include "vtkImageBimodalAnalysis.h"
+#include "vtkImageHistogramCache.h"
 #include "vtkMRMLCoreTestingMacros.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkImageAccumulate.h>
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Auto window/level must match the one computed before the histogram cache:
+// bimodal analysis of a 65536-bin histogram starting at -32768.
+int TestAutoLevels()
+{
+  // CT-like image: -32768 padding around the field of view, air on one side
+  // and soft tissue on the other.
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(40, 40, 8);
+  imageData->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < 8; ++k)
+    {
+    for (int j = 0; j < 40; ++j)
+      {
+      for (int i = 0; i < 40; ++i)
+        {
+        int noise = (i * 73 + j * 151 + k * 31 + i * j * 7) % 997;
+        double value = -32768;
+        if (i >= 4 && i < 36 && j >= 4 && j < 36)
+          {
+          value = (i < 16) ? -1000 + noise % 50 : 40 + noise % 200;
+          }
+        imageData->SetScalarComponentFromDouble(i, j, k, 0, value);
+        }
+      }
+    }
+
+  vtkNew<vtkImageAccumulate> accumulate;
+  int extent[6] = {0, 65535, 0, 0, 0, 0};
+  accumulate->SetComponentExtent(extent);
+  double origin[3] = {-32768, 0, 0};
+  accumulate->SetComponentOrigin(origin);
+  accumulate->SetInputData(imageData.GetPointer());
+  vtkNew<vtkImageBimodalAnalysis> bimodal;
+  bimodal->SetInputConnection(accumulate->GetOutputPort());
+  bimodal->Update();
+
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLScalarVolumeNode> volumeNode;
+  scene->AddNode(volumeNode.GetPointer());
+  volumeNode->SetAndObserveImageData(imageData.GetPointer());
+  // An estimated histogram would give a different window/level
+  volumeNode->GetHistogramCache()->SetMaximumNumberOfEstimateSamples(1000);
+  vtkNew<vtkMRMLScalarVolumeDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+  displayNode->SetAutoWindowLevel(1);
+  displayNode->SetAutoThreshold(1);
+  displayNode->CalculateAutoLevels();
+
+  CHECK_DOUBLE(displayNode->GetWindow(), bimodal->GetWindow());
+  CHECK_DOUBLE(displayNode->GetLevel(), bimodal->GetLevel());
+  CHECK_DOUBLE(displayNode->GetLowerThreshold(), bimodal->GetThreshold());
+  CHECK_DOUBLE(displayNode->GetUpperThreshold(), bimodal->GetMax());
+  return EXIT_SUCCESS;
+}
+
+} // end of anonymous namespace
 
 int vtkMRMLScalarVolumeDisplayNodeTest1(int , char * [] )
 {
   vtkNew<vtkMRMLScalarVolumeDisplayNode> node1;
   EXERCISE_ALL_BASIC_MRML_METHODS(node1.GetPointer());
+  CHECK_EXIT_SUCCESS(TestAutoLevels());
   return EXIT_SUCCESS;
 }
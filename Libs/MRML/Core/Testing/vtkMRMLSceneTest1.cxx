@@ -374,6 +374,56 @@ int vtkMRMLSceneTest1(int , char * [] )
       }
   }
 
+  //---------------------------------------------------------------------------
+  // Test registered node classes lookups
+  //---------------------------------------------------------------------------
+  {
+    CHECK_STRING(scene1->GetClassNameByTag("Volume"), "vtkMRMLScalarVolumeNode");
+    CHECK_STRING(scene1->GetTagByClassName("vtkMRMLScalarVolumeNode"), "Volume");
+    CHECK_NULL(scene1->GetClassNameByTag("InvalidTag"));
+    CHECK_NULL(scene1->GetTagByClassName("vtkMRMLInvalidNode"));
+
+    scene1->RegisterNodeClass(vtkSmartPointer<vtkMRMLAnotherCustomNode>::New());
+    scene1->RegisterNodeClass(vtkSmartPointer<vtkMRMLAnotherCustomNode>::New(), "AnotherCustomAlias");
+    CHECK_STRING(scene1->GetClassNameByTag("AnotherCustom"), "vtkMRMLAnotherCustomNode");
+    CHECK_STRING(scene1->GetClassNameByTag("AnotherCustomAlias"), "vtkMRMLAnotherCustomNode");
+    CHECK_STRING(scene1->GetTagByClassName("vtkMRMLAnotherCustomNode"), "AnotherCustom");
+    vtkSmartPointer<vtkMRMLNode> createdNode;
+    createdNode.TakeReference(scene1->CreateNodeByClass("vtkMRMLAnotherCustomNode"));
+    CHECK_NOT_NULL(vtkMRMLAnotherCustomNode::SafeDownCast(createdNode));
+  }
+
+  //---------------------------------------------------------------------------
+  // Test that nodes by class are up-to-date when adding and removing nodes
+  //---------------------------------------------------------------------------
+  {
+    int numberOfNodes = scene1->GetNumberOfNodes();
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLNode"), numberOfNodes);
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLCustomNode"), 2);
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLInvalidNode"), 0);
+
+    vtkMRMLNode* node5 = scene1->AddNode(vtkSmartPointer<vtkMRMLCustomNode>::New());
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLNode"), numberOfNodes + 1);
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLCustomNode"), 3);
+    CHECK_POINTER(scene1->GetNthNodeByClass(2, "vtkMRMLCustomNode"), node5);
+    CHECK_NULL(scene1->GetNthNodeByClass(3, "vtkMRMLCustomNode"));
+
+    vtkMRMLNode* node6 = scene1->InsertBeforeNode(node4, vtkSmartPointer<vtkMRMLCustomNode>::New());
+    std::vector<vtkMRMLNode*> customNodes;
+    CHECK_INT(scene1->GetNodesByClass("vtkMRMLCustomNode", customNodes), 4);
+    CHECK_POINTER(customNodes[0], node1);
+    CHECK_POINTER(customNodes[1], node6);
+    CHECK_POINTER(customNodes[2], node4);
+    CHECK_POINTER(customNodes[3], node5);
+
+    scene1->RemoveNode(node6);
+    scene1->RemoveNode(node5);
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLCustomNode"), 2);
+    CHECK_POINTER(scene1->GetFirstNodeByClass("vtkMRMLCustomNode"), node1);
+    CHECK_POINTER(scene1->GetNthNodeByClass(1, "vtkMRMLCustomNode"), node4);
+    CHECK_INT(scene1->GetNumberOfNodesByClass("vtkMRMLNode"), numberOfNodes);
+  }
+
   // Verify content of ReferencedIDChanges map
   {
     // Make sure IDs of nodes coming from private scenes are not stored in
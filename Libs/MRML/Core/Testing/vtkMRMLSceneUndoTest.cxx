@@ -0,0 +1,185 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLModelNode.h"
+#include "vtkMRMLScene.h"
+#include "vtkMRMLSegmentationNode.h"
+#include "vtkMRMLTransformNode.h"
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegmentationConverter.h"
+
+// vtkAddon includes
+#include "vtkOrientedGridTransform.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cstdlib>
+
+//---------------------------------------------------------------------------
+int vtkMRMLSceneUndoTest(int vtkNotUsed(argc), char * vtkNotUsed(argv) [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  scene->SetUndoOn();
+
+  vtkNew<vtkMRMLModelNode> node;
+  node->SetName("A");
+  scene->AddNode(node.GetPointer());
+
+  // Undo/redo a node modification
+  scene->SaveStateForUndo(node.GetPointer());
+  node->SetName("B");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 1);
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "A");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 0);
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 1);
+  scene->Redo();
+  CHECK_STRING(node->GetName(), "B");
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 1);
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 0);
+
+  // Undo/redo a node addition
+  scene->SaveStateForUndo();
+  vtkNew<vtkMRMLModelNode> node2;
+  scene->AddNode(node2.GetPointer());
+  scene->Undo();
+  CHECK_BOOL(scene->IsNodePresent(node2.GetPointer()) != 0, false);
+  CHECK_STRING(node->GetName(), "B");
+  scene->Redo();
+  CHECK_BOOL(scene->IsNodePresent(node2.GetPointer()) != 0, true);
+  CHECK_POINTER(scene->GetNodeByID(node2->GetID()), node2.GetPointer());
+
+  // Undo/redo a node removal
+  scene->SaveStateForUndo();
+  scene->RemoveNode(node2.GetPointer());
+  scene->Undo();
+  CHECK_BOOL(scene->IsNodePresent(node2.GetPointer()) != 0, true);
+  scene->Redo();
+  CHECK_BOOL(scene->IsNodePresent(node2.GetPointer()) != 0, false);
+
+  // Saving a new state clears the redo history
+  scene->Undo();
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 1);
+  scene->SaveStateForUndo(node.GetPointer());
+  CHECK_INT(scene->GetNumberOfRedoLevels(), 0);
+
+  // Copies of unmodified nodes are shared between levels
+  scene->ClearUndoStack();
+  scene->SaveStateForUndo(node.GetPointer());
+  unsigned long memorySize = scene->GetUndoMemorySize();
+  CHECK_BOOL(memorySize > 0, true);
+  scene->SaveStateForUndo(node.GetPointer());
+  CHECK_INT(static_cast<int>(scene->GetUndoMemorySize()), static_cast<int>(memorySize));
+  node->SetName("C");
+  scene->SaveStateForUndo(node.GetPointer());
+  CHECK_BOOL(scene->GetUndoMemorySize() > memorySize, true);
+  scene->Undo();
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "B");
+
+  // The oldest levels are discarded
+  scene->ClearUndoStack();
+  scene->SetUndoStackSize(2);
+  for (int i = 0; i < 5; ++i)
+    {
+    scene->SaveStateForUndo(node.GetPointer());
+    node->SetName(i % 2 ? "D" : "E");
+    }
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 2);
+
+  // Saving the whole scene only copies the modified nodes
+  scene->ClearUndoStack();
+  scene->SetUndoStackSize(100);
+  node->SetName("E");
+  scene->SaveStateForUndo();
+  memorySize = scene->GetUndoMemorySize();
+  CHECK_BOOL(memorySize > 0, true);
+  scene->SaveStateForUndo();
+  CHECK_INT(static_cast<int>(scene->GetUndoMemorySize()), static_cast<int>(memorySize));
+  node->SetName("F");
+  scene->SaveStateForUndo();
+  CHECK_BOOL(scene->GetUndoMemorySize() > memorySize, true);
+  node->SetName("G");
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "F");
+  // restored from the copy of the first level
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "E");
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "E");
+  scene->Redo();
+  scene->Redo();
+  CHECK_STRING(node->GetName(), "F");
+  scene->Redo();
+  CHECK_STRING(node->GetName(), "G");
+
+  // Copies still needed are kept when the oldest level is discarded
+  scene->ClearUndoStack();
+  scene->ClearRedoStack();
+  CHECK_INT(static_cast<int>(scene->GetUndoMemorySize()), 0);
+  scene->SetUndoStackSize(2);
+  node->SetName("H");
+  scene->SaveStateForUndo();
+  scene->SaveStateForUndo();
+  scene->SaveStateForUndo();
+  CHECK_INT(scene->GetNumberOfUndoLevels(), 2);
+  node->SetName("I");
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "H");
+  scene->Undo();
+  CHECK_STRING(node->GetName(), "H");
+
+  // Segments and transform grids copied for undo count in the undo memory
+  scene->ClearUndoStack();
+  scene->ClearRedoStack();
+  scene->SetUndoStackSize(100);
+  vtkNew<vtkOrientedImageData> labelmap;
+  labelmap->SetDimensions(64, 64, 64);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkNew<vtkSegment> segment;
+  segment->AddRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName(), labelmap.GetPointer());
+  vtkNew<vtkMRMLSegmentationNode> segmentationNode;
+  scene->AddNode(segmentationNode.GetPointer());
+  segmentationNode->GetSegmentation()->AddSegment(segment.GetPointer());
+  memorySize = scene->GetUndoMemorySize();
+  scene->SaveStateForUndo(segmentationNode.GetPointer());
+  CHECK_BOOL(scene->GetUndoMemorySize() >= memorySize + 64 * 64 * 64 / 1024, true);
+
+  vtkNew<vtkImageData> displacementGrid;
+  displacementGrid->SetDimensions(32, 32, 32);
+  displacementGrid->AllocateScalars(VTK_DOUBLE, 3);
+  vtkNew<vtkOrientedGridTransform> gridTransform;
+  gridTransform->SetDisplacementGridData(displacementGrid.GetPointer());
+  vtkNew<vtkMRMLTransformNode> transformNode;
+  transformNode->SetAndObserveTransformToParent(gridTransform.GetPointer());
+  scene->AddNode(transformNode.GetPointer());
+  memorySize = scene->GetUndoMemorySize();
+  scene->SaveStateForUndo(transformNode.GetPointer());
+  CHECK_BOOL(scene->GetUndoMemorySize() >= memorySize + 32 * 32 * 32 * 3 * sizeof(double) / 1024, true);
+
+  // The memory is released with the levels
+  scene->ClearUndoStack();
+  CHECK_INT(static_cast<int>(scene->GetUndoMemorySize()), 0);
+
+  return EXIT_SUCCESS;
+}
@@ -25,6 +25,8 @@
 #include "vtkMRMLTableSQLiteStorageNode.h"
 
 #include "vtkFloatArray.h"
+#include "vtkIntArray.h"
+#include "vtkStringArray.h"
 #include "vtkTable.h"
 #include "vtkTestErrorObserver.h"
 
@@ -67,6 +69,13 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
   arrS->SetName("Sine");
   table->AddColumn(arrS.GetPointer());
 
+  vtkNew<vtkIntArray> arrIndex;
+  arrIndex->SetName("Point index");
+  table->AddColumn(arrIndex.GetPointer());
+  vtkNew<vtkStringArray> arrLabel;
+  arrLabel->SetName("Label");
+  table->AddColumn(arrLabel.GetPointer());
+
   // add few  points...
   int numPoints = 29;
   float inc = 7.0 / (numPoints-1);
@@ -76,6 +85,8 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
     table->SetValue(i, 0, i * inc);
     table->SetValue(i, 1, cos(i * inc) + 0.0);
     table->SetValue(i, 2, sin(i * inc) + 0.0);
+    table->SetValue(i, 3, i * 1000000);
+    table->SetValue(i, 4, i % 2 ? "it's \"odd\"" : "even");
     }
 
   tableNode->SetAndObserveTable(table.GetPointer());
@@ -97,7 +108,7 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
   // read table from the database
   storageNode->ReadData(tableNode.GetPointer());
 
-  if (tableNode->GetNumberOfColumns() != 3)
+  if (tableNode->GetNumberOfColumns() != 5)
     {
     std::cerr << "Unable to read table columns from the database " << storageNode->GetFileName() <<std::endl;
     removeFile(storageNode->GetFileName());
@@ -111,6 +122,26 @@ int vtkMRMLTableSQLiteStorageNodeTest(int , char * [] )
     return EXIT_FAILURE;
     }
 
+  // check column names, types and values
+  vtkTable* readTable = tableNode->GetTable();
+  CHECK_STRING(readTable->GetColumn(3)->GetName(), "Point index");
+  CHECK_BOOL(vtkStringArray::SafeDownCast(readTable->GetColumn(4)) != NULL, true);
+  CHECK_INT(readTable->GetValue(3, 3).ToInt(), 3000000);
+  CHECK_STD_STRING(readTable->GetValue(3, 4).ToString(), "it's \"odd\"");
+  CHECK_STD_STRING(readTable->GetValue(4, 4).ToString(), "even");
+  if (fabs(readTable->GetValue(5, 2).ToDouble() - sin(5 * inc)) > 1e-5)
+    {
+    std::cerr << "Unexpected value read from the database: " << readTable->GetValue(5, 2).ToDouble() << std::endl;
+    removeFile(storageNode->GetFileName());
+    return EXIT_FAILURE;
+    }
+
+  // overwrite the existing table
+  table->SetNumberOfRows(2);
+  storageNode->WriteData(tableNode.GetPointer());
+  storageNode->ReadData(tableNode.GetPointer());
+  CHECK_INT(tableNode->GetNumberOfRows(), 2);
+
   // clean up
   removeFile(storageNode->GetFileName());
 
@@ -0,0 +1,240 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLScene.h"
+#include "vtkMRMLTransformNode.h"
+
+// VTK includes
+#include <vtkGeneralTransform.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkThinPlateSplineTransform.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckPoint(vtkAbstractTransform* transform, const double point[3],
+                const double expected[3], double tolerance)
+{
+  double transformed[3] = { 0. };
+  transform->TransformPoint(point, transformed);
+  double error = sqrt(vtkMath::Distance2BetweenPoints(transformed, expected));
+  if (error > tolerance)
+    {
+    std::cerr << "Point (" << point[0] << ", " << point[1] << ", " << point[2]
+              << "): expected (" << expected[0] << ", " << expected[1] << ", " << expected[2]
+              << "), got (" << transformed[0] << ", " << transformed[1] << ", " << transformed[2]
+              << ")" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Apply the transforms to parent from node up to the world
+void TransformPointToWorld(vtkMRMLTransformNode* node, const double point[3], double result[3])
+{
+  result[0] = point[0];
+  result[1] = point[1];
+  result[2] = point[2];
+  for (; node != NULL; node = node->GetParentTransformNode())
+    {
+    node->GetTransformToParent()->TransformPoint(result, result);
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkMRMLTransformNodeTest2(int , char * [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+
+  // Thin plate spline displacing the center of a cube by 5mm along R
+  vtkNew<vtkPoints> sourceLandmarks;
+  vtkNew<vtkPoints> targetLandmarks;
+  for (int corner = 0; corner < 8; ++corner)
+    {
+    double x = (corner & 1) ? 50. : -50.;
+    double y = (corner & 2) ? 50. : -50.;
+    double z = (corner & 4) ? 50. : -50.;
+    sourceLandmarks->InsertNextPoint(x, y, z);
+    targetLandmarks->InsertNextPoint(x, y, z);
+    }
+  sourceLandmarks->InsertNextPoint(0., 0., 0.);
+  targetLandmarks->InsertNextPoint(5., 0., 0.);
+  vtkNew<vtkThinPlateSplineTransform> tps;
+  tps->SetSourceLandmarks(sourceLandmarks.GetPointer());
+  tps->SetTargetLandmarks(targetLandmarks.GetPointer());
+  tps->SetBasisToR();
+
+  // world <- warp <- translation <- rotation
+  vtkNew<vtkMRMLTransformNode> warpNode;
+  scene->AddNode(warpNode.GetPointer());
+  warpNode->SetAndObserveTransformToParent(tps.GetPointer());
+
+  vtkNew<vtkMRMLTransformNode> translationNode;
+  scene->AddNode(translationNode.GetPointer());
+  vtkNew<vtkMatrix4x4> translation;
+  translation->SetElement(0, 3, 10.);
+  translationNode->SetMatrixTransformToParent(translation.GetPointer());
+  translationNode->SetAndObserveTransformNodeID(warpNode->GetID());
+
+  vtkNew<vtkMRMLTransformNode> rotationNode;
+  scene->AddNode(rotationNode.GetPointer());
+  vtkNew<vtkTransform> rotation;
+  rotation->RotateZ(90.);
+  rotationNode->SetMatrixTransformToParent(rotation->GetMatrix());
+  rotationNode->SetAndObserveTransformNodeID(translationNode->GetID());
+
+  CHECK_BOOL(rotationNode->IsTransformToWorldLinear() != 0, false);
+  CHECK_BOOL(warpNode->IsTransformToWorldLinear() != 0, false);
+
+  // Transform to world matches the composition of the transforms to parent
+  const double point[3] = { 3.3, -7.1, 12.9 };
+  double expected[3] = { 0. };
+  TransformPointToWorld(rotationNode.GetPointer(), point, expected);
+  vtkNew<vtkGeneralTransform> rotationToWorld;
+  rotationNode->GetTransformToWorld(rotationToWorld.GetPointer());
+  CHECK_BOOL(CheckPoint(rotationToWorld.GetPointer(), point, expected, 1e-6), true);
+
+  vtkNew<vtkGeneralTransform> rotationFromWorld;
+  rotationNode->GetTransformFromWorld(rotationFromWorld.GetPointer());
+  CHECK_BOOL(CheckPoint(rotationFromWorld.GetPointer(), expected, point, 1e-3), true);
+
+  // Returned transforms follow changes of the transforms in the hierarchy
+  translation->SetElement(1, 3, -20.);
+  translationNode->SetMatrixTransformToParent(translation.GetPointer());
+  TransformPointToWorld(rotationNode.GetPointer(), point, expected);
+  CHECK_BOOL(CheckPoint(rotationToWorld.GetPointer(), point, expected, 1e-6), true);
+  vtkNew<vtkGeneralTransform> rotationToWorld2;
+  rotationNode->GetTransformToWorld(rotationToWorld2.GetPointer());
+  CHECK_BOOL(CheckPoint(rotationToWorld2.GetPointer(), point, expected, 1e-6), true);
+
+  // Grid approximation of the non-linear transform to world
+  const double bounds[6] = { -20., 20., -20., 20., -20., 20. };
+  const double tolerance = 0.05;
+  vtkAbstractTransform* grid = rotationNode->GetTransformToWorldGrid(bounds, tolerance);
+  CHECK_NOT_NULL(grid);
+  CHECK_BOOL(CheckPoint(grid, point, expected, 2. * tolerance), true);
+  CHECK_POINTER(rotationNode->GetTransformToWorldGrid(bounds, tolerance), grid);
+  // The error peaks around the center landmark of the spline, at (20, 10, 0)
+  // in the rotation node
+  for (int i = 0; i <= 80; ++i)
+    {
+    const double landmarkPoint[3] = { 16. + i * 0.05, 9.6 + i * 0.01, 0.3 };
+    double landmarkExpected[3] = { 0. };
+    TransformPointToWorld(rotationNode.GetPointer(), landmarkPoint, landmarkExpected);
+    CHECK_BOOL(CheckPoint(grid, landmarkPoint, landmarkExpected, 2. * tolerance), true);
+    }
+
+  vtkAbstractTransform* inverseGrid = warpNode->GetTransformFromWorldGrid(bounds, tolerance);
+  CHECK_NOT_NULL(inverseGrid);
+  double warped[3] = { 0. };
+  tps->TransformPoint(point, warped);
+  CHECK_BOOL(CheckPoint(inverseGrid, warped, point, 2. * tolerance), true);
+
+  // Grids of different bounds (e.g. two volumes under the transform) are
+  // kept, and a grid is reused for bounds it covers
+  const double otherBounds[6] = { 25., 45., -10., 10., -10., 10. };
+  vtkAbstractTransform* otherGrid = rotationNode->GetTransformToWorldGrid(otherBounds, tolerance);
+  CHECK_NOT_NULL(otherGrid);
+  CHECK_BOOL(otherGrid != grid, true);
+  CHECK_POINTER(rotationNode->GetTransformToWorldGrid(bounds, tolerance), grid);
+  CHECK_POINTER(rotationNode->GetTransformToWorldGrid(otherBounds, tolerance), otherGrid);
+  const double innerBounds[6] = { -10., 10., -10., 10., -10., 10. };
+  CHECK_POINTER(rotationNode->GetTransformToWorldGrid(innerBounds, 2. * tolerance), grid);
+  CHECK_POINTER(warpNode->GetTransformFromWorldGrid(bounds, tolerance), inverseGrid);
+
+  // Grids are recomputed when the hierarchy is modified
+  targetLandmarks->SetPoint(8, 8., 0., 0.);
+  tps->Modified();
+  TransformPointToWorld(rotationNode.GetPointer(), point, expected);
+  CHECK_BOOL(CheckPoint(rotationToWorld.GetPointer(), point, expected, 1e-6), true);
+  grid = rotationNode->GetTransformToWorldGrid(bounds, tolerance);
+  CHECK_NOT_NULL(grid);
+  CHECK_BOOL(CheckPoint(grid, point, expected, 2. * tolerance), true);
+
+  // Moving the rotation to the world makes it linear
+  rotationNode->SetAndObserveTransformNodeID(NULL);
+  CHECK_BOOL(rotationNode->IsTransformToWorldLinear() != 0, true);
+  CHECK_NULL(rotationNode->GetTransformToWorldGrid(bounds, tolerance));
+  rotationNode->GetTransformToWorld(rotationToWorld.GetPointer());
+  rotation->TransformPoint(point, expected);
+  CHECK_BOOL(CheckPoint(rotationToWorld.GetPointer(), point, expected, 1e-6), true);
+
+  // Linear hierarchy: world <- translation <- rotation
+  translationNode->SetAndObserveTransformNodeID(NULL);
+  rotationNode->SetAndObserveTransformNodeID(translationNode->GetID());
+  CHECK_BOOL(rotationNode->IsTransformToWorldLinear() != 0, true);
+  vtkNew<vtkMatrix4x4> toWorld;
+  CHECK_INT(rotationNode->GetMatrixTransformToWorld(toWorld.GetPointer()), 1);
+  vtkNew<vtkMatrix4x4> expectedToWorld;
+  vtkMatrix4x4::Multiply4x4(translation.GetPointer(), rotation->GetMatrix(), expectedToWorld.GetPointer());
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      CHECK_BOOL(fabs(toWorld->GetElement(row, column) - expectedToWorld->GetElement(row, column)) < 1e-6, true);
+      }
+    }
+  vtkNew<vtkMatrix4x4> fromWorld;
+  CHECK_INT(rotationNode->GetMatrixTransformFromWorld(fromWorld.GetPointer()), 1);
+  vtkNew<vtkMatrix4x4> identity;
+  vtkMatrix4x4::Multiply4x4(toWorld.GetPointer(), fromWorld.GetPointer(), identity.GetPointer());
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      CHECK_BOOL(fabs(identity->GetElement(row, column) - (row == column ? 1. : 0.)) < 1e-6, true);
+      }
+    }
+
+  // General transforms of linear transforms are linear:
+  // world <- translation <- general (rotation, scaling)
+  vtkNew<vtkGeneralTransform> generalTransform;
+  generalTransform->PostMultiply();
+  generalTransform->Concatenate(rotation.GetPointer());
+  vtkNew<vtkTransform> scaling;
+  scaling->Scale(2., 2., 2.);
+  generalTransform->Concatenate(scaling.GetPointer());
+  vtkNew<vtkMRMLTransformNode> generalNode;
+  scene->AddNode(generalNode.GetPointer());
+  generalNode->SetAndObserveTransformToParent(generalTransform.GetPointer());
+  generalNode->SetAndObserveTransformNodeID(translationNode->GetID());
+  CHECK_BOOL(generalNode->IsTransformToWorldLinear() != 0, true);
+  CHECK_INT(generalNode->GetMatrixTransformToWorld(toWorld.GetPointer()), 1);
+  vtkNew<vtkTransform> generalToWorld;
+  generalToWorld->SetMatrix(toWorld.GetPointer());
+  TransformPointToWorld(generalNode.GetPointer(), point, expected);
+  CHECK_BOOL(CheckPoint(generalToWorld.GetPointer(), point, expected, 1e-6), true);
+  CHECK_INT(generalNode->GetMatrixTransformFromWorld(fromWorld.GetPointer()), 1);
+
+  // Concatenating a non-linear transform makes it non-linear
+  generalTransform->Concatenate(tps.GetPointer());
+  CHECK_BOOL(generalNode->IsTransformToWorldLinear() != 0, false);
+  vtkNew<vtkGeneralTransform> generalToWorld2;
+  generalNode->GetTransformToWorld(generalToWorld2.GetPointer());
+  TransformPointToWorld(generalNode.GetPointer(), point, expected);
+  CHECK_BOOL(CheckPoint(generalToWorld2.GetPointer(), point, expected, 1e-6), true);
+
+  return EXIT_SUCCESS;
+}
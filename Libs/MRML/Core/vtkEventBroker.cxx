@@ -19,11 +19,127 @@
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkCollection.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
 #include <vtkObjectFactory.h>
 #include <vtkTimerLog.h>
 
+// STD includes
+#include <cstdio>
+#include <sstream>
+
+#if defined(_WIN32)
+# include <vtkWindows.h>
+#elif defined(__APPLE__)
+# include <mach/mach_time.h>
+#else
+# include <time.h>
+#endif
+
 vtkCxxSetObjectMacro(vtkEventBroker, TimerLog, vtkTimerLog);
 
+//----------------------------------------------------------------------------
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Seconds since an arbitrary origin, never decreasing, unlike the
+// universal time of vtkTimerLog.
+double GetMonotonicTime()
+{
+#if defined(_WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / static_cast<double>(frequency.QuadPart);
+#elif defined(__APPLE__)
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0)
+    {
+    mach_timebase_info(&timebase);
+    }
+  return static_cast<double>(mach_absolute_time()) * timebase.numer / timebase.denom * 1e-9;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void WriteJSONString(std::ostream& os, const std::string& str)
+{
+  os << '"';
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+    {
+    unsigned char c = static_cast<unsigned char>(*it);
+    if (c == '"' || c == '\\')
+      {
+      os << '\\' << *it;
+      }
+    else if (c < 0x20)
+      {
+      char escaped[8];
+      sprintf(escaped, "\\u%04x", c);
+      os << escaped;
+      }
+    else
+      {
+      os << *it;
+      }
+    }
+  os << '"';
+}
+
+}
+
+//----------------------------------------------------------------------------
+class vtkEventBroker::vtkTraceInternals
+{
+public:
+  struct TraceEvent
+    {
+    std::string Name;
+    std::string Category;
+    std::string Args;
+    char Phase;
+    double Time;
+    int Thread;
+    };
+
+  vtkTraceInternals()
+    {
+    this->StartTime = 0.;
+    this->NumberOfDroppedEvents = 0;
+    }
+
+  /// Index of the current thread in Threads, must be called with Lock locked
+  int GetCurrentThreadIndex()
+    {
+    vtkMultiThreaderIDType threadID = vtkMultiThreader::GetCurrentThreadID();
+    for (size_t i = 0; i < this->Threads.size(); ++i)
+      {
+      if (vtkMultiThreader::ThreadsEqual(this->Threads[i], threadID))
+        {
+        return static_cast<int>(i);
+        }
+      }
+    this->Threads.push_back(threadID);
+    return static_cast<int>(this->Threads.size()) - 1;
+    }
+
+  vtkSimpleMutexLock Lock;
+  double StartTime;
+  std::vector<TraceEvent> Events;
+  std::vector<vtkMultiThreaderIDType> Threads;
+  /// For each thread, whether the begin of each open section was recorded.
+  /// Ends are only recorded for recorded begins, so that the trace stays
+  /// balanced when tracing starts inside a section or the buffer is full.
+  std::vector<std::vector<bool> > OpenSections;
+  int NumberOfDroppedEvents;
+};
+
 //----------------------------------------------------------------------------
 // The IO manager singleton.
 // This MUST be default initialized to zero by the compiler and is
@@ -98,6 +214,9 @@ vtkEventBroker::vtkEventBroker()
   this->LogFileName = NULL;
   this->ScriptHandler = NULL;
   this->ScriptHandlerClientData = NULL;
+  this->Tracing = false;
+  this->MaximumNumberOfTraceEvents = 1000000;
+  this->TraceInternals = new vtkTraceInternals;
 }
 
 //----------------------------------------------------------------------------
@@ -117,6 +236,12 @@ vtkEventBroker::~vtkEventBroker()
     {
     this->TimerLog->Delete();
     }
+
+  if (this->Tracing)
+    {
+    this->StopTracing();
+    }
+  delete this->TraceInternals;
   //cout << "vtkEventBroker singleton Deleted" << endl;
 }
 
@@ -668,6 +793,199 @@ void vtkEventBroker::LogEvent ( vtkObservation *observation )
     }
 }
 
+//----------------------------------------------------------------------------
+void vtkEventBroker::StartTracing(const char* fileName)
+{
+  if (!fileName)
+    {
+    vtkErrorMacro("StartTracing: invalid file name");
+    return;
+    }
+  this->TraceInternals->Lock.Lock();
+  this->TraceFileName = fileName;
+  this->TraceInternals->Events.clear();
+  this->TraceInternals->Threads.clear();
+  this->TraceInternals->OpenSections.clear();
+  this->TraceInternals->NumberOfDroppedEvents = 0;
+  // the thread that starts tracing is listed first
+  this->TraceInternals->GetCurrentThreadIndex();
+  this->TraceInternals->StartTime = GetMonotonicTime();
+  this->Tracing = true;
+  this->TraceInternals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkEventBroker::StopTracing()
+{
+  if (!this->Tracing)
+    {
+    return false;
+    }
+  this->TraceInternals->Lock.Lock();
+  this->Tracing = false;
+  std::vector<vtkTraceInternals::TraceEvent> events;
+  events.swap(this->TraceInternals->Events);
+  int numberOfThreads = static_cast<int>(this->TraceInternals->Threads.size());
+  int numberOfDroppedEvents = this->TraceInternals->NumberOfDroppedEvents;
+  this->TraceInternals->OpenSections.clear();
+  this->TraceInternals->Lock.Unlock();
+
+  if (numberOfDroppedEvents > 0)
+    {
+    vtkWarningMacro("StopTracing: " << numberOfDroppedEvents << " sections were not recorded, "
+                    "the trace reached MaximumNumberOfTraceEvents = " << this->MaximumNumberOfTraceEvents);
+    }
+
+  std::ofstream file(this->TraceFileName.c_str(), std::ios::out);
+  if (!file.is_open())
+    {
+    vtkErrorMacro("StopTracing: failed to open " << this->TraceFileName);
+    return false;
+    }
+  // timestamps are in microseconds
+  file.precision(3);
+  file << std::fixed;
+  file << "{\"traceEvents\":[\n";
+  for (int thread = 0; thread < numberOfThreads; ++thread)
+    {
+    file << (thread > 0 ? ",\n" : "")
+         << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+         << ",\"args\":{\"name\":\"" << (thread == 0 ? "Main" : "Thread ") ;
+    if (thread > 0)
+      {
+      file << thread;
+      }
+    file << "\"}}";
+    }
+  for (std::vector<vtkTraceInternals::TraceEvent>::const_iterator it = events.begin();
+       it != events.end(); ++it)
+    {
+    file << ",\n{\"ph\":\"" << it->Phase << "\",\"ts\":" << it->Time * 1e6
+         << ",\"pid\":1,\"tid\":" << it->Thread;
+    if (it->Phase != 'E')
+      {
+      file << ",\"name\":";
+      WriteJSONString(file, it->Name);
+      file << ",\"cat\":";
+      WriteJSONString(file, it->Category);
+      if (!it->Args.empty())
+        {
+        file << ",\"args\":" << it->Args;
+        }
+      }
+    file << "}";
+    }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  file.close();
+  return !file.fail();
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::TraceBegin(const char* name, const char* category, const char* args)
+{
+  if (!this->Tracing)
+    {
+    return;
+    }
+  vtkTraceInternals::TraceEvent event;
+  event.Name = (name ? name : "");
+  event.Category = (category ? category : "");
+  event.Args = (args ? args : "");
+  event.Phase = 'B';
+  this->TraceInternals->Lock.Lock();
+  event.Time = GetMonotonicTime() - this->TraceInternals->StartTime;
+  event.Thread = this->TraceInternals->GetCurrentThreadIndex();
+  if (static_cast<int>(this->TraceInternals->OpenSections.size()) <= event.Thread)
+    {
+    this->TraceInternals->OpenSections.resize(event.Thread + 1);
+    }
+  // the ends of the open sections are recorded even if the buffer is full
+  bool recorded = (static_cast<int>(this->TraceInternals->Events.size()) < this->MaximumNumberOfTraceEvents);
+  if (recorded)
+    {
+    this->TraceInternals->Events.push_back(event);
+    }
+  else
+    {
+    this->TraceInternals->NumberOfDroppedEvents++;
+    }
+  this->TraceInternals->OpenSections[event.Thread].push_back(recorded);
+  this->TraceInternals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::TraceEnd()
+{
+  if (!this->Tracing)
+    {
+    return;
+    }
+  vtkTraceInternals::TraceEvent event;
+  event.Phase = 'E';
+  this->TraceInternals->Lock.Lock();
+  event.Time = GetMonotonicTime() - this->TraceInternals->StartTime;
+  event.Thread = this->TraceInternals->GetCurrentThreadIndex();
+  bool beginRecorded = false;
+  if (static_cast<int>(this->TraceInternals->OpenSections.size()) > event.Thread &&
+      !this->TraceInternals->OpenSections[event.Thread].empty())
+    {
+    // no open section if the section started before tracing
+    beginRecorded = this->TraceInternals->OpenSections[event.Thread].back();
+    this->TraceInternals->OpenSections[event.Thread].pop_back();
+    }
+  if (beginRecorded)
+    {
+    this->TraceInternals->Events.push_back(event);
+    }
+  this->TraceInternals->Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkEventBroker::GetNumberOfDroppedTraceEvents()
+{
+  this->TraceInternals->Lock.Lock();
+  int numberOfDroppedEvents = this->TraceInternals->NumberOfDroppedEvents;
+  this->TraceInternals->Lock.Unlock();
+  return numberOfDroppedEvents;
+}
+
+//----------------------------------------------------------------------------
+int vtkEventBroker::GetNumberOfTraceEvents()
+{
+  this->TraceInternals->Lock.Lock();
+  int numberOfEvents = static_cast<int>(this->TraceInternals->Events.size());
+  this->TraceInternals->Lock.Unlock();
+  return numberOfEvents;
+}
+
+//----------------------------------------------------------------------------
+void vtkEventBroker::TraceObservationBegin(vtkObservation *observation, unsigned long eid)
+{
+  std::string eventName = vtkCommand::GetStringFromEventId(eid);
+  if (eventName == "NoEvent")
+    {
+    std::stringstream ss;
+    ss << eid;
+    eventName = ss.str();
+    }
+  std::stringstream args;
+  args << "{\"subject\":";
+  WriteJSONString(args, observation->GetSubject() ?
+    observation->GetSubject()->GetClassName() : "");
+  args << ",\"observer\":";
+  if (observation->GetScript() != NULL)
+    {
+    WriteJSONString(args, observation->GetScript());
+    }
+  else
+    {
+    WriteJSONString(args, observation->GetObserver() ?
+      observation->GetObserver()->GetClassName() : "No observer class");
+    }
+  args << ",\"eventId\":" << eid << "}";
+  this->TraceBegin(eventName.c_str(), "event", args.str().c_str());
+}
+
 //----------------------------------------------------------------------------
 void vtkEventBroker::ProcessEvent ( vtkObservation *observation, vtkObject *caller, unsigned long eid, void *callData )
 {
@@ -812,6 +1130,12 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
 {
   this->EventNestingLevel++;
 
+  bool tracing = this->Tracing;
+  if (tracing)
+    {
+    this->TraceObservationBegin(observation, eid);
+    }
+
   double startTime = this->TimerLog->GetUniversalTime();
 
   // Register so observation won't be deleted while callback is running
@@ -842,6 +1166,10 @@ void vtkEventBroker::InvokeObservation ( vtkObservation *observation,
   observation->SetTotalElapsedTime (observation->GetTotalElapsedTime() + elapsedTime);
   observation->SetLastElapsedTime (elapsedTime);
   this->LogEvent (observation);
+  if (tracing)
+    {
+    this->TraceEnd();
+    }
 
   // clear reference to observation (may cause delete)
   observation->Delete();
@@ -894,6 +1222,28 @@ void vtkEventBroker::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "EventNestingLevel: " << this->EventNestingLevel << "\n";
   os << indent << "LogFileName: " <<
     (this->LogFileName ? this->LogFileName : "(none)") << "\n";
+  os << indent << "Tracing: " << this->Tracing << "\n";
+  os << indent << "MaximumNumberOfTraceEvents: " << this->MaximumNumberOfTraceEvents << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkEventBrokerTraceScope::vtkEventBrokerTraceScope(const char* name, const char* category, const char* args)
+{
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  this->Active = broker->GetTracing();
+  if (this->Active)
+    {
+    broker->TraceBegin(name, category, args);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkEventBrokerTraceScope::~vtkEventBrokerTraceScope()
+{
+  if (this->Active)
+    {
+    vtkEventBroker::GetInstance()->TraceEnd();
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -27,6 +27,7 @@ class vtkTimerLog;
 #include <vector>
 #include <set>
 #include <map>
+#include <string>
 #include <fstream>
 
 class vtkCollection;
@@ -173,6 +174,52 @@ public:
   /// Write out the current list of observations in graphviz format (.dot)
   int GenerateGraphFile ( const char *graphFile );
 
+  /// Performance tracing
+  ///
+  /// While tracing, the invocations of the observations (nested when an
+  /// observer triggers other events), the scene states, the displayable
+  /// manager updates and the renders are recorded in memory with a
+  /// monotonic timestamp and the thread that ran them.
+  /// StopTracing() writes the records to \a fileName in the Chrome trace
+  /// event format (JSON), that can be opened in chrome://tracing or
+  /// https://ui.perfetto.dev to follow the chains of events and find the
+  /// event storms that cost frames.
+  /// From python:
+  /// \code
+  /// slicer.vtkEventBroker.GetInstance().StartTracing("/tmp/slicer-trace.json")
+  /// ...
+  /// slicer.vtkEventBroker.GetInstance().StopTracing()
+  /// \endcode
+  /// \sa TraceBegin(), vtkEventBrokerTraceScope
+  void StartTracing(const char* fileName);
+  /// Stop recording and write the trace file.
+  /// Returns false if not tracing or if the file can't be written.
+  bool StopTracing();
+  bool GetTracing() { return this->Tracing; }
+
+  /// Record the beginning and the end of a traced section of code on the
+  /// current thread. Sections must be nested. \a args is an optional JSON
+  /// object, e.g. "{\"node\": \"vtkMRMLScalarVolumeNode1\"}", displayed
+  /// with the section. Does nothing if not tracing.
+  /// An end is only recorded if the matching begin was recorded: sections
+  /// that started before StartTracing() or when the buffer was full are
+  /// left out of the trace.
+  /// Thread safe.
+  void TraceBegin(const char* name, const char* category, const char* args = NULL);
+  void TraceEnd();
+
+  /// Number of records since tracing started
+  int GetNumberOfTraceEvents();
+
+  /// Maximum number of records kept in memory while tracing, 1000000 by
+  /// default (about 100MB). When it is reached, new sections are not
+  /// recorded anymore, the ends of the open sections still are.
+  vtkSetMacro(MaximumNumberOfTraceEvents, int);
+  vtkGetMacro(MaximumNumberOfTraceEvents, int);
+
+  /// Number of sections that were not recorded because the buffer was full
+  int GetNumberOfDroppedTraceEvents();
+
 
   /// Event Queue processing modes
   ///
@@ -287,6 +334,14 @@ protected:
   int CompressCallData;
 
   std::ofstream LogFile;
+
+  void TraceObservationBegin(vtkObservation *observation, unsigned long eid);
+
+  bool Tracing;
+  int MaximumNumberOfTraceEvents;
+  std::string TraceFileName;
+  class vtkTraceInternals;
+  vtkTraceInternals* TraceInternals;
 private:
   /// DetachObservations is a fast (but dangerous) method to delete all the
   /// observations. It leaves the event broker in an inconsistent state:
@@ -296,6 +351,24 @@ private:
   friend class vtkObservation;
 };
 
+/// \brief Trace a section of code until the end of the scope.
+///
+/// Does nothing if vtkEventBroker is not tracing.
+/// \code
+/// vtkEventBrokerTraceScope trace("UpdateFromMRML", "displayable manager");
+/// \endcode
+/// \sa vtkEventBroker::StartTracing()
+class VTK_MRML_EXPORT vtkEventBrokerTraceScope
+{
+public:
+  vtkEventBrokerTraceScope(const char* name, const char* category, const char* args = NULL);
+  ~vtkEventBrokerTraceScope();
+private:
+  vtkEventBrokerTraceScope(const vtkEventBrokerTraceScope&);
+  void operator=(const vtkEventBrokerTraceScope&);
+  bool Active;
+};
+
 /// Utility class to make sure qSlicerModuleManager is initialized before it is used.
 class VTK_MRML_EXPORT vtkEventBrokerInitialize
 {
@@ -0,0 +1,450 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#include "vtkImageDataCopyOnWrite.h"
+
+// VTK includes
+#include <vtkCellData.h>
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMutexLock.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkVersion.h>
+
+// STD includes
+#include <cstring>
+#include <map>
+#include <sstream>
+
+// Arrays can release memory they do not own (VTK_DATA_ARRAY_USER_DEFINED
+// and vtkDataArray::SetArrayFreeFunction()) since VTK 8.1, arrays are deep
+// copied with earlier versions.
+#if VTK_MAJOR_VERSION >= 9 || (VTK_MAJOR_VERSION >= 8 && VTK_MINOR_VERSION >= 1)
+# define SLICER_COPY_ON_WRITE_ARRAYS
+#endif
+
+#ifdef SLICER_COPY_ON_WRITE_ARRAYS
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Arrays smaller than 1 MB are not worth a shared memory object
+const vtkIdType MINIMUM_SHARED_SIZE = 1 << 20;
+
+#ifdef SLICER_COPY_ON_WRITE_ARRAYS
+
+#ifdef _WIN32
+typedef HANDLE SharedMemoryHandle;
+const SharedMemoryHandle INVALID_SHARED_MEMORY = NULL;
+#else
+typedef int SharedMemoryHandle;
+const SharedMemoryHandle INVALID_SHARED_MEMORY = -1;
+#endif
+
+//----------------------------------------------------------------------------
+/// Create an anonymous shared memory object of the given size.
+SharedMemoryHandle CreateSharedMemory(size_t size)
+{
+#ifdef _WIN32
+  unsigned long long size64 = size;
+  // Backed by the paging file, the whole size is committed here
+  return CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+    static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64 & 0xffffffff), NULL);
+#else
+  static unsigned int counter = 0;
+  std::ostringstream name;
+  name << "/slicercow-" << getpid() << "-" << counter++;
+  int handle = shm_open(name.str().c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (handle < 0)
+    {
+    return INVALID_SHARED_MEMORY;
+    }
+  // The object lives as long as it is open or mapped
+  shm_unlink(name.str().c_str());
+  bool allocated = (ftruncate(handle, static_cast<off_t>(size)) == 0);
+# ifdef __linux__
+  // Reserve the pages now: running out of shared memory while writing
+  // through a mapping would raise SIGBUS.
+  allocated = allocated && (posix_fallocate(handle, 0, static_cast<off_t>(size)) == 0);
+# endif
+  if (!allocated)
+    {
+    ::close(handle);
+    return INVALID_SHARED_MEMORY;
+    }
+  return handle;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void CloseSharedMemory(SharedMemoryHandle handle)
+{
+#ifdef _WIN32
+  CloseHandle(handle);
+#else
+  ::close(handle);
+#endif
+}
+
+//----------------------------------------------------------------------------
+/// Map the shared memory object. Writes through a copy-on-write mapping are
+/// private to the mapping. Return NULL on failure.
+void* MapSharedMemory(SharedMemoryHandle handle, size_t size, bool copyOnWrite)
+{
+#ifdef _WIN32
+  return MapViewOfFile(handle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_WRITE, 0, 0, size);
+#else
+  void* data = mmap(0, size, PROT_READ | PROT_WRITE, copyOnWrite ? MAP_PRIVATE : MAP_SHARED, handle, 0);
+  return data == MAP_FAILED ? NULL : data;
+#endif
+}
+
+//----------------------------------------------------------------------------
+void UnmapSharedMemory(void* data, size_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+//----------------------------------------------------------------------------
+struct SharedBuffer
+{
+  SharedBuffer()
+    : Handle(INVALID_SHARED_MEMORY), Size(0), NumberOfViews(0)
+    {}
+  SharedMemoryHandle Handle;
+  size_t Size;
+  int NumberOfViews;
+};
+
+//----------------------------------------------------------------------------
+/// Array whose content was identical to a shared buffer when it was last
+/// copied. The array may have been written since: raw pointer writes do not
+/// change its MTime, so the content is compared before the buffer is reused.
+struct SharedSource
+{
+  SharedSource()
+    : Buffer(NULL), Pointer(NULL)
+    {}
+  SharedSource(SharedBuffer* buffer, void* pointer)
+    : Buffer(buffer), Pointer(pointer)
+    {}
+  SharedBuffer* Buffer;
+  void* Pointer;
+};
+
+//----------------------------------------------------------------------------
+struct Registry
+{
+  vtkSimpleMutexLock Lock;
+  /// Copy-on-write mappings, by address
+  std::map<void*, SharedBuffer*> Views;
+  /// Arrays that can be copied by mapping a buffer again
+  std::map<vtkDataArray*, SharedSource> Sources;
+};
+
+//----------------------------------------------------------------------------
+Registry& GetRegistry()
+{
+  // Never deleted: arrays may be released after static destructors ran
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+//----------------------------------------------------------------------------
+/// Close the buffer and forget the arrays it was shared with.
+/// Must be called with the registry locked.
+void DeleteSharedBuffer(Registry& registry, SharedBuffer* buffer)
+{
+  std::map<vtkDataArray*, SharedSource>::iterator sourceIt = registry.Sources.begin();
+  while (sourceIt != registry.Sources.end())
+    {
+    if (sourceIt->second.Buffer == buffer)
+      {
+      registry.Sources.erase(sourceIt++);
+      }
+    else
+      {
+      ++sourceIt;
+      }
+    }
+  CloseSharedMemory(buffer->Handle);
+  delete buffer;
+}
+
+//----------------------------------------------------------------------------
+/// Return true if the buffer holds the given content.
+bool HasContent(SharedBuffer* buffer, const void* pointer, size_t size)
+{
+  if (buffer->Size != size)
+    {
+    return false;
+    }
+  // Private mapping only read: no page is copied
+  void* data = MapSharedMemory(buffer->Handle, size, true);
+  if (!data)
+    {
+    return false;
+    }
+  bool same = (memcmp(data, pointer, size) == 0);
+  UnmapSharedMemory(data, size);
+  return same;
+}
+
+//----------------------------------------------------------------------------
+/// Return a buffer holding the content of the array, reusing the buffer the
+/// array was copied to or from if the array still has the same content.
+/// The memory of the array is only read: callers may hold pointers to it.
+/// Must be called with the registry locked.
+SharedBuffer* GetSharedBuffer(Registry& registry, vtkDataArray* array, size_t size)
+{
+  void* pointer = array->GetVoidPointer(0);
+  std::map<vtkDataArray*, SharedSource>::iterator sourceIt = registry.Sources.find(array);
+  if (sourceIt != registry.Sources.end()
+    && sourceIt->second.Pointer == pointer
+    && HasContent(sourceIt->second.Buffer, pointer, size))
+    {
+    return sourceIt->second.Buffer;
+    }
+
+  SharedMemoryHandle handle = CreateSharedMemory(size);
+  if (handle == INVALID_SHARED_MEMORY)
+    {
+    return NULL;
+    }
+  void* data = MapSharedMemory(handle, size, false);
+  if (!data)
+    {
+    CloseSharedMemory(handle);
+    return NULL;
+    }
+  memcpy(data, pointer, size);
+  UnmapSharedMemory(data, size);
+
+  SharedBuffer* buffer = new SharedBuffer;
+  buffer->Handle = handle;
+  buffer->Size = size;
+  registry.Sources[array] = SharedSource(buffer, pointer);
+  return buffer;
+}
+
+//----------------------------------------------------------------------------
+/// Free function of the copy-on-write arrays.
+void ReleaseView(void* data)
+{
+  Registry& registry = GetRegistry();
+  registry.Lock.Lock();
+  std::map<void*, SharedBuffer*>::iterator viewIt = registry.Views.find(data);
+  if (viewIt == registry.Views.end())
+    {
+    registry.Lock.Unlock();
+    return;
+    }
+  SharedBuffer* buffer = viewIt->second;
+  registry.Views.erase(viewIt);
+  UnmapSharedMemory(data, buffer->Size);
+
+  // The array that owned the mapping is deleted or reallocated
+  std::map<vtkDataArray*, SharedSource>::iterator sourceIt = registry.Sources.begin();
+  while (sourceIt != registry.Sources.end())
+    {
+    if (sourceIt->second.Pointer == data)
+      {
+      registry.Sources.erase(sourceIt++);
+      }
+    else
+      {
+      ++sourceIt;
+      }
+    }
+
+  if (--buffer->NumberOfViews == 0)
+    {
+    DeleteSharedBuffer(registry, buffer);
+    }
+  registry.Lock.Unlock();
+}
+
+//----------------------------------------------------------------------------
+/// Return a new array mapping the content of the array copy-on-write, or
+/// NULL if the array can not be shared.
+vtkDataArray* NewCopyOnWriteArray(vtkDataArray* array)
+{
+  if (!array->HasStandardMemoryLayout() || array->GetDataType() == VTK_BIT)
+    {
+    return NULL;
+    }
+  vtkIdType numberOfValues = array->GetNumberOfValues();
+  vtkIdType size = numberOfValues * array->GetDataTypeSize();
+  if (size < MINIMUM_SHARED_SIZE)
+    {
+    return NULL;
+    }
+
+  Registry& registry = GetRegistry();
+  registry.Lock.Lock();
+  SharedBuffer* buffer = GetSharedBuffer(registry, array, static_cast<size_t>(size));
+  void* view = (buffer ? MapSharedMemory(buffer->Handle, buffer->Size, true) : NULL);
+  if (view)
+    {
+    ++buffer->NumberOfViews;
+    registry.Views[view] = buffer;
+    }
+  else if (buffer && buffer->NumberOfViews == 0)
+    {
+    DeleteSharedBuffer(registry, buffer);
+    }
+  registry.Lock.Unlock();
+  if (!view)
+    {
+    return NULL;
+    }
+
+  vtkDataArray* copy = array->NewInstance();
+  copy->SetName(array->GetName());
+  copy->SetNumberOfComponents(array->GetNumberOfComponents());
+  copy->CopyComponentNames(array);
+  copy->SetVoidArray(view, numberOfValues, 0, VTK_DATA_ARRAY_USER_DEFINED);
+  copy->SetArrayFreeFunction(ReleaseView);
+
+  // Copies of the copy map the same buffer until the copy is written: the
+  // voxels of a copy that is copied again are stored only once.
+  registry.Lock.Lock();
+  registry.Sources[copy] = SharedSource(buffer, view);
+  registry.Lock.Unlock();
+  return copy;
+}
+#endif
+
+//----------------------------------------------------------------------------
+void CopyAttributes(vtkDataSetAttributes* source, vtkDataSetAttributes* target)
+{
+  target->Initialize();
+  for (int i = 0; i < source->GetNumberOfArrays(); ++i)
+    {
+    vtkAbstractArray* array = source->GetAbstractArray(i);
+    vtkSmartPointer<vtkAbstractArray> copy;
+    vtkDataArray* dataArray = vtkDataArray::SafeDownCast(array);
+    if (dataArray)
+      {
+      copy.TakeReference(vtkImageDataCopyOnWrite::NewCopy(dataArray));
+      }
+    else
+      {
+      copy.TakeReference(array->NewInstance());
+      copy->DeepCopy(array);
+      }
+    int index = target->AddArray(copy);
+    int attribute = source->IsArrayAnAttribute(i);
+    if (attribute >= 0)
+      {
+      target->SetActiveAttribute(index, attribute);
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageDataCopyOnWrite);
+
+//----------------------------------------------------------------------------
+void vtkImageDataCopyOnWrite::Copy(vtkImageData* source, vtkImageData* target)
+{
+  if (!source || !target || source == target)
+    {
+    return;
+    }
+  // Geometry and information, the arrays are replaced below
+  target->vtkImageData::ShallowCopy(source);
+  CopyAttributes(source->GetPointData(), target->GetPointData());
+  CopyAttributes(source->GetCellData(), target->GetCellData());
+  target->GetFieldData()->DeepCopy(source->GetFieldData());
+}
+
+//----------------------------------------------------------------------------
+vtkDataArray* vtkImageDataCopyOnWrite::NewCopy(vtkDataArray* array)
+{
+  if (!array)
+    {
+    return NULL;
+    }
+  vtkDataArray* copy = NULL;
+#ifdef SLICER_COPY_ON_WRITE_ARRAYS
+  copy = NewCopyOnWriteArray(array);
+#endif
+  if (!copy)
+    {
+    copy = array->NewInstance();
+    copy->DeepCopy(array);
+    }
+  return copy;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageDataCopyOnWrite::IsCopyOnWrite(vtkDataArray* array)
+{
+#ifdef SLICER_COPY_ON_WRITE_ARRAYS
+  if (!array || !array->HasStandardMemoryLayout())
+    {
+    return false;
+    }
+  Registry& registry = GetRegistry();
+  registry.Lock.Lock();
+  bool copyOnWrite = (registry.Views.find(array->GetVoidPointer(0)) != registry.Views.end());
+  registry.Lock.Unlock();
+  return copyOnWrite;
+#else
+  (void)array;
+  return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+int vtkImageDataCopyOnWrite::GetNumberOfSharedBuffers()
+{
+#ifndef SLICER_COPY_ON_WRITE_ARRAYS
+  return 0;
+#else
+  Registry& registry = GetRegistry();
+  registry.Lock.Lock();
+  std::map<SharedBuffer*, bool> buffers;
+  for (std::map<void*, SharedBuffer*>::iterator viewIt = registry.Views.begin();
+    viewIt != registry.Views.end(); ++viewIt)
+    {
+    buffers[viewIt->second] = true;
+    }
+  registry.Lock.Unlock();
+  return static_cast<int>(buffers.size());
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImageDataCopyOnWrite::GetMinimumSharedSize()
+{
+  return MINIMUM_SHARED_SIZE;
+}
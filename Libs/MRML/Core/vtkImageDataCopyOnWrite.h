@@ -0,0 +1,81 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageDataCopyOnWrite_h
+#define __vtkImageDataCopyOnWrite_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkDataArray;
+class vtkImageData;
+
+/// \brief Copy images without copying their voxels until they are written.
+///
+/// Copy() is a replacement for vtkImageData::DeepCopy() where the data arrays
+/// of the copy share the memory of the source arrays copy-on-write: the
+/// voxels are stored once in a shared memory object and each copy is a
+/// private mapping of that object. The operating system copies a page
+/// (typically 4 KB) of voxels the first time it is written through a copy,
+/// so the memory used by a copy is proportional to the voxels that are
+/// actually modified. Writes made through a copy are never visible in the
+/// source or in other copies, and the arrays can be used by any VTK filter.
+///
+/// The source is never modified: the first copy of an array copies its
+/// voxels to the shared memory object, which costs one memcpy, and the
+/// source keeps its own memory, so pointers to it (e.g. numpy arrays from
+/// slicer.util.arrayFromVolume()) remain valid. Later copies of the same
+/// array, and copies of copies, reuse the object as long as the array
+/// content did not change since its last copy: the voxels of a copy that is
+/// copied again are stored only once. The content
+/// is compared, not the MTime, because writes through GetScalarPointer() or
+/// numpy do not modify the array: a reused copy costs one memcmp and no
+/// memory, a changed array is moved to a new shared memory object.
+/// Arrays smaller than GetMinimumSharedSize() bytes, non-contiguous arrays
+/// and arrays that can not be mapped (e.g. out of shared memory) are deep
+/// copied, as are all the arrays with VTK older than 8.1.
+class VTK_MRML_EXPORT vtkImageDataCopyOnWrite : public vtkObject
+{
+public:
+  static vtkImageDataCopyOnWrite *New();
+  vtkTypeMacro(vtkImageDataCopyOnWrite,vtkObject);
+
+  /// Make \a target a copy of \a source, with the same geometry, point data,
+  /// cell data and field data. Data arrays are shared copy-on-write when
+  /// possible and deep copied otherwise. \a source is not modified.
+  static void Copy(vtkImageData* source, vtkImageData* target);
+
+  /// Return a new copy of \a array, shared copy-on-write if possible and
+  /// deep copied otherwise. The caller owns the returned reference.
+  static vtkDataArray* NewCopy(vtkDataArray* array);
+
+  /// Return true if the memory of \a array is a copy-on-write mapping.
+  static bool IsCopyOnWrite(vtkDataArray* array);
+
+  /// Number of shared memory objects currently used by copy-on-write arrays.
+  static int GetNumberOfSharedBuffers();
+
+  /// Arrays smaller than this number of bytes are deep copied.
+  static vtkIdType GetMinimumSharedSize();
+
+protected:
+  vtkImageDataCopyOnWrite() {}
+  virtual ~vtkImageDataCopyOnWrite() {}
+
+private:
+  vtkImageDataCopyOnWrite(const vtkImageDataCopyOnWrite&);  // Not implemented.
+  void operator=(const vtkImageDataCopyOnWrite&);  // Not implemented.
+};
+
+#endif
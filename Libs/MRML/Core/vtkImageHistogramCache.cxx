@@ -0,0 +1,438 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#include "vtkImageHistogramCache.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct ValueAccumulator
+{
+  ValueAccumulator()
+    : Count(0), Sum(0.), SumOfSquares(0.), Minimum(0.), Maximum(0.)
+    {}
+  vtkIdType Count;
+  double Sum;
+  double SumOfSquares;
+  double Minimum;
+  double Maximum;
+};
+
+//----------------------------------------------------------------------------
+/// State shared by the threads. Pieces are ranges of the sampled rows. The
+/// first pass accumulates the moments and extrema, the second pass fills the
+/// histograms.
+struct HistogramJob
+{
+  vtkImageData* ImageData;
+  int Component;
+  int Extent[6];
+  int SampleStep;
+  int NumberOfPieces;
+
+  std::vector<ValueAccumulator> Accumulators;
+
+  bool FillHistograms;
+  double BinOrigin;
+  double BinSpacing;
+  int NumberOfBins;
+  std::vector< std::vector<vtkIdType> > Histograms;
+
+  int GetNumberOfSamples(int axis)
+    {
+    return (this->Extent[2 * axis + 1] - this->Extent[2 * axis]) / this->SampleStep + 1;
+    }
+  vtkIdType GetNumberOfRows()
+    {
+    return static_cast<vtkIdType>(this->GetNumberOfSamples(1)) * this->GetNumberOfSamples(2);
+    }
+};
+
+//----------------------------------------------------------------------------
+template <class T>
+void ExecutePiece(HistogramJob* job, int piece, T*)
+{
+  vtkIdType numberOfRows = job->GetNumberOfRows();
+  vtkIdType firstRow = numberOfRows * piece / job->NumberOfPieces;
+  vtkIdType lastRow = numberOfRows * (piece + 1) / job->NumberOfPieces;
+  int numberOfRowsPerSlice = job->GetNumberOfSamples(1);
+  int rowLength = job->GetNumberOfSamples(0);
+  vtkIdType increment = static_cast<vtkIdType>(job->SampleStep) * job->ImageData->GetNumberOfScalarComponents();
+  ValueAccumulator& accumulator = job->Accumulators[piece];
+  vtkIdType* bins = job->FillHistograms ? &job->Histograms[piece][0] : NULL;
+  for (vtkIdType row = firstRow; row < lastRow; ++row)
+    {
+    int y = job->Extent[2] + static_cast<int>(row % numberOfRowsPerSlice) * job->SampleStep;
+    int z = job->Extent[4] + static_cast<int>(row / numberOfRowsPerSlice) * job->SampleStep;
+    T* ptr = static_cast<T*>(job->ImageData->GetScalarPointer(job->Extent[0], y, z)) + job->Component;
+    for (int x = 0; x < rowLength; ++x, ptr += increment)
+      {
+      double value = static_cast<double>(*ptr);
+      if (value != value)
+        {
+        // NaN
+        continue;
+        }
+      if (bins)
+        {
+        int bin = static_cast<int>(floor((value - job->BinOrigin) / job->BinSpacing + 0.5));
+        ++bins[std::max(0, std::min(bin, job->NumberOfBins - 1))];
+        continue;
+        }
+      if (accumulator.Count == 0)
+        {
+        accumulator.Minimum = value;
+        accumulator.Maximum = value;
+        }
+      else if (value < accumulator.Minimum)
+        {
+        accumulator.Minimum = value;
+        }
+      else if (value > accumulator.Maximum)
+        {
+        accumulator.Maximum = value;
+        }
+      ++accumulator.Count;
+      accumulator.Sum += value;
+      accumulator.SumOfSquares += value * value;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ExecuteThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  HistogramJob* job = static_cast<HistogramJob*>(info->UserData);
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread processes every NumberOfThreads-th piece.
+  for (int piece = info->ThreadID; piece < job->NumberOfPieces; piece += info->NumberOfThreads)
+    {
+    switch (job->ImageData->GetScalarType())
+      {
+      vtkTemplateMacro(ExecutePiece(job, piece, static_cast<VTK_TT*>(NULL)));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageHistogramCache);
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCache::vtkImageHistogramCache()
+{
+  this->Component = 0;
+  this->MaximumNumberOfBins = 65536;
+  this->MaximumNumberOfEstimateSamples = 1 << 22;
+  this->NumberOfThreads = 0;
+  this->Histogram = vtkIdTypeArray::New();
+  this->UpdateLock = vtkMutexLock::New();
+  this->Invalidate();
+}
+
+//----------------------------------------------------------------------------
+vtkImageHistogramCache::~vtkImageHistogramCache()
+{
+  this->Histogram->Delete();
+  this->UpdateLock->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ImageData: " << this->ImageData.GetPointer() << "\n";
+  os << indent << "Component: " << this->Component << "\n";
+  os << indent << "MaximumNumberOfBins: " << this->MaximumNumberOfBins << "\n";
+  os << indent << "MaximumNumberOfEstimateSamples: " << this->MaximumNumberOfEstimateSamples << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "Estimated: " << this->Estimated << "\n";
+  os << indent << "NumberOfSamples: " << this->NumberOfSamples << "\n";
+  os << indent << "Minimum: " << this->Minimum << "\n";
+  os << indent << "Maximum: " << this->Maximum << "\n";
+  os << indent << "Mean: " << this->Mean << "\n";
+  os << indent << "StandardDeviation: " << this->StandardDeviation << "\n";
+  os << indent << "NumberOfBins: " << this->GetNumberOfBins() << "\n";
+  os << indent << "BinOrigin: " << this->BinOrigin << "\n";
+  os << indent << "BinSpacing: " << this->BinSpacing << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::SetImageData(vtkImageData* imageData)
+{
+  if (this->ImageData.GetPointer() == imageData)
+    {
+    return;
+    }
+  this->ImageData = imageData;
+  this->Invalidate();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkImageHistogramCache::GetImageData()
+{
+  return this->ImageData.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::SetComponent(int component)
+{
+  if (this->Component == component)
+    {
+    return;
+    }
+  this->Component = component;
+  this->Invalidate();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::SetMaximumNumberOfBins(int numberOfBins)
+{
+  numberOfBins = std::max(numberOfBins, 2);
+  if (this->MaximumNumberOfBins == numberOfBins)
+    {
+    return;
+    }
+  this->MaximumNumberOfBins = numberOfBins;
+  this->Invalidate();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageHistogramCache::Invalidate()
+{
+  this->UpdateTime = vtkTimeStamp();
+  this->Estimated = false;
+  this->NumberOfSamples = 0;
+  this->Minimum = 0.;
+  this->Maximum = 0.;
+  this->Mean = 0.;
+  this->StandardDeviation = 0.;
+  this->BinOrigin = 0.;
+  this->BinSpacing = 1.;
+  this->Histogram->Initialize();
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::IsUpToDate(bool allowEstimate/*=false*/)
+{
+  vtkImageData* imageData = this->ImageData.GetPointer();
+  if (!imageData || this->UpdateTime.GetMTime() == 0)
+    {
+    return false;
+    }
+  if (this->Estimated && !allowEstimate)
+    {
+    return false;
+    }
+  // The image MTime includes the MTime of its point data arrays
+  return this->UpdateTime.GetMTime() > imageData->GetMTime();
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::Update(bool allowEstimate/*=false*/)
+{
+  // The cache of a volume is shared by all its consumers, that may update it
+  // from different threads.
+  this->UpdateLock->Lock();
+  bool success = this->UpdateInternal(allowEstimate);
+  this->UpdateLock->Unlock();
+  return success;
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageHistogramCache::UpdateInternal(bool allowEstimate)
+{
+  if (this->IsUpToDate(allowEstimate))
+    {
+    return true;
+    }
+  this->Invalidate();
+
+  vtkImageData* imageData = this->ImageData.GetPointer();
+  if (!imageData || !imageData->GetPointData() || !imageData->GetPointData()->GetScalars())
+    {
+    vtkDebugMacro("Update: image data has no scalars");
+    return false;
+    }
+  if (this->Component < 0 || this->Component >= imageData->GetNumberOfScalarComponents())
+    {
+    vtkErrorMacro("Update: invalid component " << this->Component << ", image data has "
+                  << imageData->GetNumberOfScalarComponents() << " components");
+    return false;
+    }
+
+  HistogramJob job;
+  job.ImageData = imageData;
+  job.Component = this->Component;
+  job.SampleStep = 1;
+  job.FillHistograms = false;
+  imageData->GetExtent(job.Extent);
+  if (job.Extent[0] > job.Extent[1] || job.Extent[2] > job.Extent[3] || job.Extent[4] > job.Extent[5])
+    {
+    // Empty image
+    this->UpdateTime.Modified();
+    return true;
+    }
+
+  // Estimates are computed from every SampleStep voxel along each axis.
+  double numberOfVoxels = static_cast<double>(imageData->GetNumberOfPoints());
+  if (allowEstimate && this->MaximumNumberOfEstimateSamples > 0
+    && numberOfVoxels > this->MaximumNumberOfEstimateSamples)
+    {
+    job.SampleStep = static_cast<int>(ceil(pow(numberOfVoxels / this->MaximumNumberOfEstimateSamples, 1. / 3.)));
+    this->Estimated = (job.SampleStep > 1);
+    }
+
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  job.NumberOfPieces = static_cast<int>(std::min(static_cast<vtkIdType>(numberOfThreads), job.GetNumberOfRows()));
+  job.Accumulators.resize(job.NumberOfPieces);
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(job.NumberOfPieces);
+  threader->SetSingleMethod(ExecuteThread, &job);
+  threader->SingleMethodExecute();
+
+  // Merge the accumulators of the pieces
+  ValueAccumulator accumulator;
+  for (int piece = 0; piece < job.NumberOfPieces; ++piece)
+    {
+    const ValueAccumulator& pieceAccumulator = job.Accumulators[piece];
+    if (pieceAccumulator.Count == 0)
+      {
+      continue;
+      }
+    if (accumulator.Count == 0)
+      {
+      accumulator = pieceAccumulator;
+      continue;
+      }
+    accumulator.Count += pieceAccumulator.Count;
+    accumulator.Sum += pieceAccumulator.Sum;
+    accumulator.SumOfSquares += pieceAccumulator.SumOfSquares;
+    accumulator.Minimum = std::min(accumulator.Minimum, pieceAccumulator.Minimum);
+    accumulator.Maximum = std::max(accumulator.Maximum, pieceAccumulator.Maximum);
+    }
+  this->NumberOfSamples = accumulator.Count;
+  if (accumulator.Count == 0)
+    {
+    this->UpdateTime.Modified();
+    return true;
+    }
+  double count = static_cast<double>(accumulator.Count);
+  this->Minimum = accumulator.Minimum;
+  this->Maximum = accumulator.Maximum;
+  this->Mean = accumulator.Sum / count;
+  if (accumulator.Count > 1)
+    {
+    double variance = (accumulator.SumOfSquares - accumulator.Sum * accumulator.Sum / count) / (count - 1.);
+    this->StandardDeviation = sqrt(std::max(0., variance));
+    }
+
+  // Bins
+  int scalarType = imageData->GetScalarType();
+  bool integerScalars = (scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE);
+  double range = this->Maximum - this->Minimum;
+  job.BinOrigin = this->Minimum;
+  if (range == 0.)
+    {
+    job.NumberOfBins = 1;
+    job.BinSpacing = 1.;
+    }
+  else if (integerScalars && range < this->MaximumNumberOfBins)
+    {
+    job.NumberOfBins = static_cast<int>(range) + 1;
+    job.BinSpacing = 1.;
+    }
+  else
+    {
+    job.NumberOfBins = this->MaximumNumberOfBins;
+    job.BinSpacing = range / (job.NumberOfBins - 1);
+    }
+  job.FillHistograms = true;
+  job.Histograms.resize(job.NumberOfPieces, std::vector<vtkIdType>(job.NumberOfBins, 0));
+  threader->SingleMethodExecute();
+
+  this->BinOrigin = job.BinOrigin;
+  this->BinSpacing = job.BinSpacing;
+  this->Histogram->SetNumberOfValues(job.NumberOfBins);
+  for (int bin = 0; bin < job.NumberOfBins; ++bin)
+    {
+    vtkIdType binCount = 0;
+    for (int piece = 0; piece < job.NumberOfPieces; ++piece)
+      {
+      binCount += job.Histograms[piece][bin];
+      }
+    this->Histogram->SetValue(bin, binCount);
+    }
+  this->Histogram->Modified();
+
+  this->UpdateTime.Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIdTypeArray* vtkImageHistogramCache::GetHistogram()
+{
+  return this->Histogram;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageHistogramCache::GetNumberOfBins()
+{
+  return static_cast<int>(this->Histogram->GetNumberOfValues());
+}
+
+//----------------------------------------------------------------------------
+double vtkImageHistogramCache::GetPercentile(double percent)
+{
+  int numberOfBins = this->GetNumberOfBins();
+  if (numberOfBins == 0)
+    {
+    return 0.;
+    }
+  double limitCount = std::max(0., std::min(percent, 100.)) * 0.01 * this->NumberOfSamples;
+  vtkIdType cumulatedCount = 0;
+  for (int bin = 0; bin < numberOfBins; ++bin)
+    {
+    cumulatedCount += this->Histogram->GetValue(bin);
+    if (cumulatedCount >= limitCount)
+      {
+      return this->BinOrigin + bin * this->BinSpacing;
+      }
+    }
+  return this->BinOrigin + (numberOfBins - 1) * this->BinSpacing;
+}
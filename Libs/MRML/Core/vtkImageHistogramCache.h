@@ -0,0 +1,146 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageHistogramCache_h
+#define __vtkImageHistogramCache_h
+
+// MRML includes
+#include "vtkMRML.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+class vtkIdTypeArray;
+class vtkImageData;
+class vtkMutexLock;
+
+/// \brief Lazily computed histogram and statistics of an image.
+///
+/// vtkImageHistogramCache computes the histogram, minimum, maximum, mean and
+/// standard deviation of a scalar component of an image the first time they
+/// are requested, and keeps them until the image or its scalars are modified.
+/// The voxels are traversed by multiple threads.
+///
+/// Integer images whose range spans at most MaximumNumberOfBins values get
+/// one bin per value. Otherwise MaximumNumberOfBins bins are spread over the
+/// range of the image. Bin i is centered on BinOrigin + i * BinSpacing.
+///
+/// Update(true) allows the statistics to be estimated from a regular subset of
+/// at most MaximumNumberOfEstimateSamples voxels: it is fast enough for very
+/// large images and the estimate is kept until exact statistics are requested
+/// with Update().
+///
+/// vtkMRMLScalarVolumeNode::GetHistogramCache() gives access to the cache of a
+/// volume, shared by all the display nodes and other consumers of the volume.
+///
+/// Usage from python:
+/// \code
+/// cache = volumeNode.GetHistogramCache()
+/// cache.Update()
+/// print(cache.GetMinimum(), cache.GetMaximum(), cache.GetPercentile(99.))
+/// \endcode
+class VTK_MRML_EXPORT vtkImageHistogramCache : public vtkObject
+{
+public:
+  static vtkImageHistogramCache *New();
+  vtkTypeMacro(vtkImageHistogramCache,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Image to compute the statistics of. The image is not reference counted.
+  void SetImageData(vtkImageData* imageData);
+  vtkImageData* GetImageData();
+
+  /// Scalar component to compute the statistics of. Default is 0.
+  void SetComponent(int component);
+  vtkGetMacro(Component, int);
+
+  /// Maximum number of bins of the histogram. Default is 65536.
+  void SetMaximumNumberOfBins(int numberOfBins);
+  vtkGetMacro(MaximumNumberOfBins, int);
+
+  /// Maximum number of voxels used by Update(true). Default is 4194304.
+  vtkSetMacro(MaximumNumberOfEstimateSamples, vtkIdType);
+  vtkGetMacro(MaximumNumberOfEstimateSamples, vtkIdType);
+
+  /// Number of threads used to compute the statistics.
+  /// 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the statistics if the image has been modified since the last
+  /// computation. If allowEstimate is true, the statistics of large images
+  /// are estimated from a subset of the voxels.
+  /// Returns false if the image is not set or has no scalars.
+  /// Concurrent calls from multiple threads are serialized, the statistics
+  /// are computed only once.
+  bool Update(bool allowEstimate = false);
+
+  /// Return true if the statistics are up to date with the image.
+  /// If allowEstimate is false, estimated statistics are not up to date.
+  bool IsUpToDate(bool allowEstimate = false);
+
+  /// Return true if the current statistics are estimated from a subset of
+  /// the voxels.
+  vtkGetMacro(Estimated, bool);
+
+  /// Number of voxels the statistics are computed from.
+  vtkGetMacro(NumberOfSamples, vtkIdType);
+
+  vtkGetMacro(Minimum, double);
+  vtkGetMacro(Maximum, double);
+  vtkGetMacro(Mean, double);
+  vtkGetMacro(StandardDeviation, double);
+
+  /// Voxel counts of the bins of the histogram.
+  vtkIdTypeArray* GetHistogram();
+  int GetNumberOfBins();
+  vtkGetMacro(BinOrigin, double);
+  vtkGetMacro(BinSpacing, double);
+
+  /// Value below which the given percentage (in [0, 100]) of the voxels
+  /// fall, with the precision of the bin spacing.
+  double GetPercentile(double percent);
+
+protected:
+  vtkImageHistogramCache();
+  virtual ~vtkImageHistogramCache();
+
+  /// Discard the current statistics.
+  void Invalidate();
+
+  /// Compute the statistics, called by Update() with the lock held.
+  bool UpdateInternal(bool allowEstimate);
+
+  vtkWeakPointer<vtkImageData> ImageData;
+  int Component;
+  int MaximumNumberOfBins;
+  vtkIdType MaximumNumberOfEstimateSamples;
+  int NumberOfThreads;
+
+  bool Estimated;
+  vtkIdType NumberOfSamples;
+  double Minimum;
+  double Maximum;
+  double Mean;
+  double StandardDeviation;
+  vtkIdTypeArray* Histogram;
+  double BinOrigin;
+  double BinSpacing;
+  vtkTimeStamp UpdateTime;
+  vtkMutexLock* UpdateLock;
+
+private:
+  vtkImageHistogramCache(const vtkImageHistogramCache&);  // Not implemented.
+  void operator=(const vtkImageHistogramCache&);  // Not implemented.
+};
+
+#endif
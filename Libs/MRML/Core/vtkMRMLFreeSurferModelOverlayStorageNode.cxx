@@ -372,6 +372,12 @@ bool vtkMRMLFreeSurferModelOverlayStorageNode::ReadScalarOverlayVolume(const std
   return true;
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLFreeSurferModelOverlayStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return false;
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLFreeSurferModelOverlayStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 {
@@ -60,6 +60,10 @@ protected:
   /// NOTE: Subclasses should implement this method
   virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
+  /// Overlays are added to the polydata of the model node,
+  /// they cannot be read in a detached node.
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
   ///
   /// Write data from a  referenced node
   /// NOTE: Subclasses should implement this method
@@ -104,6 +104,12 @@ void vtkMRMLFreeSurferModelStorageNode::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Use Triangle Stripper: " << this->UseStripper << "\n";
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLFreeSurferModelStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return false;
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLFreeSurferModelStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 {
@@ -70,6 +70,9 @@ protected:
   /// Read data and set it in the referenced node
   virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
+  /// FreeSurfer surfaces are not read in a detached node
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
   int UseStripper;
 };
 
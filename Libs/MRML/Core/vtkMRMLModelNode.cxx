@@ -94,6 +94,15 @@ void vtkMRMLModelNode::Copy(vtkMRMLNode *anode)
   this->EndModify(disabledModify);
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLModelNode::GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects)
+{
+  if (this->GetMesh())
+    {
+    dataObjects.push_back(this->GetMesh());
+    }
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLModelNode::ProcessMRMLEvents ( vtkObject *caller,
                                            unsigned long event,
@@ -59,6 +59,9 @@ public:
   /// Copy the node's attributes to this object
   virtual void Copy(vtkMRMLNode *node) VTK_OVERRIDE;
 
+  /// Add the mesh to \a dataObjects.
+  virtual void GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects) VTK_OVERRIDE;
+
   /// alternative method to propagate events generated in Display nodes
   virtual void ProcessMRMLEvents ( vtkObject * /*caller*/,
                                    unsigned long /*event*/,
@@ -303,21 +303,59 @@ int vtkMRMLModelStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
       result = 0;
     }
 
-    if (modelNode->GetMesh() != NULL)
+    this->UpdateDisplayNodeScalarRange(modelNode);
+    return result;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLModelStorageNode::UpdateDisplayNodeScalarRange(vtkMRMLModelNode* modelNode)
+{
+  if (modelNode->GetMesh() != NULL)
     {
-      // is there an active scalar array?
-      if (modelNode->GetDisplayNode())
+    // is there an active scalar array?
+    if (modelNode->GetDisplayNode())
       {
-        double *scalarRange = modelNode->GetMesh()->GetScalarRange();
-        if (scalarRange)
+      double *scalarRange = modelNode->GetMesh()->GetScalarRange();
+      if (scalarRange)
         {
-          vtkDebugMacro("ReadDataInternal: setting scalar range " << scalarRange[0] << ", " << scalarRange[1]);
-          modelNode->GetDisplayNode()->SetScalarRange(scalarRange);
+        vtkDebugMacro("ReadDataInternal: setting scalar range " << scalarRange[0] << ", " << scalarRange[1]);
+        modelNode->GetDisplayNode()->SetScalarRange(scalarRange);
         }
       }
-      //modelNode->GetMesh()->Modified();
+    //modelNode->GetMesh()->Modified();
     }
-    return result;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLModelStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLModelStorageNode::AttachDetachedData(vtkMRMLStorageNode* vtkNotUsed(detachedStorageNode),
+                                                vtkMRMLNode* detachedNode, vtkMRMLNode* refNode)
+{
+  vtkMRMLModelNode* detachedModelNode = vtkMRMLModelNode::SafeDownCast(detachedNode);
+  vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(refNode);
+  if (!detachedModelNode || !modelNode)
+    {
+    vtkErrorMacro("AttachDetachedData: Reference node is expected to be a vtkMRMLModelNode");
+    return 0;
+    }
+  if (detachedModelNode->GetMeshConnection())
+    {
+    if (detachedModelNode->GetMeshType() == vtkMRMLModelNode::UnstructuredGridMeshType)
+      {
+      modelNode->SetUnstructuredGridConnection(detachedModelNode->GetMeshConnection());
+      }
+    else
+      {
+      modelNode->SetPolyDataConnection(detachedModelNode->GetMeshConnection());
+      }
+    }
+  this->UpdateDisplayNodeScalarRange(modelNode);
+  return 1;
 }
 
 //----------------------------------------------------------------------------
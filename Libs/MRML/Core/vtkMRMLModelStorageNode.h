@@ -59,6 +59,16 @@ protected:
   /// Read data and set it in the referenced node
   virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
+  /// Model files are read without accessing the scene
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Move the mesh read in the detached node into the referenced node
+  virtual int AttachDetachedData(vtkMRMLStorageNode* detachedStorageNode,
+                                 vtkMRMLNode* detachedNode, vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Set the scalar range of the model display node from the mesh
+  void UpdateDisplayNodeScalarRange(vtkMRMLModelNode* modelNode);
+
   /// Write data from a  referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
@@ -21,6 +21,7 @@
 #include "vtkIdTypeArray.h"
 #include "vtkIntArray.h"
 
+class vtkDataObject;
 class vtkMRMLScene;
 class vtkStringArray;
 
@@ -224,6 +225,14 @@ public:
   /// \sa vtkMRMLScene::AddNode(vtkMRMLNode*)
   void CopyWithScene(vtkMRMLNode *node);
 
+  /// \brief Append to \a dataObjects the data objects holding the bulk data
+  /// of the node (images, meshes, transform grids...).
+  ///
+  /// The scene uses them to estimate the memory used by the undo history.
+  /// \note Subclasses storing bulk data should implement this method.
+  /// \sa vtkMRMLScene::GetUndoMemorySize()
+  virtual void GetBulkDataObjects(std::vector<vtkDataObject*>& vtkNotUsed(dataObjects)) {}
+
   /// \brief Reset node attributes to the initial state as defined in the
   /// constructor or the passed default node.
   ///
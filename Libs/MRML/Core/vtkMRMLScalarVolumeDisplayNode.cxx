@@ -14,16 +14,18 @@ Version:   $Revision: 1.2 $
 
 // MRML includes
 #include "vtkEventBroker.h"
+#include "vtkImageHistogramCache.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 #include "vtkMRMLScene.h"
 #include "vtkMRMLProceduralColorNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
 #include "vtkMRMLVolumeNode.h"
 
 // VTK includes
 #include <vtkAlgorithmOutput.h>
 #include <vtkCallbackCommand.h>
 #include <vtkColorTransferFunction.h>
-#include <vtkImageAccumulate.h>
+#include <vtkIdTypeArray.h>
 #include <vtkImageAppendComponents.h>
 #include <vtkImageExtractComponents.h>
 #include <vtkImageBimodalAnalysis.h>
@@ -35,11 +37,13 @@ Version:   $Revision: 1.2 $
 #include <vtkImageThreshold.h>
 #include <vtkObjectFactory.h>
 #include <vtkLookupTable.h>
+#include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkVersion.h>
 
 
 // STD includes
+#include <algorithm>
 #include <cassert>
 
 //----------------------------------------------------------------------------
@@ -106,7 +110,7 @@ vtkMRMLScalarVolumeDisplayNode::vtkMRMLScalarVolumeDisplayNode()
   this->AppendComponents->AddInputConnection(0, this->AlphaLogic->GetOutputPort() );
 
   this->Bimodal = NULL;
-  this->Accumulate = NULL;
+  this->HistogramCache = NULL;
   this->IsInCalculateAutoLevels = false;
 
   vtkEventBroker::GetInstance()->AddObservation(
@@ -132,10 +136,10 @@ vtkMRMLScalarVolumeDisplayNode::~vtkMRMLScalarVolumeDisplayNode()
     this->Bimodal->Delete();
     this->Bimodal = NULL;
     }
-  if (this->Accumulate)
+  if (this->HistogramCache)
     {
-    this->Accumulate->Delete();
-    this->Accumulate = NULL;
+    this->HistogramCache->Delete();
+    this->HistogramCache = NULL;
     }
 }
 
@@ -741,10 +745,6 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
     {
     this->Bimodal = vtkImageBimodalAnalysis::New();
     }
-  if (this->Accumulate == NULL)
-    {
-    this->Accumulate = vtkImageAccumulate::New();
-    }
 
   double window = 0.0;
   double level = 0.0;
@@ -752,81 +752,94 @@ void vtkMRMLScalarVolumeDisplayNode::CalculateAutoLevels()
   double upper = 0.0;
 
   int needAdHoc = 0;
-  int scalarType = imageDataScalar->GetScalarType();
 
   if (imageDataScalar->GetNumberOfScalarComponents() >=3)
     {
     needAdHoc = 1;
     }
-  else if (scalarType == VTK_INT ||
-           scalarType == VTK_SHORT ||
-           scalarType == VTK_CHAR ||
-           scalarType == VTK_SIGNED_CHAR ||
-           scalarType == VTK_UNSIGNED_CHAR ||
-           scalarType == VTK_UNSIGNED_SHORT ||
-           scalarType == VTK_UNSIGNED_INT)
-    {
-    // Data type is VTK_INT or similar, so calculate window/level
-    // check the scalar type, bimodal analysis only works on int
-
-    // Setup filter to work with signed 16-bit integer.
-    int extent[6] = {0, 65535, 0, 0, 0, 0};
-    this->Accumulate->SetComponentExtent(extent);
-    double origin[3] = {-32768, 0, 0};
-    this->Accumulate->SetComponentOrigin(origin);
-    this->Accumulate->SetInputData(imageDataScalar);
-    this->Bimodal->SetInputConnection(this->Accumulate->GetOutputPort());
-    this->Bimodal->Update();
-    // Workaround for image data where all accumulate samples fall
-    // within the same histogram bin
-    if ( this->Bimodal->GetWindow() == 0.0 &&
-         this->Bimodal->GetLevel() == 0.0 )
+  else
+    {
+    // Use the histogram shared by all the consumers of the volume if the
+    // scalars are the volume image data, a histogram of our own otherwise.
+    vtkImageHistogramCache* histogramCache = NULL;
+    vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(this->GetVolumeNode());
+    if (volumeNode && volumeNode->GetImageData() == imageDataScalar)
+      {
+      histogramCache = volumeNode->GetHistogramCache();
+      }
+    else
+      {
+      if (this->HistogramCache == NULL)
+        {
+        this->HistogramCache = vtkImageHistogramCache::New();
+        }
+      this->HistogramCache->SetImageData(imageDataScalar);
+      histogramCache = this->HistogramCache;
+      }
+
+    // Workaround for image data where all samples fall within the same
+    // histogram bin.
+    // The histogram is exact: window/level must not depend on the subset of
+    // voxels used by an estimate.
+    if (!histogramCache->Update() || histogramCache->GetNumberOfBins() < 2)
       {
       needAdHoc = 1;
       }
     else
       {
-      window = this->Bimodal->GetWindow();
-      level = this->Bimodal->GetLevel();
-      lower = this->Bimodal->GetThreshold();
-      upper = this->Bimodal->GetMax();
+      // The bimodal analysis works on bin indices and smooths the histogram
+      // over 5 bins: the bins of floating point images (or integer images with
+      // a large range) are merged into at most 1000 bins. The analysis ignores
+      // the first bin, it is left empty.
+      int numberOfBins = histogramCache->GetNumberOfBins();
+      int binsPerBimodalBin = 1;
+      int paddingBin = -1;
+      int scalarType = imageDataScalar->GetScalarType();
+      if (histogramCache->GetBinSpacing() != 1.)
+        {
+        binsPerBimodalBin = (numberOfBins + 999) / 1000;
+        }
+      else if (scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE)
+        {
+        // Voxels of value -32768 are padding (e.g. outside the field of view
+        // of CT scans), they are excluded from the analysis.
+        paddingBin = static_cast<int>(-32768. - histogramCache->GetBinOrigin());
+        }
+      int numberOfBimodalBins = (numberOfBins + binsPerBimodalBin - 1) / binsPerBimodalBin;
+      vtkNew<vtkImageData> histogram;
+      histogram->SetExtent(0, numberOfBimodalBins, 0, 0, 0, 0);
+      histogram->AllocateScalars(VTK_DOUBLE, 1);
+      double* bimodalBins = static_cast<double*>(histogram->GetScalarPointer());
+      std::fill(bimodalBins, bimodalBins + numberOfBimodalBins + 1, 0.);
+      vtkIdTypeArray* bins = histogramCache->GetHistogram();
+      for (int bin = 0; bin < numberOfBins; ++bin)
+        {
+        if (bin != paddingBin)
+          {
+          bimodalBins[1 + bin / binsPerBimodalBin] += bins->GetValue(bin);
+          }
+        }
+      this->Bimodal->SetInputData(histogram.GetPointer());
+      this->Bimodal->Update();
+
+      if ( this->Bimodal->GetWindow() == 0.0 &&
+           this->Bimodal->GetLevel() == 0.0 )
+        {
+        needAdHoc = 1;
+        }
+      else
+        {
+        // Convert the bin indices back to intensities (center of the bins)
+        double spacing = histogramCache->GetBinSpacing() * binsPerBimodalBin;
+        double origin = histogramCache->GetBinOrigin()
+          + 0.5 * (binsPerBimodalBin - 1) * histogramCache->GetBinSpacing() - spacing;
+        window = this->Bimodal->GetWindow() * spacing;
+        level = origin + this->Bimodal->GetLevel() * spacing;
+        lower = origin + this->Bimodal->GetThreshold() * spacing;
+        upper = origin + this->Bimodal->GetMax() * spacing;
+        }
       }
     }
-  else if (scalarType == VTK_FLOAT ||
-           scalarType == VTK_DOUBLE ||
-           scalarType == VTK_LONG ||
-           scalarType == VTK_UNSIGNED_LONG)
-    {
-    // If scalar range is expected to be less conventional, then scale the bins
-    // the image accumulate algorithm
-    double range[2];
-    this->GetDisplayScalarRange(range);
-    long minInt = trunc(range[0]) - 1;
-    long maxInt = trunc(range[1]) + 1;
-
-    this->Accumulate->SetInputData(imageDataScalar);
-    int extent[6] = {0, 999, 0, 0, 0, 0};
-    this->Accumulate->SetComponentExtent(extent);
-    double origin[3] = {static_cast<double>(minInt), 0.0, 0.0};
-    this->Accumulate->SetComponentOrigin(origin);
-    double spacing[3] = {(maxInt-minInt)/1000.0, 1.0, 1.0};
-    this->Accumulate->SetComponentSpacing(spacing);
-
-    this->Bimodal->SetInputConnection(this->Accumulate->GetOutputPort());
-    this->Bimodal->Update();
-
-    // The bimodal analysis assumes that the bin indices correspond directly to
-    // voxel intensity values, need to convert back to intensity space
-    window = this->Bimodal->GetWindow() * spacing[0];
-    level = minInt + (this->Bimodal->GetLevel() - minInt) * spacing[0];
-    lower = minInt + (this->Bimodal->GetThreshold() - minInt) * spacing[0];
-    upper = minInt + (this->Bimodal->GetMax() - minInt) * spacing[0];
-    }
-  else
-    {
-    // If unhandled type, estimate with ad hoc method
-    needAdHoc = 1;
-    }
 
   if (needAdHoc)
     {
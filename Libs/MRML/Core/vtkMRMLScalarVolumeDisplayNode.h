@@ -17,10 +17,10 @@
 
 // MRML includes
 #include "vtkMRMLVolumeDisplayNode.h"
+class vtkImageHistogramCache;
 
 // VTK includes
 class vtkImageAlgorithm;
-class vtkImageAccumulate;
 class vtkImageAppendComponents;
 class vtkImageBimodalAnalysis;
 class vtkImageCast;
@@ -241,8 +241,10 @@ protected:
   std::vector<WindowLevelPreset> WindowLevelPresets;
 
   ///
-  /// Used internally in CalculateScalarAutoLevels and CalculateStatisticsAutoLevels
-  vtkImageAccumulate *Accumulate;
+  /// Used internally in CalculateAutoLevels. The histogram cache is only
+  /// used if the scalars are not the image data of the volume node, the
+  /// histogram cache of the volume node is used otherwise.
+  vtkImageHistogramCache *HistogramCache;
   vtkImageBimodalAnalysis *Bimodal;
   bool IsInCalculateAutoLevels;
 };
@@ -13,6 +13,7 @@ Version:   $Revision: 1.14 $
 =========================================================================auto=*/
 // MRML includes
 #include "vtkCodedEntry.h"
+#include "vtkImageHistogramCache.h"
 #include "vtkMRMLScalarVolumeDisplayNode.h"
 #include "vtkMRMLScalarVolumeNode.h"
 #include "vtkMRMLScene.h"
@@ -34,6 +35,7 @@ vtkCxxSetObjectMacro(vtkMRMLScalarVolumeNode, VoxelValueUnits, vtkCodedEntry);
 vtkMRMLScalarVolumeNode::vtkMRMLScalarVolumeNode()
 : VoxelValueQuantity(NULL)
 , VoxelValueUnits(NULL)
+, HistogramCache(NULL)
 {
 }
 
@@ -42,6 +44,11 @@ vtkMRMLScalarVolumeNode::~vtkMRMLScalarVolumeNode()
 {
   this->SetVoxelValueQuantity(NULL);
   this->SetVoxelValueUnits(NULL);
+  if (this->HistogramCache)
+    {
+    this->HistogramCache->Delete();
+    this->HistogramCache = NULL;
+    }
 }
 
 //----------------------------------------------------------------------------
@@ -149,6 +156,18 @@ void vtkMRMLScalarVolumeNode::PrintSelf(ostream& os, vtkIndent indent)
     }
 }
 
+//----------------------------------------------------------------------------
+vtkImageHistogramCache* vtkMRMLScalarVolumeNode::GetHistogramCache()
+{
+  if (!this->HistogramCache)
+    {
+    this->HistogramCache = vtkImageHistogramCache::New();
+    }
+  // The cache is invalidated if the image data has been replaced
+  this->HistogramCache->SetImageData(this->GetImageData());
+  return this->HistogramCache;
+}
+
 //---------------------------------------------------------------------------
 vtkMRMLStorageNode* vtkMRMLScalarVolumeNode::CreateDefaultStorageNode()
 {
@@ -19,6 +19,7 @@
 #include "vtkMRMLVolumeNode.h"
 class vtkMRMLScalarVolumeDisplayNode;
 class vtkCodedEntry;
+class vtkImageHistogramCache;
 
 /// \brief MRML node for representing a volume (image stack).
 ///
@@ -84,6 +85,13 @@ class VTK_MRML_EXPORT vtkMRMLScalarVolumeNode : public vtkMRMLVolumeNode
   void SetVoxelValueUnits(vtkCodedEntry*);
   vtkGetObjectMacro(VoxelValueUnits, vtkCodedEntry);
 
+  /// Histogram and statistics of the image data, computed on demand and
+  /// shared by all the consumers of the volume (auto window/level of the
+  /// display nodes, volume rendering, etc.). The cache is recomputed only
+  /// when the image data is modified.
+  /// \sa vtkImageHistogramCache::Update()
+  vtkImageHistogramCache* GetHistogramCache();
+
 protected:
   vtkMRMLScalarVolumeNode();
   ~vtkMRMLScalarVolumeNode();
@@ -92,6 +100,8 @@ protected:
 
   vtkCodedEntry* VoxelValueQuantity;
   vtkCodedEntry* VoxelValueUnits;
+
+  vtkImageHistogramCache* HistogramCache;
 };
 
 #endif
@@ -17,6 +17,7 @@ Version:   $Revision: 1.18 $
 
 #include "vtkCacheManager.h"
 #include "vtkDataIOManager.h"
+#include "vtkEventBroker.h"
 #include "vtkTagTable.h"
 
 #include "vtkMRMLTransformNode.h"
@@ -54,6 +55,7 @@ Version:   $Revision: 1.18 $
 #include "vtkMRMLSliceCompositeNode.h"
 #include "vtkMRMLSliceNode.h"
 #include "vtkMRMLSnapshotClipNode.h"
+#include "vtkMRMLStorableNode.h"
 #include "vtkMRMLSubjectHierarchyNode.h"
 #include "vtkMRMLTableNode.h"
 #include "vtkMRMLTableStorageNode.h"
@@ -62,6 +64,7 @@ Version:   $Revision: 1.18 $
 #include "vtkMRMLTransformStorageNode.h"
 #include "vtkMRMLVectorVolumeDisplayNode.h"
 #include "vtkMRMLViewNode.h"
+#include "vtkMRMLVolumeNode.h"
 #include "vtkMRMLVolumeArchetypeStorageNode.h"
 #include "vtkURIHandler.h"
 #include "vtkMRMLLayoutNode.h"
@@ -82,9 +85,15 @@ Version:   $Revision: 1.18 $
 // VTK includes
 #include <vtkCallbackCommand.h>
 #include <vtkCollection.h>
+#include <vtkDataObject.h>
 #include <vtkDebugLeaks.h>
 #include <vtkErrorCode.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkPointSet.h>
 #include <vtkSmartPointer.h>
 
 // VTKSYS includes
@@ -110,6 +119,7 @@ vtkCxxSetObjectMacro(vtkMRMLScene, URIHandlerCollection, vtkCollection)
 vtkMRMLScene::vtkMRMLScene()
 {
   this->NodeIDsMTime = 0;
+  this->NodesByClassMTime = 0;
   this->SceneModifiedTime = 0;
 
   this->RegisteredNodeClasses.clear();
@@ -118,6 +128,8 @@ vtkMRMLScene::vtkMRMLScene()
 
   this->Nodes =  vtkCollection::New();
   this->UndoStackSize = 100;
+  this->UndoMemoryLimit = 1024;
+  this->UndoMemorySize = 0;
   this->UndoFlag = false;
   this->InUndo = false;
 
@@ -136,6 +148,7 @@ vtkMRMLScene::vtkMRMLScene()
   this->SaveToXMLString = 0;
 
   this->ReadDataOnLoad = 1;
+  this->NumberOfReadDataThreads = 0;
 
   this->LastLoadedVersion = NULL;
   this->Version = NULL;
@@ -245,6 +258,8 @@ vtkMRMLScene::~vtkMRMLScene()
     {
     this->RegisteredNodeClasses[n]->Delete();
     }
+  this->RegisteredNodeClassesByTag.clear();
+  this->RegisteredNodeClassesByClassName.clear();
 
   if ( this->CacheManager != NULL )
     {
@@ -446,13 +461,11 @@ vtkMRMLNode* vtkMRMLScene::CreateNodeByClass(const char* className)
     return NULL;
     }
   vtkMRMLNode* node = NULL;
-  for (unsigned int i=0; i<RegisteredNodeClasses.size(); i++)
+  std::map< std::string, vtkMRMLNode* >::iterator registeredIt =
+    this->RegisteredNodeClassesByClassName.find(className);
+  if (registeredIt != this->RegisteredNodeClassesByClassName.end())
     {
-    if (!strcmp(RegisteredNodeClasses[i]->GetClassName(), className))
-      {
-      node = RegisteredNodeClasses[i]->CreateNodeInstance();
-      break;
-      }
+    node = registeredIt->second->CreateNodeInstance();
     }
   // non-registered nodes can have a registered factory
   if (node == NULL)
@@ -516,6 +529,7 @@ void vtkMRMLScene::RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
   // By doing so we make sure there is no more than 1 node matching a given
   // XML tag. It allows plugins to MRML to overide default behavior when
   // instantiating nodes via XML tags.
+  bool replaced = false;
   for (unsigned int i = 0; i < this->RegisteredNodeTags.size(); ++i)
     {
     if (this->RegisteredNodeTags[i] == xmlTag)
@@ -534,6 +548,7 @@ void vtkMRMLScene::RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
       // we could have replace the entry with the new node also.
       this->RegisteredNodeClasses.erase(this->RegisteredNodeClasses.begin() + i);
       this->RegisteredNodeTags.erase(this->RegisteredNodeTags.begin() + i);
+      replaced = true;
       // we found a matching tag, there is maximum one in the list, no need to
       // search any further
       break;
@@ -543,6 +558,24 @@ void vtkMRMLScene::RegisterNodeClass(vtkMRMLNode* node, const char* tagName)
   node->Register(this);
   this->RegisteredNodeClasses.push_back(node);
   this->RegisteredNodeTags.push_back(xmlTag);
+
+  this->RegisteredNodeClassesByTag[xmlTag] = node;
+  if (replaced)
+    {
+    // the first registered node of a class is used to create the nodes of
+    // that class, it may have been unregistered.
+    this->RegisteredNodeClassesByClassName.clear();
+    for (unsigned int i = 0; i < this->RegisteredNodeClasses.size(); ++i)
+      {
+      this->RegisteredNodeClassesByClassName.insert(std::make_pair(
+        std::string(this->RegisteredNodeClasses[i]->GetClassName()), this->RegisteredNodeClasses[i]));
+      }
+    }
+  else
+    {
+    this->RegisteredNodeClassesByClassName.insert(std::make_pair(
+      std::string(node->GetClassName()), node));
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -594,14 +627,13 @@ const char* vtkMRMLScene::GetClassNameByTag(const char *tagName)
     vtkErrorMacro("GetClassNameByTag: tagname is null");
     return NULL;
     }
-  for (unsigned int i=0; i<RegisteredNodeTags.size(); i++)
+  std::map< std::string, vtkMRMLNode* >::iterator it =
+    this->RegisteredNodeClassesByTag.find(tagName);
+  if (it == this->RegisteredNodeClassesByTag.end())
     {
-    if (!strcmp(RegisteredNodeTags[i].c_str(), tagName))
-      {
-      return (RegisteredNodeClasses[i])->GetClassName();
-      }
+    return NULL;
     }
-  return NULL;
+  return it->second->GetClassName();
 }
 
 //------------------------------------------------------------------------------
@@ -612,14 +644,13 @@ const char* vtkMRMLScene::GetTagByClassName(const char *className)
     vtkErrorMacro("GetTagByClassName: className is null");
     return NULL;
     }
-  for (unsigned int i=0; i<this->RegisteredNodeClasses.size(); i++)
+  std::map< std::string, vtkMRMLNode* >::iterator it =
+    this->RegisteredNodeClassesByClassName.find(className);
+  if (it == this->RegisteredNodeClassesByClassName.end())
     {
-    if (!strcmp(this->RegisteredNodeClasses[i]->GetClassName(), className))
-      {
-      return (this->RegisteredNodeClasses[i])->GetNodeTagName();
-      }
+    return NULL;
     }
-  return NULL;
+  return it->second->GetNodeTagName();
 }
 
 //------------------------------------------------------------------------------
@@ -647,6 +678,22 @@ int vtkMRMLScene::GetStates()const
 //------------------------------------------------------------------------------
 void vtkMRMLScene::StartState(unsigned long state, int anticipatedMaxProgress)
 {
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  if (broker->GetTracing())
+    {
+    const char* name = "Scene state";
+    switch (state)
+      {
+      case vtkMRMLScene::BatchProcessState: name = "Scene batch process"; break;
+      case vtkMRMLScene::CloseState: name = "Scene close"; break;
+      case vtkMRMLScene::ImportState: name = "Scene import"; break;
+      case vtkMRMLScene::RestoreState: name = "Scene restore"; break;
+      case vtkMRMLScene::SaveState: name = "Scene save"; break;
+      default: break;
+      }
+    broker->TraceBegin(name, "scene");
+    }
+  this->TracedStates.push_back(broker->GetTracing());
   bool wasBatchProcessing = this->IsBatchProcessing();
   bool wasInState = ((this->GetStates() & state ) == state);
   this->States.push_back(state);
@@ -675,6 +722,9 @@ void vtkMRMLScene::EndState(unsigned long state)
     vtkWarningMacro("vtkMRMLScene::EndState found inconsistent state");
   }
   this->States.pop_back();
+  // the state may have started before tracing started
+  bool traced = this->TracedStates.back();
+  this->TracedStates.pop_back();
 
   bool isInState = ((this->GetStates() & state) == state);
   // vtkMRMLScene::BatchProcessState is handled after
@@ -690,6 +740,10 @@ void vtkMRMLScene::EndState(unsigned long state)
     this->InvokeEvent( StateEvent | EndEvent |
                        vtkMRMLScene::BatchProcessState );
     }
+  if (traced)
+    {
+    vtkEventBroker::GetInstance()->TraceEnd();
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -738,6 +792,132 @@ int vtkMRMLScene::Connect()
   return res;
 }
 
+//------------------------------------------------------------------------------
+namespace
+{
+
+//------------------------------------------------------------------------------
+/// Shared state of the threads reading the storage node files.
+struct DetachedReadJobs
+{
+  DetachedReadJobs() : NextJob(0), NumberOfCompletedJobs(0) {}
+
+  /// Read the next pending file. Returns false if there is no more file to read.
+  bool RunNextJob()
+  {
+    this->Lock.Lock();
+    if (this->NextJob >= this->StorageNodes.size())
+      {
+      this->Lock.Unlock();
+      return false;
+      }
+    vtkMRMLStorageNode* storageNode = this->StorageNodes[this->NextJob++];
+    this->Lock.Unlock();
+
+    storageNode->ReadDataDetached();
+
+    this->Lock.Lock();
+    ++this->NumberOfCompletedJobs;
+    this->Lock.Unlock();
+    return true;
+  }
+
+  int GetNumberOfCompletedJobs()
+  {
+    this->Lock.Lock();
+    int numberOfCompletedJobs = this->NumberOfCompletedJobs;
+    this->Lock.Unlock();
+    return numberOfCompletedJobs;
+  }
+
+  std::vector<vtkMRMLStorageNode*> StorageNodes;
+  size_t NextJob;
+  int NumberOfCompletedJobs;
+  vtkSimpleMutexLock Lock;
+};
+
+//------------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ReadDataDetachedThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  DetachedReadJobs* jobs = static_cast<DetachedReadJobs*>(info->UserData);
+  while (jobs->RunNextJob())
+    {
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
+//------------------------------------------------------------------------------
+void vtkMRMLScene::ReadDataDetached(vtkCollection* nodes)
+{
+  int numberOfThreads = this->NumberOfReadDataThreads;
+  if (!this->ReadDataOnLoad || numberOfThreads < 2)
+    {
+    // The files are read sequentially by UpdateScene()
+    return;
+    }
+  DetachedReadJobs jobs;
+  vtkMRMLNode *node = NULL;
+  vtkCollectionSimpleIterator it;
+  for (nodes->InitTraversal(it);
+       (node = vtkMRMLNode::SafeDownCast(nodes->GetNextItemAsObject(it))) ;)
+    {
+    vtkMRMLStorableNode* storableNode = vtkMRMLStorableNode::SafeDownCast(node);
+    if (!storableNode || !storableNode->GetAddToScene())
+      {
+      continue;
+      }
+    // Storage node references are not observed yet, look them up by ID.
+    for (int i = 0; i < storableNode->GetNumberOfStorageNodes(); ++i)
+      {
+      const char* storageNodeID = storableNode->GetNthStorageNodeID(i);
+      vtkMRMLStorageNode* storageNode = vtkMRMLStorageNode::SafeDownCast(
+        storageNodeID ? this->GetNodeByID(storageNodeID) : NULL);
+      if (storageNode && storageNode->PrepareReadDataDetached(storableNode))
+        {
+        jobs.StorageNodes.push_back(storageNode);
+        }
+      }
+    }
+
+  numberOfThreads = std::min(numberOfThreads, static_cast<int>(jobs.StorageNodes.size()));
+  numberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  if (jobs.StorageNodes.empty())
+    {
+    return;
+    }
+
+  vtkDebugMacro("ReadDataDetached: reading " << jobs.StorageNodes.size()
+                << " files with " << numberOfThreads << " threads");
+  vtkNew<vtkMultiThreader> threader;
+  std::vector<int> threadIDs;
+  for (int i = 1; i < numberOfThreads; ++i)
+    {
+    int threadID = threader->SpawnThread(ReadDataDetachedThread, &jobs);
+    if (threadID >= 0)
+      {
+      threadIDs.push_back(threadID);
+      }
+    }
+  // The main thread reads files as well and reports the progress (in
+  // percent of the files read): the storage nodes don't invoke events
+  // while reading detached data.
+  int numberOfJobs = static_cast<int>(jobs.StorageNodes.size());
+  while (jobs.RunNextJob())
+    {
+    this->ProgressState(vtkMRMLScene::BatchProcessState,
+                        100 * jobs.GetNumberOfCompletedJobs() / numberOfJobs);
+    }
+  for (size_t i = 0; i < threadIDs.size(); ++i)
+    {
+    threader->TerminateThread(threadIDs[i]);
+    }
+  this->ProgressState(vtkMRMLScene::BatchProcessState, 100);
+}
+
 //------------------------------------------------------------------------------
 int vtkMRMLScene::Import()
 {
@@ -798,6 +978,10 @@ int vtkMRMLScene::Import()
 
     this->InvokeEvent(vtkMRMLScene::NewSceneEvent, NULL);
 
+    // Read the bulk data files concurrently, UpdateScene() then attaches
+    // the data to the nodes.
+    this->ReadDataDetached(addedNodes);
+
     // Notify the imported nodes about that all nodes are created
     // (so the observers can be attached to referenced nodes, etc.)
     // by calling UpdateScene on each node
@@ -1183,10 +1367,13 @@ vtkMRMLNode* vtkMRMLScene::AddNodeNoNotify(vtkMRMLNode *n)
     n->SetName(this->GenerateUniqueName(n).c_str());
     }
   n->SetScene( this );
+  this->UpdateNodesByClass();
   this->Nodes->vtkCollection::AddItem((vtkObject *)n);
 
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  this->AddNodeByClass(n);
+  this->AddNodeToUndoStack(n);
 
   //n->OnNodeAddedToScene();
 
@@ -1345,10 +1532,22 @@ void vtkMRMLScene::RemoveNode(vtkMRMLNode *n)
     {
     n->SetScene(0);
     }
+  this->UpdateNodesByClass();
   this->Nodes->vtkCollection::RemoveItem((vtkObject *)n);
 
   std::string nid=n->GetID();
   this->RemoveNodeID(n->GetID());
+  if (this->IsClosing())
+    {
+    // all the nodes are being removed, don't update the lists one node at
+    // a time.
+    this->ClearNodesByClass();
+    }
+  else
+    {
+    this->RemoveNodeByClass(n);
+    }
+  this->RemoveNodeFromUndoStack(n);
 
   this->InvokeEvent(vtkMRMLScene::NodeRemovedEvent, n);
 
@@ -1526,18 +1725,7 @@ int vtkMRMLScene::GetNumberOfNodesByClass(const char *className)
     vtkErrorMacro("GetNumberOfNodesByClass: class name is null.");
     return 0;
     }
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
-    {
-    if (node->IsA(className))
-      {
-      num++;
-      }
-    }
-  return num;
+  return static_cast<int>(this->GetNodesByClassIndex(className).size());
 }
 
 //------------------------------------------------------------------------------
@@ -1549,16 +1737,8 @@ int vtkMRMLScene::GetNodesByClass(const char *className, std::vector<vtkMRMLNode
     vtkErrorMacro("GetNodesByClass: class name is null.");
     return 0;
     }
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
-    {
-    if (node->IsA(className))
-      {
-      nodes.push_back(node);
-      }
-    }
+  const std::vector<vtkMRMLNode*>& classNodes = this->GetNodesByClassIndex(className);
+  nodes.insert(nodes.end(), classNodes.begin(), classNodes.end());
   return static_cast<int>(nodes.size());
 }
 
@@ -1571,15 +1751,10 @@ vtkCollection* vtkMRMLScene::GetNodesByClass(const char *className)
     return 0;
     }
   vtkCollection* nodes = vtkCollection::New();
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const std::vector<vtkMRMLNode*>& classNodes = this->GetNodesByClassIndex(className);
+  for (std::vector<vtkMRMLNode*>::const_iterator it = classNodes.begin(); it != classNodes.end(); ++it)
     {
-    if (node->IsA(className))
-      {
-      nodes->AddItem(node);
-      }
+    nodes->AddItem(*it);
     }
   return nodes;
 }
@@ -1716,22 +1891,12 @@ vtkMRMLNode* vtkMRMLScene::GetNthNodeByClass(int n, const char *className)
     return NULL;
     }
 
-  int num=0;
-  vtkMRMLNode *node;
-  vtkCollectionSimpleIterator it;
-  for (this->Nodes->InitTraversal(it);
-       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it)) ;)
+  const std::vector<vtkMRMLNode*>& classNodes = this->GetNodesByClassIndex(className);
+  if (n >= static_cast<int>(classNodes.size()))
     {
-    if (node->IsA(className))
-      {
-      if (num == n)
-        {
-        return node;
-        }
-      num++;
-      }
+    return NULL;
     }
-  return NULL;
+  return classNodes[n];
 }
 
 //------------------------------------------------------------------------------
@@ -1964,6 +2129,9 @@ vtkMRMLNode* vtkMRMLScene::InsertAfterNode(vtkMRMLNode *item, vtkMRMLNode *n)
     }
   // cache the node so the whole scene cache stays up-to-date
   this->AddNodeID(n);
+  // the node is not at the end of the collection
+  this->ClearNodesByClass();
+  this->AddNodeToUndoStack(n);
 
   n->SetDisableModifiedEvent(modifyStatus);
 
@@ -2049,6 +2217,9 @@ vtkMRMLNode* vtkMRMLScene::InsertBeforeNode(vtkMRMLNode *item, vtkMRMLNode *n)
     }
   // cache the node so the whole scene cache stays up-todate
   this->AddNodeID(n);
+  // the node is not at the end of the collection
+  this->ClearNodesByClass();
+  this->AddNodeToUndoStack(n);
 
   n->SetDisableModifiedEvent(modifyStatus);
 
@@ -2067,6 +2238,7 @@ void vtkMRMLScene::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Version = " << (this->GetVersion() ? this->GetVersion() : "NULL") << "\n";
   os << indent << "LastLoadedVersion = " << (this->GetLastLoadedVersion() ? this->GetLastLoadedVersion() : "NULL") << "\n";
   os << indent << "ErrorCode = " << this->ErrorCode << "\n";
+  os << indent << "NumberOfReadDataThreads = " << this->NumberOfReadDataThreads << "\n";
   os << indent << "URL = " << this->GetURL() << "\n";
   os << indent << "Root Directory = " << this->GetRootDirectory() << "\n";
 
@@ -2346,7 +2518,7 @@ void vtkMRMLScene::SaveStateForUndo (vtkMRMLNode *node)
   this->PushIntoUndoStack();
   if ( node && !node->IsA("vtkMRMLSceneViewNode"))
     {
-    this->CopyNodeInUndoStack(node);
+    this->CopyNodeInUndoLevel(node, this->UndoStack.back());
     }
 }
 
@@ -2376,7 +2548,7 @@ void vtkMRMLScene::SaveStateForUndo (std::vector<vtkMRMLNode *> nodes)
     vtkMRMLNode *node = nodes[n];
     if (node && !node->IsA("vtkMRMLSceneViewNode"))
       {
-      this->CopyNodeInUndoStack(node);
+      this->CopyNodeInUndoLevel(node, this->UndoStack.back());
       }
     }
 }
@@ -2415,7 +2587,7 @@ void vtkMRMLScene::SaveStateForUndo (vtkCollection* nodes)
     vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(nodes->GetItemAsObject(n));
     if (node && !node->IsA("vtkMRMLSceneViewNode"))
       {
-      this->CopyNodeInUndoStack(node);
+      this->CopyNodeInUndoLevel(node, this->UndoStack.back());
       }
     }
 }
@@ -2428,394 +2600,561 @@ void vtkMRMLScene::SaveStateForUndo ()
     return;
     }
 
-  if (this->IsBatchProcessing())
+  if (this->InUndo)
     {
     return;
     }
-  if (this->Nodes)
+
+  if (this->IsBatchProcessing())
     {
-    this->SaveStateForUndo(this->Nodes);
+    return;
     }
-}
 
-//------------------------------------------------------------------------------
-// Make a new collection that has pointers to all the nodes in the current scene
-void vtkMRMLScene::PushIntoUndoStack()
-{
-  if (this->Nodes == NULL)
+  if (!this->Nodes)
     {
     return;
     }
 
-  vtkCollection* newScene = vtkCollection::New();
-
-  vtkCollection* currentScene = this->Nodes;
-
-  int nnodes = currentScene->GetNumberOfItems();
+  this->ClearRedoStack();
+  this->PushIntoUndoStack();
+  UndoLevel* level = this->UndoStack.back();
+  level->AllNodes = true;
 
-  for (int n=0; n<nnodes; n++)
+  // Only copy the nodes modified since their latest copy, the others are
+  // restored from the copies of the lower levels.
+  vtkMRMLNode *node = NULL;
+  vtkCollectionSimpleIterator it;
+  for (this->Nodes->InitTraversal(it);
+    (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it));)
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
+    if (!node->GetID() || node->IsA("vtkMRMLSceneViewNode"))
       {
-      newScene->AddItem(node);
+      continue;
+      }
+    std::map< std::string, UndoBaselineNode >::iterator baselineIt =
+      this->UndoBaseline.find(node->GetID());
+    if (baselineIt != this->UndoBaseline.end() &&
+        baselineIt->second.Saved.MTime == node->GetMTime())
+      {
+      continue;
       }
+    this->CopyNodeInUndoLevel(node, level);
     }
-
-  //TODO check max stack size
-  this->UndoStack.push_back(newScene);
 }
 
 //------------------------------------------------------------------------------
-// Make a new collection that has pointers to the current scene nodes
-void vtkMRMLScene::PushIntoRedoStack()
+namespace
 {
-  if (this->Nodes == NULL)
-    {
-    return;
-    }
 
-  vtkCollection* newScene = vtkCollection::New();
+/// Rough estimate of the memory used by the properties of a node copy, in KiB.
+const unsigned long UNDO_NODE_COPY_SIZE = 2;
 
-  vtkCollection* currentScene = this->Nodes;
-
-  int nnodes = currentScene->GetNumberOfItems();
+}
 
-  for (int n=0; n<nnodes; n++)
+//------------------------------------------------------------------------------
+// Start a new level of changes on the undo stack
+void vtkMRMLScene::PushIntoUndoStack()
+{
+  // discard the oldest levels to stay within the limits
+  while (!this->UndoStack.empty() &&
+         ((this->UndoStackSize > 0 &&
+           static_cast<int>(this->UndoStack.size()) >= this->UndoStackSize) ||
+          (this->UndoMemoryLimit > 0 &&
+           this->UndoMemorySize > static_cast<unsigned long>(this->UndoMemoryLimit) * 1024)))
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
-      {
-      newScene->AddItem(node);
-      }
+    this->DiscardOldestUndoLevel();
     }
+  this->UndoStack.push_back(new UndoLevel);
+}
 
-  //TODO check max stack size
-  this->RedoStack.push_back(newScene);
+//------------------------------------------------------------------------------
+// Start a new level of changes on the redo stack
+void vtkMRMLScene::PushIntoRedoStack()
+{
+  this->RedoStack.push_back(new UndoLevel);
 }
 
 //------------------------------------------------------------------------------
-// Put a replacement node into the undoable copy of the scene so that the node
-// can be edited
-void vtkMRMLScene::CopyNodeInUndoStack(vtkMRMLNode *copyNode)
+void vtkMRMLScene::DiscardOldestUndoLevel()
 {
-  if (!copyNode)
+  if (this->UndoStack.empty())
     {
-    vtkErrorMacro("CopyNodeInUndoStack: node is null");
     return;
     }
+  UndoLevel* oldestLevel = this->UndoStack.front();
+  this->UndoStack.pop_front();
 
-  vtkMRMLNode *snode = copyNode->CreateNodeInstance();
-  if (snode != NULL)
+  bool allNodesLevel = false;
+  std::list< UndoLevel* >::iterator levelIt;
+  for (levelIt = this->UndoStack.begin(); levelIt != this->UndoStack.end() && !allNodesLevel; ++levelIt)
     {
-    snode->CopyWithScene(copyNode);
+    allNodesLevel = (*levelIt)->AllNodes;
     }
-  vtkCollection* undoScene = dynamic_cast < vtkCollection *>( this->UndoStack.back() );
-  int nnodes = undoScene->GetNumberOfItems();
-  for (int n=0; n<nnodes; n++)
+  if (allNodesLevel)
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-    if (node == copyNode)
+    // The levels saved for all nodes restore the nodes left unmodified
+    // since the oldest level from its copies: keep them in the next level.
+    UndoLevel* nextLevel = this->UndoStack.front();
+    std::map< std::string, UndoLevel::SavedNode >* savedNodes[2] =
+      { &oldestLevel->SavedNodes, &oldestLevel->InheritedNodes };
+    for (int i = 0; i < 2; ++i)
       {
-      undoScene->ReplaceItem (n, snode);
-      break;
+      std::map< std::string, UndoLevel::SavedNode >::iterator savedIt;
+      for (savedIt = savedNodes[i]->begin(); savedIt != savedNodes[i]->end(); ++savedIt)
+        {
+        const std::string& id = savedIt->first;
+        if (nextLevel->SavedNodes.count(id) || nextLevel->InheritedNodes.count(id))
+          {
+          continue;
+          }
+        nextLevel->InheritedNodes[id] = savedIt->second;
+        // the memory charged for the copy moves along with it
+        vtkObject* copy = savedIt->second.Copy;
+        std::pair< std::multimap< vtkObject*, vtkObject* >::iterator,
+                   std::multimap< vtkObject*, vtkObject* >::iterator > charges =
+          oldestLevel->Charges.equal_range(copy);
+        nextLevel->Charges.insert(charges.first, charges.second);
+        oldestLevel->Charges.erase(charges.first, charges.second);
+        std::map< std::string, UndoBaselineNode >::iterator baselineIt = this->UndoBaseline.find(id);
+        if (baselineIt != this->UndoBaseline.end() && baselineIt->second.Level == oldestLevel)
+          {
+          baselineIt->second.Level = nextLevel;
+          }
+        }
       }
     }
-  snode->Delete();
+  this->RemoveUndoLevelFromBaseline(oldestLevel);
+  this->DeleteUndoLevel(oldestLevel);
 }
 
 //------------------------------------------------------------------------------
-// Put a replacement node into the redoable copy of the scene so that the node
-// can be replaced by the Undo version
-void vtkMRMLScene::CopyNodeInRedoStack(vtkMRMLNode *copyNode)
+void vtkMRMLScene::DeleteUndoLevel(UndoLevel* level)
 {
-  if (!copyNode)
+  std::multimap< vtkObject*, vtkObject* >::iterator chargeIt;
+  for (chargeIt = level->Charges.begin(); chargeIt != level->Charges.end(); ++chargeIt)
     {
-    vtkErrorMacro("CopyNodeInRedoStack: node is null");
-    return;
+    this->ReleaseUndoObject(chargeIt->second);
     }
-  vtkMRMLNode *snode = copyNode->CreateNodeInstance();
-  if (snode != NULL)
-    {
-    snode->CopyWithSceneWithSingleModifiedEvent(copyNode);
-    }
-  vtkCollection* undoScene = dynamic_cast < vtkCollection *>( this->RedoStack.back() );
-  int nnodes = undoScene->GetNumberOfItems();
-  for (int n=0; n<nnodes; n++)
-    {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-    if (node == copyNode)
-      {
-      undoScene->ReplaceItem (n, snode);
-      break;
-      }
-    }
-  snode->Delete();
+  delete level;
 }
 
 //------------------------------------------------------------------------------
-// Replace the current scene by the top of the undo stack
-// -- move the current scene on the redo stack
-void vtkMRMLScene::Undo()
+void vtkMRMLScene::CopyNodeInUndoLevel(vtkMRMLNode *copyNode, UndoLevel* level)
 {
-  if (!this->UndoFlag)
+  if (!copyNode)
     {
+    vtkErrorMacro("CopyNodeInUndoLevel: node is null");
     return;
     }
-
-  if (this->UndoStack.size() == 0)
+  if (!copyNode->GetID())
     {
+    vtkErrorMacro("CopyNodeInUndoLevel: node has no ID");
     return;
     }
-
-  this->RemoveUnusedNodeReferences();
-
-  this->InUndo = true;
-
-  int nnodes;
-  int n;
-  unsigned int nn;
-
-  PushIntoRedoStack();
-
-  vtkCollection* currentScene = this->Nodes;
-  // We use 2 vectors instead of a map in order to keep the ordering of the
-  // nodes.
-  std::vector<std::string> currentIDs;
-  std::vector<vtkMRMLNode*> currentNodes;
-  nnodes = currentScene->GetNumberOfItems();
-  for (n=0; n<nnodes; n++)
+  std::string id = copyNode->GetID();
+  bool undoStackLevel = (!this->UndoStack.empty() && level == this->UndoStack.back());
+  UndoLevel::SavedNode savedNode;
+  if (undoStackLevel)
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
+    std::map< std::string, UndoBaselineNode >::iterator baselineIt = this->UndoBaseline.find(id);
+    if (baselineIt != this->UndoBaseline.end())
       {
-      currentIDs.push_back(node->GetID());
-      currentNodes.push_back(node);
+      if (baselineIt->second.Saved.MTime == copyNode->GetMTime())
+        {
+        // the node has not been modified since its latest copy, share it
+        savedNode = baselineIt->second.Saved;
+        }
+      else
+        {
+        // the bulk data of the latest copy that the node doesn't reference
+        // anymore is only kept alive by the history now
+        this->ChargeUndoNode(baselineIt->second.Level, baselineIt->second.Saved.Copy, copyNode);
+        }
       }
     }
+  if (savedNode.Copy.GetPointer() == NULL)
+    {
+    vtkSmartPointer<vtkMRMLNode> snode =
+      vtkSmartPointer<vtkMRMLNode>::Take(copyNode->CreateNodeInstance());
+    if (snode.GetPointer() == NULL)
+      {
+      return;
+      }
+    // bulk data (image data, meshes) is shared, not copied
+    snode->CopyWithScene(copyNode);
+    savedNode.Copy = snode;
+    savedNode.MTime = copyNode->GetMTime();
+    }
 
-  vtkCollection* undoScene = NULL;
-  std::vector<std::string> undoIDs;
-  std::vector<vtkMRMLNode*> undoNodes;
+  std::map< std::string, UndoLevel::SavedNode >::iterator savedIt = level->SavedNodes.find(id);
+  if (savedIt != level->SavedNodes.end())
+    {
+    if (savedIt->second.Copy == savedNode.Copy)
+      {
+      return;
+      }
+    this->ReleaseUndoNode(level, savedIt->second.Copy);
+    }
+  level->SavedNodes[id] = savedNode;
+  this->ChargeUndoNode(level, savedNode.Copy, copyNode);
+  if (undoStackLevel)
+    {
+    UndoBaselineNode& baseline = this->UndoBaseline[id];
+    baseline.Saved = savedNode;
+    baseline.Level = level;
+    }
+}
 
-  if (!this->UndoStack.empty())
+//------------------------------------------------------------------------------
+vtkMRMLScene::UndoLevel* vtkMRMLScene::FindSavedNode(const std::string& id,
+  UndoLevel* level, UndoLevel::SavedNode& savedNode)
+{
+  std::list< UndoLevel* >::reverse_iterator levelIt = this->UndoStack.rbegin();
+  UndoLevel* currentLevel = level;
+  if (!currentLevel && levelIt != this->UndoStack.rend())
     {
-    undoScene = dynamic_cast < vtkCollection *>( this->UndoStack.back() );
-    nnodes = undoScene->GetNumberOfItems();
-    for (n=0; n<nnodes; n++)
+    currentLevel = *levelIt;
+    ++levelIt;
+    }
+  while (currentLevel)
+    {
+    std::map< std::string, UndoLevel::SavedNode >* savedNodes[2] =
+      { &currentLevel->SavedNodes, &currentLevel->InheritedNodes };
+    for (int i = 0; i < 2; ++i)
       {
-      vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-      if (node && !node->IsA("vtkMRMLSceneViewNode"))
+      std::map< std::string, UndoLevel::SavedNode >::iterator savedIt = savedNodes[i]->find(id);
+      if (savedIt != savedNodes[i]->end())
         {
-        undoIDs.push_back(node->GetID());
-        undoNodes.push_back(node);
+        savedNode = savedIt->second;
+        return currentLevel;
         }
       }
+    currentLevel = NULL;
+    if (levelIt != this->UndoStack.rend())
+      {
+      currentLevel = *levelIt;
+      ++levelIt;
+      }
     }
+  return NULL;
+}
 
-  std::vector<std::string>::iterator iterID;
-  std::vector<vtkMRMLNode*>::iterator iterNode;
-  std::vector<std::string>::iterator curIterID;
-  std::vector<vtkMRMLNode*>::iterator curIterNode;
-
-  // copy back changes and add deleted nodes to the current scene
-  std::vector<vtkMRMLNode*> addNodes;
-
-  for(iterID=undoIDs.begin(), iterNode = undoNodes.begin(); iterID != undoIDs.end(); iterID++, iterNode++)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RemoveUndoLevelFromBaseline(UndoLevel* level)
+{
+  std::map< std::string, UndoLevel::SavedNode >* savedNodes[2] =
+    { &level->SavedNodes, &level->InheritedNodes };
+  for (int i = 0; i < 2; ++i)
     {
-    curIterID = std::find(currentIDs.begin(), currentIDs.end(), *iterID);
-    curIterNode = currentNodes.begin() + std::distance(currentIDs.begin(), curIterID);
-    if ( curIterID == currentIDs.end() )
+    std::map< std::string, UndoLevel::SavedNode >::iterator savedIt;
+    for (savedIt = savedNodes[i]->begin(); savedIt != savedNodes[i]->end(); ++savedIt)
       {
-      // the node was deleted, add Node back to the curreent scene
-      addNodes.push_back(*iterNode);
-      }
-    else if (*iterNode != *curIterNode)
-      {
-      // nodes differ, copy from undo to current scene
-      // but before create a copy in redo stack from current
-      this->CopyNodeInRedoStack(*curIterNode);
-      (*curIterNode)->CopyWithSceneWithSingleModifiedEvent(*iterNode);
+      std::map< std::string, UndoBaselineNode >::iterator baselineIt = this->UndoBaseline.find(savedIt->first);
+      if (baselineIt == this->UndoBaseline.end() || baselineIt->second.Level != level)
+        {
+        continue;
+        }
+      UndoLevel::SavedNode savedNode;
+      UndoLevel* savedLevel = this->FindSavedNode(savedIt->first, NULL, savedNode);
+      if (savedLevel)
+        {
+        baselineIt->second.Saved = savedNode;
+        baselineIt->second.Level = savedLevel;
+        }
+      else
+        {
+        this->UndoBaseline.erase(baselineIt);
+        }
       }
     }
+}
 
-  // remove new nodes created before Undo
-  std::vector<vtkMRMLNode*> removeNodes;
-  for(curIterID=currentIDs.begin(), curIterNode = currentNodes.begin(); curIterID != currentIDs.end(); curIterID++, curIterNode++)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::ChargeUndoObject(UndoLevel* level, vtkObject* owner,
+                                    vtkObject* object, unsigned long size)
+{
+  std::pair< std::multimap< vtkObject*, vtkObject* >::iterator,
+             std::multimap< vtkObject*, vtkObject* >::iterator > charges =
+    level->Charges.equal_range(owner);
+  for (std::multimap< vtkObject*, vtkObject* >::iterator chargeIt = charges.first;
+       chargeIt != charges.second; ++chargeIt)
     {
-    iterID = std::find(undoIDs.begin(),undoIDs.end(), *curIterID);
-    // Remove only if the node is not present in the previous state.
-    if ( iterID == undoIDs.end() )
+    if (chargeIt->second == object)
       {
-      removeNodes.push_back(*curIterNode);
+      // already charged
+      return;
       }
     }
+  level->Charges.insert(std::make_pair(owner, object));
+  std::map< vtkObject*, UndoCharge >::iterator chargeIt = this->UndoCharges.find(object);
+  if (chargeIt != this->UndoCharges.end())
+    {
+    ++chargeIt->second.References;
+    return;
+    }
+  UndoCharge charge;
+  charge.References = 1;
+  charge.Size = size;
+  this->UndoCharges[object] = charge;
+  this->UndoMemorySize += size;
+}
 
-  for (nn=0; nn<addNodes.size(); nn++)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::ChargeUndoNode(UndoLevel* level, vtkMRMLNode* node, vtkMRMLNode* liveNode)
+{
+  this->ChargeUndoObject(level, node, node, UNDO_NODE_COPY_SIZE);
+  std::vector<vtkDataObject*> dataObjects;
+  node->GetBulkDataObjects(dataObjects);
+  std::vector<vtkDataObject*> liveDataObjects;
+  if (liveNode)
     {
-    this->AddNode(addNodes[nn]);
+    liveNode->GetBulkDataObjects(liveDataObjects);
     }
-  for (nn=0; nn<removeNodes.size(); nn++)
+  for (std::vector<vtkDataObject*>::iterator dataIt = dataObjects.begin(); dataIt != dataObjects.end(); ++dataIt)
     {
-    vtkMRMLNode* nodeToRemove = removeNodes[nn];
-    // Maybe the node has been removed already by a side effect of a previous
-    // node removal.
-    if (this->IsNodePresent(nodeToRemove))
+    // bulk data still referenced by the scene doesn't use undo memory
+    if (std::find(liveDataObjects.begin(), liveDataObjects.end(), *dataIt) == liveDataObjects.end())
       {
-      this->RemoveNode(nodeToRemove);
+      this->ChargeUndoObject(level, node, *dataIt, (*dataIt)->GetActualMemorySize());
       }
     }
+}
 
-  if (undoScene)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::ReleaseUndoNode(UndoLevel* level, vtkObject* owner)
+{
+  std::pair< std::multimap< vtkObject*, vtkObject* >::iterator,
+             std::multimap< vtkObject*, vtkObject* >::iterator > charges =
+    level->Charges.equal_range(owner);
+  for (std::multimap< vtkObject*, vtkObject* >::iterator chargeIt = charges.first;
+       chargeIt != charges.second; ++chargeIt)
     {
-    undoScene->RemoveAllItems();
-    undoScene->Delete();
+    this->ReleaseUndoObject(chargeIt->second);
     }
-
-  this->RemoveUnusedNodeReferences();
-
-  if (!this->UndoStack.empty())
-   {
-   UndoStack.pop_back();
-   }
-  this->Modified();
-
-  this->InUndo = false;
+  level->Charges.erase(charges.first, charges.second);
 }
 
 //------------------------------------------------------------------------------
-void vtkMRMLScene::Redo()
+void vtkMRMLScene::ReleaseUndoObject(vtkObject* object)
 {
-  if (!this->UndoFlag)
+  std::map< vtkObject*, UndoCharge >::iterator chargeIt = this->UndoCharges.find(object);
+  if (chargeIt == this->UndoCharges.end())
     {
     return;
     }
-
-  if (this->RedoStack.size() == 0)
+  if (--chargeIt->second.References > 0)
     {
     return;
     }
+  this->UndoMemorySize -= chargeIt->second.Size;
+  this->UndoCharges.erase(chargeIt);
+}
 
-  int nnodes;
-  int n;
-  unsigned int nn;
-
-  this->RemoveUnusedNodeReferences();
+//------------------------------------------------------------------------------
+void vtkMRMLScene::AddNodeToUndoStack(vtkMRMLNode *node)
+{
+  if (!this->UndoFlag || this->InUndo || this->UndoStack.empty() ||
+      node->IsA("vtkMRMLSceneViewNode"))
+    {
+    return;
+    }
+  UndoLevel* level = this->UndoStack.back();
+  std::vector< vtkSmartPointer<vtkMRMLNode> >::iterator removedIt =
+    std::find(level->RemovedNodes.begin(), level->RemovedNodes.end(), node);
+  if (removedIt != level->RemovedNodes.end())
+    {
+    // removed then added back, nothing to undo
+    this->ReleaseUndoNode(level, node);
+    level->RemovedNodes.erase(removedIt);
+    return;
+    }
+  level->AddedNodes.push_back(node);
+}
 
-  PushIntoUndoStack();
+//------------------------------------------------------------------------------
+void vtkMRMLScene::RemoveNodeFromUndoStack(vtkMRMLNode *node)
+{
+  if (!this->UndoFlag || this->InUndo || this->UndoStack.empty() ||
+      node->IsA("vtkMRMLSceneViewNode"))
+    {
+    return;
+    }
+  UndoLevel* level = this->UndoStack.back();
+  std::vector< vtkSmartPointer<vtkMRMLNode> >::iterator addedIt =
+    std::find(level->AddedNodes.begin(), level->AddedNodes.end(), node);
+  if (addedIt != level->AddedNodes.end())
+    {
+    // added then removed, nothing to undo
+    level->AddedNodes.erase(addedIt);
+    return;
+    }
+  level->RemovedNodes.push_back(node);
+  this->ChargeUndoNode(level, node, NULL);
+}
 
-  vtkCollection* currentScene = this->Nodes;
-  //std::hash_map<std::string, vtkMRMLNode*> currentMap;
-  std::map<std::string, vtkMRMLNode*> currentMap;
-  nnodes = currentScene->GetNumberOfItems();
-  for (n=0; n<nnodes; n++)
+//------------------------------------------------------------------------------
+void vtkMRMLScene::ApplyUndoLevel(UndoLevel* level, UndoLevel* inverseLevel)
+{
+  // add back the removed nodes, in the reverse order of their removal
+  std::vector< vtkSmartPointer<vtkMRMLNode> >::reverse_iterator nodeIt;
+  for (nodeIt = level->RemovedNodes.rbegin(); nodeIt != level->RemovedNodes.rend(); ++nodeIt)
     {
-    vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(currentScene->GetItemAsObject(n));
-    if (node && !node->IsA("vtkMRMLSceneViewNode"))
+    if (!this->IsNodePresent(*nodeIt))
       {
-      currentMap[node->GetID()] = node;
+      this->AddNode(*nodeIt);
+      inverseLevel->AddedNodes.push_back(*nodeIt);
       }
     }
 
-  //std::hash_map<std::string, vtkMRMLNode*> undoMap;
-  std::map<std::string, vtkMRMLNode*> undoMap;
-
-  vtkCollection* undoScene = NULL;
-
-  if (!this->RedoStack.empty())
+  // find the nodes that have been modified since they were saved
+  std::vector< std::pair< vtkSmartPointer<vtkMRMLNode>, vtkSmartPointer<vtkMRMLNode> > > modifiedNodes;
+  if (level->AllNodes)
     {
-    undoScene = dynamic_cast < vtkCollection *>( this->RedoStack.back() );;
-    nnodes = undoScene->GetNumberOfItems();
-    for (n=0; n<nnodes; n++)
+    // nodes without a copy in the level are restored from the lower levels
+    vtkMRMLNode *node = NULL;
+    vtkCollectionSimpleIterator it;
+    for (this->Nodes->InitTraversal(it);
+      (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(it));)
       {
-      vtkMRMLNode *node  = dynamic_cast < vtkMRMLNode *>(undoScene->GetItemAsObject(n));
-      if (node && !node->IsA("vtkMRMLSceneViewNode"))
+      if (!node->GetID() || node->IsA("vtkMRMLSceneViewNode"))
+        {
+        continue;
+        }
+      UndoLevel::SavedNode savedNode;
+      if (this->FindSavedNode(node->GetID(), level, savedNode) &&
+          node->GetMTime() != savedNode.MTime)
         {
-        undoMap[node->GetID()] = node;
+        modifiedNodes.push_back(std::make_pair(
+          vtkSmartPointer<vtkMRMLNode>(node), savedNode.Copy));
         }
       }
     }
-
-  //std::hash_map<std::string, vtkMRMLNode*>::iterator iter;
-  //std::hash_map<std::string, vtkMRMLNode*>::iterator curIter;
-  std::map<std::string, vtkMRMLNode*>::iterator iter;
-  std::map<std::string, vtkMRMLNode*>::iterator curIter;
-
-  // copy back changes and add deleted nodes to the current scene
-  std::vector<vtkMRMLNode*> addNodes;
-
-  for(iter=undoMap.begin(); iter != undoMap.end(); iter++)
+  else
     {
-    curIter = currentMap.find(iter->first);
-    if ( curIter == currentMap.end() )
+    std::map< std::string, UndoLevel::SavedNode >::iterator savedIt;
+    for (savedIt = level->SavedNodes.begin(); savedIt != level->SavedNodes.end(); ++savedIt)
       {
-      // the node was deleted, add Node back to the curreent scene
-      addNodes.push_back(iter->second);
-      }
-    else if (iter->second != curIter->second)
-      {
-      // nodes differ, copy from redo to current scene
-      // but before create a copy in undo stack from current
-      this->CopyNodeInUndoStack(curIter->second);
-      curIter->second->CopyWithSceneWithSingleModifiedEvent(iter->second);
+      vtkMRMLNode* node = this->GetNodeByID(savedIt->first);
+      if (node && node->GetMTime() != savedIt->second.MTime)
+        {
+        modifiedNodes.push_back(std::make_pair(
+          vtkSmartPointer<vtkMRMLNode>(node), savedIt->second.Copy));
+        }
       }
     }
 
-  // remove new nodes created before Undo
-  std::vector<vtkMRMLNode*> removeNodes;
-  for(curIter=currentMap.begin(); curIter != currentMap.end(); curIter++)
+  // copy them back but before save a copy of their current state in the
+  // inverse level
+  for (size_t i = 0; i < modifiedNodes.size(); ++i)
+    {
+    this->CopyNodeInUndoLevel(modifiedNodes[i].first, inverseLevel);
+    modifiedNodes[i].first->CopyWithSceneWithSingleModifiedEvent(modifiedNodes[i].second);
+    }
+
+  // remove the added nodes, in the reverse order of their addition
+  for (nodeIt = level->AddedNodes.rbegin(); nodeIt != level->AddedNodes.rend(); ++nodeIt)
     {
-    iter = undoMap.find(curIter->first);
-    if ( iter == undoMap.end() )
+    // Maybe the node has been removed already by a side effect of a previous
+    // node removal.
+    if (this->IsNodePresent(*nodeIt))
       {
-      removeNodes.push_back(curIter->second);
+      this->RemoveNode(*nodeIt);
+      inverseLevel->RemovedNodes.push_back(*nodeIt);
+      this->ChargeUndoNode(inverseLevel, *nodeIt, NULL);
       }
     }
+}
 
-  for (nn=0; nn<addNodes.size(); nn++)
+//------------------------------------------------------------------------------
+// Revert the changes of the top of the undo stack
+// -- record how to redo them on the redo stack
+void vtkMRMLScene::Undo()
+{
+  if (!this->UndoFlag)
+    {
+    return;
+    }
+
+  if (this->UndoStack.size() == 0)
     {
-    this->AddNode(addNodes[nn]);
+    return;
     }
-  for (nn=0; nn<removeNodes.size(); nn++)
+
+  this->RemoveUnusedNodeReferences();
+
+  this->InUndo = true;
+
+  UndoLevel* undoLevel = this->UndoStack.back();
+  this->UndoStack.pop_back();
+  this->PushIntoRedoStack();
+  this->ApplyUndoLevel(undoLevel, this->RedoStack.back());
+  this->RemoveUndoLevelFromBaseline(undoLevel);
+  this->DeleteUndoLevel(undoLevel);
+
+  this->RemoveUnusedNodeReferences();
+
+  this->Modified();
+
+  this->InUndo = false;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLScene::Redo()
+{
+  if (!this->UndoFlag)
     {
-    this->RemoveNode(removeNodes[nn]);
+    return;
     }
 
-  if (undoScene)
+  if (this->RedoStack.size() == 0)
     {
-    undoScene->RemoveAllItems();
-    undoScene->Delete();
+    return;
     }
 
-  RedoStack.pop_back();
+  this->RemoveUnusedNodeReferences();
+
+  this->InUndo = true;
+
+  UndoLevel* redoLevel = this->RedoStack.back();
+  this->RedoStack.pop_back();
+  this->PushIntoUndoStack();
+  this->ApplyUndoLevel(redoLevel, this->UndoStack.back());
+  this->DeleteUndoLevel(redoLevel);
 
   this->Modified();
+
+  this->InUndo = false;
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLScene::ClearUndoStack()
 {
-  std::list< vtkCollection* >::iterator iter;
+  std::list< UndoLevel* >::iterator iter;
   for(iter=this->UndoStack.begin(); iter != this->UndoStack.end(); iter++)
     {
-    (*iter)->RemoveAllItems();
-    (*iter)->Delete();
+    this->DeleteUndoLevel(*iter);
     }
   this->UndoStack.clear();
+  this->UndoBaseline.clear();
 }
 
 //------------------------------------------------------------------------------
 void vtkMRMLScene::ClearRedoStack()
 {
-  std::list< vtkCollection* >::iterator iter;
+  std::list< UndoLevel* >::iterator iter;
   for(iter=this->RedoStack.begin(); iter != this->RedoStack.end(); iter++)
     {
-    (*iter)->RemoveAllItems();
-    (*iter)->Delete();
+    this->DeleteUndoLevel(*iter);
     }
   this->RedoStack.clear();
 }
 
+//------------------------------------------------------------------------------
+unsigned long vtkMRMLScene::GetUndoMemorySize()
+{
+  return this->UndoMemorySize;
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::AddReferencedNodeID(const char *id, vtkMRMLNode *referencingNode)
 {
@@ -3138,6 +3477,89 @@ void vtkMRMLScene::ClearNodeIDs()
   }
 }
 
+//-----------------------------------------------------------------------------
+const std::vector<vtkMRMLNode*>& vtkMRMLScene::GetNodesByClassIndex(const char* className)
+{
+  this->UpdateNodesByClass();
+  std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it =
+    this->NodesByClass.find(className);
+  if (it != this->NodesByClass.end())
+    {
+    return it->second;
+    }
+  std::vector<vtkMRMLNode*>& classNodes = this->NodesByClass[className];
+  vtkMRMLNode *node;
+  vtkCollectionSimpleIterator nodeIt;
+  for (this->Nodes->InitTraversal(nodeIt);
+       (node = (vtkMRMLNode*)this->Nodes->GetNextItemAsObject(nodeIt)) ;)
+    {
+    if (node->IsA(className))
+      {
+      classNodes.push_back(node);
+      }
+    }
+  return classNodes;
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::UpdateNodesByClass()
+{
+  if (this->Nodes && this->Nodes->GetMTime() > this->NodesByClassMTime)
+    {
+    this->ClearNodesByClass();
+    }
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::AddNodeByClass(vtkMRMLNode *node)
+{
+  if (!this->Nodes || !node)
+    {
+    return;
+    }
+  for (std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it = this->NodesByClass.begin();
+       it != this->NodesByClass.end(); ++it)
+    {
+    if (node->IsA(it->first.c_str()))
+      {
+      it->second.push_back(node);
+      }
+    }
+  this->NodesByClassMTime = this->Nodes->GetMTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::RemoveNodeByClass(vtkMRMLNode *node)
+{
+  if (!this->Nodes || !node)
+    {
+    return;
+    }
+  for (std::map< std::string, std::vector<vtkMRMLNode*> >::iterator it = this->NodesByClass.begin();
+       it != this->NodesByClass.end(); ++it)
+    {
+    if (node->IsA(it->first.c_str()))
+      {
+      std::vector<vtkMRMLNode*>::iterator nodeIt = std::find(it->second.begin(), it->second.end(), node);
+      if (nodeIt != it->second.end())
+        {
+        it->second.erase(nodeIt);
+        }
+      }
+    }
+  this->NodesByClassMTime = this->Nodes->GetMTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMRMLScene::ClearNodesByClass()
+{
+  if (this->Nodes)
+    {
+    this->NodesByClass.clear();
+    this->NodesByClassMTime = this->Nodes->GetMTime();
+    }
+}
+
 //------------------------------------------------------------------------------
 void vtkMRMLScene::AddURIHandler(vtkURIHandler *handler)
 {
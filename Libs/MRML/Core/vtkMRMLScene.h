@@ -280,7 +280,9 @@ public:
   /// Get number of nodes of a specified class in the scene
   int GetNumberOfNodesByClass(const char* className);
 
-  /// Get vector of nodes of a specified class in the scene
+  /// Get vector of nodes of a specified class in the scene.
+  /// \a nodes is cleared, then the nodes are added to it in scene order.
+  /// Returns the number of nodes in \a nodes.
   int GetNodesByClass(const char *className, std::vector<vtkMRMLNode *> &nodes);
 
   /// \warning You are responsible for deleting the returned collection.
@@ -348,13 +350,41 @@ public:
   /// clear Redo stack, delete redo history
   void ClearRedoStack();
 
+  /// Maximum number of undo steps kept in the history buffer, the oldest
+  /// steps are discarded first. 0 or less means no limit. Default is 100.
+  vtkSetMacro(UndoStackSize, int);
+  vtkGetMacro(UndoStackSize, int);
+
+  /// Maximum memory used by the undo and redo history, in MiB. The oldest
+  /// undo steps are discarded first. 0 or less means no limit.
+  /// Default is 1024.
+  /// \sa GetUndoMemorySize()
+  vtkSetMacro(UndoMemoryLimit, int);
+  vtkGetMacro(UndoMemoryLimit, int);
+
+  /// Estimate of the memory used by the undo and redo history, in KiB.
+  /// Node copies count for their properties and for the bulk data they do not
+  /// share with the node they are copied from (e.g. segments, transform grids).
+  /// Shared bulk data (image data, meshes) is counted once the node it was
+  /// copied from is saved again with different bulk data. Removed nodes count
+  /// with all their bulk data. The size is kept up to date as levels are
+  /// added and discarded.
+  /// \sa vtkMRMLNode::GetBulkDataObjects()
+  unsigned long GetUndoMemorySize();
+
   /// returns number of undo steps in the history buffer
   int GetNumberOfUndoLevels() { return (int)this->UndoStack.size();};
 
   /// returns number of redo steps in the history buffer
   int GetNumberOfRedoLevels() { return (int)this->RedoStack.size();};
 
-  /// Save current state in the undo buffer
+  /// Save current state in the undo buffer.
+  /// Only the nodes modified since they were last saved are copied, the
+  /// others are restored from the copies of the previous levels.
+  /// \note Node copies share image data and meshes with the scene nodes, but
+  /// segmentations and transforms are still deep copied by their Copy()
+  /// method: their bulk data is modified in place (e.g. by the segment
+  /// editor or the transform widgets), so it cannot be shared with the copy.
   void SaveStateForUndo();
 
   /// Save current state of the node in the undo buffer
@@ -468,6 +498,19 @@ public:
   vtkSetMacro(ReadDataOnLoad,int);
   vtkGetMacro(ReadDataOnLoad,int);
 
+  /// \brief Number of threads used by Import() to read the bulk data of
+  /// the storable nodes.
+  ///
+  /// Storage nodes that support it read their files concurrently into
+  /// detached nodes, the data is then attached to the scene nodes on the
+  /// main thread, in document order. 0 (default) or 1 reads all the files
+  /// sequentially, set it for example to
+  /// vtkMultiThreader::GetGlobalDefaultNumberOfThreads() to enable
+  /// concurrent reading.
+  /// \sa Import(), vtkMRMLStorageNode::PrepareReadDataDetached()
+  vtkSetMacro(NumberOfReadDataThreads, int);
+  vtkGetMacro(NumberOfReadDataThreads, int);
+
   void SetErrorMessage(const std::string &error);
   std::string GetErrorMessage();
 
@@ -704,11 +747,93 @@ protected:
   vtkMRMLScene();
   virtual ~vtkMRMLScene();
 
+  /// \brief Changes of the scene since a call to SaveStateForUndo().
+  ///
+  /// Only the nodes passed to SaveStateForUndo() are copied, along with their
+  /// modification time so that nodes left untouched are neither restored
+  /// nor copied again. Nodes added to or removed from the scene in the
+  /// meantime are journaled instead of diffing the whole scene.
+  struct UndoLevel
+  {
+    struct SavedNode
+    {
+      vtkSmartPointer<vtkMRMLNode> Copy;
+      vtkMTimeType MTime;
+    };
+    UndoLevel() : AllNodes(false) {}
+    /// Copies of the saved nodes, indexed by node ID.
+    std::map< std::string, SavedNode > SavedNodes;
+    /// Copies moved from the discarded older levels that the levels saved
+    /// for all nodes still need. They are not restored when undoing this
+    /// level.
+    std::map< std::string, SavedNode > InheritedNodes;
+    std::vector< vtkSmartPointer<vtkMRMLNode> > AddedNodes;
+    std::vector< vtkSmartPointer<vtkMRMLNode> > RemovedNodes;
+    /// True if the level was saved for all the nodes of the scene: the nodes
+    /// without a copy in this level had not been modified since their copy
+    /// in a lower level.
+    bool AllNodes;
+    /// Objects charged against the undo memory by this level, indexed by the
+    /// node copy or removed node they belong to.
+    std::multimap< vtkObject*, vtkObject* > Charges;
+  };
+
+  /// Latest copy of a node in the undo stack and the level holding it.
+  struct UndoBaselineNode
+  {
+    UndoLevel::SavedNode Saved;
+    UndoLevel* Level;
+  };
+
+  /// Memory used by an object referenced by the undo history.
+  struct UndoCharge
+  {
+    int References;
+    unsigned long Size;
+  };
+
+  /// Push a new empty level on the undo stack, discarding the oldest levels
+  /// if UndoStackSize or UndoMemoryLimit is exceeded.
   void PushIntoUndoStack();
+  /// Push a new empty level on the redo stack.
   void PushIntoRedoStack();
-
-  void CopyNodeInUndoStack(vtkMRMLNode *node);
-  void CopyNodeInRedoStack(vtkMRMLNode *node);
+  /// Delete the oldest level of the undo stack. The copies still needed by
+  /// the levels saved for all nodes are moved to the next level.
+  void DiscardOldestUndoLevel();
+  /// Release the memory charged by the level and delete it.
+  void DeleteUndoLevel(UndoLevel* level);
+
+  /// Save a copy of the node in a level. In the undo stack, the latest copy
+  /// of the node is shared if the node has not been modified since.
+  void CopyNodeInUndoLevel(vtkMRMLNode *node, UndoLevel* level);
+
+  /// Find the latest copy of a node in \a level (if not NULL) then in the
+  /// undo stack from the top. Returns the level holding the copy, NULL if
+  /// none was found.
+  UndoLevel* FindSavedNode(const std::string& id, UndoLevel* level, UndoLevel::SavedNode& savedNode);
+
+  /// Point the baseline of the nodes saved in \a level, which is not in the
+  /// undo stack anymore, to their copies in the remaining levels.
+  void RemoveUndoLevelFromBaseline(UndoLevel* level);
+
+  /// Charge the memory of \a object, owned by \a owner, against the undo
+  /// memory. Objects shared by several owners or levels are counted once.
+  void ChargeUndoObject(UndoLevel* level, vtkObject* owner, vtkObject* object, unsigned long size);
+  /// Charge a node copy or removed node and its bulk data, except the bulk
+  /// data shared with \a liveNode.
+  void ChargeUndoNode(UndoLevel* level, vtkMRMLNode* node, vtkMRMLNode* liveNode);
+  /// Release the objects charged by \a owner in the level.
+  void ReleaseUndoNode(UndoLevel* level, vtkObject* owner);
+  void ReleaseUndoObject(vtkObject* object);
+
+  /// Journal the addition or removal of a node in the top level of the undo
+  /// stack.
+  void AddNodeToUndoStack(vtkMRMLNode *node);
+  void RemoveNodeFromUndoStack(vtkMRMLNode *node);
+
+  /// Revert the changes recorded in \a level and record in \a inverseLevel
+  /// how to redo them.
+  void ApplyUndoLevel(UndoLevel* level, UndoLevel* inverseLevel);
 
   /// Add a node to the scene without invoking a vtkMRMLScene::NodeAddedEvent event.
   ///
@@ -717,6 +842,12 @@ protected:
 
   void AddReferencedNodes(vtkMRMLNode *node, vtkCollection *refNodes);
 
+  /// Read concurrently the files of the storage nodes of \a nodes that
+  /// support detached reading. Invokes vtkMRMLScene::ProgressBatchProcessEvent
+  /// with the percentage of read files.
+  /// \sa Import(), SetNumberOfReadDataThreads()
+  void ReadDataDetached(vtkCollection *nodes);
+
   /// Handle vtkMRMLScene::DeleteEvent: clear the scene.
   static void SceneCallback( vtkObject *caller, unsigned long eid,
                              void *clientData, void *callData );
@@ -752,6 +883,27 @@ protected:
   /// Clear NodeIDs map used to speedup GetByID() method.
   void ClearNodeIDs();
 
+  /// \brief Get the nodes of the scene that are of class \a className or
+  /// of a subclass, in the order of the \a Nodes collection.
+  ///
+  /// The list is computed the first time a class is requested and is kept
+  /// up-to-date by AddNodeByClass() and RemoveNodeByClass() to speedup
+  /// GetNodesByClass() and similar methods.
+  const std::vector<vtkMRMLNode*>& GetNodesByClassIndex(const char* className);
+
+  /// Clear the \a NodesByClass lists if the \a Nodes collection has been
+  /// modified without AddNodeByClass() or RemoveNodeByClass() being called.
+  void UpdateNodesByClass();
+
+  /// Add a node appended to the \a Nodes collection to the \a NodesByClass lists.
+  void AddNodeByClass(vtkMRMLNode *node);
+
+  /// Remove node from the \a NodesByClass lists.
+  void RemoveNodeByClass(vtkMRMLNode *node);
+
+  /// Clear the \a NodesByClass lists, they are computed again on demand.
+  void ClearNodesByClass();
+
   /// Get a NodeReferences iterator for a node reference.
   NodeReferencesType::iterator FindNodeReference(const char* referencedId, vtkMRMLNode* referencingNode);
 
@@ -765,13 +917,23 @@ protected:
   vtkTagTable *      UserTagTable;
 
   std::vector<unsigned long> States;
+  /// Whether the beginning of each state in States was traced
+  /// \sa vtkEventBroker::StartTracing()
+  std::vector<bool> TracedStates;
 
   int  UndoStackSize;
+  int  UndoMemoryLimit;
   bool UndoFlag;
   bool InUndo;
 
-  std::list< vtkCollection* >  UndoStack;
-  std::list< vtkCollection* >  RedoStack;
+  std::list< UndoLevel* >  UndoStack;
+  std::list< UndoLevel* >  RedoStack;
+  /// Latest copy of the nodes in the undo stack, indexed by node ID
+  std::map< std::string, UndoBaselineNode > UndoBaseline;
+  /// Objects referenced by the undo and redo history and their size
+  std::map< vtkObject*, UndoCharge > UndoCharges;
+  /// Sum of the sizes of UndoCharges, in KiB
+  unsigned long UndoMemorySize;
 
   std::string                 URL;
   std::string                 RootDirectory;
@@ -782,10 +944,17 @@ protected:
 
   std::vector< vtkMRMLNode* > RegisteredNodeClasses;
   std::vector< std::string >  RegisteredNodeTags;
+  /// Registered node classes indexed by XML tag and by class name,
+  /// used to speedup GetClassNameByTag(), GetTagByClassName() and
+  /// CreateNodeByClass().
+  std::map< std::string, vtkMRMLNode* > RegisteredNodeClassesByTag;
+  std::map< std::string, vtkMRMLNode* > RegisteredNodeClassesByClassName;
 
   NodeReferencesType NodeReferences; // ReferencedIDs (string), ReferencingNodes (node pointer)
   std::map< std::string, std::string > ReferencedIDChanges;
   std::map< std::string, vtkSmartPointer<vtkMRMLNode> > NodeIDs;
+  /// Nodes of the scene by class name, see GetNodesByClassIndex().
+  std::map< std::string, std::vector<vtkMRMLNode*> > NodesByClass;
 
   // Stores default nodes. If a class is created or reset (using CreateNodeByClass or Clear) and
   // a default node is defined for it then the content of the default node will be used to initialize
@@ -802,7 +971,10 @@ protected:
 
   int ReadDataOnLoad;
 
+  int NumberOfReadDataThreads;
+
   vtkMTimeType  NodeIDsMTime;
+  vtkMTimeType  NodesByClassMTime;
 
   void RemoveAllNodes(bool removeSingletons);
 
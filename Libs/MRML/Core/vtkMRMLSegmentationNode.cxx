@@ -146,6 +146,29 @@ void vtkMRMLSegmentationNode::DeepCopy(vtkMRMLNode* aNode)
   Copy(aNode);
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLSegmentationNode::GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects)
+{
+  if (!this->Segmentation)
+    {
+    return;
+    }
+  for (int segmentIndex = 0; segmentIndex < this->Segmentation->GetNumberOfSegments(); ++segmentIndex)
+    {
+    vtkSegment* segment = this->Segmentation->GetNthSegment(segmentIndex);
+    std::vector<std::string> representationNames;
+    segment->GetContainedRepresentationNames(representationNames);
+    for (std::vector<std::string>::iterator nameIt = representationNames.begin(); nameIt != representationNames.end(); ++nameIt)
+      {
+      vtkDataObject* representation = segment->GetRepresentation(*nameIt);
+      if (representation)
+        {
+        dataObjects.push_back(representation);
+        }
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLSegmentationNode::PrintSelf(ostream& os, vtkIndent indent)
 {
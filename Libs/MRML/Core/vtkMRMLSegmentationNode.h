@@ -73,6 +73,9 @@ public:
   /// Copy the entire contents of the node into this node
   virtual void DeepCopy(vtkMRMLNode* node);
 
+  /// Add the representations of all the segments to \a dataObjects
+  virtual void GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects) VTK_OVERRIDE;
+
   /// Get unique node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() VTK_OVERRIDE {return "Segmentation";};
 
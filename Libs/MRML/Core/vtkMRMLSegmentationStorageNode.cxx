@@ -38,6 +38,7 @@
 #include <vtkImageCast.h>
 #include <vtkImageConstantPad.h>
 #include <vtkImageExtractComponents.h>
+#include <vtkImageThreshold.h>
 #include <vtkInformation.h>
 #include <vtkInformationIntegerVectorKey.h>
 #include <vtkInformationStringKey.h>
@@ -76,6 +77,8 @@ static const std::string KEY_SEGMENT_TAGS = "Tags";
 static const std::string KEY_SEGMENT_EXTENT = "Extent";
 static const std::string KEY_SEGMENT_NAME_AUTO_GENERATED = "NameAutoGenerated";
 static const std::string KEY_SEGMENT_COLOR_AUTO_GENERATED = "ColorAutoGenerated";
+static const std::string KEY_SEGMENT_LAYER = "Layer";
+static const std::string KEY_SEGMENT_LABEL_VALUE = "LabelValue";
 static const std::string KEY_SEGMENTATION_MASTER_REPRESENTATION = "MasterRepresentation";
 static const std::string KEY_SEGMENTATION_CONVERSION_PARAMETERS = "ConversionParameters";
 static const std::string KEY_SEGMENTATION_EXTENT = "Extent"; // Deprecated, kept only for being able to read legacy files.
@@ -83,11 +86,63 @@ static const std::string KEY_SEGMENTATION_REFERENCE_IMAGE_EXTENT_OFFSET = "Refer
 static const std::string KEY_SEGMENTATION_CONTAINED_REPRESENTATION_NAMES = "ContainedRepresentationNames";
 
 static const int SINGLE_SEGMENT_INDEX = -1; // used as segment index when there is only a single segment
+static const int MAXIMUM_NUMBER_OF_SEGMENTS_PER_LAYER = VTK_UNSIGNED_CHAR_MAX;
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Returns true if none of the non-zero voxels of the segment labelmap are
+/// set in the layer within extent. Both images are unsigned char images that
+/// contain extent.
+bool CanAddSegmentToLayer(vtkImageData* layer, vtkImageData* segmentLabelmap, const int extent[6])
+{
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      const unsigned char* layerPtr = static_cast<unsigned char*>(layer->GetScalarPointer(extent[0], j, k));
+      const unsigned char* segmentPtr = static_cast<unsigned char*>(segmentLabelmap->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; ++i, ++layerPtr, ++segmentPtr)
+        {
+        if (*segmentPtr && *layerPtr)
+          {
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+/// Set labelValue in the layer where the segment labelmap is non-zero.
+void AddSegmentToLayer(vtkImageData* layer, vtkImageData* segmentLabelmap, const int extent[6], unsigned char labelValue)
+{
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      unsigned char* layerPtr = static_cast<unsigned char*>(layer->GetScalarPointer(extent[0], j, k));
+      const unsigned char* segmentPtr = static_cast<unsigned char*>(segmentLabelmap->GetScalarPointer(extent[0], j, k));
+      for (int i = extent[0]; i <= extent[1]; ++i, ++layerPtr, ++segmentPtr)
+        {
+        if (*segmentPtr)
+          {
+          *layerPtr = labelValue;
+          }
+        }
+      }
+    }
+}
+
+} // end of anonymous namespace
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLSegmentationStorageNode);
 
 //----------------------------------------------------------------------------
 vtkMRMLSegmentationStorageNode::vtkMRMLSegmentationStorageNode()
+  : SegmentsInLayers(false)
 {
 }
 
@@ -100,6 +155,9 @@ vtkMRMLSegmentationStorageNode::~vtkMRMLSegmentationStorageNode()
 void vtkMRMLSegmentationStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   vtkMRMLStorageNode::PrintSelf(os,indent);
+  vtkMRMLPrintBeginMacro(os, indent);
+  vtkMRMLPrintBooleanMacro(SegmentsInLayers);
+  vtkMRMLPrintEndMacro();
 }
 
 //----------------------------------------------------------------------------
@@ -109,6 +167,10 @@ void vtkMRMLSegmentationStorageNode::ReadXMLAttributes(const char** atts)
 
   Superclass::ReadXMLAttributes(atts);
 
+  vtkMRMLReadXMLBeginMacro(atts);
+  vtkMRMLReadXMLBooleanMacro(segmentsInLayers, SegmentsInLayers);
+  vtkMRMLReadXMLEndMacro();
+
   this->EndModify(disabledModify);
 }
 
@@ -116,6 +178,9 @@ void vtkMRMLSegmentationStorageNode::ReadXMLAttributes(const char** atts)
 void vtkMRMLSegmentationStorageNode::WriteXML(ostream& of, int nIndent)
 {
   Superclass::WriteXML(of, nIndent);
+  vtkMRMLWriteXMLBeginMacro(of);
+  vtkMRMLWriteXMLBooleanMacro(segmentsInLayers, SegmentsInLayers);
+  vtkMRMLWriteXMLEndMacro();
 }
 
 //----------------------------------------------------------------------------
@@ -127,6 +192,10 @@ void vtkMRMLSegmentationStorageNode::Copy(vtkMRMLNode *anode)
 
   Superclass::Copy(anode);
 
+  vtkMRMLCopyBeginMacro(anode);
+  vtkMRMLCopyBooleanMacro(SegmentsInLayers);
+  vtkMRMLCopyEndMacro();
+
   this->EndModify(disabledModify);
 }
 
@@ -270,7 +339,8 @@ int vtkMRMLSegmentationStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     }
 
   // Create display node if segmentation there is none
-  if (success && !segmentationNode->GetDisplayNode())
+  // (detached nodes are not in the scene, see AttachDetachedData())
+  if (success && !this->ReadingDetachedData && !segmentationNode->GetDisplayNode())
     {
     segmentationNode->CreateDefaultDisplayNodes();
     }
@@ -285,6 +355,36 @@ int vtkMRMLSegmentationStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   return 1;
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLSegmentationStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLSegmentationStorageNode::AttachDetachedData(vtkMRMLStorageNode* vtkNotUsed(detachedStorageNode),
+                                                       vtkMRMLNode* detachedNode, vtkMRMLNode* refNode)
+{
+  vtkMRMLSegmentationNode* detachedSegmentationNode = vtkMRMLSegmentationNode::SafeDownCast(detachedNode);
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(refNode);
+  if (!detachedSegmentationNode || !segmentationNode)
+    {
+    vtkErrorMacro("AttachDetachedData: Reference node is not a segmentation node");
+    return 0;
+    }
+
+  // The detached segmentation has been copied from the reference node
+  // before reading, so it already contains the conversion parameters.
+  segmentationNode->SetAndObserveSegmentation(detachedSegmentationNode->GetSegmentation());
+
+  // Create display node if segmentation there is none
+  if (!segmentationNode->GetDisplayNode())
+    {
+    segmentationNode->CreateDefaultDisplayNodes();
+    }
+  return 1;
+}
+
 #ifdef SUPPORT_4D_SPATIAL_NRRD
 //----------------------------------------------------------------------------
 int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation4DSpatial(vtkMRMLSegmentationNode* segmentationNode, std::string path)
@@ -605,9 +705,31 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkMRMLSegm
   vtkNew<vtkImageExtractComponents> extractComponents;
   extractComponents->SetInputData(imageData);
 
+  // Only the extent of a segment is extracted from its layer
   vtkNew<vtkImageConstantPad> padder;
   padder->SetInputConnection(extractComponents->GetOutputPort());
 
+  vtkNew<vtkImageThreshold> threshold;
+  threshold->SetInputConnection(padder->GetOutputPort());
+  threshold->SetInValue(1);
+  threshold->SetOutValue(0);
+  threshold->ReplaceInOn();
+  threshold->ReplaceOutOn();
+  threshold->SetOutputScalarType(VTK_UNSIGNED_CHAR);
+
+  // Segments stored in layers have a layer index and a label value, in
+  // legacy files each component contains a segment.
+  int numberOfSegments = numberOfFrames;
+  bool segmentsInLayers = (reader->GetHeaderValue(GetSegmentMetaDataKey(0, KEY_SEGMENT_LAYER).c_str()) != NULL);
+  if (segmentsInLayers)
+    {
+    numberOfSegments = 0;
+    while (reader->GetHeaderValue(GetSegmentMetaDataKey(numberOfSegments, KEY_SEGMENT_ID).c_str()))
+      {
+      ++numberOfSegments;
+      }
+    }
+
   // Read conversion parameters
   kit = std::find(keys.begin(), keys.end(), GetSegmentationMetaDataKey(KEY_SEGMENTATION_CONVERSION_PARAMETERS));
   if (kit != keys.end())
@@ -625,7 +747,7 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkMRMLSegm
     }
 
   // Read segment binary labelmaps
-  for (int segmentIndex = 0; segmentIndex < numberOfFrames; ++segmentIndex)
+  for (int segmentIndex = 0; segmentIndex < numberOfSegments; ++segmentIndex)
     {
     // Create segment
     vtkSmartPointer<vtkSegment> currentSegment = vtkSmartPointer<vtkSegment>::New();
@@ -714,16 +836,40 @@ int vtkMRMLSegmentationStorageNode::ReadBinaryLabelmapRepresentation(vtkMRMLSegm
       currentSegmentExtent[i * 2] += referenceImageExtentOffset[i];
       currentSegmentExtent[i * 2 + 1] += referenceImageExtentOffset[i];
       }
+    // Layer and label value
+    int layerIndex = segmentIndex;
+    int labelValue = 0;
+    if (segmentsInLayers)
+      {
+      headerValue = reader->GetHeaderValue(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_LAYER).c_str());
+      layerIndex = (headerValue ? atoi(headerValue) : -1);
+      headerValue = reader->GetHeaderValue(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_LABEL_VALUE).c_str());
+      labelValue = (headerValue ? atoi(headerValue) : 0);
+      }
+    if (layerIndex < 0 || layerIndex >= numberOfFrames)
+      {
+      vtkErrorMacro("ReadBinaryLabelmapRepresentation: Invalid layer for segment " << segmentIndex);
+      currentSegmentExtent[1] = currentSegmentExtent[0] - 1;
+      }
     // Copy with clipping to specified extent
     if (currentSegmentExtent[0] <= currentSegmentExtent[1]
       && currentSegmentExtent[2] <= currentSegmentExtent[3]
       && currentSegmentExtent[4] <= currentSegmentExtent[5])
       {
       // non-empty segment
-      extractComponents->SetComponents(segmentIndex);
+      extractComponents->SetComponents(layerIndex);
       padder->SetOutputWholeExtent(currentSegmentExtent);
-      padder->Update();
-      currentBinaryLabelmap->DeepCopy(padder->GetOutput());
+      if (segmentsInLayers)
+        {
+        threshold->ThresholdBetween(labelValue, labelValue);
+        threshold->Update();
+        currentBinaryLabelmap->DeepCopy(threshold->GetOutput());
+        }
+      else
+        {
+        padder->Update();
+        currentBinaryLabelmap->DeepCopy(padder->GetOutput());
+        }
       }
     else
       {
@@ -1002,6 +1148,7 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkMRMLSeg
   vtkNew<vtkNRRDWriter> writer;
   writer->SetFileName(fullName.c_str());
   writer->SetUseCompression(this->GetUseCompression());
+  writer->SetCompressionLevel(this->GetCompressionLevel());
 
   // Create metadata dictionary
 
@@ -1035,13 +1182,20 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkMRMLSeg
   std::string containedRepresentationNames = this->SerializeContainedRepresentationNames(segmentation);
   writer->SetAttribute(GetSegmentationMetaDataKey(KEY_SEGMENTATION_CONTAINED_REPRESENTATION_NAMES).c_str(), containedRepresentationNames);
 
-  vtkNew<vtkImageAppendComponents> appender;
+  // Each segment is stored in a layer: an image in the common geometry,
+  // written as a component of the file. If SegmentsInLayers is enabled,
+  // segments are packed into layers where each segment has its own label
+  // value: a segment is added to the first layer where it does not overlap
+  // other segments, so that non-overlapping segments are stored in a single
+  // image. Otherwise each segment has its own layer, as legacy readers expect.
+  std::vector<vtkSmartPointer<vtkOrientedImageData> > layers;
+  std::vector<int> numberOfSegmentsInLayers;
 
-  // Dimensions of the output 4D NRRD file: (i, j, k, segment)
+  // Dimensions of the output 4D NRRD file: (i, j, k, layer)
   unsigned int segmentIndex = 0;
   std::vector< std::string > segmentIDs;
   segmentation->GetSegmentIDs(segmentIDs);
-  for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt, ++segmentIndex)
+  for (std::vector< std::string >::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
     {
     std::string currentSegmentID = *segmentIdIt;
     vtkSegment* currentSegment = segmentation->GetSegment(*segmentIdIt);
@@ -1055,26 +1209,17 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkMRMLSeg
       continue;
       }
 
+    // Only the effective extent of the segment is stored, empty segments
+    // are stored with an empty extent.
     int currentBinaryLabelmapExtent[6] = { 0, -1, 0, -1, 0, -1 };
-    currentBinaryLabelmap->GetExtent(currentBinaryLabelmapExtent);
-    if (currentBinaryLabelmapExtent[0] <= currentBinaryLabelmapExtent[1]
-      && currentBinaryLabelmapExtent[2] <= currentBinaryLabelmapExtent[3]
-      && currentBinaryLabelmapExtent[4] <= currentBinaryLabelmapExtent[5])
+    int layerIndex = 0;
+    int labelValue = 0;
+    int effectiveExtent[6] = { 0, -1, 0, -1, 0, -1 };
+    bool segmentAddedToLayer = false;
+    if (vtkOrientedImageDataResample::CalculateEffectiveExtent(currentBinaryLabelmap, effectiveExtent))
       {
       // There is a valid labelmap
 
-      // Get transformed extents of the segment in the common labelmap geometry
-      vtkNew<vtkTransform> currentBinaryLabelmapToCommonGeometryImageTransform;
-      vtkOrientedImageDataResample::GetTransformBetweenOrientedImages(currentBinaryLabelmap, commonGeometryImage, currentBinaryLabelmapToCommonGeometryImageTransform.GetPointer());
-      int currentBinaryLabelmapExtentInCommonGeometryImageFrame[6] = { 0, -1, 0, -1, 0, -1 };
-      vtkOrientedImageDataResample::TransformExtent(currentBinaryLabelmapExtent, currentBinaryLabelmapToCommonGeometryImageTransform.GetPointer(), currentBinaryLabelmapExtentInCommonGeometryImageFrame);
-      for (int i = 0; i < 3; i++)
-        {
-        currentBinaryLabelmapExtent[i * 2] = std::max(currentBinaryLabelmapExtentInCommonGeometryImageFrame[i * 2], commonGeometryExtent[i * 2]);
-        currentBinaryLabelmapExtent[i * 2 + 1] = std::min(currentBinaryLabelmapExtentInCommonGeometryImageFrame[i * 2 + 1], commonGeometryExtent[i * 2 + 1]);
-        }
-      // TODO: maybe calculate effective extent to make sure the data is as compact as possible? (saving may be a good time to make segments more compact)
-
       // Pad/resample current binary labelmap representation to common geometry
       vtkSmartPointer<vtkOrientedImageData> resampledCurrentBinaryLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
       bool success = vtkOrientedImageDataResample::ResampleOrientedImageToReferenceOrientedImage(
@@ -1095,11 +1240,52 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkMRMLSeg
         castFilter->Update();
         currentBinaryLabelmap->ShallowCopy(castFilter->GetOutput());
         }
+
+      // Effective extent of the segment in the common labelmap geometry
+      vtkOrientedImageDataResample::CalculateEffectiveExtent(currentBinaryLabelmap, currentBinaryLabelmapExtent);
+      for (int i = 0; i < 3; i++)
+        {
+        currentBinaryLabelmapExtent[i * 2] = std::max(currentBinaryLabelmapExtent[i * 2], commonGeometryExtent[i * 2]);
+        currentBinaryLabelmapExtent[i * 2 + 1] = std::min(currentBinaryLabelmapExtent[i * 2 + 1], commonGeometryExtent[i * 2 + 1]);
+        }
+      if (currentBinaryLabelmapExtent[0] <= currentBinaryLabelmapExtent[1]
+        && currentBinaryLabelmapExtent[2] <= currentBinaryLabelmapExtent[3]
+        && currentBinaryLabelmapExtent[4] <= currentBinaryLabelmapExtent[5]
+        && this->SegmentsInLayers)
+        {
+        for (layerIndex = 0; layerIndex < static_cast<int>(layers.size()); ++layerIndex)
+          {
+          if (numberOfSegmentsInLayers[layerIndex] < MAXIMUM_NUMBER_OF_SEGMENTS_PER_LAYER
+            && CanAddSegmentToLayer(layers[layerIndex], currentBinaryLabelmap, currentBinaryLabelmapExtent))
+            {
+            break;
+            }
+          }
+        if (layerIndex == static_cast<int>(layers.size()))
+          {
+          vtkSmartPointer<vtkOrientedImageData> layer = vtkSmartPointer<vtkOrientedImageData>::New();
+          layer->DeepCopy(commonGeometryImage);
+          layers.push_back(layer);
+          numberOfSegmentsInLayers.push_back(0);
+          }
+        labelValue = ++numberOfSegmentsInLayers[layerIndex];
+        AddSegmentToLayer(layers[layerIndex], currentBinaryLabelmap, currentBinaryLabelmapExtent, static_cast<unsigned char>(labelValue));
+        segmentAddedToLayer = true;
+        }
+      else if (currentBinaryLabelmapExtent[0] <= currentBinaryLabelmapExtent[1]
+        && currentBinaryLabelmapExtent[2] <= currentBinaryLabelmapExtent[3]
+        && currentBinaryLabelmapExtent[4] <= currentBinaryLabelmapExtent[5])
+        {
+        layerIndex = static_cast<int>(layers.size());
+        layers.push_back(currentBinaryLabelmap);
+        segmentAddedToLayer = true;
+        }
       }
-    else
+    if (!segmentAddedToLayer && !this->SegmentsInLayers)
       {
       // empty segment, use the commonGeometryImage (filled with 0)
-      currentBinaryLabelmap = commonGeometryImage;
+      layerIndex = static_cast<int>(layers.size());
+      layers.push_back(commonGeometryImage);
       }
 
     // Set metadata for current segment
@@ -1117,10 +1303,28 @@ int vtkMRMLSegmentationStorageNode::WriteBinaryLabelmapRepresentation(vtkMRMLSeg
       }
     writer->SetAttribute(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_EXTENT).c_str(), GetImageExtentAsString(currentBinaryLabelmapExtent));
     writer->SetAttribute(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_TAGS).c_str(), GetSegmentTagsAsString(currentSegment));
-
-    appender->AddInputData(currentBinaryLabelmap);
+    if (this->SegmentsInLayers)
+      {
+      std::stringstream ssLayer;
+      ssLayer << layerIndex;
+      writer->SetAttribute(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_LAYER).c_str(), ssLayer.str());
+      std::stringstream ssLabelValue;
+      ssLabelValue << labelValue;
+      writer->SetAttribute(GetSegmentMetaDataKey(segmentIndex, KEY_SEGMENT_LABEL_VALUE).c_str(), ssLabelValue.str());
+      }
+    ++segmentIndex;
     } // For each segment
 
+  if (layers.empty())
+    {
+    // all segments are empty, write the empty common geometry image
+    layers.push_back(commonGeometryImage);
+    }
+  vtkNew<vtkImageAppendComponents> appender;
+  for (std::vector<vtkSmartPointer<vtkOrientedImageData> >::iterator layerIt = layers.begin(); layerIt != layers.end(); ++layerIt)
+    {
+    appender->AddInputData(*layerIt);
+    }
 
   appender->Update();
 
@@ -86,6 +86,17 @@ public:
   /// Reset supported write file types. Called when master representation is changed
   void ResetSupportedWriteFileTypes();
 
+  /// If enabled, non-overlapping segments of a binary labelmap segmentation
+  /// are written in shared layers (components of the file) with distinct
+  /// label values, which makes files of many small segments much smaller.
+  /// Files written this way can only be read by Slicer versions that know the
+  /// Segment{N}_Layer and Segment{N}_LabelValue fields, therefore it is
+  /// disabled by default: each segment is written in its own component.
+  /// Files are read correctly regardless of this setting.
+  vtkSetMacro(SegmentsInLayers, bool);
+  vtkGetMacro(SegmentsInLayers, bool);
+  vtkBooleanMacro(SegmentsInLayers, bool);
+
 protected:
   /// Initialize all the supported read file types
   virtual void InitializeSupportedReadFileTypes() VTK_OVERRIDE;
@@ -99,7 +110,10 @@ protected:
   /// Write data from a referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
-  /// Write binary labelmap representation to file
+  /// Write binary labelmap representation to file.
+  /// Each segment only stores its effective extent. Non-overlapping segments
+  /// share a layer (a component of the 3D spatial + list nrrd) with distinct
+  /// label values if SegmentsInLayers is enabled.
   virtual int WriteBinaryLabelmapRepresentation(vtkMRMLSegmentationNode* segmentationNode, std::string path);
 
   /// Write a poly data representation to file
@@ -108,6 +122,13 @@ protected:
   /// Read data and set it in the referenced node
   virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
+  /// Segmentation files are read without accessing the scene
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Move the segmentation read in the detached node into the referenced node
+  virtual int AttachDetachedData(vtkMRMLStorageNode* detachedStorageNode,
+                                 vtkMRMLNode* detachedNode, vtkMRMLNode* refNode) VTK_OVERRIDE;
+
   /// Read binary labelmap representation from nrrd file (3D spatial + list)
   virtual int ReadBinaryLabelmapRepresentation(vtkMRMLSegmentationNode* segmentationNode, std::string path);
 
@@ -147,6 +168,8 @@ protected:
   vtkMRMLSegmentationStorageNode();
   ~vtkMRMLSegmentationStorageNode();
 
+  bool SegmentsInLayers;
+
 private:
   vtkMRMLSegmentationStorageNode(const vtkMRMLSegmentationStorageNode&);  /// Not implemented.
   void operator=(const vtkMRMLSegmentationStorageNode&);  /// Not implemented.
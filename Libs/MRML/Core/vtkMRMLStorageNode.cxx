@@ -22,8 +22,10 @@ Version:   $Revision: 1.1.1.1 $
 #include "vtkMRMLScene.h"
 
 // VTK includes
+#include <vtkCallbackCommand.h>
 #include <vtkCommand.h>
 #include <vtkNew.h>
+#include <vtkOutputWindow.h>
 #include <vtkStringArray.h>
 #include <vtkURIHandler.h>
 
@@ -46,6 +48,7 @@ vtkMRMLStorageNode::vtkMRMLStorageNode()
   this->URI = NULL;
   this->URIHandler = NULL;
   this->UseCompression = 1;
+  this->CompressionLevel = -1;
   this->ReadState = this->Idle;
   this->WriteState = this->Idle;
   this->URIHandler = NULL;
@@ -56,6 +59,10 @@ vtkMRMLStorageNode::vtkMRMLStorageNode()
   this->SupportedWriteFileTypes = vtkStringArray::New();
   this->WriteFileFormat = NULL;
   this->StoredTime = vtkTimeStamp::New();
+
+  this->DetachedDataReferenceNode = NULL;
+  this->DetachedDataReadResult = -1;
+  this->ReadingDetachedData = false;
 }
 
 //----------------------------------------------------------------------------
@@ -184,6 +191,10 @@ void vtkMRMLStorageNode::WriteXML(ostream& of, int nIndent)
   std::stringstream ss;
   ss << this->UseCompression;
   of << " useCompression=\"" << ss.str() << "\"";
+  if (this->CompressionLevel >= 0)
+    {
+    of << " compressionLevel=\"" << this->CompressionLevel << "\"";
+    }
 
   if (this->GetDefaultWriteFileExtension() != NULL)
     {
@@ -304,6 +315,14 @@ void vtkMRMLStorageNode::ReadXMLAttributes(const char** atts)
       ss << attValue;
       ss >> this->UseCompression;
       }
+    else if (!strcmp(attName, "compressionLevel"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      int compressionLevel = -1;
+      ss >> compressionLevel;
+      this->SetCompressionLevel(compressionLevel);
+      }
     else if (!strcmp(attName, "readState"))
       {
       std::stringstream ss;
@@ -339,6 +358,7 @@ void vtkMRMLStorageNode::Copy(vtkMRMLNode *anode)
     this->AddURI(node->GetNthURI(i));
     }
   this->SetUseCompression(node->UseCompression);
+  this->SetCompressionLevel(node->CompressionLevel);
   this->SetReadState(node->ReadState);
   this->SetWriteState(node->WriteState);
   this->SetDefaultWriteFileExtension(node->GetDefaultWriteFileExtension());
@@ -365,6 +385,7 @@ void vtkMRMLStorageNode::PrintSelf(ostream& os, vtkIndent indent)
     os << indent << "URIListMember: " << this->GetNthURI(i) << "\n";
     }
   os << indent << "UseCompression:   " << this->UseCompression << "\n";
+  os << indent << "CompressionLevel: " << this->CompressionLevel << "\n";
   os << indent << "ReadState:  " << this->GetReadStateAsString() << "\n";
   os << indent << "WriteState: " << this->GetWriteStateAsString() << "\n";
   os << indent << "SupportedWriteFileTypes: \n";
@@ -384,7 +405,7 @@ void vtkMRMLStorageNode::PrintSelf(ostream& os, vtkIndent indent)
 //----------------------------------------------------------------------------
 void vtkMRMLStorageNode::ProcessMRMLEvents ( vtkObject *vtkNotUsed(caller), unsigned long event, void *callData )
 {
-  if (event ==  vtkCommand::ProgressEvent)
+  if (event ==  vtkCommand::ProgressEvent && !this->ReadingDetachedData)
     {
     this->InvokeEvent ( vtkCommand::ProgressEvent,callData );
     }
@@ -1149,6 +1170,25 @@ int vtkMRMLStorageNode::ReadData(vtkMRMLNode* refNode, bool temporary)
     return 0;
     }
 
+  // Take the data already read by ReadDataDetached(), if any
+  vtkSmartPointer<vtkMRMLNode> detachedNode;
+  vtkSmartPointer<vtkMRMLStorageNode> detachedStorageNode;
+  int detachedReadResult = -1;
+  if (this->DetachedDataReferenceNode == refNode)
+    {
+    detachedNode = this->DetachedDataNode;
+    detachedStorageNode = this->DetachedStorageNode;
+    detachedReadResult = this->DetachedDataReadResult;
+    }
+  this->DetachedDataNode = NULL;
+  this->DetachedStorageNode = NULL;
+  this->DetachedDataReferenceNode = NULL;
+  this->DetachedDataReadResult = -1;
+  if (detachedStorageNode.GetPointer() && detachedReadResult != -1)
+    {
+    this->DisplayDetachedDataMessages(detachedStorageNode);
+    }
+
   if ( !this->CanReadInReferenceNode(refNode) )
     {
     return 0;
@@ -1181,7 +1221,16 @@ int vtkMRMLStorageNode::ReadData(vtkMRMLNode* refNode, bool temporary)
   vtkDebugMacro("ReadData: read state is ready, "
     <<  "URI = " << (this->GetURI() == NULL ? "null" : this->GetURI()) << ", "
     << "filename = " << (this->GetFileName() == NULL ? "null" : this->GetFileName()));
-  int res = this->ReadDataInternal(refNode);
+  int res = 0;
+  if (detachedNode.GetPointer() && detachedReadResult != -1)
+    {
+    res = detachedReadResult &&
+      this->AttachDetachedData(detachedStorageNode, detachedNode, refNode);
+    }
+  else
+    {
+    res = this->ReadDataInternal(refNode);
+    }
   if (res)
     {
     vtkMRMLStorableNode* storableNode = vtkMRMLStorableNode::SafeDownCast(refNode);
@@ -1224,12 +1273,139 @@ int vtkMRMLStorageNode::WriteData(vtkMRMLNode* refNode)
   return res;
 }
 
+//------------------------------------------------------------------------------
+bool vtkMRMLStorageNode::PrepareReadDataDetached(vtkMRMLNode* refNode)
+{
+  this->DetachedDataNode = NULL;
+  this->DetachedStorageNode = NULL;
+  this->DetachedDataReferenceNode = NULL;
+  this->DetachedDataReadResult = -1;
+
+  if (refNode == NULL
+      || !refNode->GetAddToScene()
+      || !this->CanReadInReferenceNode(refNode)
+      || !this->SupportsReadDataDetached(refNode))
+    {
+    return false;
+    }
+  if (this->GetScene() && this->GetScene()->GetReadDataOnLoad() == 0)
+    {
+    return false;
+    }
+  // remote files are downloaded by the data IO manager
+  if (this->GetFileName() == NULL ||
+      (this->GetURI() != NULL && strcmp(this->GetURI(), "") != 0))
+    {
+    return false;
+    }
+
+  // The detached node is a copy of the reference node (without bulk data)
+  // so that properties read from the scene file are taken into account.
+  vtkSmartPointer<vtkMRMLNode> detachedNode =
+    vtkSmartPointer<vtkMRMLNode>::Take(refNode->CreateNodeInstance());
+  detachedNode->Copy(refNode);
+
+  // The file is read by a copy of this node so that the worker thread
+  // doesn't access a node the main thread may use. The copy is not in the
+  // scene, its file names are made absolute.
+  vtkSmartPointer<vtkMRMLStorageNode> detachedStorageNode =
+    vtkSmartPointer<vtkMRMLStorageNode>::Take(
+      vtkMRMLStorageNode::SafeDownCast(this->CreateNodeInstance()));
+  detachedStorageNode->Copy(this);
+  detachedStorageNode->SetFileName(this->GetFullNameFromFileName().c_str());
+  for (int i = 0; i < this->GetNumberOfFileNames(); ++i)
+    {
+    detachedStorageNode->FileNameList[i] = this->GetFullNameFromNthFileName(i);
+    }
+  detachedStorageNode->ReadingDetachedData = true;
+  // vtkErrorMacro and vtkWarningMacro invoke events instead of writing to
+  // the output window when the node is observed.
+  vtkNew<vtkCallbackCommand> messageCallback;
+  messageCallback->SetCallback(vtkMRMLStorageNode::DetachedDataMessageCallback);
+  messageCallback->SetClientData(detachedStorageNode.GetPointer());
+  detachedStorageNode->AddObserver(vtkCommand::ErrorEvent, messageCallback.GetPointer());
+  detachedStorageNode->AddObserver(vtkCommand::WarningEvent, messageCallback.GetPointer());
+  detachedStorageNode->AddObserver(vtkCommand::MessageEvent, messageCallback.GetPointer());
+
+  this->DetachedDataNode = detachedNode;
+  this->DetachedStorageNode = detachedStorageNode;
+  this->DetachedDataReferenceNode = refNode;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void vtkMRMLStorageNode::ReadDataDetached()
+{
+  if (this->DetachedDataNode.GetPointer() == NULL ||
+      this->DetachedStorageNode.GetPointer() == NULL ||
+      this->DetachedDataReadResult != -1)
+    {
+    return;
+    }
+  this->DetachedDataReadResult =
+    this->DetachedStorageNode->ReadDataInternal(this->DetachedDataNode);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStorageNode::DetachedDataMessageCallback(vtkObject* vtkNotUsed(caller),
+  unsigned long eid, void* clientData, void* callData)
+{
+  vtkMRMLStorageNode* self = reinterpret_cast<vtkMRMLStorageNode*>(clientData);
+  const char* message = reinterpret_cast<const char*>(callData);
+  if (self && message)
+    {
+    self->DetachedDataMessages.push_back(std::make_pair(eid, std::string(message)));
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLStorageNode::DisplayDetachedDataMessages(vtkMRMLStorageNode* detachedStorageNode)
+{
+  std::vector< std::pair<unsigned long, std::string> >::iterator it;
+  for (it = detachedStorageNode->DetachedDataMessages.begin();
+       it != detachedStorageNode->DetachedDataMessages.end(); ++it)
+    {
+    const char* message = it->second.c_str();
+    if (it->first == vtkCommand::MessageEvent)
+      {
+      vtkInfoMacro(<< message);
+      }
+    else if (this->HasObserver(it->first))
+      {
+      this->InvokeEvent(it->first, const_cast<char*>(message));
+      }
+    else if (it->first == vtkCommand::ErrorEvent)
+      {
+      vtkOutputWindowDisplayErrorText(message);
+      }
+    else
+      {
+      vtkOutputWindowDisplayWarningText(message);
+      }
+    }
+  detachedStorageNode->DetachedDataMessages.clear();
+}
+
 //------------------------------------------------------------------------------
 int vtkMRMLStorageNode::ReadDataInternal(vtkMRMLNode* vtkNotUsed(refNode))
 {
   return 0;
 }
 
+//------------------------------------------------------------------------------
+bool vtkMRMLStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return false;
+}
+
+//------------------------------------------------------------------------------
+int vtkMRMLStorageNode::AttachDetachedData(vtkMRMLStorageNode* vtkNotUsed(detachedStorageNode),
+                                           vtkMRMLNode* vtkNotUsed(detachedNode),
+                                           vtkMRMLNode* vtkNotUsed(refNode))
+{
+  return 0;
+}
+
 //------------------------------------------------------------------------------
 int vtkMRMLStorageNode::WriteDataInternal(vtkMRMLNode* vtkNotUsed(refNode))
 {
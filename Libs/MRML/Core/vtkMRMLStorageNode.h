@@ -20,9 +20,12 @@
 class vtkURIHandler;
 
 // VTK includes
+#include <vtkSmartPointer.h>
 class vtkStringArray;
 
 // STD includes
+#include <string>
+#include <utility>
 #include <vector>
 
 /// \brief A supercalss for other storage nodes.
@@ -51,6 +54,24 @@ public:
   /// \sa SetFileName(), ReadDataInternal(), GetStoredTime()
   virtual int ReadData(vtkMRMLNode *refNode, bool temporaryFile = false);
 
+  /// Prepare reading the data of \a refNode from a worker thread.
+  /// Return true if the file can be read by ReadDataDetached(): the file is
+  /// local (no URI), data reading is enabled in the scene and the storage
+  /// node supports detached reading (see SupportsReadDataDetached()).
+  /// Must be called from the main thread.
+  /// \sa ReadDataDetached(), vtkMRMLScene::SetNumberOfReadDataThreads()
+  bool PrepareReadDataDetached(vtkMRMLNode* refNode);
+
+  /// Read the file prepared by PrepareReadDataDetached() into a copy of the
+  /// reference node that does not belong to any scene.
+  /// Can be called from any thread: the file is read by a copy of this
+  /// storage node, its error and warning messages are collected and
+  /// displayed by ReadData() on the main thread. The next call to ReadData()
+  /// with the reference node attaches the data to the reference node
+  /// instead of reading the file again.
+  /// \sa PrepareReadDataDetached(), AttachDetachedData()
+  void ReadDataDetached();
+
   ///
   /// Write data from a  referenced node
   /// Return 1 on success, 0 on failure.
@@ -91,6 +112,14 @@ public:
   vtkGetMacro(UseCompression, int);
   vtkSetMacro(UseCompression, int);
 
+  ///
+  /// Compression level used on write if UseCompression is enabled,
+  /// from 1 (fastest) to 9 (smallest file). Writers that don't support
+  /// compression levels ignore it.
+  /// -1 (default) uses the default level of the file format.
+  vtkSetClampMacro(CompressionLevel, int, -1, 9);
+  vtkGetMacro(CompressionLevel, int);
+
   ///
   /// Location of the remote copy of this file.
   vtkSetStringMacro(URI);
@@ -318,6 +347,29 @@ protected:
   /// To be reimplemented in subclass.
   virtual int WriteDataInternal(vtkMRMLNode* refNode);
 
+  /// Return true if ReadDataInternal() can be called from a worker thread
+  /// on a detached copy of \a refNode, and AttachDetachedData() is
+  /// implemented. ReadDataInternal() must then only modify the node it
+  /// reads into and must not access the scene.
+  /// Returns false by default.
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode);
+
+  /// Move the data read by ReadDataDetached() from \a detachedNode into
+  /// \a refNode. \a detachedStorageNode is the copy of this storage node
+  /// that read the file. Called from the main thread by ReadData().
+  /// Returns 1 on success, 0 otherwise. Returns 0 by default.
+  virtual int AttachDetachedData(vtkMRMLStorageNode* detachedStorageNode,
+                                 vtkMRMLNode* detachedNode, vtkMRMLNode* refNode);
+
+  /// Display the messages collected while \a detachedStorageNode read
+  /// detached data, as if they were logged by this node.
+  void DisplayDetachedDataMessages(vtkMRMLStorageNode* detachedStorageNode);
+
+  /// Collect the error, warning and info messages of the storage node
+  /// reading detached data (\a clientData).
+  static void DetachedDataMessageCallback(vtkObject* caller, unsigned long eid,
+                                          void* clientData, void* callData);
+
   ///
   /// If the URI is not null, fetch it and save it to the node's FileName location or
   /// load directly into the reference node.
@@ -333,6 +385,7 @@ protected:
   char *URI;
   vtkURIHandler *URIHandler;
   int UseCompression;
+  int CompressionLevel;
   int ReadState;
   int WriteState;
 
@@ -363,6 +416,23 @@ protected:
   /// Can be reset with InvalidateFile.
   /// \sa InvalidateFile
   vtkTimeStamp* StoredTime;
+
+  /// Node the data is read into by ReadDataDetached()
+  vtkSmartPointer<vtkMRMLNode> DetachedDataNode;
+  /// Copy of this node (with absolute file names) that reads the file in
+  /// ReadDataDetached(), worker threads don't access this node.
+  vtkSmartPointer<vtkMRMLStorageNode> DetachedStorageNode;
+  /// Events (vtkCommand::ErrorEvent, WarningEvent or MessageEvent) and
+  /// messages logged while reading detached data.
+  std::vector< std::pair<unsigned long, std::string> > DetachedDataMessages;
+  /// Reference node DetachedDataNode has been prepared for (not observed)
+  vtkMRMLNode* DetachedDataReferenceNode;
+  /// Result of ReadDataInternal() on DetachedDataNode, -1 if not read yet
+  int DetachedDataReadResult;
+  /// True for the copy of the storage node that reads detached data,
+  /// progress events are not propagated as they would be invoked from a
+  /// worker thread.
+  bool ReadingDetachedData;
 };
 
 #endif
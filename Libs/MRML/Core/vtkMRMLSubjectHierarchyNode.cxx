@@ -107,6 +107,27 @@ public:
   /// It can be static as the item IDs are unique in one application session.
   static std::map<vtkIdType, vtkSubjectHierarchyItem*> ItemCache;
 
+  /// Indices to speed up lookup by data node, UID and name under a parent, performed for each
+  /// node added to the scene and many times during DICOM import.
+  /// They contain the items of the cache (i.e. items added to a tree) and are updated when items
+  /// are added, removed or reparented, and when their UIDs or names change. They can be static for
+  /// the same reason as the item cache. Found items are checked against the searched properties as
+  /// data nodes can be deleted or renamed without notifying the item.
+  typedef std::multimap<vtkMRMLNode*, vtkIdType> DataNodeIndexType;
+  typedef std::multimap<std::pair<std::string, std::string>, vtkIdType> UIDIndexType;
+  typedef std::multimap<std::pair<vtkIdType, std::string>, vtkIdType> ChildNameIndexType;
+  /// Items by data node
+  static DataNodeIndexType DataNodeIndex;
+  /// Items by UID name and UID value
+  static UIDIndexType UIDIndex;
+  /// Items by UID name and each UID of the space-separated UID value, used for lookup in UID lists
+  static UIDIndexType UIDListIndex;
+  /// Items by parent item ID and name. Items with data node are indexed with an empty name,
+  /// as their name is the name of the data node
+  static ChildNameIndexType ChildNameIndex;
+  /// Data node the item is indexed with. Only used as index key, as the node may have been deleted
+  vtkMRMLNode* IndexedDataNode;
+
 // Get/set functions
 public:
   /// Add data item to tree under parent, specifying basic properties
@@ -124,6 +145,8 @@ public:
 
   /// Get name of the item. If has data node associated then return name of data node, \sa Name member otherwise
   std::string GetName();
+  /// Set name of the item, used only if there is no data node associated
+  void SetName(std::string name);
 
   /// Set UID to the item
   void SetUID(std::string uidName, std::string uidValue);
@@ -230,6 +253,27 @@ public:
   /// \param level Level of the ancestor node we start searching.
   vtkSubjectHierarchyItem* GetAncestorAtLevel(std::string level);
 
+// Index related functions
+public:
+  /// Determine whether the item has been added to a tree, thus is in the item cache and indices
+  bool IsInTree();
+  /// Determine whether the item is in the branch of the given item (not including the item itself)
+  bool IsInBranch(vtkSubjectHierarchyItem* ancestorItem);
+  /// Get item from the cache if it is a child of this item
+  /// \param recursive Flag whether to accept only direct children (false) or the whole branch (true)
+  vtkSubjectHierarchyItem* GetCachedChild(vtkIdType itemID, bool recursive);
+  /// Add item to all the indices. Called when the item is added to a tree
+  void AddToIndex();
+  /// Remove item from all the indices. Called when the item is removed from its tree
+  void RemoveFromIndex();
+  /// Add/remove UID of the item to/from the UID indices
+  void AddUIDToIndex(std::string uidName, std::string uidValue);
+  void RemoveUIDFromIndex(std::string uidName, std::string uidValue);
+  /// Add/remove item to/from the child name index of its parent.
+  /// Called when the parent or the name of the item changes
+  void AddToChildNameIndex();
+  void RemoveFromChildNameIndex();
+
 public:
   vtkSubjectHierarchyItem();
   ~vtkSubjectHierarchyItem();
@@ -248,6 +292,40 @@ vtkStandardNewMacro(vtkSubjectHierarchyItem);
 vtkIdType vtkSubjectHierarchyItem::NextSubjectHierarchyItemID = vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID + 1;
 
 std::map<vtkIdType, vtkSubjectHierarchyItem*> vtkSubjectHierarchyItem::ItemCache = std::map<vtkIdType, vtkSubjectHierarchyItem*>();
+vtkSubjectHierarchyItem::DataNodeIndexType vtkSubjectHierarchyItem::DataNodeIndex = vtkSubjectHierarchyItem::DataNodeIndexType();
+vtkSubjectHierarchyItem::UIDIndexType vtkSubjectHierarchyItem::UIDIndex = vtkSubjectHierarchyItem::UIDIndexType();
+vtkSubjectHierarchyItem::UIDIndexType vtkSubjectHierarchyItem::UIDListIndex = vtkSubjectHierarchyItem::UIDIndexType();
+vtkSubjectHierarchyItem::ChildNameIndexType vtkSubjectHierarchyItem::ChildNameIndex = vtkSubjectHierarchyItem::ChildNameIndexType();
+
+namespace
+{
+
+//---------------------------------------------------------------------------
+template<class KeyType>
+void RemoveIndexEntry(std::multimap<KeyType, vtkIdType>& index, const KeyType& key, vtkIdType itemID)
+{
+  typedef typename std::multimap<KeyType, vtkIdType>::iterator IteratorType;
+  std::pair<IteratorType, IteratorType> range = index.equal_range(key);
+  for (IteratorType indexIt = range.first; indexIt != range.second; ++indexIt)
+    {
+    if (indexIt->second == itemID)
+      {
+      index.erase(indexIt);
+      return;
+      }
+    }
+}
+
+//---------------------------------------------------------------------------
+struct ItemPositionLess
+{
+  bool operator()(vtkSubjectHierarchyItem* item1, vtkSubjectHierarchyItem* item2) const
+    {
+    return item1->GetPositionUnderParent() < item2->GetPositionUnderParent();
+    }
+};
+
+}
 
 //---------------------------------------------------------------------------
 // vtkSubjectHierarchyItem methods
@@ -263,6 +341,7 @@ vtkSubjectHierarchyItem::vtkSubjectHierarchyItem()
   , TemporaryID(vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
   , TemporaryDataNodeID("")
   , TemporaryParentItemID(vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID)
+  , IndexedDataNode(NULL)
 {
   this->Children.clear();
   this->Attributes.clear();
@@ -301,8 +380,9 @@ vtkIdType vtkSubjectHierarchyItem::AddToTree(vtkSubjectHierarchyItem* parent, vt
     vtkSmartPointer<vtkSubjectHierarchyItem> childPointer(this);
     this->Parent->Children.push_back(childPointer);
 
-    // Add to cache
+    // Add to cache and indices
     vtkSubjectHierarchyItem::ItemCache[this->ID] = this;
+    this->AddToIndex();
     }
   else
     {
@@ -338,8 +418,9 @@ vtkIdType vtkSubjectHierarchyItem::AddToTree(vtkSubjectHierarchyItem* parent, st
     vtkSmartPointer<vtkSubjectHierarchyItem> childPointer(this);
     this->Parent->Children.push_back(childPointer);
 
-    // Add to cache
+    // Add to cache and indices
     vtkSubjectHierarchyItem::ItemCache[this->ID] = this;
+    this->AddToIndex();
     }
   else if (! ( (!name.compare("Scene") && !level.compare("Scene"))
             || (!name.compare("UnresolvedItems") && !level.compare("UnresolvedItems")) ) )
@@ -695,6 +776,18 @@ std::string vtkSubjectHierarchyItem::GetName()
   return this->Name;
 }
 
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::SetName(std::string name)
+{
+  if (!name.compare(this->Name))
+    {
+    return;
+    }
+  this->RemoveFromChildNameIndex();
+  this->Name = name;
+  this->AddToChildNameIndex();
+}
+
 //---------------------------------------------------------------------------
 bool vtkSubjectHierarchyItem::HasChildren()
 {
@@ -757,22 +850,16 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindChildByDataNode(vtkMRMLNod
     return NULL;
     }
 
-  ChildVector::iterator childIt;
-  for (childIt=this->Children.begin(); childIt!=this->Children.end(); ++childIt)
+  std::pair<DataNodeIndexType::iterator, DataNodeIndexType::iterator> range =
+    vtkSubjectHierarchyItem::DataNodeIndex.equal_range(dataNode);
+  for (DataNodeIndexType::iterator indexIt = range.first; indexIt != range.second; ++indexIt)
     {
-    vtkSubjectHierarchyItem* currentItem = childIt->GetPointer();
-    if (dataNode == currentItem->DataNode.GetPointer())
+    vtkSubjectHierarchyItem* currentItem = this->GetCachedChild(indexIt->second, recursive);
+    // The data node may have been deleted and another one created at the same address
+    if (currentItem && dataNode == currentItem->DataNode.GetPointer())
       {
       return currentItem;
       }
-    if (recursive)
-      {
-      vtkSubjectHierarchyItem* foundItemInBranch = currentItem->FindChildByDataNode(dataNode);
-      if (foundItemInBranch)
-        {
-        return foundItemInBranch;
-        }
-      }
     }
   return NULL;
 }
@@ -784,22 +871,16 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindChildByUID(std::string uid
     {
     return NULL;
     }
-  ChildVector::iterator childIt;
-  for (childIt=this->Children.begin(); childIt!=this->Children.end(); ++childIt)
+
+  std::pair<UIDIndexType::iterator, UIDIndexType::iterator> range =
+    vtkSubjectHierarchyItem::UIDIndex.equal_range(std::make_pair(uidName, uidValue));
+  for (UIDIndexType::iterator indexIt = range.first; indexIt != range.second; ++indexIt)
     {
-    vtkSubjectHierarchyItem* currentItem = childIt->GetPointer();
-    if (!currentItem->GetUID(uidName).compare(uidValue))
+    vtkSubjectHierarchyItem* currentItem = this->GetCachedChild(indexIt->second, recursive);
+    if (currentItem)
       {
       return currentItem;
       }
-    if (recursive)
-      {
-      vtkSubjectHierarchyItem* foundItemInBranch = currentItem->FindChildByUID(uidName, uidValue);
-      if (foundItemInBranch)
-        {
-        return foundItemInBranch;
-        }
-      }
     }
   return NULL;
 }
@@ -811,6 +892,24 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindChildByUIDList(std::string
     {
     return NULL;
     }
+
+  // Single UIDs are looked up in the index of the UID list elements
+  if (uidValue.find(' ') == std::string::npos)
+    {
+    std::pair<UIDIndexType::iterator, UIDIndexType::iterator> range =
+      vtkSubjectHierarchyItem::UIDListIndex.equal_range(std::make_pair(uidName, uidValue));
+    for (UIDIndexType::iterator indexIt = range.first; indexIt != range.second; ++indexIt)
+      {
+      vtkSubjectHierarchyItem* currentItem = this->GetCachedChild(indexIt->second, recursive);
+      if (currentItem)
+        {
+        return currentItem;
+        }
+      }
+    return NULL;
+    }
+
+  // Search the tree for lists of UIDs
   ChildVector::iterator childIt;
   for (childIt=this->Children.begin(); childIt!=this->Children.end(); ++childIt)
     {
@@ -834,6 +933,37 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::FindChildByUIDList(std::string
 //---------------------------------------------------------------------------
 void vtkSubjectHierarchyItem::FindChildrenByName(std::string name, std::vector<vtkIdType> &foundItemIDs, bool contains/*=false*/, bool recursive/*=true*/)
 {
+  if (!contains && !recursive && !name.empty())
+    {
+    // Look up exact name among direct children in the index. Children with data node are
+    // indexed with empty name, for those the name of the data node is compared
+    std::vector<vtkSubjectHierarchyItem*> foundItems;
+    std::string indexedNames[2] = { name, std::string() };
+    for (int nameIndex = 0; nameIndex < 2; ++nameIndex)
+      {
+      std::pair<ChildNameIndexType::iterator, ChildNameIndexType::iterator> range =
+        vtkSubjectHierarchyItem::ChildNameIndex.equal_range(std::make_pair(this->ID, indexedNames[nameIndex]));
+      for (ChildNameIndexType::iterator indexIt = range.first; indexIt != range.second; ++indexIt)
+        {
+        vtkSubjectHierarchyItem* currentItem = this->GetCachedChild(indexIt->second, false);
+        if (currentItem && !currentItem->GetName().compare(name))
+          {
+          foundItems.push_back(currentItem);
+          }
+        }
+      }
+    // Keep the order of the children
+    if (foundItems.size() > 1)
+      {
+      std::sort(foundItems.begin(), foundItems.end(), ItemPositionLess());
+      }
+    for (std::vector<vtkSubjectHierarchyItem*>::iterator itemIt = foundItems.begin(); itemIt != foundItems.end(); ++itemIt)
+      {
+      foundItemIDs.push_back((*itemIt)->ID);
+      }
+    return;
+    }
+
   if (contains && !name.empty())
     {
     std::transform(name.begin(), name.end(), name.begin(), ::tolower); // Make it lowercase for case-insensitive comparison
@@ -971,8 +1101,10 @@ bool vtkSubjectHierarchyItem::Reparent(vtkSubjectHierarchyItem* newParentItem)
   formerParentItem->Children.erase(childIt);
 
   // Add item to new parent
+  this->RemoveFromChildNameIndex();
   this->Parent = newParentItem;
   newParentItem->Children.push_back(thisPointer);
+  this->AddToChildNameIndex();
 
   // Invoke modified events on all affected items
   formerParentItem->Modified();
@@ -1125,7 +1257,8 @@ bool vtkSubjectHierarchyItem::RemoveChild(vtkSubjectHierarchyItem* item)
   // Reparent children to parent node (to avoid them becoming orphans and thus lost to the hierarchy)
   removedItem->ReparentChildrenToParent();
 
-  // Remove from cache
+  // Remove from cache and indices
+  removedItem->RemoveFromIndex();
   vtkSubjectHierarchyItem::ItemCache.erase(removedItem->ID);
 
   // Invoke events
@@ -1169,7 +1302,8 @@ bool vtkSubjectHierarchyItem::RemoveChild(vtkIdType itemID)
   // Reparent children to parent node (to avoid them becoming orphans and thus lost to the hierarchy)
   removedItem->ReparentChildrenToParent();
 
-  // Remove from cache
+  // Remove from cache and indices
+  removedItem->RemoveFromIndex();
   vtkSubjectHierarchyItem::ItemCache.erase(removedItem->ID);
 
   // Invoke events
@@ -1205,8 +1339,10 @@ void vtkSubjectHierarchyItem::ReparentChildrenToParent()
         // Remove child from this item
         this->Children.erase(childIt);
         // Add child item to this item's parent
+        childItem->RemoveFromChildNameIndex();
         childItem->Parent = this->Parent;
         this->Parent->Children.push_back(childSmartPointer);
+        childItem->AddToChildNameIndex();
         childItem->Modified();
         break;
         }
@@ -1274,6 +1410,15 @@ void vtkSubjectHierarchyItem::SetUID(std::string uidName, std::string uidValue)
       return; // Do nothing if the UID values match
       }
     }
+  if (this->IsInTree())
+    {
+    std::map<std::string, std::string>::iterator uidIt = this->UIDs.find(uidName);
+    if (uidIt != this->UIDs.end())
+      {
+      this->RemoveUIDFromIndex(uidName, uidIt->second);
+      }
+    this->AddUIDToIndex(uidName, uidValue);
+    }
   this->UIDs[uidName] = uidValue;
   this->InvokeEvent(vtkMRMLSubjectHierarchyNode::SubjectHierarchyItemUIDAddedEvent, this);
   this->Modified();
@@ -1420,6 +1565,120 @@ vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::GetAncestorAtLevel(std::string
 }
 
 
+//---------------------------------------------------------------------------
+bool vtkSubjectHierarchyItem::IsInTree()
+{
+  return this->ID != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+    && vtkSubjectHierarchyItem::ItemCache.find(this->ID) != vtkSubjectHierarchyItem::ItemCache.end();
+}
+
+//---------------------------------------------------------------------------
+bool vtkSubjectHierarchyItem::IsInBranch(vtkSubjectHierarchyItem* ancestorItem)
+{
+  for (vtkSubjectHierarchyItem* currentItem = this->Parent; currentItem; currentItem = currentItem->Parent)
+    {
+    if (currentItem == ancestorItem)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//---------------------------------------------------------------------------
+vtkSubjectHierarchyItem* vtkSubjectHierarchyItem::GetCachedChild(vtkIdType itemID, bool recursive)
+{
+  std::map<vtkIdType, vtkSubjectHierarchyItem*>::iterator itemIt = vtkSubjectHierarchyItem::ItemCache.find(itemID);
+  if (itemIt == vtkSubjectHierarchyItem::ItemCache.end())
+    {
+    return NULL;
+    }
+  vtkSubjectHierarchyItem* item = itemIt->second;
+  if (recursive ? item->IsInBranch(this) : item->Parent == this)
+    {
+    return item;
+    }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::AddToIndex()
+{
+  this->IndexedDataNode = this->DataNode.GetPointer();
+  if (this->IndexedDataNode)
+    {
+    vtkSubjectHierarchyItem::DataNodeIndex.insert(std::make_pair(this->IndexedDataNode, this->ID));
+    }
+  for (std::map<std::string, std::string>::iterator uidIt = this->UIDs.begin(); uidIt != this->UIDs.end(); ++uidIt)
+    {
+    this->AddUIDToIndex(uidIt->first, uidIt->second);
+    }
+  this->AddToChildNameIndex();
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::RemoveFromIndex()
+{
+  // The data node may have been deleted since the item was indexed
+  if (this->IndexedDataNode)
+    {
+    RemoveIndexEntry(vtkSubjectHierarchyItem::DataNodeIndex, this->IndexedDataNode, this->ID);
+    this->IndexedDataNode = NULL;
+    }
+  for (std::map<std::string, std::string>::iterator uidIt = this->UIDs.begin(); uidIt != this->UIDs.end(); ++uidIt)
+    {
+    this->RemoveUIDFromIndex(uidIt->first, uidIt->second);
+    }
+  this->RemoveFromChildNameIndex();
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::AddUIDToIndex(std::string uidName, std::string uidValue)
+{
+  vtkSubjectHierarchyItem::UIDIndex.insert(std::make_pair(std::make_pair(uidName, uidValue), this->ID));
+  std::vector<std::string> uidList;
+  vtkMRMLSubjectHierarchyNode::DeserializeUIDList(uidValue, uidList);
+  for (std::vector<std::string>::iterator uidIt = uidList.begin(); uidIt != uidList.end(); ++uidIt)
+    {
+    vtkSubjectHierarchyItem::UIDListIndex.insert(std::make_pair(std::make_pair(uidName, *uidIt), this->ID));
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::RemoveUIDFromIndex(std::string uidName, std::string uidValue)
+{
+  RemoveIndexEntry(vtkSubjectHierarchyItem::UIDIndex, std::make_pair(uidName, uidValue), this->ID);
+  std::vector<std::string> uidList;
+  vtkMRMLSubjectHierarchyNode::DeserializeUIDList(uidValue, uidList);
+  for (std::vector<std::string>::iterator uidIt = uidList.begin(); uidIt != uidList.end(); ++uidIt)
+    {
+    RemoveIndexEntry(vtkSubjectHierarchyItem::UIDListIndex, std::make_pair(uidName, *uidIt), this->ID);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::AddToChildNameIndex()
+{
+  if (!this->Parent || !this->IsInTree())
+    {
+    return;
+    }
+  // Items with data node have empty name
+  vtkSubjectHierarchyItem::ChildNameIndex.insert(
+    std::make_pair(std::make_pair(this->Parent->ID, this->Name), this->ID));
+}
+
+//---------------------------------------------------------------------------
+void vtkSubjectHierarchyItem::RemoveFromChildNameIndex()
+{
+  if (!this->Parent || !this->IsInTree())
+    {
+    return;
+    }
+  RemoveIndexEntry(vtkSubjectHierarchyItem::ChildNameIndex,
+    std::make_pair(this->Parent->ID, this->Name), this->ID);
+}
+
 //---------------------------------------------------------------------------
 //---------------------------------------------------------------------------
 class vtkMRMLSubjectHierarchyNode::vtkInternal
@@ -1876,7 +2135,7 @@ void vtkMRMLSubjectHierarchyNode::SetItemName(vtkIdType itemID, std::string name
     if ( !item->DataNode->GetName()
       || (item->DataNode->GetName() && name.compare(item->DataNode->GetName())) )
       {
-      item->Name = "";
+      item->SetName("");
       item->DataNode->SetName(name.c_str());
       nameChanged = true;
       }
@@ -1885,7 +2144,7 @@ void vtkMRMLSubjectHierarchyNode::SetItemName(vtkIdType itemID, std::string name
     {
     if (name.compare(item->Name))
       {
-      item->Name = name;
+      item->SetName(name);
       nameChanged = true;
       }
     }
@@ -2176,7 +2435,7 @@ vtkIdType vtkMRMLSubjectHierarchyNode::CreateItem(vtkIdType parentItemID, vtkMRM
     vtkSubjectHierarchyItem* item = this->Internal->SceneItem->FindChildByID(itemID);
 
     // The name of the data node is used, so empty name is set
-    item->Name = "";
+    item->SetName("");
     // Reparent if given parent is valid and different than the current one
     if (item->Parent && item->Parent->ID != parentItemID && parentItemID != INVALID_ITEM_ID)
       {
@@ -253,7 +253,9 @@ public:
 
   /// Find subject hierarchy item according to a UID (by containing). For example find UID in instance UID list
   /// \param uidName UID string to lookup
-  /// \param uidValue UID string that needs to be _contained_ in the UID string of the subject hierarchy item
+  /// \param uidValue UID string that needs to be _contained_ in the UID string of the subject hierarchy item.
+  ///   A single UID (without space) needs to be an element of the space-separated UID list of the item,
+  ///   which is looked up in an index. Lists of UIDs are searched as substrings in the whole tree
   /// \return First match
   /// \sa GetUID()
   vtkIdType GetItemByUIDList(const char* uidName, const char* uidValue);
@@ -26,20 +26,91 @@
 #include "vtkMRMLScene.h"
 
 // VTK includes
+#include <vtkDoubleArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkTable.h>
 #include <vtkStringArray.h>
-#include <vtkBitArray.h>
 #include <vtkNew.h>
 #include <vtkSQLQuery.h>
-#include <vtkRowQueryToTable.h>
 #include <vtkSQLDatabase.h>
 #include <vtkSQLiteDatabase.h>
 #include <vtkSQLiteQuery.h>
 #include <vtkSmartPointer.h>
+#include <vtkTypeInt64Array.h>
 
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Quote a table or column name so that it can contain any character.
+std::string QuoteIdentifier(const std::string& name)
+{
+  std::string quoted = "\"";
+  for (std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+    {
+    quoted += *it;
+    if (*it == '"')
+      {
+      quoted += '"';
+      }
+    }
+  quoted += "\"";
+  return quoted;
+}
+
+//----------------------------------------------------------------------------
+// Type used to store the values of a column: VTK_TYPE_INT64 (INTEGER),
+// VTK_DOUBLE (REAL), VTK_STRING (TEXT) or VTK_VARIANT (TEXT, converted
+// value by value).
+int GetColumnStorageType(vtkAbstractArray* column)
+{
+  if (vtkStringArray::SafeDownCast(column))
+    {
+    return VTK_STRING;
+    }
+  vtkDataArray* dataArray = vtkDataArray::SafeDownCast(column);
+  if (!dataArray)
+    {
+    return VTK_VARIANT;
+    }
+  if (dataArray->GetDataType() == VTK_FLOAT || dataArray->GetDataType() == VTK_DOUBLE)
+    {
+    return VTK_DOUBLE;
+    }
+  return VTK_TYPE_INT64;
+}
+
+//----------------------------------------------------------------------------
+// Array type of a column read from the database, from the declared type of
+// the column, following the SQLite type affinity rules.
+int GetArrayTypeFromDeclaredType(std::string declaredType)
+{
+  std::transform(declaredType.begin(), declaredType.end(), declaredType.begin(), ::toupper);
+  if (declaredType.find("INT") != std::string::npos)
+    {
+    return VTK_TYPE_INT64;
+    }
+  if (declaredType.find("CHAR") != std::string::npos
+    || declaredType.find("CLOB") != std::string::npos
+    || declaredType.find("TEXT") != std::string::npos
+    || declaredType.find("BLOB") != std::string::npos
+    || declaredType.empty())
+    {
+    return VTK_STRING;
+    }
+  // REAL, FLOAT, DOUBLE and NUMERIC
+  return VTK_DOUBLE;
+}
+
+} // end of anonymous namespace
+
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLTableSQLiteStorageNode);
 
@@ -84,6 +155,11 @@ int vtkMRMLTableSQLiteStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     vtkErrorMacro("ReadData: unable to cast input node " << refNode->GetID() << " to a table node");
     return 0;
     }
+  if (!this->TableName || std::string(this->TableName).empty())
+    {
+    vtkErrorMacro("ReadData: no table name specified");
+    return 0;
+    }
 
   // Check that the file exists
   if (vtksys::SystemTools::FileExists(fullName) == false)
@@ -104,18 +180,82 @@ int vtkMRMLTableSQLiteStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 
   vtkSmartPointer<vtkSQLiteQuery> query = vtkSmartPointer<vtkSQLiteQuery>::Take(
                    vtkSQLiteQuery::SafeDownCast( database->GetQueryInstance()));
-  std::string queryString("select * from ");
-  queryString += std::string(this->TableName);
-  query->SetQuery(queryString.c_str());
-  query->Execute();
 
-  vtkSmartPointer<vtkRowQueryToTable> queryToTable = vtkSmartPointer<vtkRowQueryToTable>::New();
-  queryToTable->SetQuery(query);
-  queryToTable->Update();
+  // The declared column types determine the array types, the values are then
+  // appended to the typed arrays while stepping through the rows.
+  std::string tableInfoQuery = "PRAGMA table_info(" + QuoteIdentifier(this->TableName) + ")";
+  query->SetQuery(tableInfoQuery.c_str());
+  if (!query->Execute())
+    {
+    vtkErrorMacro("ReadData: failed to read the columns of table '" << this->TableName
+      << "' from '" << fullName << "': " << query->GetLastErrorText());
+    return 0;
+    }
+  // table_info fields: cid, name, type, notnull, dflt_value, pk
+  std::vector<std::string> columnNames;
+  std::vector<int> columnTypes;
+  while (query->NextRow())
+    {
+    columnNames.push_back(query->DataValue(1).ToString());
+    columnTypes.push_back(GetArrayTypeFromDeclaredType(query->DataValue(2).ToString()));
+    }
+  if (columnNames.empty())
+    {
+    vtkErrorMacro("ReadData: table '" << this->TableName << "' not found in '" << fullName << "'");
+    return 0;
+    }
+
+  vtkNew<vtkTable> table;
+  std::string selectQuery = "SELECT ";
+  for (size_t columnIndex = 0; columnIndex < columnNames.size(); ++columnIndex)
+    {
+    vtkSmartPointer<vtkAbstractArray> column;
+    switch (columnTypes[columnIndex])
+      {
+      case VTK_TYPE_INT64: column = vtkSmartPointer<vtkTypeInt64Array>::New(); break;
+      case VTK_DOUBLE: column = vtkSmartPointer<vtkDoubleArray>::New(); break;
+      default: column = vtkSmartPointer<vtkStringArray>::New(); break;
+      }
+    column->SetName(columnNames[columnIndex].c_str());
+    table->AddColumn(column);
+    selectQuery += (columnIndex > 0 ? ", " : "") + QuoteIdentifier(columnNames[columnIndex]);
+    }
+  selectQuery += " FROM " + QuoteIdentifier(this->TableName);
+  query->SetQuery(selectQuery.c_str());
+  if (!query->Execute())
+    {
+    vtkErrorMacro("ReadData: failed to read table '" << this->TableName
+      << "' from '" << fullName << "': " << query->GetLastErrorText());
+    return 0;
+    }
 
-  vtkSmartPointer<vtkTable> table = queryToTable->GetOutput();
+  int numberOfColumns = static_cast<int>(columnNames.size());
+  std::vector<vtkAbstractArray*> columns(numberOfColumns);
+  for (int columnIndex = 0; columnIndex < numberOfColumns; ++columnIndex)
+    {
+    columns[columnIndex] = table->GetColumn(columnIndex);
+    }
+  while (query->NextRow())
+    {
+    for (int columnIndex = 0; columnIndex < numberOfColumns; ++columnIndex)
+      {
+      vtkVariant value = query->DataValue(columnIndex);
+      switch (columnTypes[columnIndex])
+        {
+        case VTK_TYPE_INT64:
+          static_cast<vtkTypeInt64Array*>(columns[columnIndex])->InsertNextValue(value.ToTypeInt64());
+          break;
+        case VTK_DOUBLE:
+          static_cast<vtkDoubleArray*>(columns[columnIndex])->InsertNextValue(value.ToDouble());
+          break;
+        default:
+          static_cast<vtkStringArray*>(columns[columnIndex])->InsertNextValue(value.ToString());
+          break;
+        }
+      }
+    }
 
-  tableNode->SetAndObserveTable(table);
+  tableNode->SetAndObserveTable(table.GetPointer());
 
   vtkDebugMacro("ReadData: successfully read table from file: " << fullName);
 
@@ -149,124 +289,150 @@ int vtkMRMLTableSQLiteStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
     return 0;
     }
 
-  std::string dbname = std::string("sqlite://") + fullName;
-
-  //vtkSmartPointer<vtkSQLiteDatabase> database = vtkSmartPointer<vtkSQLiteDatabase>::Take(vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str())));
-  vtkSQLiteDatabase *database = vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str()));
-
-  if (!database || !database->Open(this->GetPassword(), vtkSQLiteDatabase::USE_EXISTING_OR_CREATE))
-    {
-    vtkErrorMacro("ReadData: database file '" << fullName << "cannot be openned");
-    return 0;
-    }
-
   vtkTable *table = tableNode->GetTable();
   if (!table)
     {
-    vtkErrorMacro("ReadData: no table to write for the node '" << std::string(tableNode->GetName()));
+    vtkErrorMacro("WriteData: no table to write for the node '" << std::string(tableNode->GetName()));
     return 0;
     }
 
-  if (!this->TableName || std::string(this->TableName).empty())
+  std::string dbname = std::string("sqlite://") + fullName;
+  vtkSmartPointer<vtkSQLiteDatabase> database = vtkSmartPointer<vtkSQLiteDatabase>::Take(
+                   vtkSQLiteDatabase::SafeDownCast( vtkSQLiteDatabase::CreateFromURL(dbname.c_str())));
+
+  if (!database.GetPointer() || !database->Open(this->GetPassword(), vtkSQLiteDatabase::USE_EXISTING_OR_CREATE))
     {
-    vtkErrorMacro("ReadData: no table name for the node '" << std::string(tableNode->GetName()));
+    vtkErrorMacro("WriteData: database file '" << fullName << "cannot be openned");
     return 0;
     }
 
-  // first try to drop the table
-  this->DropTable(this->TableName, database);
-
   //converting this table to SQLite will require two queries: one to create
-  //the table, and another to populate its rows with data.
+  //the table, and a prepared statement to insert the rows.
   std::string createTableQuery = "CREATE TABLE IF NOT EXISTS ";
-  createTableQuery += this->TableName;
-  createTableQuery += "(";
-
-  std::string insertPreamble = "INSERT into ";
-  insertPreamble += this->TableName;
-  insertPreamble += "(";
-
-  //get the columns from the vtkTable to finish the query
-  vtkIdType numColumns = table->GetNumberOfColumns();
-  for(vtkIdType i = 0; i < numColumns; i++)
+  createTableQuery += QuoteIdentifier(this->TableName);
+  createTableQuery += " (";
+
+  std::string insertQuery = "INSERT INTO ";
+  insertQuery += QuoteIdentifier(this->TableName);
+  insertQuery += " (";
+  std::string insertValues = ") VALUES (";
+
+  //get the columns from the vtkTable to finish the queries
+  int numColumns = static_cast<int>(table->GetNumberOfColumns());
+  std::vector<vtkAbstractArray*> columns(numColumns);
+  std::vector<int> columnTypes(numColumns);
+  for(int i = 0; i < numColumns; i++)
     {
+    columns[i] = table->GetColumn(i);
     //get this column's name
-    std::string columnName = table->GetColumn(i)->GetName();
+    const char* name = columns[i]->GetName();
+    std::string columnName = QuoteIdentifier(name ? name : "");
     createTableQuery += columnName;
-    insertPreamble += "'" + columnName + "'";
+    insertQuery += columnName;
+    insertValues += "?";
 
     //figure out what type of data is stored in this column
-    std::string columnType = table->GetColumn(i)->GetClassName();
-
-    if( (columnType.find("String") != std::string::npos) ||
-        (columnType.find("Data") != std::string::npos) ||
-        (columnType.find("Variant") != std::string::npos) )
-      {
-      createTableQuery += " TEXT";
-      }
-    else if( (columnType.find("Double") != std::string::npos) ||
-             (columnType.find("Float") != std::string::npos) )
-      {
-      createTableQuery += " REAL";
-      }
-    else
+    columnTypes[i] = GetColumnStorageType(columns[i]);
+    switch (columnTypes[i])
       {
-      createTableQuery += " INTEGER";
+      case VTK_TYPE_INT64: createTableQuery += " INTEGER"; break;
+      case VTK_DOUBLE: createTableQuery += " REAL"; break;
+      default: createTableQuery += " TEXT"; break;
       }
-    if(i == numColumns - 1)
-      {
-      createTableQuery += ");";
-      insertPreamble += ") VALUES (";
-      }
-    else
+    if (i < numColumns - 1)
       {
       createTableQuery += ", ";
-      insertPreamble += ", ";
+      insertQuery += ", ";
+      insertValues += ", ";
       }
     }
+  createTableQuery += ")";
+  insertQuery += insertValues + ")";
 
-  //perform the create table query
-  vtkSQLiteQuery *query =
-    static_cast<vtkSQLiteQuery*>(database->GetQueryInstance());
+  // Replace the table and insert all the rows with a single prepared
+  // statement in a single transaction: committing each row separately would
+  // sync the file to disk after each of them, and a failure rolls back to the
+  // previous content of the table.
+  vtkSmartPointer<vtkSQLiteQuery> query = vtkSmartPointer<vtkSQLiteQuery>::Take(
+                   vtkSQLiteQuery::SafeDownCast( database->GetQueryInstance()));
+  if (!query->BeginTransaction())
+    {
+    vtkErrorMacro(<<"Error starting transaction: " << query->GetLastErrorText());
+    return 0;
+    }
+
+  // first try to drop the table
+  this->DropTable(this->TableName, database);
 
+  //perform the create table query
   query->SetQuery(createTableQuery.c_str());
-  cout << "creating the table" << endl;
   if(!query->Execute())
     {
-    vtkErrorMacro(<<"Error performing 'create table' query");
+    vtkErrorMacro(<<"Error performing 'create table' query: " << query->GetLastErrorText());
+    query->RollbackTransaction();
+    return 0;
     }
 
-  //iterate over the rows of the vtkTable to complete the insert query
+  query->SetQuery(insertQuery.c_str());
   vtkIdType numRows = table->GetNumberOfRows();
+  vtkIdType numCompleteRows = numRows;
+  for (int j = 0; j < numColumns; j++)
+    {
+    numCompleteRows = std::min(numCompleteRows, columns[j]->GetNumberOfTuples());
+    }
   for(vtkIdType i = 0; i < numRows; i++)
     {
-    std::string insertQuery = insertPreamble;
-    for (vtkIdType j = 0; j < numColumns; j++)
+    if (i >= numCompleteRows)
+      {
+      // values missing from shorter columns are stored as NULL
+      query->ClearParameterBindings();
+      }
+    for (int j = 0; j < numColumns; j++)
       {
-      insertQuery += "'" + table->GetValue(i, j).ToString() + "'";
-      if(j < numColumns - 1)
+      vtkAbstractArray* column = columns[j];
+      if (i >= column->GetNumberOfTuples())
         {
-        insertQuery += ", ";
+        continue;
+        }
+      switch (columnTypes[j])
+        {
+        case VTK_TYPE_INT64:
+          query->BindParameter(j, static_cast<vtkTypeInt64>(
+            static_cast<vtkDataArray*>(column)->GetComponent(i, 0)));
+          break;
+        case VTK_DOUBLE:
+          query->BindParameter(j, static_cast<vtkDataArray*>(column)->GetComponent(i, 0));
+          break;
+        case VTK_STRING:
+          query->BindParameter(j, static_cast<vtkStringArray*>(column)->GetValue(i));
+          break;
+        default:
+          query->BindParameter(j, column->GetVariantValue(i).ToString());
+          break;
         }
       }
-    insertQuery += ");";
-    //perform the insert query for this row
-    query->SetQuery(insertQuery.c_str());
     if(!query->Execute())
       {
-      vtkErrorMacro(<<"Error performing 'insert' query");
+      vtkErrorMacro(<<"Error performing 'insert' query: " << query->GetLastErrorText());
+      query->RollbackTransaction();
+      return 0;
       }
     }
+  if (!query->CommitTransaction())
+    {
+    vtkErrorMacro(<<"Error committing transaction: " << query->GetLastErrorText());
+    return 0;
+    }
 
   //cleanup and return
-  query->Delete();
+  query = NULL;
   database->Close();
-  database->Delete();
 
   vtkDebugMacro("WriteData: successfully wrote table to database: " << fullName);
   return 1;
 }
 
+//----------------------------------------------------------------------------
 int vtkMRMLTableSQLiteStorageNode::DropTable(char *tableName, vtkSQLiteDatabase* database)
 {
   if(!tableName || std::string(tableName).empty())
@@ -290,7 +456,7 @@ int vtkMRMLTableSQLiteStorageNode::DropTable(char *tableName, vtkSQLiteDatabase*
     if (!tables->GetValue(i).compare(tableName))
       {
       std::string dropTableQuery = "DROP TABLE ";
-      dropTableQuery += tableName;
+      dropTableQuery += QuoteIdentifier(tableName);
       query->SetQuery(dropTableQuery.c_str());
       query->Execute();
       break;
@@ -30,7 +30,11 @@
 /// vtkMRMLTableSQLiteStorageNode allows reading/writing of table node from
 /// SQLight database.
 ///
-///
+/// All the rows are written in a single transaction with a prepared insert
+/// statement. Integer columns are stored as INTEGER, floating point columns
+/// as REAL and all other columns as TEXT. When reading, INTEGER columns are
+/// loaded into vtkTypeInt64Array, REAL columns into vtkDoubleArray and TEXT
+/// columns into vtkStringArray.
 
 class vtkSQLiteDatabase;
 
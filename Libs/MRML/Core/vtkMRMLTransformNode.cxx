@@ -29,22 +29,153 @@ Version:   $Revision: 1.14 $
 #include <vtkCollection.h>
 #include <vtkCollectionIterator.h>
 #include <vtkGeneralTransform.h>
+#include <vtkGridTransform.h>
 #include <vtkImageData.h>
 #include <vtkLinearTransform.h>
 #include <vtkHomogeneousTransform.h>
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPoints.h>
+#include <vtkSmartPointer.h>
 #include <vtkThinPlateSplineTransform.h>
 #include <vtkTransform.h>
+#include <vtkTransformToGrid.h>
 
 // STD includes
+#include <algorithm>
+#include <cmath>
+#include <list>
 #include <sstream>
 #include <stack>
+#include <vector>
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLTransformNode);
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Sample the transform on a grid that covers the bounds, refined until the
+/// error is below the tolerance. Return NULL if the tolerance cannot be
+/// reached.
+vtkSmartPointer<vtkGridTransform> ComputeGridTransform(vtkAbstractTransform* exactTransform,
+                                                       const double bounds[6], double tolerance)
+{
+  double size = 0.;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    size = std::max(size, bounds[2 * axis + 1] - bounds[2 * axis]);
+    }
+
+  // Halve the spacing until the error is below the tolerance
+  const vtkIdType maximumNumberOfPoints = 1 << 21;
+  for (double spacing = size / 16.; ; spacing /= 2.)
+    {
+    int dimensions[3] = { 0 };
+    double origin[3] = { 0. };
+    vtkIdType numberOfPoints = 1;
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      int numberOfCells = std::max(1, static_cast<int>(ceil((bounds[2 * axis + 1] - bounds[2 * axis]) / spacing)));
+      dimensions[axis] = numberOfCells + 1;
+      origin[axis] = (bounds[2 * axis] + bounds[2 * axis + 1] - numberOfCells * spacing) / 2.;
+      numberOfPoints *= dimensions[axis];
+      }
+    if (numberOfPoints > maximumNumberOfPoints)
+      {
+      return NULL;
+      }
+
+    vtkNew<vtkTransformToGrid> sampler;
+    sampler->SetInput(exactTransform);
+    sampler->SetGridOrigin(origin);
+    sampler->SetGridSpacing(spacing, spacing, spacing);
+    sampler->SetGridExtent(0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1);
+    sampler->SetGridScalarTypeToFloat();
+    sampler->Update();
+    vtkSmartPointer<vtkGridTransform> grid = vtkSmartPointer<vtkGridTransform>::New();
+    grid->SetDisplacementGridData(sampler->GetOutput());
+    grid->SetDisplacementScale(sampler->GetDisplacementScale());
+    grid->SetDisplacementShift(sampler->GetDisplacementShift());
+    grid->SetInterpolationModeToLinear();
+    grid->Update();
+
+    // Linear interpolation is the least accurate at the center of the cells.
+    // Every cell is checked: the error of non-linear transforms peaks locally
+    // (e.g. around thin plate spline landmarks) and would be missed by a
+    // subsampling. Stop at the first cell above the tolerance.
+    bool accurate = true;
+    for (int k = 0; k < dimensions[2] - 1 && accurate; ++k)
+      {
+      for (int j = 0; j < dimensions[1] - 1 && accurate; ++j)
+        {
+        for (int i = 0; i < dimensions[0] - 1 && accurate; ++i)
+          {
+          double point[3] =
+            {
+            origin[0] + (i + 0.5) * spacing,
+            origin[1] + (j + 0.5) * spacing,
+            origin[2] + (k + 0.5) * spacing
+            };
+          double exactPoint[3] = { 0. };
+          double gridPoint[3] = { 0. };
+          exactTransform->TransformPoint(point, exactPoint);
+          grid->TransformPoint(point, gridPoint);
+          accurate = (vtkMath::Distance2BetweenPoints(exactPoint, gridPoint) <= tolerance * tolerance);
+          }
+        }
+      }
+    if (accurate)
+      {
+      return grid;
+      }
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+//----------------------------------------------------------------------------
+class vtkMRMLTransformNode::vtkInternal
+{
+public:
+  vtkInternal()
+    : ParentTransformNode(NULL), ParentUpdateTime(0), Linear(true)
+    {
+    }
+
+  /// Hierarchy the cached transform to world was built from.
+  /// The parent node is only compared, never dereferenced.
+  vtkMRMLTransformNode* ParentTransformNode;
+  vtkMTimeType ParentUpdateTime;
+  vtkSmartPointer<vtkAbstractTransform> TransformToParent;
+  /// TransformToParent with its general transforms decomposed
+  std::vector< vtkSmartPointer<vtkAbstractTransform> > FlattenedTransformToParent;
+  vtkTimeStamp UpdateTime;
+
+  /// True if all the transforms to world are linear
+  bool Linear;
+  /// Transforms to world, in the order they are applied to points.
+  /// Consecutive linear transforms are concatenated into one vtkTransform.
+  std::vector< vtkSmartPointer<vtkAbstractTransform> > Components;
+
+  /// Grid approximation of the transform to or from world over bounds
+  struct GridEntry
+    {
+    bool FromWorld;
+    double Bounds[6];
+    double Tolerance;
+    /// NULL if the tolerance cannot be reached
+    vtkSmartPointer<vtkGridTransform> Grid;
+    vtkTimeStamp Time;
+    };
+  /// Grids of the consumers of the transform (e.g. one per volume under the
+  /// transform), the most recently used first.
+  std::list<GridEntry> Grids;
+};
+
 //----------------------------------------------------------------------------
 vtkMRMLTransformNode::vtkMRMLTransformNode()
 {
@@ -54,6 +185,8 @@ vtkMRMLTransformNode::vtkMRMLTransformNode()
 
   this->CachedMatrixTransformToParent=vtkMatrix4x4::New();
   this->CachedMatrixTransformFromParent=vtkMatrix4x4::New();
+
+  this->Internal = new vtkInternal;
 }
 
 //----------------------------------------------------------------------------
@@ -66,6 +199,9 @@ vtkMRMLTransformNode::~vtkMRMLTransformNode()
   this->CachedMatrixTransformToParent=NULL;
   this->CachedMatrixTransformFromParent->Delete();
   this->CachedMatrixTransformFromParent=NULL;
+
+  delete this->Internal;
+  this->Internal = NULL;
 }
 
 //----------------------------------------------------------------------------
@@ -294,6 +430,39 @@ void vtkMRMLTransformNode::Copy(vtkMRMLNode *anode)
   this->EndModify(disabledModify);
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLTransformNode::GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects)
+{
+  vtkAbstractTransform* transforms[2] = { this->TransformToParent, this->TransformFromParent };
+  for (int transformIndex = 0; transformIndex < 2; ++transformIndex)
+    {
+    if (!transforms[transformIndex])
+      {
+      continue;
+      }
+    vtkNew<vtkCollection> transformList;
+    vtkMRMLTransformNode::FlattenGeneralTransform(transformList.GetPointer(), transforms[transformIndex]);
+    vtkCollectionSimpleIterator it;
+    vtkObject* transform = NULL;
+    for (transformList->InitTraversal(it); (transform = transformList->GetNextItemAsObject(it));)
+      {
+      vtkDataObject* dataObject = NULL;
+      if (vtkGridTransform::SafeDownCast(transform))
+        {
+        dataObject = vtkGridTransform::SafeDownCast(transform)->GetDisplacementGrid();
+        }
+      else if (vtkBSplineTransform::SafeDownCast(transform))
+        {
+        dataObject = vtkBSplineTransform::SafeDownCast(transform)->GetCoefficientData();
+        }
+      if (dataObject && std::find(dataObjects.begin(), dataObjects.end(), dataObject) == dataObjects.end())
+        {
+        dataObjects.push_back(dataObject);
+        }
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLTransformNode::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -368,15 +537,97 @@ vtkAbstractTransform* vtkMRMLTransformNode::GetTransformFromParent()
 //----------------------------------------------------------------------------
 int  vtkMRMLTransformNode::IsTransformToWorldLinear()
 {
-  for (vtkMRMLTransformNode* current = this; current != NULL; current = current->GetParentTransformNode())
+  this->UpdateTransformToWorldCache();
+  return this->Internal->Linear ? 1 : 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLTransformNode::UpdateTransformToWorldCache()
+{
+  vtkMRMLTransformNode* parent = this->GetParentTransformNode();
+  vtkMTimeType parentUpdateTime = 0;
+  if (parent)
     {
-    if (!current->IsLinear())
+    parent->UpdateTransformToWorldCache();
+    parentUpdateTime = parent->Internal->UpdateTime.GetMTime();
+    }
+  vtkAbstractTransform* transformToParent = this->GetTransformToParent();
+
+  // General transforms are decomposed, so that general transforms of linear
+  // transforms are linear. Their list of transforms is compared, as it can
+  // change without replacing the general transform.
+  std::vector< vtkSmartPointer<vtkAbstractTransform> > flattenedTransformToParent;
+  if (vtkGeneralTransform::SafeDownCast(transformToParent))
+    {
+    vtkNew<vtkCollection> transformList;
+    vtkMRMLTransformNode::FlattenGeneralTransform(transformList.GetPointer(), transformToParent);
+    vtkCollectionSimpleIterator it;
+    vtkObject* transform = NULL;
+    for (transformList->InitTraversal(it); (transform = transformList->GetNextItemAsObject(it));)
       {
-      return 0;
+      flattenedTransformToParent.push_back(vtkAbstractTransform::SafeDownCast(transform));
       }
     }
-  // not found non-linear transform component, therefore it's a linear transform
-  return 1;
+  else if (transformToParent)
+    {
+    flattenedTransformToParent.push_back(transformToParent);
+    }
+
+  // Modifying the content of the transforms does not invalidate the cache:
+  // the cached components are the transforms themselves, not copies.
+  if (this->Internal->UpdateTime.GetMTime() > 0
+    && this->Internal->ParentTransformNode == parent
+    && this->Internal->ParentUpdateTime == parentUpdateTime
+    && this->Internal->TransformToParent.GetPointer() == transformToParent
+    && this->Internal->FlattenedTransformToParent == flattenedTransformToParent)
+    {
+    return;
+    }
+
+  std::vector<vtkAbstractTransform*> transforms;
+  for (std::vector< vtkSmartPointer<vtkAbstractTransform> >::iterator transformIt = flattenedTransformToParent.begin();
+    transformIt != flattenedTransformToParent.end(); ++transformIt)
+    {
+    transforms.push_back(transformIt->GetPointer());
+    }
+  if (parent)
+    {
+    for (std::vector< vtkSmartPointer<vtkAbstractTransform> >::iterator parentIt = parent->Internal->Components.begin();
+      parentIt != parent->Internal->Components.end(); ++parentIt)
+      {
+      transforms.push_back(parentIt->GetPointer());
+      }
+    }
+
+  std::vector< vtkSmartPointer<vtkAbstractTransform> > components;
+  vtkTransform* linearComponent = NULL;
+  for (std::vector<vtkAbstractTransform*>::iterator transformIt = transforms.begin();
+    transformIt != transforms.end(); ++transformIt)
+    {
+    vtkLinearTransform* linearTransform = vtkLinearTransform::SafeDownCast(*transformIt);
+    if (!linearTransform)
+      {
+      components.push_back(*transformIt);
+      linearComponent = NULL;
+      continue;
+      }
+    if (!linearComponent)
+      {
+      vtkSmartPointer<vtkTransform> newLinearComponent = vtkSmartPointer<vtkTransform>::New();
+      newLinearComponent->PostMultiply();
+      components.push_back(newLinearComponent);
+      linearComponent = newLinearComponent;
+      }
+    linearComponent->Concatenate(linearTransform);
+    }
+
+  this->Internal->Linear = (components.empty() || (components.size() == 1 && linearComponent != NULL));
+  this->Internal->Components.swap(components);
+  this->Internal->ParentTransformNode = parent;
+  this->Internal->ParentUpdateTime = parentUpdateTime;
+  this->Internal->TransformToParent = transformToParent;
+  this->Internal->FlattenedTransformToParent.swap(flattenedTransformToParent);
+  this->Internal->UpdateTime.Modified();
 }
 
 //----------------------------------------------------------------------------
@@ -479,6 +730,23 @@ void vtkMRMLTransformNode::GetTransformBetweenNodes(vtkMRMLTransformNode* source
     return;
     }
 
+  if (sourceNode == NULL || targetNode == NULL)
+    {
+    // transform to or from world: use the cached transform to world
+    vtkMRMLTransformNode* node = (sourceNode != NULL ? sourceNode : targetNode);
+    node->UpdateTransformToWorldCache();
+    for (std::vector< vtkSmartPointer<vtkAbstractTransform> >::iterator componentIt = node->Internal->Components.begin();
+      componentIt != node->Internal->Components.end(); ++componentIt)
+      {
+      transformSourceToTarget->Concatenate(componentIt->GetPointer());
+      }
+    if (sourceNode == NULL)
+      {
+      transformSourceToTarget->Inverse();
+      }
+    return;
+    }
+
   if (sourceNode != NULL && sourceNode->IsTransformNodeMyParent(targetNode))
     {
     // traverse the transform tree from bottom to top, from sourceNode to targetNode
@@ -835,6 +1103,100 @@ int  vtkMRMLTransformNode::GetMatrixTransformFromWorld(vtkMatrix4x4* transformFr
   return vtkMRMLTransformNode::GetMatrixTransformBetweenNodes(NULL, this, transformFromWorld);
 }
 
+//----------------------------------------------------------------------------
+vtkAbstractTransform* vtkMRMLTransformNode::GetTransformToWorldGrid(const double bounds[6], double tolerance)
+{
+  return this->GetTransformWorldGrid(bounds, tolerance, false);
+}
+
+//----------------------------------------------------------------------------
+vtkAbstractTransform* vtkMRMLTransformNode::GetTransformFromWorldGrid(const double bounds[6], double tolerance)
+{
+  return this->GetTransformWorldGrid(bounds, tolerance, true);
+}
+
+//----------------------------------------------------------------------------
+vtkAbstractTransform* vtkMRMLTransformNode::GetTransformWorldGrid(const double bounds[6], double tolerance, bool fromWorld)
+{
+  if (bounds == NULL || tolerance <= 0.)
+    {
+    vtkErrorMacro("vtkMRMLTransformNode::GetTransformWorldGrid failed: invalid bounds or tolerance");
+    return NULL;
+    }
+  double size = 0.;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    size = std::max(size, bounds[2 * axis + 1] - bounds[2 * axis]);
+    }
+  if (size <= 0.)
+    {
+    vtkErrorMacro("vtkMRMLTransformNode::GetTransformWorldGrid failed: empty bounds");
+    return NULL;
+    }
+
+  this->UpdateTransformToWorldCache();
+  if (this->Internal->Linear)
+    {
+    return NULL;
+    }
+
+  // Grids, and failures to reach the tolerance, are cached. A grid is reused
+  // for bounds it covers with the same or a better tolerance.
+  vtkInternal* internal = this->Internal;
+  vtkMTimeType updateTime = std::max(internal->UpdateTime.GetMTime(), this->GetTransformToWorldMTime());
+  std::list<vtkInternal::GridEntry>::iterator gridIt = internal->Grids.begin();
+  while (gridIt != internal->Grids.end())
+    {
+    if (gridIt->Time.GetMTime() <= updateTime)
+      {
+      // the transforms to world changed since the grid was computed
+      gridIt = internal->Grids.erase(gridIt);
+      continue;
+      }
+    bool sameKey = (gridIt->Tolerance == tolerance && std::equal(bounds, bounds + 6, gridIt->Bounds));
+    bool covered = (gridIt->Grid.GetPointer() != NULL && gridIt->Tolerance <= tolerance);
+    for (int axis = 0; axis < 3 && covered; ++axis)
+      {
+      covered = (gridIt->Bounds[2 * axis] <= bounds[2 * axis] && bounds[2 * axis + 1] <= gridIt->Bounds[2 * axis + 1]);
+      }
+    if (gridIt->FromWorld == fromWorld && (sameKey || covered))
+      {
+      internal->Grids.splice(internal->Grids.begin(), internal->Grids, gridIt);
+      return internal->Grids.front().Grid;
+      }
+    ++gridIt;
+    }
+
+  vtkInternal::GridEntry entry;
+  entry.FromWorld = fromWorld;
+  std::copy(bounds, bounds + 6, entry.Bounds);
+  entry.Tolerance = tolerance;
+  vtkNew<vtkGeneralTransform> exactTransform;
+  if (fromWorld)
+    {
+    this->GetTransformFromWorld(exactTransform.GetPointer());
+    }
+  else
+    {
+    this->GetTransformToWorld(exactTransform.GetPointer());
+    }
+  exactTransform->Update();
+  entry.Grid = ComputeGridTransform(exactTransform.GetPointer(), bounds, tolerance);
+  if (entry.Grid.GetPointer() == NULL)
+    {
+    // Not an error, callers fall back to the exact transform
+    vtkDebugMacro("vtkMRMLTransformNode::GetTransformWorldGrid: tolerance " << tolerance << " cannot be reached");
+    }
+  entry.Time.Modified();
+  internal->Grids.push_front(entry);
+  const size_t maximumNumberOfGrids = 8;
+  if (internal->Grids.size() > maximumNumberOfGrids)
+    {
+    internal->Grids.pop_back();
+    }
+  return entry.Grid;
+}
+
 //----------------------------------------------------------------------------
 int  vtkMRMLTransformNode::GetMatrixTransformToNode(vtkMRMLTransformNode* node, vtkMatrix4x4* transformToNode)
 {
@@ -862,6 +1224,29 @@ int  vtkMRMLTransformNode::GetMatrixTransformBetweenNodes(vtkMRMLTransformNode*
     return 1;
     }
 
+  if (sourceNode == NULL || targetNode == NULL)
+    {
+    // transform to or from world: use the cached transform to world,
+    // which is a single matrix if all the transforms are linear
+    vtkMRMLTransformNode* node = (sourceNode != NULL ? sourceNode : targetNode);
+    node->UpdateTransformToWorldCache();
+    transformSourceToTarget->Identity();
+    if (!node->Internal->Linear)
+      {
+      vtkGenericWarningMacro("vtkMRMLTransformNode::GetMatrixTransformBetweenNodes failed: expected linear transforms between nodes");
+      return 0;
+      }
+    if (!node->Internal->Components.empty())
+      {
+      vtkTransform::SafeDownCast(node->Internal->Components[0])->GetMatrix(transformSourceToTarget);
+      }
+    if (sourceNode == NULL)
+      {
+      transformSourceToTarget->Invert();
+      }
+    return 1;
+    }
+
   if (sourceNode && sourceNode->IsTransformNodeMyParent(targetNode))
     {
     transformSourceToTarget->Identity();
@@ -51,6 +51,11 @@ public:
   /// Copy the node's attributes to this object
   virtual void Copy(vtkMRMLNode *node) VTK_OVERRIDE;
 
+  ///
+  /// Add the displacement grids and B-spline coefficients of the transforms
+  /// to \a dataObjects.
+  virtual void GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects) VTK_OVERRIDE;
+
   ///
   /// Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() VTK_OVERRIDE {return "Transform";};
@@ -111,7 +116,8 @@ public:
   virtual const char* GetTransformFromParentInfo();
 
   ///
-  /// 1 if all the transforms to the top are linear, 0 otherwise
+  /// 1 if all the transforms to the top are linear, 0 otherwise.
+  /// General transforms that only concatenate linear transforms are linear.
   int  IsTransformToWorldLinear();
 
   ///
@@ -120,6 +126,11 @@ public:
 
   ///
   /// Get concatenated transforms to world.
+  /// The transforms to world are cached in each node: consecutive linear
+  /// transforms are concatenated into a single matrix and the cache of a node
+  /// is only rebuilt when the transform of this node or of one of its parents
+  /// is replaced or the hierarchy changes. As before, the returned transform
+  /// follows later modifications of the transforms of the hierarchy.
   /// \sa GetTransformBetweenNodes
   void GetTransformToWorld(vtkGeneralTransform* transformToWorld);
 
@@ -152,6 +163,33 @@ public:
   /// \sa GetMatrixTransformBetweenNodes
   virtual int GetMatrixTransformToWorld(vtkMatrix4x4* transformToWorld);
 
+  ///
+  /// Get an approximation of the transform to world sampled on a displacement
+  /// grid that covers \a bounds (in the coordinate system of this node).
+  /// The grid is refined until the approximation error, estimated at the
+  /// center of every grid cell, is below \a tolerance. Transforming a point
+  /// then costs a single trilinear interpolation, whatever the number of
+  /// non-linear transforms to world. Points outside \a bounds get the
+  /// displacement of the closest grid point.
+  /// The grid is computed on the first call and kept until the transforms to
+  /// world change. The 8 most recently used grids are kept, so that consumers
+  /// with different bounds (e.g. several volumes under the transform) do not
+  /// discard each other's grid. A grid is also returned for bounds it covers
+  /// with the same or a smaller tolerance.
+  /// Returns NULL if the transform to world is linear (use
+  /// GetMatrixTransformToWorld instead) or if the tolerance cannot be
+  /// reached with a grid of at most 2^21 points.
+  /// \sa vtkMRMLSliceLayerLogic::UpdateTransforms()
+  vtkAbstractTransform* GetTransformToWorldGrid(const double bounds[6], double tolerance);
+
+  ///
+  /// Get an approximation of the transform from world sampled on a
+  /// displacement grid that covers \a bounds (in world coordinates).
+  /// The inverse of non-linear transforms is computed iteratively for each
+  /// point, so the grid is especially useful in this direction.
+  /// \sa GetTransformToWorldGrid
+  vtkAbstractTransform* GetTransformFromWorldGrid(const double bounds[6], double tolerance);
+
   ///
   /// Get concatenated transforms from world.
   /// Returns 0 if the transform is not linear (cannot be described by a matrix).
@@ -354,6 +392,16 @@ protected:
   vtkMRMLTransformNode(const vtkMRMLTransformNode&);
   void operator=(const vtkMRMLTransformNode&);
 
+  ///
+  /// Rebuild the cached transform to world if the transform of this node or
+  /// of one of its parents has been replaced or if a parent changed.
+  void UpdateTransformToWorldCache();
+
+  ///
+  /// Compute or return the cached grid approximation of the transform
+  /// to (or from) world.
+  vtkAbstractTransform* GetTransformWorldGrid(const double bounds[6], double tolerance, bool fromWorld);
+
   ///
   /// Retrieves a simple transform from a generic transform
   /// If the generic transform is composed of multiple transform or contains a different
@@ -383,6 +431,10 @@ protected:
   /// GetMatrixTransformToParent and GetMatrixFromParent methods
   vtkMatrix4x4* CachedMatrixTransformToParent;
   vtkMatrix4x4* CachedMatrixTransformFromParent;
+
+  /// Cached transforms to world
+  class vtkInternal;
+  vtkInternal* Internal;
 };
 
 #endif
@@ -37,15 +37,20 @@ Version:   $Revision: 1.6 $
 #include <vtkDataArray.h>
 #include <vtkErrorCode.h>
 #include <vtkImageChangeInformation.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkSmartPointer.h>
 #include <vtkStringArray.h>
 #include <vtksys/Directory.hxx>
 
+// ITK includes
+#include <itkObjectFactoryBase.h>
+
 // STD includes
 #include <algorithm>
 #include <iterator>
+#include <sstream>
 
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLVolumeArchetypeStorageNode);
@@ -259,6 +264,8 @@ void ApplyImageSeriesReaderWorkaround(vtkMRMLVolumeArchetypeStorageNode * storag
 //----------------------------------------------------------------------------
 int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
 {
+  this->DetachedFileNameList.clear();
+
   std::string fullName = this->GetFullNameFromFileName();
   vtkDebugMacro("ReadData: got full archetype name " << fullName);
 
@@ -420,25 +427,15 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
     {
     vtkDebugMacro("Number of file names = " << reader->GetNumberOfFileNames()
                   << ", number of slice location = " << reader->GetNumberOfSliceLocation());
-    if (this->FileNameList.size() == 0)
+    if (this->ReadingDetachedData)
       {
-      // It is safe to assume that the file names in reader are unique.
-      // Here we shortcut the n*log(n) unique insertion of  AddFileName().
-      this->FileNameList = reader->GetFileNames();
+      // The file list of the storage node in the scene is updated by
+      // AttachDetachedData().
+      this->DetachedFileNameList = reader->GetFileNames();
       }
     else
       {
-      // include the archtype, file 0, in the storage node's file list
-      for (unsigned int n = 0; n < reader->GetNumberOfFileNames(); n++)
-        {
-        const char *thisFileName = reader->GetFileName(n);
-#ifndef NDEBUG
-        int currentSize =
-#endif
-          this->AddFileName(thisFileName);
-        vtkDebugMacro("After adding file " << n << ", filename = " << thisFileName
-                      << " to this storage node's list, current size of the list = " << currentSize);
-        }
+      this->AddFileNames(reader->GetFileNames());
       }
     }
 
@@ -459,10 +456,21 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   volNode->SetAndObserveImageData(iciOutputCopy.GetPointer());
 
   // Log volume size to the application log. It helps to identify potential out-of-memory issues.
-  vtkInfoMacro(<<"Loaded volume from file: "<<fullName \
+  std::stringstream volumeInfo;
+  volumeInfo << "Loaded volume from file: "<<fullName \
     <<". Dimensions: "<<iciOutputCopy->GetDimensions()[0]<<"x"<<iciOutputCopy->GetDimensions()[1]<<"x"<<iciOutputCopy->GetDimensions()[2] \
     <<". Number of components: "<<iciOutputCopy->GetNumberOfScalarComponents() \
-    <<". Pixel type: "<<vtkImageScalarTypeNameMacro(iciOutputCopy->GetScalarType())<<".");
+    <<". Pixel type: "<<vtkImageScalarTypeNameMacro(iciOutputCopy->GetScalarType())<<".";
+  if (this->ReadingDetachedData)
+    {
+    // The output window is not thread-safe, ReadData() displays the
+    // message from the main thread.
+    this->InvokeEvent(vtkCommand::MessageEvent, const_cast<char*>(volumeInfo.str().c_str()));
+    }
+  else
+    {
+    vtkInfoMacro(<< volumeInfo.str());
+    }
 
   vtkMatrix4x4* mat = reader->GetRasToIjkMatrix();
   if ( mat == NULL )
@@ -480,6 +488,85 @@ int vtkMRMLVolumeArchetypeStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
   return 1;
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLVolumeArchetypeStorageNode::SupportsReadDataDetached(vtkMRMLNode* vtkNotUsed(refNode))
+{
+  // ITK registers the image IO factories when the first image IO is
+  // requested, which is not thread-safe. Called from the main thread,
+  // before the files are read concurrently.
+  static bool imageIOFactoriesRegistered = false;
+  if (!imageIOFactoriesRegistered)
+    {
+    itk::ObjectFactoryBase::CreateAllInstance("itkImageIOBase");
+    imageIOFactoriesRegistered = true;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLVolumeArchetypeStorageNode::AttachDetachedData(vtkMRMLStorageNode* detachedStorageNode,
+                                                          vtkMRMLNode* detachedNode, vtkMRMLNode* refNode)
+{
+  vtkMRMLScalarVolumeNode* detachedVolumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(detachedNode);
+  vtkMRMLScalarVolumeNode* volNode = vtkMRMLScalarVolumeNode::SafeDownCast(refNode);
+  if (!detachedVolumeNode || !volNode)
+    {
+    vtkErrorMacro("AttachDetachedData: Reference node is expected to be a vtkMRMLScalarVolumeNode");
+    return 0;
+    }
+
+  int wasModifying = volNode->StartModify();
+  volNode->SetMetaDataDictionary(detachedVolumeNode->GetMetaDataDictionary());
+  volNode->SetAndObserveImageData(detachedVolumeNode->GetImageData());
+  volNode->CopyOrientation(detachedVolumeNode);
+  vtkMRMLDiffusionTensorVolumeNode* dtvn = vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(volNode);
+  if (dtvn)
+    {
+    vtkNew<vtkMatrix4x4> measurementFrame;
+    vtkMRMLDiffusionTensorVolumeNode::SafeDownCast(detachedVolumeNode)->GetMeasurementFrameMatrix(
+      measurementFrame.GetPointer());
+    dtvn->SetMeasurementFrameMatrix(measurementFrame.GetPointer());
+    }
+  volNode->EndModify(wasModifying);
+
+  vtkMRMLVolumeArchetypeStorageNode* detachedArchetypeStorageNode =
+    vtkMRMLVolumeArchetypeStorageNode::SafeDownCast(detachedStorageNode);
+  if (detachedArchetypeStorageNode)
+    {
+    this->AddFileNames(detachedArchetypeStorageNode->DetachedFileNameList);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeArchetypeStorageNode::AddFileNames(const std::vector<std::string>& fileNames)
+{
+  if (fileNames.size() <= 1)
+    {
+    return;
+    }
+  if (this->FileNameList.size() == 0)
+    {
+    // It is safe to assume that the file names in reader are unique.
+    // Here we shortcut the n*log(n) unique insertion of  AddFileName().
+    this->FileNameList = fileNames;
+    }
+  else
+    {
+    // include the archtype, file 0, in the storage node's file list
+    for (unsigned int n = 0; n < fileNames.size(); n++)
+      {
+      const char *thisFileName = fileNames[n].c_str();
+#ifndef NDEBUG
+      int currentSize =
+#endif
+        this->AddFileName(thisFileName);
+      vtkDebugMacro("After adding file " << n << ", filename = " << thisFileName
+                    << " to this storage node's list, current size of the list = " << currentSize);
+      }
+    }
+}
+
 //----------------------------------------------------------------------------
 int vtkMRMLVolumeArchetypeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
 {
@@ -580,6 +667,7 @@ int vtkMRMLVolumeArchetypeStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
 
     writer->SetInputConnection( volNode->GetImageDataConnection() );
     writer->SetUseCompression(this->GetUseCompression());
+    writer->SetCompressionLevel(this->GetCompressionLevel());
     if(this->WriteFileFormat)
       {
       writer->SetImageIOClassName(
@@ -706,6 +794,7 @@ std::string vtkMRMLVolumeArchetypeStorageNode::UpdateFileList(vtkMRMLNode *refNo
   writer->SetFileName(tempName.c_str());
   writer->SetInputData( volNode->GetImageData() );
   writer->SetUseCompression(this->GetUseCompression());
+  writer->SetCompressionLevel(this->GetCompressionLevel());
   if(this->WriteFileFormat)
     {
     if (this->GetScene() &&
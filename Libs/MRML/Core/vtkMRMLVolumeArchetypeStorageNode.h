@@ -104,6 +104,17 @@ protected:
   /// Read data and set it in the referenced node
   virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
+  /// Volume files are read without accessing the scene
+  virtual bool SupportsReadDataDetached(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Move the image data and geometry read in the detached node
+  /// into the referenced node
+  virtual int AttachDetachedData(vtkMRMLStorageNode* detachedStorageNode,
+                                 vtkMRMLNode* detachedNode, vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Add the file names of a multi-file volume to the file list
+  void AddFileNames(const std::vector<std::string>& fileNames);
+
   /// Write data from a referenced node
   virtual int WriteDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
 
@@ -111,6 +122,10 @@ protected:
   int SingleFile;
   int UseOrientationFromFile;
 
+  /// File names found by ReadDataInternal() in a detached read,
+  /// added to the file list by AttachDetachedData()
+  std::vector<std::string> DetachedFileNameList;
+
 };
 
 #endif
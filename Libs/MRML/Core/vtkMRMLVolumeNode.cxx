@@ -201,6 +201,15 @@ void vtkMRMLVolumeNode::Copy(vtkMRMLNode *anode)
   this->EndModify(disabledModify);
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLVolumeNode::GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects)
+{
+  if (this->GetImageData())
+    {
+    dataObjects.push_back(this->GetImageData());
+    }
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLVolumeNode::CopyOrientation(vtkMRMLVolumeNode *node)
 {
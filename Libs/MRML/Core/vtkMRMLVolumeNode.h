@@ -61,6 +61,9 @@ public:
   /// Copy the node's attributes to this object
   void CopyOrientation(vtkMRMLVolumeNode *node);
 
+  /// Add the image data to \a dataObjects.
+  virtual void GetBulkDataObjects(std::vector<vtkDataObject*>& dataObjects) VTK_OVERRIDE;
+
 
   ///
   /// Get node XML tag name (like Volume, Model)
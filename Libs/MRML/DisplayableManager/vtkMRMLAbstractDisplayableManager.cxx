@@ -27,6 +27,7 @@
 #include <vtkMRMLApplicationLogic.h>
 
 // MRML includes
+#include <vtkEventBroker.h>
 #include <vtkMRMLInteractionNode.h>
 #include <vtkMRMLScene.h>
 #include <vtkMRMLSelectionNode.h>
@@ -851,6 +852,8 @@ void vtkMRMLAbstractDisplayableManager::RequestRender()
 
   if (this->Internal->UpdateFromMRMLRequested)
     {
+    vtkEventBrokerTraceScope trace(this->GetClassName(), "displayable manager",
+                                   "{\"method\":\"UpdateFromMRML\"}");
     this->UpdateFromMRML();
     }
 
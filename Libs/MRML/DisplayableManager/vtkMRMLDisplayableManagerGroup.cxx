@@ -29,6 +29,7 @@
 #endif
 
 // MRML includes
+#include <vtkEventBroker.h>
 #include <vtkMRMLNode.h>
 
 // VTK includes
@@ -68,6 +69,10 @@ public:
       NameToDisplayableManagerMapIt;
 
   vtkSmartPointer<vtkCallbackCommand>   CallBackCommand;
+  // Traces the renders when vtkEventBroker is tracing
+  vtkSmartPointer<vtkCallbackCommand>   RenderCallBackCommand;
+  // True if the beginning of the current render was traced
+  bool                                  RenderTraced;
   vtkMRMLDisplayableManagerFactory*     DisplayableManagerFactory;
   vtkMRMLNode*                          MRMLDisplayableNode;
   vtkRenderer*                          Renderer;
@@ -83,6 +88,8 @@ vtkMRMLDisplayableManagerGroup::vtkInternal::vtkInternal()
   this->MRMLDisplayableNode = 0;
   this->Renderer = 0;
   this->CallBackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RenderCallBackCommand = vtkSmartPointer<vtkCallbackCommand>::New();
+  this->RenderTraced = false;
   this->DisplayableManagerFactory = 0;
   this->LightBoxRendererManagerProxy = 0;
 }
@@ -96,6 +103,8 @@ vtkMRMLDisplayableManagerGroup::vtkMRMLDisplayableManagerGroup()
   this->Internal = new vtkInternal;
   this->Internal->CallBackCommand->SetCallback(Self::DoCallback);
   this->Internal->CallBackCommand->SetClientData(this);
+  this->Internal->RenderCallBackCommand->SetCallback(Self::DoRenderCallback);
+  this->Internal->RenderCallBackCommand->SetClientData(this);
 }
 
 //----------------------------------------------------------------------------
@@ -111,6 +120,7 @@ vtkMRMLDisplayableManagerGroup::~vtkMRMLDisplayableManagerGroup()
 
   if (this->Internal->Renderer)
     {
+    this->Internal->Renderer->RemoveObserver(this->Internal->RenderCallBackCommand);
     this->Internal->Renderer->UnRegister(this);
     }
 
@@ -315,6 +325,7 @@ void vtkMRMLDisplayableManagerGroup::SetRenderer(vtkRenderer* newRenderer)
 
   if (this->Internal->Renderer)
     {
+    this->Internal->Renderer->RemoveObserver(this->Internal->RenderCallBackCommand);
     this->Internal->Renderer->Delete();
     }
 
@@ -323,6 +334,8 @@ void vtkMRMLDisplayableManagerGroup::SetRenderer(vtkRenderer* newRenderer)
   if (this->Internal->Renderer)
     {
     this->Internal->Renderer->Register(this);
+    this->Internal->Renderer->AddObserver(vtkCommand::StartEvent, this->Internal->RenderCallBackCommand);
+    this->Internal->Renderer->AddObserver(vtkCommand::EndEvent, this->Internal->RenderCallBackCommand);
     }
 
   vtkDebugMacro(<< this->GetClassName() << " (" << this << "): "
@@ -433,6 +446,34 @@ void vtkMRMLDisplayableManagerGroup::DoCallback(vtkObject* vtk_obj, unsigned lon
     }
 }
 
+//-----------------------------------------------------------------------------
+void vtkMRMLDisplayableManagerGroup::DoRenderCallback(vtkObject* vtkNotUsed(vtk_obj), unsigned long event,
+                                                      void* client_data, void* vtkNotUsed(call_data))
+{
+  vtkMRMLDisplayableManagerGroup* self =
+      reinterpret_cast<vtkMRMLDisplayableManagerGroup*>(client_data);
+  vtkEventBroker* broker = vtkEventBroker::GetInstance();
+  if (event == vtkCommand::EndEvent)
+    {
+    // the render may have started before tracing started
+    if (self->Internal->RenderTraced)
+      {
+      broker->TraceEnd();
+      }
+    self->Internal->RenderTraced = false;
+    return;
+    }
+  self->Internal->RenderTraced = broker->GetTracing();
+  if (!self->Internal->RenderTraced)
+    {
+    return;
+    }
+  vtkMRMLNode* viewNode = self->GetMRMLDisplayableNode();
+  std::string args = std::string("{\"view\":\"") +
+    (viewNode && viewNode->GetID() ? viewNode->GetID() : "") + "\"}";
+  broker->TraceBegin("Render", "render", args.c_str());
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLDisplayableManagerGroup::onDisplayableManagerFactoryRegisteredEvent(
     const char* displayableManagerName)
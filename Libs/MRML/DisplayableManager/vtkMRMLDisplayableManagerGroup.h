@@ -125,6 +125,9 @@ protected:
   typedef vtkMRMLDisplayableManagerGroup Self;
   static void DoCallback(vtkObject* vtk_obj, unsigned long event,
                          void* client_data, void* call_data);
+  /// Record the renders of the renderer when vtkEventBroker is tracing
+  static void DoRenderCallback(vtkObject* vtk_obj, unsigned long event,
+                               void* client_data, void* call_data);
   /// Trigger upon a DisplayableManager is either registered or unregistered from
   /// the associated factory
   void onDisplayableManagerFactoryRegisteredEvent(const char* displayableManagerName);
@@ -0,0 +1,177 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include "vtkImageLabelStatistics.h"
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckValue(const char* name, double value, double expected)
+{
+  if (fabs(value - expected) > 1e-6)
+    {
+    std::cerr << name << ": expected " << expected << ", got " << value << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatisticsTest1(int , char * [] )
+{
+  // 10x4x3 volumes: label = i / 4 (0, 1 or 2), scalar = i + 10 * j
+  vtkNew<vtkImageData> labelImage;
+  labelImage->SetDimensions(10, 4, 3);
+  labelImage->SetSpacing(0.5, 1., 2.);
+  labelImage->AllocateScalars(VTK_SHORT, 1);
+  vtkNew<vtkImageData> scalarImage;
+  scalarImage->SetDimensions(10, 4, 3);
+  scalarImage->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < 3; ++k)
+    {
+    for (int j = 0; j < 4; ++j)
+      {
+      for (int i = 0; i < 10; ++i)
+        {
+        labelImage->SetScalarComponentFromDouble(i, j, k, 0, i / 4);
+        scalarImage->SetScalarComponentFromDouble(i, j, k, 0, i + 10 * j);
+        }
+      }
+    }
+
+  vtkNew<vtkImageLabelStatistics> statistics;
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_BOOL(statistics->Compute(), false);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+  // Counts only
+  statistics->SetLabelImage(labelImage.GetPointer());
+  statistics->SetNumberOfThreads(3);
+  CHECK_BOOL(statistics->Compute(), true);
+  CHECK_INT(statistics->GetNumberOfLabels(), 3);
+  CHECK_INT(statistics->GetNthLabel(2), 2);
+  CHECK_BOOL(statistics->HasLabel(3), false);
+  CHECK_INT(statistics->GetVoxelCount(0), 4 * 4 * 3);
+  CHECK_INT(statistics->GetVoxelCount(2), 2 * 4 * 3);
+  CHECK_INT(statistics->GetVoxelCount(3), 0);
+  CHECK_BOOL(CheckValue("Volume", statistics->GetVolume(1), 4 * 4 * 3), true);
+
+  // Scalar statistics
+  statistics->SetScalarImage(scalarImage.GetPointer());
+  CHECK_BOOL(statistics->Compute(), true);
+  CHECK_INT(statistics->GetVoxelCount(1), 4 * 4 * 3);
+  // label 1: i in [4, 7], j in [0, 3]
+  CHECK_BOOL(CheckValue("Minimum", statistics->GetMinimum(1), 4.), true);
+  CHECK_BOOL(CheckValue("Maximum", statistics->GetMaximum(1), 37.), true);
+  CHECK_BOOL(CheckValue("Mean", statistics->GetMean(1), 20.5), true);
+  // values 4..7, 14..17, 24..27, 34..37, 3 times each: sample variance
+  CHECK_BOOL(CheckValue("StandardDeviation", statistics->GetStandardDeviation(1),
+                        sqrt(126.25 * 48. / 47.)), true);
+  CHECK_BOOL(CheckValue("Median", statistics->GetMedian(1), 17.), true);
+  // label 2: i in [8, 9]
+  CHECK_BOOL(CheckValue("Minimum", statistics->GetMinimum(2), 8.), true);
+  CHECK_BOOL(CheckValue("Mean", statistics->GetMean(2), 23.5), true);
+
+  // Same results with a single thread and with a custom voxel volume
+  statistics->SetNumberOfThreads(1);
+  statistics->SetVoxelVolume(2.);
+  CHECK_BOOL(statistics->Compute(), true);
+  CHECK_BOOL(CheckValue("Mean", statistics->GetMean(1), 20.5), true);
+  CHECK_BOOL(CheckValue("Median", statistics->GetMedian(1), 17.), true);
+  CHECK_BOOL(CheckValue("Volume", statistics->GetVolume(1), 2. * 4 * 4 * 3), true);
+
+  // Statistics are computed on the intersection of the extents
+  scalarImage->SetExtent(0, 9, 0, 0, 0, 2);
+  scalarImage->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < 3; ++k)
+    {
+    for (int i = 0; i < 10; ++i)
+      {
+      scalarImage->SetScalarComponentFromDouble(i, 0, k, 0, i);
+      }
+    }
+  CHECK_BOOL(statistics->Compute(), true);
+  CHECK_INT(statistics->GetVoxelCount(1), 4 * 3);
+  CHECK_BOOL(CheckValue("Mean", statistics->GetMean(1), 5.5), true);
+
+  // Sparse label values: the memory only depends on the labels present,
+  // the pieces of the median pass share labels and fill the same histograms
+  vtkNew<vtkImageData> sparseLabelImage;
+  sparseLabelImage->SetDimensions(10, 4, 3);
+  sparseLabelImage->AllocateScalars(VTK_INT, 1);
+  for (int k = 0; k < 3; ++k)
+    {
+    for (int j = 0; j < 4; ++j)
+      {
+      for (int i = 0; i < 10; ++i)
+        {
+        sparseLabelImage->SetScalarComponentFromDouble(i, j, k, 0, i < 5 ? -5 : 50000000);
+        }
+      }
+    }
+  scalarImage->SetExtent(0, 9, 0, 3, 0, 2);
+  scalarImage->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < 3; ++k)
+    {
+    for (int j = 0; j < 4; ++j)
+      {
+      for (int i = 0; i < 10; ++i)
+        {
+        scalarImage->SetScalarComponentFromDouble(i, j, k, 0, i + 10 * k);
+        }
+      }
+    }
+  statistics->SetLabelImage(sparseLabelImage.GetPointer());
+  statistics->SetNumberOfThreads(4);
+  CHECK_BOOL(statistics->Compute(), true);
+  CHECK_INT(statistics->GetNumberOfLabels(), 2);
+  CHECK_INT(statistics->GetNthLabel(0), -5);
+  CHECK_INT(statistics->GetNthLabel(1), 50000000);
+  CHECK_INT(statistics->GetVoxelCount(50000000), 5 * 4 * 3);
+  // label 50000000: i in [5, 9], k in [0, 2]
+  CHECK_BOOL(CheckValue("Minimum", statistics->GetMinimum(50000000), 5.), true);
+  CHECK_BOOL(CheckValue("Maximum", statistics->GetMaximum(50000000), 29.), true);
+  CHECK_BOOL(CheckValue("Median", statistics->GetMedian(50000000), 17.), true);
+  CHECK_BOOL(CheckValue("Median", statistics->GetMedian(-5), 12.), true);
+
+  // All the pieces are computed when the multithreader runs fewer threads
+  // than pieces
+  int globalMaximumNumberOfThreads = vtkMultiThreader::GetGlobalMaximumNumberOfThreads();
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(1);
+  CHECK_BOOL(statistics->Compute(), true);
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(globalMaximumNumberOfThreads);
+  CHECK_INT(statistics->GetVoxelCount(50000000), 5 * 4 * 3);
+  CHECK_INT(statistics->GetVoxelCount(-5), 5 * 4 * 3);
+  CHECK_BOOL(CheckValue("Maximum", statistics->GetMaximum(50000000), 29.), true);
+  CHECK_BOOL(CheckValue("Median", statistics->GetMedian(50000000), 17.), true);
+
+  return EXIT_SUCCESS;
+}
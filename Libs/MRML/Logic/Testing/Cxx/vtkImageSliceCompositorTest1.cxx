@@ -0,0 +1,299 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLLogic includes
+#include "vtkImageSliceCompositor.h"
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+
+// VTK includes
+#include <vtkImageBlend.h>
+#include <vtkImageData.h>
+#include <vtkImageMapToColors.h>
+#include <vtkImageMapToWindowLevelColors.h>
+#include <vtkImageReslice.h>
+#include <vtkLookupTable.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+#include <vtkTrivialProducer.h>
+
+// STD includes
+#include <cstdlib>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckPixel(vtkImageData* image, int x, int y, int r, int g, int b, int a)
+{
+  unsigned char* pixel = static_cast<unsigned char*>(image->GetScalarPointer(x, y, 0));
+  int expected[4] = {r, g, b, a};
+  for (int c = 0; c < 4; ++c)
+    {
+    if (abs(pixel[c] - expected[c]) > 1)
+      {
+      std::cerr << "Pixel (" << x << ", " << y << ") component " << c
+                << ": expected " << expected[c] << ", got " << static_cast<int>(pixel[c])
+                << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkAlgorithm> ResliceLayer(vtkAlgorithmOutput* input,
+                                           vtkMatrix4x4* xyToIJK, bool interpolate)
+{
+  vtkNew<vtkTransform> transform;
+  transform->SetMatrix(xyToIJK);
+  vtkSmartPointer<vtkImageReslice> reslice = vtkSmartPointer<vtkImageReslice>::New();
+  reslice->SetInputConnection(input);
+  reslice->SetResliceTransform(transform.GetPointer());
+  reslice->SetBackgroundColor(0, 0, 0, 0);
+  reslice->AutoCropOutputOff();
+  reslice->SetOutputOrigin(0, 0, 0);
+  reslice->SetOutputSpacing(1, 1, 1);
+  reslice->SetOutputDimensionality(3);
+  reslice->SetOutputExtent(0, 15, 0, 15, 0, 0);
+  if (interpolate)
+    {
+    reslice->SetInterpolationModeToLinear();
+    }
+  else
+    {
+    reslice->SetInterpolationModeToNearestNeighbor();
+    }
+  return reslice;
+}
+
+//----------------------------------------------------------------------------
+/// Compare the compositor with the reslice, window/level, lookup table and
+/// blend pipeline it replaces. Only the colors of the pixels inside the
+/// volume are compared, vtkImageBlend does not compute the same alpha.
+bool CompareWithPipeline(bool interpolate)
+{
+  vtkNew<vtkImageData> volume;
+  volume->SetDimensions(16, 16, 1);
+  volume->AllocateScalars(VTK_SHORT, 1);
+  vtkNew<vtkImageData> labelMap;
+  labelMap->SetDimensions(16, 16, 1);
+  labelMap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  for (int j = 0; j < 16; ++j)
+    {
+    for (int i = 0; i < 16; ++i)
+      {
+      volume->SetScalarComponentFromDouble(i, j, 0, 0, (37 * i + 61 * j) % 500 - 100);
+      labelMap->SetScalarComponentFromDouble(i, j, 0, 0, (i + j) % 3);
+      }
+    }
+  vtkNew<vtkTrivialProducer> volumeProducer;
+  volumeProducer->SetOutput(volume.GetPointer());
+  vtkNew<vtkTrivialProducer> labelMapProducer;
+  labelMapProducer->SetOutput(labelMap.GetPointer());
+
+  vtkNew<vtkLookupTable> grey;
+  grey->SetNumberOfTableValues(256);
+  for (int i = 0; i < 256; ++i)
+    {
+    grey->SetTableValue(i, i / 255., (255 - i) / 255., 0.5, 1.);
+    }
+  grey->SetTableRange(0, 255);
+
+  vtkNew<vtkLookupTable> labels;
+  labels->SetNumberOfTableValues(3);
+  labels->SetTableValue(0, 0., 0., 0., 0.);
+  labels->SetTableValue(1, 1., 0., 0., 1.);
+  labels->SetTableValue(2, 0.2, 0.8, 0.4, 0.6);
+  labels->SetTableRange(0, 2);
+
+  vtkNew<vtkMatrix4x4> xyToIJK;
+  xyToIJK->SetElement(0, 0, 0.75);
+  xyToIJK->SetElement(0, 3, 0.3);
+  xyToIJK->SetElement(1, 1, 0.8);
+  xyToIJK->SetElement(1, 3, 0.6);
+
+  const double window = 300.;
+  const double level = 120.;
+  const double labelOpacity = 0.6;
+
+  // Pipeline of vtkMRMLSliceLogic
+  vtkSmartPointer<vtkAlgorithm> volumeReslice =
+    ResliceLayer(volumeProducer->GetOutputPort(), xyToIJK.GetPointer(), interpolate);
+  vtkNew<vtkImageMapToWindowLevelColors> windowLevel;
+  windowLevel->SetInputConnection(volumeReslice->GetOutputPort());
+  windowLevel->SetOutputFormatToLuminance();
+  windowLevel->SetWindow(window);
+  windowLevel->SetLevel(level);
+  vtkNew<vtkImageMapToColors> volumeColors;
+  volumeColors->SetInputConnection(windowLevel->GetOutputPort());
+  volumeColors->SetOutputFormatToRGBA();
+  volumeColors->SetLookupTable(grey.GetPointer());
+
+  vtkSmartPointer<vtkAlgorithm> labelReslice =
+    ResliceLayer(labelMapProducer->GetOutputPort(), xyToIJK.GetPointer(), false);
+  vtkNew<vtkImageMapToColors> labelColors;
+  labelColors->SetInputConnection(labelReslice->GetOutputPort());
+  labelColors->SetOutputFormatToRGBA();
+  labelColors->SetLookupTable(labels.GetPointer());
+
+  vtkNew<vtkImageBlend> blend;
+  blend->AddInputConnection(volumeColors->GetOutputPort());
+  blend->AddInputConnection(labelColors->GetOutputPort());
+  blend->SetOpacity(1, labelOpacity);
+  blend->Update();
+
+  // Single pass
+  vtkNew<vtkImageSliceCompositor> compositor;
+  compositor->SetOutputExtent(0, 15, 0, 15, 0, 0);
+  compositor->SetNumberOfLayers(2);
+  compositor->SetLayerInputConnection(0, volumeProducer->GetOutputPort());
+  compositor->SetLayerResliceMatrix(0, xyToIJK.GetPointer());
+  compositor->SetLayerInterpolate(0, interpolate);
+  compositor->SetLayerLookupTable(0, grey.GetPointer());
+  compositor->SetLayerWindowLevel(0, window, level);
+  compositor->SetLayerInputConnection(1, labelMapProducer->GetOutputPort());
+  compositor->SetLayerResliceMatrix(1, xyToIJK.GetPointer());
+  compositor->SetLayerLookupTable(1, labels.GetPointer());
+  compositor->SetLayerLabelMap(1, true);
+  compositor->SetLayerOpacity(1, labelOpacity);
+  compositor->Update();
+
+  vtkImageData* expected = blend->GetOutput();
+  vtkImageData* output = compositor->GetOutput();
+  const int tolerance = 2;
+  for (int y = 0; y < 16; ++y)
+    {
+    for (int x = 0; x < 16; ++x)
+      {
+      unsigned char* expectedPixel = static_cast<unsigned char*>(expected->GetScalarPointer(x, y, 0));
+      unsigned char* pixel = static_cast<unsigned char*>(output->GetScalarPointer(x, y, 0));
+      if (pixel[3] == 0)
+        {
+        // outside of the volume
+        continue;
+        }
+      for (int c = 0; c < 3; ++c)
+        {
+        if (abs(pixel[c] - expectedPixel[c]) > tolerance)
+          {
+          std::cerr << "Interpolate " << interpolate << ", pixel (" << x << ", " << y
+                    << ") component " << c << ": expected " << static_cast<int>(expectedPixel[c])
+                    << ", got " << static_cast<int>(pixel[c]) << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositorTest1(int , char * [] )
+{
+  // 4x4 volume: value = 20 * i
+  vtkNew<vtkImageData> volume;
+  volume->SetDimensions(4, 4, 1);
+  volume->AllocateScalars(VTK_SHORT, 1);
+  vtkNew<vtkImageData> labelMap;
+  labelMap->SetDimensions(4, 4, 1);
+  labelMap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  for (int j = 0; j < 4; ++j)
+    {
+    for (int i = 0; i < 4; ++i)
+      {
+      volume->SetScalarComponentFromDouble(i, j, 0, 0, 20 * i);
+      labelMap->SetScalarComponentFromDouble(i, j, 0, 0, (i == 1 && j == 1) ? 1 : 0);
+      }
+    }
+  vtkNew<vtkTrivialProducer> volumeProducer;
+  volumeProducer->SetOutput(volume.GetPointer());
+  vtkNew<vtkTrivialProducer> labelMapProducer;
+  labelMapProducer->SetOutput(labelMap.GetPointer());
+
+  vtkNew<vtkLookupTable> grey;
+  grey->SetNumberOfTableValues(256);
+  for (int i = 0; i < 256; ++i)
+    {
+    grey->SetTableValue(i, i / 255., i / 255., i / 255., 1.);
+    }
+  grey->SetTableRange(0, 255);
+
+  vtkNew<vtkLookupTable> labels;
+  labels->SetNumberOfTableValues(2);
+  labels->SetTableValue(0, 0., 0., 0., 0.);
+  labels->SetTableValue(1, 1., 0., 0., 1.);
+  labels->SetTableRange(0, 255);
+
+  vtkNew<vtkImageSliceCompositor> compositor;
+  compositor->SetOutputExtent(0, 5, 0, 3, 0, 0);
+  compositor->SetNumberOfLayers(2);
+  CHECK_INT(compositor->GetNumberOfLayers(), 2);
+
+  compositor->SetLayerInputConnection(0, volumeProducer->GetOutputPort());
+  compositor->SetLayerLookupTable(0, grey.GetPointer());
+  compositor->SetLayerWindowLevel(0, 60., 30.);
+
+  compositor->SetLayerInputConnection(1, labelMapProducer->GetOutputPort());
+  compositor->SetLayerLookupTable(1, labels.GetPointer());
+  compositor->SetLayerLabelMap(1, true);
+  compositor->SetLayerOpacity(1, 0.5);
+
+  compositor->Update();
+  vtkImageData* output = compositor->GetOutput();
+  CHECK_INT(output->GetNumberOfScalarComponents(), 4);
+  CHECK_INT(output->GetScalarType(), VTK_UNSIGNED_CHAR);
+  CHECK_INT(output->GetDimensions()[0], 6);
+
+  // window/level: [0, 60] -> [0, 255]
+  CHECK_BOOL(CheckPixel(output, 0, 0, 0, 0, 0, 255), true);
+  CHECK_BOOL(CheckPixel(output, 2, 0, 170, 170, 170, 255), true);
+  CHECK_BOOL(CheckPixel(output, 3, 0, 255, 255, 255, 255), true);
+  // label blended with 50% opacity
+  CHECK_BOOL(CheckPixel(output, 1, 1, 170, 43, 43, 255), true);
+  // outside of the volume
+  CHECK_BOOL(CheckPixel(output, 5, 0, 0, 0, 0, 0), true);
+
+  // Threshold makes the voxels transparent
+  compositor->SetLayerThreshold(0, true, 15., 100.);
+  compositor->Update();
+  CHECK_BOOL(CheckPixel(output, 0, 0, 0, 0, 0, 0), true);
+  CHECK_BOOL(CheckPixel(output, 2, 0, 170, 170, 170, 255), true);
+  compositor->SetLayerThreshold(0, false, 15., 100.);
+
+  // Reslice: shift by one voxel along I
+  vtkNew<vtkMatrix4x4> xyToIJK;
+  xyToIJK->SetElement(0, 3, 1.);
+  compositor->SetLayerResliceMatrix(0, xyToIJK.GetPointer());
+  compositor->Update();
+  CHECK_BOOL(CheckPixel(output, 0, 0, 85, 85, 85, 255), true);
+
+  // Linear interpolation at half voxel
+  xyToIJK->SetElement(0, 3, 0.5);
+  compositor->SetLayerResliceMatrix(0, xyToIJK.GetPointer());
+  compositor->SetLayerInterpolate(0, true);
+  compositor->Update();
+  CHECK_BOOL(CheckPixel(output, 0, 0, 42, 42, 42, 255), true);
+
+  CHECK_BOOL(CompareWithPipeline(false), true);
+  CHECK_BOOL(CompareWithPipeline(true), true);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,560 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#include "vtkImageLabelStatistics.h"
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+//----------------------------------------------------------------------------
+class vtkImageLabelStatistics::vtkInternal
+{
+public:
+  struct LabelStatistics
+    {
+    LabelStatistics()
+      : VoxelCount(0), Minimum(0.), Maximum(0.), Mean(0.), StandardDeviation(0.), Median(0.)
+      {}
+    vtkIdType VoxelCount;
+    double Minimum;
+    double Maximum;
+    double Mean;
+    double StandardDeviation;
+    double Median;
+    };
+
+  std::vector<int> Labels;
+  std::map<int, LabelStatistics> Statistics;
+  double VoxelVolume;
+
+  const LabelStatistics* GetLabelStatistics(int label)
+    {
+    std::map<int, LabelStatistics>::const_iterator it = this->Statistics.find(label);
+    return it != this->Statistics.end() ? &it->second : NULL;
+    }
+};
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+struct LabelAccumulator
+{
+  LabelAccumulator()
+    : VoxelCount(0), Sum(0.), SumOfSquares(0.), Minimum(0.), Maximum(0.)
+    {}
+  vtkIdType VoxelCount;
+  double Sum;
+  double SumOfSquares;
+  double Minimum;
+  double Maximum;
+};
+
+//----------------------------------------------------------------------------
+/// Histogram of a label, shared by all the threads
+struct LabelHistogram
+{
+  LabelHistogram()
+    : Origin(0.), Spacing(1.), NumberOfBins(1)
+    {}
+  double Origin;
+  double Spacing;
+  int NumberOfBins;
+  std::vector<vtkIdType> Bins;
+  /// Locks Bins while a piece adds its pending bins
+  vtkSmartPointer<vtkMutexLock> Lock;
+};
+
+typedef std::map<int, LabelAccumulator> LabelAccumulatorMap;
+typedef std::map<int, std::vector<int> > LabelPendingBinsMap;
+
+/// Number of bin indices a piece collects for a label before adding them
+/// to the shared histogram of the label
+const size_t NUMBER_OF_PENDING_BINS = 1024;
+
+//----------------------------------------------------------------------------
+/// State shared by the threads. Each piece is a range of rows of the
+/// computed extent, in both passes. Accumulators are only allocated for
+/// the labels present in the rows of the piece. Histograms are allocated
+/// once per label, pieces add their bins under the lock of the label.
+struct StatisticsJob
+{
+  vtkImageData* LabelImage;
+  vtkImageData* ScalarImage;
+  int Extent[6];
+  int NumberOfPieces;
+
+  /// First pass: accumulators of each piece, indexed by label value
+  std::vector<LabelAccumulatorMap> Accumulators;
+
+  /// Second pass: histogram of each label, indexed by label value.
+  /// The map itself is not modified while the threads run.
+  bool FillHistograms;
+  std::map<int, LabelHistogram> Histograms;
+
+  vtkIdType GetNumberOfRows()
+    {
+    return static_cast<vtkIdType>(this->Extent[3] - this->Extent[2] + 1)
+      * (this->Extent[5] - this->Extent[4] + 1);
+    }
+
+  void GetRowRange(int piece, vtkIdType& firstRow, vtkIdType& lastRow)
+    {
+    vtkIdType numberOfRows = this->GetNumberOfRows();
+    firstRow = numberOfRows * piece / this->NumberOfPieces;
+    lastRow = numberOfRows * (piece + 1) / this->NumberOfPieces;
+    }
+};
+
+//----------------------------------------------------------------------------
+template <class TLabel, class TScalar>
+void AccumulateRows(StatisticsJob* job, int piece, TLabel*, TScalar*)
+{
+  LabelAccumulatorMap& accumulators = job->Accumulators[piece];
+  vtkIdType firstRow = 0;
+  vtkIdType lastRow = 0;
+  job->GetRowRange(piece, firstRow, lastRow);
+  int rowLength = job->Extent[1] - job->Extent[0] + 1;
+  int numberOfRowsPerSlice = job->Extent[3] - job->Extent[2] + 1;
+  // Neighbor voxels mostly have the same label, only look up the
+  // accumulator when the label changes.
+  int currentLabel = 0;
+  LabelAccumulator* accumulator = NULL;
+  for (vtkIdType row = firstRow; row < lastRow; ++row)
+    {
+    int y = job->Extent[2] + static_cast<int>(row % numberOfRowsPerSlice);
+    int z = job->Extent[4] + static_cast<int>(row / numberOfRowsPerSlice);
+    TLabel* labelPtr = static_cast<TLabel*>(job->LabelImage->GetScalarPointer(job->Extent[0], y, z));
+    TScalar* scalarPtr = job->ScalarImage ?
+      static_cast<TScalar*>(job->ScalarImage->GetScalarPointer(job->Extent[0], y, z)) : NULL;
+    for (int x = 0; x < rowLength; ++x)
+      {
+      int label = static_cast<int>(labelPtr[x]);
+      if (!accumulator || label != currentLabel)
+        {
+        accumulator = &accumulators[label];
+        currentLabel = label;
+        }
+      if (!scalarPtr)
+        {
+        ++accumulator->VoxelCount;
+        continue;
+        }
+      double value = static_cast<double>(scalarPtr[x]);
+      if (accumulator->VoxelCount == 0)
+        {
+        accumulator->Minimum = value;
+        accumulator->Maximum = value;
+        }
+      else if (value < accumulator->Minimum)
+        {
+        accumulator->Minimum = value;
+        }
+      else if (value > accumulator->Maximum)
+        {
+        accumulator->Maximum = value;
+        }
+      ++accumulator->VoxelCount;
+      accumulator->Sum += value;
+      accumulator->SumOfSquares += value * value;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void AddPendingBins(LabelHistogram& histogram, std::vector<int>& pendingBins)
+{
+  if (pendingBins.empty())
+    {
+    return;
+    }
+  histogram.Lock->Lock();
+  for (std::vector<int>::const_iterator binIt = pendingBins.begin(); binIt != pendingBins.end(); ++binIt)
+    {
+    ++histogram.Bins[*binIt];
+    }
+  histogram.Lock->Unlock();
+  pendingBins.clear();
+}
+
+//----------------------------------------------------------------------------
+template <class TLabel, class TScalar>
+void FillHistograms(StatisticsJob* job, int piece, TLabel*, TScalar*)
+{
+  // Bins are collected per label and added to the shared histograms in
+  // batches, so that the memory used by a piece does not depend on the
+  // number of bins.
+  LabelPendingBinsMap pieceBins;
+  vtkIdType firstRow = 0;
+  vtkIdType lastRow = 0;
+  job->GetRowRange(piece, firstRow, lastRow);
+  int rowLength = job->Extent[1] - job->Extent[0] + 1;
+  int numberOfRowsPerSlice = job->Extent[3] - job->Extent[2] + 1;
+  int currentLabel = 0;
+  LabelHistogram* histogram = NULL;
+  std::vector<int>* bins = NULL;
+  for (vtkIdType row = firstRow; row < lastRow; ++row)
+    {
+    int y = job->Extent[2] + static_cast<int>(row % numberOfRowsPerSlice);
+    int z = job->Extent[4] + static_cast<int>(row / numberOfRowsPerSlice);
+    TLabel* labelPtr = static_cast<TLabel*>(job->LabelImage->GetScalarPointer(job->Extent[0], y, z));
+    TScalar* scalarPtr = static_cast<TScalar*>(job->ScalarImage->GetScalarPointer(job->Extent[0], y, z));
+    for (int x = 0; x < rowLength; ++x)
+      {
+      int label = static_cast<int>(labelPtr[x]);
+      if (!histogram || label != currentLabel)
+        {
+        histogram = &job->Histograms.find(label)->second;
+        bins = &pieceBins[label];
+        if (bins->capacity() < NUMBER_OF_PENDING_BINS)
+          {
+          bins->reserve(NUMBER_OF_PENDING_BINS);
+          }
+        currentLabel = label;
+        }
+      int bin = static_cast<int>(floor((scalarPtr[x] - histogram->Origin) / histogram->Spacing + 0.5));
+      bins->push_back(std::max(0, std::min(bin, histogram->NumberOfBins - 1)));
+      if (bins->size() >= NUMBER_OF_PENDING_BINS)
+        {
+        AddPendingBins(*histogram, *bins);
+        }
+      }
+    }
+  for (LabelPendingBinsMap::iterator binsIt = pieceBins.begin(); binsIt != pieceBins.end(); ++binsIt)
+    {
+    AddPendingBins(job->Histograms.find(binsIt->first)->second, binsIt->second);
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class TLabel>
+void ExecutePiece(StatisticsJob* job, int piece, TLabel* labelType)
+{
+  if (!job->ScalarImage)
+    {
+    AccumulateRows(job, piece, labelType, static_cast<TLabel*>(NULL));
+    return;
+    }
+  switch (job->ScalarImage->GetScalarType())
+    {
+    vtkTemplateMacro(
+      if (job->FillHistograms)
+        {
+        FillHistograms(job, piece, labelType, static_cast<VTK_TT*>(NULL));
+        }
+      else
+        {
+        AccumulateRows(job, piece, labelType, static_cast<VTK_TT*>(NULL));
+        }
+      );
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ExecuteThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  StatisticsJob* job = static_cast<StatisticsJob*>(info->UserData);
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread processes every NumberOfThreads-th piece.
+  for (int piece = info->ThreadID; piece < job->NumberOfPieces; piece += info->NumberOfThreads)
+    {
+    switch (job->LabelImage->GetScalarType())
+      {
+      vtkTemplateMacro(ExecutePiece(job, piece, static_cast<VTK_TT*>(NULL)));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+double ComputeHistogramMedian(const LabelHistogram& histogram, vtkIdType voxelCount)
+{
+  double halfCount = 0.5 * voxelCount;
+  vtkIdType cumulatedCount = 0;
+  for (int bin = 0; bin < histogram.NumberOfBins; ++bin)
+    {
+    cumulatedCount += histogram.Bins[bin];
+    if (cumulatedCount >= halfCount)
+      {
+      return histogram.Origin + bin * histogram.Spacing;
+      }
+    }
+  return histogram.Origin + (histogram.NumberOfBins - 1) * histogram.Spacing;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageLabelStatistics);
+vtkCxxSetObjectMacro(vtkImageLabelStatistics, LabelImage, vtkImageData);
+vtkCxxSetObjectMacro(vtkImageLabelStatistics, ScalarImage, vtkImageData);
+
+//----------------------------------------------------------------------------
+vtkImageLabelStatistics::vtkImageLabelStatistics()
+{
+  this->LabelImage = NULL;
+  this->ScalarImage = NULL;
+  this->VoxelVolume = 0.;
+  this->ComputeMedian = true;
+  this->MaximumNumberOfBins = 65536;
+  this->NumberOfThreads = 0;
+  this->Internal = new vtkInternal;
+  this->Internal->VoxelVolume = 0.;
+}
+
+//----------------------------------------------------------------------------
+vtkImageLabelStatistics::~vtkImageLabelStatistics()
+{
+  this->SetLabelImage(NULL);
+  this->SetScalarImage(NULL);
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageLabelStatistics::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LabelImage: " << this->LabelImage << "\n";
+  os << indent << "ScalarImage: " << this->ScalarImage << "\n";
+  os << indent << "VoxelVolume: " << this->VoxelVolume << "\n";
+  os << indent << "ComputeMedian: " << this->ComputeMedian << "\n";
+  os << indent << "MaximumNumberOfBins: " << this->MaximumNumberOfBins << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "NumberOfLabels: " << this->Internal->Labels.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageLabelStatistics::Compute()
+{
+  this->Internal->Labels.clear();
+  this->Internal->Statistics.clear();
+
+  if (!this->LabelImage || !this->LabelImage->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("Compute: label image is not set");
+    return false;
+    }
+  if (this->LabelImage->GetNumberOfScalarComponents() != 1
+    || (this->ScalarImage && this->ScalarImage->GetNumberOfScalarComponents() != 1))
+    {
+    vtkErrorMacro("Compute: images must have a single scalar component");
+    return false;
+    }
+  if (this->ScalarImage && !this->ScalarImage->GetPointData()->GetScalars())
+    {
+    vtkErrorMacro("Compute: scalar image has no scalars");
+    return false;
+    }
+
+  double* spacing = this->LabelImage->GetSpacing();
+  this->Internal->VoxelVolume = this->VoxelVolume > 0. ?
+    this->VoxelVolume : spacing[0] * spacing[1] * spacing[2];
+
+  StatisticsJob job;
+  job.LabelImage = this->LabelImage;
+  job.ScalarImage = this->ScalarImage;
+  job.FillHistograms = false;
+  this->LabelImage->GetExtent(job.Extent);
+  if (this->ScalarImage)
+    {
+    int* scalarExtent = this->ScalarImage->GetExtent();
+    for (int i = 0; i < 3; ++i)
+      {
+      job.Extent[2 * i] = std::max(job.Extent[2 * i], scalarExtent[2 * i]);
+      job.Extent[2 * i + 1] = std::min(job.Extent[2 * i + 1], scalarExtent[2 * i + 1]);
+      }
+    }
+  if (job.Extent[0] > job.Extent[1] || job.Extent[2] > job.Extent[3] || job.Extent[4] > job.Extent[5])
+    {
+    // Nothing to compute
+    return true;
+    }
+
+  int numberOfThreads = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  numberOfThreads = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  job.NumberOfPieces = static_cast<int>(std::min(static_cast<vtkIdType>(numberOfThreads), job.GetNumberOfRows()));
+  job.Accumulators.resize(job.NumberOfPieces);
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(job.NumberOfPieces);
+  threader->SetSingleMethod(ExecuteThread, &job);
+  threader->SingleMethodExecute();
+
+  // Merge the accumulators of the pieces
+  LabelAccumulatorMap& accumulators = job.Accumulators[0];
+  for (int piece = 1; piece < job.NumberOfPieces; ++piece)
+    {
+    for (LabelAccumulatorMap::const_iterator pieceIt = job.Accumulators[piece].begin(); pieceIt != job.Accumulators[piece].end(); ++pieceIt)
+      {
+      const LabelAccumulator& pieceAccumulator = pieceIt->second;
+      LabelAccumulator& accumulator = accumulators[pieceIt->first];
+      if (accumulator.VoxelCount == 0)
+        {
+        accumulator = pieceAccumulator;
+        continue;
+        }
+      accumulator.VoxelCount += pieceAccumulator.VoxelCount;
+      accumulator.Sum += pieceAccumulator.Sum;
+      accumulator.SumOfSquares += pieceAccumulator.SumOfSquares;
+      accumulator.Minimum = std::min(accumulator.Minimum, pieceAccumulator.Minimum);
+      accumulator.Maximum = std::max(accumulator.Maximum, pieceAccumulator.Maximum);
+      }
+    job.Accumulators[piece].clear();
+    }
+
+  for (LabelAccumulatorMap::const_iterator accumulatorIt = accumulators.begin(); accumulatorIt != accumulators.end(); ++accumulatorIt)
+    {
+    const LabelAccumulator& accumulator = accumulatorIt->second;
+    int label = accumulatorIt->first;
+    vtkInternal::LabelStatistics& statistics = this->Internal->Statistics[label];
+    this->Internal->Labels.push_back(label);
+    statistics.VoxelCount = accumulator.VoxelCount;
+    if (!this->ScalarImage)
+      {
+      continue;
+      }
+    double count = static_cast<double>(accumulator.VoxelCount);
+    statistics.Minimum = accumulator.Minimum;
+    statistics.Maximum = accumulator.Maximum;
+    statistics.Mean = accumulator.Sum / count;
+    if (accumulator.VoxelCount > 1)
+      {
+      double variance = (accumulator.SumOfSquares - accumulator.Sum * accumulator.Sum / count) / (count - 1.);
+      statistics.StandardDeviation = sqrt(std::max(0., variance));
+      }
+    }
+
+  if (!this->ScalarImage || !this->ComputeMedian)
+    {
+    return true;
+    }
+
+  // Second pass: histograms of the scalar values within each label.
+  // Each piece adds the voxels of its rows to the shared histograms.
+  int scalarType = this->ScalarImage->GetScalarType();
+  bool integerScalars = (scalarType != VTK_FLOAT && scalarType != VTK_DOUBLE);
+  for (LabelAccumulatorMap::const_iterator accumulatorIt = accumulators.begin(); accumulatorIt != accumulators.end(); ++accumulatorIt)
+    {
+    const LabelAccumulator& accumulator = accumulatorIt->second;
+    LabelHistogram& histogram = job.Histograms[accumulatorIt->first];
+    double range = accumulator.Maximum - accumulator.Minimum;
+    histogram.Origin = accumulator.Minimum;
+    if (integerScalars && range + 1 <= this->MaximumNumberOfBins)
+      {
+      histogram.NumberOfBins = static_cast<int>(range) + 1;
+      histogram.Spacing = 1.;
+      }
+    else if (range > 0.)
+      {
+      histogram.NumberOfBins = this->MaximumNumberOfBins;
+      histogram.Spacing = range / (this->MaximumNumberOfBins - 1);
+      }
+    histogram.Bins.resize(histogram.NumberOfBins, 0);
+    histogram.Lock = vtkSmartPointer<vtkMutexLock>::New();
+    }
+  job.FillHistograms = true;
+  threader->SingleMethodExecute();
+
+  for (std::vector<int>::iterator labelIt = this->Internal->Labels.begin(); labelIt != this->Internal->Labels.end(); ++labelIt)
+    {
+    this->Internal->Statistics[*labelIt].Median =
+      ComputeHistogramMedian(job.Histograms[*labelIt], accumulators[*labelIt].VoxelCount);
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatistics::GetNumberOfLabels()
+{
+  return static_cast<int>(this->Internal->Labels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkImageLabelStatistics::GetNthLabel(int n)
+{
+  if (n < 0 || n >= static_cast<int>(this->Internal->Labels.size()))
+    {
+    vtkErrorMacro("GetNthLabel: index " << n << " is out of range");
+    return 0;
+    }
+  return this->Internal->Labels[n];
+}
+
+//----------------------------------------------------------------------------
+bool vtkImageLabelStatistics::HasLabel(int label)
+{
+  return this->Internal->GetLabelStatistics(label) != NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkImageLabelStatistics::GetVoxelCount(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->VoxelCount : 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetVolume(int label)
+{
+  return this->GetVoxelCount(label) * this->Internal->VoxelVolume;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetMinimum(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->Minimum : 0.;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetMaximum(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->Maximum : 0.;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetMean(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->Mean : 0.;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetStandardDeviation(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->StandardDeviation : 0.;
+}
+
+//----------------------------------------------------------------------------
+double vtkImageLabelStatistics::GetMedian(int label)
+{
+  const vtkInternal::LabelStatistics* statistics = this->Internal->GetLabelStatistics(label);
+  return statistics ? statistics->Median : 0.;
+}
@@ -0,0 +1,125 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageLabelStatistics_h
+#define __vtkImageLabelStatistics_h
+
+// VTK includes
+#include <vtkObject.h>
+
+#include "vtkMRMLLogicExport.h"
+
+class vtkImageData;
+
+/// \brief Compute the statistics of all the labels of a labelmap at once.
+///
+/// vtkImageLabelStatistics computes, for every label value present in the
+/// label image, the number of voxels and the volume of the label and, if a
+/// scalar image is set, the minimum, maximum, mean, standard deviation and
+/// median of the scalar values within the label.
+///
+/// The voxels are traversed once by multiple threads to compute the counts,
+/// extrema and moments of all the labels. The medians are computed from a
+/// histogram per label, filled in a second pass. In both passes each thread
+/// processes a range of rows and only allocates accumulators and histograms
+/// for the labels present in its rows, so the memory does not depend on the
+/// range of the label values.
+///
+/// The label and scalar images must share the same IJK grid (same origin,
+/// spacing and orientation), the statistics are computed on the intersection
+/// of their extents. Label values are truncated to integers.
+///
+/// Usage from python:
+/// \code
+/// statistics = slicer.vtkImageLabelStatistics()
+/// statistics.SetLabelImage(labelNode.GetImageData())
+/// statistics.SetScalarImage(grayscaleNode.GetImageData())
+/// statistics.Compute()
+/// for n in range(statistics.GetNumberOfLabels()):
+///   label = statistics.GetNthLabel(n)
+///   print(label, statistics.GetVoxelCount(label), statistics.GetMean(label))
+/// \endcode
+class VTK_MRML_LOGIC_EXPORT vtkImageLabelStatistics : public vtkObject
+{
+public:
+  static vtkImageLabelStatistics *New();
+  vtkTypeMacro(vtkImageLabelStatistics,vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Labelmap, must have a single scalar component.
+  void SetLabelImage(vtkImageData* labelImage);
+  vtkGetObjectMacro(LabelImage, vtkImageData);
+
+  /// Optional scalar image. If not set, only the voxel counts and volumes
+  /// are computed.
+  void SetScalarImage(vtkImageData* scalarImage);
+  vtkGetObjectMacro(ScalarImage, vtkImageData);
+
+  /// Volume of a voxel, used to compute the label volumes.
+  /// If not positive (default), the product of the label image spacing is used.
+  vtkSetMacro(VoxelVolume, double);
+  vtkGetMacro(VoxelVolume, double);
+
+  /// Compute the medians. Default is true.
+  vtkSetMacro(ComputeMedian, bool);
+  vtkGetMacro(ComputeMedian, bool);
+  vtkBooleanMacro(ComputeMedian, bool);
+
+  /// Maximum number of bins of the histograms used to compute the medians.
+  /// Medians of integer scalars are exact if the scalar range of the label
+  /// is smaller than the number of bins. Default is 65536.
+  vtkSetClampMacro(MaximumNumberOfBins, int, 2, VTK_INT_MAX);
+  vtkGetMacro(MaximumNumberOfBins, int);
+
+  /// Number of threads used to compute the statistics.
+  /// 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
+  /// Compute the statistics of all the labels.
+  /// Returns false if the inputs are invalid.
+  bool Compute();
+
+  /// Number of label values with at least one voxel, including 0.
+  int GetNumberOfLabels();
+  /// Label values are sorted in increasing order.
+  int GetNthLabel(int n);
+  bool HasLabel(int label);
+
+  /// Statistics of a label. Zero if the label has no voxels.
+  vtkIdType GetVoxelCount(int label);
+  double GetVolume(int label);
+  double GetMinimum(int label);
+  double GetMaximum(int label);
+  double GetMean(int label);
+  double GetStandardDeviation(int label);
+  double GetMedian(int label);
+
+protected:
+  vtkImageLabelStatistics();
+  virtual ~vtkImageLabelStatistics();
+
+  vtkImageData* LabelImage;
+  vtkImageData* ScalarImage;
+  double VoxelVolume;
+  bool ComputeMedian;
+  int MaximumNumberOfBins;
+  int NumberOfThreads;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkImageLabelStatistics(const vtkImageLabelStatistics&);  // Not implemented.
+  void operator=(const vtkImageLabelStatistics&);  // Not implemented.
+};
+
+#endif
@@ -0,0 +1,624 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#include "vtkImageSliceCompositor.h"
+
+// VTK includes
+#include <vtkAlgorithmOutput.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkLookupTable.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkScalarsToColors.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+/// Maximum number of entries of a label map color table
+const int MAXIMUM_LABEL_TABLE_SIZE = 65536;
+}
+
+//----------------------------------------------------------------------------
+class vtkImageSliceCompositor::vtkInternal
+{
+public:
+  struct Layer
+  {
+    Layer()
+    {
+      vtkMatrix4x4::Identity(this->ResliceMatrix);
+      this->Interpolate = false;
+      this->LabelMap = false;
+      this->Window = 256.;
+      this->Level = 128.;
+      this->ApplyThreshold = false;
+      this->LowerThreshold = VTK_SHORT_MIN;
+      this->UpperThreshold = VTK_SHORT_MAX;
+      this->Opacity = 1.;
+      this->TableOffset = 0;
+    }
+
+    double ResliceMatrix[16];
+    bool Interpolate;
+    bool LabelMap;
+    double Window;
+    double Level;
+    bool ApplyThreshold;
+    double LowerThreshold;
+    double UpperThreshold;
+    vtkSmartPointer<vtkScalarsToColors> LookupTable;
+    double Opacity;
+
+    /// RGBA colors indexed by the window/level luminance (scalar layers) or
+    /// by the voxel value minus TableOffset (label maps). Built in RequestData.
+    std::vector<unsigned char> ColorTable;
+    int TableOffset;
+  };
+
+  bool IsValidLayer(vtkImageSliceCompositor* self, int layer)
+  {
+    if (layer < 0 || layer >= static_cast<int>(this->Layers.size()))
+      {
+      vtkErrorWithObjectMacro(self, "Invalid layer index " << layer);
+      return false;
+      }
+    return true;
+  }
+
+  void BuildColorTable(Layer& layer);
+
+  std::vector<Layer> Layers;
+};
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::vtkInternal::BuildColorTable(Layer& layer)
+{
+  layer.ColorTable.clear();
+  layer.TableOffset = 0;
+  if (layer.LookupTable.GetPointer() == NULL)
+    {
+    return;
+    }
+  layer.LookupTable->Build();
+  vtkLookupTable* labelLookupTable = vtkLookupTable::SafeDownCast(layer.LookupTable);
+  if (layer.LabelMap && labelLookupTable)
+    {
+    // 1:1 mapping of the label values to the table values, as done by
+    // vtkMRMLLabelMapVolumeDisplayNode
+    vtkIdType numberOfColors = std::min(labelLookupTable->GetNumberOfTableValues(),
+                                        static_cast<vtkIdType>(MAXIMUM_LABEL_TABLE_SIZE));
+    if (numberOfColors <= 0)
+      {
+      return;
+      }
+    const unsigned char* colors = labelLookupTable->GetPointer(0);
+    layer.ColorTable.assign(colors, colors + 4 * numberOfColors);
+    }
+  else if (layer.LabelMap)
+    {
+    double* range = layer.LookupTable->GetRange();
+    int first = static_cast<int>(std::ceil(range[0]));
+    int last = static_cast<int>(std::floor(range[1]));
+    last = std::max(first, std::min(last, first + MAXIMUM_LABEL_TABLE_SIZE - 1));
+    std::vector<double> values(last - first + 1);
+    for (size_t i = 0; i < values.size(); ++i)
+      {
+      values[i] = first + static_cast<int>(i);
+      }
+    layer.ColorTable.resize(values.size() * 4);
+    layer.LookupTable->MapScalarsThroughTable(&values[0], &layer.ColorTable[0],
+      VTK_DOUBLE, static_cast<int>(values.size()), 1, VTK_RGBA);
+    layer.TableOffset = first;
+    }
+  else
+    {
+    // Same as vtkImageMapToWindowLevelColors (luminance) + vtkImageMapToColors
+    unsigned char luminances[256];
+    for (int i = 0; i < 256; ++i)
+      {
+      luminances[i] = static_cast<unsigned char>(i);
+      }
+    layer.ColorTable.resize(256 * 4);
+    layer.LookupTable->MapScalarsThroughTable(luminances, &layer.ColorTable[0],
+      VTK_UNSIGNED_CHAR, 256, 1, VTK_RGBA);
+    }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkImageSliceCompositor);
+
+//----------------------------------------------------------------------------
+vtkImageSliceCompositor::vtkImageSliceCompositor()
+{
+  this->Internal = new vtkInternal;
+  this->OutputExtent[0] = this->OutputExtent[2] = this->OutputExtent[4] = 0;
+  this->OutputExtent[1] = this->OutputExtent[3] = this->OutputExtent[5] = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkImageSliceCompositor::~vtkImageSliceCompositor()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "OutputExtent: " << this->OutputExtent[0] << " " << this->OutputExtent[1] << " "
+     << this->OutputExtent[2] << " " << this->OutputExtent[3] << " "
+     << this->OutputExtent[4] << " " << this->OutputExtent[5] << "\n";
+  os << indent << "NumberOfLayers: " << this->Internal->Layers.size() << "\n";
+  for (size_t i = 0; i < this->Internal->Layers.size(); ++i)
+    {
+    const vtkInternal::Layer& layer = this->Internal->Layers[i];
+    os << indent << "Layer " << i << ":"
+       << " Interpolate=" << layer.Interpolate
+       << " LabelMap=" << layer.LabelMap
+       << " Window=" << layer.Window
+       << " Level=" << layer.Level
+       << " ApplyThreshold=" << layer.ApplyThreshold
+       << " Threshold=[" << layer.LowerThreshold << ", " << layer.UpperThreshold << "]"
+       << " Opacity=" << layer.Opacity
+       << " LookupTable=" << layer.LookupTable.GetPointer() << "\n";
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetNumberOfLayers(int numberOfLayers)
+{
+  numberOfLayers = std::max(0, numberOfLayers);
+  if (numberOfLayers == this->GetNumberOfLayers())
+    {
+    return;
+    }
+  this->Internal->Layers.resize(numberOfLayers);
+  this->SetNumberOfInputConnections(0, numberOfLayers);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::GetNumberOfLayers()
+{
+  return static_cast<int>(this->Internal->Layers.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerInputConnection(int layer, vtkAlgorithmOutput* input)
+{
+  if (!this->Internal->IsValidLayer(this, layer))
+    {
+    return;
+    }
+  if (this->GetInputConnection(0, layer) == input)
+    {
+    return;
+    }
+  this->SetNthInputConnection(0, layer, input);
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerResliceMatrix(int layer, vtkMatrix4x4* xyToIJK)
+{
+  if (!this->Internal->IsValidLayer(this, layer) || xyToIJK == NULL)
+    {
+    return;
+    }
+  double* matrix = this->Internal->Layers[layer].ResliceMatrix;
+  if (std::equal(matrix, matrix + 16, &xyToIJK->Element[0][0]))
+    {
+    return;
+    }
+  std::copy(&xyToIJK->Element[0][0], &xyToIJK->Element[0][0] + 16, matrix);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerInterpolate(int layer, bool interpolate)
+{
+  if (!this->Internal->IsValidLayer(this, layer) ||
+      this->Internal->Layers[layer].Interpolate == interpolate)
+    {
+    return;
+    }
+  this->Internal->Layers[layer].Interpolate = interpolate;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerWindowLevel(int layer, double window, double level)
+{
+  if (!this->Internal->IsValidLayer(this, layer) ||
+      (this->Internal->Layers[layer].Window == window &&
+       this->Internal->Layers[layer].Level == level))
+    {
+    return;
+    }
+  this->Internal->Layers[layer].Window = window;
+  this->Internal->Layers[layer].Level = level;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerThreshold(int layer, bool apply, double lower, double upper)
+{
+  if (!this->Internal->IsValidLayer(this, layer))
+    {
+    return;
+    }
+  vtkInternal::Layer& layerInfo = this->Internal->Layers[layer];
+  if (layerInfo.ApplyThreshold == apply &&
+      layerInfo.LowerThreshold == lower &&
+      layerInfo.UpperThreshold == upper)
+    {
+    return;
+    }
+  layerInfo.ApplyThreshold = apply;
+  layerInfo.LowerThreshold = lower;
+  layerInfo.UpperThreshold = upper;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerLookupTable(int layer, vtkScalarsToColors* lookupTable)
+{
+  if (!this->Internal->IsValidLayer(this, layer) ||
+      this->Internal->Layers[layer].LookupTable.GetPointer() == lookupTable)
+    {
+    return;
+    }
+  this->Internal->Layers[layer].LookupTable = lookupTable;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerLabelMap(int layer, bool labelMap)
+{
+  if (!this->Internal->IsValidLayer(this, layer) ||
+      this->Internal->Layers[layer].LabelMap == labelMap)
+    {
+    return;
+    }
+  this->Internal->Layers[layer].LabelMap = labelMap;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::SetLayerOpacity(int layer, double opacity)
+{
+  opacity = std::max(0., std::min(opacity, 1.));
+  if (!this->Internal->IsValidLayer(this, layer) ||
+      this->Internal->Layers[layer].Opacity == opacity)
+    {
+    return;
+    }
+  this->Internal->Layers[layer].Opacity = opacity;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMTimeType vtkImageSliceCompositor::GetMTime()
+{
+  vtkMTimeType mTime = this->Superclass::GetMTime();
+  for (size_t i = 0; i < this->Internal->Layers.size(); ++i)
+    {
+    vtkScalarsToColors* lookupTable = this->Internal->Layers[i].LookupTable;
+    if (lookupTable)
+      {
+      mTime = std::max(mTime, lookupTable->GetMTime());
+      }
+    }
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::FillInputPortInformation(int port, vtkInformation* info)
+{
+  this->Superclass::FillInputPortInformation(port, info);
+  info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
+  info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::RequestInformation(vtkInformation* vtkNotUsed(request),
+                                                vtkInformationVector** vtkNotUsed(inputVector),
+                                                vtkInformationVector* outputVector)
+{
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  double origin[3] = {0., 0., 0.};
+  double spacing[3] = {1., 1., 1.};
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(), this->OutputExtent, 6);
+  outInfo->Set(vtkDataObject::ORIGIN(), origin, 3);
+  outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+  vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_UNSIGNED_CHAR, 4);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
+                                                 vtkInformationVector** inputVector,
+                                                 vtkInformationVector* vtkNotUsed(outputVector))
+{
+  // The voxels needed by a slice are not known in advance, request the
+  // whole volumes (they are typically already in memory).
+  for (int i = 0; i < inputVector[0]->GetNumberOfInformationObjects(); ++i)
+    {
+    vtkInformation* inInfo = inputVector[0]->GetInformationObject(i);
+    if (inInfo == NULL)
+      {
+      continue;
+      }
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
+      inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()), 6);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkImageSliceCompositor::RequestData(vtkInformation* request,
+                                         vtkInformationVector** inputVector,
+                                         vtkInformationVector* outputVector)
+{
+  // Color tables are shared by all the threads, build them beforehand
+  for (size_t i = 0; i < this->Internal->Layers.size(); ++i)
+    {
+    this->Internal->BuildColorTable(this->Internal->Layers[i]);
+    }
+  if (inputVector[0]->GetNumberOfInformationObjects() == 0)
+    {
+    vtkImageData* output = vtkImageData::GetData(outputVector);
+    output->SetExtent(this->OutputExtent);
+    output->AllocateScalars(VTK_UNSIGNED_CHAR, 4);
+    std::fill_n(static_cast<unsigned char*>(output->GetScalarPointer()),
+                output->GetNumberOfPoints() * 4, 0);
+    return 1;
+    }
+  return this->Superclass::RequestData(request, inputVector, outputVector);
+}
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Sample a row of the volume starting at \a point (in IJK coordinates) with
+/// a step of \a step. Points outside of the volume (extended by half a voxel
+/// as vtkImageReslice does) get a value of 0 and are flagged in \a inside.
+template <class T>
+void vtkImageSliceCompositorSampleRow(vtkImageData* inData, T* inPtr,
+                                      const double point[3], const double step[3],
+                                      int numberOfPixels, bool interpolate,
+                                      double* values, unsigned char* inside)
+{
+  int inExt[6];
+  inData->GetExtent(inExt);
+  vtkIdType inInc[3];
+  inData->GetIncrements(inInc);
+  const bool isInteger = std::numeric_limits<T>::is_integer;
+
+  for (int n = 0; n < numberOfPixels; ++n)
+    {
+    double ijk[3] = { point[0] + n * step[0], point[1] + n * step[1], point[2] + n * step[2] };
+    bool isInside = true;
+    for (int axis = 0; axis < 3 && isInside; ++axis)
+      {
+      isInside = (ijk[axis] >= inExt[2 * axis] - 0.5 && ijk[axis] <= inExt[2 * axis + 1] + 0.5);
+      }
+    inside[n] = isInside ? 1 : 0;
+    if (!isInside)
+      {
+      values[n] = 0.;
+      continue;
+      }
+    if (!interpolate)
+      {
+      vtkIdType offset = 0;
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        int index = static_cast<int>(std::floor(ijk[axis] + 0.5));
+        index = std::max(inExt[2 * axis], std::min(index, inExt[2 * axis + 1]));
+        offset += (index - inExt[2 * axis]) * inInc[axis];
+        }
+      values[n] = static_cast<double>(inPtr[offset]);
+      continue;
+      }
+    vtkIdType offsets[3][2];
+    double weights[3][2];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      int index = static_cast<int>(std::floor(ijk[axis]));
+      double fraction = ijk[axis] - index;
+      if (index < inExt[2 * axis])
+        {
+        index = inExt[2 * axis];
+        fraction = 0.;
+        }
+      if (index >= inExt[2 * axis + 1])
+        {
+        index = inExt[2 * axis + 1];
+        fraction = 0.;
+        }
+      offsets[axis][0] = (index - inExt[2 * axis]) * inInc[axis];
+      offsets[axis][1] = offsets[axis][0] + (fraction > 0. ? inInc[axis] : 0);
+      weights[axis][0] = 1. - fraction;
+      weights[axis][1] = fraction;
+      }
+    double value = 0.;
+    for (int k = 0; k < 2; ++k)
+      {
+      for (int j = 0; j < 2; ++j)
+        {
+        const T* rowPtr = inPtr + offsets[2][k] + offsets[1][j];
+        value += weights[2][k] * weights[1][j] *
+          (weights[0][0] * rowPtr[offsets[0][0]] + weights[0][1] * rowPtr[offsets[0][1]]);
+        }
+      }
+    // vtkImageReslice rounds interpolated values to the input scalar type
+    values[n] = isInteger ? std::floor(value + 0.5) : value;
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Luminance computed by vtkImageMapToWindowLevelColors
+inline unsigned char vtkImageSliceCompositorWindowLevel(double value,
+  double lower, double upper, unsigned char lowerValue, unsigned char upperValue,
+  double shift, double scale)
+{
+  if (value <= lower)
+    {
+    return lowerValue;
+    }
+  if (value >= upper)
+    {
+    return upperValue;
+    }
+  return static_cast<unsigned char>((value + shift) * scale);
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+void vtkImageSliceCompositor::ThreadedRequestData(vtkInformation* vtkNotUsed(request),
+                                                  vtkInformationVector** vtkNotUsed(inputVector),
+                                                  vtkInformationVector* vtkNotUsed(outputVector),
+                                                  vtkImageData*** inData,
+                                                  vtkImageData** outData,
+                                                  int outExt[6], int vtkNotUsed(threadId))
+{
+  const int numberOfPixels = outExt[1] - outExt[0] + 1;
+  if (numberOfPixels <= 0)
+    {
+    return;
+    }
+  const int numberOfLayers = std::min(this->GetNumberOfInputConnections(0),
+                                      this->GetNumberOfLayers());
+
+  std::vector<double> values(numberOfPixels);
+  std::vector<unsigned char> inside(numberOfPixels);
+  std::vector<unsigned char> colors(numberOfPixels * 4);
+
+  for (int z = outExt[4]; z <= outExt[5]; ++z)
+    {
+    for (int y = outExt[2]; y <= outExt[3]; ++y)
+      {
+      unsigned char* outPtr = static_cast<unsigned char*>(
+        outData[0]->GetScalarPointer(outExt[0], y, z));
+      std::fill_n(outPtr, numberOfPixels * 4, 0);
+
+      for (int layerIndex = 0; layerIndex < numberOfLayers; ++layerIndex)
+        {
+        const vtkInternal::Layer& layer = this->Internal->Layers[layerIndex];
+        vtkImageData* volume = inData[0][layerIndex];
+        if (volume == NULL || layer.ColorTable.empty() ||
+            volume->GetNumberOfScalarComponents() != 1 ||
+            volume->GetPointData()->GetScalars() == NULL)
+          {
+          continue;
+          }
+
+        // Resample the row
+        const double* m = layer.ResliceMatrix;
+        double point[3];
+        double step[3];
+        for (int i = 0; i < 3; ++i)
+          {
+          point[i] = m[4 * i] * outExt[0] + m[4 * i + 1] * y + m[4 * i + 2] * z + m[4 * i + 3];
+          step[i] = m[4 * i];
+          }
+        void* inPtr = volume->GetScalarPointerForExtent(volume->GetExtent());
+        switch (volume->GetScalarType())
+          {
+          vtkTemplateMacro(vtkImageSliceCompositorSampleRow(volume, static_cast<VTK_TT*>(inPtr),
+            point, step, numberOfPixels, layer.Interpolate, &values[0], &inside[0]));
+          default:
+            vtkErrorMacro("ThreadedRequestData: unsupported scalar type " << volume->GetScalarType());
+            continue;
+          }
+
+        // Map the values to colors
+        const unsigned char* table = &layer.ColorTable[0];
+        if (layer.LabelMap)
+          {
+          const int tableSize = static_cast<int>(layer.ColorTable.size() / 4);
+          for (int n = 0; n < numberOfPixels; ++n)
+            {
+            int index = static_cast<int>(std::floor(values[n] + 0.5)) - layer.TableOffset;
+            index = std::max(0, std::min(index, tableSize - 1));
+            const unsigned char* color = table + 4 * index;
+            unsigned char* rgba = &colors[4 * n];
+            rgba[0] = color[0];
+            rgba[1] = color[1];
+            rgba[2] = color[2];
+            rgba[3] = color[3];
+            }
+          }
+        else
+          {
+          const double window = layer.Window;
+          const double level = layer.Level;
+          const double lower = level - std::fabs(window) / 2.;
+          const double upper = level + std::fabs(window) / 2.;
+          const unsigned char lowerValue = window > 0 ? 0 : 255;
+          const unsigned char upperValue = window > 0 ? 255 : 0;
+          const double shift = window / 2. - level;
+          const double scale = window != 0. ? 255. / window : 0.;
+          for (int n = 0; n < numberOfPixels; ++n)
+            {
+            const double value = values[n];
+            const unsigned char* color = table + 4 * vtkImageSliceCompositorWindowLevel(
+              value, lower, upper, lowerValue, upperValue, shift, scale);
+            const bool visible = inside[n] && color[3] != 0 &&
+              (!layer.ApplyThreshold ||
+               (value >= layer.LowerThreshold && value <= layer.UpperThreshold));
+            unsigned char* rgba = &colors[4 * n];
+            rgba[0] = color[0];
+            rgba[1] = color[1];
+            rgba[2] = color[2];
+            rgba[3] = visible ? 255 : 0;
+            }
+          }
+
+        // Blend over the previous layers
+        if (layerIndex == 0)
+          {
+          std::copy(colors.begin(), colors.end(), outPtr);
+          continue;
+          }
+        const double opacity = layer.Opacity / 255.;
+        for (int n = 0; n < numberOfPixels; ++n)
+          {
+          const unsigned char* rgba = &colors[4 * n];
+          if (rgba[3] == 0)
+            {
+            continue;
+            }
+          unsigned char* out = outPtr + 4 * n;
+          const double alpha = rgba[3] * opacity;
+          for (int c = 0; c < 3; ++c)
+            {
+            out[c] = static_cast<unsigned char>(out[c] + alpha * (rgba[c] - out[c]) + 0.5);
+            }
+          out[3] = static_cast<unsigned char>(out[3] + alpha * (255 - out[3]) + 0.5);
+          }
+        }
+      }
+    }
+}
@@ -0,0 +1,126 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+#ifndef __vtkImageSliceCompositor_h
+#define __vtkImageSliceCompositor_h
+
+// VTK includes
+#include <vtkThreadedImageAlgorithm.h>
+
+#include "vtkMRMLLogicExport.h"
+
+class vtkAlgorithmOutput;
+class vtkMatrix4x4;
+class vtkScalarsToColors;
+
+/// \brief Resample, map and blend slice layers in a single pass.
+///
+/// vtkImageSliceCompositor computes the RGBA image of a slice view directly
+/// from the volumes of its layers. For each output pixel and each layer, the
+/// volume is sampled (nearest neighbor or trilinear) at the position given by
+/// the layer XY to IJK matrix, mapped through the window/level and the lookup
+/// table, thresholded and alpha blended over the previous layers.
+///
+/// For single component volumes with a linear transform, the output
+/// approximates the vtkImageReslice, vtkMRMLScalarVolumeDisplayNode
+/// (or vtkMRMLLabelMapVolumeDisplayNode) and vtkImageBlend pipeline of
+/// vtkMRMLSliceLogic without allocating and traversing an intermediate image
+/// per stage. Colors are blended in floating point and rounded, while
+/// vtkImageBlend uses fixed point arithmetic: color components may differ by
+/// a couple of units. The output alpha is the "over" composition of the
+/// layer alphas, which may differ from the alpha computed by vtkImageBlend.
+///
+/// The first layer is copied into the output, the following layers are
+/// blended using their alpha multiplied by their opacity.
+/// \sa vtkMRMLSliceLogic::SetUseFusedCompositing()
+class VTK_MRML_LOGIC_EXPORT vtkImageSliceCompositor : public vtkThreadedImageAlgorithm
+{
+public:
+  static vtkImageSliceCompositor *New();
+  vtkTypeMacro(vtkImageSliceCompositor,vtkThreadedImageAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Set the number of layers. Layers are composited back to front.
+  void SetNumberOfLayers(int numberOfLayers);
+  int GetNumberOfLayers();
+
+  /// Volume of the layer. The volume must have a single scalar component.
+  void SetLayerInputConnection(int layer, vtkAlgorithmOutput* input);
+
+  /// Transform from output XY coordinates to the volume IJK coordinates.
+  void SetLayerResliceMatrix(int layer, vtkMatrix4x4* xyToIJK);
+
+  /// Trilinear interpolation if true, nearest neighbor otherwise.
+  /// Default is false.
+  void SetLayerInterpolate(int layer, bool interpolate);
+
+  /// Window/level applied before the lookup table. Ignored for label maps.
+  /// Default is 256/128.
+  void SetLayerWindowLevel(int layer, double window, double level);
+
+  /// Voxels outside of [lower, upper] are transparent if \a apply is true.
+  /// Ignored for label maps. Default is false.
+  void SetLayerThreshold(int layer, bool apply, double lower, double upper);
+
+  /// Lookup table used to color the layer. A layer without lookup table
+  /// is not displayed.
+  void SetLayerLookupTable(int layer, vtkScalarsToColors* lookupTable);
+
+  /// Map the voxel values directly through the lookup table (no window/level,
+  /// no threshold). A vtkLookupTable is indexed by the voxel values regardless
+  /// of its table range, as vtkMRMLLabelMapVolumeDisplayNode does. Only the
+  /// first 65536 colors are used. Default is false.
+  void SetLayerLabelMap(int layer, bool labelMap);
+
+  /// Opacity of the layer. Ignored for the first layer. Default is 1.
+  void SetLayerOpacity(int layer, double opacity);
+
+  /// Extent of the output image, typically the slice node dimensions.
+  vtkSetVector6Macro(OutputExtent, int);
+  vtkGetVector6Macro(OutputExtent, int);
+
+  /// Reimplemented to take into account the lookup tables
+  virtual vtkMTimeType GetMTime() VTK_OVERRIDE;
+
+protected:
+  vtkImageSliceCompositor();
+  virtual ~vtkImageSliceCompositor();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info) VTK_OVERRIDE;
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector) VTK_OVERRIDE;
+  virtual int RequestUpdateExtent(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector) VTK_OVERRIDE;
+  virtual int RequestData(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector) VTK_OVERRIDE;
+
+  virtual void ThreadedRequestData(vtkInformation* request,
+                                   vtkInformationVector** inputVector,
+                                   vtkInformationVector* outputVector,
+                                   vtkImageData*** inData,
+                                   vtkImageData** outData,
+                                   int extent[6], int threadId) VTK_OVERRIDE;
+
+  int OutputExtent[6];
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkImageSliceCompositor(const vtkImageSliceCompositor&);  // Not implemented.
+  void operator=(const vtkImageSliceCompositor&);  // Not implemented.
+};
+
+#endif
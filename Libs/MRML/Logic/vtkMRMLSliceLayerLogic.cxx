@@ -18,6 +18,7 @@
 // MRML includes
 #include "vtkMRMLLabelMapVolumeNode.h"
 #include "vtkMRMLLabelMapVolumeDisplayNode.h"
+#include "vtkMRMLProceduralColorNode.h"
 #include "vtkMRMLVectorVolumeDisplayNode.h"
 #include "vtkMRMLDiffusionWeightedVolumeDisplayNode.h"
 #include "vtkMRMLDiffusionTensorVolumeDisplayNode.h"
@@ -29,6 +30,7 @@
 #include <vtkAlgorithm.h>
 #include <vtkAlgorithmOutput.h>
 #include <vtkAssignAttribute.h>
+#include <vtkColorTransferFunction.h>
 #include <vtkDiffusionTensorMathematics.h>
 #include <vtkFloatArray.h>
 #include <vtkGeneralTransform.h>
@@ -36,9 +38,11 @@
 #include <vtkImageReslice.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkScalarsToColors.h>
 #include <vtkTrivialProducer.h>
 #include <vtkTransform.h>
 #include <vtkVersion.h>
@@ -46,6 +50,7 @@
 
 //
 #include "vtkImageLabelOutline.h"
+#include "vtkImageSliceCompositor.h"
 
 // STD includes
 #include <algorithm>
@@ -112,6 +117,7 @@ vtkMRMLSliceLayerLogic::vtkMRMLSliceLayerLogic()
   this->UVWToIJKTransform = vtkGeneralTransform ::New();
 
   this->IsLabelLayer = 0;
+  this->UseTransformGrid = 0;
 
   this->AssignAttributeTensorsToScalars= vtkAssignAttribute::New();
   this->AssignAttributeScalarsToTensors= vtkAssignAttribute::New();
@@ -515,7 +521,34 @@ void vtkMRMLSliceLayerLogic::UpdateTransforms()
     {
     // Apply the transform, if it exists
     vtkMRMLTransformNode *transformNode = this->VolumeNode->GetParentTransformNode();
-    if ( transformNode != 0 )
+    vtkAbstractTransform* worldGrid = NULL;
+    if ( transformNode != 0 && this->UseTransformGrid
+      && !transformNode->IsTransformToWorldLinear() )
+      {
+      // Non-linear transforms from world are inverted iteratively for each
+      // resliced voxel. Reslice through a grid approximation instead, within
+      // a tenth of a voxel over the volume and its surroundings.
+      double bounds[6] = { 0. };
+      this->VolumeNode->GetRASBounds(bounds);
+      double* spacing = this->VolumeNode->GetSpacing();
+      double tolerance = 0.1 * std::min(spacing[0], std::min(spacing[1], spacing[2]));
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        double margin = 0.1 * (bounds[2 * axis + 1] - bounds[2 * axis]);
+        bounds[2 * axis] -= margin;
+        bounds[2 * axis + 1] += margin;
+        }
+      if (vtkMath::AreBoundsInitialized(bounds) && tolerance > 0.)
+        {
+        worldGrid = transformNode->GetTransformFromWorldGrid(bounds, tolerance);
+        }
+      }
+    if ( worldGrid != 0 )
+      {
+      this->XYToIJKTransform->Concatenate(worldGrid);
+      this->UVWToIJKTransform->Concatenate(worldGrid);
+      }
+    else if ( transformNode != 0 )
       {
       vtkNew<vtkGeneralTransform> worldTransform;
       worldTransform->Identity();
@@ -799,6 +832,75 @@ void vtkMRMLSliceLayerLogic::UpdateImageDisplay()
     }
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLSliceLayerLogic::UpdateSliceCompositorLayer(vtkImageSliceCompositor* compositor, int layer)
+{
+  vtkMRMLScalarVolumeDisplayNode* scalarVolumeDisplayNode =
+    vtkMRMLScalarVolumeDisplayNode::SafeDownCast(this->VolumeDisplayNode);
+  vtkMRMLLabelMapVolumeDisplayNode* labelMapVolumeDisplayNode =
+    vtkMRMLLabelMapVolumeDisplayNode::SafeDownCast(this->VolumeDisplayNode);
+  if (compositor == 0 || this->VolumeNode == 0 ||
+      this->VolumeNode->GetImageData() == 0 ||
+      this->VolumeNode->GetImageData()->GetNumberOfScalarComponents() != 1 ||
+      this->VolumeNode->GetImageDataConnection() == 0 ||
+      this->VolumeNode->IsA("vtkMRMLDiffusionTensorVolumeNode"))
+    {
+    return false;
+    }
+  // Only the display nodes that map the slice through window/level and
+  // lookup table (or lookup table only for label maps) are supported.
+  if (!(labelMapVolumeDisplayNode ||
+        (scalarVolumeDisplayNode &&
+         !vtkMRMLDiffusionWeightedVolumeDisplayNode::SafeDownCast(scalarVolumeDisplayNode))))
+    {
+    return false;
+    }
+  if (labelMapVolumeDisplayNode && this->GetIsLabelLayer() &&
+      this->SliceNode && this->SliceNode->GetUseLabelOutline())
+    {
+    return false;
+    }
+  vtkTransform* linearTransform = vtkTransform::SafeDownCast(this->Reslice->GetResliceTransform());
+  if (linearTransform == 0)
+    {
+    return false;
+    }
+  // Same lookup table as the display node pipeline
+  vtkMRMLColorNode* colorNode = this->VolumeDisplayNode->GetColorNode();
+  vtkScalarsToColors* lookupTable = colorNode ? colorNode->GetLookupTable() : 0;
+  if (lookupTable == 0 && vtkMRMLProceduralColorNode::SafeDownCast(colorNode))
+    {
+    lookupTable = vtkMRMLProceduralColorNode::SafeDownCast(colorNode)->GetColorTransferFunction();
+    }
+  if (lookupTable == 0)
+    {
+    return false;
+    }
+  if (labelMapVolumeDisplayNode && !lookupTable->IsA("vtkLookupTable") &&
+      lookupTable->GetRange()[1] - lookupTable->GetRange()[0] >= 65536)
+    {
+    return false;
+    }
+
+  compositor->SetLayerInputConnection(layer, this->VolumeNode->GetImageDataConnection());
+  compositor->SetLayerResliceMatrix(layer, linearTransform->GetMatrix());
+  compositor->SetLayerLookupTable(layer, lookupTable);
+  compositor->SetLayerLabelMap(layer, labelMapVolumeDisplayNode != 0);
+  if (labelMapVolumeDisplayNode)
+    {
+    compositor->SetLayerInterpolate(layer, false);
+    }
+  else
+    {
+    compositor->SetLayerInterpolate(layer, scalarVolumeDisplayNode->GetInterpolate() != 0);
+    compositor->SetLayerWindowLevel(layer,
+      scalarVolumeDisplayNode->GetWindow(), scalarVolumeDisplayNode->GetLevel());
+    compositor->SetLayerThreshold(layer, scalarVolumeDisplayNode->GetApplyThreshold() != 0,
+      scalarVolumeDisplayNode->GetLowerThreshold(), scalarVolumeDisplayNode->GetUpperThreshold());
+    }
+  return true;
+}
+
 //----------------------------------------------------------------------------
 vtkAlgorithmOutput* vtkMRMLSliceLayerLogic::GetSliceImageDataConnection()
 {
@@ -973,6 +1075,7 @@ void vtkMRMLSliceLayerLogic::PrintSelf(ostream& os, vtkIndent indent)
     }
 
   os << indent << "IsLabelLayer: " << this->GetIsLabelLayer() << "\n";
+  os << indent << "UseTransformGrid: " << this->GetUseTransformGrid() << "\n";
   os << indent << "LabelOutline:\n";
   if (this->LabelOutline)
     {
@@ -55,6 +55,7 @@ class vtkGeneralTransform;
 //#include <cstdlib>
 
 class vtkImageLabelOutline;
+class vtkImageSliceCompositor;
 class vtkTransform;
 
 class VTK_MRML_LOGIC_EXPORT vtkMRMLSliceLayerLogic
@@ -96,6 +97,15 @@ public:
   vtkSetMacro (IsLabelLayer, int);
   vtkBooleanMacro (IsLabelLayer, int);
 
+  ///
+  /// Select if volumes under a non-linear transform are resliced through a
+  /// grid approximation of the transform from world, within a tenth of a
+  /// voxel (see vtkMRMLTransformNode::GetTransformFromWorldGrid()), instead
+  /// of the exact transform. Off by default.
+  vtkGetMacro (UseTransformGrid, int);
+  vtkSetMacro (UseTransformGrid, int);
+  vtkBooleanMacro (UseTransformGrid, int);
+
   ///
   /// The filter that turns the label map into an outline
   vtkGetObjectMacro (LabelOutline, vtkImageLabelOutline);
@@ -129,6 +139,13 @@ public:
   /// The current reslice transform XYToIJK
   vtkGetObjectMacro (XYToIJKTransform, vtkGeneralTransform);
 
+  /// Set the parameters of the \a layer of \a compositor so that it
+  /// produces the same image as GetImageDataConnection().
+  /// Returns false if the layer can't be composited in a single pass
+  /// (non-linear transform, multi-component volume, label outline...),
+  /// in which case the regular pipeline must be used.
+  bool UpdateSliceCompositorLayer(vtkImageSliceCompositor* compositor, int layer);
+
 
 protected:
   vtkMRMLSliceLayerLogic();
@@ -180,6 +197,7 @@ protected:
   vtkGeneralTransform *UVWToIJKTransform;
 
   int IsLabelLayer;
+  int UseTransformGrid;
 
   int UpdatingTransforms;
 };
@@ -15,6 +15,7 @@
 // MRMLLogic includes
 #include "vtkMRMLSliceLogic.h"
 #include "vtkMRMLSliceLayerLogic.h"
+#include "vtkImageSliceCompositor.h"
 
 // MRML includes
 #include <vtkEventBroker.h>
@@ -64,13 +65,17 @@ const std::string vtkMRMLSliceLogic::SLICE_MODEL_NODE_NAME_SUFFIX = std::string(
 //----------------------------------------------------------------------------
 struct SliceLayerInfo
   {
-  SliceLayerInfo(vtkAlgorithmOutput* blendInput, double opacity)
+  SliceLayerInfo(vtkAlgorithmOutput* blendInput, double opacity,
+                 vtkMRMLSliceLayerLogic* layerLogic = 0)
     {
     this->BlendInput = blendInput;
     this->Opacity = opacity;
+    this->LayerLogic = layerLogic;
     }
   vtkSmartPointer<vtkAlgorithmOutput> BlendInput;
   double Opacity;
+  /// Layer that produces BlendInput, if any
+  vtkMRMLSliceLayerLogic* LayerLogic;
   };
 
 //----------------------------------------------------------------------------
@@ -88,6 +93,9 @@ vtkMRMLSliceLogic::vtkMRMLSliceLogic()
   this->SliceCompositeNode = 0;
   this->Blend = vtkImageBlend::New();
   this->BlendUVW = vtkImageBlend::New();
+  this->SliceCompositor = vtkImageSliceCompositor::New();
+  this->UseFusedCompositing = false;
+  this->FusedCompositingActive = false;
 
   this->ExtractModelTexture = vtkImageReslice::New();
   this->ExtractModelTexture->SetOutputDimensionality (2);
@@ -127,6 +135,11 @@ vtkMRMLSliceLogic::~vtkMRMLSliceLogic()
     this->BlendUVW->Delete();
     this->BlendUVW = 0;
     }
+  if (this->SliceCompositor)
+    {
+    this->SliceCompositor->Delete();
+    this->SliceCompositor = 0;
+    }
   if (this->ExtractModelTexture)
     {
     this->ExtractModelTexture->Delete();
@@ -829,10 +842,12 @@ vtkAlgorithmOutput * vtkMRMLSliceLogic::GetImageDataConnection()
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLogic::UpdateImageData ()
 {
+  vtkAlgorithmOutput* blendOutputPort = this->FusedCompositingActive ?
+    this->SliceCompositor->GetOutputPort() : this->Blend->GetOutputPort();
   if (this->SliceNode->GetSliceResolutionMode() == vtkMRMLSliceNode::SliceResolutionMatch2DView)
     {
-    this->ExtractModelTexture->SetInputConnection( this->Blend->GetOutputPort() );
-    this->ImageDataConnection = this->Blend->GetOutputPort();
+    this->ExtractModelTexture->SetInputConnection( blendOutputPort );
+    this->ImageDataConnection = blendOutputPort;
     }
   else
     {
@@ -845,9 +860,10 @@ void vtkMRMLSliceLogic::UpdateImageData ()
        (this->GetForegroundLayer() != 0 && this->GetForegroundLayer()->GetImageDataConnection() != 0) ||
        (this->GetLabelLayer() != 0 && this->GetLabelLayer()->GetImageDataConnection() != 0) )
     {
-    if (this->ImageDataConnection == 0 || this->Blend->GetOutputPort()->GetMTime() > this->ImageDataConnection->GetMTime())
+    if (this->ImageDataConnection == 0 || blendOutputPort->GetMTime() > this->ImageDataConnection->GetMTime() ||
+        blendOutputPort != this->ImageDataConnection)
       {
-      this->ImageDataConnection = this->Blend->GetOutputPort();
+      this->ImageDataConnection = blendOutputPort;
       }
     }
   else
@@ -911,6 +927,50 @@ bool vtkMRMLSliceLogic::UpdateBlendLayers(vtkImageBlend* blend, const std::deque
   return modified;
 }
 
+//----------------------------------------------------------------------------
+bool vtkMRMLSliceLogic::UpdateSliceCompositor(const std::deque<SliceLayerInfo> &layers)
+{
+  if (layers.empty() || this->SliceNode == 0)
+    {
+    return false;
+    }
+  for (std::deque<SliceLayerInfo>::const_iterator layerIt = layers.begin(); layerIt != layers.end(); ++layerIt)
+    {
+    if (layerIt->LayerLogic == 0)
+      {
+      // e.g. add/subtract compositing
+      return false;
+      }
+    }
+  this->SliceCompositor->SetNumberOfLayers(static_cast<int>(layers.size()));
+  int layerIndex = 0;
+  for (std::deque<SliceLayerInfo>::const_iterator layerIt = layers.begin(); layerIt != layers.end(); ++layerIt, ++layerIndex)
+    {
+    if (!layerIt->LayerLogic->UpdateSliceCompositorLayer(this->SliceCompositor, layerIndex))
+      {
+      return false;
+      }
+    this->SliceCompositor->SetLayerOpacity(layerIndex, layerIt->Opacity);
+    }
+  int* dimensions = this->SliceNode->GetDimensions();
+  this->SliceCompositor->SetOutputExtent(0, dimensions[0] - 1,
+                                         0, dimensions[1] - 1,
+                                         0, dimensions[2] - 1);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLSliceLogic::SetUseFusedCompositing(bool use)
+{
+  if (this->UseFusedCompositing == use)
+    {
+    return;
+    }
+  this->UseFusedCompositing = use;
+  this->UpdatePipeline();
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLSliceLogic::UpdatePipeline()
 {
@@ -1076,11 +1136,11 @@ void vtkMRMLSliceLogic::UpdatePipeline()
         {
         if ( backgroundImagePort )
           {
-          layers.push_back(SliceLayerInfo(backgroundImagePort, 1.0));
+          layers.push_back(SliceLayerInfo(backgroundImagePort, 1.0, this->BackgroundLayer));
           }
         if ( foregroundImagePort )
           {
-          layers.push_back(SliceLayerInfo(foregroundImagePort, this->SliceCompositeNode->GetForegroundOpacity()));
+          layers.push_back(SliceLayerInfo(foregroundImagePort, this->SliceCompositeNode->GetForegroundOpacity(), this->ForegroundLayer));
           }
         if ( backgroundImagePortUVW )
           {
@@ -1095,11 +1155,11 @@ void vtkMRMLSliceLogic::UpdatePipeline()
         {
         if ( foregroundImagePort )
           {
-          layers.push_back(SliceLayerInfo(foregroundImagePort, 1.0));
+          layers.push_back(SliceLayerInfo(foregroundImagePort, 1.0, this->ForegroundLayer));
           }
         if ( backgroundImagePort )
           {
-          layers.push_back(SliceLayerInfo(backgroundImagePort, this->SliceCompositeNode->GetForegroundOpacity()));
+          layers.push_back(SliceLayerInfo(backgroundImagePort, this->SliceCompositeNode->GetForegroundOpacity(), this->BackgroundLayer));
           }
         if ( foregroundImagePortUVW )
           {
@@ -1117,7 +1177,7 @@ void vtkMRMLSliceLogic::UpdatePipeline()
     vtkAlgorithmOutput* labelImagePortUVW = this->LabelLayer ? this->LabelLayer->GetImageDataConnectionUVW() : 0;
     if ( labelImagePort )
       {
-      layers.push_back(SliceLayerInfo(labelImagePort, this->SliceCompositeNode->GetLabelOpacity()));
+      layers.push_back(SliceLayerInfo(labelImagePort, this->SliceCompositeNode->GetLabelOpacity(), this->LabelLayer));
       }
     if ( labelImagePortUVW )
       {
@@ -1133,6 +1193,16 @@ void vtkMRMLSliceLogic::UpdatePipeline()
       modified = 1;
       }
 
+    vtkMTimeType oldSliceCompositorMTime = this->SliceCompositor->GetMTime();
+    bool fusedCompositingActive = this->UseFusedCompositing &&
+      this->UpdateSliceCompositor(layers);
+    if (fusedCompositingActive != this->FusedCompositingActive ||
+        (fusedCompositingActive && this->SliceCompositor->GetMTime() > oldSliceCompositorMTime))
+      {
+      this->FusedCompositingActive = fusedCompositingActive;
+      modified = 1;
+      }
+
     //Models
     this->UpdateImageData();
     vtkMRMLDisplayNode* displayNode = this->SliceModelNode ? this->SliceModelNode->GetModelDisplayNode() : 0;
@@ -1252,6 +1322,9 @@ void vtkMRMLSliceLogic::PrintSelf(ostream& os, vtkIndent indent)
     os << indent << "BlendUVW: (none)\n";
     }
 
+  os << indent << "UseFusedCompositing: " << this->UseFusedCompositing << "\n";
+  os << indent << "FusedCompositingActive: " << this->FusedCompositingActive << "\n";
+
   os << indent << "SLICE_MODEL_NODE_NAME_SUFFIX: " << this->SLICE_MODEL_NODE_NAME_SUFFIX << "\n";
 
 }
@@ -34,6 +34,7 @@ class vtkMRMLVolumeNode;
 class vtkAlgorithmOutput;
 class vtkCollection;
 class vtkImageBlend;
+class vtkImageSliceCompositor;
 class vtkTransform;
 class vtkImageData;
 class vtkImageReslice;
@@ -134,6 +135,27 @@ public:
   vtkGetObjectMacro(Blend, vtkImageBlend);
   vtkGetObjectMacro(BlendUVW, vtkImageBlend);
 
+  /// \brief Composite the 2D view layers in a single pass.
+  ///
+  /// If enabled, the slice image is computed by SliceCompositor directly
+  /// from the layer volumes (reslice, window/level, lookup table, threshold
+  /// and blending fused in one multithreaded pass) instead of the per layer
+  /// reslice/display pipelines and Blend. The regular pipeline is still used
+  /// if any layer requires it (see
+  /// vtkMRMLSliceLayerLogic::UpdateSliceCompositorLayer()) or if the
+  /// compositing is not Alpha or ReverseAlpha. Disabled by default.
+  /// \sa GetFusedCompositingActive()
+  void SetUseFusedCompositing(bool use);
+  vtkGetMacro(UseFusedCompositing, bool);
+  vtkBooleanMacro(UseFusedCompositing, bool);
+
+  /// Returns true if the slice image is currently computed by SliceCompositor.
+  vtkGetMacro(FusedCompositingActive, bool);
+
+  /// The single pass compositing filter
+  /// \sa SetUseFusedCompositing()
+  vtkGetObjectMacro(SliceCompositor, vtkImageSliceCompositor);
+
   ///
   /// The offset to the correct slice for lightbox mode
   vtkGetObjectMacro(ActiveSliceTransform, vtkTransform);
@@ -391,6 +413,10 @@ protected:
   /// is a relatively expensive operation.
   bool UpdateBlendLayers(vtkImageBlend* blend, const std::deque<SliceLayerInfo> &layers);
 
+  /// Helper to set the layers of SliceCompositor.
+  /// Returns false if one of the layers can't be composited in a single pass.
+  bool UpdateSliceCompositor(const std::deque<SliceLayerInfo> &layers);
+
   bool                        AddingSliceModelNodes;
   bool                        Initialized;
 
@@ -404,6 +430,9 @@ protected:
 
   vtkImageBlend *   Blend;
   vtkImageBlend *   BlendUVW;
+  vtkImageSliceCompositor * SliceCompositor;
+  bool              UseFusedCompositing;
+  bool              FusedCompositingActive;
   vtkImageReslice * ExtractModelTexture;
   vtkAlgorithmOutput *    ImageDataConnection;
   vtkTransform *    ActiveSliceTransform;
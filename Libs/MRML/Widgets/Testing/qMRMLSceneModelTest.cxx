@@ -43,6 +43,8 @@ private slots:
   void testDefaults();
   void testSetsAndGets();
   void testSetScene();
+  void testIndexFromNode();
+  void testBatchProcessing();
   void testSetColumns();
   void testSetColumns_data();
   void testSetColumnsWithScene();
@@ -108,6 +110,67 @@ void qMRMLSceneModelTester::testSetScene()
   QCOMPARE(sceneModel.columnCount(sceneModel.mrmlSceneIndex()), 1);
 }
 
+// ----------------------------------------------------------------------------
+void qMRMLSceneModelTester::testIndexFromNode()
+{
+  qMRMLSceneModel sceneModel;
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLViewNode> node1;
+  scene->AddNode(node1.GetPointer());
+  sceneModel.setMRMLScene(scene.GetPointer());
+  vtkNew<vtkMRMLViewNode> node2;
+  scene->AddNode(node2.GetPointer());
+
+  QModelIndex index1 = sceneModel.indexFromNode(node1.GetPointer());
+  QModelIndex index2 = sceneModel.indexFromNode(node2.GetPointer());
+  QVERIFY(index1.isValid());
+  QVERIFY(index2.isValid());
+  QCOMPARE(index1.row(), 0);
+  QCOMPARE(index2.row(), 1);
+  QCOMPARE(sceneModel.mrmlNodeFromIndex(index2), node2.GetPointer());
+  QCOMPARE(sceneModel.indexes(node2.GetPointer()).count(), 1);
+
+  scene->RemoveNode(node1.GetPointer());
+  QVERIFY(!sceneModel.indexFromNode(node1.GetPointer()).isValid());
+  QCOMPARE(sceneModel.indexes(node1.GetPointer()).count(), 0);
+  index2 = sceneModel.indexFromNode(node2.GetPointer());
+  QCOMPARE(index2.row(), 0);
+  QCOMPARE(sceneModel.mrmlNodeFromIndex(index2), node2.GetPointer());
+
+  sceneModel.setMRMLScene(0);
+  QVERIFY(!sceneModel.indexFromNode(node2.GetPointer()).isValid());
+}
+
+// ----------------------------------------------------------------------------
+void qMRMLSceneModelTester::testBatchProcessing()
+{
+  qMRMLSceneModel sceneModel;
+  sceneModel.setLazyUpdate(true);
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLViewNode> node1;
+  scene->AddNode(node1.GetPointer());
+  vtkNew<vtkMRMLViewNode> node2;
+  scene->AddNode(node2.GetPointer());
+  sceneModel.setMRMLScene(scene.GetPointer());
+  QStandardItem* item2 = sceneModel.itemFromNode(node2.GetPointer());
+  QVERIFY(item2 != 0);
+
+  scene->StartState(vtkMRMLScene::BatchProcessState);
+  scene->RemoveNode(node1.GetPointer());
+  vtkNew<vtkMRMLViewNode> node3;
+  scene->AddNode(node3.GetPointer());
+  node2->SetName("renamed");
+  scene->EndState(vtkMRMLScene::BatchProcessState);
+
+  // The item of the node that stayed in the scene is kept and updated
+  QCOMPARE(sceneModel.itemFromNode(node2.GetPointer()), item2);
+  QCOMPARE(item2->text(), QString("renamed"));
+  QVERIFY(!sceneModel.indexFromNode(node1.GetPointer()).isValid());
+  QCOMPARE(sceneModel.indexFromNode(node2.GetPointer()).row(), 0);
+  QCOMPARE(sceneModel.indexFromNode(node3.GetPointer()).row(), 1);
+  QCOMPARE(sceneModel.rowCount(sceneModel.mrmlSceneIndex()), 2);
+}
+
 // ----------------------------------------------------------------------------
 void qMRMLSceneModelTester::testSetColumns()
 {
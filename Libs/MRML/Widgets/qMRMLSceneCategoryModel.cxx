@@ -154,6 +154,7 @@ void qMRMLSceneCategoryModel::updateItemFromCategory(QStandardItem* item, const
 //------------------------------------------------------------------------------
 void qMRMLSceneCategoryModel::updateItemFromNode(QStandardItem* item, vtkMRMLNode* node, int column)
 {
+  Q_D(qMRMLSceneCategoryModel);
   this->qMRMLSceneModel::updateItemFromNode(item, node, column);
   QStandardItem* parentItem = item->parent();
   QString category = QString(node->GetAttribute("Category"));
@@ -167,6 +168,7 @@ void qMRMLSceneCategoryModel::updateItemFromNode(QStandardItem* item, vtkMRMLNod
     int max = newParentItem->rowCount() - this->postItems(newParentItem).count();
     int pos = max;
     newParentItem->insertRow(pos, children);
+    d->cacheNodeIndexes(children[0]);
     }
 }
 
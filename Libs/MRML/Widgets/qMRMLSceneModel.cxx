@@ -92,21 +92,13 @@ void qMRMLSceneModelPrivate::init()
 QModelIndexList qMRMLSceneModelPrivate::indexes(const QString& nodeID)const
 {
   Q_Q(const qMRMLSceneModel);
-  QModelIndex scene = q->mrmlSceneIndex();
-  if (scene == QModelIndex())
-    {
-    return QModelIndexList();
-    }
-  // QAbstractItemModel::match doesn't browse through columns
-  // we need to do it manually
-  QModelIndexList nodeIndexes = q->match(
-    scene, qMRMLSceneModel::UIDRole, nodeID,
-    1, Qt::MatchExactly | Qt::MatchRecursive);
-  Q_ASSERT(nodeIndexes.size() <= 1); // we know for sure it won't be more than 1
-  if (nodeIndexes.size() == 0)
+  QModelIndexList nodeIndexes;
+  QModelIndex nodeIndex = this->indexFromNodeID(nodeID);
+  if (!nodeIndex.isValid())
     {
     return nodeIndexes;
     }
+  nodeIndexes << nodeIndex;
   // Add the QModelIndexes from the other columns
   const int row = nodeIndexes[0].row();
   QModelIndex nodeParentIndex = nodeIndexes[0].parent();
@@ -118,6 +110,64 @@ QModelIndexList qMRMLSceneModelPrivate::indexes(const QString& nodeID)const
   return nodeIndexes;
 }
 
+//------------------------------------------------------------------------------
+QModelIndex qMRMLSceneModelPrivate::indexFromNodeID(const QString& nodeID)const
+{
+  Q_Q(const qMRMLSceneModel);
+  QHash<QString, QPersistentModelIndex>::iterator cacheIt =
+    this->NodeIndexCache.find(nodeID);
+  if (cacheIt == this->NodeIndexCache.end())
+    {
+    // not found in cache, therefore it cannot be in the model
+    return QModelIndex();
+    }
+  if (cacheIt.value().isValid())
+    {
+    // The item may have been replaced (e.g. drag-and-drop), make sure the
+    // item at the cached index is still the node item.
+    QModelIndex nodeIndex = cacheIt.value();
+    if (q->data(nodeIndex, qMRMLSceneModel::UIDRole).toString() == nodeID)
+      {
+      return nodeIndex;
+      }
+    }
+  // The cache was not up-to-date. Do a slow linear search.
+  // QAbstractItemModel::match doesn't browse through columns, the node is
+  // searched in the first column only (because scene is in the first column)
+  QModelIndexList nodeIndexes = q->match(
+    q->mrmlSceneIndex(), qMRMLSceneModel::UIDRole, nodeID,
+    1, Qt::MatchExactly | Qt::MatchRecursive);
+  Q_ASSERT(nodeIndexes.size() <= 1); // we know for sure it won't be more than 1
+  if (nodeIndexes.size() == 0)
+    {
+    // maybe the node hasn't been added to the scene yet...
+    // (if it's called from populateScene/inserteNode)
+    this->NodeIndexCache.erase(cacheIt);
+    return QModelIndex();
+    }
+  cacheIt.value() = nodeIndexes[0];
+  return nodeIndexes[0];
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneModelPrivate::cacheNodeIndexes(QStandardItem* item)
+{
+  Q_Q(qMRMLSceneModel);
+  if (q->isANode(item))
+    {
+    this->NodeIndexCache[item->data(qMRMLSceneModel::UIDRole).toString()] =
+      item->index();
+    }
+  for (int i = 0; i < item->rowCount(); ++i)
+    {
+    QStandardItem* child = item->child(i, 0);
+    if (child)
+      {
+      this->cacheNodeIndexes(child);
+      }
+    }
+}
+
 //------------------------------------------------------------------------------
 void qMRMLSceneModelPrivate::listenNodeModifiedEvent()
 {
@@ -251,6 +301,102 @@ void qMRMLSceneModelPrivate::reparentItems(
   int max = newParentItem->rowCount() - q->postItems(newParentItem).count();
   int pos = qMin(min + newIndex, max);
   newParentItem->insertRow(pos, children);
+  if (!children.isEmpty())
+    {
+    this->cacheNodeIndexes(children[0]);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneModelPrivate::nodeItems(QStandardItem* parent, QList<QStandardItem*>& items)const
+{
+  Q_Q(const qMRMLSceneModel);
+  for (int i = 0; i < parent->rowCount(); ++i)
+    {
+    QStandardItem* child = parent->child(i, 0);
+    if (!child || !q->isANode(child))
+      {
+      continue;
+      }
+    items << child;
+    this->nodeItems(child, items);
+    }
+}
+
+//------------------------------------------------------------------------------
+void qMRMLSceneModelPrivate::updateSceneItems()
+{
+  Q_Q(qMRMLSceneModel);
+  QStandardItem* sceneItem = q->mrmlSceneItem();
+  Q_ASSERT(sceneItem && this->MRMLScene);
+
+  QList<QStandardItem*> items;
+  this->nodeItems(sceneItem, items);
+  if (items.isEmpty())
+    {
+    // Faster than inserting the nodes one by one
+    q->populateScene();
+    return;
+    }
+
+  // Remove the items of the nodes that are not in the scene anymore.
+  // Items are listed depth first, they are browsed in reverse order so that
+  // the children of a removed item have been processed before it is removed.
+  // Observations of the removed nodes have already been removed in
+  // onMRMLSceneNodeAboutToBeRemoved().
+  QList<QList<QStandardItem*> > orphans;
+  for (int i = items.size() - 1; i >= 0; --i)
+    {
+    QStandardItem* item = items[i];
+    const QString nodeID = item->data(qMRMLSceneModel::UIDRole).toString();
+    vtkMRMLNode* node = this->MRMLScene->GetNodeByID(nodeID.toLatin1());
+    if (node && item->data(qMRMLSceneModel::PointerRole).toLongLong() ==
+                  reinterpret_cast<long long>(node))
+      {
+      continue;
+      }
+    while (item->rowCount())
+      {
+      orphans.push_back(item->takeRow(0));
+      }
+    this->NodeIndexCache.remove(nodeID);
+    item->parent()->removeRow(item->row());
+    }
+
+  // Put the children of the removed items back in the model before adding
+  // items, otherwise they would be inserted again as parents of new nodes.
+  foreach(QList<QStandardItem*> orphan, orphans)
+    {
+    vtkMRMLNode* node = q->mrmlNodeFromItem(orphan[0]);
+    if (!node)
+      {
+      qDeleteAll(orphan);
+      continue;
+      }
+    QStandardItem* newParentItem = q->itemFromNode(q->parentNode(node));
+    if (newParentItem == 0)
+      {
+      newParentItem = sceneItem;
+      }
+    this->reparentItems(orphan, q->nodeIndex(node), newParentItem);
+    }
+
+  // Add the items of the new nodes
+  this->MisplacedNodes.clear();
+  vtkMRMLNode* node = 0;
+  vtkCollectionSimpleIterator it;
+  for (this->MRMLScene->GetNodes()->InitTraversal(it);
+       (node = (vtkMRMLNode*)this->MRMLScene->GetNodes()->GetNextItemAsObject(it)) ;)
+    {
+    if (!this->NodeIndexCache.contains(QString(node->GetID())))
+      {
+      q->insertNode(node);
+      }
+    }
+
+  // Nodes may have been modified, reparented or reordered while the model
+  // was not listening (e.g. batch processing).
+  q->updateNodeItems();
 }
 
 //------------------------------------------------------------------------------
@@ -440,54 +586,13 @@ QModelIndex qMRMLSceneModel::indexFromNode(vtkMRMLNode* node, int column)const
     return QModelIndex();
     }
 
-  QModelIndex nodeIndex;
-
-  // Try to find the nodeIndex in the cache first
-  QMap<vtkMRMLNode*,QPersistentModelIndex>::iterator rowCacheIt=d->RowCache.find(node);
-  if (rowCacheIt==d->RowCache.end())
-    {
-    // not found in cache, therefore it cannot be in the model
-    return nodeIndex;
-    }
-  if (rowCacheIt.value().isValid())
-    {
-    // An entry found in the cache. If the item at the cached index matches the requested node ID
-    // then we use it.
-    QStandardItem* nodeItem = this->itemFromIndex(rowCacheIt.value());
-    if (nodeItem!=NULL)
-      {
-      if (nodeItem->data(qMRMLSceneModel::UIDRole).toString().compare(QLatin1String(node->GetID()))==0)
-        {
-        // id matched
-        nodeIndex=rowCacheIt.value();
-        }
-      }
-    }
-
-  // The cache was not up-to-date. Do a slow linear search.
+  QModelIndex nodeIndex = d->indexFromNodeID(QString(node->GetID()));
   if (!nodeIndex.isValid())
     {
-    // QAbstractItemModel::match doesn't browse through columns
-    // we need to do it manually
-    QModelIndexList nodeIndexes = this->match(
-      this->mrmlSceneIndex(), qMRMLSceneModel::UIDRole, QString(node->GetID()),
-      1, Qt::MatchExactly | Qt::MatchRecursive);
-    Q_ASSERT(nodeIndexes.size() <= 1); // we know for sure it won't be more than 1
-    if (nodeIndexes.size() == 0)
-      {
-      // maybe the node hasn't been added to the scene yet...
-      // (if it's called from populateScene/inserteNode)
-      d->RowCache.remove(node);
-      return QModelIndex();
-      }
-    nodeIndex=nodeIndexes[0];
-    d->RowCache[node]=nodeIndex;
+    return nodeIndex;
     }
   if (column == 0)
     {
-    // QAbstractItemModel::match only search through the first column
-    // (because scene is in the first column)
-    Q_ASSERT(nodeIndex.isValid());
     return nodeIndex;
     }
   // Add the QModelIndexes from the other columns
@@ -690,6 +795,17 @@ void qMRMLSceneModel::updateScene()
 {
   Q_D(qMRMLSceneModel);
 
+  // If the items already represent the nodes of the scene, only the items
+  // of the nodes removed and added since then are updated.
+  QStandardItem* currentSceneItem = this->mrmlSceneItem();
+  if (d->MRMLScene && currentSceneItem &&
+      currentSceneItem->data(qMRMLSceneModel::PointerRole) ==
+        QVariant::fromValue(reinterpret_cast<long long>(d->MRMLScene)))
+    {
+    d->updateSceneItems();
+    return;
+    }
+
   // Stop listening to all the nodes before we remove them (setRowCount) as some
   // weird behavior could arise when removing the nodes (e.g onMRMLNodeModified
   // could be called ...)
@@ -698,7 +814,7 @@ void qMRMLSceneModel::updateScene()
   qvtkDisconnect(0, vtkMRMLNode::IDChangedEvent,
                  this, SLOT(onMRMLNodeIDChanged(vtkObject*,void*)));
 
-  d->RowCache.clear();
+  d->NodeIndexCache.clear();
 
   // Enabled so it can be interacted with
   this->invisibleRootItem()->setFlags(Qt::ItemIsEnabled);
@@ -841,10 +957,11 @@ QStandardItem* qMRMLSceneModel::insertNode(vtkMRMLNode* node, QStandardItem* par
 
   // Insert an invalid item in the cache to indicate that the node is in the model
   // but we don't know its index yet. This is needed because a custom widget may be notified
-  // abot row insertion before insertRow() returns (and the RowCache entry is added).
+  // abot row insertion before insertRow() returns (and the cache entry is added).
   // For example, qSlicerPresetComboBox::setIconToPreset() is called at the end of insertRow,
-  // before the RowCache entry is added.
-  d->RowCache[node]=QModelIndex();
+  // before the cache entry is added.
+  const QString nodeID = QString(node->GetID());
+  d->NodeIndexCache[nodeID] = QModelIndex();
 
   if (parent)
     {
@@ -855,7 +972,7 @@ QStandardItem* qMRMLSceneModel::insertNode(vtkMRMLNode* node, QStandardItem* par
     {
     this->insertRow(row,items);
     }
-  d->RowCache[node]=items[0]->index();
+  d->NodeIndexCache[nodeID] = items[0]->index();
   // TODO: don't listen to nodes that are hidden from editors ?
   if (d->ListenNodeModifiedEvent == AllNodes)
     {
@@ -1236,6 +1353,9 @@ void qMRMLSceneModel::onMRMLSceneNodeAboutToBeRemoved(vtkMRMLScene* scene, vtkMR
 
   if (d->MRMLScene->IsClosing() || (d->LazyUpdate && d->MRMLScene->IsBatchProcessing()))
     {
+    // The item is removed by updateScene(). Stop observing the node now as
+    // it may be deleted by then.
+    qvtkDisconnect(node, vtkCommand::NoEvent, this, 0);
     return;
     }
 
@@ -1254,13 +1374,11 @@ void qMRMLSceneModel::onMRMLSceneNodeAboutToBeRemoved(vtkMRMLScene* scene, vtkMR
   // Remove all the observations on the node
   qvtkDisconnect(node, vtkCommand::NoEvent, this, 0);
 
-  // TODO: can be fasten by browsing the tree only once
-  QModelIndexList indexes = this->match(this->mrmlSceneIndex(), qMRMLSceneModel::UIDRole,
-                                        QString(node->GetID()), 1,
-                                        Qt::MatchExactly | Qt::MatchRecursive);
-  if (indexes.count())
+  QModelIndex nodeIndex = this->indexFromNode(node);
+  d->NodeIndexCache.remove(QString(node->GetID()));
+  if (nodeIndex.isValid())
     {
-    QStandardItem* item = this->itemFromIndex(indexes[0].sibling(indexes[0].row(),0));
+    QStandardItem* item = this->itemFromIndex(nodeIndex);
     // The children may be lost if not reparented, we ensure they got reparented.
     while (item->rowCount())
       {
@@ -1277,7 +1395,7 @@ void qMRMLSceneModel::onMRMLSceneNodeAboutToBeRemoved(vtkMRMLScene* scene, vtkMR
         d->Orphans.removeAll(orphans);
         }
       }
-    this->removeRow(indexes[0].row(), indexes[0].parent());
+    this->removeRow(nodeIndex.row(), nodeIndex.parent());
     }
 }
 
@@ -1405,6 +1523,12 @@ void qMRMLSceneModel::updateNodeItems(vtkMRMLNode* node, const QString& nodeUID)
   //Q_ASSERT(node->GetScene()->IsNodePresent(node));
   QModelIndexList nodeIndexes = d->indexes(nodeUID);
   //qDebug() << "onMRMLNodeModified" << node->GetID() << nodeIndexes;
+  const QString nodeID = QString(node->GetID());
+  if (nodeUID != nodeID && d->NodeIndexCache.contains(nodeUID))
+    {
+    // The node ID has changed, the item UIDRole is updated below.
+    d->NodeIndexCache[nodeID] = d->NodeIndexCache.take(nodeUID);
+    }
   Q_ASSERT(nodeIndexes.count());
   for (int i = 0; i < nodeIndexes.size(); ++i)
     {
@@ -263,6 +263,10 @@ signals:
 protected:
   qMRMLSceneModel(qMRMLSceneModelPrivate* pimpl, QObject *parent=0);
 
+  /// Synchronize the items with the scene nodes. If the model already
+  /// represents the scene (e.g. at the end of a batch process), only the
+  /// items of removed and added nodes are removed and inserted, otherwise
+  /// all the items are rebuilt.
   virtual void updateScene();
   virtual void populateScene();
   virtual QStandardItem* insertNode(vtkMRMLNode* node);
@@ -35,7 +35,7 @@
 // Qt includes
 class QStandardItemModel;
 #include <QFlags>
-#include <QMap>
+#include <QHash>
 
 // qMRML includes
 #include "qMRMLSceneModel.h"
@@ -61,6 +61,13 @@ public:
   void init();
 
   QModelIndexList indexes(const QString& nodeID)const;
+  /// Return the index of the first column item of the node \a nodeID.
+  /// The lookup is done in NodeIndexCache.
+  QModelIndex indexFromNodeID(const QString& nodeID)const;
+  /// Update NodeIndexCache with the index of \a item and its children.
+  /// Must be called after items are moved (e.g. with takeRow/insertRow) as
+  /// the persistent indexes of the moved items are invalidated.
+  void cacheNodeIndexes(QStandardItem* item);
 
   QStringList extraItems(QStandardItem* parent, const QString& extraType)const;
   void insertExtraItem(int row, QStandardItem* parent,
@@ -77,6 +84,15 @@ public:
   /// qMRMLSceneModel::nodeIndex(vtkMRMLNode*).
   QStandardItem* insertNode(vtkMRMLNode* node, int index);
 
+  /// Append to \a items the node items under \a parent, depth first.
+  void nodeItems(QStandardItem* parent, QList<QStandardItem*>& items)const;
+
+  /// Called by qMRMLSceneModel::updateScene() when the model already
+  /// contains the items of the scene: remove the items of the nodes that
+  /// are not in the scene anymore, add the items of the new nodes and
+  /// update the others, instead of rebuilding all the items.
+  void updateSceneItems();
+
   vtkSmartPointer<vtkCallbackCommand> CallBack;
   qMRMLSceneModel::NodeTypes ListenNodeModifiedEvent;
   bool LazyUpdate;
@@ -101,12 +117,13 @@ public:
   // likely to be unreachable when browsing the model
   QList<QList<QStandardItem*> > Orphans;
 
-  // Map from MRML node to row.
-  // It just stores the result of the latest lookup by indexFromNode,
-  // not guaranteed to contain up-to-date information, should be just used
-  // as a search hint. If the node cannot be found at the given index then
-  // we need to browse through all model items.
-  mutable QMap<vtkMRMLNode*,QPersistentModelIndex> RowCache;
+  // Map from MRML node ID to the index of the node item in the first column.
+  // Entries are added when the node item is inserted and removed when the
+  // node is removed, a node that has no entry is therefore not in the model.
+  // An entry may be invalid if its item has been moved in a way the model is
+  // not aware of (e.g. drag-and-drop), the index is then looked up by
+  // browsing through all model items and the entry is updated.
+  mutable QHash<QString, QPersistentModelIndex> NodeIndexCache;
 };
 
 #endif
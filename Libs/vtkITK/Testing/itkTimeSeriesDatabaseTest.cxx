@@ -0,0 +1,141 @@
+#include "itkTimeSeriesDatabase.h"
+
+// ITK includes
+#include <itkConfigure.h>
+#include <itkFactoryRegistration.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+
+// STD includes
+#include <sstream>
+
+typedef short                                   PixelType;
+typedef itk::TimeSeriesDatabase<PixelType>      DatabaseType;
+typedef DatabaseType::OutputImageType           ImageType;
+
+// Image size that is not a multiple of the block size
+const unsigned int ImageSize[3] = { 20, 18, 17 };
+const unsigned int NumberOfVolumes = 3;
+
+PixelType ExpectedValue(const ImageType::IndexType& index, unsigned int volume)
+{
+  return static_cast<PixelType>(index[0] + 20 * index[1] + 400 * index[2] - 10000 * volume);
+}
+
+int main(int argc, char *argv[])
+{
+  itk::itkFactoryRegistration();
+
+  if (argc < 2)
+    {
+    std::cout << "ERROR: need to specify a temporary directory on the command line." << std::endl;
+    return 1;
+    }
+  std::string directory = argv[1];
+
+  // Write a series of volumes
+  std::string archetype;
+  for (unsigned int volume = 0; volume < NumberOfVolumes; volume++)
+    {
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    ImageType::SizeType size = {{ ImageSize[0], ImageSize[1], ImageSize[2] }};
+    region.SetSize(size);
+    image->SetRegions(region);
+    image->Allocate();
+    itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      it.Set(ExpectedValue(it.GetIndex(), volume));
+      }
+    std::ostringstream fileName;
+    fileName << directory << "/itkTimeSeriesDatabaseTest_" << volume + 1 << ".nrrd";
+    typedef itk::ImageFileWriter<ImageType> WriterType;
+    WriterType::Pointer writer = WriterType::New();
+    writer->SetFileName(fileName.str());
+    writer->SetInput(image);
+    try
+      {
+      writer->Update();
+      }
+    catch (itk::ExceptionObject& err)
+      {
+      std::cout << "Unable to write file '" << fileName.str() << "', err = \n" << err << std::endl;
+      return 1;
+      }
+    if (volume == 0)
+      {
+      archetype = fileName.str();
+      }
+    }
+
+  // Store 8 blocks per file, each volume spans several files
+  std::string databaseFileName = directory + "/itkTimeSeriesDatabaseTest.tsd";
+  unsigned long fileSize = 8 * TimeSeriesVolumeBlockSize * sizeof(PixelType);
+  DatabaseType::Pointer database = DatabaseType::New();
+  try
+    {
+    DatabaseType::CreateFromFileArchetype(databaseFileName.c_str(), archetype.c_str(), fileSize);
+    database->Connect(databaseFileName.c_str());
+    }
+  catch (itk::ExceptionObject& err)
+    {
+    std::cout << "Unable to create database '" << databaseFileName << "', err = \n" << err << std::endl;
+    return 1;
+    }
+  if (database->GetNumberOfVolumes() != static_cast<int>(NumberOfVolumes)
+    || database->GetOutputRegion().GetSize()[0] != ImageSize[0]
+    || database->GetOutputRegion().GetSize()[1] != ImageSize[1]
+    || database->GetOutputRegion().GetSize()[2] != ImageSize[2])
+    {
+    std::cout << "ERROR: unexpected database size " << database->GetOutputRegion().GetSize()
+              << " with " << database->GetNumberOfVolumes() << " volumes" << std::endl;
+    return 1;
+    }
+
+  // Read the volumes forward, then backward: prefetched blocks are found in the cache
+  const unsigned int volumes[5] = { 0, 1, 2, 1, 0 };
+  for (int i = 0; i < 5; i++)
+    {
+    database->SetCurrentImage(volumes[i]);
+    database->Modified();
+    database->Update();
+    itk::ImageRegionIteratorWithIndex<ImageType> it(database->GetOutput(), database->GetOutputRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+      if (it.Get() != ExpectedValue(it.GetIndex(), volumes[i]))
+        {
+        std::cout << "ERROR: value " << it.Get() << " at " << it.GetIndex() << " of volume " << volumes[i]
+                  << ", expected " << ExpectedValue(it.GetIndex(), volumes[i]) << std::endl;
+        return 1;
+        }
+      }
+    }
+  if (database->GetPrefetchedBlocks() == 0 || database->GetCacheHits() == 0)
+    {
+    std::cout << "ERROR: no block was prefetched or found in the cache" << std::endl;
+    return 1;
+    }
+
+  // Time series of a voxel in a partial block
+  ImageType::IndexType index = {{ 19, 17, 16 }};
+  DatabaseType::ArrayType timeSeries;
+  database->GetVoxelTimeSeries(index, timeSeries);
+  if (timeSeries.GetSize() != NumberOfVolumes)
+    {
+    std::cout << "ERROR: time series has " << timeSeries.GetSize() << " values" << std::endl;
+    return 1;
+    }
+  for (unsigned int volume = 0; volume < NumberOfVolumes; volume++)
+    {
+    if (timeSeries[volume] != ExpectedValue(index, volume))
+      {
+      std::cout << "ERROR: time series value " << timeSeries[volume] << " of volume " << volume
+                << ", expected " << ExpectedValue(index, volume) << std::endl;
+      return 1;
+      }
+    }
+
+  database->Disconnect();
+  return 0;
+}
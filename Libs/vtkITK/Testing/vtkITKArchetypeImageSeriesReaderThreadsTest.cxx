@@ -0,0 +1,144 @@
+
+// vtkITK includes
+#include <vtkITKArchetypeImageSeriesScalarReader.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// ITK includes
+#include <itkConfigure.h>
+#include <itkFactoryRegistration.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// Read the series of the archetype with the given number of threads.
+bool ReadSeries(vtkITKArchetypeImageSeriesScalarReader* reader,
+                const char* archetype, int numberOfThreads)
+{
+  reader->SetArchetype(archetype);
+  reader->SetOutputScalarTypeToNative();
+  reader->SetDesiredCoordinateOrientationToNative();
+  reader->SetNumberOfThreads(numberOfThreads);
+  try
+    {
+    reader->Update();
+    }
+  catch (itk::ExceptionObject err)
+    {
+    std::cout << "Unable to read file '" << archetype << "', err = \n" << err << std::endl;
+    return false;
+    }
+  return reader->GetOutput() != 0;
+}
+
+//----------------------------------------------------------------------------
+// Check that the headers are analyzed and the slices are read the same way
+// by both readers.
+bool CompareReaders(vtkITKArchetypeImageSeriesScalarReader* serialReader,
+                    vtkITKArchetypeImageSeriesScalarReader* reader)
+{
+  if (serialReader->GetNumberOfFileNames() != reader->GetNumberOfFileNames()
+    || serialReader->GetNumberOfFileNames() < 2)
+    {
+    std::cout << "ERROR: " << reader->GetNumberOfFileNames() << " files read instead of "
+              << serialReader->GetNumberOfFileNames() << std::endl;
+    return false;
+    }
+  for (unsigned int i = 0; i < serialReader->GetNumberOfFileNames(); ++i)
+    {
+    if (serialReader->GetFileNames()[i] != reader->GetFileNames()[i])
+      {
+      std::cout << "ERROR: file " << i << " is " << reader->GetFileNames()[i]
+                << " instead of " << serialReader->GetFileNames()[i] << std::endl;
+      return false;
+      }
+    }
+  if (serialReader->GetNumberOfSeriesInstanceUIDs() != reader->GetNumberOfSeriesInstanceUIDs()
+    || serialReader->GetNumberOfSliceLocation() != reader->GetNumberOfSliceLocation()
+    || serialReader->GetNumberOfImagePositionPatient() != reader->GetNumberOfImagePositionPatient())
+    {
+    std::cout << "ERROR: series grouping differs: "
+              << reader->GetNumberOfSeriesInstanceUIDs() << " series, "
+              << reader->GetNumberOfSliceLocation() << " slice locations and "
+              << reader->GetNumberOfImagePositionPatient() << " positions instead of "
+              << serialReader->GetNumberOfSeriesInstanceUIDs() << ", "
+              << serialReader->GetNumberOfSliceLocation() << " and "
+              << serialReader->GetNumberOfImagePositionPatient() << std::endl;
+    return false;
+    }
+  for (unsigned int i = 0; i < serialReader->GetNumberOfSeriesInstanceUIDs(); ++i)
+    {
+    if (strcmp(serialReader->GetNthSeriesInstanceUID(i), reader->GetNthSeriesInstanceUID(i)) != 0)
+      {
+      std::cout << "ERROR: series " << i << " is " << reader->GetNthSeriesInstanceUID(i)
+                << " instead of " << serialReader->GetNthSeriesInstanceUID(i) << std::endl;
+      return false;
+      }
+    }
+  for (unsigned int i = 0; i < serialReader->GetNumberOfSliceLocation(); ++i)
+    {
+    if (serialReader->GetNthSliceLocation(i) != reader->GetNthSliceLocation(i))
+      {
+      std::cout << "ERROR: slice location " << i << " is " << reader->GetNthSliceLocation(i)
+                << " instead of " << serialReader->GetNthSliceLocation(i) << std::endl;
+      return false;
+      }
+    }
+
+  vtkDataArray* serialScalars = serialReader->GetOutput()->GetPointData()->GetScalars();
+  vtkDataArray* scalars = reader->GetOutput()->GetPointData()->GetScalars();
+  if (!serialScalars || !scalars
+    || serialScalars->GetDataType() != scalars->GetDataType()
+    || serialScalars->GetNumberOfTuples() != scalars->GetNumberOfTuples()
+    || memcmp(serialScalars->GetVoidPointer(0), scalars->GetVoidPointer(0),
+              serialScalars->GetNumberOfTuples() * serialScalars->GetDataTypeSize()) != 0)
+    {
+    std::cout << "ERROR: voxels differ" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  itk::itkFactoryRegistration();
+
+  if (argc < 2)
+    {
+    std::cout << "ERROR: need to specify a file of a series on the command line." << std::endl;
+    return 1;
+    }
+
+  vtkNew<vtkITKArchetypeImageSeriesScalarReader> serialReader;
+  if (!ReadSeries(serialReader.GetPointer(), argv[1], 1))
+    {
+    return 1;
+    }
+
+  // More threads than files
+  vtkNew<vtkITKArchetypeImageSeriesScalarReader> reader;
+  if (!ReadSeries(reader.GetPointer(), argv[1], serialReader->GetNumberOfFileNames() + 3)
+    || !CompareReaders(serialReader.GetPointer(), reader.GetPointer()))
+    {
+    return 1;
+    }
+
+  // The multithreader runs fewer threads than requested
+  int globalMaximumNumberOfThreads = vtkMultiThreader::GetGlobalMaximumNumberOfThreads();
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(2);
+  vtkNew<vtkITKArchetypeImageSeriesScalarReader> clampedReader;
+  bool read = ReadSeries(clampedReader.GetPointer(), argv[1], 8);
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(globalMaximumNumberOfThreads);
+  if (!read || !CompareReaders(serialReader.GetPointer(), clampedReader.GetPointer()))
+    {
+    return 1;
+    }
+
+  return 0;
+}
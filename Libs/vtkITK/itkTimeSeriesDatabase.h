@@ -95,12 +95,37 @@ public:
   void GetVoxelTimeSeries ( typename OutputImageType::IndexType idx, ArrayType& array );
 
   /** Set the size of the cache in MiB (1 MiB = 2^20 bytes)
+   * The database files are memory mapped and their pages are kept by the
+   * operating system. The cache records the most recently accessed or
+   * prefetched blocks, used to compute the cache statistics.
    */
   void SetCacheSizeInMiB ( float sz );
   /** Get the size of the cache in MiB (1 MiB = 2^20 bytes)
    */
   float GetCacheSizeInMiB ();
 
+  /** Number of images following the current image along the playback
+   * direction whose requested region is prefetched by GenerateData.
+   * The blocks are read asynchronously by the operating system.  Default is 2.
+   */
+  itkSetMacro ( PrefetchTimeSteps, unsigned int );
+  itkGetMacro ( PrefetchTimeSteps, unsigned int );
+
+  /** Ask the operating system to read asynchronously the blocks of a region
+   * of an image, for example the slice plane being viewed in the following
+   * images.
+   */
+  void Prefetch ( const typename OutputImageType::RegionType& region, unsigned int image );
+
+  /** Cache statistics
+   * A block access is a hit if the block is one of the most recently
+   * accessed or prefetched blocks, a miss otherwise.
+   */
+  itkGetMacro ( CacheHits, unsigned long );
+  itkGetMacro ( CacheMisses, unsigned long );
+  itkGetMacro ( PrefetchedBlocks, unsigned long );
+  void ResetCacheStatistics();
+
 
 protected:
   TimeSeriesDatabase();
@@ -115,9 +140,7 @@ protected:
   typename OutputImageType::PointType     m_OutputOrigin;
   typename OutputImageType::DirectionType m_OutputDirection;
 
-  typedef itk::TimeSeriesDatabaseHelper::counted_ptr<std::fstream> StreamPtr;
-
-  static std::streampos CalculatePosition ( unsigned long index, unsigned long BlocksPerFile );
+  typedef itk::TimeSeriesDatabaseHelper::counted_ptr<itk::TimeSeriesDatabaseHelper::MappedFile> MappedFilePtr;
 
   unsigned int CalculateFileIndex ( unsigned long Index );
   static unsigned int CalculateFileIndex ( unsigned long Index, unsigned long BlocksPerFile );
@@ -136,17 +159,22 @@ protected:
   std::string  m_Filename;
   unsigned int m_CurrentImage;
 
-  std::vector<StreamPtr>   m_DatabaseFiles;
-  std::vector<std::string> m_DatabaseFileNames;
-  unsigned long            m_BlocksPerFile;
-
-  /// our cache
-  struct CacheBlock
-  {
-    TPixel data[TimeSeriesBlockSize*TimeSeriesBlockSize*TimeSeriesBlockSize];
-  };
-  TimeSeriesDatabaseHelper::LRUCache<unsigned long, CacheBlock> m_Cache;
-  CacheBlock* GetCacheBlock ( unsigned long index );
+  std::vector<MappedFilePtr> m_DatabaseFiles;
+  std::vector<std::string>   m_DatabaseFileNames;
+  unsigned long              m_BlocksPerFile;
+
+  /// Most recently accessed or prefetched blocks, pointing into the mapped files.
+  TimeSeriesDatabaseHelper::LRUCache<unsigned long, const TPixel*> m_Cache;
+  /// Return the block at index, in place in the mapped file.
+  const TPixel* GetBlock ( unsigned long index );
+  const TPixel* GetMappedBlock ( unsigned long index );
+  void PrefetchBlock ( unsigned long index );
+
+  unsigned int  m_PrefetchTimeSteps;
+  unsigned int  m_PreviousImage;
+  unsigned long m_CacheHits;
+  unsigned long m_CacheMisses;
+  unsigned long m_PrefetchedBlocks;
 };
 
 } // end namespace itk
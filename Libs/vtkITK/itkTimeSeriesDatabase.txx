@@ -54,7 +54,7 @@ template <class TPixel>
 bool TimeSeriesDatabase<TPixel>::IsOpen () const
 {
   if ( this->m_DatabaseFiles.size() == 0 ) { return false; }
-  return const_cast<std::fstream*>(this->m_DatabaseFiles[0].get())->is_open();
+  return this->m_DatabaseFiles[0]->is_open();
 }
 
 template <class TPixel>
@@ -66,6 +66,8 @@ void TimeSeriesDatabase<TPixel>::Disconnect ()
     }
   this->m_DatabaseFiles.clear();
   this->m_DatabaseFileNames.clear();
+  // Cached blocks point into the unmapped files
+  this->m_Cache.clear();
 }
 
 template <class TPixel>
@@ -129,8 +131,16 @@ void TimeSeriesDatabase<TPixel>::Connect ( const char* filename )
     o >> Filename;
     // std::cout << "Reading file " << idx << " " << Filename << std::endl;
     this->m_DatabaseFileNames.push_back ( Filename );
-    this->m_DatabaseFiles.push_back ( StreamPtr ( new std::fstream ( Filename.c_str(), ::std::ios::in | ::std::ios::binary ) ) );
+    MappedFilePtr file ( new TimeSeriesDatabaseHelper::MappedFile() );
+    if ( !file->open ( Filename.c_str() ) )
+      {
+      this->Disconnect();
+      itkExceptionMacro ( "TimeSeriesDatabase::Connect: Failed to map " << Filename );
+      }
+    this->m_DatabaseFiles.push_back ( file );
     }
+  this->m_Cache.clear();
+  this->m_PreviousImage = this->m_CurrentImage;
   /*
   std::cout << "ImageSize: " << m_OutputRegion.GetSize() << endl;
   std::cout << "ImageOrigin: " << m_OutputOrigin << endl;
@@ -176,28 +186,85 @@ unsigned long TimeSeriesDatabase<TPixel>::CalculateIndex ( Size<3> p, int ImageP
 }
 
 template <class TPixel>
-::std::streampos TimeSeriesDatabase<TPixel>::CalculatePosition ( unsigned long index, unsigned long BlocksPerFile )
+const TPixel* TimeSeriesDatabase<TPixel>::GetMappedBlock ( unsigned long index )
 {
-  ::std::streampos position = ( index % BlocksPerFile ) * sizeof ( TPixel ) * TimeSeriesVolumeBlockSize;
-  return position;
+  unsigned int FileIdx = this->CalculateFileIndex ( index );
+  size_t position = ( index % this->m_BlocksPerFile ) * sizeof ( TPixel ) * TimeSeriesVolumeBlockSize;
+  if ( FileIdx >= this->m_DatabaseFiles.size()
+       || position + TimeSeriesVolumeBlockSize * sizeof ( TPixel ) > this->m_DatabaseFiles[FileIdx]->size() )
+    {
+    itkExceptionMacro ( "TimeSeriesDatabase::GetMappedBlock: block " << index << " is not in the database files" );
+    }
+  return reinterpret_cast<const TPixel*> ( this->m_DatabaseFiles[FileIdx]->data() + position );
 }
 
+template <class TPixel>
+const TPixel* TimeSeriesDatabase<TPixel>::GetBlock ( unsigned long index )
+{
+  const TPixel** Buffer = this->m_Cache.find ( index );
+  if ( Buffer )
+    {
+    this->m_CacheHits++;
+    return *Buffer;
+    }
+  this->m_CacheMisses++;
+  const TPixel* block = this->GetMappedBlock ( index );
+  this->m_Cache.insert ( index, block );
+  return block;
+}
 
 template <class TPixel>
-typename TimeSeriesDatabase<TPixel>::CacheBlock* TimeSeriesDatabase<TPixel>::GetCacheBlock ( unsigned long index )
+void TimeSeriesDatabase<TPixel>::PrefetchBlock ( unsigned long index )
 {
-  CacheBlock* Buffer = this->m_Cache.find ( index );
-  if ( Buffer == 0 ) {
-    // Fill it in
-    CacheBlock B;
-    int FileIdx = this->CalculateFileIndex ( index );
-
-    this->m_DatabaseFiles[FileIdx]->seekg ( this->CalculatePosition ( index, this->m_BlocksPerFile ) );
-    this->m_DatabaseFiles[FileIdx]->read ( reinterpret_cast<char*> ( B.data ), TimeSeriesVolumeBlockSize * sizeof ( TPixel ) );
-    this->m_Cache.insert ( index, B );
-    Buffer = this->m_Cache.find ( index );
-  }
-  return Buffer;
+  if ( this->m_Cache.find ( index ) )
+    {
+    return;
+    }
+  const TPixel* block = this->GetMappedBlock ( index );
+  unsigned int FileIdx = this->CalculateFileIndex ( index );
+  this->m_DatabaseFiles[FileIdx]->will_need ( reinterpret_cast<const char*> ( block ) - this->m_DatabaseFiles[FileIdx]->data(),
+                                             TimeSeriesVolumeBlockSize * sizeof ( TPixel ) );
+  this->m_Cache.insert ( index, block );
+  this->m_PrefetchedBlocks++;
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::Prefetch ( const typename OutputImageType::RegionType& region, unsigned int image )
+{
+  if ( !this->IsOpen() || image >= this->m_Dimensions[3] )
+    {
+    return;
+    }
+  typename OutputImageType::RegionType Region = region;
+  if ( !Region.Crop ( this->m_OutputRegion ) )
+    {
+    return;
+    }
+  Size<3> BlockStart, BlockEnd;
+  for ( unsigned int i = 0; i < 3; i++ )
+    {
+    BlockStart[i] = Region.GetIndex(i) / TimeSeriesBlockSize;
+    BlockEnd[i] = ( Region.GetIndex(i) + Region.GetSize(i) - 1 ) / TimeSeriesBlockSize;
+    }
+  Size<3> CurrentBlock;
+  for ( CurrentBlock[2] = BlockStart[2]; CurrentBlock[2] <= BlockEnd[2]; CurrentBlock[2]++ )
+    {
+    for ( CurrentBlock[1] = BlockStart[1]; CurrentBlock[1] <= BlockEnd[1]; CurrentBlock[1]++ )
+      {
+      for ( CurrentBlock[0] = BlockStart[0]; CurrentBlock[0] <= BlockEnd[0]; CurrentBlock[0]++ )
+        {
+        this->PrefetchBlock ( this->CalculateIndex ( CurrentBlock, image ) );
+        }
+      }
+    }
+}
+
+template <class TPixel>
+void TimeSeriesDatabase<TPixel>::ResetCacheStatistics()
+{
+  this->m_CacheHits = 0;
+  this->m_CacheMisses = 0;
+  this->m_PrefetchedBlocks = 0;
 }
 
 
@@ -208,18 +275,22 @@ void TimeSeriesDatabase<TPixel>::GetVoxelTimeSeries ( typename OutputImageType::
   // and figure out which cache block we need
   Size<3> CurrentBlock;
   Size<3> Offset;
+  if ( !this->IsOpen() )
+  {
+    itkExceptionMacro ( "TimeSeriesDatabase::GetVoxelTimeSeries: not open for reading" );
+  }
   for ( int i = 0; i < 3; i++ ) {
-    if ( idx[i] < 0 || idx[i] > this->m_OutputRegion.Size[i] ) {
-      throw 1;
+    if ( idx[i] < 0 || idx[i] >= static_cast<IndexValueType> ( this->m_OutputRegion.GetSize(i) ) ) {
+      itkExceptionMacro ( "TimeSeriesDatabase::GetVoxelTimeSeries: index " << idx << " is outside of the volume" );
     }
-    CurrentBlock[i] = reinterpret_cast<unsigned long> ( idx[i] / (double)TimeSeriesBlockSize );
+    CurrentBlock[i] = idx[i] / TimeSeriesBlockSize;
     Offset[i] = idx[i] % TimeSeriesBlockSize;
   }
   unsigned long offset = Offset[0] + Offset[1] * TimeSeriesBlockSize + Offset[2] * TimeSeriesBlockSizeP2;
   array = ArrayType ( this->m_Dimensions[3] );
-  for ( int volume = 0; volume < this->m_Dimensions[3]; volume++ ) {
-    CacheBlock* cache = this->GetCacheBlock ( CurrentBlock, volume );
-    array[volume] = cache->data[offset];
+  for ( unsigned int volume = 0; volume < this->m_Dimensions[3]; volume++ ) {
+    const TPixel* block = this->GetBlock ( this->CalculateIndex ( CurrentBlock, volume ) );
+    array[volume] = block[offset];
   }
 }
 
@@ -275,7 +346,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
         typename OutputImageType::RegionType BR, IR;
         if ( print ) {  std::cout << "For Block Index: " << CurrentBlock << std::endl; }
         unsigned long index = this->CalculateIndex ( CurrentBlock, this->m_CurrentImage );
-        CacheBlock* Buffer = this->GetCacheBlock ( index );
+        const TPixel* Buffer = this->GetBlock ( index );
         if ( this->CalculateIntersection ( CurrentBlock, Region, BR, IR ) ) {
           // Just iterate over whole block
           // Good we can use an iterator!
@@ -290,7 +361,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
           BlockRegion.SetIndex ( BlockIndex );
           ImageRegionIterator<OutputImageType> it ( output, IR );
           it.GoToBegin();
-          TPixel* ptr = Buffer->data;
+          const TPixel* ptr = Buffer;
           while ( !it.IsAtEnd() ) {
             it.Set ( *ptr );
             ++it;
@@ -305,7 +376,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
             std::cout << "Count: " << Count << std::endl;
             std::cout << "Block Region: " << BR;
             std::cout << "Image Region: " << IR;
-            std::cout << "First voxel: " << Buffer->data[0] << std::endl;
+            std::cout << "First voxel: " << Buffer[0] << std::endl;
           }
           unsigned int bx, by, bz, x, y, z;
           for ( z = 0; z < Count[2]; z++ ) {
@@ -325,7 +396,7 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
                 }
                 */
 
-                output->SetPixel ( ImageIndex, Buffer->data[bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz] );
+                output->SetPixel ( ImageIndex, Buffer[bx + TimeSeriesBlockSize*by + TimeSeriesBlockSize*TimeSeriesBlockSize*bz] );
                 }
               }
             }
@@ -334,6 +405,19 @@ void TimeSeriesDatabase<TPixel>::GenerateData()
       }
     }
 
+  // Prefetch the requested region of the next images along the playback
+  // direction, while the current image is processed.
+  long direction = this->m_CurrentImage < this->m_PreviousImage ? -1 : 1;
+  for ( unsigned int step = 1; step <= this->m_PrefetchTimeSteps; step++ )
+    {
+    long image = static_cast<long> ( this->m_CurrentImage ) + direction * static_cast<long> ( step );
+    if ( image < 0 || image >= static_cast<long> ( this->m_Dimensions[3] ) )
+      {
+      break;
+      }
+    this->Prefetch ( Region, static_cast<unsigned int> ( image ) );
+    }
+  this->m_PreviousImage = this->m_CurrentImage;
   return;
 }
 
@@ -391,6 +475,7 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
 
 
   // Make our array, and open it
+  typedef itk::TimeSeriesDatabaseHelper::counted_ptr<std::fstream> StreamPtr;
   std::vector<StreamPtr> db;
   db.push_back ( StreamPtr ( new std::fstream ( TSDFilename, ::std::ios::out | ::std::ios::binary ) ) );
 
@@ -500,10 +585,10 @@ void TimeSeriesDatabase<TPixel>::CreateFromFileArchetype ( const char* TSDFilena
                 }
               }
             }
-          // Calculate where to write...  This code is copied from CalculatePosition and CalculateIndex
+          // Calculate where to write, as GetMappedBlock does when reading
           unsigned long index = CalculateIndex ( CurrentBlock, i, m_BlocksPerImage );
           // Adjust the position, based on the FileIndex
-          ::std::streampos position = CalculatePosition ( index, BlocksPerFile );
+          ::std::streampos position = ( index % BlocksPerFile ) * sizeof ( TPixel ) * TimeSeriesVolumeBlockSize;
           unsigned long FileIndex = CalculateFileIndex ( index, BlocksPerFile );
           // std::cout << "Found FileIndex : " << FileIndex << " For index: " << index << " position: " << position << std::endl;
 
@@ -569,14 +654,22 @@ void TimeSeriesDatabase<TPixel>::SetCacheSizeInMiB ( float sz )
 {
   // How many blocks is this?
   double BlockSizeInMiB = sizeof ( TPixel ) * TimeSeriesVolumeBlockSize / ( 1024*1024.);
-  unsigned long int blocks = (unsigned long int) ceil ( sz * BlockSizeInMiB );
+  unsigned long int blocks = (unsigned long int) ceil ( sz / BlockSizeInMiB );
   this->m_Cache.set_maxsize ( blocks );
 }
 
 template <class TPixel>
 TimeSeriesDatabase<TPixel>::TimeSeriesDatabase () : m_Cache ( 1024 ){
   this->m_Dimensions.SetSize ( 4 );
+  this->m_Dimensions.Fill ( 0 );
   this->m_BlocksPerImage.SetSize ( 4 );
+  this->m_CurrentImage = 0;
+  this->m_PreviousImage = 0;
+  this->m_BlocksPerFile = 0;
+  this->m_PrefetchTimeSteps = 2;
+  this->ResetCacheStatistics();
+  // Blocks are not copied, the cache can cover a few volumes
+  this->SetCacheSizeInMiB ( 256 );
 }
 
 template <class TPixel>
@@ -609,6 +702,10 @@ TimeSeriesDatabase<TPixel>
   } else {
     os << indent << "Database is closed." << "\n";
   }
+  os << indent << "PrefetchTimeSteps: " << this->m_PrefetchTimeSteps << "\n";
+  os << indent << "CacheHits: " << this->m_CacheHits << "\n";
+  os << indent << "CacheMisses: " << this->m_CacheMisses << "\n";
+  os << indent << "PrefetchedBlocks: " << this->m_PrefetchedBlocks << "\n";
 
   this->m_Cache.statistics ( os );
 }
@@ -0,0 +1,145 @@
+/*=========================================================================
+
+  Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   vtkITK
+
+==========================================================================*/
+
+#include "itkTimeSeriesDatabaseHelper.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace itk {
+  namespace TimeSeriesDatabaseHelper {
+
+//----------------------------------------------------------------------------
+MappedFile::MappedFile()
+  : m_Data(0), m_Size(0)
+#ifdef _WIN32
+  , m_Mapping(0)
+#endif
+{
+}
+
+//----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+  this->close();
+}
+
+//----------------------------------------------------------------------------
+bool MappedFile::open(const char* filename)
+{
+  this->close();
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+    {
+    return false;
+    }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 ||
+      static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+    {
+    CloseHandle(file);
+    return false;
+    }
+  // The mapping keeps a reference to the file
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL)
+    {
+    return false;
+    }
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == NULL)
+    {
+    CloseHandle(mapping);
+    return false;
+    }
+  m_Mapping = mapping;
+  m_Size = static_cast<size_t>(fileSize.QuadPart);
+#else
+  int file = ::open(filename, O_RDONLY);
+  if (file < 0)
+    {
+    return false;
+    }
+  struct stat fileStatus;
+  if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0 ||
+      static_cast<unsigned long long>(fileStatus.st_size) > static_cast<size_t>(-1))
+    {
+    ::close(file);
+    return false;
+    }
+  // The mapping keeps a reference to the file
+  void* data = mmap(0, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_SHARED, file, 0);
+  ::close(file);
+  if (data == MAP_FAILED)
+    {
+    return false;
+    }
+  m_Size = static_cast<size_t>(fileStatus.st_size);
+#endif
+  m_Data = static_cast<const char*>(data);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void MappedFile::close()
+{
+  if (!m_Data)
+    {
+    return;
+    }
+#ifdef _WIN32
+  UnmapViewOfFile(m_Data);
+  CloseHandle(m_Mapping);
+  m_Mapping = 0;
+#else
+  munmap(const_cast<char*>(m_Data), m_Size);
+#endif
+  m_Data = 0;
+  m_Size = 0;
+}
+
+//----------------------------------------------------------------------------
+void MappedFile::will_need(size_t offset, size_t length) const
+{
+  if (!m_Data || offset >= m_Size)
+    {
+    return;
+    }
+  if (length > m_Size - offset)
+    {
+    length = m_Size - offset;
+    }
+#ifdef _WIN32
+# if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = const_cast<char*>(m_Data + offset);
+  range.NumberOfBytes = length;
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+# endif
+#else
+  // madvise requires a page aligned address
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t alignedOffset = offset - offset % pageSize;
+  madvise(const_cast<char*>(m_Data + alignedOffset), length + offset - alignedOffset, MADV_WILLNEED);
+#endif
+}
+
+  }
+}
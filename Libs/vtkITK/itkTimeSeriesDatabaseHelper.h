@@ -6,6 +6,10 @@
 #include <string>
 #include <cstdarg>
 #include <cassert>
+#include <cstddef>
+#include <cstdio>
+
+#include "vtkITKExport.h"
 
 namespace itk {
   namespace TimeSeriesDatabaseHelper {
@@ -68,6 +72,42 @@ namespace itk {
         }
       };
 
+    /// Read-only memory mapping of a whole file.
+    ///
+    /// The content of the file is accessed in place, without copy. Pages
+    /// are loaded on demand by the operating system and kept in its page
+    /// cache, from which they can be evicted under memory pressure: files
+    /// larger than the physical memory can be mapped.
+    class VTK_ITK_EXPORT MappedFile
+      {
+      public:
+        MappedFile();
+        ~MappedFile();
+
+        /// Map the file. Returns false if the file can't be opened or mapped.
+        bool open(const char* filename);
+        void close();
+        bool is_open() const {return m_Data != 0;}
+
+        const char* data() const {return m_Data;}
+        size_t size() const {return m_Size;}
+
+        /// Hint that the given range will be accessed soon. The pages are
+        /// read asynchronously by the operating system, the call does not
+        /// wait for the data.
+        void will_need(size_t offset, size_t length) const;
+
+      private:
+        MappedFile(const MappedFile&); /// Not implemented.
+        void operator=(const MappedFile&); /// Not implemented.
+
+        const char* m_Data;
+        size_t      m_Size;
+#ifdef _WIN32
+        void*       m_Mapping;
+#endif
+      };
+
     /// LRU Cache
 
     using namespace std;
@@ -21,6 +21,7 @@
 #include <vtkImageData.h>
 #include <vtkMath.h>
 #include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkNew.h>
@@ -91,6 +92,7 @@ vtkITKArchetypeImageSeriesReader::vtkITKArchetypeImageSeriesReader()
   this->ImageOrientationPatient.resize( 0 );
 
   this->AnalyzeHeader = true;
+  this->NumberOfThreads = 0;
 
   this->GroupingByTags = false;
   this->IsOnlyFile = false;
@@ -174,6 +176,7 @@ void vtkITKArchetypeImageSeriesReader::PrintSelf(ostream& os, vtkIndent indent)
     os << ", " << this->DefaultDataOrigin[idx];
     }
   os << ")\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
 #ifdef VTKITK_BUILD_DICOM_SUPPORT
   os << indent << "DICOMImageIOApproach: " << this->GetDICOMImageIOApproach();
 #else
@@ -1110,7 +1113,11 @@ void vtkITKArchetypeImageSeriesReader::GroupFiles ( int idxSeriesInstanceUID,
   return;
 }
 
-std::string vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(const itk::MetaDataDictionary &dict, const std::string& tag)
+namespace
+{
+
+//----------------------------------------------------------------------------
+std::string MetaDataWithoutSpaces(const itk::MetaDataDictionary &dict, const std::string& tag)
 {
   std::string tagValue;
   itk::ExposeMetaData<std::string>(dict, tag, tagValue);
@@ -1118,6 +1125,96 @@ std::string vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(const itk
   return tagValue;
 }
 
+#ifdef VTKITK_BUILD_DICOM_SUPPORT
+/// Indices of the DICOM tags analyzed by AnalyzeDicomHeaders() in DICOMTags.
+enum
+{
+  SeriesInstanceUIDTag = 0,
+  ContentTimeTag,
+  TriggerTimeTag,
+  EchoNumbersTag,
+  DiffusionGradientOrientationTag,
+  SliceLocationTag,
+  ImageOrientationPatientTag,
+  ImagePositionPatientTag,
+  NumberOfDICOMTags
+};
+
+const char* DICOMTags[NumberOfDICOMTags] =
+{
+  "0020|000e", // series instance UID
+  "0008|0033", // content time
+  "0018|1060", // trigger time
+  "0018|0086", // echo numbers
+  "0010|9089", // diffusion gradient orientation
+  "0020|1041", // slice location
+  "0020|0037", // image orientation patient
+  "0020|0032"  // image position patient
+};
+
+//----------------------------------------------------------------------------
+/// Tag values of a set of files, read by multiple threads. The files are
+/// split into NumberOfPieces contiguous ranges, each read with its own
+/// image IO.
+struct DICOMHeaderJob
+{
+  const std::vector<std::string>* FileNames;
+  /// Tag values (without spaces) of each file, indexed by DICOMTags.
+  std::vector<std::vector<std::string> > TagValues;
+  /// Description of the error raised while reading a file, if any.
+  std::vector<std::string> Errors;
+  int NumberOfPieces;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ReadDICOMHeadersThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  DICOMHeaderJob* job = static_cast<DICOMHeaderJob*>(info->UserData);
+  const int nFiles = static_cast<int>(job->FileNames->size());
+
+  itk::GDCMImageIO::Pointer gdcmIO = itk::GDCMImageIO::New();
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread reads every NumberOfThreads-th piece.
+  for (int piece = info->ThreadID; piece < job->NumberOfPieces; piece += info->NumberOfThreads)
+    {
+    const int begin = static_cast<int>(static_cast<vtkIdType>(nFiles) * piece / job->NumberOfPieces);
+    const int end = static_cast<int>(static_cast<vtkIdType>(nFiles) * (piece + 1) / job->NumberOfPieces);
+    for (int f = begin; f < end; f++)
+      {
+      try
+        {
+        gdcmIO->SetFileName( (*job->FileNames)[f] );
+        gdcmIO->ReadImageInformation();
+        }
+      catch (itk::ExceptionObject& e)
+        {
+        // Following files of the piece are not read, the error of the first
+        // failing file is reported as when the headers are read serially.
+        job->Errors[f] = e.GetDescription();
+        break;
+        }
+      const itk::MetaDataDictionary &dict = gdcmIO->GetMetaDataDictionary();
+      std::vector<std::string>& tagValues = job->TagValues[f];
+      for (int tag = 0; tag < NumberOfDICOMTags; tag++)
+        {
+        tagValues[tag] = MetaDataWithoutSpaces(dict, DICOMTags[tag]);
+        }
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+#endif
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+std::string vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(const itk::MetaDataDictionary &dict, const std::string& tag)
+{
+  return MetaDataWithoutSpaces(dict, tag);
+}
+
 //----------------------------------------------------------------------------
 void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
 {
@@ -1225,20 +1322,37 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
   // if Archetype is a Dicom File
-  gdcmIO->SetFileName( this->Archetype );
+  // The headers are read in parallel, then the tag values are inserted in
+  // file order so that the Index* vectors do not depend on the number of
+  // threads.
+  DICOMHeaderJob job;
+  job.FileNames = &this->AllFileNames;
+  job.TagValues.resize( nFiles, std::vector<std::string>(NumberOfDICOMTags) );
+  job.Errors.resize( nFiles );
+  vtkNew<vtkMultiThreader> threader;
+  job.NumberOfPieces = this->NumberOfThreads > 0 ?
+    this->NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  job.NumberOfPieces = std::max(1, std::min(job.NumberOfPieces, nFiles));
+  threader->SetNumberOfThreads(std::min(job.NumberOfPieces, VTK_MAX_THREADS));
+  threader->SetSingleMethod(ReadDICOMHeadersThread, &job);
+  threader->SingleMethodExecute();
+
   for (int f = 0; f < nFiles; f++)
   {
-    gdcmIO->SetFileName( this->AllFileNames[f] );
-    gdcmIO->ReadImageInformation();
-    itk::MetaDataDictionary &dict = gdcmIO->GetMetaDataDictionary();
+    if (!job.Errors[f].empty())
+    {
+      itkGenericExceptionMacro(<< "Failed to read the DICOM header of "
+                               << this->AllFileNames[f] << ": " << job.Errors[f]);
+    }
+    const std::vector<std::string>& tagValues = job.TagValues[f];
     std::string tagValue;
 
-    // Use vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces to remove extra spaces
+    // Tag values are read with MetaDataWithoutSpaces to remove extra spaces
     // from the DICOM tag, because extra spaces were found in some DICOM file before/after the
     // multi-value separator backslashes.
 
     // series instance UID
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|000e");
+    tagValue = tagValues[SeriesInstanceUIDTag];
     if (!tagValue.empty())
     {
       int idx = InsertSeriesInstanceUIDs( tagValue.c_str() );
@@ -1250,7 +1364,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // content time
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0008|0033");
+    tagValue = tagValues[ContentTimeTag];
     if (!tagValue.empty())
     {
       int idx = InsertContentTime( tagValue.c_str() );
@@ -1262,7 +1376,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // trigger time
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0018|1060");
+    tagValue = tagValues[TriggerTimeTag];
     if (!tagValue.empty())
     {
       int idx = InsertTriggerTime( tagValue.c_str() );
@@ -1274,7 +1388,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // echo numbers
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0018|0086");
+    tagValue = tagValues[EchoNumbersTag];
     if (!tagValue.empty())
     {
       int idx = InsertEchoNumbers( tagValue.c_str() );
@@ -1286,7 +1400,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // diffision gradient orientation
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0010|9089");
+    tagValue = tagValues[DiffusionGradientOrientationTag];
     if (!tagValue.empty())
     {
       float a[3] = { -1 };
@@ -1300,7 +1414,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // slice location
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|1041");
+    tagValue = tagValues[SliceLocationTag];
     if (!tagValue.empty())
     {
       float a = -1;
@@ -1314,7 +1428,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
     }
 
     // image orientation patient
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|0037");
+    tagValue = tagValues[ImageOrientationPatientTag];
     if (!tagValue.empty())
     {
       float a[6] = { -1 };
@@ -1327,7 +1441,7 @@ void vtkITKArchetypeImageSeriesReader::AnalyzeDicomHeaders()
       this->IndexImageOrientationPatient[f] = -1;
     }
     // image position patient
-    tagValue = vtkITKArchetypeImageSeriesReader::GetMetaDataWithoutSpaces(dict, "0020|0032");
+    tagValue = tagValues[ImagePositionPatientTag];
     if (!tagValue.empty())
     {
       float a[3] = { -1 };
@@ -246,6 +246,14 @@ public:
   vtkSetMacro(AnalyzeHeader, bool);
   vtkGetMacro(AnalyzeHeader, bool);
 
+  ///
+  /// Number of threads used to read the DICOM headers and the slices of a
+  /// series. Files are split into contiguous ranges, one per thread; the
+  /// results do not depend on the number of threads.
+  /// 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetMacro(NumberOfThreads, int);
+  vtkGetMacro(NumberOfThreads, int);
+
   ///
   /// Whether to use orientation from file
   vtkSetMacro(UseOrientationFromFile, int);
@@ -872,6 +880,7 @@ protected:
 
   std::vector<std::string> AllFileNames;
   bool AnalyzeHeader;
+  int NumberOfThreads;
   bool IsOnlyFile;
   bool ArchetypeIsDICOM;
 
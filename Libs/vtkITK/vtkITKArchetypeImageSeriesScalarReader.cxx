@@ -22,6 +22,8 @@
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
@@ -35,6 +37,9 @@
 #include <itkGDCMImageIO.h>
 #endif
 
+// STD includes
+#include <algorithm>
+
 vtkStandardNewMacro(vtkITKArchetypeImageSeriesScalarReader);
 
 namespace {
@@ -45,6 +50,158 @@ vtkAOSDataArrayTemplate<T>* DownCast(vtkAbstractArray* a)
   return vtkAOSDataArrayTemplate<T>::FastDownCast(a);
 }
 
+//----------------------------------------------------------------------------
+/// Slices of a series decoded by multiple threads into a preallocated image.
+/// The files are split into NumberOfPieces contiguous ranges, each read with
+/// its own image IO.
+template <class TImage>
+struct SliceReadJob
+{
+  const std::vector<std::string>* FileNames;
+  TImage* Image;
+  /// -1 if the files are not DICOM.
+  int DICOMImageIOApproach;
+  /// If true, the last file is copied into the first slice
+  /// (see itk::ImageSeriesReader::SetReverseOrder()).
+  bool ReverseOrder;
+  /// Description of the error raised while reading a file, if any.
+  std::vector<std::string> Errors;
+  /// Meta data dictionary of the first file.
+  itk::MetaDataDictionary FirstFileMetaDataDictionary;
+  int NumberOfPieces;
+  vtkAlgorithm* Algorithm;
+};
+
+//----------------------------------------------------------------------------
+template <class TImage>
+VTK_THREAD_RETURN_TYPE ReadSlicesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SliceReadJob<TImage>* job = static_cast<SliceReadJob<TImage>*>(info->UserData);
+  const int nFiles = static_cast<int>(job->FileNames->size());
+
+  const typename TImage::SizeType& size = job->Image->GetLargestPossibleRegion().GetSize();
+  const size_t sliceSize = static_cast<size_t>(size[0]) * size[1];
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread reads every NumberOfThreads-th piece.
+  const int numberOfThreadPieces = (job->NumberOfPieces - 1 - info->ThreadID) / info->NumberOfThreads + 1;
+  int threadPiece = 0;
+  for (int piece = info->ThreadID; piece < job->NumberOfPieces; piece += info->NumberOfThreads, ++threadPiece)
+    {
+    const int begin = static_cast<int>(static_cast<vtkIdType>(nFiles) * piece / job->NumberOfPieces);
+    const int end = static_cast<int>(static_cast<vtkIdType>(nFiles) * (piece + 1) / job->NumberOfPieces);
+    for (int f = begin; f < end; f++)
+      {
+      try
+        {
+        typename itk::ImageFileReader<TImage>::Pointer reader = itk::ImageFileReader<TImage>::New();
+        reader->SetFileName((*job->FileNames)[f]);
+#ifdef VTKITK_BUILD_DICOM_SUPPORT
+        if (job->DICOMImageIOApproach == vtkITKArchetypeImageSeriesReader::GDCM)
+          {
+          reader->SetImageIO(itk::GDCMImageIO::New());
+          }
+#endif
+        reader->Update();
+        const typename TImage::SizeType& sliceSizes = reader->GetOutput()->GetLargestPossibleRegion().GetSize();
+        if (sliceSizes[0] != size[0] || sliceSizes[1] != size[1] || sliceSizes[2] != 1)
+          {
+          job->Errors[f] = "Size mismatch! The size of the slice does not match the size of the first slice.";
+          break;
+          }
+        if (f == 0)
+          {
+          job->FirstFileMetaDataDictionary = reader->GetImageIO()->GetMetaDataDictionary();
+          }
+        const int sliceIndex = job->ReverseOrder ? nFiles - 1 - f : f;
+        const typename TImage::PixelType* slice = reader->GetOutput()->GetBufferPointer();
+        std::copy(slice, slice + sliceSize, job->Image->GetBufferPointer() + sliceIndex * sliceSize);
+        }
+      catch (itk::ExceptionObject& e)
+        {
+        job->Errors[f] = e.GetDescription();
+        break;
+        }
+      if (info->ThreadID == 0)
+        {
+        job->Algorithm->UpdateProgress(
+          (threadPiece + static_cast<double>(f + 1 - begin) / (end - begin)) / numberOfThreadPieces);
+        }
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+/// Decode the slices of a series with multiple threads.
+/// The geometry of the image is the one computed by the series reader, file
+/// f is copied into slice f (or into the slice nFiles - 1 - f in reverse
+/// order) as itk::ImageSeriesReader does, and the meta data dictionary of
+/// the image is the one of the first file.
+/// Returns NULL if the series can't be read in parallel (single thread,
+/// DCMTK image IO, files containing more than one slice, or a series reader
+/// that must fill its meta data dictionary array), in which case the series
+/// reader must be updated.
+template <class TImage>
+typename TImage::Pointer ReadSeriesSlices(itk::ImageSeriesReader<TImage>* seriesReader,
+                                          const std::vector<std::string>& fileNames,
+                                          int dicomImageIOApproach,
+                                          int numberOfThreads,
+                                          vtkAlgorithm* algorithm)
+{
+  const int nFiles = static_cast<int>(fileNames.size());
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfThreads = std::min(numberOfThreads, nFiles);
+  // DCMTK decoders share global state and are not used concurrently.
+  // The dictionaries of all the files are only kept by the series reader.
+  if (numberOfThreads < 2 || dicomImageIOApproach == vtkITKArchetypeImageSeriesReader::DCMTK
+      || seriesReader->GetMetaDataDictionaryArrayUpdate())
+    {
+    return NULL;
+    }
+
+  seriesReader->UpdateOutputInformation();
+  const TImage* information = seriesReader->GetOutput();
+  const typename TImage::RegionType region = information->GetLargestPossibleRegion();
+  if (region.GetSize()[2] != static_cast<typename TImage::SizeValueType>(nFiles))
+    {
+    return NULL;
+    }
+
+  typename TImage::Pointer image = TImage::New();
+  image->CopyInformation(information);
+  image->SetRegions(region);
+  image->Allocate();
+
+  SliceReadJob<TImage> job;
+  job.FileNames = &fileNames;
+  job.Image = image;
+  job.DICOMImageIOApproach = dicomImageIOApproach;
+  job.ReverseOrder = seriesReader->GetReverseOrder();
+  job.Errors.resize(nFiles);
+  job.NumberOfPieces = numberOfThreads;
+  job.Algorithm = algorithm;
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(std::min(numberOfThreads, VTK_MAX_THREADS));
+  threader->SetSingleMethod(ReadSlicesThread<TImage>, &job);
+  threader->SingleMethodExecute();
+
+  for (int f = 0; f < nFiles; f++)
+    {
+    if (!job.Errors[f].empty())
+      {
+      itkGenericExceptionMacro(<< "Failed to read " << fileNames[f] << ": " << job.Errors[f]);
+      }
+    }
+  image->SetMetaDataDictionary(job.FirstFileMetaDataDictionary);
+  return image;
+}
+
 };
 
 //----------------------------------------------------------------------------
@@ -136,6 +293,13 @@ int vtkITKArchetypeImageSeriesScalarReader::RequestData(
       reader##typeN->AddObserver(itk::ProgressEvent(),pcl); \
       reader##typeN->SetFileNames(this->FileNames); \
       reader##typeN->ReleaseDataFlagOn(); \
+      /* the dictionaries of the slices are not used */ \
+      reader##typeN->MetaDataDictionaryArrayUpdateOff(); \
+      image##typeN::Pointer slices##typeN = ReadSeriesSlices<image##typeN>( \
+        reader##typeN, this->FileNames, \
+        this->ArchetypeIsDICOM ? this->DICOMImageIOApproach : -1, \
+        this->NumberOfThreads, this); \
+      image##typeN::Pointer output##typeN = slices##typeN; \
       if (this->UseNativeCoordinateOrientation) \
         { \
         filter = reader##typeN; \
@@ -145,14 +309,26 @@ int vtkITKArchetypeImageSeriesScalarReader::RequestData(
         itk::OrientImageFilter<image##typeN,image##typeN>::Pointer orient##typeN = \
             itk::OrientImageFilter<image##typeN,image##typeN>::New(); \
         if (this->Debug) {orient##typeN->DebugOn();} \
-        orient##typeN->SetInput(reader##typeN->GetOutput()); \
+        if (slices##typeN) \
+          { \
+          orient##typeN->SetInput(slices##typeN); \
+          } \
+        else \
+          { \
+          orient##typeN->SetInput(reader##typeN->GetOutput()); \
+          } \
         orient##typeN->UseImageDirectionOn(); \
         orient##typeN->SetDesiredCoordinateOrientation(this->DesiredCoordinateOrientation); \
         filter = orient##typeN; \
+        output##typeN = NULL; \
         }\
-      filter->UpdateLargestPossibleRegion(); \
+      if (!output##typeN) \
+        { \
+        filter->UpdateLargestPossibleRegion(); \
+        output##typeN = filter->GetOutput(); \
+        } \
       itk::ImportImageContainer<itk::SizeValueType, type>::Pointer PixelContainer##typeN;\
-      PixelContainer##typeN = filter->GetOutput()->GetPixelContainer();\
+      PixelContainer##typeN = output##typeN->GetPixelContainer();\
       void *ptr = static_cast<void *> (PixelContainer##typeN->GetBufferPointer());\
       DownCast<type>(data->GetPointData()->GetScalars())                \
         ->SetVoidArray(ptr, PixelContainer##typeN->Size(), 0,\
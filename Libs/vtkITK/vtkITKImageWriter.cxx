@@ -31,6 +31,7 @@
 #include <vtksys/SystemTools.hxx>
 
 // ITK includes
+#include <itkConfigure.h>
 #include <itkDiffusionTensor3D.h>
 #include <itkImageFileWriter.h>
 #include <itkMetaDataDictionary.h>
@@ -145,6 +146,12 @@ void ITKWriteVTKImage(vtkITKImageWriter *self, vtkImageData *inputImage, char *f
     {
     itkImageWriter->UseCompressionOff();
     }
+#if ITK_VERSION_MAJOR > 5 || (ITK_VERSION_MAJOR == 5 && ITK_VERSION_MINOR >= 1)
+  if ( self->GetCompressionLevel() >= 0 )
+    {
+    itkImageWriter->SetCompressionLevel(self->GetCompressionLevel());
+    }
+#endif
 
 
   // set pipeline for the image
@@ -245,6 +252,7 @@ vtkITKImageWriter::vtkITKImageWriter()
   this->RasToIJKMatrix = NULL;
   this->MeasurementFrameMatrix = NULL;
   this->UseCompression = 0;
+  this->CompressionLevel = -1;
   this->ImageIOClassName = NULL;
 }
 
@@ -274,6 +282,8 @@ void vtkITKImageWriter::PrintSelf(ostream& os, vtkIndent indent)
 
   os << indent << "FileName: " <<
     (this->FileName ? this->FileName : "(none)") << "\n";
+  os << indent << "UseCompression: " << this->UseCompression << "\n";
+  os << indent << "CompressionLevel: " << this->CompressionLevel << "\n";
   os << indent << "ImageIOClassName: " <<
     (this->ImageIOClassName ? this->ImageIOClassName : "(none)") << "\n";
 }
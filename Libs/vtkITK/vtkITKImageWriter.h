@@ -48,6 +48,13 @@ public:
   vtkSetMacro (UseCompression, int);
   vtkBooleanMacro(UseCompression, int);
 
+  ///
+  /// Compression level used if UseCompression is enabled, from 1 (fastest)
+  /// to 9 (smallest file), -1 uses the default level of the image IO.
+  /// Requires ITK 5.1 or later, ignored with earlier versions.
+  vtkSetClampMacro(CompressionLevel, int, -1, 9);
+  vtkGetMacro(CompressionLevel, int);
+
   ///
   /// Set/Get the ImageIO class name.
   vtkGetStringMacro (ImageIOClassName);
@@ -75,6 +82,7 @@ protected:
   vtkMatrix4x4* RasToIJKMatrix;
   vtkMatrix4x4* MeasurementFrameMatrix;
   int UseCompression;
+  int CompressionLevel;
   char* ImageIOClassName;
 
 private:
@@ -66,6 +66,44 @@ public:
   int GetNumberOfVolumes()
   { DelegateITKOutputMacro ( GetNumberOfVolumes ); };
 
+  /// Get/Set the number of images following the current image whose blocks
+  /// are prefetched while the current image is read.
+  void SetPrefetchTimeSteps ( unsigned int value )
+  { DelegateITKInputMacro ( SetPrefetchTimeSteps, value ); };
+  unsigned int GetPrefetchTimeSteps()
+  { DelegateITKOutputMacro ( GetPrefetchTimeSteps ); };
+
+  /// Ask for the extent of an image to be read asynchronously, for example
+  /// the slice being viewed in the next images.
+  void Prefetch ( int extent[6], unsigned int image )
+  {
+    SourceType::OutputImageType::RegionType region;
+    for ( int i = 0; i < 3; i++ )
+      {
+      region.SetIndex ( i, extent[2*i] );
+      region.SetSize ( i, extent[2*i+1] >= extent[2*i] ? extent[2*i+1] - extent[2*i] + 1 : 0 );
+      }
+    this->m_Filter->Prefetch ( region, image );
+  };
+
+  /// Get/Set the number of blocks accounted as cached, in MiB.
+  void SetCacheSizeInMiB ( float value )
+  { DelegateITKInputMacro ( SetCacheSizeInMiB, value ); };
+  float GetCacheSizeInMiB()
+  { DelegateITKOutputMacro ( GetCacheSizeInMiB ); };
+
+  /// Cache statistics: number of block accesses that hit recently accessed
+  /// or prefetched blocks, number of block accesses that missed, and number
+  /// of blocks prefetched.
+  unsigned long GetCacheHits()
+  { DelegateITKOutputMacro ( GetCacheHits ); };
+  unsigned long GetCacheMisses()
+  { DelegateITKOutputMacro ( GetCacheMisses ); };
+  unsigned long GetPrefetchedBlocks()
+  { DelegateITKOutputMacro ( GetPrefetchedBlocks ); };
+  void ResetCacheStatistics()
+  { this->m_Filter->ResetCacheStatistics(); };
+
 protected:
   vtkITKTimeSeriesDatabase()
     {
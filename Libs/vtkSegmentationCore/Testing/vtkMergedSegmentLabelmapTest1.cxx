@@ -0,0 +1,170 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// SegmentationCore includes
+#include "vtkMergedSegmentLabelmap.h"
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+namespace
+{
+void SetBox(vtkOrientedImageData* labelmap, int i0, int i1, int j0, int j1, int k0, int k1, double value)
+{
+  for (int k = k0; k <= k1; ++k)
+    {
+    for (int j = j0; j <= j1; ++j)
+      {
+      for (int i = i0; i <= i1; ++i)
+        {
+        labelmap->SetScalarComponentFromDouble(i, j, k, 0, value);
+        }
+      }
+    }
+  labelmap->Modified();
+}
+
+bool IsInside(const int extent[6], int i, int j, int k)
+{
+  return i >= extent[0] && i <= extent[1] && j >= extent[2] && j <= extent[3] && k >= extent[4] && k <= extent[5];
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkMergedSegmentLabelmapTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  // Three segments with the same geometry:
+  // "a" and "c" have the same extent, "b" is next to them.
+  const int extentA[6] = { 0, 9, 0, 9, 0, 9 };
+  const int extentB[6] = { 10, 19, 0, 9, 0, 9 };
+  vtkNew<vtkOrientedImageData> labelmapA;
+  labelmapA->SetExtent(const_cast<int*>(extentA));
+  labelmapA->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkOrientedImageDataResample::FillImage(labelmapA.GetPointer(), 0);
+  SetBox(labelmapA.GetPointer(), 2, 5, 2, 5, 2, 5, 1);
+  vtkNew<vtkOrientedImageData> labelmapB;
+  labelmapB->SetExtent(const_cast<int*>(extentB));
+  labelmapB->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkOrientedImageDataResample::FillImage(labelmapB.GetPointer(), 1);
+  vtkNew<vtkOrientedImageData> labelmapC;
+  labelmapC->SetExtent(const_cast<int*>(extentA));
+  labelmapC->AllocateScalars(VTK_SHORT, 1);
+  vtkOrientedImageDataResample::FillImage(labelmapC.GetPointer(), 0);
+  SetBox(labelmapC.GetPointer(), 7, 9, 0, 9, 0, 9, 1);
+
+  std::vector<std::string> segmentIDs;
+  segmentIDs.push_back("a");
+  segmentIDs.push_back("b");
+  segmentIDs.push_back("c");
+  std::vector<vtkOrientedImageData*> labelmaps;
+  labelmaps.push_back(labelmapA.GetPointer());
+  labelmaps.push_back(labelmapB.GetPointer());
+  labelmaps.push_back(labelmapC.GetPointer());
+
+  vtkNew<vtkMergedSegmentLabelmap> merged;
+  int updatedExtent[6] = { 0 };
+  if (!merged->Update(segmentIDs, labelmaps) || merged->GetMergedSegmentIDs().size() != 3)
+    {
+    std::cerr << __LINE__ << ": failed to merge segments" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkImageData* mergedImage = merged->GetMergedImage();
+  merged->GetUpdatedExtent(updatedExtent);
+  if (mergedImage->GetScalarType() != VTK_UNSIGNED_CHAR
+    || updatedExtent[0] != 0 || updatedExtent[1] != 19 || updatedExtent[5] != 9
+    || mergedImage->GetScalarComponentAsDouble(3, 3, 3, 0) != 1.0
+    || mergedImage->GetScalarComponentAsDouble(15, 3, 3, 0) != 2.0
+    || mergedImage->GetScalarComponentAsDouble(8, 3, 3, 0) != 3.0
+    || mergedImage->GetScalarComponentAsDouble(6, 3, 3, 0) != 0.0)
+    {
+    std::cerr << __LINE__ << ": unexpected merged labelmap" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Nothing to do if the segments did not change
+  if (merged->Update(segmentIDs, labelmaps))
+    {
+    std::cerr << __LINE__ << ": unchanged segments were merged again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Editing a segment only updates the voxels of that segment
+  vtkNew<vtkImageData> previousMergedImage;
+  previousMergedImage->DeepCopy(mergedImage);
+  SetBox(labelmapA.GetPointer(), 2, 2, 2, 2, 2, 2, 0);
+  SetBox(labelmapA.GetPointer(), 0, 1, 0, 1, 0, 1, 1);
+  if (!merged->Update(segmentIDs, labelmaps) || merged->GetMergedSegmentIDs().size() != 3)
+    {
+    std::cerr << __LINE__ << ": failed to update edited segment" << std::endl;
+    return EXIT_FAILURE;
+    }
+  merged->GetUpdatedExtent(updatedExtent);
+  if (!std::equal(updatedExtent, updatedExtent + 6, extentA))
+    {
+    std::cerr << __LINE__ << ": unexpected updated extent " << updatedExtent[0] << " " << updatedExtent[1] << " "
+      << updatedExtent[2] << " " << updatedExtent[3] << " " << updatedExtent[4] << " " << updatedExtent[5] << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int k = 0; k <= 9; ++k)
+    {
+    for (int j = 0; j <= 9; ++j)
+      {
+      for (int i = 0; i <= 19; ++i)
+        {
+        double previousLabel = previousMergedImage->GetScalarComponentAsDouble(i, j, k, 0);
+        double label = mergedImage->GetScalarComponentAsDouble(i, j, k, 0);
+        double expectedLabel = previousLabel;
+        if (IsInside(extentA, i, j, k) && previousLabel != 2.0 && previousLabel != 3.0)
+          {
+          expectedLabel = labelmapA->GetScalarComponentAsDouble(i, j, k, 0) != 0.0 ? 1.0 : 0.0;
+          }
+        if (label != expectedLabel)
+          {
+          std::cerr << __LINE__ << ": unexpected label " << label << " at (" << i << ", " << j << ", " << k
+            << "), expected " << expectedLabel << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  // A segment that overlaps a previously merged segment is not merged anymore
+  SetBox(labelmapC.GetPointer(), 5, 5, 5, 5, 5, 5, 1);
+  if (!merged->Update(segmentIDs, labelmaps) || merged->GetMergedSegmentIDs().size() != 2
+    || merged->GetMergedSegmentIDs()[1] != "b"
+    || mergedImage->GetScalarComponentAsDouble(8, 3, 3, 0) != 0.0
+    || mergedImage->GetScalarComponentAsDouble(5, 5, 5, 0) != 1.0)
+    {
+    std::cerr << __LINE__ << ": overlapping segment was merged" << std::endl;
+    return EXIT_FAILURE;
+    }
+  merged->GetUpdatedExtent(updatedExtent);
+  if (updatedExtent[1] != 19)
+    {
+    std::cerr << __LINE__ << ": merged labelmap was not rebuilt" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
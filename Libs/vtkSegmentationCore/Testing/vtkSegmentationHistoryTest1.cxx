@@ -0,0 +1,226 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VTK includes
+#include <vtkNew.h>
+
+// SegmentationCore includes
+#include "vtkOrientedImageData.h"
+#include "vtkSegment.h"
+#include "vtkSegmentation.h"
+#include "vtkSegmentationConverter.h"
+#include "vtkSegmentationHistory.h"
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+namespace
+{
+double GetVoxel(vtkSegment* segment, int i, int j, int k)
+{
+  vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(segment->GetRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()));
+  return labelmap ? labelmap->GetScalarComponentAsDouble(i, j, k, 0) : -1.0;
+}
+
+//----------------------------------------------------------------------------
+// Set voxel (i, j, k) of the "cube" segment and report it as the only modified voxel,
+// as vtkSlicerSegmentationsModuleLogic does. If hiddenI is not negative, voxel (hiddenI, hiddenJ, hiddenK)
+// is also set without being reported.
+bool ReportedEdit(vtkSegmentation* segmentation, int i, int j, int k, int hiddenI, int hiddenJ, int hiddenK)
+{
+  vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(segmentation->GetSegment("cube")->GetRepresentation(
+    vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName()));
+  if (!labelmap)
+    {
+    return false;
+    }
+  vtkSegmentation::MasterRepresentationExtentModifiedInfo modifiedInfo;
+  modifiedInfo.SegmentID = "cube";
+  modifiedInfo.PreviousMTime = labelmap->GetMTime();
+  int extent[6] = { i, i, j, j, k, k };
+  std::copy(extent, extent + 6, modifiedInfo.Extent);
+  labelmap->SetScalarComponentFromDouble(i, j, k, 0, 1);
+  if (hiddenI >= 0)
+    {
+    labelmap->SetScalarComponentFromDouble(hiddenI, hiddenJ, hiddenK, 0, 1);
+    }
+  labelmap->Modified();
+  segmentation->InvokeEvent(vtkSegmentation::MasterRepresentationExtentModified, &modifiedInfo);
+  segmentation->InvokeEvent(vtkSegmentation::MasterRepresentationModified, const_cast<char*>("cube"));
+  return true;
+}
+}
+
+//----------------------------------------------------------------------------
+int vtkSegmentationHistoryTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  const char* labelmapName = vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName();
+
+  // 128^3 labelmap with a cube that fills exactly 2x2x2 bricks of 32^3 voxels
+  vtkNew<vtkOrientedImageData> labelmap;
+  labelmap->SetExtent(0, 127, 0, 127, 0, 127);
+  labelmap->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  unsigned char* voxels = static_cast<unsigned char*>(labelmap->GetScalarPointer());
+  for (int k = 0; k < 128; ++k)
+    {
+    for (int j = 0; j < 128; ++j)
+      {
+      for (int i = 0; i < 128; ++i, ++voxels)
+        {
+        *voxels = (i >= 32 && i < 96 && j >= 32 && j < 96 && k >= 32 && k < 96) ? 1 : 0;
+        }
+      }
+    }
+
+  vtkNew<vtkSegment> segment;
+  segment->SetName("cube");
+  segment->AddRepresentation(labelmapName, labelmap.GetPointer());
+  vtkNew<vtkSegmentation> segmentation;
+  segmentation->SetMasterRepresentationName(labelmapName);
+  segmentation->AddSegment(segment.GetPointer(), "cube");
+
+  vtkNew<vtkSegmentationHistory> history;
+  history->SetSegmentation(segmentation.GetPointer());
+  history->SetMaximumNumberOfStates(100);
+
+  // Only the 8 bricks that are not empty are stored
+  const unsigned long brickMemorySize = 32 * 32 * 32 / 1024;
+  history->SaveState();
+  if (history->GetMemorySize() != 8 * brickMemorySize)
+    {
+    std::cerr << __LINE__ << ": unexpected memory size " << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Saving unchanged segments does not use memory
+  history->SaveState();
+  if (history->GetMemorySize() != 8 * brickMemorySize)
+    {
+    std::cerr << __LINE__ << ": unexpected memory size " << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Each edit only stores the bricks that changed.
+  // As in the segment editor, the state is saved before each edit.
+  const int numberOfEdits = 50;
+  for (int edit = 0; edit < numberOfEdits; ++edit)
+    {
+    history->SaveState();
+    vtkOrientedImageData* currentLabelmap = vtkOrientedImageData::SafeDownCast(
+      segmentation->GetSegment("cube")->GetRepresentation(labelmapName));
+    currentLabelmap->SetScalarComponentFromDouble(edit % 32, edit / 32, 0, 0, 1);
+    currentLabelmap->SetScalarComponentFromDouble(64, 64, 64, 0, edit % 2);
+    currentLabelmap->Modified();
+    }
+  // 1 brick in the corner and 1 in the cube per saved edit
+  if (history->GetMemorySize() != (8 + 2 * (numberOfEdits - 1)) * brickMemorySize)
+    {
+    std::cerr << __LINE__ << ": unexpected memory size " << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Undo the last edit
+  vtkSegment* cube = segmentation->GetSegment("cube");
+  if (!history->RestorePreviousState()
+    || GetVoxel(cube, (numberOfEdits - 1) % 32, (numberOfEdits - 1) / 32, 0) != 0.0
+    || GetVoxel(cube, (numberOfEdits - 2) % 32, (numberOfEdits - 2) / 32, 0) != 1.0
+    || GetVoxel(cube, 64, 64, 64) != ((numberOfEdits - 2) % 2)
+    || GetVoxel(cube, 40, 40, 40) != 1.0
+    || GetVoxel(cube, 100, 100, 100) != 0.0)
+    {
+    std::cerr << __LINE__ << ": failed to restore previous state" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // Back to the first state
+  while (history->IsRestorePreviousStateAvailable())
+    {
+    history->RestorePreviousState();
+    }
+  if (GetVoxel(cube, 0, 0, 0) != 0.0 || GetVoxel(cube, 64, 64, 64) != 1.0)
+    {
+    std::cerr << __LINE__ << ": failed to restore first state" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // Redo up to the first edit (the first three states are identical)
+  history->RestoreNextState();
+  history->RestoreNextState();
+  history->RestoreNextState();
+  if (GetVoxel(cube, 0, 0, 0) != 1.0 || GetVoxel(cube, 1, 0, 0) != 0.0 || GetVoxel(cube, 64, 64, 64) != 0.0)
+    {
+    std::cerr << __LINE__ << ": failed to restore next state" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Edit that reports its modified extent: only the bricks in that extent are compared.
+  // The voxel written outside of the reported extent is not noticed.
+  history->RemoveAllStates();
+  history->SaveState();
+  unsigned long baselineMemorySize = history->GetMemorySize();
+  if (!ReportedEdit(segmentation.GetPointer(), 5, 5, 100, 100, 100, 0))
+    {
+    std::cerr << __LINE__ << ": failed to edit segment" << std::endl;
+    return EXIT_FAILURE;
+    }
+  history->SaveState();
+  if (history->GetMemorySize() != baselineMemorySize + brickMemorySize)
+    {
+    std::cerr << __LINE__ << ": bricks outside of the modified extent were compared, memory size "
+      << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!history->RestorePreviousState() || GetVoxel(segmentation->GetSegment("cube"), 5, 5, 100) != 0.0
+    || !history->RestoreNextState() || GetVoxel(segmentation->GetSegment("cube"), 5, 5, 100) != 1.0)
+    {
+    std::cerr << __LINE__ << ": failed to undo and redo edit with reported extent" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A modification that is not reported before the reported edit: the whole labelmap is compared
+  history->RemoveAllStates();
+  history->SaveState();
+  baselineMemorySize = history->GetMemorySize();
+  vtkOrientedImageData* currentLabelmap = vtkOrientedImageData::SafeDownCast(
+    segmentation->GetSegment("cube")->GetRepresentation(labelmapName));
+  currentLabelmap->SetScalarComponentFromDouble(100, 100, 0, 0, 1);
+  currentLabelmap->Modified();
+  if (!ReportedEdit(segmentation.GetPointer(), 6, 5, 100, -1, -1, -1))
+    {
+    std::cerr << __LINE__ << ": failed to edit segment" << std::endl;
+    return EXIT_FAILURE;
+    }
+  history->SaveState();
+  if (history->GetMemorySize() != baselineMemorySize + 2 * brickMemorySize)
+    {
+    std::cerr << __LINE__ << ": unreported modification was not stored, memory size "
+      << history->GetMemorySize() << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (!history->RestorePreviousState()
+    || GetVoxel(segmentation->GetSegment("cube"), 100, 100, 0) != 0.0
+    || GetVoxel(segmentation->GetSegment("cube"), 6, 5, 100) != 0.0
+    || !history->RestoreNextState()
+    || GetVoxel(segmentation->GetSegment("cube"), 100, 100, 0) != 1.0
+    || GetVoxel(segmentation->GetSegment("cube"), 6, 5, 100) != 1.0)
+    {
+    std::cerr << __LINE__ << ": failed to undo and redo unreported modification" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,361 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// SegmentationCore includes
+#include "vtkMergedSegmentLabelmap.h"
+#include "vtkOrientedImageData.h"
+#include "vtkOrientedImageDataResample.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkMergedSegmentLabelmap);
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool IsExtentEmpty(const int extent[6])
+{
+  return extent[0] > extent[1] || extent[2] > extent[3] || extent[4] > extent[5];
+}
+
+//----------------------------------------------------------------------------
+bool IsExtentInside(const int extent[6], const int containerExtent[6])
+{
+  for (int i = 0; i < 3; ++i)
+    {
+    if (extent[i * 2] < containerExtent[i * 2] || extent[i * 2 + 1] > containerExtent[i * 2 + 1])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void AddExtent(int extent[6], const int addedExtent[6])
+{
+  if (IsExtentEmpty(addedExtent))
+    {
+    return;
+    }
+  if (IsExtentEmpty(extent))
+    {
+    std::copy(addedExtent, addedExtent + 6, extent);
+    return;
+    }
+  for (int i = 0; i < 3; ++i)
+    {
+    extent[i * 2] = std::min(extent[i * 2], addedExtent[i * 2]);
+    extent[i * 2 + 1] = std::max(extent[i * 2 + 1], addedExtent[i * 2 + 1]);
+    }
+}
+
+//----------------------------------------------------------------------------
+// Write \a label into the merged labelmap wherever the segment labelmap is
+// non-zero. If \a checkOnly is true, nothing is written and the function
+// returns true if a non-zero voxel of the segment is already labeled in the
+// merged labelmap (i.e. the segment overlaps a previously merged segment).
+template <class T, class L>
+bool MergeSegmentLabelmap(vtkImageData* segmentImage, T*, vtkImageData* mergedImage, L label, bool checkOnly)
+{
+  int* extent = segmentImage->GetExtent();
+  int rowLength = extent[1] - extent[0] + 1;
+  for (int z = extent[4]; z <= extent[5]; ++z)
+    {
+    for (int y = extent[2]; y <= extent[3]; ++y)
+      {
+      T* inPtr = static_cast<T*>(segmentImage->GetScalarPointer(extent[0], y, z));
+      L* outPtr = static_cast<L*>(mergedImage->GetScalarPointer(extent[0], y, z));
+      for (int x = 0; x < rowLength; ++x)
+        {
+        if (inPtr[x] == 0)
+          {
+          continue;
+          }
+        if (checkOnly)
+          {
+          if (outPtr[x] != 0)
+            {
+            return true;
+            }
+          }
+        else
+          {
+          outPtr[x] = label;
+          }
+        }
+      }
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+template <class L>
+bool MergeSegmentLabelmap(vtkImageData* segmentImage, vtkImageData* mergedImage, L label, bool checkOnly)
+{
+  switch (segmentImage->GetScalarType())
+    {
+    vtkTemplateMacro(return MergeSegmentLabelmap(segmentImage, static_cast<VTK_TT*>(NULL), mergedImage, label, checkOnly));
+    }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+// Set the voxels of the merged labelmap that have the value \a label to 0 within \a extent
+template <class L>
+void ClearLabel(vtkImageData* mergedImage, const int extent[6], L label)
+{
+  int rowLength = extent[1] - extent[0] + 1;
+  for (int z = extent[4]; z <= extent[5]; ++z)
+    {
+    for (int y = extent[2]; y <= extent[3]; ++y)
+      {
+      L* ptr = static_cast<L*>(mergedImage->GetScalarPointer(extent[0], y, z));
+      for (int x = 0; x < rowLength; ++x)
+        {
+        if (ptr[x] == label)
+          {
+          ptr[x] = 0;
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template <class L>
+bool AddSegmentToMergedLabelmap(vtkImageData* segmentImage, vtkImageData* mergedImage, L label)
+{
+  if (MergeSegmentLabelmap(segmentImage, mergedImage, label, true))
+    {
+    return false;
+    }
+  MergeSegmentLabelmap(segmentImage, mergedImage, label, false);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Add a segment to the merged labelmap unless it overlaps a previously merged segment.
+// Returns true if the segment was added.
+bool AddSegmentToMergedLabelmap(vtkImageData* segmentImage, vtkImageData* mergedImage, int label)
+{
+  if (mergedImage->GetScalarType() == VTK_UNSIGNED_CHAR)
+    {
+    return AddSegmentToMergedLabelmap(segmentImage, mergedImage, static_cast<unsigned char>(label));
+    }
+  return AddSegmentToMergedLabelmap(segmentImage, mergedImage, static_cast<unsigned short>(label));
+}
+
+//----------------------------------------------------------------------------
+void ClearLabel(vtkImageData* mergedImage, const int extent[6], int label)
+{
+  if (IsExtentEmpty(extent))
+    {
+    return;
+    }
+  if (mergedImage->GetScalarType() == VTK_UNSIGNED_CHAR)
+    {
+    ClearLabel(mergedImage, extent, static_cast<unsigned char>(label));
+    }
+  else
+    {
+    ClearLabel(mergedImage, extent, static_cast<unsigned short>(label));
+    }
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+vtkMergedSegmentLabelmap::vtkMergedSegmentLabelmap()
+{
+  this->MergedImage = vtkSmartPointer<vtkImageData>::New();
+  this->ImageToWorldMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->UpdatedExtent[0] = this->UpdatedExtent[2] = this->UpdatedExtent[4] = 0;
+  this->UpdatedExtent[1] = this->UpdatedExtent[3] = this->UpdatedExtent[5] = -1;
+}
+
+//----------------------------------------------------------------------------
+vtkMergedSegmentLabelmap::~vtkMergedSegmentLabelmap()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkMergedSegmentLabelmap::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfSegments: " << this->Segments.size() << "\n";
+  os << indent << "NumberOfMergedSegments: " << this->MergedSegmentIDs.size() << "\n";
+  os << indent << "UpdatedExtent: " << this->UpdatedExtent[0] << " " << this->UpdatedExtent[1] << " "
+    << this->UpdatedExtent[2] << " " << this->UpdatedExtent[3] << " "
+    << this->UpdatedExtent[4] << " " << this->UpdatedExtent[5] << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkMergedSegmentLabelmap::GetMergedImage()
+{
+  return this->MergedImage;
+}
+
+//----------------------------------------------------------------------------
+vtkMatrix4x4* vtkMergedSegmentLabelmap::GetImageToWorldMatrix()
+{
+  return this->ImageToWorldMatrix;
+}
+
+//----------------------------------------------------------------------------
+void vtkMergedSegmentLabelmap::GetUpdatedExtent(int extent[6])
+{
+  std::copy(this->UpdatedExtent, this->UpdatedExtent + 6, extent);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMergedSegmentLabelmap::Update(const std::vector<std::string>& segmentIDs,
+  const std::vector<vtkOrientedImageData*>& segmentLabelmaps)
+{
+  this->UpdatedExtent[0] = this->UpdatedExtent[2] = this->UpdatedExtent[4] = 0;
+  this->UpdatedExtent[1] = this->UpdatedExtent[3] = this->UpdatedExtent[5] = -1;
+  if (segmentIDs.size() != segmentLabelmaps.size())
+    {
+    vtkErrorMacro("Update: the number of segment IDs and labelmaps differ");
+    return false;
+    }
+
+  // A different set of segments or a different geometry requires a rebuild
+  bool rebuild = (segmentIDs.size() != this->Segments.size());
+  for (size_t segmentIndex = 0; !rebuild && segmentIndex < segmentIDs.size(); ++segmentIndex)
+    {
+    rebuild = (segmentIDs[segmentIndex] != this->Segments[segmentIndex].SegmentID);
+    }
+  if (!rebuild && !segmentLabelmaps.empty())
+    {
+    vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+    segmentLabelmaps[0]->GetImageToWorldMatrix(imageToWorldMatrix.GetPointer());
+    rebuild = !vtkOrientedImageDataResample::IsEqual(imageToWorldMatrix.GetPointer(), this->ImageToWorldMatrix);
+    }
+
+  bool modified = false;
+  for (size_t segmentIndex = 0; !rebuild && segmentIndex < segmentLabelmaps.size(); ++segmentIndex)
+    {
+    const SegmentState& state = this->Segments[segmentIndex];
+    vtkOrientedImageData* labelmap = segmentLabelmaps[segmentIndex];
+    if (labelmap == state.Labelmap.GetPointer() && labelmap->GetMTime() == state.LabelmapMTime)
+      {
+      continue;
+      }
+    rebuild = !this->UpdateSegment(segmentIndex, labelmap);
+    modified = true;
+    }
+
+  if (rebuild)
+    {
+    this->Rebuild(segmentIDs, segmentLabelmaps);
+    modified = true;
+    }
+  if (modified)
+    {
+    this->MergedImage->Modified();
+    this->Modified();
+    }
+  return modified;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMergedSegmentLabelmap::UpdateSegment(size_t segmentIndex, vtkOrientedImageData* segmentLabelmap)
+{
+  SegmentState& state = this->Segments[segmentIndex];
+  if (state.Label == 0)
+    {
+    // The segment may not overlap other segments anymore
+    return false;
+    }
+  int* mergedExtent = this->MergedImage->GetExtent();
+  int* extent = segmentLabelmap->GetExtent();
+  if (!IsExtentEmpty(extent) && !IsExtentInside(extent, mergedExtent))
+    {
+    // The merged labelmap must be enlarged
+    return false;
+    }
+
+  ClearLabel(this->MergedImage, state.Extent, state.Label);
+  AddExtent(this->UpdatedExtent, state.Extent);
+  if (!IsExtentEmpty(extent))
+    {
+    if (!AddSegmentToMergedLabelmap(segmentLabelmap, this->MergedImage, state.Label))
+      {
+      // The segment overlaps another segment now
+      return false;
+      }
+    AddExtent(this->UpdatedExtent, extent);
+    }
+
+  state.Labelmap = segmentLabelmap;
+  state.LabelmapMTime = segmentLabelmap->GetMTime();
+  std::copy(extent, extent + 6, state.Extent);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMergedSegmentLabelmap::Rebuild(const std::vector<std::string>& segmentIDs,
+  const std::vector<vtkOrientedImageData*>& segmentLabelmaps)
+{
+  this->Segments.clear();
+  this->MergedSegmentIDs.clear();
+  if (segmentLabelmaps.empty())
+    {
+    this->MergedImage->Initialize();
+    return;
+    }
+  segmentLabelmaps[0]->GetImageToWorldMatrix(this->ImageToWorldMatrix);
+
+  // The merged labelmap covers the union of the segment extents
+  int mergedExtent[6] = { 0, -1, 0, -1, 0, -1 };
+  for (std::vector<vtkOrientedImageData*>::const_iterator labelmapIt = segmentLabelmaps.begin(); labelmapIt != segmentLabelmaps.end(); ++labelmapIt)
+    {
+    AddExtent(mergedExtent, (*labelmapIt)->GetExtent());
+    }
+  this->MergedImage->SetExtent(mergedExtent);
+  this->MergedImage->AllocateScalars(
+    segmentIDs.size() <= static_cast<size_t>(VTK_UNSIGNED_CHAR_MAX) ? VTK_UNSIGNED_CHAR : VTK_UNSIGNED_SHORT, 1);
+  vtkOrientedImageDataResample::FillImage(this->MergedImage, 0);
+
+  for (size_t segmentIndex = 0; segmentIndex < segmentLabelmaps.size(); ++segmentIndex)
+    {
+    vtkOrientedImageData* labelmap = segmentLabelmaps[segmentIndex];
+    SegmentState state;
+    state.SegmentID = segmentIDs[segmentIndex];
+    state.Labelmap = labelmap;
+    state.LabelmapMTime = labelmap->GetMTime();
+    labelmap->GetExtent(state.Extent);
+    state.Label = 0;
+    int label = static_cast<int>(this->MergedSegmentIDs.size()) + 1;
+    if (!IsExtentEmpty(state.Extent) && AddSegmentToMergedLabelmap(labelmap, this->MergedImage, label))
+      {
+      state.Label = label;
+      this->MergedSegmentIDs.push_back(state.SegmentID);
+      }
+    this->Segments.push_back(state);
+    }
+  this->MergedImage->GetExtent(this->UpdatedExtent);
+}
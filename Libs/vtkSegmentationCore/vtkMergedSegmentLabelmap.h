@@ -0,0 +1,104 @@
+/*==============================================================================
+
+  Copyright (c) Laboratory for Percutaneous Surgery (PerkLab)
+  Queen's University, Kingston, ON, Canada. All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#ifndef __vtkMergedSegmentLabelmap_h
+#define __vtkMergedSegmentLabelmap_h
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+#include "vtkSegmentationCoreConfigure.h"
+
+class vtkImageData;
+class vtkMatrix4x4;
+class vtkOrientedImageData;
+
+/// \ingroup SegmentationCore
+/// \brief Single labelmap storing binary labelmap segments that share the same geometry.
+///
+/// The i-th merged segment is stored with label i+1. A segment that overlaps
+/// a previously merged segment is not merged (it must be displayed separately).
+/// When only the labelmaps of some segments change, only the extent of those
+/// segments is written again in the merged labelmap, so that the cost of an
+/// update is proportional to the size of the modified segments and not to
+/// the number of segments.
+class vtkSegmentationCore_EXPORT vtkMergedSegmentLabelmap : public vtkObject
+{
+public:
+  static vtkMergedSegmentLabelmap* New();
+  vtkTypeMacro(vtkMergedSegmentLabelmap, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Update the merged labelmap from the binary labelmaps of the segments.
+  /// \param segmentIDs IDs of the segments to merge, in label order
+  /// \param segmentLabelmaps Single component labelmaps of the segments, all with the same geometry
+  /// \return True if the merged labelmap was modified
+  bool Update(const std::vector<std::string>& segmentIDs, const std::vector<vtkOrientedImageData*>& segmentLabelmaps);
+
+  /// Merged labelmap, with unit spacing and zero origin.
+  /// Its scalar type is unsigned char, or unsigned short above 255 segments.
+  vtkImageData* GetMergedImage();
+
+  /// Geometry shared by the merged segments.
+  vtkMatrix4x4* GetImageToWorldMatrix();
+
+  /// IDs of the segments stored in the merged labelmap, in label order.
+  const std::vector<std::string>& GetMergedSegmentIDs() { return this->MergedSegmentIDs; };
+
+  /// Extent of the merged labelmap written by the last Update() call.
+  /// It is the whole extent if the merged labelmap was rebuilt and empty if it was not modified.
+  void GetUpdatedExtent(int extent[6]);
+
+protected:
+  /// Build the merged labelmap from scratch
+  void Rebuild(const std::vector<std::string>& segmentIDs, const std::vector<vtkOrientedImageData*>& segmentLabelmaps);
+
+  /// Write the modified segment again in the merged labelmap.
+  /// Returns false if the merged labelmap must be rebuilt instead.
+  bool UpdateSegment(size_t segmentIndex, vtkOrientedImageData* segmentLabelmap);
+
+protected:
+  vtkMergedSegmentLabelmap();
+  ~vtkMergedSegmentLabelmap();
+
+  struct SegmentState
+    {
+    std::string SegmentID;
+    vtkWeakPointer<vtkOrientedImageData> Labelmap;
+    vtkMTimeType LabelmapMTime;
+    int Extent[6];
+    /// Label of the segment in the merged labelmap, 0 if not merged
+    int Label;
+    };
+
+  vtkSmartPointer<vtkImageData> MergedImage;
+  vtkSmartPointer<vtkMatrix4x4> ImageToWorldMatrix;
+  std::vector<SegmentState> Segments;
+  std::vector<std::string> MergedSegmentIDs;
+  int UpdatedExtent[6];
+
+private:
+  vtkMergedSegmentLabelmap(const vtkMergedSegmentLabelmap&);  // Not implemented.
+  void operator=(const vtkMergedSegmentLabelmap&);  // Not implemented.
+};
+
+#endif
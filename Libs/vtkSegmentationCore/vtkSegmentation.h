@@ -103,7 +103,21 @@ public:
     /// Invoked if a representation is created or removed in the segments (e.g., created by conversion from master).
     ContainedRepresentationNamesModified,
     /// Invoked if segment IDs order is changed. Not called when a segment is added or removed.
-    SegmentsOrderModified
+    SegmentsOrderModified,
+    /// Invoked by functions that modified only the voxels of a known extent of the master
+    /// labelmap representation of a segment, before MasterRepresentationModified.
+    /// Call data is a pointer to a MasterRepresentationExtentModifiedInfo.
+    MasterRepresentationExtentModified
+    };
+
+  /// Call data of MasterRepresentationExtentModified events
+  struct MasterRepresentationExtentModifiedInfo
+    {
+    const char* SegmentID;
+    /// Extent that contains all the modified voxels
+    int Extent[6];
+    /// Modified time of the labelmap before the modification
+    vtkMTimeType PreviousMTime;
     };
 
   enum
@@ -22,11 +22,325 @@
 #include "vtkSegmentationHistory.h"
 #include "vtkSegmentationConverterFactory.h"
 #include "vtkSegmentation.h"
+#include "vtkOrientedImageData.h"
 
 // VTK includes
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkCallbackCommand.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <set>
+
+//----------------------------------------------------------------------------
+/// Image stored as bricks of BrickSize^3 voxels, the bricks are shared with the
+/// previous state of the image when their content is identical.
+/// Bricks that contain only zeros are not allocated (NULL).
+class vtkSegmentationHistory::vtkBrickedLabelmap : public vtkObject
+{
+public:
+  static vtkBrickedLabelmap* New();
+  vtkTypeMacro(vtkBrickedLabelmap, vtkObject);
+
+  /// Store the image. Bricks identical to the bricks of baseline are shared.
+  /// If modifiedExtent is not NULL, the image only differs from baseline in this extent:
+  /// the bricks outside of it are shared without comparing them.
+  void SetImage(vtkOrientedImageData* image, int brickSize, vtkBrickedLabelmap* baseline,
+    const int* modifiedExtent = NULL);
+
+  /// True if this is a copy of image and image was not modified after mtime.
+  bool IsCopyOf(vtkOrientedImageData* image, vtkMTimeType mtime)
+    {
+    return image != NULL && this->Source.GetPointer() == image && mtime <= this->SourceMTime;
+    }
+
+  /// Copy the stored image into image.
+  void GetImage(vtkOrientedImageData* image);
+
+  /// Add the stored bricks to bricks.
+  void GetBricks(std::set<vtkUnsignedCharArray*>& bricks);
+
+protected:
+  vtkBrickedLabelmap()
+    : ScalarType(VTK_UNSIGNED_CHAR)
+    , NumberOfScalarComponents(0)
+    , BrickSize(1)
+    , SourceMTime(0)
+    {
+    this->NumberOfBricks[0] = this->NumberOfBricks[1] = this->NumberOfBricks[2] = 0;
+    }
+  ~vtkBrickedLabelmap() {}
+
+  /// True if the image can share bricks with this stored image.
+  bool HasSameLayout(vtkOrientedImageData* image, int brickSize);
+
+  /// Extent of a brick, in voxels relative to the first voxel of the image.
+  void GetBrickExtent(int bi, int bj, int bk, int brickExtent[6]);
+
+  /// Image with the geometry of the stored image, without scalars
+  vtkSmartPointer<vtkOrientedImageData> Geometry;
+  int ScalarType;
+  /// 0 if the image has no scalars
+  int NumberOfScalarComponents;
+  int BrickSize;
+  int NumberOfBricks[3];
+  std::vector<vtkSmartPointer<vtkUnsignedCharArray> > Bricks;
+  /// Image that was stored and its modified time when it was stored
+  vtkWeakPointer<vtkOrientedImageData> Source;
+  vtkMTimeType SourceMTime;
+
+private:
+  vtkBrickedLabelmap(const vtkBrickedLabelmap&);  // Not implemented.
+  void operator=(const vtkBrickedLabelmap&);  // Not implemented.
+};
+
+vtkStandardNewMacro(vtkSegmentationHistory::vtkBrickedLabelmap);
+
+namespace
+{
+//----------------------------------------------------------------------------
+bool IsZero(const unsigned char* data, size_t size)
+{
+  for (size_t i = 0; i < size; ++i)
+    {
+    if (data[i])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool Intersects(const int extent1[6], const int extent2[6])
+{
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    if (extent1[2 * axis] > extent2[2 * axis + 1] || extent1[2 * axis + 1] < extent2[2 * axis])
+      {
+      return false;
+      }
+    }
+  return true;
+}
+}
+
+//----------------------------------------------------------------------------
+bool vtkSegmentationHistory::vtkBrickedLabelmap::HasSameLayout(vtkOrientedImageData* image, int brickSize)
+{
+  if (!this->Geometry || this->BrickSize != brickSize
+    || this->ScalarType != image->GetScalarType()
+    || this->NumberOfScalarComponents != image->GetNumberOfScalarComponents())
+    {
+    return false;
+    }
+  int* extent = this->Geometry->GetExtent();
+  int* imageExtent = image->GetExtent();
+  return std::equal(extent, extent + 6, imageExtent);
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationHistory::vtkBrickedLabelmap::GetBrickExtent(int bi, int bj, int bk, int brickExtent[6])
+{
+  int dimensions[3] = { 0, 0, 0 };
+  this->Geometry->GetDimensions(dimensions);
+  int brickIndex[3] = { bi, bj, bk };
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    brickExtent[2 * axis] = brickIndex[axis] * this->BrickSize;
+    brickExtent[2 * axis + 1] = std::min(brickExtent[2 * axis] + this->BrickSize, dimensions[axis]) - 1;
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationHistory::vtkBrickedLabelmap::SetImage(vtkOrientedImageData* image, int brickSize,
+  vtkBrickedLabelmap* baseline, const int* modifiedExtent)
+{
+  if (baseline && !baseline->HasSameLayout(image, brickSize))
+    {
+    baseline = NULL;
+    }
+  this->Source = image;
+  this->SourceMTime = image->GetMTime();
+
+  this->Geometry = vtkSmartPointer<vtkOrientedImageData>::New();
+  this->Geometry->SetExtent(image->GetExtent());
+  this->Geometry->SetOrigin(image->GetOrigin());
+  this->Geometry->SetSpacing(image->GetSpacing());
+  this->Geometry->CopyDirections(image);
+  this->ScalarType = image->GetScalarType();
+  this->NumberOfScalarComponents = (image->GetPointData()->GetScalars() ? image->GetNumberOfScalarComponents() : 0);
+  this->BrickSize = brickSize;
+  this->Bricks.clear();
+
+  int dimensions[3] = { 0, 0, 0 };
+  image->GetDimensions(dimensions);
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    this->NumberOfBricks[axis] = (this->NumberOfScalarComponents > 0 ? (dimensions[axis] + brickSize - 1) / brickSize : 0);
+    }
+  if (this->NumberOfScalarComponents == 0 || dimensions[0] == 0 || dimensions[1] == 0 || dimensions[2] == 0)
+    {
+    this->Modified();
+    return;
+    }
+
+  const size_t voxelSize = image->GetScalarSize() * this->NumberOfScalarComponents;
+  const size_t rowIncrement = dimensions[0] * voxelSize;
+  const size_t sliceIncrement = rowIncrement * dimensions[1];
+  const unsigned char* scalars = static_cast<const unsigned char*>(image->GetScalarPointer());
+  int* imageExtent = image->GetExtent();
+  for (int bk = 0; bk < this->NumberOfBricks[2]; ++bk)
+    {
+    for (int bj = 0; bj < this->NumberOfBricks[1]; ++bj)
+      {
+      for (int bi = 0; bi < this->NumberOfBricks[0]; ++bi)
+        {
+        int brickExtent[6] = { 0, 0, 0, 0, 0, 0 };
+        this->GetBrickExtent(bi, bj, bk, brickExtent);
+        const size_t brickRowSize = (brickExtent[1] - brickExtent[0] + 1) * voxelSize;
+
+        if (baseline && modifiedExtent)
+          {
+          int brickImageExtent[6] = { 0, 0, 0, 0, 0, 0 };
+          for (int i = 0; i < 6; ++i)
+            {
+            brickImageExtent[i] = brickExtent[i] + imageExtent[i - i % 2];
+            }
+          if (!Intersects(brickImageExtent, modifiedExtent))
+            {
+            // Not modified since the baseline
+            this->Bricks.push_back(baseline->Bricks[this->Bricks.size()]);
+            continue;
+            }
+          }
+
+        // Compare the brick to the baseline brick at the same location
+        vtkUnsignedCharArray* baselineBrick = NULL;
+        bool sameAsBaseline = (baseline != NULL);
+        bool zero = true;
+        if (baseline)
+          {
+          baselineBrick = baseline->Bricks[this->Bricks.size()];
+          }
+        const unsigned char* baselineRow = (baselineBrick ? baselineBrick->GetPointer(0) : NULL);
+        for (int k = brickExtent[4]; k <= brickExtent[5]; ++k)
+          {
+          for (int j = brickExtent[2]; j <= brickExtent[3]; ++j)
+            {
+            const unsigned char* row = scalars + k * sliceIncrement + j * rowIncrement + brickExtent[0] * voxelSize;
+            if (zero)
+              {
+              zero = IsZero(row, brickRowSize);
+              }
+            if (sameAsBaseline)
+              {
+              sameAsBaseline = (baselineRow ? memcmp(row, baselineRow, brickRowSize) == 0 : zero);
+              }
+            if (baselineRow)
+              {
+              baselineRow += brickRowSize;
+              }
+            }
+          }
+
+        if (sameAsBaseline)
+          {
+          this->Bricks.push_back(baselineBrick);
+          continue;
+          }
+        if (zero)
+          {
+          this->Bricks.push_back(vtkSmartPointer<vtkUnsignedCharArray>());
+          continue;
+          }
+        vtkSmartPointer<vtkUnsignedCharArray> brick = vtkSmartPointer<vtkUnsignedCharArray>::New();
+        brick->SetNumberOfValues(brickRowSize
+          * (brickExtent[3] - brickExtent[2] + 1) * (brickExtent[5] - brickExtent[4] + 1));
+        unsigned char* brickRow = brick->GetPointer(0);
+        for (int k = brickExtent[4]; k <= brickExtent[5]; ++k)
+          {
+          for (int j = brickExtent[2]; j <= brickExtent[3]; ++j)
+            {
+            memcpy(brickRow, scalars + k * sliceIncrement + j * rowIncrement + brickExtent[0] * voxelSize, brickRowSize);
+            brickRow += brickRowSize;
+            }
+          }
+        this->Bricks.push_back(brick);
+        }
+      }
+    }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationHistory::vtkBrickedLabelmap::GetImage(vtkOrientedImageData* image)
+{
+  image->SetExtent(this->Geometry->GetExtent());
+  image->SetOrigin(this->Geometry->GetOrigin());
+  image->SetSpacing(this->Geometry->GetSpacing());
+  image->CopyDirections(this->Geometry);
+  if (this->NumberOfScalarComponents == 0)
+    {
+    return;
+    }
+  image->AllocateScalars(this->ScalarType, this->NumberOfScalarComponents);
+
+  int dimensions[3] = { 0, 0, 0 };
+  image->GetDimensions(dimensions);
+  const size_t voxelSize = image->GetScalarSize() * this->NumberOfScalarComponents;
+  const size_t rowIncrement = dimensions[0] * voxelSize;
+  const size_t sliceIncrement = rowIncrement * dimensions[1];
+  unsigned char* scalars = static_cast<unsigned char*>(image->GetScalarPointer());
+  std::vector<vtkSmartPointer<vtkUnsignedCharArray> >::iterator brickIt = this->Bricks.begin();
+  for (int bk = 0; bk < this->NumberOfBricks[2]; ++bk)
+    {
+    for (int bj = 0; bj < this->NumberOfBricks[1]; ++bj)
+      {
+      for (int bi = 0; bi < this->NumberOfBricks[0]; ++bi, ++brickIt)
+        {
+        int brickExtent[6] = { 0, 0, 0, 0, 0, 0 };
+        this->GetBrickExtent(bi, bj, bk, brickExtent);
+        const size_t brickRowSize = (brickExtent[1] - brickExtent[0] + 1) * voxelSize;
+        const unsigned char* brickRow = (brickIt->GetPointer() ? (*brickIt)->GetPointer(0) : NULL);
+        for (int k = brickExtent[4]; k <= brickExtent[5]; ++k)
+          {
+          for (int j = brickExtent[2]; j <= brickExtent[3]; ++j)
+            {
+            unsigned char* row = scalars + k * sliceIncrement + j * rowIncrement + brickExtent[0] * voxelSize;
+            if (brickRow)
+              {
+              memcpy(row, brickRow, brickRowSize);
+              brickRow += brickRowSize;
+              }
+            else
+              {
+              memset(row, 0, brickRowSize);
+              }
+            }
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkSegmentationHistory::vtkBrickedLabelmap::GetBricks(std::set<vtkUnsignedCharArray*>& bricks)
+{
+  for (std::vector<vtkSmartPointer<vtkUnsignedCharArray> >::iterator brickIt = this->Bricks.begin();
+    brickIt != this->Bricks.end(); ++brickIt)
+    {
+    if (brickIt->GetPointer())
+      {
+      bricks.insert(brickIt->GetPointer());
+      }
+    }
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkSegmentationHistory);
@@ -37,6 +351,7 @@ vtkSegmentationHistory::vtkSegmentationHistory()
   this->Segmentation = NULL;
 
   this->MaximumNumberOfStates = 5;
+  this->BrickSize = 32;
 
   this->LastRestoredState = 0;
   this->RestoreStateInProgress = false;
@@ -81,6 +396,8 @@ void vtkSegmentationHistory::SetSegmentation(vtkSegmentation* segmentation)
     this->Segmentation->AddObserver(vtkSegmentation::SegmentRemoved, this->SegmentationModifiedCallbackCommand);
     this->Segmentation->AddObserver(vtkSegmentation::SegmentModified, this->SegmentationModifiedCallbackCommand);
     this->Segmentation->AddObserver(vtkSegmentation::MasterRepresentationModified, this->SegmentationModifiedCallbackCommand);
+    // Extents modified since the last saved state
+    this->Segmentation->AddObserver(vtkSegmentation::MasterRepresentationExtentModified, this->SegmentationModifiedCallbackCommand);
     //this->Segmentation->AddObserver(vtkSegmentation::ContainedRepresentationNamesModified, this->SegmentationModifiedCallbackCommand);
     }
 }
@@ -95,6 +412,7 @@ void vtkSegmentationHistory::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Modified Time: " << this->GetMTime() << "\n";
 
   os << indent << "Number of saved states:  " << this->SegmentationStates.size() << "\n";
+  os << indent << "BrickSize:  " << this->BrickSize << "\n";
 }
 
 //---------------------------------------------------------------------------
@@ -130,19 +448,37 @@ bool vtkSegmentationHistory::SaveState()
     // Previous saved state of the segment
     // (if the new state has exactly the same representation then only a shallow copy will be made)
     vtkSegment* baselineSegment = NULL;
+    LabelmapsMap* baselineLabelmaps = NULL;
     if (this->SegmentationStates.size() > 0)
       {
-      SegmentsMap::iterator baselineSegmentIt = this->SegmentationStates.back().Segments.find(*segmentIDIt);
-      if (baselineSegmentIt != this->SegmentationStates.back().Segments.end())
+      SegmentationState& baselineState = this->SegmentationStates.back();
+      SegmentsMap::iterator baselineSegmentIt = baselineState.Segments.find(*segmentIDIt);
+      if (baselineSegmentIt != baselineState.Segments.end())
         {
         baselineSegment = baselineSegmentIt->second.GetPointer();
+        baselineLabelmaps = &baselineState.Labelmaps[*segmentIDIt];
+        }
+      }
+    // Extent of the master labelmap modified since the previous saved state, if all modifications were reported
+    const int* modifiedExtent = NULL;
+    std::map<std::string, ModifiedLabelmap>::iterator modifiedIt = this->ModifiedLabelmaps.find(*segmentIDIt);
+    if (modifiedIt != this->ModifiedLabelmaps.end())
+      {
+      vtkOrientedImageData* labelmap = vtkOrientedImageData::SafeDownCast(
+        segment->GetRepresentation(this->Segmentation->GetMasterRepresentationName()));
+      if (labelmap && modifiedIt->second.Labelmap.GetPointer() == labelmap
+        && labelmap->GetMTime() <= modifiedIt->second.MTime)
+        {
+        modifiedExtent = modifiedIt->second.Extent;
         }
       }
     vtkSmartPointer<vtkSegment> segmentClone = vtkSmartPointer<vtkSegment>::New();
-    CopySegment(segmentClone, segment, baselineSegment);
+    CopySegment(segmentClone, segment, baselineSegment,
+      newSegmentationState.Labelmaps[*segmentIDIt], baselineLabelmaps, modifiedExtent);
     newSegmentationState.Segments[*segmentIDIt] = segmentClone;
     }
   this->SegmentationStates.push_back(newSegmentationState);
+  this->ModifiedLabelmaps.clear();
 
   // Set the current state as last restored state
   this->LastRestoredState = this->SegmentationStates.size();
@@ -153,10 +489,12 @@ bool vtkSegmentationHistory::SaveState()
 }
 
 //---------------------------------------------------------------------------
-void vtkSegmentationHistory::CopySegment(vtkSegment* destination, vtkSegment* source, vtkSegment* baseline)
+void vtkSegmentationHistory::CopySegment(vtkSegment* destination, vtkSegment* source, vtkSegment* baseline,
+  LabelmapsMap& destinationLabelmaps, LabelmapsMap* baselineLabelmaps, const int* modifiedExtent)
 {
   destination->RemoveAllRepresentations();
   destination->DeepCopyMetadata(source);
+  destinationLabelmaps.clear();
 
   // Copy representations
   std::vector<std::string> representationNames;
@@ -165,6 +503,38 @@ void vtkSegmentationHistory::CopySegment(vtkSegment* destination, vtkSegment* so
     representationNameIt != representationNames.end(); ++representationNameIt)
     {
     vtkDataObject* sourceRepresentation = source->GetRepresentation(*representationNameIt);
+
+    vtkOrientedImageData* sourceLabelmap = vtkOrientedImageData::SafeDownCast(sourceRepresentation);
+    if (sourceLabelmap)
+      {
+      vtkBrickedLabelmap* baselineLabelmap = NULL;
+      if (baselineLabelmaps)
+        {
+        LabelmapsMap::iterator baselineLabelmapIt = baselineLabelmaps->find(*representationNameIt);
+        if (baselineLabelmapIt != baselineLabelmaps->end())
+          {
+          baselineLabelmap = baselineLabelmapIt->second;
+          }
+        }
+      if (baselineLabelmap != NULL
+        && baselineLabelmap->GetMTime() > sourceLabelmap->GetMTime())
+        {
+        // we already have an up-to-date copy in the baseline, so reuse that
+        destinationLabelmaps[*representationNameIt] = baselineLabelmap;
+        }
+      else
+        {
+        // only copy the bricks that changed since the baseline
+        bool isMasterRepresentation = (this->Segmentation
+          && *representationNameIt == this->Segmentation->GetMasterRepresentationName());
+        vtkSmartPointer<vtkBrickedLabelmap> labelmapCopy = vtkSmartPointer<vtkBrickedLabelmap>::New();
+        labelmapCopy->SetImage(sourceLabelmap, this->BrickSize, baselineLabelmap,
+          isMasterRepresentation ? modifiedExtent : NULL);
+        destinationLabelmaps[*representationNameIt] = labelmapCopy;
+        }
+      continue;
+      }
+
     vtkDataObject* baselineRepresentation = NULL;
     if (baseline)
       {
@@ -193,6 +563,20 @@ void vtkSegmentationHistory::CopySegment(vtkSegment* destination, vtkSegment* so
     }
 }
 
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkSegment> vtkSegmentationHistory::CreateSegmentFromState(vtkSegment* storedSegment, LabelmapsMap& labelmaps)
+{
+  vtkSmartPointer<vtkSegment> segment = vtkSmartPointer<vtkSegment>::New();
+  segment->DeepCopy(storedSegment);
+  for (LabelmapsMap::iterator labelmapIt = labelmaps.begin(); labelmapIt != labelmaps.end(); ++labelmapIt)
+    {
+    vtkSmartPointer<vtkOrientedImageData> labelmap = vtkSmartPointer<vtkOrientedImageData>::New();
+    labelmapIt->second->GetImage(labelmap);
+    segment->AddRepresentation(labelmapIt->first, labelmap);
+    }
+  return segment;
+}
+
 //---------------------------------------------------------------------------
 bool vtkSegmentationHistory::RestorePreviousState()
 {
@@ -252,17 +636,34 @@ bool vtkSegmentationHistory::RestoreState(unsigned int stateIndex)
     restoredSegmentsIt != restoredState.Segments.end(); ++restoredSegmentsIt)
     {
     segmentIDsToKeep.insert(restoredSegmentsIt->first);
+    vtkSmartPointer<vtkSegment> restoredSegment = this->CreateSegmentFromState(
+      restoredSegmentsIt->second, restoredState.Labelmaps[restoredSegmentsIt->first]);
     vtkSegment* segment = this->Segmentation->GetSegment(restoredSegmentsIt->first);
     if (segment != NULL)
       {
-      segment->DeepCopy(restoredSegmentsIt->second);
+      // The representations of the restored segment are new objects, they can be moved into the segment
+      segment->DeepCopyMetadata(restoredSegment);
+      std::vector<std::string> representationNames;
+      segment->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator representationNameIt = representationNames.begin();
+        representationNameIt != representationNames.end(); ++representationNameIt)
+        {
+        if (!restoredSegment->GetRepresentation(*representationNameIt))
+          {
+          segment->RemoveRepresentation(*representationNameIt);
+          }
+        }
+      restoredSegment->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator representationNameIt = representationNames.begin();
+        representationNameIt != representationNames.end(); ++representationNameIt)
+        {
+        segment->AddRepresentation(*representationNameIt, restoredSegment->GetRepresentation(*representationNameIt));
+        }
       segment->Modified();
       }
     else
       {
-      vtkSmartPointer<vtkSegment> newSegment = vtkSmartPointer<vtkSegment>::New();
-      newSegment->DeepCopy(restoredSegmentsIt->second);
-      this->Segmentation->AddSegment(newSegment);
+      this->Segmentation->AddSegment(restoredSegment);
       }
     }
 
@@ -282,6 +683,8 @@ bool vtkSegmentationHistory::RestoreState(unsigned int stateIndex)
   this->Segmentation->ReorderSegments(restoredState.SegmentIds);
 
   this->LastRestoredState = stateIndex;
+  // The restored labelmaps are new images, they are compared entirely when saved
+  this->ModifiedLabelmaps.clear();
 
   this->RestoreStateInProgress = false;
   this->Modified();
@@ -352,9 +755,9 @@ void vtkSegmentationHistory::SetMaximumNumberOfStates(unsigned int maximumNumber
 
 //---------------------------------------------------------------------------
 void vtkSegmentationHistory::OnSegmentationModified(vtkObject* vtkNotUsed(caller),
-  unsigned long vtkNotUsed(eid),
+  unsigned long eid,
   void* clientData,
-  void* vtkNotUsed(callData))
+  void* callData)
 {
   vtkSegmentationHistory* self = reinterpret_cast<vtkSegmentationHistory*>(clientData);
   if (!self)
@@ -367,6 +770,12 @@ void vtkSegmentationHistory::OnSegmentationModified(vtkObject* vtkNotUsed(caller
     // This object causes the changes, this object handles it
     return;
     }
+  if (eid == vtkSegmentation::MasterRepresentationExtentModified)
+    {
+    // MasterRepresentationModified follows
+    self->AddModifiedExtent(static_cast<vtkSegmentation::MasterRepresentationExtentModifiedInfo*>(callData));
+    return;
+    }
   self->RemoveAllNextStates();
   if (self->LastRestoredState != self->SegmentationStates.size())
     {
@@ -375,10 +784,136 @@ void vtkSegmentationHistory::OnSegmentationModified(vtkObject* vtkNotUsed(caller
     }
 }
 
+//---------------------------------------------------------------------------
+vtkSegmentationHistory::SegmentationState* vtkSegmentationHistory::GetBaselineState()
+{
+  if (this->SegmentationStates.empty())
+    {
+    return NULL;
+    }
+  // States after the last restored state are removed before saving
+  unsigned int stateIndex = std::min<unsigned int>(this->LastRestoredState, this->SegmentationStates.size() - 1);
+  return &this->SegmentationStates[stateIndex];
+}
+
+//---------------------------------------------------------------------------
+void vtkSegmentationHistory::AddModifiedExtent(vtkSegmentation::MasterRepresentationExtentModifiedInfo* info)
+{
+  if (!info || !info->SegmentID || !this->Segmentation)
+    {
+    return;
+    }
+  const std::string segmentID = info->SegmentID;
+  vtkSegment* segment = this->Segmentation->GetSegment(segmentID);
+  vtkOrientedImageData* labelmap = (segment ? vtkOrientedImageData::SafeDownCast(
+    segment->GetRepresentation(this->Segmentation->GetMasterRepresentationName())) : NULL);
+
+  // The extent can only be used if the labelmap was not modified in any other way
+  // since it was saved in the baseline state
+  std::map<std::string, ModifiedLabelmap>::iterator modifiedIt = this->ModifiedLabelmaps.find(segmentID);
+  bool previousModificationsKnown = false;
+  if (modifiedIt != this->ModifiedLabelmaps.end())
+    {
+    previousModificationsKnown = (labelmap && modifiedIt->second.Labelmap.GetPointer() == labelmap
+      && info->PreviousMTime <= modifiedIt->second.MTime);
+    }
+  else
+    {
+    SegmentationState* baselineState = this->GetBaselineState();
+    if (baselineState)
+      {
+      std::map<std::string, LabelmapsMap>::iterator labelmapsIt = baselineState->Labelmaps.find(segmentID);
+      if (labelmapsIt != baselineState->Labelmaps.end())
+        {
+        LabelmapsMap::iterator labelmapIt = labelmapsIt->second.find(this->Segmentation->GetMasterRepresentationName());
+        previousModificationsKnown = (labelmapIt != labelmapsIt->second.end()
+          && labelmapIt->second->IsCopyOf(labelmap, info->PreviousMTime));
+        }
+      }
+    }
+  if (!previousModificationsKnown)
+    {
+    // The whole labelmap will be compared to the baseline
+    if (modifiedIt != this->ModifiedLabelmaps.end())
+      {
+      this->ModifiedLabelmaps.erase(modifiedIt);
+      }
+    return;
+    }
+
+  const int* extent = info->Extent;
+  if (modifiedIt == this->ModifiedLabelmaps.end())
+    {
+    ModifiedLabelmap& modifiedLabelmap = this->ModifiedLabelmaps[segmentID];
+    std::copy(extent, extent + 6, modifiedLabelmap.Extent);
+    modifiedIt = this->ModifiedLabelmaps.find(segmentID);
+    }
+  else if (extent[0] <= extent[1] && extent[2] <= extent[3] && extent[4] <= extent[5])
+    {
+    int* modifiedExtent = modifiedIt->second.Extent;
+    if (modifiedExtent[0] > modifiedExtent[1] || modifiedExtent[2] > modifiedExtent[3] || modifiedExtent[4] > modifiedExtent[5])
+      {
+      std::copy(extent, extent + 6, modifiedExtent);
+      }
+    else
+      {
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        modifiedExtent[2 * axis] = std::min(modifiedExtent[2 * axis], extent[2 * axis]);
+        modifiedExtent[2 * axis + 1] = std::max(modifiedExtent[2 * axis + 1], extent[2 * axis + 1]);
+        }
+      }
+    }
+  modifiedIt->second.Labelmap = labelmap;
+  modifiedIt->second.MTime = labelmap->GetMTime();
+}
+
 //---------------------------------------------------------------------------
 void vtkSegmentationHistory::RemoveAllStates()
 {
   this->SegmentationStates.clear();
+  this->ModifiedLabelmaps.clear();
   this->LastRestoredState = 0;
   this->Modified();
 }
+
+//---------------------------------------------------------------------------
+unsigned long vtkSegmentationHistory::GetMemorySize()
+{
+  std::set<vtkDataObject*> representations;
+  std::set<vtkUnsignedCharArray*> bricks;
+  for (std::deque<SegmentationState>::iterator stateIt = this->SegmentationStates.begin();
+    stateIt != this->SegmentationStates.end(); ++stateIt)
+    {
+    for (SegmentsMap::iterator segmentIt = stateIt->Segments.begin(); segmentIt != stateIt->Segments.end(); ++segmentIt)
+      {
+      std::vector<std::string> representationNames;
+      segmentIt->second->GetContainedRepresentationNames(representationNames);
+      for (std::vector<std::string>::iterator representationNameIt = representationNames.begin();
+        representationNameIt != representationNames.end(); ++representationNameIt)
+        {
+        representations.insert(segmentIt->second->GetRepresentation(*representationNameIt));
+        }
+      }
+    for (std::map<std::string, LabelmapsMap>::iterator labelmapsIt = stateIt->Labelmaps.begin();
+      labelmapsIt != stateIt->Labelmaps.end(); ++labelmapsIt)
+      {
+      for (LabelmapsMap::iterator labelmapIt = labelmapsIt->second.begin(); labelmapIt != labelmapsIt->second.end(); ++labelmapIt)
+        {
+        labelmapIt->second->GetBricks(bricks);
+        }
+      }
+    }
+
+  unsigned long memorySize = 0;
+  for (std::set<vtkDataObject*>::iterator representationIt = representations.begin();
+    representationIt != representations.end(); ++representationIt)
+    {
+    memorySize += (*representationIt)->GetActualMemorySize();
+    }
+  for (std::set<vtkUnsignedCharArray*>::iterator brickIt = bricks.begin(); brickIt != bricks.end(); ++brickIt)
+    {
+    memorySize += (*brickIt)->GetActualMemorySize();
+    }
+  return memorySize;
+}
@@ -24,19 +24,33 @@
 // VTK includes
 #include <vtkObject.h>
 #include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
 
 // STD includes
 #include <deque>
 #include <map>
 #include <vector>
 
+// SegmentationCore includes
+#include "vtkSegmentation.h"
+
 #include "vtkSegmentationCoreConfigure.h"
 
 class vtkCallbackCommand;
+class vtkOrientedImageData;
 class vtkSegment;
-class vtkSegmentation;
 
 /// \ingroup SegmentationCore
+/// \brief Stores the states of a segmentation for undo/redo.
+///
+/// Unchanged representations are shared between states. Labelmap
+/// representations are stored as bricks of BrickSize^3 voxels: when a
+/// labelmap changes, only the bricks that differ from the previous state are
+/// copied, and bricks that contain only zeros are not stored at all.
+/// Therefore a state saved after a local edit of a large labelmap only costs
+/// the memory of the bricks that the edit touched. When the edits report the
+/// extent they modified (vtkSegmentation::MasterRepresentationExtentModified
+/// event), only the bricks in that extent are compared when the state is saved.
 class vtkSegmentationCore_EXPORT vtkSegmentationHistory : public vtkObject
 {
 public:
@@ -82,11 +96,23 @@ public:
   /// Get the limit of how many states may be stored.
   vtkGetMacro(MaximumNumberOfStates, unsigned int);
 
+  /// Number of voxels along each axis of the bricks that labelmaps are stored in.
+  /// Changing it only affects the states saved afterwards. Default is 32.
+  vtkSetClampMacro(BrickSize, int, 1, VTK_INT_MAX);
+  vtkGetMacro(BrickSize, int);
+
+  /// Memory used by the stored states, in kibibytes.
+  /// Data shared between states is counted once.
+  unsigned long GetMemorySize();
+
 protected:
   /// Callback function called when the segmentation has been modified.
   /// It clears all states that are more recent than the last restored state.
   static void OnSegmentationModified(vtkObject* caller, unsigned long eid, void* clientData, void* callData);
 
+  /// Record the extent modified in the master labelmap of a segment since the last saved state.
+  void AddModifiedExtent(vtkSegmentation::MasterRepresentationExtentModifiedInfo* info);
+
   /// Delete all states that are more recent than the last restored state
   void RemoveAllNextStates();
 
@@ -101,9 +127,21 @@ protected:
   ~vtkSegmentationHistory();
   void operator=(const vtkSegmentationHistory&);
 
+  /// Labelmap representation stored as bricks, shared between states
+  class vtkBrickedLabelmap;
+  /// Maps representation names to labelmap representations
+  typedef std::map<std::string, vtkSmartPointer<vtkBrickedLabelmap> > LabelmapsMap;
+
   /// Deep copies source segment to destination segment. If the same representation is found in baseline
   /// with up-to-date timestamp then the representation is reused from baseline.
-  void CopySegment(vtkSegment* destination, vtkSegment* source, vtkSegment* baseline);
+  /// Labelmap representations are stored in destinationLabelmaps instead of the destination segment,
+  /// sharing the unchanged bricks with baselineLabelmaps.
+  /// If modifiedExtent is not NULL, the master labelmap only differs from the baseline in this extent.
+  void CopySegment(vtkSegment* destination, vtkSegment* source, vtkSegment* baseline,
+    LabelmapsMap& destinationLabelmaps, LabelmapsMap* baselineLabelmaps, const int* modifiedExtent);
+
+  /// Create a segment from a stored segment and its labelmap representations.
+  vtkSmartPointer<vtkSegment> CreateSegmentFromState(vtkSegment* storedSegment, LabelmapsMap& labelmaps);
 
 protected:  /// Container type for segments. Maps segment IDs to segment objects
   typedef std::map<std::string, vtkSmartPointer<vtkSegment> > SegmentsMap;
@@ -111,14 +149,31 @@ protected:  /// Container type for segments. Maps segment IDs to segment objects
   struct SegmentationState
     {
     SegmentsMap Segments;
+    std::map<std::string, LabelmapsMap> Labelmaps; // labelmap representations of each segment
     std::vector<std::string> SegmentIds; // order of segments
     };
 
+  /// State that the next saved state is compared to, NULL if there is none
+  SegmentationState* GetBaselineState();
+
   vtkSegmentation* Segmentation;
   vtkCallbackCommand* SegmentationModifiedCallbackCommand;
   std::deque<SegmentationState> SegmentationStates;
   unsigned int MaximumNumberOfStates;
 
+  /// Master labelmap modified only in a known extent since the last saved state
+  struct ModifiedLabelmap
+    {
+    vtkWeakPointer<vtkOrientedImageData> Labelmap;
+    /// Modified time of the labelmap after the last reported modification
+    vtkMTimeType MTime;
+    int Extent[6];
+    };
+  /// Maps segment IDs to the extent modified since the last saved state.
+  /// Segments that are not found are compared entirely.
+  std::map<std::string, ModifiedLabelmap> ModifiedLabelmaps;
+  int BrickSize;
+
   // Index of the state in SegmentationStates that was restored last.
   // If index == size of states then it means that the segmentation has changed
   // since the last restored state.
@@ -0,0 +1,242 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// vtkTeem includes
+#include <vtkNRRDReader.h>
+#include <vtkNRRDWriter.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+
+// Teem includes
+#include <teem/nrrd.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckImage(vtkImageData* expected, vtkImageData* image, int line)
+{
+  if (!image || !image->GetPointData()->GetScalars())
+    {
+    std::cerr << "Line " << line << ": image is empty" << std::endl;
+    return false;
+    }
+  int* expectedDimensions = expected->GetDimensions();
+  int* dimensions = image->GetDimensions();
+  if (dimensions[0] != expectedDimensions[0]
+    || dimensions[1] != expectedDimensions[1]
+    || dimensions[2] != expectedDimensions[2]
+    || image->GetScalarType() != expected->GetScalarType())
+    {
+    std::cerr << "Line " << line << ": image geometry mismatch" << std::endl;
+    return false;
+    }
+  if (memcmp(image->GetScalarPointer(), expected->GetScalarPointer(),
+             expected->GetPointData()->GetScalars()->GetDataSize() * expected->GetScalarSize()) != 0)
+    {
+    std::cerr << "Line " << line << ": image content mismatch" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool ReadAndCheck(const std::string& fileName, vtkImageData* expected, int numberOfThreads, int line)
+{
+  vtkNew<vtkNRRDReader> reader;
+  reader->SetNumberOfThreads(numberOfThreads);
+  reader->SetFileName(fileName.c_str());
+  reader->Update();
+  if (reader->GetHeaderValue(vtkNRRDWriter::GetCompressedBlockSizesKey()))
+    {
+    std::cerr << "Line " << line << ": block index is exposed as a header field" << std::endl;
+    return false;
+    }
+  return CheckImage(expected, reader->GetOutput(), line);
+}
+
+//----------------------------------------------------------------------------
+/// Read the file with teem only, as any other NRRD reader would.
+bool ReadWithTeemAndCheck(const std::string& fileName, vtkImageData* expected, int line)
+{
+  Nrrd* nrrd = nrrdNew();
+  if (nrrdLoad(nrrd, fileName.c_str(), NULL) != 0)
+    {
+    char* err = biffGetDone(NRRD);
+    std::cerr << "Line " << line << ": teem failed to read " << fileName << ": " << err << std::endl;
+    free(err);
+    nrrdNuke(nrrd);
+    return false;
+    }
+  bool same = (nrrdElementSize(nrrd) * nrrdElementNumber(nrrd)
+                 == static_cast<size_t>(expected->GetPointData()->GetScalars()->GetDataSize() * expected->GetScalarSize())
+               && memcmp(nrrd->data, expected->GetScalarPointer(), nrrdElementSize(nrrd) * nrrdElementNumber(nrrd)) == 0);
+  nrrdNuke(nrrd);
+  if (!same)
+    {
+    std::cerr << "Line " << line << ": teem image content mismatch" << std::endl;
+    }
+  return same;
+}
+
+//----------------------------------------------------------------------------
+/// Save the file again with teem as a single gzip stream, as another
+/// application would. The block index key/values are kept.
+bool ResaveWithTeem(const std::string& fileName, const std::string& newFileName, int line)
+{
+  Nrrd* nrrd = nrrdNew();
+  NrrdIoState* nio = nrrdIoStateNew();
+  nio->encoding = nrrdEncodingGzip;
+  bool success = (nrrdLoad(nrrd, fileName.c_str(), NULL) == 0);
+  char* blockSizes = success ? nrrdKeyValueGet(nrrd, vtkNRRDWriter::GetCompressedBlockSizesKey()) : NULL;
+  success = (blockSizes != NULL && nrrdSave(newFileName.c_str(), nrrd, nio) == 0);
+  free(blockSizes); // blockSizes points to malloc'd data
+  nio = nrrdIoStateNix(nio);
+  nrrdNuke(nrrd);
+  if (!success)
+    {
+    std::cerr << "Line " << line << ": teem failed to save " << fileName << " again" << std::endl;
+    }
+  return success;
+}
+
+//----------------------------------------------------------------------------
+bool Write(const std::string& fileName, vtkImageData* image, int numberOfThreads, int compressionLevel)
+{
+  vtkNew<vtkNRRDWriter> writer;
+  writer->SetInputData(image);
+  writer->SetFileName(fileName.c_str());
+  writer->SetNumberOfThreads(numberOfThreads);
+  writer->SetCompressionLevel(compressionLevel);
+  // Many small blocks
+  writer->SetCompressionBlockSize(10000);
+  writer->Write();
+  return !writer->GetWriteError();
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkNRRDWriterCompressionTest1(int argc, char* argv[])
+{
+  if (argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " /path/to/temp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const std::string tempDir = argv[1];
+
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(50, 40, 30);
+  image->AllocateScalars(VTK_SHORT, 1);
+  short* scalars = static_cast<short*>(image->GetScalarPointer());
+  for (vtkIdType i = 0; i < 50 * 40 * 30; ++i)
+    {
+    scalars[i] = static_cast<short>((i * 7) % 1000 - 500);
+    }
+
+  // Data compressed in parallel blocks
+  const std::string blockFileName = tempDir + "/vtkNRRDWriterCompressionTest1_blocks.nrrd";
+  if (!Write(blockFileName, image.GetPointer(), 4, 1)
+    || !ReadAndCheck(blockFileName, image.GetPointer(), 4, __LINE__)
+    || !ReadAndCheck(blockFileName, image.GetPointer(), 1, __LINE__)
+    || !ReadWithTeemAndCheck(blockFileName, image.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // More threads and blocks than vtkMultiThreader supports
+  vtkNew<vtkImageData> largeImage;
+  largeImage->SetDimensions(100, 100, 100);
+  largeImage->AllocateScalars(VTK_SHORT, 1);
+  scalars = static_cast<short*>(largeImage->GetScalarPointer());
+  for (vtkIdType i = 0; i < 100 * 100 * 100; ++i)
+    {
+    scalars[i] = static_cast<short>((i * 13) % 2000 - 1000);
+    }
+  const std::string manyThreadsFileName = tempDir + "/vtkNRRDWriterCompressionTest1_threads.nrrd";
+  if (!Write(manyThreadsFileName, largeImage.GetPointer(), 4 * VTK_MAX_THREADS, 1)
+    || !ReadAndCheck(manyThreadsFileName, largeImage.GetPointer(), 4 * VTK_MAX_THREADS, __LINE__)
+    || !ReadWithTeemAndCheck(manyThreadsFileName, largeImage.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The multithreader runs fewer threads than requested
+  const std::string clampedThreadsFileName = tempDir + "/vtkNRRDWriterCompressionTest1_clamped.nrrd";
+  int globalMaximumNumberOfThreads = vtkMultiThreader::GetGlobalMaximumNumberOfThreads();
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(2);
+  bool clampedThreadsSuccess = Write(clampedThreadsFileName, largeImage.GetPointer(), 8, 1)
+    && ReadAndCheck(clampedThreadsFileName, largeImage.GetPointer(), 8, __LINE__);
+  vtkMultiThreader::SetGlobalMaximumNumberOfThreads(globalMaximumNumberOfThreads);
+  if (!clampedThreadsSuccess
+    || !ReadAndCheck(clampedThreadsFileName, largeImage.GetPointer(), 1, __LINE__)
+    || !ReadWithTeemAndCheck(clampedThreadsFileName, largeImage.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Block index left over in a file saved again as a single gzip stream
+  const std::string resavedFileName = tempDir + "/vtkNRRDWriterCompressionTest1_resaved.nrrd";
+  if (!ResaveWithTeem(blockFileName, resavedFileName, __LINE__)
+    || !ReadAndCheck(resavedFileName, image.GetPointer(), 4, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Standard gzip encoding written by teem
+  const std::string gzipFileName = tempDir + "/vtkNRRDWriterCompressionTest1_gzip.nrrd";
+  if (!Write(gzipFileName, image.GetPointer(), 1, -1)
+    || !ReadAndCheck(gzipFileName, image.GetPointer(), 4, __LINE__)
+    || !ReadWithTeemAndCheck(gzipFileName, image.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Detached headers are always written by teem, whatever the extension case
+  const char* detachedExtensions[2] = { ".nhdr", ".NHDR" };
+  for (int i = 0; i < 2; ++i)
+    {
+    const std::string detachedFileName = tempDir + "/vtkNRRDWriterCompressionTest1_" + (i == 0 ? "lower" : "upper") + detachedExtensions[i];
+    if (!Write(detachedFileName, image.GetPointer(), 4, 9)
+      || !ReadAndCheck(detachedFileName, image.GetPointer(), 4, __LINE__))
+      {
+      return EXIT_FAILURE;
+      }
+    Nrrd* nrrd = nrrdNew();
+    bool loaded = (nrrdLoad(nrrd, detachedFileName.c_str(), NULL) == 0);
+    char* blockSize = loaded ? nrrdKeyValueGet(nrrd, vtkNRRDWriter::GetCompressionBlockSizeKey()) : NULL;
+    bool detached = (loaded && blockSize == NULL);
+    free(blockSize); // blockSize points to malloc'd data
+    nrrdNuke(nrrd);
+    if (!detached)
+      {
+      std::cerr << "Line " << __LINE__ << ": " << detachedFileName << " is not a detached header written by teem" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << "Test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -27,6 +27,7 @@
 =========================================================================*/
 // vtkTeem includes
 #include "vtkNRRDReader.h"
+#include "vtkNRRDWriter.h"
 
 // VTK includes
 #include "vtkBitArray.h"
@@ -39,6 +40,7 @@
 #include "vtkIntArray.h"
 #include "vtkLongArray.h"
 #include "vtkMath.h"
+#include <vtkMultiThreader.h>
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkShortArray.h"
@@ -47,13 +49,79 @@
 #include "vtkUnsignedShortArray.h"
 #include "vtkUnsignedIntArray.h"
 #include "vtkUnsignedLongArray.h"
+#include <vtk_zlib.h>
 #include <vtksys/SystemTools.hxx>
 
 // Teem includes
 #include "teem/ten.h"
 
+// STD includes
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
 vtkStandardNewMacro(vtkNRRDReader);
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Blocks of compressed data decompressed by multiple threads into the
+/// image buffer. Each thread decompresses every NumberOfThreads-th block.
+struct BlockDecompressionJob
+{
+  const unsigned char* CompressedData;
+  /// Offset of each block in the compressed data, followed by the total size.
+  std::vector<vtkIdType> CompressedOffsets;
+  unsigned char* Data;
+  vtkIdType DataSize;
+  vtkIdType BlockSize;
+  /// Not a vector<bool>: the threads set the flags of their blocks concurrently.
+  std::vector<char> Failed;
+};
+
+//----------------------------------------------------------------------------
+/// Decompress a complete gzip member that must fill the output buffer.
+bool DecompressBlock(const unsigned char* compressed, vtkIdType compressedSize,
+                     unsigned char* data, vtkIdType size)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 15 + 16: maximum window size, with gzip header and trailer
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    {
+    return false;
+    }
+  stream.next_in = const_cast<Bytef*>(compressed);
+  stream.avail_in = static_cast<uInt>(compressedSize);
+  stream.next_out = data;
+  stream.avail_out = static_cast<uInt>(size);
+  bool success = (inflate(&stream, Z_FINISH) == Z_STREAM_END
+    && stream.avail_in == 0 && stream.avail_out == 0);
+  inflateEnd(&stream);
+  return success;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE DecompressBlocksThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BlockDecompressionJob* job = static_cast<BlockDecompressionJob*>(info->UserData);
+  const vtkIdType numberOfBlocks = static_cast<vtkIdType>(job->Failed.size());
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()).
+  for (vtkIdType b = info->ThreadID; b < numberOfBlocks; b += info->NumberOfThreads)
+    {
+    const vtkIdType offset = b * job->BlockSize;
+    job->Failed[b] = !DecompressBlock(job->CompressedData + job->CompressedOffsets[b],
+      job->CompressedOffsets[b + 1] - job->CompressedOffsets[b],
+      job->Data + offset, std::min(job->BlockSize, job->DataSize - offset));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+};
+
 //----------------------------------------------------------------------------
 vtkNRRDReader::vtkNRRDReader()
 {
@@ -66,6 +134,8 @@ vtkNRRDReader::vtkNRRDReader()
   this->PointDataType = -1;
   this->DataType = -1;
   this->NumberOfComponents = -1;
+  this->NumberOfThreads = 0;
+  this->CompressionBlockSize = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -343,6 +413,8 @@ void vtkNRRDReader::ExecuteInformation()
     return;
     }
   this->CurrentFileName = this->GetFileName();
+  this->CompressionBlockSize = 0;
+  this->CompressedBlockSizes.clear();
 
   nrrdNuke(this->nrrd); // nuke and reallocate to reset the state
   this->nrrd = nrrdNew();
@@ -588,10 +660,36 @@ void vtkNRRDReader::ExecuteInformation()
     char *key = NULL;
     char *val = NULL;
     nrrdKeyValueIndex(this->nrrd, &key, &val, i);
-    HeaderKeyValue[std::string(key)] = std::string(val);
+    // The block index of the data is not exposed as a header field, it
+    // would be obsolete once the image is saved again
+    if (!strcmp(key, vtkNRRDWriter::GetCompressionBlockSizeKey()))
+      {
+      std::stringstream ss(val);
+      ss >> this->CompressionBlockSize;
+      }
+    else if (!strcmp(key, vtkNRRDWriter::GetCompressedBlockSizesKey()))
+      {
+      std::stringstream ss(val);
+      vtkIdType compressedBlockSize = 0;
+      while (ss >> compressedBlockSize)
+        {
+        this->CompressedBlockSizes.push_back(compressedBlockSize);
+        }
+      }
+    else
+      {
+      HeaderKeyValue[std::string(key)] = std::string(val);
+      }
     free(key);  // key and val point to malloc'd data!!
     free(val);
     }
+  // Only attached gzip data can be decompressed in blocks
+  if (this->CompressionBlockSize <= 0
+    || nio->encoding != nrrdEncodingGzip || nio->dataFNArr->len > 0)
+    {
+    this->CompressionBlockSize = 0;
+    this->CompressedBlockSizes.clear();
+    }
 
   const char* labels[NRRD_DIM_MAX] = { 0 };
   nrrdAxisInfoGet_nva(nrrd, nrrdAxisInfoLabel, labels);
@@ -909,7 +1007,18 @@ void vtkNRRDReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
 
   // Read in the this->nrrd.  Yes, this means that the header is being read
   // twice: once by ExecuteInformation, and once here
-  if ( nrrdLoad(this->nrrd, this->GetFileName(), NULL) != 0 )
+  bool dataLoaded = false;
+  if (!this->CompressedBlockSizes.empty())
+    {
+    // The block keys may have been kept by an application that saved the
+    // file again as a single gzip stream, then teem reads the data.
+    dataLoaded = (this->ReadCompressedBlocks() == 0);
+    if (!dataLoaded)
+      {
+      nrrdEmpty(this->nrrd);
+      }
+    }
+  if (!dataLoaded && nrrdLoad(this->nrrd, this->GetFileName(), NULL) != 0)
     {
     char *err =  biffGetDone(NRRD); // would be nice to free(err)
     vtkErrorMacro("Read: Error reading " << this->GetFileName() << ":\n" << err);
@@ -1092,8 +1201,115 @@ void vtkNRRDReader::ExecuteDataWithInformation(vtkDataObject *output, vtkInforma
   nrrdEmpty(this->nrrd);
 }
 
+//----------------------------------------------------------------------------
+int vtkNRRDReader::ReadCompressedBlocks()
+{
+  // Read the header again to reset the axes, that may have been permuted
+  NrrdIoState *nio = nrrdIoStateNew();
+  nrrdIoStateSet(nio, nrrdIoStateSkipData, 1);
+  if (nrrdLoad(this->nrrd, this->GetFileName(), nio) != 0)
+    {
+    char *err = biffGetDone(NRRD);
+    vtkDebugMacro("Read: Error reading " << this->GetFileName() << ":\n" << err);
+    free(err); // err points to malloc'd data!!
+    nio = nrrdIoStateNix(nio);
+    return 1;
+    }
+  const int endian = nio->endian;
+  nio = nrrdIoStateNix(nio);
+
+  size_t size[NRRD_DIM_MAX] = { 0 };
+  nrrdAxisInfoGet_nva(this->nrrd, nrrdAxisInfoSize, size);
+  if (nrrdMaybeAlloc_nva(this->nrrd, this->nrrd->type, this->nrrd->dim, size) != 0)
+    {
+    char *err = biffGetDone(NRRD);
+    vtkDebugMacro("Read: Error allocating data of " << this->GetFileName() << ":\n" << err);
+    free(err); // err points to malloc'd data!!
+    return 1;
+    }
+
+  BlockDecompressionJob job;
+  job.Data = static_cast<unsigned char*>(this->nrrd->data);
+  job.DataSize = static_cast<vtkIdType>(nrrdElementSize(this->nrrd) * nrrdElementNumber(this->nrrd));
+  job.BlockSize = this->CompressionBlockSize;
+  const vtkIdType numberOfBlocks = static_cast<vtkIdType>(this->CompressedBlockSizes.size());
+  if (numberOfBlocks != std::max<vtkIdType>(1, (job.DataSize + job.BlockSize - 1) / job.BlockSize))
+    {
+    vtkDebugMacro("Read: the number of compressed blocks of " << this->GetFileName()
+      << " does not match the data size");
+    return 1;
+    }
+  job.CompressedOffsets.resize(numberOfBlocks + 1, 0);
+  for (vtkIdType b = 0; b < numberOfBlocks; b++)
+    {
+    if (this->CompressedBlockSizes[b] <= 0)
+      {
+      vtkDebugMacro("Read: invalid compressed block size in " << this->GetFileName());
+      return 1;
+      }
+    job.CompressedOffsets[b + 1] = job.CompressedOffsets[b] + this->CompressedBlockSizes[b];
+    }
+
+  // The data follows the empty line that ends the header
+  std::ifstream file(this->GetFileName(), std::ios::in | std::ios::binary);
+  std::string line;
+  while (std::getline(file, line) && !line.empty() && line != "\r")
+    {
+    }
+  // The blocks must exactly fill the data that follows the header
+  const std::streamoff dataOffset = file.tellg();
+  file.seekg(0, std::ios::end);
+  const std::streamoff fileSize = file.tellg();
+  if (!file || dataOffset < 0
+    || fileSize - dataOffset != static_cast<std::streamoff>(job.CompressedOffsets[numberOfBlocks]))
+    {
+    vtkDebugMacro("Read: the compressed blocks of " << this->GetFileName()
+      << " do not match the size of the data");
+    return 1;
+    }
+  file.seekg(dataOffset);
+  std::vector<unsigned char> compressedData(job.CompressedOffsets[numberOfBlocks] + 1);
+  file.read(reinterpret_cast<char*>(&compressedData[0]), job.CompressedOffsets[numberOfBlocks]);
+  if (!file)
+    {
+    vtkDebugMacro("Read: Error reading the compressed data of " << this->GetFileName());
+    return 1;
+    }
+  job.CompressedData = &compressedData[0];
+  // Blocks that are not decompressed are reported as failed
+  job.Failed.resize(numberOfBlocks, 1);
+
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::max<vtkIdType>(1,
+    std::min<vtkIdType>(std::min(numberOfThreads, VTK_MAX_THREADS), numberOfBlocks))));
+  threader->SetSingleMethod(DecompressBlocksThread, &job);
+  threader->SingleMethodExecute();
+
+  for (vtkIdType b = 0; b < numberOfBlocks; b++)
+    {
+    if (job.Failed[b])
+      {
+      vtkDebugMacro("Read: Error decompressing block " << b << " of " << this->GetFileName());
+      return 1;
+      }
+    }
+
+  if (endian != airEndianUnknown && endian != airMyEndian() && nrrdElementSize(this->nrrd) > 1)
+    {
+    nrrdSwapEndian(this->nrrd);
+    }
+  return 0;
+}
+
 //----------------------------------------------------------------------------
 void vtkNRRDReader::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
 }
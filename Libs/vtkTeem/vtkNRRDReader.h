@@ -32,6 +32,7 @@
 #include <string>
 #include <map>
 #include <iostream>
+#include <vector>
 
 #include "vtkTeemConfigure.h"
 #include "vtkMedicalImageReader2.h"
@@ -127,6 +128,13 @@ public:
   vtkSetMacro(NumberOfComponents,int);
   vtkGetMacro(NumberOfComponents,int);
 
+  ///
+  /// Number of threads used to decompress files written by vtkNRRDWriter
+  /// in independently compressed blocks. Other files are read by teem.
+  /// 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetMacro(NumberOfThreads,int);
+  vtkGetMacro(NumberOfThreads,int);
+
 
   ///
   /// Use image origin from the file
@@ -251,6 +259,12 @@ protected:
   int DataType;
   int NumberOfComponents;
   bool UseNativeOrigin;
+  int NumberOfThreads;
+
+  /// Uncompressed and compressed sizes of the data blocks, empty if the
+  /// data is not compressed in blocks.
+  vtkIdType CompressionBlockSize;
+  std::vector<vtkIdType> CompressedBlockSizes;
 
   std::map <std::string, std::string> HeaderKeyValue;
   std::string HeaderKeys; // buffer for returning key list
@@ -263,6 +277,11 @@ protected:
 
   int tenSpaceDirectionReduce(Nrrd *nout, const Nrrd *nin, double SD[9]);
 
+  /// Read the data compressed in blocks into this->nrrd.
+  /// Returns 0 on success, as nrrdLoad(). Returns 1 if the blocks do not
+  /// match the data, which must then be read by nrrdLoad().
+  int ReadCompressedBlocks();
+
 private:
   vtkNRRDReader(const vtkNRRDReader&);  /// Not implemented.
   void operator=(const vtkNRRDReader&);  /// Not implemented.
@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <map>
+#include <sstream>
+#include <vector>
 
 #include "vtkNRRDWriter.h"
 
@@ -7,13 +10,77 @@
 #include "vtkPointData.h"
 #include "vtkObjectFactory.h"
 #include "vtkInformation.h"
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
 #include <vtkVersion.h>
+#include <vtk_zlib.h>
+#include <vtksys/SystemTools.hxx>
 
 class AttributeMapType: public std::map<std::string, std::string> {};
 class AxisInfoMapType : public std::map<unsigned int, std::string> {};
 
 vtkStandardNewMacro(vtkNRRDWriter);
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Blocks of the image buffer compressed by multiple threads.
+/// Each thread compresses a contiguous range of blocks.
+struct BlockCompressionJob
+{
+  const unsigned char* Data;
+  vtkIdType DataSize;
+  vtkIdType BlockSize;
+  int Level;
+  std::vector<std::vector<unsigned char> > Blocks;
+  /// Not a vector<bool>: the threads set the flags of their blocks concurrently.
+  std::vector<char> Failed;
+};
+
+//----------------------------------------------------------------------------
+/// Compress a buffer into a complete gzip member.
+bool CompressBlock(const unsigned char* data, vtkIdType size, int level,
+                   std::vector<unsigned char>& compressed)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 15 + 16: maximum window size, with gzip header and trailer
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+    return false;
+    }
+  compressed.resize(deflateBound(&stream, static_cast<uLong>(size)));
+  stream.next_in = const_cast<Bytef*>(data);
+  stream.avail_in = static_cast<uInt>(size);
+  stream.next_out = &compressed[0];
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  bool success = (deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+  return success;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE CompressBlocksThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  BlockCompressionJob* job = static_cast<BlockCompressionJob*>(info->UserData);
+  const vtkIdType numberOfBlocks = static_cast<vtkIdType>(job->Blocks.size());
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread compresses every NumberOfThreads-th block.
+  for (vtkIdType b = info->ThreadID; b < numberOfBlocks; b += info->NumberOfThreads)
+    {
+    const vtkIdType offset = b * job->BlockSize;
+    const vtkIdType size = std::min(job->BlockSize, job->DataSize - offset);
+    job->Failed[b] = !CompressBlock(job->Data + offset, size, job->Level, job->Blocks[b]);
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+};
+
 //----------------------------------------------------------------------------
 vtkNRRDWriter::vtkNRRDWriter()
 {
@@ -23,6 +90,9 @@ vtkNRRDWriter::vtkNRRDWriter()
   this->IJKToRASMatrix = vtkMatrix4x4::New();
   this->MeasurementFrameMatrix = vtkMatrix4x4::New();
   this->UseCompression = 1;
+  this->CompressionLevel = -1;
+  this->NumberOfThreads = 0;
+  this->CompressionBlockSize = 4 * 1024 * 1024;
   this->DiffusionWeigthedData = 0;
   this->FileType = VTK_BINARY;
   this->WriteErrorOff();
@@ -273,6 +343,12 @@ void* vtkNRRDWriter::MakeNRRD()
   AttributeMapType::iterator ait;
   for (ait = this->Attributes->begin(); ait != this->Attributes->end(); ++ait)
     {
+    // The block index describes the data written by WriteCompressedBlocks only
+    if ((*ait).first == vtkNRRDWriter::GetCompressionBlockSizeKey()
+      || (*ait).first == vtkNRRDWriter::GetCompressedBlockSizesKey())
+      {
+      continue;
+      }
     nrrdKeyValueAdd(nrrd, (*ait).first.c_str(), (*ait).second.c_str());
     }
 
@@ -352,8 +428,31 @@ void vtkNRRDWriter::WriteData()
   // set encoding for data: compressed (raw), (uncompressed) raw, or ascii
   if ( this->GetUseCompression() && nrrdEncodingGzip->available() )
     {
+    int numberOfThreads = this->NumberOfThreads;
+    if (numberOfThreads <= 0)
+      {
+      numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+      }
+    // Data of detached headers is written by teem
+    if (numberOfThreads > 1
+      && vtksys::SystemTools::LowerCase(
+           vtksys::SystemTools::GetFilenameLastExtension(this->GetFileName())) != ".nhdr")
+      {
+      if (this->WriteCompressedBlocks(nrrd, numberOfThreads))
+        {
+        nrrd = nrrdNix(nrrd);
+        nio = nrrdIoStateNix(nio);
+        return;
+        }
+      // The file is written again as a single gzip stream by teem
+      vtkWarningMacro("Write: Failed to write compressed blocks in "
+                      << this->GetFileName() << ", using single-threaded compression");
+      nrrdKeyValueErase(nrrd, vtkNRRDWriter::GetCompressionBlockSizeKey());
+      nrrdKeyValueErase(nrrd, vtkNRRDWriter::GetCompressedBlockSizesKey());
+      }
     // this is necessarily gzip-compressed *raw* data
     nio->encoding = nrrdEncodingGzip;
+    nio->zlibLevel = this->CompressionLevel;
     }
   else
     {
@@ -387,10 +486,91 @@ void vtkNRRDWriter::WriteData()
   return;
 }
 
+//----------------------------------------------------------------------------
+bool vtkNRRDWriter::WriteCompressedBlocks(Nrrd* nrrd, int numberOfThreads)
+{
+  BlockCompressionJob job;
+  job.Data = static_cast<const unsigned char*>(nrrd->data);
+  job.DataSize = static_cast<vtkIdType>(nrrdElementSize(nrrd) * nrrdElementNumber(nrrd));
+  job.BlockSize = this->CompressionBlockSize;
+  job.Level = (this->CompressionLevel < 0 ? Z_DEFAULT_COMPRESSION : this->CompressionLevel);
+  const vtkIdType numberOfBlocks = std::max<vtkIdType>(1, (job.DataSize + job.BlockSize - 1) / job.BlockSize);
+  job.Blocks.resize(numberOfBlocks);
+  // Blocks that are not compressed are reported as failed
+  job.Failed.resize(numberOfBlocks, 1);
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::max<vtkIdType>(1,
+    std::min<vtkIdType>(std::min(numberOfThreads, VTK_MAX_THREADS), numberOfBlocks))));
+  threader->SetSingleMethod(CompressBlocksThread, &job);
+  threader->SingleMethodExecute();
+
+  std::stringstream blockSizes;
+  for (vtkIdType b = 0; b < numberOfBlocks; b++)
+    {
+    if (job.Failed[b])
+      {
+      vtkWarningMacro("Write: Error compressing data of " << this->GetFileName());
+      return false;
+      }
+    blockSizes << (b > 0 ? " " : "") << job.Blocks[b].size();
+    }
+  std::stringstream blockSize;
+  blockSize << job.BlockSize;
+  nrrdKeyValueAdd(nrrd, vtkNRRDWriter::GetCompressionBlockSizeKey(), blockSize.str().c_str());
+  nrrdKeyValueAdd(nrrd, vtkNRRDWriter::GetCompressedBlockSizesKey(), blockSizes.str().c_str());
+
+  // Let teem write the header only, the blocks are appended to it
+  NrrdIoState *nio = nrrdIoStateNew();
+  nio->encoding = nrrdEncodingGzip;
+  nio->endian = airEndianUnknown;
+  nio->skipData = AIR_TRUE;
+  int error = nrrdSave(this->GetFileName(), nrrd, nio);
+  nio = nrrdIoStateNix(nio);
+  if (error)
+    {
+    char *err = biffGetDone(NRRD); // would be nice to free(err)
+    vtkWarningMacro("Write: Error writing "
+                      << this->GetFileName() << ":\n" << err);
+    return false;
+    }
+
+  FILE* file = fopen(this->GetFileName(), "r+b");
+  if (!file)
+    {
+    vtkWarningMacro("Write: Error opening " << this->GetFileName());
+    return false;
+    }
+  // The header must end with an empty line
+  char headerEnd[2] = { 0, 0 };
+  fseek(file, -2, SEEK_END);
+  bool headerEnded = (fread(headerEnd, 1, 2, file) == 2 && headerEnd[0] == '\n' && headerEnd[1] == '\n');
+  fseek(file, 0, SEEK_END);
+  if (!headerEnded)
+    {
+    fputc('\n', file);
+    }
+  bool success = true;
+  for (vtkIdType b = 0; b < numberOfBlocks && success; b++)
+    {
+    success = (fwrite(&job.Blocks[b][0], 1, job.Blocks[b].size(), file) == job.Blocks[b].size());
+    }
+  if (fclose(file) != 0 || !success)
+    {
+    vtkWarningMacro("Write: Error writing data of " << this->GetFileName());
+    return false;
+    }
+  return true;
+}
+
 void vtkNRRDWriter::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
 
+  os << indent << "UseCompression: " << this->UseCompression << "\n";
+  os << indent << "CompressionLevel: " << this->CompressionLevel << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "CompressionBlockSize: " << this->CompressionBlockSize << "\n";
   os << indent << "RAS to IJK Matrix: ";
      this->IJKToRASMatrix->PrintSelf(os,indent);
   os << indent << "Measurement frame: ";
@@ -55,6 +55,25 @@ public:
   vtkGetMacro(UseCompression,int);
   vtkBooleanMacro(UseCompression,int);
 
+  /// Gzip compression level, from 1 (fastest) to 9 (smallest file).
+  /// -1 (default) uses the zlib default level (6).
+  vtkSetClampMacro(CompressionLevel,int,-1,9);
+  vtkGetMacro(CompressionLevel,int);
+
+  /// Number of threads used to compress the data.
+  /// If more than one thread is used, the data is split into blocks of
+  /// CompressionBlockSize bytes that are compressed independently and
+  /// written as consecutive gzip members, which standard gzip decoders read
+  /// as a single stream. The compressed size of each block is stored in the
+  /// header so that vtkNRRDReader can decompress the blocks in parallel.
+  /// 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetMacro(NumberOfThreads,int);
+  vtkGetMacro(NumberOfThreads,int);
+
+  /// Number of uncompressed bytes per compressed block. Default is 4 MiB.
+  vtkSetClampMacro(CompressionBlockSize,vtkIdType,1,VTK_INT_MAX);
+  vtkGetMacro(CompressionBlockSize,vtkIdType);
+
   vtkSetClampMacro(FileType,int,VTK_ASCII,VTK_BINARY);
   vtkGetMacro(FileType,int);
   void SetFileTypeToASCII() {this->SetFileType(VTK_ASCII);};
@@ -77,6 +96,11 @@ public:
   /// Utility function to return image as a Nrrd*
   void* MakeNRRD();
 
+  /// Header keys of the uncompressed block size and of the list of
+  /// compressed block sizes, written when the data is compressed in parallel.
+  static const char* GetCompressionBlockSizeKey() { return "gzip_block_size"; }
+  static const char* GetCompressedBlockSizesKey() { return "gzip_block_compressed_sizes"; }
+
 protected:
   vtkNRRDWriter();
   ~vtkNRRDWriter();
@@ -87,6 +111,11 @@ protected:
   /// Write method. It is called by vtkWriter::Write();
   void WriteData() VTK_OVERRIDE;
 
+  ///
+  /// Write the header with teem, then the data compressed in parallel blocks.
+  /// Returns false on error, the file must then be written again.
+  bool WriteCompressedBlocks(Nrrd* nrrd, int numberOfThreads);
+
   ///
   /// Flag to set to on when a write error occured
   int WriteError;
@@ -100,6 +129,9 @@ protected:
   vtkMatrix4x4* MeasurementFrameMatrix;
 
   int UseCompression;
+  int CompressionLevel;
+  int NumberOfThreads;
+  vtkIdType CompressionBlockSize;
   int FileType;
 
   AttributeMapType *Attributes;
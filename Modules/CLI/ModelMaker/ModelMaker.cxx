@@ -42,8 +42,14 @@ Version:   $Revision$
 #include <vtkImageToStructuredPoints.h>
 #include <vtkInformation.h>
 #include <vtkLookupTable.h>
+#include <vtkMarchingCubes.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkPolyDataWriter.h>
 #include <vtkReverseSense.h>
@@ -54,6 +60,7 @@ Version:   $Revision$
 #include <vtkThreshold.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkTypeTraits.h>
 #include <vtkUnstructuredGrid.h>
 #include <vtkWindowedSincPolyDataFilter.h>
 #include <vtkVersion.h>
@@ -61,6 +68,284 @@ Version:   $Revision$
 // VTKsys includes
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+/// Bounding box of a label and surface generated from it by a worker thread.
+struct SurfaceJob
+{
+  int Label;
+  vtkIdType NumberOfVoxels;
+  int Extent[6];
+  bool Failed;
+  vtkSmartPointer<vtkPolyData> Surface;
+};
+
+//----------------------------------------------------------------------------
+/// Labels shared by the worker threads, they pick the next job in Order
+/// until all the surfaces are generated.
+struct SurfaceJobs
+{
+  vtkImageData* Image;
+  vtkMatrix4x4* IJKToRASMatrix;
+  double Decimate;
+  int Smooth;
+  bool SincFilter;
+  bool SplitNormals;
+  bool PointNormals;
+
+  std::vector<SurfaceJob> Jobs;
+  std::vector<size_t> Order;
+  size_t NextJob;
+  vtkSimpleMutexLock Lock;
+};
+
+//----------------------------------------------------------------------------
+/// Sort the jobs by decreasing number of voxels so that the largest labels
+/// are not left for the end.
+struct CompareNumberOfVoxels
+{
+  CompareNumberOfVoxels(const std::vector<SurfaceJob>& jobs) : Jobs(jobs) {}
+  bool operator()(size_t job1, size_t job2) const
+    {
+    return this->Jobs[job1].NumberOfVoxels > this->Jobs[job2].NumberOfVoxels;
+    }
+  const std::vector<SurfaceJob>& Jobs;
+};
+
+//----------------------------------------------------------------------------
+/// Compute the voxel count and bounding box of the labels in [minLabel, maxLabel]
+/// in a single pass. boxes contains 6 values per label, an empty box has
+/// its minimum greater than its maximum.
+template <class T>
+void ComputeLabelBoundingBoxes(vtkImageData* image, T* vtkNotUsed(scalarType),
+                               int minLabel, int maxLabel,
+                               std::vector<vtkIdType>& counts, std::vector<int>& boxes)
+{
+  int numberOfLabels = maxLabel - minLabel + 1;
+  counts.assign(numberOfLabels, 0);
+  boxes.resize(6 * numberOfLabels);
+  for (int n = 0; n < numberOfLabels; ++n)
+    {
+    boxes[6 * n] = boxes[6 * n + 2] = boxes[6 * n + 4] = VTK_INT_MAX;
+    boxes[6 * n + 1] = boxes[6 * n + 3] = boxes[6 * n + 5] = VTK_INT_MIN;
+    }
+
+  int extent[6];
+  image->GetExtent(extent);
+  vtkIdType increments[3];
+  image->GetIncrements(increments);
+  T* imagePtr = static_cast<T*>(image->GetScalarPointer());
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      T* rowPtr = imagePtr + (k - extent[4]) * increments[2] + (j - extent[2]) * increments[1];
+      // process the row as runs of identical voxels
+      int i = extent[0];
+      while (i <= extent[1])
+        {
+        T value = rowPtr[(i - extent[0]) * increments[0]];
+        int runStart = i;
+        for (++i; i <= extent[1] && rowPtr[(i - extent[0]) * increments[0]] == value; ++i)
+          {
+          }
+        double labelValue = static_cast<double>(value);
+        if (labelValue < minLabel || labelValue > maxLabel ||
+            labelValue != static_cast<int>(labelValue))
+          {
+          continue;
+          }
+        int n = static_cast<int>(labelValue) - minLabel;
+        counts[n] += i - runStart;
+        int* box = &boxes[6 * n];
+        box[0] = std::min(box[0], runStart);
+        box[1] = std::max(box[1], i - 1);
+        box[2] = std::min(box[2], j);
+        box[3] = std::max(box[3], j);
+        box[4] = std::min(box[4], k);
+        box[5] = std::max(box[5], k);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Threshold a label within an extent, like vtkImageThreshold does on the
+/// whole image with an in value of 200 and an out value of 0. Voxels of
+/// extent outside of the image are considered as padding (value 0).
+/// The output image starts at index 0, its origin is moved accordingly.
+template <class T>
+void ExtractLabel(vtkImageData* image, T* vtkNotUsed(scalarType), int label,
+                  const int extent[6], vtkImageData* output)
+{
+  int imageExtent[6];
+  image->GetExtent(imageExtent);
+  vtkIdType increments[3];
+  image->GetIncrements(increments);
+  T* imagePtr = static_cast<T*>(image->GetScalarPointer());
+
+  double origin[3];
+  image->GetOrigin(origin);
+  double spacing[3];
+  image->GetSpacing(spacing);
+  output->SetExtent(0, extent[1] - extent[0], 0, extent[3] - extent[2], 0, extent[5] - extent[4]);
+  output->SetOrigin(origin[0] + extent[0] * spacing[0],
+                    origin[1] + extent[2] * spacing[1],
+                    origin[2] + extent[4] * spacing[2]);
+  output->SetSpacing(spacing);
+  output->AllocateScalars(image->GetScalarType(), 1);
+
+  // vtkImageThreshold clamps the replacement value to the scalar range
+  T inValue = static_cast<T>(std::min(200., static_cast<double>(vtkTypeTraits<T>::Max())));
+  T outValue = static_cast<T>(0);
+  T labelValue = static_cast<T>(label);
+  T padValue = (labelValue == static_cast<T>(0) ? inValue : outValue);
+  T* outputPtr = static_cast<T*>(output->GetScalarPointer());
+  for (int k = extent[4]; k <= extent[5]; ++k)
+    {
+    bool kInside = (k >= imageExtent[4] && k <= imageExtent[5]);
+    for (int j = extent[2]; j <= extent[3]; ++j)
+      {
+      bool jkInside = kInside && (j >= imageExtent[2] && j <= imageExtent[3]);
+      T* rowPtr = imagePtr + (k - imageExtent[4]) * increments[2] + (j - imageExtent[2]) * increments[1];
+      for (int i = extent[0]; i <= extent[1]; ++i)
+        {
+        if (jkInside && i >= imageExtent[0] && i <= imageExtent[1])
+          {
+          *outputPtr++ = (rowPtr[(i - imageExtent[0]) * increments[0]] == labelValue ? inValue : outValue);
+          }
+        else
+          {
+          *outputPtr++ = padValue;
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+/// Generate the surface of a label with the same filters and parameters as
+/// the label loop of main().
+void GenerateSurface(SurfaceJobs* jobs, SurfaceJob& job)
+{
+  vtkNew<vtkImageData> labelImage;
+  switch (jobs->Image->GetScalarType())
+    {
+    vtkTemplateMacro(ExtractLabel(jobs->Image, static_cast<VTK_TT*>(NULL), job.Label,
+                                  job.Extent, labelImage.GetPointer()));
+    default:
+      job.Failed = true;
+      return;
+    }
+
+  vtkNew<vtkMarchingCubes> mcubes;
+  mcubes->SetInputData(labelImage.GetPointer());
+  mcubes->SetValue(0, 100.5);
+  mcubes->ComputeScalarsOff();
+  mcubes->ComputeGradientsOff();
+  mcubes->ComputeNormalsOff();
+  mcubes->Update();
+  job.Surface = vtkSmartPointer<vtkPolyData>::New();
+  if (mcubes->GetOutput()->GetNumberOfPolys() == 0)
+    {
+    job.Surface->ShallowCopy(mcubes->GetOutput());
+    return;
+    }
+
+  vtkNew<vtkDecimatePro> decimator;
+  decimator->SetInputConnection(mcubes->GetOutputPort());
+  decimator->SetFeatureAngle(60);
+  decimator->SplittingOff();
+  decimator->PreserveTopologyOn();
+  decimator->SetMaximumError(1);
+  decimator->SetTargetReduction(jobs->Decimate);
+
+  vtkNew<vtkReverseSense> reverser;
+  vtkAlgorithm* decimated = decimator.GetPointer();
+  if (jobs->IJKToRASMatrix->Determinant() < 0)
+    {
+    reverser->SetInputConnection(decimator->GetOutputPort());
+    reverser->ReverseNormalsOn();
+    decimated = reverser.GetPointer();
+    }
+
+  vtkSmartPointer<vtkPolyDataAlgorithm> smoother;
+  if (jobs->SincFilter)
+    {
+    vtkNew<vtkWindowedSincPolyDataFilter> smootherSinc;
+    smootherSinc->SetPassBand(0.1);
+    smootherSinc->SetNumberOfIterations(jobs->Smooth);
+    smootherSinc->FeatureEdgeSmoothingOff();
+    smootherSinc->BoundarySmoothingOff();
+    smoother = smootherSinc.GetPointer();
+    }
+  else
+    {
+    vtkNew<vtkSmoothPolyDataFilter> smootherPoly;
+    smootherPoly->SetRelaxationFactor(0.33);
+    smootherPoly->SetFeatureAngle(60);
+    smootherPoly->SetConvergence(0);
+    smootherPoly->SetNumberOfIterations(jobs->Smooth);
+    smootherPoly->FeatureEdgeSmoothingOff();
+    smootherPoly->BoundarySmoothingOff();
+    smoother = smootherPoly.GetPointer();
+    }
+  smoother->SetInputConnection(decimated->GetOutputPort());
+
+  // each thread has its own transform to not share its internal state
+  vtkNew<vtkTransform> transformIJKtoRAS;
+  transformIJKtoRAS->SetMatrix(jobs->IJKToRASMatrix);
+  vtkNew<vtkTransformPolyDataFilter> transformer;
+  transformer->SetInputConnection(smoother->GetOutputPort());
+  transformer->SetTransform(transformIJKtoRAS.GetPointer());
+
+  vtkNew<vtkPolyDataNormals> normals;
+  normals->SetComputePointNormals(jobs->PointNormals ? 1 : 0);
+  normals->SetInputConnection(transformer->GetOutputPort());
+  normals->SetFeatureAngle(60);
+  normals->SetSplitting(jobs->SplitNormals ? 1 : 0);
+
+  vtkNew<vtkStripper> stripper;
+  stripper->SetInputConnection(normals->GetOutputPort());
+  stripper->Update();
+  job.Surface->ShallowCopy(stripper->GetOutput());
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE GenerateSurfacesThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  SurfaceJobs* jobs = static_cast<SurfaceJobs*>(info->UserData);
+  while (true)
+    {
+    jobs->Lock.Lock();
+    if (jobs->NextJob >= jobs->Order.size())
+      {
+      jobs->Lock.Unlock();
+      break;
+      }
+    SurfaceJob& job = jobs->Jobs[jobs->Order[jobs->NextJob++]];
+    jobs->Lock.Unlock();
+    try
+      {
+      GenerateSurface(jobs, job);
+      }
+    catch(...)
+      {
+      job.Failed = true;
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
 int main(int argc, char * argv[])
 {
   PARSE_ARGS;
@@ -869,6 +1154,9 @@ int main(int argc, char * argv[])
       loopLabels.push_back(Labels[i]);
       }
     }
+  // name the models first, skipping the empty and un-named labels
+  std::vector<int>         modelLabels;
+  std::vector<std::string> modelNames;
   for(::size_t l = 0; l < loopLabels.size(); l++)
     {
     // get the label out of the vector
@@ -978,9 +1266,116 @@ int main(int argc, char * argv[])
         }
       */
       }
+    modelLabels.push_back(i);
+    modelNames.push_back(labelName);
+    }   // end of loop over labels to name the models
+
+  // Generate the models of multiple labels concurrently. Each label is only
+  // thresholded within its bounding box, all the bounding boxes are computed
+  // in a single pass over the image. Joint smoothing already extracts all the
+  // labels at once and intermediate models are saved by the label loop.
+  SurfaceJobs surfaceJobs;
+  int numberOfThreads = NumberOfThreads;
+  if (numberOfThreads <= 0)
+    {
+    numberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+    }
+  numberOfThreads = std::min(numberOfThreads, std::min(static_cast<int>(modelLabels.size()), VTK_MAX_THREADS));
+  int minModelLabel = 0;
+  int maxModelLabel = 0;
+  if (modelLabels.size() > 0)
+    {
+    minModelLabel = *std::min_element(modelLabels.begin(), modelLabels.end());
+    maxModelLabel = *std::max_element(modelLabels.begin(), modelLabels.end());
+    }
+  // the bounding boxes are indexed by label value
+  const double maxModelLabelRange = 1 << 24;
+  if (numberOfThreads > 1 && JointSmoothing == 0 && !SaveIntermediateModels &&
+      static_cast<double>(maxModelLabel) - minModelLabel < maxModelLabelRange)
+    {
+    if (strcmp(FilterType.c_str(), "Sinc") == 0 && Smooth == 1)
+      {
+      std::cerr << "Warning: Smoothing iterations of 1 not allowed for Sinc filter, using 2" << endl;
+      Smooth = 2;
+      }
+    std::vector<vtkIdType> labelCounts;
+    std::vector<int>       labelBoxes;
+    switch (image->GetScalarType())
+      {
+      vtkTemplateMacro(ComputeLabelBoundingBoxes(image, static_cast<VTK_TT*>(NULL),
+                                                 minModelLabel, maxModelLabel,
+                                                 labelCounts, labelBoxes));
+      default:
+        std::cerr << "ERROR: unsupported scalar type " << image->GetScalarTypeAsString() << std::endl;
+        return EXIT_FAILURE;
+      }
+    // padding is done on the fly: the voxels around the image are 0
+    int padding = (Pad ? 1 : 0);
+    int imageExtent[6];
+    image->GetExtent(imageExtent);
+    surfaceJobs.Jobs.resize(modelLabels.size());
+    for(::size_t m = 0; m < modelLabels.size(); m++)
+      {
+      SurfaceJob& job = surfaceJobs.Jobs[m];
+      job.Label = modelLabels[m];
+      job.NumberOfVoxels = labelCounts[job.Label - minModelLabel];
+      job.Failed = false;
+      const int* box = &labelBoxes[6 * (job.Label - minModelLabel)];
+      bool wholeImage = (job.NumberOfVoxels == 0 || (Pad && job.Label == 0));
+      for (int axis = 0; axis < 3; ++axis)
+        {
+        // a margin of one voxel gives the same surface as the whole image
+        job.Extent[2 * axis] = imageExtent[2 * axis] - padding;
+        job.Extent[2 * axis + 1] = imageExtent[2 * axis + 1] + padding;
+        if (!wholeImage)
+          {
+          job.Extent[2 * axis] = std::max(job.Extent[2 * axis], box[2 * axis] - 1);
+          job.Extent[2 * axis + 1] = std::min(job.Extent[2 * axis + 1], box[2 * axis + 1] + 1);
+          }
+        }
+      surfaceJobs.Order.push_back(m);
+      }
+    std::stable_sort(surfaceJobs.Order.begin(), surfaceJobs.Order.end(),
+                     CompareNumberOfVoxels(surfaceJobs.Jobs));
+    surfaceJobs.Image = image;
+    surfaceJobs.IJKToRASMatrix = transformIJKtoRAS->GetMatrix();
+    surfaceJobs.Decimate = Decimate;
+    surfaceJobs.Smooth = Smooth;
+    surfaceJobs.SincFilter = (strcmp(FilterType.c_str(), "Sinc") == 0);
+    surfaceJobs.SplitNormals = SplitNormals;
+    surfaceJobs.PointNormals = PointNormals;
+    surfaceJobs.NextJob = 0;
+
+    std::cout << "Generating " << modelLabels.size() << " models using " << numberOfThreads << " threads" << std::endl;
+    vtkNew<vtkMultiThreader> threader;
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(GenerateSurfacesThread, &surfaceJobs);
+    threader->SingleMethodExecute();
+    for(::size_t m = 0; m < surfaceJobs.Jobs.size(); m++)
+      {
+      if (surfaceJobs.Jobs[m].Failed)
+        {
+        std::cerr << "ERROR while generating the model of label " << surfaceJobs.Jobs[m].Label << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    // all the filters but the writer have run for each model
+    double numberOfStepsPerModel = (surfaceJobs.IJKToRASMatrix->Determinant() < 0 ? 8.0 : 7.0);
+    currentFilterOffset += numberOfStepsPerModel * modelLabels.size();
+    }
+
+  for(::size_t m = 0; m < modelLabels.size(); m++)
+    {
+    int i = modelLabels[m];
+    labelName = modelNames[m];
+    SurfaceJob* surfaceJob = (surfaceJobs.Jobs.size() > 0 ? &surfaceJobs.Jobs[m] : NULL);
 
     // threshold
-    if (JointSmoothing == 0)
+    if (surfaceJob != NULL)
+      {
+      // the model has already been generated
+      }
+    else if (JointSmoothing == 0)
       {
       if (imageThreshold)
         {
@@ -1079,7 +1474,17 @@ int main(int argc, char * argv[])
 
     // if not joint smoothing, may need to skip this label
     int skipLabel = 0;
-    if (JointSmoothing == 0)
+    if (surfaceJob != NULL)
+      {
+      if (surfaceJob->Surface->GetNumberOfPolys() == 0)
+        {
+        std::cout << "Cannot create a model from label " << i
+                  << "\nNo polygons can be created,\nthere may be no voxels with this label in the volume." << endl;
+        std::cout << "...continuing" << endl;
+        continue;
+        }
+      }
+    else if (JointSmoothing == 0)
       {
       if (mcubes)
         {
@@ -1190,7 +1595,7 @@ int main(int argc, char * argv[])
       {
       std::cout << "Skipping marching cubes..." << endl;
       }
-    if (!skipLabel)
+    if (!skipLabel && surfaceJob == NULL)
       {
       // In switch from vtk 4 to vtk 5, vtkDecimate was deprecated from the Patented dir, use vtkDecimatePro
       // TODO: look at vtkQuadraticDecimation
@@ -1569,7 +1974,9 @@ int main(int argc, char * argv[])
         std::cerr << "ERROR updating stripper for model " << i << std::endl;
         return EXIT_FAILURE;
         }
-
+      }
+    if (!skipLabel)
+      {
       // but for now we're just going to write it out
       writer = vtkSmartPointer<vtkPolyDataWriter>::New();
       std::string            comment4 = "Write " + labelName;
@@ -1583,7 +1990,14 @@ int main(int argc, char * argv[])
         {
         watchWriter.QuietOn();
         }
-      writer->SetInputConnection(stripper->GetOutputPort());
+      if (surfaceJob != NULL)
+        {
+        writer->SetInputData(surfaceJob->Surface);
+        }
+      else
+        {
+        writer->SetInputConnection(stripper->GetOutputPort());
+        }
       writer->SetFileType(2);
       std::string fileName;
       if (rootDir != "")
@@ -1,5 +1,19 @@
 #include "itkTestMain.h"
 
+// VTK includes
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataReader.h>
+
+// VTKsys includes
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cmath>
+#include <string>
+#include <vector>
+
 #ifdef WIN32
 #define MODULE_IMPORT __declspec(dllimport)
 #else
@@ -8,7 +22,126 @@
 
 extern "C" MODULE_IMPORT int ModuleEntryPoint(int, char * []);
 
+namespace
+{
+
+//----------------------------------------------------------------------------
+int RunModelMaker(const char* labelMap, const std::string& sceneFile, const char* numberOfThreads)
+{
+  std::vector<std::string> arguments;
+  arguments.push_back("ModelMaker");
+  arguments.push_back("--generateAll");
+  arguments.push_back("--pad");
+  arguments.push_back("--numberOfThreads");
+  arguments.push_back(numberOfThreads);
+  arguments.push_back("--modelSceneFile");
+  arguments.push_back(sceneFile + "#vtkMRMLModelHierarchyNode1");
+  arguments.push_back(labelMap);
+  std::vector<char*> argv;
+  for (std::vector<std::string>::iterator it = arguments.begin(); it != arguments.end(); ++it)
+    {
+    argv.push_back(const_cast<char*>(it->c_str()));
+    }
+  argv.push_back(NULL);
+  return ModuleEntryPoint(static_cast<int>(arguments.size()), &argv[0]);
+}
+
+//----------------------------------------------------------------------------
+bool CompareModels(const std::string& serialFileName, const std::string& threadsFileName)
+{
+  vtkNew<vtkPolyDataReader> serialReader;
+  serialReader->SetFileName(serialFileName.c_str());
+  serialReader->Update();
+  vtkNew<vtkPolyDataReader> threadsReader;
+  threadsReader->SetFileName(threadsFileName.c_str());
+  threadsReader->Update();
+  vtkPolyData* serialModel = serialReader->GetOutput();
+  vtkPolyData* threadsModel = threadsReader->GetOutput();
+  if (serialModel->GetNumberOfPoints() == 0
+    || serialModel->GetNumberOfPoints() != threadsModel->GetNumberOfPoints()
+    || serialModel->GetNumberOfPolys() != threadsModel->GetNumberOfPolys())
+    {
+    std::cerr << threadsFileName << ": " << threadsModel->GetNumberOfPoints() << " points and "
+              << threadsModel->GetNumberOfPolys() << " polygons, expected "
+              << serialModel->GetNumberOfPoints() << " points and "
+              << serialModel->GetNumberOfPolys() << " polygons" << std::endl;
+    return false;
+    }
+  double serialBounds[6] = { 0. };
+  double threadsBounds[6] = { 0. };
+  serialModel->GetBounds(serialBounds);
+  threadsModel->GetBounds(threadsBounds);
+  for (int i = 0; i < 6; ++i)
+    {
+    if (fabs(serialBounds[i] - threadsBounds[i]) > 1e-4)
+      {
+      std::cerr << threadsFileName << ": bound " << i << " is " << threadsBounds[i]
+                << ", expected " << serialBounds[i] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+/// Generate the models of all the labels serially and with multiple threads
+/// and check that the models are identical.
+/// Arguments: label map, serial scene file, multithreaded scene file.
+/// The scene files must be in different directories.
+int ModelMakerThreadsCompareTest(int argc, char * argv[])
+{
+  if (argc < 4)
+    {
+    std::cerr << "Usage: ModelMakerThreadsCompareTest labelMap serialScene threadsScene" << std::endl;
+    return EXIT_FAILURE;
+    }
+  std::string serialScene = argv[2];
+  std::string threadsScene = argv[3];
+  // The number of threads is set explicitly (instead of 0 for the number of
+  // cores) so that the parallel path also runs on single core machines.
+  if (RunModelMaker(argv[1], serialScene, "1") != EXIT_SUCCESS
+    || RunModelMaker(argv[1], threadsScene, "4") != EXIT_SUCCESS)
+    {
+    std::cerr << "ModelMaker failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string serialDirectory = vtksys::SystemTools::GetFilenamePath(serialScene);
+  std::string threadsDirectory = vtksys::SystemTools::GetFilenamePath(threadsScene);
+  vtksys::Directory directory;
+  directory.Load(serialDirectory.c_str());
+  int numberOfModels = 0;
+  for (unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i)
+    {
+    std::string fileName = directory.GetFile(i);
+    if (vtksys::SystemTools::GetFilenameLastExtension(fileName) != ".vtk")
+      {
+      continue;
+      }
+    std::string threadsFileName = threadsDirectory + "/" + fileName;
+    if (!vtksys::SystemTools::FileExists(threadsFileName.c_str(), true))
+      {
+      std::cerr << "Missing model " << threadsFileName << std::endl;
+      return EXIT_FAILURE;
+      }
+    if (!CompareModels(serialDirectory + "/" + fileName, threadsFileName))
+      {
+      return EXIT_FAILURE;
+      }
+    ++numberOfModels;
+    }
+  if (numberOfModels < 3)
+    {
+    std::cerr << "Expected at least 3 models, found " << numberOfModels << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+
 void RegisterTests()
 {
   StringToTestFunctionMap["ModuleEntryPoint"] = ModuleEntryPoint;
+  StringToTestFunctionMap["ModelMakerThreadsCompareTest"] = ModelMakerThreadsCompareTest;
 }
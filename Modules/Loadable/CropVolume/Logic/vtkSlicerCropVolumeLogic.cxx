@@ -43,6 +43,8 @@
 #include <vtkGeneralTransform.h>
 #include <vtkImageData.h>
 #include <vtkImageClip.h>
+#include <vtkImageReslice.h>
+#include <vtkImageSincInterpolator.h>
 #include <vtkNew.h>
 #include <vtkMatrix4x4.h>
 #include <vtkMatrix3x3.h>
@@ -420,11 +422,26 @@ int vtkSlicerCropVolumeLogic::CropInterpolated(vtkMRMLAnnotationROINode* roi, vt
     return -1;
     }
 
-  if (this->Internal->ResampleLogic == 0)
+  // B-spline interpolation is only available in the resample module, other
+  // interpolation modes are computed in-process. The resample module is also
+  // used to reorient the gradients of transformed diffusion weighted volumes.
+  bool useResampleModule = (interpolationMode == vtkMRMLCropVolumeParametersNode::InterpolationBSpline);
+  if (vtkMRMLDiffusionWeightedVolumeNode::SafeDownCast(inputVolume)
+    && inputVolume->GetParentTransformNode() != outputVolume->GetParentTransformNode())
+    {
+    useResampleModule = true;
+    }
+  if (useResampleModule && this->Internal->ResampleLogic == 0)
     {
     vtkErrorMacro("CropVolume: resample logic is not set");
     return -3;
     }
+  if (!useResampleModule && !inputVolume->GetImageData())
+    {
+    vtkWarningMacro("CropVolume: input image is empty");
+    outputVolume->SetAndObserveImageData(NULL);
+    return 0;
+    }
 
   int outputExtent[6] = { 0, -1, 0, -1, 0, -1 };
   double outputSpacing[3] = { 0 };
@@ -483,22 +500,6 @@ int vtkSlicerCropVolumeLogic::CropInterpolated(vtkMRMLAnnotationROINode* roi, vt
     outputSpacing[column] = vtkMath::Normalize(outputDirectionColRow[column]);
     }
 
-  vtkMRMLCommandLineModuleNode* cmdNode = this->Internal->ResampleLogic->CreateNodeInScene();
-  if (cmdNode == NULL)
-    {
-    vtkErrorMacro("CropVolume: failed to create resample node");
-    return -4;
-    }
-
-  cmdNode->SetParameterAsString("inputVolume", inputVolume->GetID());
-  cmdNode->SetParameterAsString("outputVolume", outputVolume->GetID());
-
-  std::stringstream sizeStream;
-  sizeStream << (outputExtent[1] - outputExtent[0] + 1)  << ","
-    << (outputExtent[3] - outputExtent[2] + 1) << ","
-    << (outputExtent[5] - outputExtent[4] + 1);
-  cmdNode->SetParameterAsString("outputImageSize", sizeStream.str());
-
   // Center the output image in the ROI. For that, compute the size difference between
   // the ROI and the output image.
   double sizeDifference_IJK[3] =
@@ -519,6 +520,35 @@ int vtkSlicerCropVolumeLogic::CropInterpolated(vtkMRMLAnnotationROINode* roi, vt
   double outputOrigin_RAS[4] = { 0.0, 0.0, 0.0, 1.0 };
   outputIJKToRAS->MultiplyPoint(outputOrigin_IJK, outputOrigin_RAS);
 
+  if (!useResampleModule)
+    {
+    // Output voxel (i, j, k) is centered on outputIJKToRAS * (i, j, k) + outputOrigin
+    vtkNew<vtkMatrix4x4> outputVoxelIJKToRAS;
+    outputVoxelIJKToRAS->DeepCopy(outputIJKToRAS.GetPointer());
+    for (int row = 0; row < 3; row++)
+      {
+      outputVoxelIJKToRAS->SetElement(row, 3, outputOrigin_RAS[row]);
+      }
+    return vtkSlicerCropVolumeLogic::CropInterpolatedInProcess(inputVolume, outputVolume,
+      outputVoxelIJKToRAS.GetPointer(), outputExtent, interpolationMode, fillValue);
+    }
+
+  vtkMRMLCommandLineModuleNode* cmdNode = this->Internal->ResampleLogic->CreateNodeInScene();
+  if (cmdNode == NULL)
+    {
+    vtkErrorMacro("CropVolume: failed to create resample node");
+    return -4;
+    }
+
+  cmdNode->SetParameterAsString("inputVolume", inputVolume->GetID());
+  cmdNode->SetParameterAsString("outputVolume", outputVolume->GetID());
+
+  std::stringstream sizeStream;
+  sizeStream << (outputExtent[1] - outputExtent[0] + 1)  << ","
+    << (outputExtent[3] - outputExtent[2] + 1) << ","
+    << (outputExtent[5] - outputExtent[4] + 1);
+  cmdNode->SetParameterAsString("outputImageSize", sizeStream.str());
+
   vtkNew<vtkMRMLMarkupsFiducialNode> originMarkupNode;
   // Markups are transformed from RAS to LPS by the CLI infrastructure, so we pass them in RAS
   originMarkupNode->AddFiducial(outputOrigin_RAS[0], outputOrigin_RAS[1], outputOrigin_RAS[2]);
@@ -591,6 +621,84 @@ int vtkSlicerCropVolumeLogic::CropInterpolated(vtkMRMLAnnotationROINode* roi, vt
   return 0;
 }
 
+//----------------------------------------------------------------------------
+int vtkSlicerCropVolumeLogic::CropInterpolatedInProcess(vtkMRMLVolumeNode* inputVolume, vtkMRMLVolumeNode* outputVolume,
+  vtkMatrix4x4* outputIJKToRAS, int outputExtent[6], int interpolationMode, double fillValue)
+{
+  if (!inputVolume || !inputVolume->GetImageData() || !outputVolume || !outputIJKToRAS)
+    {
+    return -1;
+    }
+
+  // Transform from output IJK to input IJK:
+  // output IJK -> output RAS -> input RAS -> input IJK
+  vtkNew<vtkGeneralTransform> outputIJKToInputIJK;
+  outputIJKToInputIJK->PostMultiply();
+  outputIJKToInputIJK->Concatenate(outputIJKToRAS);
+  if (inputVolume->GetParentTransformNode() != outputVolume->GetParentTransformNode())
+    {
+    vtkNew<vtkGeneralTransform> outputRASToInputRAS;
+    vtkMRMLTransformNode::GetTransformBetweenNodes(outputVolume->GetParentTransformNode(),
+      inputVolume->GetParentTransformNode(), outputRASToInputRAS.GetPointer());
+    outputIJKToInputIJK->Concatenate(outputRASToInputRAS.GetPointer());
+    }
+  vtkNew<vtkMatrix4x4> inputRASToIJK;
+  inputVolume->GetRASToIJKMatrix(inputRASToIJK.GetPointer());
+  outputIJKToInputIJK->Concatenate(inputRASToIJK.GetPointer());
+
+  // The IJK to RAS matrix of the volume node holds the geometry of the image,
+  // make sure the image data has no origin or spacing of its own.
+  vtkNew<vtkImageData> inputImage;
+  inputImage->ShallowCopy(inputVolume->GetImageData());
+  inputImage->SetOrigin(0., 0., 0.);
+  inputImage->SetSpacing(1., 1., 1.);
+
+  // vtkImageReslice is multithreaded and, with a linear transform, only
+  // reads the region of the input image that is under the output extent.
+  vtkNew<vtkImageReslice> reslice;
+  reslice->SetInputData(inputImage.GetPointer());
+  reslice->SetOutputOrigin(0., 0., 0.);
+  reslice->SetOutputSpacing(1., 1., 1.);
+  reslice->SetOutputExtent(outputExtent);
+  reslice->SetBackgroundLevel(fillValue);
+  // vtkImageReslice works faster if the input is a linear transform, so try to convert it
+  // to a linear transform
+  vtkNew<vtkTransform> linearResliceTransform;
+  if (vtkMRMLTransformNode::IsGeneralTransformLinear(outputIJKToInputIJK.GetPointer(), linearResliceTransform.GetPointer()))
+    {
+    reslice->SetResliceTransform(linearResliceTransform.GetPointer());
+    }
+  else
+    {
+    reslice->SetResliceTransform(outputIJKToInputIJK.GetPointer());
+    }
+
+  vtkNew<vtkImageSincInterpolator> sincInterpolator;
+  switch (interpolationMode)
+    {
+    case vtkMRMLCropVolumeParametersNode::InterpolationNearestNeighbor:
+      reslice->SetInterpolationModeToNearestNeighbor();
+      break;
+    case vtkMRMLCropVolumeParametersNode::InterpolationWindowedSinc:
+      // same window as the default of the resample module
+      sincInterpolator->SetWindowFunctionToCosine();
+      reslice->SetInterpolator(sincInterpolator.GetPointer());
+      break;
+    case vtkMRMLCropVolumeParametersNode::InterpolationLinear:
+    default:
+      reslice->SetInterpolationModeToLinear();
+      break;
+    }
+  reslice->Update();
+
+  int wasModified = outputVolume->StartModify();
+  outputVolume->SetAndObserveImageData(reslice->GetOutput());
+  outputVolume->SetIJKToRASMatrix(outputIJKToRAS);
+  outputVolume->EndModify(wasModified);
+
+  return 0;
+}
+
 //-----------------------------------------------------------------------------
 bool vtkSlicerCropVolumeLogic::FitROIToInputVolume(vtkMRMLCropVolumeParametersNode* parametersNode)
 {
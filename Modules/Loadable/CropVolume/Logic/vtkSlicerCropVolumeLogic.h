@@ -87,9 +87,23 @@ public:
   static bool GetVoxelBasedCropOutputExtent(vtkMRMLAnnotationROINode* roi, vtkMRMLVolumeNode* inputVolume, int outputExtent[6]);
 
   /// Perform interpolated cropping.
+  /// Nearest neighbor, linear and windowed sinc interpolation are computed
+  /// in-process by a multithreaded resampler, which only reads the voxels
+  /// under the ROI: it is fast enough to update a cropped volume while the
+  /// ROI is moved. B-spline interpolation runs the resample CLI module and
+  /// requires the resample logic to be set.
   int CropInterpolated(vtkMRMLAnnotationROINode* roi, vtkMRMLVolumeNode* inputVolume, vtkMRMLVolumeNode* outputNode,
     bool isotropicResampling, double spacingScale, int interpolationMode, double fillValue);
 
+  /// Resample the input volume into the output volume, with the given
+  /// output geometry (IJK to RAS matrix in the coordinate system of the
+  /// output volume parent transform, and extent).
+  /// Interpolation mode is one of vtkMRMLCropVolumeParametersNode
+  /// InterpolationNearestNeighbor, InterpolationLinear or
+  /// InterpolationWindowedSinc.
+  static int CropInterpolatedInProcess(vtkMRMLVolumeNode* inputVolume, vtkMRMLVolumeNode* outputVolume,
+    vtkMatrix4x4* outputIJKToRAS, int outputExtent[6], int interpolationMode, double fillValue);
+
   /// Computes output volume geometry for interpolated cropping (without actually cropping the image).
   static bool GetInterpolatedCropOutputGeometry(vtkMRMLAnnotationROINode* roi, vtkMRMLVolumeNode* inputVolume,
     bool isotropicResampling, double spacingScale, int outputExtent[6], double outputSpacing[3]);
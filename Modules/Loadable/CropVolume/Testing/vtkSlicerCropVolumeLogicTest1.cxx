@@ -0,0 +1,117 @@
+/*=auto=========================================================================
+
+  Portions (c) Copyright 2005 Brigham and Women's Hospital (BWH)
+  All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+
+=========================================================================auto=*/
+
+// CropVolume includes
+#include "vtkSlicerCropVolumeLogic.h"
+
+// MRML includes
+#include "vtkMRMLAnnotationROINode.h"
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLCropVolumeParametersNode.h"
+#include "vtkMRMLScalarVolumeNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+bool CheckVoxel(vtkMRMLVolumeNode* volumeNode, int i, int j, int k, double expected)
+{
+  double value = volumeNode->GetImageData()->GetScalarComponentAsDouble(i, j, k, 0);
+  if (fabs(value - expected) > 1e-4)
+    {
+    std::cerr << "Voxel (" << i << ", " << j << ", " << k << "): expected "
+              << expected << ", got " << value << std::endl;
+    return false;
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkSlicerCropVolumeLogicTest1(int , char * [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkSlicerCropVolumeLogic> logic;
+  logic->SetMRMLScene(scene.GetPointer());
+
+  // 10x10x10 volume with identity geometry: voxel value = R coordinate
+  vtkNew<vtkImageData> imageData;
+  imageData->SetDimensions(10, 10, 10);
+  imageData->AllocateScalars(VTK_FLOAT, 1);
+  for (int k = 0; k < 10; ++k)
+    {
+    for (int j = 0; j < 10; ++j)
+      {
+      for (int i = 0; i < 10; ++i)
+        {
+        imageData->SetScalarComponentFromDouble(i, j, k, 0, i);
+        }
+      }
+    }
+  vtkNew<vtkMRMLScalarVolumeNode> inputVolume;
+  inputVolume->SetAndObserveImageData(imageData.GetPointer());
+  scene->AddNode(inputVolume.GetPointer());
+  vtkNew<vtkMRMLScalarVolumeNode> outputVolume;
+  scene->AddNode(outputVolume.GetPointer());
+
+  vtkNew<vtkMRMLAnnotationROINode> roi;
+  scene->AddNode(roi.GetPointer());
+  roi->SetXYZ(4.5, 4.5, 4.5);
+  roi->SetRadiusXYZ(2., 2., 2.);
+
+  // Nearest neighbor: 4 voxels centered on 3, 4, 5 and 6
+  CHECK_INT(logic->CropInterpolated(roi.GetPointer(), inputVolume.GetPointer(), outputVolume.GetPointer(),
+    false, 1., vtkMRMLCropVolumeParametersNode::InterpolationNearestNeighbor, -1.), 0);
+  int* dimensions = outputVolume->GetImageData()->GetDimensions();
+  CHECK_INT(dimensions[0], 4);
+  CHECK_INT(dimensions[2], 4);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 0, 0, 0, 3.), true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 3, 2, 1, 6.), true);
+  double* origin = outputVolume->GetOrigin();
+  CHECK_BOOL(fabs(origin[0] - 3.) < 1e-6, true);
+
+  // Linear: half spacing, 8 voxels centered on 2.75, 3.25, ...
+  CHECK_INT(logic->CropInterpolated(roi.GetPointer(), inputVolume.GetPointer(), outputVolume.GetPointer(),
+    false, 0.5, vtkMRMLCropVolumeParametersNode::InterpolationLinear, -1.), 0);
+  CHECK_INT(outputVolume->GetImageData()->GetDimensions()[0], 8);
+  CHECK_BOOL(fabs(outputVolume->GetSpacing()[0] - 0.5) < 1e-6, true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 0, 0, 0, 2.75), true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 1, 3, 3, 3.25), true);
+
+  // Voxels outside of the input volume are set to the fill value.
+  // 4 voxels centered on -1, 0, 1 and 2: on input voxel centers, away from
+  // the nearest neighbor ties.
+  roi->SetXYZ(0.5, 4.5, 4.5);
+  CHECK_INT(logic->CropInterpolated(roi.GetPointer(), inputVolume.GetPointer(), outputVolume.GetPointer(),
+    false, 1., vtkMRMLCropVolumeParametersNode::InterpolationNearestNeighbor, -1.), 0);
+  CHECK_BOOL(fabs(outputVolume->GetOrigin()[0] + 1.) < 1e-6, true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 0, 0, 0, -1.), true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 1, 0, 0, 0.), true);
+  CHECK_BOOL(CheckVoxel(outputVolume.GetPointer(), 3, 0, 0, 2.), true);
+
+  // B-spline interpolation requires the resample module
+  TESTING_OUTPUT_ASSERT_ERRORS_BEGIN();
+  CHECK_INT(logic->CropInterpolated(roi.GetPointer(), inputVolume.GetPointer(), outputVolume.GetPointer(),
+    false, 1., vtkMRMLCropVolumeParametersNode::InterpolationBSpline, -1.), -3);
+  TESTING_OUTPUT_ASSERT_ERRORS_END();
+
+  return EXIT_SUCCESS;
+}
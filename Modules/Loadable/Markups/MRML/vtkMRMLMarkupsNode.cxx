@@ -29,10 +29,12 @@
 #include <vtkAbstractTransform.h>
 #include <vtkBitArray.h>
 #include <vtkCommand.h>
+#include <vtkGeneralTransform.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyData.h>
 #include <vtkStringArray.h>
 
@@ -51,6 +53,7 @@ vtkMRMLMarkupsNode::vtkMRMLMarkupsNode()
   this->Locked = 0;
   this->MarkupLabelFormat = std::string("%N-%d");
   this->MaximumNumberOfMarkups = 0;
+  this->MarkupIndexByIDValid = true;
 }
 
 //----------------------------------------------------------------------------
@@ -142,11 +145,12 @@ void vtkMRMLMarkupsNode::Copy(vtkMRMLNode *anode)
     }
 
   this->Markups.clear();
+  this->MarkupIndexByID.clear();
+  this->MarkupIndexByIDValid = true;
   int numMarkups = node->GetNumberOfMarkups();
   for (int n = 0; n < numMarkups; n++)
     {
-    Markup *markup = node->GetNthMarkup(n);
-    this->AddMarkup(*markup);
+    this->AddMarkup(node->Markups[n]);
     }
 
   // set max number of markups after adding the new ones
@@ -207,7 +211,7 @@ void vtkMRMLMarkupsNode::PrintSelf(ostream& os, vtkIndent indent)
   for (int i = 0; i < this->GetNumberOfMarkups(); i++)
     {
     os << indent << "Markup " << i << ":\n";
-    Markup *markup = this->GetNthMarkup(i);
+    Markup *markup = this->GetNthMarkupInternal(i);
     this->PrintMarkup(os, indent, markup);
     }
 
@@ -233,9 +237,17 @@ void vtkMRMLMarkupsNode::RemoveAllMarkups()
 
   this->SetLocked(0); // Should this be done here ?
 
-  while(this->Markups.size() > 0)
+  // Remove all the markups at once instead of one by one: erasing from the
+  // front of the vector is quadratic and observers would be notified for
+  // each removal.
+  if (!this->Markups.empty())
     {
-    this->RemoveMarkup(0);
+    this->Markups.clear();
+    this->MarkupIndexByID.clear();
+    this->MarkupIndexByIDValid = true;
+    int markupIndex = -1;
+    this->Modified();
+    this->InvokeCustomModifiedEvent(vtkMRMLMarkupsNode::MarkupRemovedEvent, (void*)&markupIndex);
     }
   this->MaximumNumberOfMarkups = 0;
 
@@ -411,6 +423,18 @@ bool vtkMRMLMarkupsNode::PointExistsInMarkup(int p, int n)
 
 //---------------------------------------------------------------------------
 Markup *vtkMRMLMarkupsNode::GetNthMarkup(int n)
+{
+  Markup* markup = this->GetNthMarkupInternal(n);
+  if (markup)
+    {
+    // the ID may be changed through the returned pointer
+    this->InvalidateMarkupIndexByID();
+    }
+  return markup;
+}
+
+//---------------------------------------------------------------------------
+Markup *vtkMRMLMarkupsNode::GetNthMarkupInternal(int n)
 {
   if (this->MarkupExists(n))
     {
@@ -428,7 +452,7 @@ int vtkMRMLMarkupsNode:: GetNumberOfPointsInNthMarkup(int n)
     {
     return 0;
     }
-  Markup *markupN = this->GetNthMarkup(n);
+  Markup *markupN = this->GetNthMarkupInternal(n);
   if (markupN)
     {
     return markupN->points.size();
@@ -486,6 +510,11 @@ int vtkMRMLMarkupsNode::AddMarkup(Markup markup)
   this->MaximumNumberOfMarkups++;
 
   int markupIndex = this->GetNumberOfMarkups() - 1;
+  if (this->MarkupIndexByIDValid)
+    {
+    // keep the first markup if the ID is not unique, as a linear search would
+    this->MarkupIndexByID.insert(std::make_pair(markup.ID, markupIndex));
+    }
 
   this->Modified();
   this->InvokeCustomModifiedEvent(vtkMRMLMarkupsNode::MarkupAddedEvent, (void*)&markupIndex);
@@ -551,7 +580,7 @@ vtkVector3d vtkMRMLMarkupsNode::GetMarkupPointVector(int markupIndex, int pointI
     {
     return point;
     }
-  point = this->GetNthMarkup(markupIndex)->points[pointIndex];
+  point = this->GetNthMarkupInternal(markupIndex)->points[pointIndex];
   return point;
 }
 
@@ -585,6 +614,43 @@ int vtkMRMLMarkupsNode::GetMarkupPointWorld(int markupIndex, int pointIndex, dou
   return 1;
 }
 
+//-----------------------------------------------------------
+void vtkMRMLMarkupsNode::GetMarkupPointsWorld(vtkPoints* points, int pointIndex)
+{
+  if (!points)
+    {
+    vtkErrorMacro("GetMarkupPointsWorld: invalid points");
+    return;
+    }
+  vtkMRMLTransformNode* tnode = this->GetParentTransformNode();
+  vtkNew<vtkPoints> localPoints;
+  vtkPoints* markupPoints = (tnode ? localPoints.GetPointer() : points);
+  int numberOfMarkups = this->GetNumberOfMarkups();
+  markupPoints->SetNumberOfPoints(numberOfMarkups);
+  for (int m = 0; m < numberOfMarkups; ++m)
+    {
+    const std::vector<vtkVector3d>& pointsInMarkup = this->Markups[m].points;
+    if (pointIndex >= 0 && pointIndex < static_cast<int>(pointsInMarkup.size()))
+      {
+      markupPoints->SetPoint(m, pointsInMarkup[pointIndex].GetData());
+      }
+    else
+      {
+      markupPoints->SetPoint(m, 0.0, 0.0, 0.0);
+      }
+    }
+  if (!tnode)
+    {
+    return;
+    }
+
+  vtkNew<vtkGeneralTransform> transformToWorld;
+  tnode->GetTransformToWorld(transformToWorld.GetPointer());
+  // TransformPoints appends to the output points
+  points->Reset();
+  transformToWorld->TransformPoints(localPoints.GetPointer(), points);
+}
+
 //-----------------------------------------------------------
 void vtkMRMLMarkupsNode::RemoveMarkup(int m)
 {
@@ -592,6 +658,7 @@ void vtkMRMLMarkupsNode::RemoveMarkup(int m)
     {
     vtkDebugMacro("RemoveMarkup: m = " << m << ", markups size = " << this->Markups.size());
     this->Markups.erase(this->Markups.begin() + m);
+    this->InvalidateMarkupIndexByID();
 
     this->Modified();
     this->InvokeCustomModifiedEvent(vtkMRMLMarkupsNode::MarkupRemovedEvent, (void*)&m);
@@ -621,6 +688,7 @@ bool vtkMRMLMarkupsNode::InsertMarkup(Markup m, int targetIndex)
 
   std::vector < Markup >::iterator result;
   result = this->Markups.insert(pos, m);
+  this->InvalidateMarkupIndexByID();
 
   // sanity check
   if (result->Label.compare(m.Label) != 0)
@@ -646,6 +714,11 @@ void vtkMRMLMarkupsNode::CopyMarkup(Markup *source, Markup *target)
     return;
     }
 
+  if (target->ID != source->ID && !this->Markups.empty() &&
+      target >= &this->Markups.front() && target <= &this->Markups.back())
+    {
+    this->InvalidateMarkupIndexByID();
+    }
   target->ID = source->ID;
   target->Label = source->Label;
   target->Description = source->Description;
@@ -677,14 +750,15 @@ void vtkMRMLMarkupsNode::SwapMarkups(int m1, int m2)
     return;
     }
 
-  Markup *m1Markup = this->GetNthMarkup(m1);
+  Markup *m1Markup = this->GetNthMarkupInternal(m1);
   Markup m1MarkupBackup;
   // make a copy of the first markup
   this->CopyMarkup(m1Markup, &m1MarkupBackup);
   // copy the second markup into the first
-  this->CopyMarkup(this->GetNthMarkup(m2), m1Markup);
+  this->CopyMarkup(this->GetNthMarkupInternal(m2), m1Markup);
   // and copy the backup of the first one into the second
-  this->CopyMarkup(&m1MarkupBackup, this->GetNthMarkup(m2));
+  this->CopyMarkup(&m1MarkupBackup, this->GetNthMarkupInternal(m2));
+  this->InvalidateMarkupIndexByID();
 
   // and let listeners know that two markups have changed
   this->Modified();
@@ -719,7 +793,7 @@ void vtkMRMLMarkupsNode::SetMarkupPoint(const int markupIndex, const int pointIn
     {
     return;
     }
-  Markup *markup = this->GetNthMarkup(markupIndex);
+  Markup *markup = this->GetNthMarkupInternal(markupIndex);
   if (markup)
     {
     markup->points[pointIndex].SetX(x);
@@ -783,7 +857,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupOrientation(int n, double w, double x, doub
     {
     return;
     }
-  Markup *markup = this->GetNthMarkup(n);
+  Markup *markup = this->GetNthMarkupInternal(n);
   if (!markup)
     {
     return;
@@ -801,7 +875,7 @@ void vtkMRMLMarkupsNode::GetNthMarkupOrientation(int n, double orientation[4])
     {
     return;
     }
-  Markup *markup = this->GetNthMarkup(n);
+  Markup *markup = this->GetNthMarkupInternal(n);
   if (!markup)
     {
     return;
@@ -818,7 +892,7 @@ std::string vtkMRMLMarkupsNode::GetNthMarkupAssociatedNodeID(int n)
   std::string id = std::string("");
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       id = markup->AssociatedNodeID;
@@ -837,7 +911,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupAssociatedNodeID(int n, std::string id)
   vtkDebugMacro("SetNthMarkupAssociatedNodeID: n = " << n << ", id = '" << id.c_str() << "'");
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       vtkDebugMacro("Changing markup " << n << " associated node id from " << markup->AssociatedNodeID.c_str() << " to " << id.c_str());
@@ -859,7 +933,7 @@ std::string vtkMRMLMarkupsNode::GetNthMarkupID(int n)
   std::string id = std::string("");
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       id = markup->ID;
@@ -880,17 +954,32 @@ int vtkMRMLMarkupsNode::GetMarkupIndexByID(const char* markupID)
     return -1;
     }
 
+  if (!this->MarkupIndexByIDValid)
+    {
+    this->UpdateMarkupIndexByID();
+    }
+  std::map<std::string, int>::const_iterator it = this->MarkupIndexByID.find(markupID);
+  return (it != this->MarkupIndexByID.end() ? it->second : -1);
+}
+
+//-------------------------------------------------------------------------
+void vtkMRMLMarkupsNode::InvalidateMarkupIndexByID()
+{
+  this->MarkupIndexByID.clear();
+  this->MarkupIndexByIDValid = false;
+}
+
+//-------------------------------------------------------------------------
+void vtkMRMLMarkupsNode::UpdateMarkupIndexByID()
+{
+  this->MarkupIndexByID.clear();
   int numberOfMarkups = this->GetNumberOfMarkups();
   for (int i = 0; i < numberOfMarkups; ++i)
     {
-    Markup* compareMarkup = this->GetNthMarkup(i);
-    if (compareMarkup &&
-        strcmp(compareMarkup->ID.c_str(), markupID) == 0)
-      {
-      return i;
-      }
+    // keep the first markup if the ID is not unique, as a linear search would
+    this->MarkupIndexByID.insert(std::make_pair(this->Markups[i].ID, i));
     }
-  return -1;
+  this->MarkupIndexByIDValid = true;
 }
 
 //-------------------------------------------------------------------------
@@ -915,13 +1004,14 @@ void vtkMRMLMarkupsNode::SetNthMarkupID(int n, std::string id)
   vtkDebugMacro("SetNthMarkupID: n = " << n << ", id = '" << id.c_str() << "'");
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->ID.compare(id) != 0)
         {
         vtkDebugMacro("Changing markup " << n << " associated node id from " << markup->ID.c_str() << " to " << id.c_str());
         markup->ID = std::string(id.c_str());
+        this->InvalidateMarkupIndexByID();
         }
       else
         {
@@ -940,7 +1030,7 @@ bool vtkMRMLMarkupsNode::GetNthMarkupSelected(int n)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       return markup->Selected;
@@ -954,7 +1044,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupSelected(int n, bool flag)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->Selected != flag)
@@ -973,7 +1063,7 @@ bool vtkMRMLMarkupsNode::GetNthMarkupLocked(int n)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       return markup->Locked;
@@ -987,7 +1077,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupLocked(int n, bool flag)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->Locked != flag)
@@ -1006,7 +1096,7 @@ bool vtkMRMLMarkupsNode::GetNthMarkupVisibility(int n)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       return markup->Visibility;
@@ -1020,7 +1110,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupVisibility(int n, bool flag)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->Visibility != flag)
@@ -1039,7 +1129,7 @@ std::string vtkMRMLMarkupsNode::GetNthMarkupLabel(int n)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       return markup->Label;
@@ -1053,7 +1143,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupLabel(int n, std::string label)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->Label.compare(label))
@@ -1072,7 +1162,7 @@ std::string vtkMRMLMarkupsNode::GetNthMarkupDescription(int n)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       return markup->Description;
@@ -1086,7 +1176,7 @@ void vtkMRMLMarkupsNode::SetNthMarkupDescription(int n, std::string description)
 {
   if (this->MarkupExists(n))
     {
-    Markup *markup = this->GetNthMarkup(n);
+    Markup *markup = this->GetNthMarkupInternal(n);
     if (markup)
       {
       if (markup->Description.compare(description))
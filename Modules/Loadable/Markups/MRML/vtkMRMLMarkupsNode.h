@@ -28,8 +28,12 @@
 #include <vtkSmartPointer.h>
 #include <vtkVector.h>
 
-class vtkStringArray;
+// STD includes
+#include <map>
+
 class vtkMatrix4x4;
+class vtkPoints;
+class vtkStringArray;
 
 /// see doxygen enabled comment in class description
 typedef struct
@@ -135,6 +139,8 @@ public:
   /// Invoke the markup added event when adding a new markup to a markups node.
   /// Invoke the markup removed event when removing one or all markups from a node
   /// (caught by the displayable manager to make sure the widgets match the node).
+  /// The call data of the markup removed event is a pointer to the index of the
+  /// removed markup, or to -1 if all markups were removed at once by RemoveAllMarkups().
   enum
   {
     LockModifiedEvent = 19000,
@@ -148,7 +154,8 @@ public:
     MarkupRemovedEvent,
   };
 
-  /// Clear out the node of all markups
+  /// Clear out the node of all markups.
+  /// A single MarkupRemovedEvent is invoked with -1 as markup index.
   virtual void RemoveAllMarkups();
 
   /// Get the Locked property on the markup node/list of markups.
@@ -173,7 +180,9 @@ public:
   bool PointExistsInMarkup(int p, int n);
   /// Return the number of points in a markup, 0 if n is invalid
   int GetNumberOfPointsInNthMarkup(int n);
-  /// Return a pointer to the nth markup stored in this node, null if n is out of bounds
+  /// Return a pointer to the nth markup stored in this node, null if n is out of bounds.
+  /// As its ID may be changed through the pointer, the ID to index map of
+  /// GetMarkupIndexByID() is rebuilt on the next lookup.
   Markup * GetNthMarkup(int n);
   /// Initialise a markup to default values
   void InitMarkup(Markup *markup);
@@ -206,6 +215,12 @@ public:
   /// transform on the markup applied to the return of GetMarkupPoint.
   /// Returns 0 on failure, 1 on success.
   int GetMarkupPointWorld(int markupIndex, int pointIndex, double worldxyz[4]);
+  /// Set \a points to the world coordinates of the point \a pointIndex of
+  /// all the markups, point i being the position of the markup i.
+  /// The transform to world is retrieved only once, which makes it much
+  /// faster than calling GetMarkupPointWorld for each markup of a large list.
+  /// Markups that don't have the requested point are positioned at the origin.
+  void GetMarkupPointsWorld(vtkPoints* points, int pointIndex = 0);
 
   /// Remove a markup
   void RemoveMarkup(int m);
@@ -255,9 +270,14 @@ public:
 
   /// Get the id for the nth markup
   std::string GetNthMarkupID(int n = 0);
-  /// Get Markup index based on it's ID
+  /// Get Markup index based on it's ID, -1 if there is no markup with this ID.
+  /// Lookups use an ID to index map that is rebuilt after markups are
+  /// inserted, removed, swapped or renamed, or after a markup is accessed
+  /// through a pointer, so that successive lookups in a large list don't
+  /// scan all the markups.
   int GetMarkupIndexByID(const char* markupID);
   /// Get Markup based on it's ID
+  /// \sa GetNthMarkup()
   Markup* GetMarkupByID(const char* markupID);
 
   /// Get the Selected flag on the nth markup, returns false if markup doesn't
@@ -364,6 +384,19 @@ private:
   /// saved in the vector.
   std::vector < Markup > Markups;
 
+  /// Cache of the index of the markups, keyed by markup ID.
+  /// Appending a markup updates the map, other structural changes and
+  /// access to a markup through a pointer invalidate it and it is rebuilt
+  /// on the next lookup.
+  /// \sa GetMarkupIndexByID(), InvalidateMarkupIndexByID()
+  std::map<std::string, int> MarkupIndexByID;
+  bool MarkupIndexByIDValid;
+  void InvalidateMarkupIndexByID();
+  void UpdateMarkupIndexByID();
+  /// Return the nth markup without invalidating the ID map, for the
+  /// methods of this class that don't change its ID or update the map.
+  Markup* GetNthMarkupInternal(int n);
+
   int Locked;
 
   std::string MarkupLabelFormat;
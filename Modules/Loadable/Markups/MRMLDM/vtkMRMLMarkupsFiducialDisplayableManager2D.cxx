@@ -36,15 +36,22 @@
 
 // VTK includes
 #include <vtkAbstractWidget.h>
+#include <vtkActor2D.h>
 #include <vtkFollower.h>
+#include <vtkGlyph2D.h>
 #include <vtkHandleRepresentation.h>
 #include <vtkInteractorStyle.h>
 #include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkOrientedPolygonalHandleRepresentation3D.h>
+#include <vtkMatrix4x4.h>
 #include <vtkPickingManager.h>
+#include <vtkPointData.h>
 #include <vtkPointHandleRepresentation2D.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper2D.h>
 #include <vtkProperty2D.h>
 #include <vtkProperty.h>
 #include <vtkRenderer.h>
@@ -53,14 +60,52 @@
 #include <vtkSeedRepresentation.h>
 #include <vtkSmartPointer.h>
 #include <vtkSphereSource.h>
+#include <vtkUnsignedCharArray.h>
 
 // STD includes
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 //---------------------------------------------------------------------------
 vtkStandardNewMacro (vtkMRMLMarkupsFiducialDisplayableManager2D);
 
+//---------------------------------------------------------------------------
+class vtkMRMLMarkupsFiducialDisplayableManager2D::vtkInternal
+{
+public:
+  /// Rendering pipeline of a fiducial list that has too many fiducials to
+  /// be represented by handles. The points are the display coordinates of
+  /// the fiducials that are on the slice.
+  struct GlyphPipeline
+    {
+    vtkSmartPointer<vtkPolyData> PolyData;
+    vtkSmartPointer<vtkMarkupsGlyphSource2D> GlyphSource;
+    vtkSmartPointer<vtkGlyph2D> Glypher;
+    vtkSmartPointer<vtkPolyDataMapper2D> Mapper;
+    vtkSmartPointer<vtkActor2D> Actor;
+    /// Point of PolyData of each fiducial, -1 for fiducials that are hidden
+    /// or not on the slice
+    std::vector<vtkIdType> PointIds;
+    };
+  typedef std::map<vtkMRMLMarkupsNode*, GlyphPipeline> GlyphPipelinesType;
+  GlyphPipelinesType GlyphPipelines;
+};
+
+//---------------------------------------------------------------------------
+namespace
+{
+void GetGlyphColor(vtkMRMLMarkupsDisplayNode* displayNode, bool selected, unsigned char color[3])
+{
+  double* displayColor = (selected ? displayNode->GetSelectedColor() : displayNode->GetColor());
+  for (int i = 0; i < 3; ++i)
+    {
+    color[i] = static_cast<unsigned char>(displayColor[i] * 255.0);
+    }
+}
+}
+
 //---------------------------------------------------------------------------
 // vtkMRMLMarkupsFiducialDisplayableManager2D Callback
 /// \ingroup Slicer_QtModules_Markups
@@ -249,13 +294,246 @@ public:
 //---------------------------------------------------------------------------
 // vtkMRMLMarkupsFiducialDisplayableManager2D methods
 
+//---------------------------------------------------------------------------
+vtkMRMLMarkupsFiducialDisplayableManager2D::vtkMRMLMarkupsFiducialDisplayableManager2D()
+{
+  this->Focus = "vtkMRMLMarkupsFiducialNode";
+  this->MaximumNumberOfHandles = 5000;
+  this->Internal = new vtkInternal;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLMarkupsFiducialDisplayableManager2D::~vtkMRMLMarkupsFiducialDisplayableManager2D()
+{
+  while (!this->Internal->GlyphPipelines.empty())
+    {
+    this->RemoveGlyphActor(this->Internal->GlyphPipelines.begin()->first);
+    }
+  delete this->Internal;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLMarkupsFiducialDisplayableManager2D::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfHandles = " << this->MaximumNumberOfHandles << std::endl;
   this->Helper->PrintSelf(os, indent);
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLMarkupsFiducialDisplayableManager2D::UseGlyphActor(vtkMRMLMarkupsNode* node)
+{
+  return node && this->MaximumNumberOfHandles >= 0
+    && node->GetNumberOfMarkups() > this->MaximumNumberOfHandles;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLMarkupsFiducialDisplayableManager2D::GetGlyphDisplayPosition(double worldPosition[4],
+  vtkMatrix4x4* rasToXY, double displayPosition[4])
+{
+  double worldCoordinates[4] = { worldPosition[0], worldPosition[1], worldPosition[2], 1.0 };
+  rasToXY->MultiplyPoint(worldCoordinates, displayPosition);
+  // same criterion as IsWidgetDisplayableOnSlice: within half a slice of the
+  // slices displayed by the view
+  double maxDistance = 0.5 + (this->GetMRMLSliceNode()->GetDimensions()[2] - 1);
+  return displayPosition[2] >= -0.5 && displayPosition[2] < maxDistance;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager2D::UpdateGlyphActor(vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  vtkMRMLSliceNode* sliceNode = this->GetMRMLSliceNode();
+  if (!fiducialNode || !sliceNode || !this->GetRenderer())
+    {
+    return;
+    }
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  if (!displayNode)
+    {
+    vtkDebugMacro("UpdateGlyphActor: Could not get display node for node " << (fiducialNode->GetID() ? fiducialNode->GetID() : "null id"));
+    return;
+    }
+
+  vtkInternal::GlyphPipeline& pipeline = this->Internal->GlyphPipelines[fiducialNode];
+  if (!pipeline.Actor)
+    {
+    pipeline.PolyData = vtkSmartPointer<vtkPolyData>::New();
+    pipeline.GlyphSource = vtkSmartPointer<vtkMarkupsGlyphSource2D>::New();
+    pipeline.Glypher = vtkSmartPointer<vtkGlyph2D>::New();
+    pipeline.Glypher->SetInputData(pipeline.PolyData);
+    pipeline.Glypher->SetSourceConnection(pipeline.GlyphSource->GetOutputPort());
+    pipeline.Glypher->ScalingOff();
+    pipeline.Glypher->OrientOff();
+    pipeline.Glypher->SetColorModeToColorByScalar();
+    pipeline.Mapper = vtkSmartPointer<vtkPolyDataMapper2D>::New();
+    pipeline.Mapper->SetInputConnection(pipeline.Glypher->GetOutputPort());
+    pipeline.Actor = vtkSmartPointer<vtkActor2D>::New();
+    pipeline.Actor->SetMapper(pipeline.Mapper);
+    this->GetRenderer()->AddActor2D(pipeline.Actor);
+    }
+
+  // same glyph and size as the projections of the fiducials
+  int glyphType = displayNode->GetGlyphType();
+  if (glyphType == vtkMRMLMarkupsDisplayNode::Sphere3D)
+    {
+    glyphType = vtkMRMLMarkupsDisplayNode::Circle2D;
+    }
+  else if (glyphType == vtkMRMLMarkupsDisplayNode::Diamond3D)
+    {
+    glyphType = vtkMRMLMarkupsDisplayNode::Diamond2D;
+    }
+  else if (displayNode->GlyphTypeIs3D())
+    {
+    glyphType = vtkMRMLMarkupsDisplayNode::StarBurst2D;
+    }
+  pipeline.GlyphSource->SetGlyphType(glyphType);
+  pipeline.GlyphSource->SetScale(displayNode->GetGlyphScale() * 2.0);
+  pipeline.GlyphSource->FilledOn();
+  pipeline.Actor->GetProperty()->SetOpacity(displayNode->GetOpacity());
+
+  // display positions and colors of the visible fiducials on the slice
+  vtkNew<vtkMatrix4x4> rasToXY;
+  vtkMatrix4x4::Invert(sliceNode->GetXYToRAS(), rasToXY.GetPointer());
+  vtkNew<vtkPoints> worldPoints;
+  fiducialNode->GetMarkupPointsWorld(worldPoints.GetPointer());
+  int numberOfFiducials = fiducialNode->GetNumberOfMarkups();
+  vtkNew<vtkPoints> points;
+  vtkNew<vtkUnsignedCharArray> colors;
+  colors->SetName("Colors");
+  colors->SetNumberOfComponents(3);
+  unsigned char color[3];
+  unsigned char selectedColor[3];
+  GetGlyphColor(displayNode, false, color);
+  GetGlyphColor(displayNode, true, selectedColor);
+  pipeline.PointIds.assign(numberOfFiducials, -1);
+  // fiducials are not shown in light box mode, see IsWidgetDisplayableOnSlice
+  if (!this->IsInLightboxMode())
+    {
+    for (int n = 0; n < numberOfFiducials; n++)
+      {
+      double worldPosition[4] = { 0.0, 0.0, 0.0, 1.0 };
+      worldPoints->GetPoint(n, worldPosition);
+      double displayPosition[4] = { 0.0, 0.0, 0.0, 1.0 };
+      if (!fiducialNode->GetNthMarkupVisibility(n) ||
+          !this->GetGlyphDisplayPosition(worldPosition, rasToXY.GetPointer(), displayPosition))
+        {
+        continue;
+        }
+      pipeline.PointIds[n] = points->InsertNextPoint(displayPosition[0], displayPosition[1], 0.0);
+      colors->InsertNextTypedTuple(fiducialNode->GetNthMarkupSelected(n) ? selectedColor : color);
+      }
+    }
+  pipeline.PolyData->SetPoints(points.GetPointer());
+  pipeline.PolyData->GetPointData()->SetScalars(colors.GetPointer());
+
+  this->UpdateGlyphActorVisibility(fiducialNode);
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager2D::UpdateGlyphActorVisibility(vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(fiducialNode);
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  if (it == this->Internal->GlyphPipelines.end() || !displayNode)
+    {
+    return;
+    }
+  vtkMRMLSliceNode* sliceNode = this->GetMRMLSliceNode();
+  bool visible = true;
+  if ((sliceNode && !displayNode->IsDisplayableInView(sliceNode->GetID())) ||
+      displayNode->GetVisibility() == 0 ||
+      it->second.PolyData->GetNumberOfPoints() == 0)
+    {
+    visible = false;
+    }
+  it->second.Actor->SetVisibility(visible);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager2D::UpdateNthGlyphPoint(int n, vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  if (!fiducialNode)
+    {
+    return;
+    }
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(fiducialNode);
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  vtkMRMLSliceNode* sliceNode = this->GetMRMLSliceNode();
+  int numberOfFiducials = fiducialNode->GetNumberOfMarkups();
+  if (it == this->Internal->GlyphPipelines.end() || !displayNode || !sliceNode ||
+      n < 0 || n >= numberOfFiducials)
+    {
+    this->UpdateGlyphActor(fiducialNode);
+    return;
+    }
+  vtkInternal::GlyphPipeline& pipeline = it->second;
+  int numberOfPipelineFiducials = static_cast<int>(pipeline.PointIds.size());
+  bool appended = (n == numberOfFiducials - 1 && numberOfPipelineFiducials == n);
+  if (!appended && numberOfPipelineFiducials != numberOfFiducials)
+    {
+    // inserted fiducial: the point indices change
+    this->UpdateGlyphActor(fiducialNode);
+    return;
+    }
+
+  vtkNew<vtkMatrix4x4> rasToXY;
+  vtkMatrix4x4::Invert(sliceNode->GetXYToRAS(), rasToXY.GetPointer());
+  double worldPosition[4] = { 0.0, 0.0, 0.0, 1.0 };
+  fiducialNode->GetMarkupPointWorld(n, 0, worldPosition);
+  double displayPosition[4] = { 0.0, 0.0, 0.0, 1.0 };
+  bool visible = !this->IsInLightboxMode() && fiducialNode->GetNthMarkupVisibility(n) &&
+    this->GetGlyphDisplayPosition(worldPosition, rasToXY.GetPointer(), displayPosition);
+  if (!appended && (pipeline.PointIds[n] >= 0) != visible)
+    {
+    // the fiducial was moved to or from the slice, or its visibility changed
+    this->UpdateGlyphActor(fiducialNode);
+    return;
+    }
+  if (appended)
+    {
+    pipeline.PointIds.push_back(-1);
+    }
+  if (visible)
+    {
+    unsigned char color[3];
+    GetGlyphColor(displayNode, fiducialNode->GetNthMarkupSelected(n), color);
+    vtkPoints* points = pipeline.PolyData->GetPoints();
+    vtkUnsignedCharArray* colors = vtkUnsignedCharArray::SafeDownCast(pipeline.PolyData->GetPointData()->GetScalars());
+    if (appended)
+      {
+      pipeline.PointIds[n] = points->InsertNextPoint(displayPosition[0], displayPosition[1], 0.0);
+      colors->InsertNextTypedTuple(color);
+      }
+    else
+      {
+      points->SetPoint(pipeline.PointIds[n], displayPosition[0], displayPosition[1], 0.0);
+      colors->SetTypedTuple(pipeline.PointIds[n], color);
+      }
+    points->Modified();
+    colors->Modified();
+    pipeline.PolyData->Modified();
+    }
+  this->UpdateGlyphActorVisibility(fiducialNode);
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager2D::RemoveGlyphActor(vtkMRMLMarkupsNode* node)
+{
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(node);
+  if (it == this->Internal->GlyphPipelines.end())
+    {
+    return;
+    }
+  if (it->second.Actor && this->GetRenderer())
+    {
+    this->GetRenderer()->RemoveActor2D(it->second.Actor);
+    }
+  this->Internal->GlyphPipelines.erase(it);
+  this->RequestRender();
+}
+
 //---------------------------------------------------------------------------
 /// Create a new seed widget.
 vtkAbstractWidget * vtkMRMLMarkupsFiducialDisplayableManager2D::CreateWidget(vtkMRMLMarkupsNode* node)
@@ -459,6 +737,15 @@ bool vtkMRMLMarkupsFiducialDisplayableManager2D::UpdateNthSeedPositionFromMRML(i
     {
     return false;
     }
+  if (n >= seedRepresentation->GetNumberOfSeeds())
+    {
+    // no handle, the fiducials may be rendered by a glyph actor
+    if (this->UseGlyphActor(pointsNode))
+      {
+      this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(pointsNode));
+      }
+    return false;
+    }
   bool positionChanged = false;
 
 //  std::cout << "UpdateNthSeedPositionFromMRML: n = " << n << std::endl;
@@ -1087,10 +1374,23 @@ void vtkMRMLMarkupsFiducialDisplayableManager2D::PropagateMRMLToWidget(vtkMRMLMa
       }
     }
 
-  for (int n = 0; n < numberOfFiducials; n++)
+  if (this->UseGlyphActor(fiducialNode))
+    {
+    // too many fiducials for one handle each, render them all at once
+    while (seedRepresentation->GetNumberOfSeeds() > 0)
+      {
+      seedWidget->DeleteSeed(seedRepresentation->GetNumberOfSeeds() - 1);
+      }
+    this->UpdateGlyphActor(fiducialNode);
+    }
+  else
     {
-    // std::cout << "Fids PropagateMRMLToWidget: n = " << n << std::endl;
-    this->SetNthSeed(n, fiducialNode, seedWidget);
+    this->RemoveGlyphActor(fiducialNode);
+    for (int n = 0; n < numberOfFiducials; n++)
+      {
+      // std::cout << "Fids PropagateMRMLToWidget: n = " << n << std::endl;
+      this->SetNthSeed(n, fiducialNode, seedWidget);
+      }
     }
 
 
@@ -1427,6 +1727,12 @@ void vtkMRMLMarkupsFiducialDisplayableManager2D::UpdatePosition(vtkAbstractWidge
    return;
    }
 
+  if (this->UseGlyphActor(pointsNode))
+    {
+    this->UpdateGlyphActor(vtkMRMLMarkupsFiducialNode::SafeDownCast(pointsNode));
+    return;
+    }
+
   // now get the widget properties (coordinates, measurement etc.) and if the mrml node has changed, propagate the changes
 
 
@@ -1462,6 +1768,17 @@ void vtkMRMLMarkupsFiducialDisplayableManager2D::OnMRMLSceneEndClose()
 
   // clear out the map of glyph types
   this->Helper->ClearNodeGlyphTypes();
+  while (!this->Internal->GlyphPipelines.empty())
+    {
+    this->RemoveGlyphActor(this->Internal->GlyphPipelines.begin()->first);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager2D::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  this->Superclass::OnMRMLSceneNodeRemoved(node);
+  this->RemoveGlyphActor(vtkMRMLMarkupsNode::SafeDownCast(node));
 }
 
 //---------------------------------------------------------------------------
@@ -1487,6 +1804,11 @@ void vtkMRMLMarkupsFiducialDisplayableManager2D::OnMRMLMarkupsNodeNthMarkupModif
    vtkErrorMacro("OnMRMLMarkupsNodeNthMarkupModifiedEvent: Could not get seed widget!")
    return;
    }
+  if (this->UseGlyphActor(node))
+    {
+    this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(node));
+    return;
+    }
   this->SetNthSeed(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(node), seedWidget);
 }
 
@@ -1522,6 +1844,21 @@ void vtkMRMLMarkupsFiducialDisplayableManager2D::OnMRMLMarkupsNodeMarkupAddedEve
    return;
    }
 
+  if (this->UseGlyphActor(markupsNode))
+    {
+    vtkSeedRepresentation* seedRepresentation = vtkSeedRepresentation::SafeDownCast(seedWidget->GetRepresentation());
+    if (seedRepresentation && seedRepresentation->GetNumberOfSeeds() > 0)
+      {
+      // removes the handles if the list just became too large for them
+      this->PropagateMRMLToWidget(markupsNode, seedWidget);
+      }
+    else
+      {
+      this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(markupsNode));
+      }
+    return;
+    }
+
   // this call will create a new handle and set it
   // std::cout << "OnMRMLMarkupsNodeMarkupAddedEvent: adding to markups node that currently has " << markupsNode->GetNumberOfMarkups() << std::endl;
   this->SetNthSeed(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(markupsNode), seedWidget);
@@ -24,12 +24,19 @@
 // MarkupsModule/MRMLDisplayableManager includes
 #include "vtkMRMLMarkupsDisplayableManager2D.h"
 
+class vtkMatrix4x4;
 class vtkMRMLMarkupsFiducialNode;
 class vtkSlicerViewerWidget;
 class vtkMRMLMarkupsDisplayNode;
 class vtkTextWidget;
 
 /// \ingroup Slicer_QtModules_Markups
+/// \brief Displayable manager for fiducial lists in slice views.
+///
+/// Each fiducial of a list is represented by a handle of a seed widget.
+/// Lists with more fiducials than MaximumNumberOfHandles are instead
+/// rendered by a single 2D glyph actor that only contains the fiducials on the slice.
+/// These fiducials have no label nor projection and can't be dragged.
 class VTK_SLICER_MARKUPS_MODULE_MRMLDISPLAYABLEMANAGER_EXPORT vtkMRMLMarkupsFiducialDisplayableManager2D :
     public vtkMRMLMarkupsDisplayableManager2D
 {
@@ -45,10 +52,17 @@ public:
   /// Update a single markup position from the seed widget, return true if the position changed
   virtual bool UpdateNthMarkupPositionFromWidget(int n, vtkMRMLMarkupsNode* pointsNode, vtkAbstractWidget * widget) VTK_OVERRIDE;
 
+  /// Maximum number of fiducials of a list that are represented by handles,
+  /// larger lists are rendered by a single glyph actor, without labels nor
+  /// dragging. Default is 5000, above which the handles make the view
+  /// unresponsive. Set it to -1 to represent all the lists by handles.
+  vtkSetMacro(MaximumNumberOfHandles, int);
+  vtkGetMacro(MaximumNumberOfHandles, int);
+
 protected:
 
-  vtkMRMLMarkupsFiducialDisplayableManager2D(){this->Focus="vtkMRMLMarkupsFiducialNode";}
-  virtual ~vtkMRMLMarkupsFiducialDisplayableManager2D(){}
+  vtkMRMLMarkupsFiducialDisplayableManager2D();
+  virtual ~vtkMRMLMarkupsFiducialDisplayableManager2D();
 
   /// Callback for click in RenderWindow
   virtual void OnClickInRenderWindow(double x, double y, const char *associatedNodeID) VTK_OVERRIDE;
@@ -82,6 +96,31 @@ protected:
 
   // Clean up when scene closes
   virtual void OnMRMLSceneEndClose() VTK_OVERRIDE;
+  /// Remove the glyph actor of the removed node
+  virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) VTK_OVERRIDE;
+
+  /// Return true if the fiducials of the node are rendered by a glyph actor
+  /// instead of handles.
+  /// \sa MaximumNumberOfHandles
+  bool UseGlyphActor(vtkMRMLMarkupsNode* node);
+  /// Compute the display position of a fiducial with the RAS to XY matrix
+  /// of the slice, return true if the fiducial is on the slice.
+  bool GetGlyphDisplayPosition(double worldPosition[4], vtkMatrix4x4* rasToXY, double displayPosition[4]);
+  /// Create or update the glyph actor of a fiducial list
+  void UpdateGlyphActor(vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Update the glyph of the nth fiducial of a list, or append it if it is
+  /// the last fiducial and is not rendered yet. The whole glyph actor is
+  /// updated if the fiducial was inserted, or moved to or from the slice.
+  void UpdateNthGlyphPoint(int n, vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Show the glyph actor if the list and at least one fiducial are visible
+  void UpdateGlyphActorVisibility(vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Remove the glyph actor of a fiducial list from the renderer
+  void RemoveGlyphActor(vtkMRMLMarkupsNode* node);
+
+  int MaximumNumberOfHandles;
+
+  class vtkInternal;
+  vtkInternal* Internal;
 
 private:
 
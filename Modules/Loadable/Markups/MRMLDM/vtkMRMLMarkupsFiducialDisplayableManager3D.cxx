@@ -37,7 +37,9 @@
 
 // VTK includes
 #include <vtkAbstractWidget.h>
+#include <vtkActor.h>
 #include <vtkFollower.h>
+#include <vtkGlyph3DMapper.h>
 #include <vtkHandleRepresentation.h>
 #include <vtkInteractorStyle.h>
 #include <vtkMath.h>
@@ -45,6 +47,11 @@
 #include <vtkObjectFactory.h>
 #include <vtkOrientedPolygonalHandleRepresentation3D.h>
 #include <vtkPickingManager.h>
+#include <vtkPointData.h>
+#include <vtkPointLocator.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPropPicker.h>
 #include <vtkProperty2D.h>
 #include <vtkProperty.h>
 #include <vtkRenderer.h>
@@ -53,14 +60,56 @@
 #include <vtkSmartPointer.h>
 #include <vtkSeedRepresentation.h>
 #include <vtkSphereSource.h>
+#include <vtkUnsignedCharArray.h>
 
 // STD includes
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 //---------------------------------------------------------------------------
 vtkStandardNewMacro (vtkMRMLMarkupsFiducialDisplayableManager3D);
 
+//---------------------------------------------------------------------------
+class vtkMRMLMarkupsFiducialDisplayableManager3D::vtkInternal
+{
+public:
+  /// Rendering pipeline of a fiducial list that has too many fiducials to
+  /// be represented by handles.
+  struct GlyphPipeline
+    {
+    vtkSmartPointer<vtkPolyData> PolyData;
+    vtkSmartPointer<vtkSphereSource> GlyphSource;
+    vtkSmartPointer<vtkGlyph3DMapper> Mapper;
+    vtkSmartPointer<vtkActor> Actor;
+    vtkSmartPointer<vtkPointLocator> Locator;
+    /// Index of the fiducial of each point of PolyData, hidden fiducials
+    /// are not drawn.
+    std::vector<int> MarkupIndices;
+    /// Point of PolyData of each fiducial, -1 for hidden fiducials
+    std::vector<vtkIdType> PointIds;
+    };
+  typedef std::map<vtkMRMLMarkupsNode*, GlyphPipeline> GlyphPipelinesType;
+  GlyphPipelinesType GlyphPipelines;
+
+  vtkNew<vtkPropPicker> Picker;
+  int LeftButtonPressPosition[2];
+};
+
+//---------------------------------------------------------------------------
+namespace
+{
+void GetGlyphColor(vtkMRMLMarkupsDisplayNode* displayNode, bool selected, unsigned char color[3])
+{
+  double* displayColor = (selected ? displayNode->GetSelectedColor() : displayNode->GetColor());
+  for (int i = 0; i < 3; ++i)
+    {
+    color[i] = static_cast<unsigned char>(displayColor[i] * 255.0);
+    }
+}
+}
+
 //---------------------------------------------------------------------------
 // vtkMRMLMarkupsFiducialDisplayableManager3D Callback
 /// \ingroup Slicer_QtModules_Markups
@@ -165,13 +214,250 @@ public:
 //---------------------------------------------------------------------------
 // vtkMRMLMarkupsFiducialDisplayableManager3D methods
 
+//---------------------------------------------------------------------------
+vtkMRMLMarkupsFiducialDisplayableManager3D::vtkMRMLMarkupsFiducialDisplayableManager3D()
+{
+  this->Focus = "vtkMRMLMarkupsFiducialNode";
+  this->MaximumNumberOfHandles = 5000;
+  this->Internal = new vtkInternal;
+  this->Internal->Picker->PickFromListOn();
+  this->Internal->LeftButtonPressPosition[0] = -1;
+  this->Internal->LeftButtonPressPosition[1] = -1;
+}
+
+//---------------------------------------------------------------------------
+vtkMRMLMarkupsFiducialDisplayableManager3D::~vtkMRMLMarkupsFiducialDisplayableManager3D()
+{
+  while (!this->Internal->GlyphPipelines.empty())
+    {
+    this->RemoveGlyphActor(this->Internal->GlyphPipelines.begin()->first);
+    }
+  delete this->Internal;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLMarkupsFiducialDisplayableManager3D::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfHandles = " << this->MaximumNumberOfHandles << std::endl;
   this->Helper->PrintSelf(os, indent);
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLMarkupsFiducialDisplayableManager3D::UseGlyphActor(vtkMRMLMarkupsNode* node)
+{
+  return node && this->MaximumNumberOfHandles >= 0
+    && node->GetNumberOfMarkups() > this->MaximumNumberOfHandles;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager3D::UpdateGlyphActor(vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  if (!fiducialNode)
+    {
+    return;
+    }
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  if (!displayNode)
+    {
+    vtkDebugMacro("UpdateGlyphActor: Could not get display node for node " << (fiducialNode->GetID() ? fiducialNode->GetID() : "null id"));
+    return;
+    }
+
+  vtkInternal::GlyphPipeline& pipeline = this->Internal->GlyphPipelines[fiducialNode];
+  if (!pipeline.Actor)
+    {
+    pipeline.PolyData = vtkSmartPointer<vtkPolyData>::New();
+    pipeline.GlyphSource = vtkSmartPointer<vtkSphereSource>::New();
+    pipeline.GlyphSource->SetPhiResolution(8);
+    pipeline.GlyphSource->SetThetaResolution(8);
+    pipeline.Mapper = vtkSmartPointer<vtkGlyph3DMapper>::New();
+    pipeline.Mapper->SetInputData(pipeline.PolyData);
+    pipeline.Mapper->SetSourceConnection(pipeline.GlyphSource->GetOutputPort());
+    pipeline.Mapper->ScalingOff();
+    pipeline.Mapper->OrientOff();
+    pipeline.Actor = vtkSmartPointer<vtkActor>::New();
+    pipeline.Actor->SetMapper(pipeline.Mapper);
+    pipeline.Locator = vtkSmartPointer<vtkPointLocator>::New();
+    pipeline.Locator->SetDataSet(pipeline.PolyData);
+    this->GetRenderer()->AddActor(pipeline.Actor);
+    this->Internal->Picker->AddPickList(pipeline.Actor);
+    }
+
+  // same size as the handles, that have a unit size glyph
+  pipeline.GlyphSource->SetRadius(0.5 * displayNode->GetGlyphScale());
+
+  // positions and colors of the visible fiducials
+  vtkNew<vtkPoints> worldPoints;
+  fiducialNode->GetMarkupPointsWorld(worldPoints.GetPointer());
+  int numberOfFiducials = fiducialNode->GetNumberOfMarkups();
+  vtkNew<vtkPoints> points;
+  points->Allocate(numberOfFiducials);
+  vtkNew<vtkUnsignedCharArray> colors;
+  colors->SetName("Colors");
+  colors->SetNumberOfComponents(3);
+  colors->Allocate(3 * numberOfFiducials);
+  unsigned char color[3];
+  unsigned char selectedColor[3];
+  GetGlyphColor(displayNode, false, color);
+  GetGlyphColor(displayNode, true, selectedColor);
+  pipeline.MarkupIndices.clear();
+  pipeline.PointIds.assign(numberOfFiducials, -1);
+  for (int n = 0; n < numberOfFiducials; n++)
+    {
+    if (!fiducialNode->GetNthMarkupVisibility(n))
+      {
+      continue;
+      }
+    pipeline.PointIds[n] = points->InsertNextPoint(worldPoints->GetPoint(n));
+    colors->InsertNextTypedTuple(fiducialNode->GetNthMarkupSelected(n) ? selectedColor : color);
+    pipeline.MarkupIndices.push_back(n);
+    }
+  pipeline.PolyData->SetPoints(points.GetPointer());
+  pipeline.PolyData->GetPointData()->SetScalars(colors.GetPointer());
+
+  vtkProperty* prop = pipeline.Actor->GetProperty();
+  prop->SetOpacity(displayNode->GetOpacity());
+  prop->SetAmbient(displayNode->GetAmbient());
+  prop->SetDiffuse(displayNode->GetDiffuse());
+  prop->SetSpecular(displayNode->GetSpecular());
+
+  this->UpdateGlyphActorVisibility(fiducialNode);
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager3D::UpdateGlyphActorVisibility(vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(fiducialNode);
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  if (it == this->Internal->GlyphPipelines.end() || !displayNode)
+    {
+    return;
+    }
+  bool visible = true;
+  vtkMRMLViewNode *viewNode = this->GetMRMLViewNode();
+  if ((viewNode && displayNode->GetVisibility(viewNode->GetID()) == 0) ||
+      displayNode->GetVisibility() == 0 ||
+      it->second.MarkupIndices.empty())
+    {
+    visible = false;
+    }
+  it->second.Actor->SetVisibility(visible);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager3D::UpdateNthGlyphPoint(int n, vtkMRMLMarkupsFiducialNode* fiducialNode)
+{
+  if (!fiducialNode)
+    {
+    return;
+    }
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(fiducialNode);
+  vtkMRMLMarkupsDisplayNode *displayNode = fiducialNode->GetMarkupsDisplayNode();
+  int numberOfFiducials = fiducialNode->GetNumberOfMarkups();
+  if (it == this->Internal->GlyphPipelines.end() || !displayNode || n < 0 || n >= numberOfFiducials)
+    {
+    this->UpdateGlyphActor(fiducialNode);
+    return;
+    }
+  vtkInternal::GlyphPipeline& pipeline = it->second;
+  int numberOfPipelineFiducials = static_cast<int>(pipeline.PointIds.size());
+  bool appended = (n == numberOfFiducials - 1 && numberOfPipelineFiducials == n);
+  bool visible = fiducialNode->GetNthMarkupVisibility(n);
+  if (!appended &&
+      (numberOfPipelineFiducials != numberOfFiducials || (pipeline.PointIds[n] >= 0) != visible))
+    {
+    // inserted fiducial or visibility change: the point indices change
+    this->UpdateGlyphActor(fiducialNode);
+    return;
+    }
+  if (appended)
+    {
+    pipeline.PointIds.push_back(-1);
+    }
+  if (visible)
+    {
+    double worldPosition[4] = { 0.0, 0.0, 0.0, 1.0 };
+    fiducialNode->GetMarkupPointWorld(n, 0, worldPosition);
+    unsigned char color[3];
+    GetGlyphColor(displayNode, fiducialNode->GetNthMarkupSelected(n), color);
+    vtkPoints* points = pipeline.PolyData->GetPoints();
+    vtkUnsignedCharArray* colors = vtkUnsignedCharArray::SafeDownCast(pipeline.PolyData->GetPointData()->GetScalars());
+    if (appended)
+      {
+      pipeline.PointIds[n] = points->InsertNextPoint(worldPosition);
+      colors->InsertNextTypedTuple(color);
+      pipeline.MarkupIndices.push_back(n);
+      }
+    else
+      {
+      points->SetPoint(pipeline.PointIds[n], worldPosition);
+      colors->SetTypedTuple(pipeline.PointIds[n], color);
+      }
+    points->Modified();
+    colors->Modified();
+    pipeline.PolyData->Modified();
+    }
+  this->UpdateGlyphActorVisibility(fiducialNode);
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager3D::RemoveGlyphActor(vtkMRMLMarkupsNode* node)
+{
+  vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.find(node);
+  if (it == this->Internal->GlyphPipelines.end())
+    {
+    return;
+    }
+  if (it->second.Actor)
+    {
+    if (this->GetRenderer())
+      {
+      this->GetRenderer()->RemoveActor(it->second.Actor);
+      }
+    this->Internal->Picker->DeletePickList(it->second.Actor);
+    }
+  this->Internal->GlyphPipelines.erase(it);
+  this->RequestRender();
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLMarkupsFiducialDisplayableManager3D::PickGlyph(int x, int y, vtkMRMLMarkupsNode*& pickedNode)
+{
+  pickedNode = NULL;
+  if (this->Internal->GlyphPipelines.empty() || !this->GetRenderer())
+    {
+    return -1;
+    }
+  // the prop picker uses the depth buffer, its cost doesn't depend on the
+  // number of fiducials. The closest fiducial to the picked position on the
+  // glyph surface is then found with the locator.
+  if (!this->Internal->Picker->Pick(x, y, 0, this->GetRenderer()))
+    {
+    return -1;
+    }
+  vtkActor* pickedActor = this->Internal->Picker->GetActor();
+  for (vtkInternal::GlyphPipelinesType::iterator it = this->Internal->GlyphPipelines.begin();
+       it != this->Internal->GlyphPipelines.end(); ++it)
+    {
+    vtkInternal::GlyphPipeline& pipeline = it->second;
+    if (pipeline.Actor.GetPointer() != pickedActor || pipeline.MarkupIndices.empty())
+      {
+      continue;
+      }
+    vtkIdType pointId = pipeline.Locator->FindClosestPoint(this->Internal->Picker->GetPickPosition());
+    if (pointId < 0 || pointId >= static_cast<vtkIdType>(pipeline.MarkupIndices.size()))
+      {
+      return -1;
+      }
+    pickedNode = it->first;
+    return pipeline.MarkupIndices[pointId];
+    }
+  return -1;
+}
+
 //---------------------------------------------------------------------------
 /// Create a new widget.
 vtkAbstractWidget * vtkMRMLMarkupsFiducialDisplayableManager3D::CreateWidget(vtkMRMLMarkupsNode* node)
@@ -285,6 +571,15 @@ bool vtkMRMLMarkupsFiducialDisplayableManager3D::UpdateNthSeedPositionFromMRML(i
     {
     return false;
     }
+  if (n >= seedRepresentation->GetNumberOfSeeds())
+    {
+    // no handle, the fiducials may be rendered by a glyph actor
+    if (this->UseGlyphActor(pointsNode))
+      {
+      this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(pointsNode));
+      }
+    return false;
+    }
   bool positionChanged = false;
 
   // transform fiducial point using parent transforms
@@ -591,10 +886,24 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::PropagateMRMLToWidget(vtkMRMLMa
 
   vtkDebugMacro("Fids PropagateMRMLToWidget, node num markups = " << numberOfFiducials);
 
-  for (int n = 0; n < numberOfFiducials; n++)
+  vtkSeedRepresentation * seedRepresentation = vtkSeedRepresentation::SafeDownCast(seedWidget->GetRepresentation());
+  if (this->UseGlyphActor(fiducialNode))
+    {
+    // too many fiducials for one handle each, render them all at once
+    while (seedRepresentation->GetNumberOfSeeds() > 0)
+      {
+      seedWidget->DeleteSeed(seedRepresentation->GetNumberOfSeeds() - 1);
+      }
+    this->UpdateGlyphActor(fiducialNode);
+    }
+  else
     {
-    // std::cout << "Fids PropagateMRMLToWidget: n = " << n << std::endl;
-    this->SetNthSeed(n, fiducialNode, seedWidget);
+    this->RemoveGlyphActor(fiducialNode);
+    for (int n = 0; n < numberOfFiducials; n++)
+      {
+      // std::cout << "Fids PropagateMRMLToWidget: n = " << n << std::endl;
+      this->SetNthSeed(n, fiducialNode, seedWidget);
+      }
     }
 
   // update lock status
@@ -604,7 +913,6 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::PropagateMRMLToWidget(vtkMRMLMa
   // std::cout << "PropagateMRMLToWidget: calling UpdateWidgetVisibility" << std::endl;
   this->UpdateWidgetVisibility(node);
 
-  vtkSeedRepresentation * seedRepresentation = vtkSeedRepresentation::SafeDownCast(seedWidget->GetRepresentation());
   seedRepresentation->NeedToRenderOn();
   seedWidget->Modified();
 
@@ -842,7 +1150,28 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::OnInteractorStyleEvent(int even
     return;
     }
 
-  if (eventid == vtkCommand::KeyPressEvent)
+  if (eventid == vtkCommand::LeftButtonPressEvent)
+    {
+    this->Internal->LeftButtonPressPosition[0] = this->GetInteractor()->GetEventPosition()[0];
+    this->Internal->LeftButtonPressPosition[1] = this->GetInteractor()->GetEventPosition()[1];
+    }
+  else if (eventid == vtkCommand::LeftButtonReleaseEvent)
+    {
+    // a click on a fiducial rendered by a glyph actor
+    int* position = this->GetInteractor()->GetEventPosition();
+    if (position[0] == this->Internal->LeftButtonPressPosition[0] &&
+        position[1] == this->Internal->LeftButtonPressPosition[1] &&
+        this->GetInteractionNode()->GetCurrentInteractionMode() == vtkMRMLInteractionNode::ViewTransform)
+      {
+      vtkMRMLMarkupsNode* pickedNode = NULL;
+      int markupIndex = this->PickGlyph(position[0], position[1], pickedNode);
+      if (pickedNode && markupIndex >= 0)
+        {
+        pickedNode->InvokeEvent(vtkMRMLMarkupsNode::PointClickedEvent, &markupIndex);
+        }
+      }
+    }
+  else if (eventid == vtkCommand::KeyPressEvent)
     {
     char *keySym = this->GetInteractor()->GetKeySym();
     vtkDebugMacro("OnInteractorStyleEvent 3D: key press event position = "
@@ -901,6 +1230,12 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::UpdatePosition(vtkAbstractWidge
    return;
    }
 
+  if (this->UseGlyphActor(pointsNode))
+    {
+    this->UpdateGlyphActor(vtkMRMLMarkupsFiducialNode::SafeDownCast(pointsNode));
+    return;
+    }
+
   // now get the widget properties (coordinates, measurement etc.) and if the mrml node has changed, propagate the changes
   bool positionChanged = false;
   int numberOfFiducials = pointsNode->GetNumberOfMarkups();
@@ -926,6 +1261,17 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::OnMRMLSceneEndClose()
 {
   // clear out the map of glyph types
   this->Helper->ClearNodeGlyphTypes();
+  while (!this->Internal->GlyphPipelines.empty())
+    {
+    this->RemoveGlyphActor(this->Internal->GlyphPipelines.begin()->first);
+    }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLMarkupsFiducialDisplayableManager3D::OnMRMLSceneNodeRemoved(vtkMRMLNode* node)
+{
+  this->Superclass::OnMRMLSceneNodeRemoved(node);
+  this->RemoveGlyphActor(vtkMRMLMarkupsNode::SafeDownCast(node));
 }
 
 //---------------------------------------------------------------------------
@@ -951,6 +1297,11 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::OnMRMLMarkupsNodeNthMarkupModif
    vtkErrorMacro("OnMRMLMarkupsNodeNthMarkupModifiedEvent: Could not get seed widget!")
    return;
    }
+  if (this->UseGlyphActor(node))
+    {
+    this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(node));
+    return;
+    }
   this->SetNthSeed(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(node), seedWidget);
 }
 
@@ -985,6 +1336,21 @@ void vtkMRMLMarkupsFiducialDisplayableManager3D::OnMRMLMarkupsNodeMarkupAddedEve
    return;
    }
 
+  if (this->UseGlyphActor(markupsNode))
+    {
+    vtkSeedRepresentation* seedRepresentation = vtkSeedRepresentation::SafeDownCast(seedWidget->GetRepresentation());
+    if (seedRepresentation && seedRepresentation->GetNumberOfSeeds() > 0)
+      {
+      // removes the handles if the list just became too large for them
+      this->PropagateMRMLToWidget(markupsNode, seedWidget);
+      }
+    else
+      {
+      this->UpdateNthGlyphPoint(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(markupsNode));
+      }
+    return;
+    }
+
   // this call will create a new handle and set it
   this->SetNthSeed(n, vtkMRMLMarkupsFiducialNode::SafeDownCast(markupsNode), seedWidget);
 
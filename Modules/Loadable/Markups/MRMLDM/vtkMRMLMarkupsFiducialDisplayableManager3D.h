@@ -30,6 +30,15 @@ class vtkMRMLMarkupsDisplayNode;
 class vtkTextWidget;
 
 /// \ingroup Slicer_QtModules_Markups
+/// \brief Displayable manager for fiducial lists in 3D views.
+///
+/// Each fiducial of a list is represented by a handle of a seed widget, that
+/// can be moved in the view. Lists with more fiducials than
+/// MaximumNumberOfHandles are instead rendered by a single glyph actor, which keeps
+/// lists of tens of thousands of fiducials interactive. The fiducials
+/// of these lists are drawn as spheres without labels and can't be dragged,
+/// clicking on one of them invokes vtkMRMLMarkupsNode::PointClickedEvent with
+/// its index, found with a point locator.
 class VTK_SLICER_MARKUPS_MODULE_MRMLDISPLAYABLEMANAGER_EXPORT vtkMRMLMarkupsFiducialDisplayableManager3D :
     public vtkMRMLMarkupsDisplayableManager3D
 {
@@ -39,10 +48,17 @@ public:
   vtkTypeMacro(vtkMRMLMarkupsFiducialDisplayableManager3D, vtkMRMLMarkupsDisplayableManager3D);
   void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
+  /// Maximum number of fiducials of a list that are represented by handles,
+  /// larger lists are rendered by a single glyph actor, without labels nor
+  /// dragging. Default is 5000, above which the handles make the view
+  /// unresponsive. Set it to -1 to represent all the lists by handles.
+  vtkSetMacro(MaximumNumberOfHandles, int);
+  vtkGetMacro(MaximumNumberOfHandles, int);
+
 protected:
 
-  vtkMRMLMarkupsFiducialDisplayableManager3D(){this->Focus="vtkMRMLMarkupsFiducialNode";}
-  virtual ~vtkMRMLMarkupsFiducialDisplayableManager3D(){}
+  vtkMRMLMarkupsFiducialDisplayableManager3D();
+  virtual ~vtkMRMLMarkupsFiducialDisplayableManager3D();
 
   /// Callback for click in RenderWindow
   virtual void OnClickInRenderWindow(double x, double y, const char *associatedNodeID) VTK_OVERRIDE;
@@ -78,6 +94,32 @@ protected:
 
   // Clean up when scene closes
   virtual void OnMRMLSceneEndClose() VTK_OVERRIDE;
+  /// Remove the glyph actor of the removed node
+  virtual void OnMRMLSceneNodeRemoved(vtkMRMLNode* node) VTK_OVERRIDE;
+
+  /// Return true if the fiducials of the node are rendered by a glyph actor
+  /// instead of handles.
+  /// \sa MaximumNumberOfHandles
+  bool UseGlyphActor(vtkMRMLMarkupsNode* node);
+  /// Create or update the glyph actor of a fiducial list
+  void UpdateGlyphActor(vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Update the glyph of the nth fiducial of a list, or append it if it is
+  /// the last fiducial and is not rendered yet. The whole glyph actor is
+  /// updated if the fiducial was inserted or its visibility changed.
+  void UpdateNthGlyphPoint(int n, vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Show the glyph actor if the list and at least one fiducial are visible
+  void UpdateGlyphActorVisibility(vtkMRMLMarkupsFiducialNode* fiducialNode);
+  /// Remove the glyph actor of a fiducial list from the renderer
+  void RemoveGlyphActor(vtkMRMLMarkupsNode* node);
+  /// Find the fiducial rendered by a glyph actor at the display position.
+  /// Returns the index of the fiducial, or -1 if there is none, and sets
+  /// \a pickedNode to its list.
+  int PickGlyph(int x, int y, vtkMRMLMarkupsNode*& pickedNode);
+
+  int MaximumNumberOfHandles;
+
+  class vtkInternal;
+  vtkInternal* Internal;
 
 private:
 
@@ -0,0 +1,162 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRMLDisplayableManager includes
+#include <vtkMRMLDisplayableManagerGroup.h>
+
+// MRMLLogic includes
+#include <vtkMRMLApplicationLogic.h>
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLMarkupsDisplayNode.h"
+#include "vtkMRMLMarkupsFiducialDisplayableManager3D.h"
+#include "vtkMRMLMarkupsFiducialNode.h"
+#include <vtkMRMLScene.h>
+#include <vtkMRMLViewNode.h>
+
+// VTK includes
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkRenderer.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+
+//----------------------------------------------------------------------------
+// Give access to the glyph actor methods of the displayable manager
+class vtkMRMLMarkupsFiducialDisplayableManager3DTester
+  : public vtkMRMLMarkupsFiducialDisplayableManager3D
+{
+public:
+  static vtkMRMLMarkupsFiducialDisplayableManager3DTester *New();
+  vtkTypeMacro(vtkMRMLMarkupsFiducialDisplayableManager3DTester, vtkMRMLMarkupsFiducialDisplayableManager3D);
+
+  using vtkMRMLMarkupsFiducialDisplayableManager3D::UseGlyphActor;
+  using vtkMRMLMarkupsFiducialDisplayableManager3D::UpdateGlyphActor;
+  using vtkMRMLMarkupsFiducialDisplayableManager3D::PickGlyph;
+
+protected:
+  vtkMRMLMarkupsFiducialDisplayableManager3DTester() {}
+  virtual ~vtkMRMLMarkupsFiducialDisplayableManager3DTester() {}
+};
+vtkStandardNewMacro(vtkMRMLMarkupsFiducialDisplayableManager3DTester);
+
+//----------------------------------------------------------------------------
+namespace
+{
+void GetDisplayPosition(vtkRenderer* renderer, vtkMRMLMarkupsFiducialNode* node, int n, int displayPosition[2])
+{
+  double worldPosition[4] = {0., 0., 0., 1.};
+  node->GetMarkupPointWorld(n, 0, worldPosition);
+  renderer->SetWorldPoint(worldPosition);
+  renderer->WorldToDisplay();
+  double* displayPoint = renderer->GetDisplayPoint();
+  displayPosition[0] = static_cast<int>(displayPoint[0] + 0.5);
+  displayPosition[1] = static_cast<int>(displayPoint[1] + 0.5);
+}
+}
+
+//----------------------------------------------------------------------------
+// test the rendering and picking of large fiducial lists by a glyph actor
+int vtkMRMLMarkupsFiducialDisplayableManager3DTest1(int , char * [] )
+{
+  // Renderer, RenderWindow and Interactor
+  vtkNew<vtkRenderer> renderer;
+  vtkNew<vtkRenderWindow> renderWindow;
+  vtkNew<vtkRenderWindowInteractor> renderWindowInteractor;
+  renderWindow->SetSize(300, 300);
+  renderWindow->SetMultiSamples(0);
+  renderWindow->AddRenderer(renderer.GetPointer());
+  renderWindow->SetInteractor(renderWindowInteractor.GetPointer());
+
+  // MRML scene and application logic, that creates the selection and
+  // interaction nodes
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLApplicationLogic> applicationLogic;
+  applicationLogic->SetMRMLScene(scene.GetPointer());
+
+  vtkNew<vtkMRMLViewNode> viewNode;
+  scene->AddNode(viewNode.GetPointer());
+
+  vtkNew<vtkMRMLDisplayableManagerGroup> displayableManagerGroup;
+  displayableManagerGroup->SetRenderer(renderer.GetPointer());
+  displayableManagerGroup->SetMRMLDisplayableNode(viewNode.GetPointer());
+
+  vtkNew<vtkMRMLMarkupsFiducialDisplayableManager3DTester> displayableManager;
+  displayableManager->SetMRMLApplicationLogic(applicationLogic.GetPointer());
+  displayableManagerGroup->AddDisplayableManager(displayableManager.GetPointer());
+  displayableManagerGroup->GetInteractor()->Initialize();
+
+  // Large lists are rendered by glyphs by default
+  CHECK_INT(displayableManager->GetMaximumNumberOfHandles(), 5000);
+
+  vtkNew<vtkMRMLMarkupsFiducialNode> fiducialNode;
+  scene->AddNode(fiducialNode.GetPointer());
+  vtkNew<vtkMRMLMarkupsDisplayNode> displayNode;
+  scene->AddNode(displayNode.GetPointer());
+  fiducialNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+
+  CHECK_BOOL(displayableManager->UseGlyphActor(NULL), false);
+  CHECK_BOOL(displayableManager->UseGlyphActor(fiducialNode.GetPointer()), false);
+
+  const int numberOfFiducials = 10;
+  displayableManager->SetMaximumNumberOfHandles(numberOfFiducials / 2);
+  fiducialNode->StartModify();
+  for (int n = 0; n < numberOfFiducials; ++n)
+    {
+    fiducialNode->AddFiducial(20. * n, 0., 0.);
+    }
+  fiducialNode->EndModify(0);
+  CHECK_BOOL(displayableManager->UseGlyphActor(fiducialNode.GetPointer()), true);
+
+  // -1 represents all the fiducials by handles
+  displayableManager->SetMaximumNumberOfHandles(-1);
+  CHECK_BOOL(displayableManager->UseGlyphActor(fiducialNode.GetPointer()), false);
+  displayableManager->SetMaximumNumberOfHandles(numberOfFiducials / 2);
+
+  displayableManager->UpdateGlyphActor(fiducialNode.GetPointer());
+  renderer->ResetCamera();
+  renderWindow->Render();
+
+  // Pick the fiducials through the glyph actor
+  vtkMRMLMarkupsNode* pickedNode = NULL;
+  int displayPosition[2] = {0, 0};
+  for (int n = 0; n < numberOfFiducials; n += 3)
+    {
+    GetDisplayPosition(renderer.GetPointer(), fiducialNode.GetPointer(), n, displayPosition);
+    CHECK_INT(displayableManager->PickGlyph(displayPosition[0], displayPosition[1], pickedNode), n);
+    CHECK_POINTER(pickedNode, fiducialNode.GetPointer());
+    }
+
+  // Nothing in the corner of the view
+  CHECK_INT(displayableManager->PickGlyph(1, 1, pickedNode), -1);
+  CHECK_NULL(pickedNode);
+
+  // Hidden fiducials are not rendered nor picked
+  const int hiddenFiducial = 4;
+  fiducialNode->SetNthFiducialVisibility(hiddenFiducial, false);
+  displayableManager->UpdateGlyphActor(fiducialNode.GetPointer());
+  renderWindow->Render();
+  GetDisplayPosition(renderer.GetPointer(), fiducialNode.GetPointer(), hiddenFiducial, displayPosition);
+  CHECK_INT(displayableManager->PickGlyph(displayPosition[0], displayPosition[1], pickedNode), -1);
+
+  // and the indices of the following ones are kept
+  GetDisplayPosition(renderer.GetPointer(), fiducialNode.GetPointer(), hiddenFiducial + 1, displayPosition);
+  CHECK_INT(displayableManager->PickGlyph(displayPosition[0], displayPosition[1], pickedNode), hiddenFiducial + 1);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  Portions (c) Copyright Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MRML includes
+#include "vtkMRMLCoreTestingMacros.h"
+#include "vtkMRMLLinearTransformNode.h"
+#include "vtkMRMLMarkupsNode.h"
+#include "vtkMRMLScene.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+// test lookups by ID and bulk access in large lists
+int vtkMRMLMarkupsNodeTest3(int , char * [] )
+{
+  vtkNew<vtkMRMLScene> scene;
+  vtkNew<vtkMRMLMarkupsNode> node;
+  scene->AddNode(node.GetPointer());
+
+  const int numberOfMarkups = 10000;
+  node->StartModify();
+  for (int i = 0; i < numberOfMarkups; ++i)
+    {
+    node->AddPointToNewMarkup(vtkVector3d(i, 2. * i, 0.));
+    }
+  node->EndModify(0);
+  CHECK_INT(node->GetNumberOfMarkups(), numberOfMarkups);
+
+  // Lookups by ID
+  for (int i = 0; i < numberOfMarkups; i += 97)
+    {
+    CHECK_INT(node->GetMarkupIndexByID(node->GetNthMarkupID(i).c_str()), i);
+    }
+  std::string lastID = node->GetNthMarkupID(numberOfMarkups - 1);
+  std::string firstID = node->GetNthMarkupID(0);
+  CHECK_INT(node->GetMarkupIndexByID("Invalid"), -1);
+
+  // Lookups remain valid after structural changes
+  node->RemoveMarkup(0);
+  CHECK_INT(node->GetMarkupIndexByID(firstID.c_str()), -1);
+  CHECK_INT(node->GetMarkupIndexByID(lastID.c_str()), numberOfMarkups - 2);
+
+  Markup markup;
+  node->InitMarkup(&markup);
+  markup.points.push_back(vtkVector3d(-1., -1., -1.));
+  node->InsertMarkup(markup, 0);
+  CHECK_INT(node->GetMarkupIndexByID(markup.ID.c_str()), 0);
+  CHECK_INT(node->GetMarkupIndexByID(lastID.c_str()), numberOfMarkups - 1);
+
+  node->SwapMarkups(0, numberOfMarkups - 1);
+  CHECK_INT(node->GetMarkupIndexByID(markup.ID.c_str()), numberOfMarkups - 1);
+  CHECK_INT(node->GetMarkupIndexByID(lastID.c_str()), 0);
+
+  node->ResetNthMarkupID(0);
+  CHECK_INT(node->GetMarkupIndexByID(lastID.c_str()), -1);
+  CHECK_INT(node->GetMarkupIndexByID(node->GetNthMarkupID(0).c_str()), 0);
+
+  // IDs changed through the returned pointer are detected
+  std::string fifthID = node->GetNthMarkupID(5);
+  node->GetNthMarkup(5)->ID = "ChangedID";
+  CHECK_INT(node->GetMarkupIndexByID(fifthID.c_str()), -1);
+  CHECK_INT(node->GetMarkupIndexByID("ChangedID"), 5);
+
+  // even if the previous ID is not looked up first, as after
+  // vtkSlicerMarkupsLogic::CopyMarkup
+  node->GetNthMarkup(6)->ID = "OtherChangedID";
+  CHECK_INT(node->GetMarkupIndexByID("OtherChangedID"), 6);
+  CHECK_INT(node->GetMarkupIndexByID("Invalid"), -1);
+
+  // or if it is overwritten by CopyMarkup after a lookup
+  Markup* seventhMarkup = node->GetNthMarkup(7);
+  CHECK_INT(node->GetMarkupIndexByID("OtherChangedID"), 6);
+  Markup copiedMarkup;
+  node->CopyMarkup(seventhMarkup, &copiedMarkup);
+  copiedMarkup.ID = "CopiedID";
+  node->CopyMarkup(&copiedMarkup, seventhMarkup);
+  CHECK_INT(node->GetMarkupIndexByID("CopiedID"), 7);
+
+  // Copy
+  vtkNew<vtkMRMLMarkupsNode> copy;
+  copy->Copy(node.GetPointer());
+  CHECK_INT(copy->GetMarkupIndexByID("ChangedID"), 5);
+
+  // Positions of all the markups at once, in world coordinates
+  vtkNew<vtkPoints> points;
+  node->GetMarkupPointsWorld(points.GetPointer());
+  CHECK_INT(points->GetNumberOfPoints(), numberOfMarkups);
+  CHECK_DOUBLE(points->GetPoint(1)[1], 2.);
+
+  vtkNew<vtkMRMLLinearTransformNode> transformNode;
+  scene->AddNode(transformNode.GetPointer());
+  vtkNew<vtkMatrix4x4> matrix;
+  matrix->SetElement(0, 3, 100.);
+  transformNode->SetMatrixTransformToParent(matrix.GetPointer());
+  node->SetAndObserveTransformNodeID(transformNode->GetID());
+  node->GetMarkupPointsWorld(points.GetPointer());
+  CHECK_INT(points->GetNumberOfPoints(), numberOfMarkups);
+  CHECK_DOUBLE(points->GetPoint(1)[0], 101.);
+  double worldPoint[4] = {0., 0., 0., 0.};
+  node->GetMarkupPointWorld(1, 0, worldPoint);
+  CHECK_DOUBLE(worldPoint[0], 101.);
+
+  // Remove all the markups at once
+  node->RemoveAllMarkups();
+  CHECK_INT(node->GetNumberOfMarkups(), 0);
+  CHECK_INT(node->GetMarkupIndexByID("ChangedID"), -1);
+  node->AddPointToNewMarkup(vtkVector3d(0., 0., 0.));
+  CHECK_INT(node->GetMarkupIndexByID(node->GetNthMarkupID(0).c_str()), 0);
+
+  return EXIT_SUCCESS;
+}
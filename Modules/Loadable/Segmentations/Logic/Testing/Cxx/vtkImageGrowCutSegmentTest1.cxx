@@ -0,0 +1,202 @@
+/*==============================================================================
+
+  Program: 3D Slicer
+
+  See COPYRIGHT.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Segmentations includes
+#include "vtkImageGrowCutSegment.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkNew.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+namespace
+{
+
+// Intensity image made of three slabs along the X axis:
+// 0 for x < 10, 30 for 10 <= x < 20, 100 for x >= 20.
+const int Dimensions[3] = { 30, 12, 5 };
+
+//----------------------------------------------------------------------------
+void CreateIntensityImage(vtkImageData* image)
+{
+  image->SetDimensions(const_cast<int*>(Dimensions));
+  image->AllocateScalars(VTK_SHORT, 1);
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < Dimensions[1]; ++j)
+      {
+      for (int i = 0; i < Dimensions[0]; ++i)
+        {
+        double value = (i < 10 ? 0. : (i < 20 ? 30. : 100.));
+        image->SetScalarComponentFromDouble(i, j, k, 0, value);
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void CreateSeedImage(vtkImageData* image)
+{
+  image->SetDimensions(const_cast<int*>(Dimensions));
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  memset(image->GetScalarPointer(), 0, Dimensions[0] * Dimensions[1] * Dimensions[2]);
+}
+
+//----------------------------------------------------------------------------
+void SetSeed(vtkImageData* image, int i, int label)
+{
+  image->SetScalarComponentFromDouble(i, Dimensions[1] / 2, Dimensions[2] / 2, 0, label);
+  image->Modified();
+}
+
+//----------------------------------------------------------------------------
+int ExpectedLabel(int i, bool middleSeeded)
+{
+  if (i < 10)
+    {
+    return 1;
+    }
+  if (i < 20)
+    {
+    // The middle slab is closer to the left slab than to the right one
+    return middleSeeded ? 3 : 1;
+    }
+  return 2;
+}
+
+//----------------------------------------------------------------------------
+bool CheckLabels(vtkImageData* result, bool middleSeeded, int line)
+{
+  int* dimensions = result->GetDimensions();
+  if (dimensions[0] != Dimensions[0] || dimensions[1] != Dimensions[1] || dimensions[2] != Dimensions[2])
+    {
+    std::cerr << line << ": unexpected result dimensions " << dimensions[0] << "x"
+      << dimensions[1] << "x" << dimensions[2] << std::endl;
+    return false;
+    }
+  for (int k = 0; k < Dimensions[2]; ++k)
+    {
+    for (int j = 0; j < Dimensions[1]; ++j)
+      {
+      for (int i = 0; i < Dimensions[0]; ++i)
+        {
+        int label = static_cast<int>(result->GetScalarComponentAsDouble(i, j, k, 0));
+        if (label != ExpectedLabel(i, middleSeeded))
+          {
+          std::cerr << line << ": unexpected label " << label << " at (" << i << ", " << j << ", " << k
+            << "), expected " << ExpectedLabel(i, middleSeeded) << std::endl;
+          return false;
+          }
+        }
+      }
+    }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool CompareImages(vtkImageData* result, vtkImageData* expected, int line)
+{
+  vtkIdType numberOfVoxels = expected->GetNumberOfPoints();
+  if (result->GetNumberOfPoints() != numberOfVoxels || result->GetScalarType() != expected->GetScalarType())
+    {
+    std::cerr << line << ": result geometry differs from the full computation" << std::endl;
+    return false;
+    }
+  unsigned char* resultPtr = static_cast<unsigned char*>(result->GetScalarPointer());
+  unsigned char* expectedPtr = static_cast<unsigned char*>(expected->GetScalarPointer());
+  for (vtkIdType index = 0; index < numberOfVoxels; ++index)
+    {
+    if (resultPtr[index] != expectedPtr[index])
+      {
+      std::cerr << line << ": label " << int(resultPtr[index]) << " at voxel " << index
+        << " differs from the full computation label " << int(expectedPtr[index]) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+} // end of anonymous namespace
+
+//----------------------------------------------------------------------------
+int vtkImageGrowCutSegmentTest1(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  vtkNew<vtkImageData> intensityImage;
+  CreateIntensityImage(intensityImage.GetPointer());
+  vtkNew<vtkImageData> seedImage;
+  CreateSeedImage(seedImage.GetPointer());
+  SetSeed(seedImage.GetPointer(), 4, 1);
+  SetSeed(seedImage.GetPointer(), 25, 2);
+
+  // Full computation from two seeds
+  vtkNew<vtkImageGrowCutSegment> growCut;
+  growCut->SetIntensityVolume(intensityImage.GetPointer());
+  growCut->SetSeedLabelVolume(seedImage.GetPointer());
+  growCut->SetNumberOfThreads(2);
+  growCut->Update();
+  if (!CheckLabels(growCut->GetOutput(), false, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Incremental update after adding a seed in the middle slab
+  SetSeed(seedImage.GetPointer(), 15, 3);
+  growCut->Update();
+  vtkNew<vtkImageData> incrementalResult;
+  incrementalResult->DeepCopy(growCut->GetOutput());
+  if (!CheckLabels(incrementalResult.GetPointer(), true, __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The incremental update gives the same result as a full recomputation
+  // with a single piece, with many pieces, and with many pieces when the
+  // multithreader runs fewer threads than pieces.
+  const int numberOfThreads[3] = { 1, 64, 8 };
+  const int globalMaximumNumberOfThreads = vtkMultiThreader::GetGlobalMaximumNumberOfThreads();
+  for (int i = 0; i < 3; ++i)
+    {
+    vtkNew<vtkImageGrowCutSegment> fullGrowCut;
+    fullGrowCut->SetIntensityVolume(intensityImage.GetPointer());
+    fullGrowCut->SetSeedLabelVolume(seedImage.GetPointer());
+    fullGrowCut->SetNumberOfThreads(numberOfThreads[i]);
+    if (i == 2)
+      {
+      vtkMultiThreader::SetGlobalMaximumNumberOfThreads(2);
+      }
+    fullGrowCut->Update();
+    vtkMultiThreader::SetGlobalMaximumNumberOfThreads(globalMaximumNumberOfThreads);
+    if (!CompareImages(incrementalResult.GetPointer(), fullGrowCut->GetOutput(), __LINE__))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Reset forces a full recomputation with the same result
+  growCut->Reset();
+  growCut->Modified();
+  growCut->Update();
+  if (!CompareImages(growCut->GetOutput(), incrementalResult.GetPointer(), __LINE__))
+    {
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Test passed." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -1,80 +1,256 @@
 #include "vtkImageGrowCutSegment.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkLoggingMacros.h>
+#include <vtkMultiThreader.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTimerLog.h>
 
-#include "FibHeap.h"
-
 vtkStandardNewMacro(vtkImageGrowCutSegment);
 
 //----------------------------------------------------------------------------
 typedef float DistancePixelType;  // type for cost function
-const int DistancePixelTypeID = VTK_FLOAT;
 const DistancePixelType DIST_INF = std::numeric_limits<DistancePixelType>::max();
 const DistancePixelType DIST_EPSILON = 1e-3;
 
+namespace
+{
+
 //----------------------------------------------------------------------------
-class HeapNode : public FibHeapNode
+// Monotone priority queue (radix heap) of voxel indices sorted by distance.
+//
+// Distances are non-negative floats: their bit patterns compare like the
+// distances when interpreted as unsigned integers. Elements are stored in
+// buckets depending on the highest bit that differs from the last extracted
+// key, each element is moved at most 32 times. Pushed distances must not be
+// smaller than the last extracted one, which holds for Dijkstra's algorithm.
+// Decreasing the distance of a voxel is done by pushing it again, outdated
+// elements must be skipped by the caller.
+class DistanceQueue
 {
 public:
-  HeapNode()
-  : FibHeapNode()
-  , m_Key(0)
-  , m_Index(-1)
-  {
-  }
-
-  virtual void operator =(FibHeapNode& RHS)
-  {
-    FHN_Assign(RHS);
-    m_Key = ((HeapNode&)RHS).m_Key;
-  }
+  DistanceQueue()
+    {
+    this->Clear();
+    }
 
-  virtual int operator ==(FibHeapNode& RHS)
-  {
-    if (FHN_Cmp(RHS))
+  void Clear()
+    {
+    for (int i = 0; i < NumberOfBuckets; ++i)
       {
-      return 0;
+      std::vector<Element>().swap(this->Buckets[i]);
       }
-    return m_Key == ((HeapNode&)RHS).m_Key ? 1 : 0;
-  }
+    this->LastKey = 0;
+    this->Size = 0;
+    }
 
-  virtual int operator <(FibHeapNode& RHS)
-  {
-    int x = FHN_Cmp(RHS);
-    if (x != 0)
+  bool IsEmpty() const
+    {
+    return this->Size == 0;
+    }
+
+  void Push(DistancePixelType distance, unsigned int index)
+    {
+    Element element;
+    element.Key = ToKey(distance);
+    element.Index = index;
+    this->Buckets[this->BucketIndex(element.Key)].push_back(element);
+    ++this->Size;
+    }
+
+  void Pop(DistancePixelType& distance, unsigned int& index)
+    {
+    if (this->Buckets[0].empty())
       {
-      return x < 0 ? 1 : 0;
+      int bucket = 1;
+      while (this->Buckets[bucket].empty())
+        {
+        ++bucket;
+        }
+      // Move the elements of the first non-empty bucket to the lower buckets
+      std::vector<Element>& elements = this->Buckets[bucket];
+      unsigned int minimumKey = elements[0].Key;
+      for (size_t i = 1; i < elements.size(); ++i)
+        {
+        minimumKey = std::min(minimumKey, elements[i].Key);
+        }
+      this->LastKey = minimumKey;
+      for (size_t i = 0; i < elements.size(); ++i)
+        {
+        this->Buckets[this->BucketIndex(elements[i].Key)].push_back(elements[i]);
+        }
+      elements.clear();
       }
-    return m_Key < ((HeapNode&)RHS).m_Key ? 1 : 0;
-  }
+    Element element = this->Buckets[0].back();
+    this->Buckets[0].pop_back();
+    --this->Size;
+    distance = FromKey(element.Key);
+    index = element.Index;
+    }
 
-  virtual void operator =(DistancePixelType newKeyVal)
+private:
+  struct Element
   {
-    HeapNode tmp;
-    tmp.m_Key = m_Key = newKeyVal;
-    FHN_Assign(tmp);
-  }
+    unsigned int Key;
+    unsigned int Index;
+  };
+  static const int NumberOfBuckets = 33;
 
-  inline DistancePixelType GetKeyValue() { return m_Key; }
-  inline void SetKeyValue(DistancePixelType keyValue) { m_Key = keyValue; }
-  inline long int GetIndexValue() { return m_Index; }
-  inline void SetIndexValue(long int indexValue) { m_Index = indexValue; }
+  static unsigned int ToKey(DistancePixelType distance)
+    {
+    unsigned int key;
+    memcpy(&key, &distance, sizeof(key));
+    return key;
+    }
+
+  static DistancePixelType FromKey(unsigned int key)
+    {
+    DistancePixelType distance;
+    memcpy(&distance, &key, sizeof(distance));
+    return distance;
+    }
+
+  // 0 if key is the last extracted key, position of the highest bit that
+  // differs from the last extracted key (1-32) otherwise.
+  int BucketIndex(unsigned int key) const
+    {
+    unsigned int differentBits = key ^ this->LastKey;
+    int bucket = 0;
+    if (differentBits >= (1u << 16)) { differentBits >>= 16; bucket += 16; }
+    if (differentBits >= (1u << 8)) { differentBits >>= 8; bucket += 8; }
+    if (differentBits >= (1u << 4)) { differentBits >>= 4; bucket += 4; }
+    if (differentBits >= (1u << 2)) { differentBits >>= 2; bucket += 2; }
+    if (differentBits >= (1u << 1)) { differentBits >>= 1; bucket += 1; }
+    return bucket + static_cast<int>(differentBits);
+    }
+
+  std::vector<Element> Buckets[NumberOfBuckets];
+  unsigned int LastKey;
+  size_t Size;
+};
 
-protected:
-  DistancePixelType m_Key;
-  long m_Index;
+//----------------------------------------------------------------------------
+// State shared by the threads processing the voxels in parallel.
+// Piece i processes the voxels [dimXYZ * i / NumberOfPieces,
+// dimXYZ * (i + 1) / NumberOfPieces).
+struct GrowCutJob
+{
+  enum PassType
+    {
+    /// Set the result labels and distances from the seeds
+    InitializePass,
+    /// Reuse the previous results, only grow from the new/changed seeds
+    UpdatePass,
+    /// Restore the previous result of the voxels that have not been reached
+    RestorePass
+    };
+  PassType Pass;
+  int NumberOfPieces;
+  vtkIdType NumberOfVoxels;
+  int LabelScalarType;
+  void* SeedLabels;
+  void* ResultLabels;
+  void* ResultLabelsPre;
+  DistancePixelType* Distances;
+  DistancePixelType* DistancesPre;
+  /// Seeds to grow from, one list per piece
+  std::vector< std::vector<unsigned int> > Seeds;
 };
 
+//----------------------------------------------------------------------------
+template <class LabelPixelType>
+void ExecutePiece(GrowCutJob* job, int piece, LabelPixelType*)
+{
+  LabelPixelType* seedLabels = static_cast<LabelPixelType*>(job->SeedLabels);
+  LabelPixelType* resultLabels = static_cast<LabelPixelType*>(job->ResultLabels);
+  LabelPixelType* resultLabelsPre = static_cast<LabelPixelType*>(job->ResultLabelsPre);
+  DistancePixelType* distances = job->Distances;
+  std::vector<unsigned int>& seeds = job->Seeds[piece];
+  vtkIdType firstIndex = job->NumberOfVoxels * piece / job->NumberOfPieces;
+  vtkIdType lastIndex = job->NumberOfVoxels * (piece + 1) / job->NumberOfPieces;
+  switch (job->Pass)
+    {
+    case GrowCutJob::InitializePass:
+      for (vtkIdType index = firstIndex; index < lastIndex; ++index)
+        {
+        LabelPixelType seedValue = seedLabels[index];
+        resultLabels[index] = seedValue;
+        if (seedValue == 0)
+          {
+          distances[index] = DIST_INF;
+          }
+        else
+          {
+          distances[index] = DIST_EPSILON;
+          seeds.push_back(static_cast<unsigned int>(index));
+          }
+        }
+      break;
+    case GrowCutJob::UpdatePass:
+      for (vtkIdType index = firstIndex; index < lastIndex; ++index)
+        {
+        LabelPixelType seedValue = seedLabels[index];
+        if (seedValue != 0)
+          {
+          // Only grow from new/changed seeds
+          if (resultLabels[index] != seedValue)
+            {
+            distances[index] = DIST_EPSILON;
+            resultLabels[index] = seedValue;
+            seeds.push_back(static_cast<unsigned int>(index));
+            }
+          }
+        else
+          {
+          distances[index] = DIST_INF;
+          resultLabels[index] = 0;
+          }
+        }
+      break;
+    case GrowCutJob::RestorePass:
+      for (vtkIdType index = firstIndex; index < lastIndex; ++index)
+        {
+        if (resultLabels[index] == 0)
+          {
+          resultLabels[index] = resultLabelsPre[index];
+          distances[index] = job->DistancesPre[index];
+          }
+        }
+      break;
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE ExecuteThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  GrowCutJob* job = static_cast<GrowCutJob*>(info->UserData);
+  // The multithreader may run fewer threads than requested
+  // (see vtkMultiThreader::SetGlobalMaximumNumberOfThreads()),
+  // each thread processes every NumberOfThreads-th piece.
+  for (int piece = info->ThreadID; piece < job->NumberOfPieces; piece += info->NumberOfThreads)
+    {
+    switch (job->LabelScalarType)
+      {
+      vtkTemplateMacro(ExecutePiece(job, piece, static_cast<VTK_TT*>(NULL)));
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+} // end of anonymous namespace
+
 //----------------------------------------------------------------------------
 class vtkImageGrowCutSegment::vtkInternal
 {
@@ -84,6 +260,9 @@ public:
 
   void Reset();
 
+  /// Run a pass over all the voxels with multiple threads
+  void ExecutePass(GrowCutJob::PassType pass, vtkImageData *seedLabelVolume);
+
   template<typename IntensityPixelType, typename LabelPixelType>
   bool InitializationAHP(vtkImageData *intensityVolume, vtkImageData *seedLabelVolume);
 
@@ -96,8 +275,10 @@ public:
   template< class SourceVolType, class SeedVolType>
   bool ExecuteGrowCut2(vtkImageData *intensityVolume, vtkImageData *seedLabelVolume);
 
-  vtkSmartPointer<vtkImageData> m_DistanceVolume;
-  vtkSmartPointer<vtkImageData> m_DistanceVolumePre;
+  /// Distances are only needed for computation and are not part of the
+  /// output, they are kept in plain arrays.
+  std::vector<DistancePixelType> m_Distances;
+  std::vector<DistancePixelType> m_DistancesPre;
   vtkSmartPointer<vtkImageData> m_ResultLabelVolume;
   vtkSmartPointer<vtkImageData> m_ResultLabelVolumePre;
 
@@ -105,21 +286,17 @@ public:
   long m_DimY;
   long m_DimZ;
   std::vector<long> m_NeighborIndexOffsets;
-  std::vector<unsigned char> m_NumberOfNeighbors;
 
-  FibHeap *m_Heap;
-  HeapNode *m_HeapNodes;
+  DistanceQueue m_Queue;
+  int m_NumberOfThreads;
   bool m_bSegInitialized;
 };
 
 //-----------------------------------------------------------------------------
 vtkImageGrowCutSegment::vtkInternal::vtkInternal()
 {
-  m_Heap = NULL;
-  m_HeapNodes = NULL;
+  m_NumberOfThreads = 0;
   m_bSegInitialized = false;
-  m_DistanceVolume = vtkSmartPointer<vtkImageData>::New();
-  m_DistanceVolumePre = vtkSmartPointer<vtkImageData>::New();
   m_ResultLabelVolume = vtkSmartPointer<vtkImageData>::New();
   m_ResultLabelVolumePre = vtkSmartPointer<vtkImageData>::New();
 };
@@ -133,37 +310,62 @@ vtkImageGrowCutSegment::vtkInternal::~vtkInternal()
 //-----------------------------------------------------------------------------
 void vtkImageGrowCutSegment::vtkInternal::Reset()
 {
-  if (m_Heap != NULL)
-    {
-    delete m_Heap;
-    m_Heap = NULL;
-    }
-  if (m_HeapNodes != NULL)
-    {
-    delete[]m_HeapNodes;
-    m_HeapNodes = NULL;
-    }
+  m_Queue.Clear();
   m_bSegInitialized = false;
-  m_DistanceVolume->Initialize();
-  m_DistanceVolumePre->Initialize();
+  std::vector<DistancePixelType>().swap(m_Distances);
+  std::vector<DistancePixelType>().swap(m_DistancesPre);
   m_ResultLabelVolume->Initialize();
   m_ResultLabelVolumePre->Initialize();
 }
 
+//-----------------------------------------------------------------------------
+void vtkImageGrowCutSegment::vtkInternal::ExecutePass(
+  GrowCutJob::PassType pass, vtkImageData *seedLabelVolume)
+{
+  GrowCutJob job;
+  job.Pass = pass;
+  job.NumberOfVoxels = m_DimX * m_DimY * m_DimZ;
+  job.LabelScalarType = m_ResultLabelVolume->GetScalarType();
+  job.SeedLabels = seedLabelVolume->GetScalarPointer();
+  job.ResultLabels = m_ResultLabelVolume->GetScalarPointer();
+  job.ResultLabelsPre = m_ResultLabelVolumePre->GetScalarPointer();
+  job.Distances = &(m_Distances[0]);
+  job.DistancesPre = m_DistancesPre.empty() ? NULL : &(m_DistancesPre[0]);
+
+  int numberOfThreads = m_NumberOfThreads > 0 ?
+    m_NumberOfThreads : vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  job.NumberOfPieces = std::max(1, std::min(numberOfThreads, VTK_MAX_THREADS));
+  job.Seeds.resize(job.NumberOfPieces);
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(job.NumberOfPieces);
+  threader->SetSingleMethod(ExecuteThread, &job);
+  threader->SingleMethodExecute();
+
+  for (int piece = 0; piece < job.NumberOfPieces; ++piece)
+    {
+    const std::vector<unsigned int>& seeds = job.Seeds[piece];
+    for (size_t i = 0; i < seeds.size(); ++i)
+      {
+      m_Queue.Push(DIST_EPSILON, seeds[i]);
+      }
+    }
+}
+
 //-----------------------------------------------------------------------------
 template<typename IntensityPixelType, typename LabelPixelType>
 bool vtkImageGrowCutSegment::vtkInternal::InitializationAHP(
     vtkImageData *vtkNotUsed(intensityVolume),
     vtkImageData *seedLabelVolume)
 {
-  m_Heap = new FibHeap;
   long dimXYZ = m_DimX * m_DimY * m_DimZ;
-  if ((m_HeapNodes = new HeapNode[dimXYZ + 1]) == NULL)
+  // Voxel indices are stored as unsigned int in the queue
+  if (static_cast<vtkTypeUInt64>(dimXYZ) > std::numeric_limits<unsigned int>::max())
     {
-    vtkGenericWarningMacro("Memory allocation failed. Dimensions: " << m_DimX << "x" << m_DimY << "x" << m_DimZ);
+    vtkGenericWarningMacro("vtkImageGrowCutSegment: image is too large. Dimensions: " << m_DimX << "x" << m_DimY << "x" << m_DimZ);
     return false;
     }
-  LabelPixelType* seedLabelVolumePtr = static_cast<LabelPixelType*>(seedLabelVolume->GetScalarPointer());
+  m_Queue.Clear();
 
   if (!m_bSegInitialized)
     {
@@ -171,16 +373,9 @@ bool vtkImageGrowCutSegment::vtkInternal::InitializationAHP(
     m_ResultLabelVolume->SetSpacing(seedLabelVolume->GetSpacing());
     m_ResultLabelVolume->SetExtent(seedLabelVolume->GetExtent());
     m_ResultLabelVolume->AllocateScalars(seedLabelVolume->GetScalarType(), 1);
-    m_DistanceVolume->SetOrigin(seedLabelVolume->GetOrigin());
-    m_DistanceVolume->SetSpacing(seedLabelVolume->GetSpacing());
-    m_DistanceVolume->SetExtent(seedLabelVolume->GetExtent());
-    m_DistanceVolume->AllocateScalars(DistancePixelTypeID, 1);
-    m_ResultLabelVolumePre->SetExtent(0, -1, 0, -1, 0, -1);
-    m_ResultLabelVolumePre->AllocateScalars(seedLabelVolume->GetScalarType(), 1);
-    m_DistanceVolumePre->SetExtent(0, -1, 0, -1, 0, -1);
-    m_DistanceVolumePre->AllocateScalars(DistancePixelTypeID, 1);
-    LabelPixelType* resultLabelVolumePtr = static_cast<LabelPixelType*>(m_ResultLabelVolume->GetScalarPointer());
-    DistancePixelType* distanceVolumePtr = static_cast<DistancePixelType*>(m_DistanceVolume->GetScalarPointer());
+    m_ResultLabelVolumePre->Initialize();
+    m_Distances.resize(dimXYZ);
+    std::vector<DistancePixelType>().swap(m_DistancesPre);
 
     // Compute index offset
     m_NeighborIndexOffsets.clear();
@@ -205,75 +400,12 @@ bool vtkImageGrowCutSegment::vtkInternal::InitializationAHP(
         }
       }
 
-    // Determine neighborhood size for computation at each voxel.
-    // The neighborhood size is everwhere the same (size of m_NeighborIndexOffsets)
-    // except at the edges of the volume, where the neighborhood size is 0.
-    m_NumberOfNeighbors.resize(dimXYZ);
-    const unsigned char numberOfNeighbors = m_NeighborIndexOffsets.size();
-    unsigned char* nbSizePtr = &(m_NumberOfNeighbors[0]);
-    for (int z = 0; z < m_DimZ; z++)
-      {
-      bool zEdge = (z == 0 || z == m_DimZ - 1);
-      for (int y = 0; y < m_DimY; y++)
-        {
-        bool yEdge = (y == 0 || y == m_DimY - 1);
-        *(nbSizePtr++) = 0; // x == 0 (there is always padding, so we don'neighborNewDistance need to check if m_DimX>0)
-        unsigned char nbSize = (zEdge || yEdge) ? 0 : numberOfNeighbors;
-        for (int x = m_DimX-2; x > 0; x--)
-          {
-          *(nbSizePtr++) = nbSize;
-          }
-        *(nbSizePtr++) = 0; // x == m_DimX-1 (there is always padding, so we don'neighborNewDistance need to check if m_DimX>1)
-        }
-      }
-
-    for (long index = 0; index < dimXYZ; index++)
-      {
-      LabelPixelType seedValue = seedLabelVolumePtr[index];
-      resultLabelVolumePtr[index] = seedValue;
-      if (seedValue == 0)
-        {
-        m_HeapNodes[index] = DIST_INF;
-        distanceVolumePtr[index] = DIST_INF;
-        }
-      else
-        {
-        m_HeapNodes[index] = DIST_EPSILON;
-        distanceVolumePtr[index] = DIST_EPSILON;
-        }
-      m_Heap->Insert(&m_HeapNodes[index]);
-      m_HeapNodes[index].SetIndexValue(index);
-      }
+    this->ExecutePass(GrowCutJob::InitializePass, seedLabelVolume);
     }
   else
     {
     // Already initialized
-    LabelPixelType* resultLabelVolumePtr = static_cast<LabelPixelType*>(m_ResultLabelVolume->GetScalarPointer());
-    DistancePixelType* distanceVolumePtr = static_cast<DistancePixelType*>(m_DistanceVolume->GetScalarPointer());
-
-    for (long index = 0; index < dimXYZ; index++)
-      {
-      if (seedLabelVolumePtr[index] != 0)
-        {
-        // Only grow from new/changed seeds
-        if (resultLabelVolumePtr[index] != seedLabelVolumePtr[index])
-          {
-          m_HeapNodes[index] = DIST_EPSILON;
-          distanceVolumePtr[index] = DIST_EPSILON;
-          resultLabelVolumePtr[index] = seedLabelVolumePtr[index];
-          m_Heap->Insert(&m_HeapNodes[index]);
-          m_HeapNodes[index].SetIndexValue(index);
-          }
-        }
-      else
-        {
-        m_HeapNodes[index] = DIST_INF;
-        distanceVolumePtr[index] = DIST_INF;
-        resultLabelVolumePtr[index] = 0;
-        m_Heap->Insert(&m_HeapNodes[index]);
-        m_HeapNodes[index].SetIndexValue(index);
-        }
-      }
+    this->ExecutePass(GrowCutJob::UpdatePass, seedLabelVolume);
     }
   return true;
 }
@@ -282,133 +414,79 @@ bool vtkImageGrowCutSegment::vtkInternal::InitializationAHP(
 template<typename IntensityPixelType, typename LabelPixelType>
 void vtkImageGrowCutSegment::vtkInternal::DijkstraBasedClassificationAHP(
     vtkImageData *intensityVolume,
-    vtkImageData *vtkNotUsed(seedLabelVolume))
+    vtkImageData *seedLabelVolume)
 {
   LabelPixelType* resultLabelVolumePtr = static_cast<LabelPixelType*>(m_ResultLabelVolume->GetScalarPointer());
   IntensityPixelType* imSrc = static_cast<IntensityPixelType*>(intensityVolume->GetScalarPointer());
-
-  // Insert 0 then extract it, which will balance heap
-  HeapNode hnZero;
-  m_Heap->Insert(&hnZero);
-  m_Heap->ExtractMin();
-
-  if (!m_bSegInitialized)
+  DistancePixelType* distanceVolumePtr = &(m_Distances[0]);
+  const long* neighborIndexOffsets = &(m_NeighborIndexOffsets[0]);
+  const int numberOfNeighbors = static_cast<int>(m_NeighborIndexOffsets.size());
+  const long dimXY = m_DimX * m_DimY;
+
+  // Only the voxels that have a full neighborhood are propagated from,
+  // voxels at the edges of the volume can only be reached.
+  const LabelPixelType* resultLabelVolumePrePtr = NULL;
+  const DistancePixelType* distanceVolumePrePtr = NULL;
+  if (m_bSegInitialized)
     {
-    // Full computation
-    DistancePixelType* distanceVolumePtr = static_cast<DistancePixelType*>(m_DistanceVolume->GetScalarPointer());
-    LabelPixelType* resultLabelVolumePtr = static_cast<LabelPixelType*>(m_ResultLabelVolume->GetScalarPointer());
+    // Quick update: adaptive Dijkstra, stop propagation when the new
+    // distance is larger than the previous one
+    resultLabelVolumePrePtr = static_cast<LabelPixelType*>(m_ResultLabelVolumePre->GetScalarPointer());
+    distanceVolumePrePtr = &(m_DistancesPre[0]);
+    }
 
-    // Normal Dijkstra (to be used in initializing the segmenter for the current image)
-    HeapNode hnTmp;
-    while (!m_Heap->IsEmpty())
+  DistancePixelType currentDistance = 0;
+  unsigned int index = 0;
+  while (!m_Queue.IsEmpty())
+    {
+    m_Queue.Pop(currentDistance, index);
+    if (currentDistance > distanceVolumePtr[index])
       {
-      HeapNode* hnMin = (HeapNode *)m_Heap->ExtractMin();
-      long index = hnMin->GetIndexValue();
-      DistancePixelType currentDistance = hnMin->GetKeyValue();
-      LabelPixelType currentLabel = resultLabelVolumePtr[index];
-      distanceVolumePtr[index] = currentDistance;
-
-      // Update neighbors
-      DistancePixelType pixCenter = imSrc[index];
-      unsigned char nbSize = m_NumberOfNeighbors[index];
-      for (unsigned char i = 0; i < nbSize; i++)
-        {
-        long indexNgbh = index + m_NeighborIndexOffsets[i];
-        DistancePixelType neighborCurrentDistance = distanceVolumePtr[indexNgbh];
-        DistancePixelType neighborNewDistance = fabs(pixCenter - imSrc[indexNgbh]) + currentDistance;
-        if (neighborCurrentDistance > neighborNewDistance)
-          {
-          distanceVolumePtr[indexNgbh] = neighborNewDistance;
-          resultLabelVolumePtr[indexNgbh] = currentLabel;
-
-          hnTmp = m_HeapNodes[indexNgbh];
-          hnTmp.SetKeyValue(neighborNewDistance);
-          m_Heap->DecreaseKey(&m_HeapNodes[indexNgbh], hnTmp);
-          }
-        }
+      // The voxel has been reached with a shorter distance since it was queued
+      continue;
       }
-    }
-  else
-    {
-    // Quick update
-
-    LabelPixelType* resultLabelVolumePrePtr = static_cast<LabelPixelType*>(m_ResultLabelVolumePre->GetScalarPointer());
-
-    // Adaptive Dijkstra
-    HeapNode hnTmp;
-    long dimXYZ = m_DimX * m_DimY * m_DimZ;
-    while (!m_Heap->IsEmpty())
+    if (distanceVolumePrePtr && currentDistance > distanceVolumePrePtr[index])
       {
-      DistancePixelType* distanceVolumePrePtr = static_cast<DistancePixelType*>(m_DistanceVolumePre->GetScalarPointer());
-      DistancePixelType* distanceVolumePtr = static_cast<DistancePixelType*>(m_DistanceVolume->GetScalarPointer());
-
-      HeapNode* hnMin = (HeapNode *)m_Heap->ExtractMin();
-      DistancePixelType currentDistance = hnMin->GetKeyValue();
+      distanceVolumePtr[index] = distanceVolumePrePtr[index];
+      resultLabelVolumePtr[index] = resultLabelVolumePrePtr[index];
+      continue;
+      }
 
-      // Stop of minimum value is infinite
-      if (currentDistance == DIST_INF)
-        {
-        for (long index = 0; index < dimXYZ; index++)
-          {
-          if (resultLabelVolumePtr[index] == 0)
-            {
-            resultLabelVolumePtr[index] = resultLabelVolumePrePtr[index];
-            distanceVolumePtr[index] = distanceVolumePrePtr[index];
-            }
-          }
-        break;
-        }
+    long x = index % m_DimX;
+    long y = (index / m_DimX) % m_DimY;
+    long z = index / dimXY;
+    if (x == 0 || x == m_DimX - 1 || y == 0 || y == m_DimY - 1 || z == 0 || z == m_DimZ - 1)
+      {
+      continue;
+      }
 
-      // Stop propagation when the new distance is larger than the previous one
-      long index = hnMin->GetIndexValue();
-      if (currentDistance > distanceVolumePrePtr[index])
+    // Update neighbors
+    LabelPixelType currentLabel = resultLabelVolumePtr[index];
+    DistancePixelType pixCenter = imSrc[index];
+    for (int i = 0; i < numberOfNeighbors; i++)
+      {
+      long indexNgbh = index + neighborIndexOffsets[i];
+      DistancePixelType neighborNewDistance = fabs(pixCenter - imSrc[indexNgbh]) + currentDistance;
+      if (distanceVolumePtr[indexNgbh] > neighborNewDistance)
         {
-        distanceVolumePtr[index] = distanceVolumePrePtr[index];
-        resultLabelVolumePtr[index] = resultLabelVolumePrePtr[index];
-        continue;
-        }
-
-      LabelPixelType currentLabel = resultLabelVolumePtr[index];
-      distanceVolumePtr[index] = currentDistance;
-
-      // Update neighbors
-      DistancePixelType pixCenter = imSrc[index];
-      unsigned char nbSize = m_NumberOfNeighbors[index];
-      for (unsigned char i = 0; i < nbSize; i++)
-        {
-        long indexNgbh = index + m_NeighborIndexOffsets[i];
-        DistancePixelType neighborCurrentDistance = distanceVolumePtr[indexNgbh];
-        DistancePixelType neighborNewDistance = fabs(pixCenter - imSrc[indexNgbh]) + currentDistance;
-        if (neighborCurrentDistance > neighborNewDistance)
-          {
-          distanceVolumePtr[indexNgbh] = neighborNewDistance;
-          resultLabelVolumePtr[indexNgbh] = currentLabel;
-
-          hnTmp = m_HeapNodes[indexNgbh];
-          hnTmp.SetKeyValue(neighborNewDistance);
-          m_Heap->DecreaseKey(&m_HeapNodes[indexNgbh], hnTmp);
-          }
+        distanceVolumePtr[indexNgbh] = neighborNewDistance;
+        resultLabelVolumePtr[indexNgbh] = currentLabel;
+        m_Queue.Push(neighborNewDistance, static_cast<unsigned int>(indexNgbh));
         }
       }
     }
+  m_Queue.Clear();
+
+  if (m_bSegInitialized)
+    {
+    // Voxels that have not been reached keep their previous result
+    this->ExecutePass(GrowCutJob::RestorePass, seedLabelVolume);
+    }
 
   // Update previous labels and distance information
   m_ResultLabelVolumePre->DeepCopy(m_ResultLabelVolume);
-  m_DistanceVolumePre->DeepCopy(m_DistanceVolume);
+  m_DistancesPre = m_Distances;
   m_bSegInitialized = true;
-
-  // Release memory
-  if (m_Heap != NULL)
-    {
-    delete m_Heap;
-    m_Heap = NULL;
-    }
-  //m_HeapNodes.clear();
-  if (m_HeapNodes != NULL)
-    {
-    delete[] m_HeapNodes;
-    m_HeapNodes = NULL;
-    }
 }
 
 //-----------------------------------------------------------------------------
@@ -558,6 +636,23 @@ void vtkImageGrowCutSegment::Reset()
   this->Internal->Reset();
 }
 
+//-----------------------------------------------------------------------------
+void vtkImageGrowCutSegment::SetNumberOfThreads(int numberOfThreads)
+{
+  if (this->Internal->m_NumberOfThreads == numberOfThreads)
+    {
+    return;
+    }
+  this->Internal->m_NumberOfThreads = numberOfThreads;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkImageGrowCutSegment::GetNumberOfThreads()
+{
+  return this->Internal->m_NumberOfThreads;
+}
+
 //-----------------------------------------------------------------------------
 void vtkImageGrowCutSegment::PrintSelf(ostream &os, vtkIndent indent)
 {
@@ -23,6 +23,12 @@ public:
   // This method has to be called if intensity volume changes or if seeds are deleted after initial computation.
   void Reset();
 
+  // Number of threads used for the passes over all the voxels (initialization
+  // from the seeds and update of the voxels that have not been reached).
+  // 0 (default) uses vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads();
+
 protected:
   vtkImageGrowCutSegment();
   virtual ~vtkImageGrowCutSegment();
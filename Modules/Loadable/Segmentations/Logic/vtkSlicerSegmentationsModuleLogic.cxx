@@ -55,6 +55,7 @@
 #include <vtksys/SystemTools.hxx>
 
 // MRML includes
+#include <vtkImageDataCopyOnWrite.h>
 #include <vtkMRMLScene.h>
 #include "vtkMRMLSegmentationNode.h"
 #include "vtkMRMLSegmentationDisplayNode.h"
@@ -71,6 +72,7 @@
 #include <vtkEventBroker.h>
 
 // STD includes
+#include <algorithm>
 #include <sstream>
 
 //----------------------------------------------------------------------------
@@ -353,7 +355,8 @@ bool vtkSlicerSegmentationsModuleLogic::CopyOrientedImageDataToVolumeNode(
     }
   else
     {
-    identityImageData->DeepCopy(orientedImageData);
+    // voxels are shared copy-on-write, they are copied only when written
+    vtkImageDataCopyOnWrite::Copy(orientedImageData, identityImageData);
     }
   identityImageData->SetOrigin(0,0,0);
   identityImageData->SetSpacing(1,1,1);
@@ -381,7 +384,9 @@ vtkOrientedImageData* vtkSlicerSegmentationsModuleLogic::CreateOrientedImageData
     }
 
   vtkOrientedImageData* orientedImageData = vtkOrientedImageData::New();
-  orientedImageData->vtkImageData::DeepCopy(volumeNode->GetImageData());
+  // The voxels are shared copy-on-write by the copies of the volume, they
+  // are copied again only if the volume changed since its last copy
+  vtkImageDataCopyOnWrite::Copy(volumeNode->GetImageData(), orientedImageData);
 
   vtkSmartPointer<vtkMatrix4x4> ijkToRasMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
   volumeNode->GetIJKToRASMatrix(ijkToRasMatrix);
@@ -1803,6 +1808,9 @@ bool vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment(
   // 1. Append input labelmap to the segment labelmap if requested
   vtkSmartPointer<vtkOrientedImageData> newSegmentLabelmap = vtkSmartPointer<vtkOrientedImageData>::New();
   bool segmentLabelmapModified = true;
+  vtkMTimeType previousSegmentLabelmapMTime = segmentLabelmap->GetMTime();
+  // Voxels outside of extent are only known to be unchanged if merging on the same lattice
+  bool modifiedExtentKnown = false;
 
   int* segmentLabelmapExtent = segmentLabelmap->GetExtent();
   bool segmentLabelmapEmpty = (segmentLabelmapExtent[0] > segmentLabelmapExtent[1] ||
@@ -1851,6 +1859,7 @@ bool vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment(
         vtkErrorWithObjectMacro(segmentationNode, "vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment: Failed to merge labelmap (max)");
         return false;
         }
+      modifiedExtentKnown = (extent != NULL);
       }
     }
 
@@ -1901,6 +1910,15 @@ bool vtkSlicerSegmentationsModuleLogic::SetBinaryLabelmapToSegment(
   // Re-enable master representation modified event
   segmentationNode->GetSegmentation()->SetMasterRepresentationModifiedEnabled(wasMasterRepresentationModifiedEnabled);
   const char* segmentIdChar = segmentID.c_str();
+  if (modifiedExtentKnown)
+    {
+    // Allow observers (such as the undo/redo history) to only process the modified region
+    vtkSegmentation::MasterRepresentationExtentModifiedInfo modifiedInfo;
+    modifiedInfo.SegmentID = segmentIdChar;
+    std::copy(extent, extent + 6, modifiedInfo.Extent);
+    modifiedInfo.PreviousMTime = previousSegmentLabelmapMTime;
+    segmentationNode->GetSegmentation()->InvokeEvent(vtkSegmentation::MasterRepresentationExtentModified, &modifiedInfo);
+    }
   segmentationNode->GetSegmentation()->InvokeEvent(vtkSegmentation::MasterRepresentationModified, (void*)segmentIdChar);
   segmentationNode->GetSegmentation()->InvokeEvent(vtkSegmentation::RepresentationModified, (void*)segmentIdChar);
 
@@ -32,6 +32,7 @@
 #include "vtkImageLabelOutline.h"
 
 // SegmentationCore includes
+#include "vtkMergedSegmentLabelmap.h"
 #include "vtkSegmentation.h"
 #include "vtkOrientedImageData.h"
 #include "vtkOrientedImageDataResample.h"
@@ -257,10 +258,79 @@ public:
     vtkMTimeType SliceIntersectionUpdatedTime;
     };
 
+  /// Pipeline displaying all the binary labelmap segments of a display node
+  /// that share the same image geometry and do not overlap.
+  /// The segments are merged into a single labelmap (label i+1 for the i-th
+  /// merged segment) that is resliced once, and the fill and outline colors
+  /// of all the segments are applied with a single lookup table each.
+  struct MergedLabelmapPipeline
+    {
+    MergedLabelmapPipeline()
+      {
+      this->MergedLabelmap = vtkSmartPointer<vtkMergedSegmentLabelmap>::New();
+      this->ImageOutlineActor = vtkSmartPointer<vtkActor2D>::New();
+      this->ImageFillActor = vtkSmartPointer<vtkActor2D>::New();
+      this->Reslice = vtkSmartPointer<vtkImageReslice>::New();
+      this->SliceToImageTransform = vtkSmartPointer<vtkGeneralTransform>::New();
+      this->LabelOutline = vtkSmartPointer<vtkImageLabelOutline>::New();
+      this->LookupTableOutline = vtkSmartPointer<vtkLookupTable>::New();
+      this->LookupTableFill = vtkSmartPointer<vtkLookupTable>::New();
+
+      this->Reslice->SetBackgroundColor(0.0, 0.0, 0.0, 0.0);
+      this->Reslice->AutoCropOutputOff();
+      this->Reslice->SetOptimization(1);
+      this->Reslice->SetOutputOrigin(0.0, 0.0, 0.0);
+      this->Reslice->SetOutputSpacing(1.0, 1.0, 1.0);
+      this->Reslice->SetOutputDimensionality(3);
+      this->Reslice->SetInterpolationModeToNearestNeighbor();
+
+      this->SliceToImageTransform->PostMultiply();
+
+      // Image outline
+      this->LabelOutline->SetInputConnection(this->Reslice->GetOutputPort());
+      vtkSmartPointer<vtkImageMapToRGBA> outlineColorMapper = vtkSmartPointer<vtkImageMapToRGBA>::New();
+      outlineColorMapper->SetInputConnection(this->LabelOutline->GetOutputPort());
+      outlineColorMapper->SetOutputFormatToRGBA();
+      outlineColorMapper->SetLookupTable(this->LookupTableOutline);
+      vtkSmartPointer<vtkImageMapper> imageOutlineMapper = vtkSmartPointer<vtkImageMapper>::New();
+      imageOutlineMapper->SetInputConnection(outlineColorMapper->GetOutputPort());
+      imageOutlineMapper->SetColorWindow(255);
+      imageOutlineMapper->SetColorLevel(127.5);
+      this->ImageOutlineActor->SetMapper(imageOutlineMapper);
+      this->ImageOutlineActor->SetVisibility(0);
+
+      // Image fill
+      vtkSmartPointer<vtkImageMapToRGBA> fillColorMapper = vtkSmartPointer<vtkImageMapToRGBA>::New();
+      fillColorMapper->SetInputConnection(this->Reslice->GetOutputPort());
+      fillColorMapper->SetOutputFormatToRGBA();
+      fillColorMapper->SetLookupTable(this->LookupTableFill);
+      vtkSmartPointer<vtkImageMapper> imageFillMapper = vtkSmartPointer<vtkImageMapper>::New();
+      imageFillMapper->SetInputConnection(fillColorMapper->GetOutputPort());
+      imageFillMapper->SetColorWindow(255);
+      imageFillMapper->SetColorLevel(127.5);
+      this->ImageFillActor->SetMapper(imageFillMapper);
+      this->ImageFillActor->SetVisibility(0);
+      }
+
+    /// Labelmap of the merged segments
+    vtkSmartPointer<vtkMergedSegmentLabelmap> MergedLabelmap;
+
+    vtkSmartPointer<vtkActor2D> ImageOutlineActor;
+    vtkSmartPointer<vtkActor2D> ImageFillActor;
+    vtkSmartPointer<vtkImageReslice> Reslice;
+    vtkSmartPointer<vtkGeneralTransform> SliceToImageTransform;
+    vtkSmartPointer<vtkImageLabelOutline> LabelOutline;
+    vtkSmartPointer<vtkLookupTable> LookupTableOutline;
+    vtkSmartPointer<vtkLookupTable> LookupTableFill;
+    };
+
   typedef std::map<std::string, Pipeline*> PipelineMapType; // first: segment ID; second: display pipeline
   typedef std::map < vtkMRMLSegmentationDisplayNode*, PipelineMapType > PipelinesCacheType;
   PipelinesCacheType DisplayPipelines;
 
+  typedef std::map < vtkMRMLSegmentationDisplayNode*, MergedLabelmapPipeline* > MergedPipelinesCacheType;
+  MergedPipelinesCacheType MergedLabelmapPipelines;
+
   typedef std::map < vtkMRMLSegmentationNode*, std::set< vtkMRMLSegmentationDisplayNode* > > SegmentationToDisplayCacheType;
   SegmentationToDisplayCacheType SegmentationToDisplayNodes;
 
@@ -286,6 +356,16 @@ public:
   void UpdateDisplayNodePipeline(vtkMRMLSegmentationDisplayNode*, PipelineMapType);
   void RemoveDisplayNode(vtkMRMLSegmentationDisplayNode* displayNode);
 
+  // Merged labelmap
+  /// Display the binary labelmap segments that can be merged with a single reslice.
+  /// The IDs of the segments displayed by the merged pipeline are returned in
+  /// \a mergedSegmentIDs, their per-segment pipelines must be hidden.
+  void UpdateMergedLabelmapPipeline(vtkMRMLSegmentationDisplayNode* displayNode, PipelineMapType& pipelines,
+    std::set<std::string>& mergedSegmentIDs);
+  void UpdateMergedLabelmap(MergedLabelmapPipeline* mergedPipeline, vtkSegmentation* segmentation,
+    const std::vector<std::string>& candidateSegmentIDs);
+  void HideMergedLabelmapPipeline(vtkMRMLSegmentationDisplayNode* displayNode);
+
   // Observations
   void AddObservations(vtkMRMLSegmentationNode* node);
   void RemoveObservations(vtkMRMLSegmentationNode* node);
@@ -510,6 +590,15 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::RemoveDisplayNode(vt
     delete pipeline;
     }
   this->DisplayPipelines.erase(pipelinesIter);
+
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedLabelmapPipelines.find(displayNode);
+  if (mergedPipelineIt != this->MergedLabelmapPipelines.end())
+    {
+    this->External->GetRenderer()->RemoveActor(mergedPipelineIt->second->ImageOutlineActor);
+    this->External->GetRenderer()->RemoveActor(mergedPipelineIt->second->ImageFillActor);
+    delete mergedPipelineIt->second;
+    this->MergedLabelmapPipelines.erase(mergedPipelineIt);
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -681,6 +770,7 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
       pipelineIt->second->ImageOutlineActor->SetVisibility(false);
       pipelineIt->second->ImageFillActor->SetVisibility(false);
       }
+    this->HideMergedLabelmapPipeline(displayNode);
     return;
     }
 
@@ -702,11 +792,24 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
     return;
     }
 
+  // Segments sharing the same labelmap geometry are displayed by a single merged pipeline
+  std::set<std::string> mergedSegmentIDs;
+  this->UpdateMergedLabelmapPipeline(displayNode, pipelines, mergedSegmentIDs);
+
   // For all pipelines (pipeline per segment)
   for (PipelineMapType::iterator pipelineIt=pipelines.begin(); pipelineIt!=pipelines.end(); ++pipelineIt)
     {
     Pipeline* pipeline = pipelineIt->second;
 
+    if (mergedSegmentIDs.find(pipelineIt->first) != mergedSegmentIDs.end())
+      {
+      pipeline->PolyDataOutlineActor->SetVisibility(false);
+      pipeline->PolyDataFillActor->SetVisibility(false);
+      pipeline->ImageOutlineActor->SetVisibility(false);
+      pipeline->ImageFillActor->SetVisibility(false);
+      continue;
+      }
+
     // Get visibility
     vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
     displayNode->GetSegmentDisplayProperties(pipelineIt->first, properties);
@@ -967,6 +1070,194 @@ void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateDisplayNodePip
     }
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::HideMergedLabelmapPipeline(vtkMRMLSegmentationDisplayNode* displayNode)
+{
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedLabelmapPipelines.find(displayNode);
+  if (mergedPipelineIt == this->MergedLabelmapPipelines.end())
+    {
+    return;
+    }
+  mergedPipelineIt->second->ImageOutlineActor->SetVisibility(false);
+  mergedPipelineIt->second->ImageFillActor->SetVisibility(false);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateMergedLabelmap(
+  MergedLabelmapPipeline* mergedPipeline, vtkSegmentation* segmentation, const std::vector<std::string>& candidateSegmentIDs)
+{
+  // Only the modified segments are written again in the merged labelmap.
+  // Candidate segments include the hidden ones, so changes in visibility,
+  // color or opacity only change the lookup table values.
+  std::vector<vtkOrientedImageData*> segmentImages;
+  for (std::vector<std::string>::const_iterator segmentIdIt = candidateSegmentIDs.begin(); segmentIdIt != candidateSegmentIDs.end(); ++segmentIdIt)
+    {
+    segmentImages.push_back(vtkOrientedImageData::SafeDownCast(
+      segmentation->GetSegmentRepresentation(*segmentIdIt, vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName())));
+    }
+  mergedPipeline->MergedLabelmap->Update(candidateSegmentIDs, segmentImages);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::UpdateMergedLabelmapPipeline(
+  vtkMRMLSegmentationDisplayNode* displayNode, PipelineMapType& pipelines, std::set<std::string>& mergedSegmentIDs)
+{
+  mergedSegmentIDs.clear();
+
+  vtkMRMLSegmentationNode* segmentationNode = vtkMRMLSegmentationNode::SafeDownCast(displayNode->GetDisplayableNode());
+  vtkSegmentation* segmentation = (segmentationNode ? segmentationNode->GetSegmentation() : NULL);
+  std::string shownRepresentationName = displayNode->GetDisplayRepresentationName2D();
+  if (!segmentation || pipelines.empty() || !this->IsVisible(displayNode) || !this->SliceNode
+    || shownRepresentationName != vtkSegmentationConverter::GetSegmentationBinaryLabelmapRepresentationName())
+    {
+    this->HideMergedLabelmapPipeline(displayNode);
+    return;
+    }
+
+  // Collect the shown binary labelmaps that have the same geometry as the first one
+  std::vector<std::string> candidateSegmentIDs;
+  vtkNew<vtkMatrix4x4> referenceImageToWorldMatrix;
+  vtkNew<vtkMatrix4x4> imageToWorldMatrix;
+  std::vector<std::string> segmentIDs;
+  segmentation->GetSegmentIDs(segmentIDs);
+  for (std::vector<std::string>::const_iterator segmentIdIt = segmentIDs.begin(); segmentIdIt != segmentIDs.end(); ++segmentIdIt)
+    {
+    if (pipelines.find(*segmentIdIt) == pipelines.end()
+      || candidateSegmentIDs.size() >= static_cast<size_t>(VTK_UNSIGNED_SHORT_MAX))
+      {
+      continue;
+      }
+    // Hidden segments are kept in the merged labelmap with a transparent
+    // color, so that showing or hiding a segment does not rewrite it.
+    vtkOrientedImageData* imageData = vtkOrientedImageData::SafeDownCast(
+      segmentation->GetSegmentRepresentation(*segmentIdIt, shownRepresentationName));
+    if (!imageData || imageData->GetNumberOfScalarComponents() != 1)
+      {
+      continue;
+      }
+    int* imageExtent = imageData->GetExtent();
+    if (imageExtent[0]>imageExtent[1] || imageExtent[2]>imageExtent[3] || imageExtent[4]>imageExtent[5])
+      {
+      continue;
+      }
+    // Labelmaps with a scalar range or threshold are interpolated and thresholded per segment
+    if (imageData->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetScalarRangeFieldName())
+      || imageData->GetFieldData()->GetAbstractArray(vtkSegmentationConverter::GetThresholdValueFieldName()))
+      {
+      continue;
+      }
+    imageData->GetImageToWorldMatrix(imageToWorldMatrix.GetPointer());
+    if (candidateSegmentIDs.empty())
+      {
+      referenceImageToWorldMatrix->DeepCopy(imageToWorldMatrix.GetPointer());
+      }
+    else if (!vtkOrientedImageDataResample::IsEqual(referenceImageToWorldMatrix.GetPointer(), imageToWorldMatrix.GetPointer()))
+      {
+      continue;
+      }
+    candidateSegmentIDs.push_back(*segmentIdIt);
+    }
+  // A single segment is displayed as efficiently by its own pipeline
+  if (candidateSegmentIDs.size() < 2)
+    {
+    this->HideMergedLabelmapPipeline(displayNode);
+    return;
+    }
+
+  MergedLabelmapPipeline* mergedPipeline = NULL;
+  MergedPipelinesCacheType::iterator mergedPipelineIt = this->MergedLabelmapPipelines.find(displayNode);
+  if (mergedPipelineIt != this->MergedLabelmapPipelines.end())
+    {
+    mergedPipeline = mergedPipelineIt->second;
+    }
+  else
+    {
+    mergedPipeline = new MergedLabelmapPipeline();
+    this->External->GetRenderer()->AddActor(mergedPipeline->ImageOutlineActor);
+    this->External->GetRenderer()->AddActor(mergedPipeline->ImageFillActor);
+    this->MergedLabelmapPipelines[displayNode] = mergedPipeline;
+    }
+
+  this->UpdateMergedLabelmap(mergedPipeline, segmentation, candidateSegmentIDs);
+  const std::vector<std::string>& mergedLabelmapSegmentIDs = mergedPipeline->MergedLabelmap->GetMergedSegmentIDs();
+  int numberOfLabels = static_cast<int>(mergedLabelmapSegmentIDs.size());
+  if (numberOfLabels < 2)
+    {
+    this->HideMergedLabelmapPipeline(displayNode);
+    return;
+    }
+
+  // Set segment colors: label i+1 is the i-th merged segment
+  mergedPipeline->LookupTableFill->SetNumberOfTableValues(numberOfLabels + 1);
+  mergedPipeline->LookupTableFill->SetTableRange(0, numberOfLabels);
+  mergedPipeline->LookupTableFill->SetTableValue(0, 0, 0, 0, 0);
+  mergedPipeline->LookupTableOutline->SetNumberOfTableValues(numberOfLabels + 1);
+  mergedPipeline->LookupTableOutline->SetTableRange(0, numberOfLabels);
+  mergedPipeline->LookupTableOutline->SetTableValue(0, 0, 0, 0, 0);
+  bool outlineVisible = false;
+  bool fillVisible = false;
+  for (int label = 1; label <= numberOfLabels; ++label)
+    {
+    const std::string& segmentID = mergedLabelmapSegmentIDs[label - 1];
+    mergedSegmentIDs.insert(segmentID);
+
+    vtkMRMLSegmentationDisplayNode::SegmentDisplayProperties properties;
+    displayNode->GetSegmentDisplayProperties(segmentID, properties);
+    bool segmentOutlineVisible = properties.Visible && properties.Visible2DOutline && displayNode->GetVisibility2DOutline();
+    bool segmentFillVisible = properties.Visible && properties.Visible2DFill && displayNode->GetVisibility2DFill();
+    outlineVisible = outlineVisible || segmentOutlineVisible;
+    fillVisible = fillVisible || segmentFillVisible;
+
+    double color[3] = {vtkSegment::SEGMENT_COLOR_INVALID[0], vtkSegment::SEGMENT_COLOR_INVALID[1], vtkSegment::SEGMENT_COLOR_INVALID[2]};
+    displayNode->GetSegmentColor(segmentID, color);
+    mergedPipeline->LookupTableOutline->SetTableValue(label, color[0], color[1], color[2],
+      segmentOutlineVisible ? properties.Opacity2DOutline * displayNode->GetOpacity2DOutline() * displayNode->GetOpacity() : 0.0);
+    mergedPipeline->LookupTableFill->SetTableValue(label, color[0], color[1], color[2],
+      segmentFillVisible ? properties.Opacity2DFill * displayNode->GetOpacity2DFill() * displayNode->GetOpacity() : 0.0);
+    }
+
+  // Calculate slice XY to merged image IJK transform
+  // (all the pipelines of the display node share the same node to world transform)
+  vtkNew<vtkMatrix4x4> worldToImageMatrix;
+  vtkMatrix4x4::Invert(mergedPipeline->MergedLabelmap->GetImageToWorldMatrix(), worldToImageMatrix.GetPointer());
+  mergedPipeline->SliceToImageTransform->Identity();
+  mergedPipeline->SliceToImageTransform->Concatenate(this->SliceXYToRAS);
+  mergedPipeline->SliceToImageTransform->Concatenate(pipelines.begin()->second->WorldToNodeTransform);
+  mergedPipeline->SliceToImageTransform->Concatenate(worldToImageMatrix.GetPointer());
+
+  vtkSmartPointer<vtkTransform> linearSliceToImageTransform = vtkSmartPointer<vtkTransform>::New();
+  if (vtkMRMLTransformNode::IsGeneralTransformLinear(mergedPipeline->SliceToImageTransform, linearSliceToImageTransform))
+    {
+    SnapToPermuteMatrix(linearSliceToImageTransform);
+    mergedPipeline->Reslice->SetResliceTransform(linearSliceToImageTransform);
+    }
+  else
+    {
+    mergedPipeline->Reslice->SetResliceTransform(mergedPipeline->SliceToImageTransform);
+    }
+  mergedPipeline->Reslice->SetInputData(mergedPipeline->MergedLabelmap->GetMergedImage());
+
+  int dimensions[3] = { 0, 0, 0 };
+  this->SliceNode->GetDimensions(dimensions);
+  int sliceOutputExtent[6] = { 0, dimensions[0] - 1, 0, dimensions[1] - 1, 0, dimensions[2] - 1 };
+  mergedPipeline->Reslice->SetOutputExtent(sliceOutputExtent);
+
+  if (outlineVisible)
+    {
+    mergedPipeline->LabelOutline->SetInputConnection(mergedPipeline->Reslice->GetOutputPort());
+    mergedPipeline->LabelOutline->SetOutline(displayNode->GetSliceIntersectionThickness());
+    }
+  else
+    {
+    mergedPipeline->LabelOutline->SetInputConnection(NULL);
+    }
+
+  mergedPipeline->ImageOutlineActor->SetVisibility(outlineVisible);
+  mergedPipeline->ImageOutlineActor->SetPosition(0,0);
+  mergedPipeline->ImageFillActor->SetVisibility(fillVisible);
+  mergedPipeline->ImageFillActor->SetPosition(0,0);
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLSegmentationsDisplayableManager2D::vtkInternal::AddObservations(vtkMRMLSegmentationNode* node)
 {
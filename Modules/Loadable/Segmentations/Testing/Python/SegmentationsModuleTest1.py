@@ -1,6 +1,7 @@
 import os
 import unittest
 import vtk, qt, ctk, slicer
+import teem
 import logging
 
 import vtkSegmentationCorePython as vtkSegmentationCore
@@ -27,6 +28,7 @@ class SegmentationsModuleTest1(unittest.TestCase):
     self.TestSection_LoadInputData()
     self.TestSection_AddRemoveSegment()
     self.TestSection_MergeLabelmapWithDifferentGeometries()
+    self.TestSection_SaveLoadSegmentsInLayers()
     self.TestSection_ImportExportSegment()
     self.TestSection_SubjectHierarchy()
 
@@ -242,6 +244,72 @@ class SegmentationsModuleTest1(unittest.TestCase):
     self.assertEqual(imageStatResult.GetScalarComponentAsDouble(3,0,0,0), 445489)
     self.assertEqual(imageStatResult.GetScalarComponentAsDouble(4,0,0,0), 0)  # Built from color table and color four is removed in previous test section
 
+  #------------------------------------------------------------------------------
+  def TestSection_SaveLoadSegmentsInLayers(self):
+    # Save segments that share labelmap layers, load them back and check that they are unchanged
+    logging.info('Test section: Save/load segments in layers')
+
+    segmentationNode = slicer.vtkMRMLSegmentationNode()
+    segmentationNode.GetSegmentation().SetMasterRepresentationName(self.binaryLabelmapReprName)
+    slicer.mrmlScene.AddNode(segmentationNode)
+
+    # Two disjoint boxes, stored in the same layer, and a box overlapping both of them
+    boxExtents = [[0,9,0,9,0,9], [20,29,0,9,0,9], [5,24,5,14,0,4]]
+    for boxIndex, boxExtent in enumerate(boxExtents):
+      labelmap = vtkSegmentationCore.vtkOrientedImageData()
+      labelmap.SetExtent(0,29,0,19,0,9)
+      labelmap.AllocateScalars(vtk.VTK_UNSIGNED_CHAR, 1)
+      vtkSegmentationCore.vtkOrientedImageDataResample.FillImage(labelmap, 0)
+      vtkSegmentationCore.vtkOrientedImageDataResample.FillImage(labelmap, 1, boxExtent)
+      segment = vtkSegmentationCore.vtkSegment()
+      segment.SetName('Box{0}'.format(boxIndex))
+      segment.AddRepresentation(self.binaryLabelmapReprName, labelmap)
+      segmentationNode.GetSegmentation().AddSegment(segment)
+
+    # By default each segment is written in its own component
+    legacySegmentationFilePath = self.segmentationsModuleTestDir + '/SegmentsNotInLayers.seg.nrrd'
+    self.assertTrue(slicer.util.saveNode(segmentationNode, legacySegmentationFilePath))
+    reader = teem.vtkNRRDReader()
+    reader.SetFileName(legacySegmentationFilePath)
+    reader.Update()
+    self.assertEqual(reader.GetOutput().GetNumberOfScalarComponents(), 3)
+    self.assertIsNone(reader.GetHeaderValue('Segment0_Layer'))
+
+    segmentationFilePath = self.segmentationsModuleTestDir + '/SegmentsInLayers.seg.nrrd'
+    storageNode = segmentationNode.CreateDefaultStorageNode()
+    storageNode.SetSegmentsInLayers(True)
+    storageNode.SetFileName(segmentationFilePath)
+    self.assertTrue(storageNode.WriteData(segmentationNode))
+
+    # The two disjoint boxes share the first layer, the overlapping box is in a second layer
+    reader.SetFileName(segmentationFilePath)
+    reader.Update()
+    self.assertEqual(reader.GetOutput().GetNumberOfScalarComponents(), 2)
+    self.assertEqual(reader.GetHeaderValue('Segment0_Layer'), '0')
+    self.assertEqual(reader.GetHeaderValue('Segment1_Layer'), '0')
+    self.assertEqual(reader.GetHeaderValue('Segment2_Layer'), '1')
+    self.assertNotEqual(reader.GetHeaderValue('Segment0_LabelValue'), reader.GetHeaderValue('Segment1_LabelValue'))
+
+    [success, loadedSegmentationNode] = slicer.util.loadSegmentation(segmentationFilePath, returnNode=True)
+    self.assertTrue(success)
+
+    loadedSegmentation = loadedSegmentationNode.GetSegmentation()
+    self.assertEqual(loadedSegmentation.GetNumberOfSegments(), 3)
+    for boxIndex, boxExtent in enumerate(boxExtents):
+      segment = loadedSegmentation.GetNthSegment(boxIndex)
+      self.assertEqual(segment.GetName(), 'Box{0}'.format(boxIndex))
+      labelmap = segment.GetRepresentation(self.binaryLabelmapReprName)
+      # Segments are loaded at their effective extent
+      self.assertEqual(list(labelmap.GetExtent()), boxExtent)
+      imageStat = vtk.vtkImageAccumulate()
+      imageStat.SetInputData(labelmap)
+      imageStat.IgnoreZeroOn()
+      imageStat.Update()
+      self.assertEqual(imageStat.GetVoxelCount(), 1000)
+
+    slicer.mrmlScene.RemoveNode(segmentationNode)
+    slicer.mrmlScene.RemoveNode(loadedSegmentationNode)
+
   #------------------------------------------------------------------------------
   def TestSection_ImportExportSegment(self):
     # Import/export, both one label and all labels
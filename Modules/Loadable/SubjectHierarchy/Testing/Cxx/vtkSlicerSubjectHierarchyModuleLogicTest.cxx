@@ -57,6 +57,7 @@ namespace
   bool TestInsertDicomSeriesPopulatedScene();
   bool TestVisibilityOperations();
   bool TestTransformBranch();
+  bool TestLookupAfterChanges();
 
   const char* STUDY_ATTRIBUTE_NAME = "TestStudyAttribute";
   const char* STUDY_ATTRIBUTE_VALUE = "1";
@@ -281,6 +282,11 @@ namespace
       std::cerr << "'TestTransformBranch' call not successful." << std::endl;
       return false;
       }
+    if (!TestLookupAfterChanges())
+      {
+      std::cerr << "'TestLookupAfterChanges' call not successful." << std::endl;
+      return false;
+      }
     return true;
     }
 
@@ -867,4 +873,79 @@ namespace
     return true;
     }
 
+  //---------------------------------------------------------------------------
+  bool TestLookupAfterChanges()
+    {
+    vtkNew<vtkMRMLScene> scene;
+    if (!PopulateScene(scene.GetPointer()))
+      {
+      return false;
+      }
+
+    vtkMRMLSubjectHierarchyNode* shNode = vtkMRMLSubjectHierarchyNode::GetSubjectHierarchyNode(scene.GetPointer());
+    if (!shNode)
+      {
+      return false;
+      }
+
+    vtkIdType patientShItemID = shNode->GetItemByUID(UID_NAME, PATIENT_UID_VALUE);
+    vtkIdType study1ShItemID = shNode->GetItemByUID(UID_NAME, STUDY1_UID_VALUE);
+    vtkIdType study2ShItemID = shNode->GetItemByUID(UID_NAME, STUDY2_UID_VALUE);
+    vtkIdType volume1ShItemID = shNode->GetItemByUID(UID_NAME, VOLUME1_UID_VALUE);
+    vtkMRMLNode* volume1Node = shNode->GetItemDataNode(volume1ShItemID);
+
+    // Lookup by name follows renaming and reparenting
+    shNode->SetItemName(study1ShItemID, "RenamedStudy");
+    if ( shNode->GetItemChildWithName(patientShItemID, "Study1") != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+      || shNode->GetItemChildWithName(patientShItemID, "RenamedStudy") != study1ShItemID )
+      {
+      std::cerr << "Failed to find renamed study by name" << std::endl;
+      return false;
+      }
+    shNode->SetItemParent(volume1ShItemID, study2ShItemID);
+    if ( shNode->GetItemChildWithName(study1ShItemID, "Volume1") != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+      || shNode->GetItemChildWithName(study2ShItemID, "Volume1") != volume1ShItemID )
+      {
+      std::cerr << "Failed to find reparented series by name" << std::endl;
+      return false;
+      }
+    // Name of items with data node is the name of the data node
+    volume1Node->SetName("RenamedVolume1");
+    if (shNode->GetItemChildWithName(study2ShItemID, "RenamedVolume1") != volume1ShItemID)
+      {
+      std::cerr << "Failed to find series by the name of its data node" << std::endl;
+      return false;
+      }
+
+    // Lookup by element of UID list
+    shNode->SetItemUID(volume1ShItemID, vtkMRMLSubjectHierarchyConstants::GetDICOMInstanceUIDName(), "1.2.3 1.2.34 1.2.5");
+    if ( shNode->GetItemByUIDList(vtkMRMLSubjectHierarchyConstants::GetDICOMInstanceUIDName(), "1.2.34") != volume1ShItemID
+      || shNode->GetItemByUIDList(vtkMRMLSubjectHierarchyConstants::GetDICOMInstanceUIDName(), "1.2.5") != volume1ShItemID
+      || shNode->GetItemByUIDList(vtkMRMLSubjectHierarchyConstants::GetDICOMInstanceUIDName(), "1.2.6") != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID )
+      {
+      std::cerr << "Failed to find series by instance UID" << std::endl;
+      return false;
+      }
+    // Replaced UID is not found anymore
+    shNode->SetItemUID(volume1ShItemID, UID_NAME, "VOLUME1_REPLACED");
+    if ( shNode->GetItemByUID(UID_NAME, VOLUME1_UID_VALUE) != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+      || shNode->GetItemByUID(UID_NAME, "VOLUME1_REPLACED") != volume1ShItemID )
+      {
+      std::cerr << "Failed to find series by replaced UID" << std::endl;
+      return false;
+      }
+
+    // Removed items are not found
+    shNode->RemoveItem(volume1ShItemID, false);
+    if ( shNode->GetItemByDataNode(volume1Node) != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+      || shNode->GetItemByUID(UID_NAME, "VOLUME1_REPLACED") != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID
+      || shNode->GetItemChildWithName(study2ShItemID, "RenamedVolume1") != vtkMRMLSubjectHierarchyNode::INVALID_ITEM_ID )
+      {
+      std::cerr << "Removed series is still found" << std::endl;
+      return false;
+      }
+
+    return true;
+    }
+
 } // end of anonymous namespace
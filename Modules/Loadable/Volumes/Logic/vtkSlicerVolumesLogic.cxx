@@ -26,6 +26,7 @@
 // MRML nodes includes
 #include "vtkCacheManager.h"
 #include "vtkDataIOManager.h"
+#include "vtkImageDataCopyOnWrite.h"
 #include "vtkMRMLDiffusionTensorVolumeDisplayNode.h"
 #include "vtkMRMLDiffusionTensorVolumeNode.h"
 #include "vtkMRMLDiffusionTensorVolumeSliceDisplayNode.h"
@@ -950,9 +951,11 @@ vtkSlicerVolumesLogic::CreateLabelVolumeFromVolume(vtkMRMLScene *scene,
     outputVolume->SetNodeReferenceID("AssociatedNodeID", inputVolume->GetID());
     }
 
-  // Copy and set image data of the input volume to the label volume
+  // Copy and set image data of the input volume to the label volume.
+  // The voxels are shared copy-on-write by the copies of the input volume,
+  // a page is duplicated when a copy writes it.
   vtkNew<vtkImageData> imageData;
-  imageData->DeepCopy(inputVolume->GetImageData());
+  vtkImageDataCopyOnWrite::Copy(inputVolume->GetImageData(), imageData.GetPointer());
   outputVolume->SetAndObserveImageData(imageData.GetPointer());
 
   vtkNew<vtkMatrix4x4> ijkToRas;
@@ -993,9 +996,11 @@ vtkMRMLScalarVolumeNode* vtkSlicerVolumesLogic::CreateScalarVolumeFromVolume(
     outputVolume->SetNodeReferenceID("AssociatedNodeID", inputVolume->GetID());
     }
 
-  // Copy and set image data of the input volume to the label volume
+  // Copy and set image data of the input volume to the label volume.
+  // The voxels are shared copy-on-write by the copies of the input volume,
+  // a page is duplicated when a copy writes it.
   vtkNew<vtkImageData> imageData;
-  imageData->DeepCopy(inputVolume->GetImageData());
+  vtkImageDataCopyOnWrite::Copy(inputVolume->GetImageData(), imageData.GetPointer());
   outputVolume->SetAndObserveImageData(imageData.GetPointer());
 
   vtkNew<vtkMatrix4x4> ijkToRas;
@@ -1297,8 +1302,10 @@ CloneVolumeGeneric (vtkMRMLScene *scene, vtkMRMLVolumeNode *volumeNode, const ch
     // copy over the volume's data
     if (volumeNode->GetImageData())
       {
+      // voxels are shared copy-on-write by the clones of the volume, a page
+      // is duplicated when a clone writes it
       vtkNew<vtkImageData> clonedVolumeData;
-      clonedVolumeData->DeepCopy(volumeNode->GetImageData());
+      vtkImageDataCopyOnWrite::Copy(volumeNode->GetImageData(), clonedVolumeData.GetPointer());
       clonedVolumeNode->SetAndObserveImageData( clonedVolumeData.GetPointer() );
       }
     else
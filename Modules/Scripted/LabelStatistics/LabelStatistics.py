@@ -301,70 +301,26 @@ class LabelStatisticsLogic(ScriptedLoadableModuleLogic):
     self.labelStats = {}
     self.labelStats['Labels'] = []
 
-    stataccum = vtk.vtkImageAccumulate()
-    stataccum.SetInputConnection(labelNode.GetImageDataConnection())
-    stataccum.Update()
-    lo = int(stataccum.GetMin()[0])
-    hi = int(stataccum.GetMax()[0])
-
-    for i in xrange(lo,hi+1):
-
-      # this->SetProgress((float)i/hi);
-      # std::string event_message = "Label "; std::stringstream s; s << i; event_message.append(s.str());
-      # this->InvokeEvent(vtkLabelStatisticsLogic::LabelStatsOuterLoop, (void*)event_message.c_str());
-
-      # logic copied from slicer3 LabelStatistics
-      # to create the binary volume of the label
-      # //logic copied from slicer2 LabelStatistics MaskStat
-      # // create the binary volume of the label
-      thresholder = vtk.vtkImageThreshold()
-      thresholder.SetInputConnection(labelNode.GetImageDataConnection())
-      thresholder.SetInValue(1)
-      thresholder.SetOutValue(0)
-      thresholder.ReplaceOutOn()
-      thresholder.ThresholdBetween(i,i)
-      thresholder.SetOutputScalarType(grayscaleNode.GetImageData().GetScalarType())
-      thresholder.Update()
-
-      # this.InvokeEvent(vtkLabelStatisticsLogic::LabelStatsInnerLoop, (void*)"0.25");
-
-      #  use vtk's statistics class with the binary labelmap as a stencil
-      stencil = vtk.vtkImageToImageStencil()
-      stencil.SetInputConnection(thresholder.GetOutputPort())
-      stencil.ThresholdBetween(1, 1)
-
-      # this.InvokeEvent(vtkLabelStatisticsLogic::LabelStatsInnerLoop, (void*)"0.5")
-
-      stat1 = vtk.vtkImageAccumulate()
-      stat1.SetInputConnection(grayscaleNode.GetImageDataConnection())
-      stencil.Update()
-      stat1.SetStencilData(stencil.GetOutput())
-
-      stat1.Update()
-
-      medians = vtk.vtkImageHistogramStatistics()
-      medians.SetInputConnection(grayscaleNode.GetImageDataConnection())
-      stencil.Update()
-      medians.SetStencilData(stencil.GetOutput())
-
-      medians.Update()
-
-      # this.InvokeEvent(vtkLabelStatisticsLogic::LabelStatsInnerLoop, (void*)"0.75")
-
-      if stat1.GetVoxelCount() > 0:
-        # add an entry to the LabelStats list
-        self.labelStats["Labels"].append(i)
-        self.labelStats[i,"Index"] = i
-        self.labelStats[i,"Count"] = stat1.GetVoxelCount()
-        self.labelStats[i,"Volume mm^3"] = self.labelStats[i,"Count"] * cubicMMPerVoxel
-        self.labelStats[i,"Volume cc"] = self.labelStats[i,"Volume mm^3"] * ccPerCubicMM
-        self.labelStats[i,"Min"] = stat1.GetMin()[0]
-        self.labelStats[i,"Max"] = stat1.GetMax()[0]
-        self.labelStats[i,"Mean"] = stat1.GetMean()[0]
-        self.labelStats[i,"Median"] = medians.GetMedian()
-        self.labelStats[i,"StdDev"] = stat1.GetStandardDeviation()[0]
-
-        # this.InvokeEvent(vtkLabelStatisticsLogic::LabelStatsInnerLoop, (void*)"1")
+    # compute the statistics of all the labels in a single pass
+    statistics = slicer.vtkImageLabelStatistics()
+    statistics.SetLabelImage(labelNode.GetImageData())
+    statistics.SetScalarImage(grayscaleNode.GetImageData())
+    statistics.SetVoxelVolume(cubicMMPerVoxel)
+    statistics.Compute()
+
+    for labelIndex in xrange(statistics.GetNumberOfLabels()):
+      i = statistics.GetNthLabel(labelIndex)
+      # add an entry to the LabelStats list
+      self.labelStats["Labels"].append(i)
+      self.labelStats[i,"Index"] = i
+      self.labelStats[i,"Count"] = statistics.GetVoxelCount(i)
+      self.labelStats[i,"Volume mm^3"] = statistics.GetVolume(i)
+      self.labelStats[i,"Volume cc"] = self.labelStats[i,"Volume mm^3"] * ccPerCubicMM
+      self.labelStats[i,"Min"] = statistics.GetMinimum(i)
+      self.labelStats[i,"Max"] = statistics.GetMaximum(i)
+      self.labelStats[i,"Mean"] = statistics.GetMean(i)
+      self.labelStats[i,"Median"] = statistics.GetMedian(i)
+      self.labelStats[i,"StdDev"] = statistics.GetStandardDeviation(i)
 
     # this.InvokeEvent(vtkLabelStatisticsLogic::EndLabelStats, (void*)"end label stats")
 
@@ -41,27 +41,22 @@ class LabelmapSegmentStatisticsPlugin(SegmentStatisticsPluginBase):
     thresh.SetOutputScalarType(vtk.VTK_UNSIGNED_CHAR)
     thresh.Update()
 
-    #  Use binary labelmap as a stencil
-    stencil = vtk.vtkImageToImageStencil()
-    stencil.SetInputData(thresh.GetOutput())
-    stencil.ThresholdByUpper(labelValue)
-    stencil.Update()
-
-    stat = vtk.vtkImageAccumulate()
-    stat.SetInputData(thresh.GetOutput())
-    stat.SetStencilData(stencil.GetOutput())
-    stat.Update()
+    # Count the segment voxels
+    stat = slicer.vtkImageLabelStatistics()
+    stat.SetLabelImage(thresh.GetOutput())
+    stat.Compute()
 
     # Add data to statistics list
     cubicMMPerVoxel = reduce(lambda x,y: x*y, segmentLabelmap.GetSpacing())
     ccPerCubicMM = 0.001
     stats = {}
+    voxelCount = stat.GetVoxelCount(labelValue)
     if "voxel_count" in requestedKeys:
-      stats["voxel_count"] = stat.GetVoxelCount()
+      stats["voxel_count"] = voxelCount
     if "volume_mm3" in requestedKeys:
-      stats["volume_mm3"] = stat.GetVoxelCount() * cubicMMPerVoxel
+      stats["volume_mm3"] = voxelCount * cubicMMPerVoxel
     if "volume_cm3" in requestedKeys:
-      stats["volume_cm3"] = stat.GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM
+      stats["volume_cm3"] = voxelCount * cubicMMPerVoxel * ccPerCubicMM
     return stats
 
   def getMeasurementInfo(self, key):
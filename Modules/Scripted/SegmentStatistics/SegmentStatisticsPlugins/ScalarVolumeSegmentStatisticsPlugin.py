@@ -68,41 +68,34 @@ class ScalarVolumeSegmentStatisticsPlugin(SegmentStatisticsPluginBase):
     thresh.SetOutputScalarType(vtk.VTK_UNSIGNED_CHAR)
     thresh.Update()
 
-    #  Use binary labelmap as a stencil
-    stencil = vtk.vtkImageToImageStencil()
-    stencil.SetInputData(thresh.GetOutput())
-    stencil.ThresholdByUpper(labelValue)
-    stencil.Update()
-
-    stat = vtk.vtkImageAccumulate()
-    stat.SetInputData(grayscaleNode.GetImageData())
-    stat.SetStencilData(stencil.GetOutput())
-    stat.Update()
-
-    medians = vtk.vtkImageHistogramStatistics()
-    medians.SetInputData(grayscaleNode.GetImageData())
-    medians.SetStencilData(stencil.GetOutput())
-    medians.Update()
+    # Compute all the statistics of the segment voxels in a single pass
+    stat = slicer.vtkImageLabelStatistics()
+    stat.SetLabelImage(thresh.GetOutput())
+    stat.SetScalarImage(grayscaleNode.GetImageData())
+    stat.SetVoxelVolume(cubicMMPerVoxel)
+    stat.SetComputeMedian("median" in requestedKeys)
+    stat.Compute()
+    voxelCount = stat.GetVoxelCount(labelValue)
 
     # create statistics list
     stats = {}
     if "voxel_count" in requestedKeys:
-      stats["voxel_count"] = stat.GetVoxelCount()
+      stats["voxel_count"] = voxelCount
     if "volume_mm3" in requestedKeys:
-      stats["volume_mm3"] = stat.GetVoxelCount() * cubicMMPerVoxel
+      stats["volume_mm3"] = stat.GetVolume(labelValue)
     if "volume_cm3" in requestedKeys:
-      stats["volume_cm3"] = stat.GetVoxelCount() * cubicMMPerVoxel * ccPerCubicMM
-    if stat.GetVoxelCount()>0:
+      stats["volume_cm3"] = stat.GetVolume(labelValue) * ccPerCubicMM
+    if voxelCount>0:
       if "min" in requestedKeys:
-        stats["min"] = stat.GetMin()[0]
+        stats["min"] = stat.GetMinimum(labelValue)
       if "max" in requestedKeys:
-        stats["max"] = stat.GetMax()[0]
+        stats["max"] = stat.GetMaximum(labelValue)
       if "mean" in requestedKeys:
-        stats["mean"] = stat.GetMean()[0]
+        stats["mean"] = stat.GetMean(labelValue)
       if "stdev" in requestedKeys:
-        stats["stdev"] = stat.GetStandardDeviation()[0]
+        stats["stdev"] = stat.GetStandardDeviation(labelValue)
       if "median" in requestedKeys:
-        stats["median"] = medians.GetMedian()
+        stats["median"] = stat.GetMedian(labelValue)
     return stats
 
   def getMeasurementInfo(self, key):